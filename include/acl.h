@@ -0,0 +1,79 @@
+#pragma once
+/*
+ * Liste d'accès locale (autorisé / refusé) pour décider sans l'API.
+ *
+ * /acl/list.bin : en-tête de 16 octets puis entrées de 12 octets triées par
+ * clé (UID complété de zéros sur 10 octets + taille). La recherche passe par
+ * un filtre de Bloom en RAM puis par un index creux (une clé toutes les
+ * ACL_FENCE_STRIDE entrées) : une seule lecture flash par UID connu.
+ *
+ * Le filtre est dimensionné au chargement d'après le nombre d'entrées :
+ * ACL_BLOOM_BITS_PER_UID bits par UID et k = 0,69 x bits/UID hachages
+ * (environ 1 % de faux positifs). Sa taille est bornée par ACL_BLOOM_MAX_BYTES
+ * et par le plus grand bloc libre moins ACL_HEAP_RESERVE. Filtre plafonné :
+ * k est recalculé pour les bits disponibles et le taux de faux positifs
+ * remonte (4 % à 40 000 UID sur 32 Ko) ; aclStatusJson() donne le taux
+ * attendu (bloomFpp).
+ *
+ * Synchronisation : GET <source>?since=<version>, réponse texte ligne à ligne
+ *   ACL FULL <version>           liste complète, triée (ordre hexadécimal)
+ *   ACL DELTA <base> <version>   modifications depuis <base>
+ *   +<uid> autorisé, -<uid> refusé, ~<uid> retiré de la liste
+ * La nouvelle liste est écrite dans /acl/list.new puis renommée : une
+ * synchronisation interrompue laisse la version précédente intacte.
+ */
+#include <Arduino.h>
+
+#define ACL_DIR              "/acl"
+#define ACL_LIST_PATH        ACL_DIR "/list.bin"
+#define ACL_NEW_PATH         ACL_DIR "/list.new"
+#define ACL_SOURCE_PATH      ACL_DIR "/source.txt"
+#define ACL_MAGIC            0x314C4341UL   // "ACL1" en little-endian
+#define ACL_KEY_SIZE         11             // uid[10] + taille
+#define ACL_FENCE_STRIDE     64             // entrées par bloc lu en flash
+#define ACL_BLOOM_BITS_PER_UID 10          // ~1 % de faux positifs avec 7 hachages
+#define ACL_BLOOM_MIN_BYTES  64
+#define ACL_BLOOM_MAX_BYTES  32768          // 262144 bits
+#define ACL_BLOOM_HASHES_MAX 8
+#define ACL_HEAP_RESERVE     12288          // tas laissé au WiFi, à TLS et au serveur web
+#define ACL_DELTA_MAX        256            // modifications par synchronisation
+#define ACL_SYNC_INTERVAL_MS (15UL * 60UL * 1000UL)
+
+enum AclDecision : uint8_t {
+    ACL_UNKNOWN = 0,
+    ACL_ALLOW = 1,
+    ACL_DENY = 2
+};
+
+struct AclEntry {
+    uint8_t uid[10];
+    uint8_t uidSize;
+    uint8_t flags;      // ACL_ALLOW / ACL_DENY
+};
+static_assert(sizeof(AclEntry) == 12, "AclEntry doit faire 12 octets");
+
+struct AclStats {
+    uint32_t version;
+    uint32_t count;
+    uint32_t lookups;
+    uint32_t bloomRejects;   // UID écartés sans lecture flash
+    uint32_t bloomBytes;     // taille du filtre, fixée au chargement
+    uint8_t bloomHashes;
+    uint32_t hits;
+    uint32_t misses;         // faux positifs du filtre de Bloom
+    uint32_t lastLookupUs;
+    uint32_t maxLookupUs;
+    unsigned long lastSyncMs;
+    int lastSyncCode;        // code HTTP, ou négatif en cas d'erreur locale
+    uint16_t lastSyncChanges;
+};
+
+bool aclBegin();
+AclDecision aclLookup(const byte *uid, byte uidSize);
+bool aclSync();
+String aclSourceUrl();
+void aclSetSourceUrl(const String &url);
+bool aclParseUidHex(const String &hex, AclEntry &entry);
+const AclStats &aclStats();
+String aclStatusJson();
+const char *aclDecisionName(AclDecision decision);
@@ -0,0 +1,30 @@
+#pragma once
+/*
+ * Envoi des UID à l'API distante et historique des envois. L'audit différé
+ * des décisions locales et les renvois passent par upload_outbox.h.
+ */
+#include <Arduino.h>
+#include <scan_payload.h>
+
+// === Historique des envois à l'API ===
+#define API_LOG_SIZE 32
+#define API_LOG_UID_MAXLEN 21   // 10 octets d'UID en hexadécimal + '\0'
+#define API_LOG_URL_MAXLEN 80   // URL tronquée au-delà
+struct ApiLogEntry {
+    unsigned long timestamp;
+    char uid[API_LOG_UID_MAXLEN];
+    int httpCode;
+    char url[API_LOG_URL_MAXLEN]; // Ajouté pour journaliser l'URL utilisée
+};
+extern ApiLogEntry apiLog[API_LOG_SIZE];
+extern int apiLogIndex;
+extern uint32_t apiLogTotal;  // entrées ajoutées depuis le démarrage (version de l'historique)
+
+extern bool aclSyncDue;
+
+// Corps selon apiEncoding (form ou CBOR) ; code HTTP, ou négatif en cas d'échec.
+// Tout 2xx autorise, sauf refus dans le corps : 403 rendu à la place
+int sendScanToApi(const ScanRecord &scan);
+int sendUidToApi(const char *uid, const char *fields = "");
+void logApiSend(const char *uid, int httpCode, const String& url);
+void apiClientLoop();
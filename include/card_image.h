@@ -0,0 +1,56 @@
+#pragma once
+/*
+ * Images binaires de cartes stockées sur LittleFS.
+ *
+ * Un fichier /cards/<uid>.img contient un en-tête fixe de 64 octets suivi du
+ * contenu brut de la carte dans l'ordre standard .mfd (bloc 0 à N-1).
+ * Les blocs illisibles (clé inconnue) sont remplis de zéros et marqués
+ * invalides dans validMap ; ils ne sont jamais réécrits lors d'une restauration.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+
+#define CARD_IMAGE_DIR         "/cards"
+#define CARD_IMAGE_EXT         ".img"
+#define CARD_IMAGE_MAGIC       0x4D494652UL  // "RFIM" en little-endian
+#define CARD_IMAGE_VERSION     1
+#define CARD_IMAGE_MAX_BLOCKS  256           // MIFARE Classic 4K
+#define CARD_IMAGE_UID_HEX_MAX 21            // 10 octets d'UID + '\0'
+
+struct CardImageHeader {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  piccType;        // MFRC522::PICC_Type
+    uint8_t  sak;
+    uint8_t  uidSize;
+    uint8_t  uid[10];
+    uint16_t blockCount;      // nombre de blocs (Classic) ou de pages (Ultralight)
+    uint8_t  blockSize;       // 16 pour Classic, 4 pour Ultralight
+    uint8_t  flags;
+    uint16_t reserved;
+    uint32_t timestamp;       // secondes depuis le démarrage à la capture
+    uint8_t  validMap[CARD_IMAGE_MAX_BLOCKS / 8];
+    uint32_t reserved2;
+};
+static_assert(sizeof(CardImageHeader) == 64, "CardImageHeader doit faire 64 octets");
+
+struct CardRestoreStats {
+    uint16_t written;
+    uint16_t unchanged;
+    uint16_t skipped;   // bloc 0, trailers, blocs absents de l'image
+    uint16_t failed;
+};
+
+bool cardImageBegin();
+bool cardImageLayout(MFRC522::PICC_Type type, uint16_t &blockCount, uint8_t &blockSize);
+void cardImageUidHex(const byte *uid, byte uidSize, char *out);
+String cardImagePath(const String &uidHex);
+size_t cardImageBodySize(const CardImageHeader &header);
+uint16_t cardImageValidCount(const CardImageHeader &header);
+
+bool cardImageCapture(MFRC522 &reader, MFRC522::MIFARE_Key &key, CardImageHeader &header);
+bool cardImageRestore(MFRC522 &reader, MFRC522::MIFARE_Key &key, const String &uidHex, CardRestoreStats &stats);
+bool cardImageReadHeader(const String &uidHex, CardImageHeader &header);
+bool cardImageImport(const char *tmpPath, String &uidHex);
+bool cardImageRemove(const String &uidHex);
+String cardImageListJson();
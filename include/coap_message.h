@@ -0,0 +1,81 @@
+#pragma once
+/*
+ * Messages CoAP (RFC 7252) : codage et analyse d'un datagramme.
+ *
+ * En-tête de 4 octets (version 1, type, longueur du jeton, code, identifiant
+ * de message), jeton, options en numéros croissants (delta et longueur sur
+ * 4 bits, étendus sur 1 ou 2 octets), puis 0xFF et la charge utile. Seules
+ * les options utiles à la remontée des scans sont interprétées (Uri-Path,
+ * Content-Format) ; les autres sont sautées.
+ *
+ * Sans dépendance Arduino : compilé aussi dans l'outil tools/coap_server.cpp.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define COAP_HEADER_SIZE   4
+#define COAP_TOKEN_MAX     8
+#define COAP_PATH_MAX      48    // Uri-Path reconstitué ("api/scan")
+
+#define COAP_TYPE_CON      0     // confirmable : ACK attendu, renvoi sinon
+#define COAP_TYPE_NON      1
+#define COAP_TYPE_ACK      2
+#define COAP_TYPE_RST      3
+
+// Code c.dd sur un octet : classe sur 3 bits, détail sur 5
+#define COAP_CODE(c, dd)   (uint8_t)(((c) << 5) | (dd))
+#define COAP_CODE_EMPTY    COAP_CODE(0, 0)
+#define COAP_CODE_POST     COAP_CODE(0, 2)
+#define COAP_CODE_CHANGED  COAP_CODE(2, 4)
+#define COAP_CODE_FORBIDDEN COAP_CODE(4, 3)
+#define COAP_CODE_NOT_FOUND COAP_CODE(4, 4)
+#define COAP_CODE_BAD_REQUEST COAP_CODE(4, 0)
+
+#define COAP_OPTION_URI_PATH        11
+#define COAP_OPTION_CONTENT_FORMAT  12
+#define COAP_FORMAT_TEXT            0     // text/plain ; charset=utf-8
+#define COAP_FORMAT_CBOR            60    // application/cbor
+#define COAP_FORMAT_NONE            0xFFFF
+
+struct CoapMessage {
+    uint8_t type;
+    uint8_t code;
+    uint16_t messageId;
+    uint8_t tokenLength;
+    uint8_t token[COAP_TOKEN_MAX];
+    uint16_t contentFormat;        // COAP_FORMAT_NONE si absent
+    char path[COAP_PATH_MAX];      // segments Uri-Path séparés par '/', tronqué
+    const uint8_t *payload;        // dans le datagramme analysé
+    size_t payloadLength;
+};
+
+// false si le datagramme n'est pas un message CoAP valide
+bool coapParse(const uint8_t *data, size_t length, CoapMessage &out);
+
+// Écriture en place : en-tête, options en ordre croissant, puis charge utile
+struct CoapWriter {
+    uint8_t *buf;
+    size_t size;
+    size_t length;
+    uint16_t lastOption;
+    bool overflow;
+};
+
+void coapBegin(CoapWriter &w, uint8_t *buf, size_t size, uint8_t type, uint8_t code, uint16_t messageId,
+               const uint8_t *token, uint8_t tokenLength);
+void coapOption(CoapWriter &w, uint16_t number, const uint8_t *value, size_t length);
+void coapOptionUint(CoapWriter &w, uint16_t number, uint32_t value);
+// Uri-Path : une option par segment de path ("api/scan")
+void coapOptionPath(CoapWriter &w, const char *path);
+void coapPayload(CoapWriter &w, const uint8_t *data, size_t length);
+// Charge codée en place par l'appelant : zone libre après le marqueur 0xFF,
+// puis longueur écrite (0 : pas de charge)
+uint8_t *coapPayloadSpace(CoapWriter &w, size_t &room);
+void coapPayloadCommit(CoapWriter &w, size_t length);
+// Longueur du datagramme, 0 si le tampon a débordé
+size_t coapEnd(CoapWriter &w);
+
+// Code c.dd en nombre décimal à la manière HTTP (2.04 -> 204)
+inline int coapCodeNumber(uint8_t code) {
+    return (code >> 5) * 100 + (code & 0x1F);
+}
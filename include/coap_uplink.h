@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * Remontée des scans en CoAP sur UDP (URL d'API « coap://hôte[:port]/chemin »).
+ *
+ * Pour les tourniquets : un scan tient dans un seul datagramme POST
+ * confirmable (CON), sans connexion TCP ni en-têtes HTTP, et la réponse
+ * portée par l'ACK donne la décision qui pilote le buzzer. Corps form
+ * (Content-Format 0) ou CBOR (60) selon apiEncoding :
+ *
+ *   2.xx, charge "allow" (ou vide)  autorisé
+ *   2.xx, charge "deny", ou 4.03    refusé
+ *   autre code, RST, délai dépassé  échec (motif d'erreur)
+ *
+ * Un « ttl=<s> » dans la charge met la décision en cache (decision_cache.h).
+ *
+ * Sans ACK, le même datagramme (même identifiant de message, que le serveur
+ * dédoublonne) est renvoyé après COAP_ACK_TIMEOUT_MS, délai doublé à chaque
+ * essai, COAP_MAX_RETRANSMIT fois au plus. Les paramètres de transmission
+ * sont resserrés par rapport aux valeurs par défaut de la RFC 7252 (2 s,
+ * 4 renvois) : sur le réseau local du lecteur, une perte se rattrape en
+ * 50 ms plutôt qu'en 2 à 3 s. Un ACK vide annonce une réponse séparée (CON
+ * du serveur, acquittée à son tour). Les ACK en double ou tardifs sont
+ * ignorés.
+ *
+ * Un seul échange à la fois (NSTART = 1). coapStart() puis coapPoll() à
+ * chaque passage : l'étape d'envoi du pipeline ne bloque pas loop() pendant
+ * l'attente ; sendUidToApi() (audit, repli) attend la fin de l'échange.
+ *
+ * Serveur de test : tools/coap_server.cpp.
+ */
+#include <Arduino.h>
+#include <scan_payload.h>
+
+#define COAP_DEFAULT_PORT      5683
+#define COAP_LOCAL_PORT        5683
+#define COAP_ACK_TIMEOUT_MS    50     // premier délai avant renvoi, doublé ensuite
+#define COAP_MAX_RETRANSMIT    3
+#define COAP_SEPARATE_TIMEOUT_MS 2000 // ACK vide -> réponse séparée
+#define COAP_DATAGRAM_MAX      256
+
+enum CoapResult : uint8_t {
+    COAP_PENDING,
+    COAP_ALLOW,
+    COAP_DENY,
+    COAP_FAILED,
+};
+
+struct CoapStats {
+    uint32_t requests;
+    uint32_t retransmits;
+    uint32_t timeouts;
+    uint32_t duplicates;      // ACK ou réponses reçus en double, ignorés
+    uint32_t separate;        // réponses séparées (ACK vide d'abord)
+    uint32_t allowed;
+    uint32_t denied;
+    uint32_t lastRttUs;       // envoi -> réponse
+    uint32_t maxRttUs;
+    int lastCode;             // à la manière HTTP : 204, 403, -1 délai dépassé
+};
+
+// URL d'API en coap://
+bool coapUplinkActive();
+bool coapExchangeActive();
+// Début d'un échange ; false si un échange est en cours ou l'hôte introuvable
+bool coapStart(const ScanRecord &scan);
+CoapResult coapPoll();
+// Échange complet : 200 autorisé, 403 refusé, code CoAP ou négatif sinon
+int coapSend(const ScanRecord &scan);
+const CoapStats &coapStats();
@@ -14,16 +14,24 @@
 #define BUZZER_PIN D2 // GPIO 4  (D2)
 #define LED_PIN    D4 // GPIO 2  (D4)
 
-#define EEPROM_SIZE 256
-#define API_URL_ADDR 0
-#define API_URL_MAXLEN 200
+// Réglages RF du RC522 (ajustés par rf_tuning.cpp dans ces bornes)
+#define RF_GAIN_DEFAULT         0x40  // RFCfgReg : 33 dB, valeur au reset
+#define RF_GAIN_MIN             0x40  // 33 dB
+#define RF_GAIN_MAX             0x70  // 48 dB
+#define RF_TIMER_RELOAD_DEFAULT 1000  // 25 ms, valeur de la bibliothèque
+#define RF_TIMER_RELOAD_MIN     400   // 10 ms : couvre l'ACK d'une écriture MIFARE
+#define RF_TIMER_RELOAD_MAX     1000
 
-#define EEPROM_SIZE 256
-#define API_URL_ADDR 0
+// Secteur EEPROM émulé : contient le bloc de configuration (voir settings.cpp)
+#define EEPROM_SIZE 512
 #define API_URL_MAXLEN 200
-#define WIFI_SSID_ADDR (API_URL_ADDR + API_URL_MAXLEN)
 #define WIFI_SSID_MAXLEN 32
-#define WIFI_PASS_ADDR (WIFI_SSID_ADDR + WIFI_SSID_MAXLEN)
 #define WIFI_PASS_MAXLEN 64
+#define WEB_CODE_MAXLEN 16
+#define READ_PROFILE_NAME_MAXLEN 15
+#define MQTT_HOST_MAXLEN 48
+#define MQTT_USER_MAXLEN 24
+#define MQTT_PASS_MAXLEN 32
+#define MQTT_TOPIC_MAXLEN 32
 #define AP_SSID "RFID-Config"
 #define AP_PASS "12345678"
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+/*
+ * Cache des décisions de l'API, pour un retour immédiat sur les badges
+ * présentés à nouveau.
+ *
+ * La réponse de l'API peut porter une décision et une durée de validité,
+ * en corps texte (POST HTTP ou charge CoAP) :
+ *
+ *   decision=allow&ttl=300     autorisé, réutilisable 300 s
+ *   deny&ttl=60                refusé, réutilisable 60 s
+ *   allow (ou corps quelconque) sans ttl : décision non mise en cache
+ *
+ * Sans mot « decision », un code 2xx autorise et un 403 refuse, comme avant ;
+ * un autre code ne touche pas au cache. Une réponse sans ttl retire l'entrée
+ * existante : le serveur ne veut plus qu'elle soit réutilisée. Le PUBACK
+ * MQTT ne porte pas de décision : seuls HTTP et CoAP remplissent le cache.
+ *
+ * Table de DECISION_CACHE_SLOTS entrées en RAM, adressée par hachage FNV-1a
+ * de l'UID ; un UID n'est cherché que dans DECISION_CACHE_PROBE cases
+ * consécutives, sans marque de suppression. Table pleine dans cette fenêtre :
+ * l'entrée qui expire le plus tôt cède sa place. L'échéance suit micros64(),
+ * sans retour à zéro ; une entrée trouvée périmée est retirée aussitôt.
+ *
+ * Sur une décision en cache, le pipeline (scan_pipeline.h) donne le retour
+ * buzzer tout de suite puis envoie le scan au passage suivant, comme un scan
+ * inconnu : la réponse rafraîchit l'entrée. Une réponse qui contredit la
+ * décision déjà donnée est comptée (stale) ; l'invalidation explicite
+ * (POST /api/cache/invalidate) sert aux révocations qui ne peuvent pas
+ * attendre la fin du ttl.
+ */
+#include <Arduino.h>
+#include <acl.h>
+
+#define DECISION_CACHE_SLOTS 64      // puissance de 2
+#define DECISION_CACHE_PROBE 4       // cases examinées par UID
+#define DECISION_TTL_MAX_S   86400   // ttl plus long ramené à un jour
+#define DECISION_BODY_MAX    64      // début de réponse examiné
+
+struct DecisionCacheStats {
+    uint16_t entries;           // cases occupées ; une entrée trouvée périmée est libérée
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t expired;           // trouvées périmées, case libérée
+    uint32_t stores;
+    uint32_t evictions;         // fenêtre pleine : entrée la plus proche de l'expiration remplacée
+    uint32_t invalidations;     // retirées par l'API ou par une réponse sans ttl
+    uint32_t stale;             // réponse contraire à la décision en cache
+    uint32_t lastLookupUs;
+};
+
+// Décision en cache pour un UID, ACL_UNKNOWN si absente ou expirée
+AclDecision decisionCacheLookup(const byte *uid, byte uidSize);
+// Réponse de l'API pour un UID hexadécimal : décision lue (ACL_UNKNOWN si le
+// code n'en porte pas) ; mise en cache avec son ttl, ou entrée retirée
+AclDecision decisionCacheLearn(const char *uidHex, int code, const char *body, size_t length);
+// false si l'UID est invalide ou absent du cache
+bool decisionCacheInvalidate(const char *uidHex);
+void decisionCacheClear();
+const DecisionCacheStats &decisionCacheStats();
+String decisionCacheStatusJson();
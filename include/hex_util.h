@@ -0,0 +1,41 @@
+#pragma once
+/*
+ * Encodage hexadécimal sans allocation, par table de correspondance.
+ * Les fonctions écrivent dans un tampon fourni par l'appelant et renvoient
+ * un pointeur sur le '\0' final pour permettre l'enchaînement.
+ */
+#include <Arduino.h>
+
+static const char HEX_LOWER[] = "0123456789abcdef";
+static const char HEX_UPPER[] = "0123456789ABCDEF";
+
+// "0a1b2c" : out doit contenir 2 * len + 1 octets
+inline char *hexEncode(const byte *data, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++) {
+        *out++ = HEX_LOWER[data[i] >> 4];
+        *out++ = HEX_LOWER[data[i] & 0x0F];
+    }
+    *out = '\0';
+    return out;
+}
+
+// " 0A 1B 2C" (format historique du port série) : out doit contenir 3 * len + 1 octets
+inline char *hexEncodeSpaced(const byte *data, size_t len, char *out, bool upper = true) {
+    const char *digits = upper ? HEX_UPPER : HEX_LOWER;
+    for (size_t i = 0; i < len; i++) {
+        *out++ = ' ';
+        *out++ = digits[data[i] >> 4];
+        *out++ = digits[data[i] & 0x0F];
+    }
+    *out = '\0';
+    return out;
+}
+
+// Caractères imprimables tels quels, '.' sinon : out doit contenir len + 1 octets
+inline char *asciiEncode(const byte *data, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++) {
+        *out++ = (data[i] >= 32 && data[i] <= 126) ? (char)data[i] : '.';
+    }
+    *out = '\0';
+    return out;
+}
@@ -0,0 +1,23 @@
+#pragma once
+/*
+ * Lecture des cartes ISO 14443-4 : MIFARE DESFire (GetVersion,
+ * GetApplicationIDs) et NDEF Type 4 (application D2760000850101, fichiers CC
+ * et NDEF).
+ *
+ * Ces cartes ne répondent pas à l'authentification MIFARE Classic : le dump
+ * secteur par secteur n'y coûtait qu'une suite de timeouts. Les cartes sans
+ * couche ISO-DEP ni mémoire Classic lisible (MIFARE Plus SL2, NFC-DEP,
+ * TNP3xxx) sont reconnues à leur SAK et écartées sans échange.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+
+#define ISO_NDEF_MAX 256    // message NDEF Type 4 lu au plus
+
+// Type relevant de ce module plutôt que du dump Classic
+bool isoCardHandles(MFRC522::PICC_Type type);
+// Résumé de la carte sélectionnée (série et lastCardInfo)
+void appendIsoCardDump(MFRC522::PICC_Type type);
+
+// false : ancien comportement, dump Classic tenté sur toutes les cartes (comparaison)
+extern bool isoDepEnabled;
@@ -0,0 +1,58 @@
+#pragma once
+/*
+ * Couche ISO-DEP (ISO/IEC 14443-4) au-dessus du RC522.
+ *
+ * isoDepActivate() envoie RATS, décode l'ATS (taille de trame FSC, temps
+ * d'attente FWT, débits proposés dans TA(1)) puis négocie par PPS le plus
+ * haut débit commun jusqu'à ISO_DEP_MAX_DIVISOR (106 kbit/s x D). Le CRC est
+ * alors confié au RC522 (TxCRCEn/RxCRCEn, obligatoires au-delà de 106 kbit/s)
+ * et le timer réglé sur FWT.
+ *
+ * isoDepTransceive() échange une APDU complète : découpage en blocs I
+ * chaînés selon FSC, chaînage des réponses par R(ACK), R(NAK) sur timeout
+ * (ISO_DEP_RETRIES fois), S(WTX) acquittés avec prolongation du timer.
+ * isoDepDeselect() renvoie la carte à l'état HALT et rétablit le RC522
+ * (106 kbit/s, CRC logiciel, timer de rf_tuning).
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+
+#define ISO_DEP_FSD          64    // FIFO du RC522 : trame reçue la plus longue
+#define ISO_DEP_MAX_DIVISOR  4     // 424 kbit/s ; 848 kbit/s est peu fiable sur RC522
+#define ISO_DEP_RETRIES      2
+#define ISO_DEP_APDU_MAX     256   // réponse complète (chaînée) la plus longue
+
+struct IsoDepAts {
+    byte raw[20];
+    byte length;
+    uint16_t fsc;          // trame la plus longue acceptée par la carte
+    byte fwi;              // FWT = 302 µs x 2^FWI
+    byte dsMask;           // débits carte -> lecteur proposés (bits 0..2 : D = 2, 4, 8)
+    byte drMask;           // débits lecteur -> carte
+    bool sameDivisor;      // TA(1) b8 : un seul débit pour les deux sens
+    const byte *historical;
+    byte historicalLength;
+};
+
+struct IsoDepStats {
+    uint32_t activations;   // RATS réussis
+    uint32_t ppsOk;         // débit relevé au-delà de 106 kbit/s
+    uint32_t apdus;
+    uint32_t frames;        // blocs I, R et S émis
+    uint32_t retransmissions;
+    uint32_t waitExtensions;    // S(WTX)
+    uint32_t errors;            // APDU abandonnées
+    uint32_t skipped;           // cartes non supportées écartées d'après SAK/ATS
+};
+
+// RATS (+ PPS) sur la carte sélectionnée ; false si elle n'est pas ISO-DEP
+bool isoDepActivate(MFRC522 &reader, IsoDepAts &ats);
+// Débit courant en kbit/s
+uint16_t isoDepBitrate();
+// APDU complète ; *responseLength : taille du tampon en entrée, reçue en sortie
+// (mots d'état SW1 SW2 compris)
+MFRC522::StatusCode isoDepTransceive(const byte *apdu, uint16_t apduLength, byte *response,
+                                     uint16_t *responseLength);
+void isoDepDeselect();
+const IsoDepStats &isoDepStats();
+void isoDepSkipped();
@@ -0,0 +1,102 @@
+#pragma once
+/*
+ * Trames de la liaison série binaire : COBS et CRC-16.
+ *
+ * Une trame porte type, numéro de séquence et corps, suivis du CRC-16/
+ * CCITT-FALSE (polynôme 0x1021, valeur initiale 0xFFFF, octet de poids
+ * faible en premier) ; l'ensemble est codé en COBS, donc sans octet nul, et
+ * encadré de deux 0x00. Le délimiteur de tête isole les trames du texte que
+ * le port série continue d'émettre : un segment de texte échoue au CRC et
+ * l'hôte l'écarte (ou l'affiche comme journal).
+ *
+ * Sans dépendance Arduino : compilé aussi dans l'outil hôte tools/rfid_link.cpp.
+ *
+ * Messages (entiers little-endian) :
+ *   appareil -> hôte
+ *     LINK_MSG_SCAN    id u32, capture µs u32, type PICC u8, décision locale u8,
+ *                      taille UID u8, UID, champs du profil de lecture (texte)
+ *     LINK_MSG_RESULT  id u32, API OK u8 (2 : publié MQTT, sans décision),
+ *                      capture -> retour buzzer µs u32
+ *     LINK_MSG_STATUS  mode u8, scan continu u8, uptime s u32, tas libre u32,
+ *                      file de scan u8, pertes u32, RC522 OK u8, dernier id u32
+ *     LINK_MSG_IMAGE   position u16, taille totale u16, octets de l'image
+ *     LINK_MSG_ACK     type et séquence de la commande, résultat u8, données
+ *   hôte -> appareil
+ *     LINK_CMD_MODE    nom du mode (READ, WRITE... ou STOP), puis 0x00 et
+ *                      argument pour WRITE <données> et RESTORE <uid>
+ *     LINK_CMD_STATUS  (vide) -> LINK_MSG_STATUS
+ *     LINK_CMD_IMAGE   UID hexadécimal -> LINK_MSG_IMAGE x n puis ACK
+ *     LINK_CMD_PING    données quelconques, renvoyées dans l'ACK
+ *     LINK_CMD_TEXT    baud u32 facultatif : retour au mode texte après l'ACK
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define LINK_PAYLOAD_MAX  240   // type + séquence + corps
+#define LINK_HEADER_SIZE  2
+#define LINK_CRC_SIZE     2
+// Délimiteurs, code COBS de tête et un code supplémentaire tous les 254 octets
+#define LINK_FRAME_MAX    (LINK_PAYLOAD_MAX + LINK_CRC_SIZE + (LINK_PAYLOAD_MAX + LINK_CRC_SIZE) / 254 + 3)
+#define LINK_IMAGE_CHUNK  192   // octets d'image par trame
+
+#define LINK_MSG_SCAN     0x01
+#define LINK_MSG_RESULT   0x02
+#define LINK_MSG_STATUS   0x03
+#define LINK_MSG_IMAGE    0x04
+#define LINK_MSG_ACK      0x05
+
+#define LINK_CMD_MODE     0x81
+#define LINK_CMD_STATUS   0x82
+#define LINK_CMD_IMAGE    0x83
+#define LINK_CMD_PING     0x84
+#define LINK_CMD_TEXT     0x85
+
+// Résultat porté par LINK_MSG_ACK
+#define LINK_ACK_OK        0
+#define LINK_ACK_INVALID   1   // corps mal formé ou argument manquant
+#define LINK_ACK_UNKNOWN   2   // type de commande ou mode inconnu
+#define LINK_ACK_NOT_FOUND 3   // image absente
+
+uint16_t linkCrc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+// Trame complète (00 COBS(payload CRC) 00) ; 0 si payload ou out sont trop grands
+size_t linkEncode(const uint8_t *payload, size_t length, uint8_t *out, size_t size);
+
+enum LinkFeed : uint8_t {
+    LINK_NONE,    // trame en cours (ou délimiteurs consécutifs)
+    LINK_FRAME,   // trame valide dans buf[0..length)
+    LINK_ERROR,   // segment rejeté : CRC, COBS ou longueur
+};
+
+// Décodeur incrémental, un octet à la fois ; aucune attente, aucune allocation
+struct LinkDecoder {
+    uint8_t buf[LINK_PAYLOAD_MAX + LINK_CRC_SIZE];
+    size_t length;       // octets décodés (payload, puis CRC retiré)
+    uint8_t remaining;   // octets restants dans le bloc COBS courant
+    uint8_t block;       // code du bloc courant, 0 avant le premier
+    bool overflow;
+    uint32_t frames;
+    uint32_t crcErrors;
+    uint32_t framingErrors;   // COBS incomplet, trame trop courte ou trop longue
+};
+
+void linkDecoderReset(LinkDecoder &decoder);
+LinkFeed linkDecoderFeed(LinkDecoder &decoder, uint8_t byte);
+
+// Lecture et écriture little-endian dans un corps de trame
+inline void linkPut16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+inline void linkPut32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+inline uint16_t linkGet16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+inline uint32_t linkGet32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,39 @@
+#pragma once
+/*
+ * Métriques internes exposées sur /api/metrics (format texte Prometheus).
+ *
+ * Histogrammes à seaux fixes en échelle log2 : le seau i compte les durées
+ * <= 2^(i+6) µs (64 µs ... 1 s), le dernier seau est +Inf. Pas d'allocation
+ * à l'enregistrement, environ 80 octets de RAM par histogramme.
+ */
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+
+#define METRICS_BUCKETS        16
+#define METRICS_FIRST_BUCKET_LOG2 6   // 64 µs
+
+struct Histogram {
+    uint32_t buckets[METRICS_BUCKETS];
+    uint32_t count;
+    uint64_t sumUs;
+};
+
+// Étapes d'un scan, dans l'ordre du pipeline
+enum MetricStage : uint8_t {
+    STAGE_DETECT,    // PICC_IsNewCardPresent (REQA)
+    STAGE_SELECT,    // anticollision + SELECT
+    STAGE_TYPE,      // résolution du type et formatage de l'UID
+    STAGE_MEMORY,    // lecture mémoire
+    STAGE_UPLOAD,    // envoi à l'API
+    STAGE_FEEDBACK,  // buzzer
+    STAGE_LOG,       // journal de fin de pipeline
+    STAGE_COUNT
+};
+
+void histogramRecord(Histogram &h, uint32_t us);
+void metricsStage(MetricStage stage, uint32_t us);
+void metricsLoopTick();
+void metricsWebRequestStart();
+void metricsWebRequestEnd();
+void metricsUpload(bool success);
+void metricsSend(ESP8266WebServer &server);
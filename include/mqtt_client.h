@@ -0,0 +1,71 @@
+#pragma once
+/*
+ * Transport MQTT des scans, à la place d'un POST HTTP par scan.
+ *
+ * Une seule session MQTT 3.1.1 reste ouverte vers le broker (session
+ * persistante, identifiant client stable deviceId() = HOSTNAME-<chipId>) :
+ * plus de connexion TCP ni d'en-têtes HTTP par scan. Chaque scan part en
+ * PUBLISH QoS 1 sur <préfixe>/scan avec le corps du POST (form
+ * « uid=...&device=...&scan=<séquence> » suivi des champs du profil de
+ * lecture, ou CBOR selon apiEncoding) ; l'étape
+ * d'envoi du pipeline rend la main dès la publication écrite, sans attendre
+ * le PUBACK, qui acquitte l'événement dans la boîte d'envoi (upload_outbox.h).
+ *
+ * Les publications non acquittées restent dans une file bornée de
+ * MQTT_INFLIGHT_MAX entrées, renvoyées (DUP) à la reconnexion ; file pleine,
+ * le scan repasse par sendUidToApi(). La session persistante garde aussi
+ * l'abonnement aux commandes : celles publiées pendant une coupure sont
+ * livrées à la reconnexion.
+ *
+ *   <préfixe>/scan          scans publiés (QoS 1)
+ *   <préfixe>/cmd/command   "READ", "STOP", "INFO"... comme /api/command
+ *   <préfixe>/cmd/buzzer    "times=3&duration=100" comme /api/buzzer, sans bloquer
+ *   <préfixe>/status        "online" (retenu) ; "offline" par le testament
+ *
+ * Préfixe : mqttTopic, ou rfid/<identifiant client> s'il est vide ; trop
+ * long, la session n'est pas ouverte. Le mot de passe n'est envoyé qu'avec
+ * un nom d'utilisateur (MQTT 3.1.1).
+ * Connexion TCP et lecture sans attente dans mqttLoop() ; seule la connexion
+ * elle-même bloque, au plus MQTT_CONNECT_TIMEOUT_MS, avec un délai de reprise
+ * doublé à chaque échec.
+ */
+#include <Arduino.h>
+#include <scan_payload.h>
+
+#define MQTT_KEEPALIVE_S         30
+#define MQTT_INFLIGHT_MAX        16     // publications QoS 1 en attente de PUBACK
+#define MQTT_CONNECT_TIMEOUT_MS  3000
+#define MQTT_RETRY_MIN_MS        1000   // délai de reprise, doublé jusqu'au maximum
+#define MQTT_RETRY_MAX_MS        30000
+#define MQTT_PAYLOAD_MAX         SCAN_PAYLOAD_MAX
+#define MQTT_RX_MAX              256    // paquet reçu (commande) ; au-delà, ignoré
+
+struct MqttStats {
+    bool connected;
+    bool sessionPresent;        // session retrouvée par le broker à la connexion
+    uint8_t inflight;           // publications non acquittées
+    uint8_t inflightHighWater;
+    uint32_t connects;
+    uint32_t connectFailures;
+    uint32_t published;         // scans confiés à MQTT
+    uint32_t acked;             // PUBACK reçus
+    uint32_t resent;            // publications renvoyées (DUP) après reconnexion
+    uint32_t overflows;         // file pleine : scan renvoyé vers HTTP
+    uint32_t commands;          // commandes reçues
+    uint32_t lastAckUs;         // publication -> PUBACK
+    uint32_t maxAckUs;
+};
+
+void mqttBegin();
+void mqttLoop();
+// Configuration modifiée : session fermée puis rouverte avec les nouveaux réglages
+void mqttRestart();
+// Activé et hôte configuré : le pipeline publie ses scans
+bool mqttActive();
+bool mqttConnected();
+// Publication QoS 1 d'un scan (scan.sequence : identifiant) ; false si MQTT est
+// inactif ou la file pleine
+bool mqttPublishScan(const ScanRecord &scan);
+const MqttStats &mqttStats();
+const char *mqttTopicPrefix();
+String mqttStatusJson();
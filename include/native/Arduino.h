@@ -0,0 +1,82 @@
+#pragma once
+/*
+ * Couche de compatibilité Arduino pour la cible hôte (env:native).
+ * Seul le sous-ensemble utilisé par le firmware est fourni.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncpy_P strncpy
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+// Broches du D1 Mini (numéros GPIO)
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+
+using std::max;
+using std::min;
+template <typename T, typename L, typename H>
+T constrain(T amt, L low, H high) {
+    return amt < (T)low ? (T)low : (amt > (T)high ? (T)high : amt);
+}
+
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+
+unsigned long millis();
+unsigned long micros();
+uint64_t micros64();          // comme le cœur ESP8266 : sans retour à zéro
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize();
+    uint8_t getHeapFragmentation();
+    uint32_t getChipId() { return 0x00C0FFEE; }
+    uint8_t getCpuFreqMHz() { return 80; }
+    uint32_t getCycleCount();
+    void restart();
+    void reset() { restart(); }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,50 @@
+#pragma once
+/*
+ * EEPROM émulée pour la cible hôte : secteur de 4 Ko persisté dans
+ * <NATIVE_FS_ROOT>/eeprom.bin, avec compteurs de copies (begin) et
+ * d'effacements (commit).
+ */
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+    void begin(size_t size);
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    bool commit();
+    bool end();
+    uint8_t *getDataPtr();
+    const uint8_t *getConstDataPtr() const { return _data; }
+    size_t length() const { return _size; }
+
+    template <typename T>
+    T &get(int address, T &t) {
+        if (address < 0 || address + sizeof(T) > _size) return t;
+        memcpy((uint8_t *)&t, _data + address, sizeof(T));
+        return t;
+    }
+    template <typename T>
+    const T &put(int address, const T &t) {
+        if (address < 0 || address + sizeof(T) > _size) return t;
+        if (memcmp(_data + address, (const uint8_t *)&t, sizeof(T)) != 0) {
+            _dirty = true;
+            memcpy(_data + address, (const uint8_t *)&t, sizeof(T));
+        }
+        return t;
+    }
+
+    // === API hôte ===
+    uint32_t sectorReads = 0;  // copies flash -> RAM (begin)
+    uint32_t sectorErases = 0; // effacements + réécritures (commit)
+    uint8_t flash[4096];       // contenu du secteur « flash »
+    void eraseFlash() { memset(flash, 0xFF, sizeof(flash)); }
+    bool persist = true;       // false : secteur purement en mémoire (bancs d'essai)
+
+private:
+    bool _loaded = false;
+    uint8_t *_data = nullptr;
+    size_t _size = 0;
+    bool _dirty = false;
+};
+
+extern EEPROMClass EEPROM;
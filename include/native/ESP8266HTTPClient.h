@@ -0,0 +1,52 @@
+#pragma once
+/*
+ * HTTPClient hôte : les requêtes sont servies en mémoire par
+ * LoopbackHttpServer (latence, coût TCP/TLS et échecs configurables).
+ */
+#include <ESP8266WiFi.h>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NO_CONTENT 204
+#define HTTP_CODE_NOT_MODIFIED 304
+
+class HTTPClient {
+public:
+    bool begin(WiFiClient &client, const String &url);
+    void end();
+    void setTimeout(uint16_t timeout) { _timeout = timeout; }
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void addHeader(const String &name, const String &value, bool first = false, bool replace = true);
+    void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+    String header(const char *name);
+    int GET();
+    int POST(const uint8_t *payload, size_t size);
+    int POST(const String &payload);
+    int sendRequest(const char *type, const uint8_t *payload = nullptr, size_t size = 0);
+    const String &getString() { return _response; }
+    int writeToStream(Stream *stream);
+    int getSize() { return _response.length(); }
+    bool connected() { return _client != nullptr; }
+    static String errorToString(int error);
+
+private:
+    WiFiClient *_client = nullptr;
+    String _url;
+    String _contentType;
+    String _idempotencyKey;
+    String _response;
+    uint16_t _timeout = 5000;
+    bool _reuse = true;
+};
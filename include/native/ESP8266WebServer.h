@@ -0,0 +1,147 @@
+#pragma once
+/*
+ * ESP8266WebServer hôte : mêmes routes et accesseurs que la bibliothèque,
+ * mais les requêtes sont injectées en mémoire via request()/requestUpload()
+ * au lieu d'arriver par une socket.
+ */
+#include <ESP8266WiFi.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 2048
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+struct HTTPUpload {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    size_t contentLength;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+// Réponse capturée par la boucle locale
+struct NativeHttpResponse {
+    int code = 0;
+    String contentType;
+    String body;
+    std::vector<std::pair<String, String>> headers;
+    String header(const char *name) const;
+
+    // Réponse différée : le gestionnaire a gardé webServer.client() sans
+    // répondre. poll() lit ce qui a été écrit depuis sur la socket et renvoie
+    // true une fois la réponse complète (code -1 si fermée sans réponse).
+    std::shared_ptr<int> peer;
+    String raw;
+    bool deferred() const { return code == 0 && peer != nullptr; }
+    bool poll();
+};
+
+class ESP8266WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+    // Crochets appelés avant le traitement de chaque requête (core ESP8266 >= 3.0)
+    enum ClientFuture { CLIENT_REQUEST_CAN_CONTINUE, CLIENT_REQUEST_IS_HANDLED, CLIENT_MUST_STOP, CLIENT_IS_GIVEN };
+    typedef std::function<String(const String &)> ContentTypeFunction;
+    typedef std::function<ClientFuture(const String &method, const String &url, WiFiClient *client,
+                                       ContentTypeFunction contentType)>
+        HookFunction;
+    void addHook(HookFunction hook) { _hooks.push_back(hook); }
+
+    explicit ESP8266WebServer(int port = 80) : _port(port) {}
+
+    void begin() { _started = true; }
+    void close() { _started = false; }
+    void stop() { close(); }
+    void handleClient();
+
+    void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction fn);
+    void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+    const String &uri() const { return _uri; }
+    HTTPMethod method() const { return _method; }
+    WiFiClient &client() { return _client; }
+    HTTPUpload &upload() { return _upload; }
+
+    const String &arg(const String &name) const;
+    const String &arg(int i) const;
+    const String &argName(int i) const;
+    int args() const { return (int)_args.size(); }
+    bool hasArg(const String &name) const;
+    const String &header(const String &name) const;
+    bool hasHeader(const String &name) const;
+    void collectHeaders(const char *[], const size_t) {}
+
+    void send(int code, const char *contentType = nullptr, const String &content = String());
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+    void send(int code, const char *contentType, const char *content) { send(code, contentType, String(content)); }
+    void send(int code, const char *contentType, const char *content, size_t contentLength);
+    void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, content); }
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength) {
+        send(code, contentType, content, contentLength);
+    }
+    void setContentLength(const size_t contentLength) { _contentLength = contentLength; }
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char *content, size_t size);
+    void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+    void sendContent_P(PGM_P content, size_t size) { sendContent(content, size); }
+
+    template <typename T>
+    size_t streamFile(T &file, const String &contentType, HTTPMethod requestMethod = HTTP_GET) {
+        setContentLength(file.size());
+        send(200, contentType.c_str(), String());
+        uint8_t buf[512];
+        size_t total = 0;
+        while (file.available()) {
+            size_t n = file.read(buf, sizeof(buf));
+            if (n == 0) break;
+            sendContent((const char *)buf, n);
+            total += n;
+        }
+        return total;
+    }
+
+    // === API hôte ===
+    NativeHttpResponse request(HTTPMethod method, const String &uriWithQuery, const String &body = String(),
+                               const String &contentType = "application/x-www-form-urlencoded");
+    NativeHttpResponse requestUpload(const String &uri, const String &filename, const uint8_t *data, size_t len);
+    uint32_t requestsServed = 0;
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+    int _port;
+    bool _started = false;
+    std::vector<Route> _routes;
+    std::vector<HookFunction> _hooks;
+    THandlerFunction _notFound;
+    String _uri;
+    HTTPMethod _method = HTTP_GET;
+    std::vector<std::pair<String, String>> _args;
+    std::vector<std::pair<String, String>> _headers;
+    WiFiClient _client;
+    HTTPUpload _upload;
+    size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+    NativeHttpResponse *_response = nullptr;
+    std::vector<std::pair<String, String>> _pendingHeaders;
+
+    Route *findRoute(const String &path, HTTPMethod method);
+    void parseArgs(const String &query);
+    NativeHttpResponse dispatch(HTTPMethod method, const String &uriWithQuery, const String &body,
+                                const String &contentType, const uint8_t *upload, size_t uploadLen,
+                                const String &filename);
+};
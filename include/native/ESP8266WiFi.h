@@ -0,0 +1,90 @@
+#pragma once
+/*
+ * WiFi simulé pour la cible hôte. WiFiClient s'appuie sur de vraies
+ * sockets TCP POSIX (utile pour les bancs d'essai contre un serveur local).
+ */
+#include <Arduino.h>
+#include "native_sim.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+} wl_status_t;
+
+typedef enum WiFiMode { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } WiFiMode_t;
+
+enum wl_enc_type { ENC_TYPE_WEP = 5, ENC_TYPE_TKIP = 2, ENC_TYPE_CCMP = 4, ENC_TYPE_NONE = 7, ENC_TYPE_AUTO = 8 };
+
+class ESP8266WiFiClass {
+public:
+    wl_status_t status();
+    int32_t RSSI() { return SimNetwork::instance().rssi; }
+    int32_t RSSI(uint8_t) { return -60; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+    String macAddress() { return String("5C:CF:7F:00:00:01"); }
+    WiFiMode_t getMode() { return _mode; }
+    bool mode(WiFiMode_t m) {
+        _mode = m;
+        return true;
+    }
+    wl_status_t begin(const char *, const char *) { return status(); }
+    bool disconnect(bool = false) { return true; }
+    bool softAP(const char *, const char * = nullptr, int = 1, int = 0, int = 4) { return true; }
+    bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+    int8_t scanNetworks() { return 0; }
+    String SSID(uint8_t) { return String(); }
+    uint8_t encryptionType(uint8_t) { return ENC_TYPE_NONE; }
+    void scanDelete() {}
+    // Résolution par getaddrinfo ; 1 si l'hôte est trouvé
+    int hostByName(const char *host, IPAddress &result);
+
+private:
+    WiFiMode_t _mode = WIFI_STA;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient() {}
+    virtual ~WiFiClient();
+    WiFiClient(const WiFiClient &other);
+    WiFiClient &operator=(const WiFiClient &other);
+
+    virtual int connect(const char *host, uint16_t port);
+    int connect(const String &host, uint16_t port) { return connect(host.c_str(), port); }
+    int connect(IPAddress ip, uint16_t port);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size);
+    int peek() override;
+    void flush() override {}
+    void stop();
+    uint8_t connected();
+    explicit operator bool() { return connected(); }
+    void setNoDelay(bool nodelay);
+    virtual bool isSecure() const { return false; }
+
+    // === API hôte ===
+    int fd() const { return _fd ? *_fd : -1; }
+    // Adopte une socket déjà connectée (extrémité serveur d'une requête injectée)
+    void attach(int fd);
+
+private:
+    std::shared_ptr<int> _fd;
+    int _peeked = -1;
+};
+
+#include "WiFiUdp.h"
+
+#include "WiFiClientSecure.h"
@@ -0,0 +1,112 @@
+#pragma once
+/*
+ * Système de fichiers hôte calqué sur l'API fs::FS de l'ESP8266.
+ * Les fichiers sont stockés sous un répertoire racine (NATIVE_FS_ROOT,
+ * par défaut ./.native_fs).
+ */
+#include <Arduino.h>
+#include <stdio.h>
+#include <memory>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FSInfo {
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+    size_t maxOpenFiles;
+    size_t maxPathLength;
+};
+
+class File : public Stream {
+public:
+    File() {}
+    File(FILE *fp, const String &path, bool isDir = false);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t *buf, size_t size);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    bool truncate(uint32_t size);
+    explicit operator bool() const { return _fp != nullptr || _isDir; }
+    const char *name() const;
+    const char *fullName() const { return _path.c_str(); }
+    bool isFile() const { return _fp != nullptr; }
+    bool isDirectory() const { return _isDir; }
+
+private:
+    std::shared_ptr<FILE> _fp;
+    std::shared_ptr<size_t> _pending; // octets écrits pas encore programmés (modèle flash)
+    String _path;
+    bool _isDir = false;
+};
+
+class Dir {
+public:
+    Dir() {}
+    explicit Dir(const String &path) : _path(path) {}
+    bool next();
+    String fileName() const { return _name; }
+    size_t fileSize() const { return _size; }
+    bool isFile() const { return !_isDir; }
+    bool isDirectory() const { return _isDir; }
+    File openFile(const char *mode);
+    bool rewind() {
+        _index = 0;
+        return true;
+    }
+
+private:
+    String _path;
+    String _name;
+    size_t _size = 0;
+    bool _isDir = false;
+    size_t _index = 0;
+};
+
+class FS {
+public:
+    bool begin();
+    void end() {}
+    bool format();
+    bool info(FSInfo &info);
+    File open(const char *path, const char *mode);
+    File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    Dir openDir(const char *path);
+    Dir openDir(const String &path) { return openDir(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path);
+
+    // === API hôte ===
+    static String hostPath(const char *path);
+    uint32_t bytesWritten = 0;
+};
+
+} // namespace fs
+
+using fs::Dir;
+using fs::File;
+using fs::FS;
+using fs::FSInfo;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
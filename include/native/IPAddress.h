@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+    IPAddress() : IPAddress(0, 0, 0, 0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _bytes[0] = a;
+        _bytes[1] = b;
+        _bytes[2] = c;
+        _bytes[3] = d;
+    }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    bool isSet() const { return _bytes[0] | _bytes[1] | _bytes[2] | _bytes[3]; }
+    String toString() const;
+    size_t printTo(Print &p) const override;
+
+private:
+    uint8_t _bytes[4];
+};
@@ -0,0 +1,120 @@
+#pragma once
+/*
+ * Print / Stream / HardwareSerial pour la cible hôte.
+ * Serial écrit sur stdout (désactivable) et lit depuis un tampon injecté.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *s);
+    size_t print(const String &s);
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(long long n, int base = DEC);
+    size_t print(unsigned long long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+    size_t print(const Printable &p);
+
+    size_t println();
+    template <typename T>
+    size_t println(const T &value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &value, int base) {
+        size_t n = print(value, base);
+        return n + println();
+    }
+    size_t println(const char *s) {
+        size_t n = print(s);
+        return n + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t vprintf(const char *format, va_list args);
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readStringUntil(char terminator);
+    String readString();
+
+protected:
+    unsigned long _timeout = 1000;
+    int timedRead();
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { _baud = baud; }
+    void end() {}
+    unsigned long baudRate() const { return _baud; }
+    explicit operator bool() const { return true; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite() { return 256; }
+    void flush() override;
+
+    // === API hôte ===
+    // Active/désactive la recopie de la sortie sur stdout
+    void setEcho(bool enabled) { _echo = enabled; }
+    // Ajoute des octets dans le tampon de réception
+    void inject(const char *data, size_t len);
+    void inject(const char *data);
+    // Redirige la sortie/entrée vers un descripteur (ex: pseudo-terminal)
+    void attachFd(int fd) { _fd = fd; }
+    int fd() const { return _fd; }
+    size_t bytesWritten() const { return _written; }
+
+private:
+    unsigned long _baud = 0;
+    bool _echo = true;
+    int _fd = -1;
+    size_t _written = 0;
+    String _rx;
+    unsigned int _rxPos = 0;
+    void pollFd();
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,31 @@
+#pragma once
+/*
+ * Ticker hôte : même interface que la bibliothèque Ticker du cœur ESP8266
+ * (os_timer). Les échéances sont servies pendant les attentes simulées
+ * (delay(), nativeWait(), yield()), comme le SDK les sert pendant un appel
+ * réseau bloquant. Pas d'allocation : les tickers armés forment une liste
+ * chaînée intrusive.
+ */
+#include <Arduino.h>
+
+class Ticker {
+public:
+    typedef void (*callback_function_t)();
+
+    ~Ticker() { detach(); }
+    void attach_ms(uint32_t milliseconds, callback_function_t callback) { arm(milliseconds, callback, true); }
+    void once_ms(uint32_t milliseconds, callback_function_t callback) { arm(milliseconds, callback, false); }
+    void detach();
+    bool active() const { return _armed; }
+
+    // Utilisé par le cœur hôte
+    uint64_t _dueUs = 0;
+    uint64_t _periodUs = 0;
+    bool _repeat = false;
+    bool _armed = false;
+    callback_function_t _callback = nullptr;
+    Ticker *_next = nullptr;
+
+private:
+    void arm(uint32_t milliseconds, callback_function_t callback, bool repeat);
+};
@@ -0,0 +1,130 @@
+#pragma once
+/*
+ * Implémentation hôte minimale de la classe String d'Arduino.
+ * Les allocations passent par new[] pour être comptées par le suivi de tas natif.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+class __FlashStringHelper;
+
+class String {
+public:
+    String(const char *cstr = "");
+    String(const char *cstr, size_t len);
+    String(const String &str);
+    String(String &&str);
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimals = 2);
+    explicit String(double value, unsigned char decimals = 2);
+    ~String();
+
+    String &operator=(const String &rhs);
+    String &operator=(String &&rhs);
+    String &operator=(const char *cstr);
+    String &operator=(const __FlashStringHelper *str);
+    String &operator=(char c);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _len; }
+    bool isEmpty() const { return _len == 0; }
+    const char *c_str() const { return _buf ? _buf : ""; }
+    char *begin() { return _buf; }
+    char *end() { return _buf ? _buf + _len : nullptr; }
+
+    bool concat(const String &str);
+    bool concat(const char *cstr);
+    bool concat(const char *cstr, unsigned int len);
+    bool concat(const __FlashStringHelper *str);
+    bool concat(char c);
+    bool concat(unsigned char num);
+    bool concat(int num);
+    bool concat(unsigned int num);
+    bool concat(long num);
+    bool concat(unsigned long num);
+    bool concat(long long num);
+    bool concat(unsigned long long num);
+    bool concat(float num);
+    bool concat(double num);
+
+    template <typename T>
+    String &operator+=(const T &rhs) {
+        concat(rhs);
+        return *this;
+    }
+    String &operator+=(const char *cstr) {
+        concat(cstr);
+        return *this;
+    }
+
+    int compareTo(const String &s) const;
+    bool equals(const String &s) const;
+    bool equals(const char *cstr) const;
+    bool equalsIgnoreCase(const String &s) const;
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+    bool startsWith(const String &prefix) const;
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index);
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes((unsigned char *)buf, bufsize, index);
+    }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    char *_buf = nullptr;
+    unsigned int _len = 0;
+    unsigned int _cap = 0;
+
+    bool grow(unsigned int size);
+    void copy(const char *cstr, unsigned int len);
+    void move(String &rhs);
+    bool concatNumber(unsigned long long value, bool negative, unsigned char base);
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(const String &lhs, int rhs);
+String operator+(const String &lhs, unsigned int rhs);
+String operator+(const String &lhs, long rhs);
+String operator+(const String &lhs, unsigned long rhs);
+String operator+(const String &lhs, const __FlashStringHelper *rhs);
+
+inline bool operator==(const char *lhs, const String &rhs) { return rhs == lhs; }
+inline bool operator!=(const char *lhs, const String &rhs) { return rhs != lhs; }
@@ -0,0 +1,14 @@
+#pragma once
+#include <ESP8266WiFi.h>
+
+// TLS simulé : seul le coût de la poignée de main est modélisé (voir LoopbackHttpServer)
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() {}
+    void setBufferSizes(int, int) {}
+    bool isSecure() const override { return true; }
+};
+
+namespace BearSSL {
+using ::WiFiClientSecure;
+}
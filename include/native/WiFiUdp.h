@@ -0,0 +1,50 @@
+#pragma once
+/*
+ * WiFiUDP hôte : socket UDP POSIX non bloquante, même interface que le
+ * cœur ESP8266 (paquet en cours d'écriture, paquet reçu lu par morceaux).
+ */
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <vector>
+
+class WiFiUDP : public Stream {
+public:
+    WiFiUDP() {}
+    ~WiFiUDP() override { stop(); }
+    WiFiUDP(const WiFiUDP &) = delete;
+    WiFiUDP &operator=(const WiFiUDP &) = delete;
+
+    // Port local (0 : éphémère) ; 1 si la socket est ouverte
+    uint8_t begin(uint16_t port);
+    void stop();
+    int beginPacket(IPAddress ip, uint16_t port);
+    int beginPacket(const char *host, uint16_t port);
+    int endPacket();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+    // Taille du datagramme suivant, 0 si rien n'est arrivé
+    int parsePacket();
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size);
+    int read(char *buf, size_t size) { return read((uint8_t *)buf, size); }
+    int peek() override;
+    void flush() override {}
+    IPAddress remoteIP() const { return _remoteIp; }
+    uint16_t remotePort() const { return _remotePort; }
+
+    // === API hôte ===
+    uint16_t localPort() const;
+
+private:
+    int _fd = -1;
+    IPAddress _txIp;
+    uint16_t _txPort = 0;
+    std::vector<uint8_t> _tx;
+    uint8_t _rx[1500];
+    size_t _rxLength = 0;
+    size_t _rxPos = 0;
+    IPAddress _remoteIp;
+    uint16_t _remotePort = 0;
+};
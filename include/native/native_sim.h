@@ -0,0 +1,334 @@
+#pragma once
+/*
+ * Contrôle de l'environnement simulé (env:native) :
+ * - champ RF et cartes simulées (Classic Mini/1K/4K, Ultralight, NTAG,
+ *   ISO 14443-4 : DESFire EV1, carte à puce générique, MIFARE Plus SL2)
+ * - modèle temporel du RC522, qualité du couplage selon le gain d'antenne
+ * - serveur HTTP distant en boucle locale (latence, taux d'échec)
+ * - modèle temporel de la flash SPI (EEPROM émulée, LittleFS)
+ * - traces des broches et suivi du tas
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// === Horloge ===
+// Temps virtuel : delay() et les attentes simulées avancent l'horloge au lieu
+// de dormir (bancs d'essai rapides et reproductibles).
+void nativeSetVirtualTime(bool enabled);
+void nativeWait(uint64_t us);
+
+// === Modèle temporel (µs) calqué sur un RC522 à 106 kbit/s, SPI 4 MHz ===
+struct SimTiming {
+    uint32_t requestUs = 600;        // REQA/WUPA + ATQA
+    uint32_t selectUs = 1300;        // anticollision + SELECT (niveau 1)
+    uint32_t cascadeUs = 1000;       // niveau de cascade supplémentaire
+    uint32_t authUs = 1100;          // authentification Crypto1 réussie
+    uint32_t readUs = 1000;          // MIFARE READ (16 octets)
+    uint32_t writeUs = 5800;         // MIFARE WRITE (deux phases + programmation)
+    uint32_t frameUs = 800;          // trame ISO-DEP : délai de réponse et traitement
+    uint32_t byteUs = 85;            // octet transmis à 106 kbit/s (9 bits), divisé par D
+    uint32_t registerUs = 8;         // accès registre SPI
+    float scale = 1.0f;              // 0 = instantané
+};
+
+// === Modèle temporel de la flash SPI (µs), puce 4 Mo d'un D1 mini ===
+// LittleFS : les écritures sont programmées par pages à la fermeture ou au
+// flush du fichier, un secteur est effacé tous les 4 Ko programmés, et chaque
+// fermeture/renommage/suppression coûte un commit de métadonnées.
+struct SimFlash {
+    uint32_t sectorEraseUs = 45000;      // effacement d'un secteur de 4 Ko
+    uint32_t pageProgramUs = 700;        // programmation d'une page de 256 octets
+    uint32_t readUsPerKB = 120;          // lecture SPI 40 MHz + pilote
+    uint32_t fsOpenUs = 300;             // recherche des métadonnées LittleFS
+    uint32_t fsMetadataCommitUs = 1400;  // commit de métadonnées (2 pages)
+    bool enabled = true;
+
+    // Compteurs
+    uint32_t erases = 0;
+    uint32_t pagePrograms = 0;
+    uint64_t bytesRead = 0;
+
+    static SimFlash &instance();
+    void read(size_t bytes);
+    void program(size_t bytes, bool allocates = true);
+    void erase();
+    void metadataCommit();
+    void open();
+};
+
+// === Cartes simulées ===
+class SimCard {
+public:
+    enum State : uint8_t { STATE_IDLE, STATE_READY, STATE_ACTIVE, STATE_HALT };
+
+    SimCard(const byte *uidBytes, byte uidLen, byte sakValue, uint16_t atqaValue);
+    virtual ~SimCard() {}
+    virtual const char *kindName() const = 0;
+
+    virtual MFRC522::StatusCode authenticate(byte command, byte blockAddr, const byte *key);
+    virtual MFRC522::StatusCode read(byte blockAddr, byte *out16) = 0;
+    virtual MFRC522::StatusCode write(byte blockAddr, const byte *data, byte len) = 0;
+    // Trames brutes (ISO-DEP, commandes propriétaires)
+    virtual MFRC522::StatusCode transceive(const byte *tx, byte txLen, byte *rx, byte *rxLen);
+    // Débits du RC522 (TxModeReg/RxModeReg) compris par la carte
+    virtual bool acceptsLink(byte txSpeed, byte rxSpeed) const { return txSpeed == 0 && rxSpeed == 0; }
+    virtual void reset();
+
+    byte uid[10];
+    byte uidSize;
+    byte sak;
+    uint16_t atqa;
+    State state = STATE_IDLE;
+    bool crypto = false;
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t authFailures = 0;
+};
+
+class SimClassicCard : public SimCard {
+public:
+    enum Size : uint8_t { MINI, CLASSIC_1K, CLASSIC_4K };
+
+    SimClassicCard(Size size, const byte *uidBytes, byte uidLen);
+    const char *kindName() const override;
+
+    MFRC522::StatusCode authenticate(byte command, byte blockAddr, const byte *key) override;
+    MFRC522::StatusCode read(byte blockAddr, byte *out16) override;
+    MFRC522::StatusCode write(byte blockAddr, const byte *data, byte len) override;
+    void reset() override;
+
+    uint16_t blockCount() const { return _blocks; }
+    byte sectorCount() const;
+    static byte sectorOf(byte blockAddr);
+    static byte trailerOf(byte sector);
+    static byte firstBlockOf(byte sector);
+    static byte blocksInSector(byte sector);
+
+    // Configuration du contenu
+    void setBlock(byte blockAddr, const byte *data16);
+    const byte *block(byte blockAddr) const { return &_memory[blockAddr * 16]; }
+    void setSectorKeys(byte sector, const byte *keyA, const byte *keyB, byte g0, byte g1, byte g2, byte g3);
+    bool magic = false; // carte « magique » : bloc 0 inscriptible
+
+private:
+    Size _size;
+    uint16_t _blocks;
+    std::vector<byte> _memory;
+    int _authSector = -1;
+    bool _authKeyB = false;
+
+    byte accessBits(byte blockAddr) const;
+    bool dataAllowed(byte blockAddr, bool writeOp) const;
+};
+
+class SimUltralightCard : public SimCard {
+public:
+    enum Model : uint8_t { ULTRALIGHT, NTAG213, NTAG215, NTAG216 };
+
+    SimUltralightCard(Model model, const byte *uid7);
+    const char *kindName() const override;
+
+    MFRC522::StatusCode read(byte page, byte *out16) override;
+    MFRC522::StatusCode write(byte page, const byte *data, byte len) override;
+
+    uint16_t pageCount() const { return _pages; }
+    void setPage(byte page, const byte *data4);
+    const byte *page(byte p) const { return &_memory[p * 4]; }
+
+private:
+    Model _model;
+    uint16_t _pages;
+    std::vector<byte> _memory;
+};
+
+// Carte ISO 14443-4 : RATS/ATS, PPS, blocs I/R/S (règles de numérotation de
+// la norme), applications DESFire (commandes natives encapsulées CLA 0x90) et
+// NDEF Type 4. Aucune réponse aux commandes MIFARE Classic.
+class SimIsoDepCard : public SimCard {
+public:
+    enum Kind : uint8_t { DESFIRE_EV1, SMARTCARD, MIFARE_PLUS_SL2 };
+
+    SimIsoDepCard(Kind kind, const byte *uid7);
+    const char *kindName() const override;
+
+    MFRC522::StatusCode read(byte blockAddr, byte *out16) override;
+    MFRC522::StatusCode write(byte blockAddr, const byte *data, byte len) override;
+    MFRC522::StatusCode transceive(const byte *tx, byte txLen, byte *rx, byte *rxLen) override;
+    bool acceptsLink(byte txSpeed, byte rxSpeed) const override { return txSpeed == dri && rxSpeed == dsi; }
+    void reset() override;
+
+    // Message NDEF du fichier E104 (vide : pas d'application NDEF)
+    void setNdef(const std::vector<byte> &message);
+
+    std::vector<byte> ats;
+    std::vector<uint32_t> applications;
+    bool waitExtension = false;  // S(WTX) avant chaque réponse APDU
+    // Débits négociés par PPS (indices : 106 kbit/s x 2^n)
+    byte dsi = 0;
+    byte dri = 0;
+    uint32_t apdus = 0;
+
+private:
+    Kind _kind;
+    bool _layer4 = false;
+    byte _blockNumber = 1;
+    uint16_t _fsd = 16;
+    std::vector<byte> _command;      // blocs I chaînés reçus
+    std::vector<byte> _pending;      // réponse en cours d'émission
+    size_t _pendingOffset = 0;
+    std::vector<byte> _lastBlock;
+    bool _wtxPending = false;
+    byte _versionFrame = 0;          // GetVersion : trame suivante
+    bool _ndefSelected = false;
+    uint16_t _file = 0;
+    std::vector<byte> _ndefFile;
+
+    std::vector<byte> apdu(const std::vector<byte> &command);
+    void nextBlock(byte *rx, byte *rxLen);
+    void sendBlock(const std::vector<byte> &block, byte *rx, byte *rxLen);
+};
+
+// === Champ RF / puce RC522 simulée ===
+class SimField {
+public:
+    static SimField &instance();
+
+    // Dépose une carte dans le champ (l'ancienne est retirée)
+    void place(std::shared_ptr<SimCard> card);
+    void remove();
+    SimCard *card() { return _card.get(); }
+    bool present() const { return _card != nullptr; }
+    unsigned long placedAtUs() const { return _placedAtUs; }
+
+    SimTiming timing;
+    void spend(uint32_t us);
+    uint32_t timerTimeoutUs() const;
+
+    // Registres du PCD
+    byte regs[64];
+    void resetRegisters();
+    bool antennaOn() const { return (regs[0x14] & 0x03) == 0x03; }
+
+    // Couplage carte/antenne : 0 = liaison parfaite (modèle désactivé), 1 = carte
+    // sur l'antenne au gain par défaut (33 dB), 0,5 = boîtier épais ou carte
+    // éloignée. Chaque échange est perdu avec une probabilité qui dépend du
+    // couplage multiplié par le gain (RFCfgReg) ; trop de signal sature aussi.
+    float coupling = 0.0f;
+    uint32_t rfSeed = 0x2545F491;
+    uint32_t rfErrors = 0;
+    // Échange perdu : couplage insuffisant ou réponse plus lente que le timer
+    bool responseLost(uint32_t responseUs);
+
+    // Injection de défauts : le RC522 cesse de répondre jusqu'au prochain PCD_Init
+    void injectBrownout();
+    // Décharge électrostatique : registres revenus au reset (antenne coupée,
+    // timer manuel), la puce répond encore sur le bus SPI
+    void injectGlitch();
+    bool brownout = false;
+
+    uint32_t requests = 0;
+    uint32_t selects = 0;
+    uint32_t timeouts = 0;
+
+private:
+    SimField();
+    std::shared_ptr<SimCard> _card;
+    unsigned long _placedAtUs = 0;
+};
+
+// Fabriques de cartes simulées
+std::shared_ptr<SimClassicCard> simClassic1K(uint32_t uid4 = 0xDEADBEEF);
+std::shared_ptr<SimClassicCard> simClassic4K(uint32_t uid4 = 0xC0FFEE42);
+// 1K aux droits mélangés : clé A inconnue, lecture réservée à la clé B, lecture seule, bloqué
+std::shared_ptr<SimClassicCard> simClassicMixed(uint32_t uid4 = 0x5EC70A11);
+std::shared_ptr<SimUltralightCard> simUltralight();
+// DESFire EV1 4K : 3 applications dont NDEF (URI https://example.com)
+std::shared_ptr<SimIsoDepCard> simDesfire();
+// Carte à puce ISO 14443-4 sans DESFire ni NDEF (paiement, JavaCard)
+std::shared_ptr<SimIsoDepCard> simSmartCard();
+std::shared_ptr<SimIsoDepCard> simMifarePlus();
+std::shared_ptr<SimUltralightCard> simNtag(SimUltralightCard::Model model = SimUltralightCard::NTAG215);
+
+// === Serveur HTTP distant simulé (cible de sendUidToApi) ===
+struct LoopbackRequest {
+    String method;
+    String url;
+    String contentType;
+    String idempotencyKey;      // en-tête Idempotency-Key, vide si absent
+    std::vector<uint8_t> body;
+    unsigned long receivedAtUs;
+};
+
+struct LoopbackResponse {
+    int code = 200;
+    String body = "OK";
+};
+
+class LoopbackHttpServer {
+public:
+    static LoopbackHttpServer &instance();
+
+    uint32_t latencyUs = 0;           // temps de traitement serveur
+    uint32_t connectUs = 2000;        // établissement TCP
+    uint32_t tlsHandshakeUs = 250000; // poignée de main TLS (BearSSL sur ESP8266)
+    float failureRate = 0.0f;         // proportion de requêtes en échec
+    int failureCode = -1;             // code renvoyé en cas d'échec (HTTPC_ERROR_*)
+    bool reachable = true;
+
+    // Réponse personnalisée (sinon 200 "OK")
+    std::function<LoopbackResponse(const LoopbackRequest &)> handler;
+
+    std::vector<LoopbackRequest> received;
+    void clear() { received.clear(); }
+
+    int serve(const LoopbackRequest &req, String &responseBody, bool secure);
+
+private:
+    LoopbackHttpServer() {}
+};
+
+// === Port série sur pseudo-terminal ===
+// Serial lit et écrit le côté maître (non bloquant) ; le côté esclave, en mode
+// brut, est le port que l'hôte ouvre (chemin dans slavePath). Le descripteur
+// esclave reste ouvert pour que le terminal survive aux fermetures de l'hôte.
+// Renvoie le descripteur maître, -1 en cas d'échec.
+int nativeOpenPty(char *slavePath, size_t size);
+
+// === WiFi simulé ===
+struct SimNetwork {
+    static SimNetwork &instance();
+    bool connected = true;
+    int32_t rssi = -55;
+};
+
+// === Traces des broches (buzzer, LED) ===
+struct PinTrace {
+    uint32_t writes = 0;
+    uint32_t risingEdges = 0;
+    uint8_t level = 0;
+    unsigned long lastChangeUs = 0;
+    unsigned long firstRiseUs = 0;
+};
+PinTrace &nativePinTrace(uint8_t pin);
+void nativePinTraceReset();
+
+// === Suivi du tas (operator new/delete) ===
+struct NativeHeapStats {
+    uint32_t allocations = 0;
+    uint32_t frees = 0;
+    uint32_t liveBytes = 0;
+    uint32_t peakBytes = 0;
+    uint32_t minFree = 0;
+    uint32_t networkAllocations = 0; // dont allocations faites par la pile HTTP simulée
+};
+#define NATIVE_HEAP_SIZE 48000 // tas disponible typique d'un ESP8266 WiFi actif
+NativeHeapStats nativeHeapStats();
+void nativeHeapResetPeak();
+// Attribue les allocations à la pile réseau le temps d'une portée
+struct NativeNetworkHeapScope {
+    NativeNetworkHeapScope();
+    ~NativeNetworkHeapScope();
+};
@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * Images NDEF de référence, partagées par les tests (test/test_ndef) et le
+ * banc program ndef.
+ */
+#include <ndef.h>
+#include <string.h>
+#include <vector>
+
+// Images de référence au format NFC Forum, telles que relues d'une carte :
+// NTAG213 (URI + texte), Ultralight avec TLV Lock Control (texte UTF-8),
+// Classic 1K secteurs 0 à 3 (MAD, message URI à cheval sur deux secteurs ;
+// clés A relues à zéro comme dans un dump)
+static const byte ntag213Image[64] = {
+    0x04, 0xA1, 0xB2, 0x2F, 0xC3, 0xD4, 0xE5, 0x80, 0x91, 0x48, 0x00, 0x00, 0xE1, 0x10, 0x12, 0x00,
+    0x03, 0x2C, 0x91, 0x01, 0x1A, 0x55, 0x02, 0x65, 0x78, 0x61, 0x6D, 0x70, 0x6C, 0x65, 0x2E, 0x6F,
+    0x72, 0x67, 0x2F, 0x62, 0x61, 0x64, 0x67, 0x65, 0x3F, 0x69, 0x64, 0x3D, 0x31, 0x32, 0x33, 0x34,
+    0x51, 0x01, 0x0A, 0x54, 0x02, 0x66, 0x72, 0x42, 0x6F, 0x6E, 0x6A, 0x6F, 0x75, 0x72, 0xFE, 0x00,
+};
+static const byte ultralightImage[64] = {
+    0x04, 0x11, 0x22, 0xBF, 0x33, 0x44, 0x55, 0x66, 0x00, 0x48, 0x00, 0x00, 0xE1, 0x10, 0x06, 0x00,
+    0x01, 0x03, 0xA0, 0x10, 0x44, 0x03, 0x16, 0xD1, 0x01, 0x12, 0x54, 0x02, 0x66, 0x72, 0x41, 0x63,
+    0x63, 0xC3, 0xA8, 0x73, 0x20, 0x76, 0x69, 0x73, 0x69, 0x74, 0x65, 0x75, 0x72, 0xFE, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+static const byte classic1kImage[256] = {
+    0x5A, 0x3C, 0x91, 0x07, 0xF0, 0x08, 0x04, 0x00, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0xF3, 0x01, 0x03, 0xE1, 0x03, 0xE1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x77, 0x88, 0xC1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x37, 0xD1, 0x01, 0x33, 0x55, 0x04, 0x69, 0x6E, 0x74, 0x72, 0x61, 0x6E, 0x65, 0x74, 0x2E,
+    0x65, 0x78, 0x61, 0x6D, 0x70, 0x6C, 0x65, 0x2E, 0x63, 0x6F, 0x6D, 0x2F, 0x61, 0x67, 0x65, 0x6E,
+    0x74, 0x73, 0x2F, 0x66, 0x69, 0x63, 0x68, 0x65, 0x3F, 0x6D, 0x61, 0x74, 0x72, 0x69, 0x63, 0x75,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x07, 0x88, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x6C, 0x65, 0x3D, 0x30, 0x30, 0x30, 0x31, 0x32, 0x33, 0xFE, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x07, 0x88, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x07, 0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// Zone NDEF d'une image Classic : blocs de données des secteurs du MAD bout à bout
+inline size_t classicNdefArea(const byte *image, uint16_t blocks, byte *out, size_t size) {
+    uint16_t sectors = ndefMadSectors(image + 16);
+    size_t n = 0;
+    for (uint8_t s = 1; s < NDEF_MAD_SECTORS; s++) {
+        if (!(sectors & (1 << s)) || s * 4 + 3 >= blocks) continue;
+        for (byte b = 0; b < 3 && n + 16 <= size; b++, n += 16) memcpy(out + n, image + (s * 4 + b) * 16, 16);
+    }
+    return n;
+}
+
+// TLV d'un enregistrement MIME de 300 octets : longueurs sur trois et quatre octets
+inline std::vector<byte> ndefVcardArea() {
+    std::vector<byte> payload(300, ' ');
+    const char *vcard = "BEGIN:VCARD\nVERSION:3.0\nFN:Agent 0042\nEND:VCARD\n";
+    memcpy(payload.data(), vcard, strlen(vcard));
+    std::vector<byte> record = {NDEF_MB | NDEF_ME | NDEF_TNF_MIME, 10, 0x00, 0x00, 0x01, 0x2C};
+    const char *type = "text/vcard";
+    record.insert(record.end(), type, type + 10);
+    record.insert(record.end(), payload.begin(), payload.end());
+    std::vector<byte> area = {NDEF_TLV_MESSAGE, 0xFF, (byte)(record.size() >> 8), (byte)record.size()};
+    area.insert(area.end(), record.begin(), record.end());
+    area.push_back(NDEF_TLV_TERMINATOR);
+    return area;
+}
@@ -0,0 +1,91 @@
+#pragma once
+/*
+ * Codage NDEF : TLV, enregistrements, URI et texte, MAD MIFARE Classic.
+ *
+ * L'analyse se fait en place sur la zone de données brute de la carte (pages
+ * 4 et suivantes d'une Ultralight/NTAG, blocs de données des secteurs NDEF
+ * d'une Classic mis bout à bout) : ndefFindMessage() localise le TLV NDEF,
+ * ndefNextRecord() parcourt les enregistrements et NdefRecord ne contient que
+ * des pointeurs dans cette zone. Aucune allocation, aucune copie.
+ *
+ * Les fonctions d'encodage écrivent le TLV complet (03 L message FE) dans un
+ * tampon fourni, prêt à être découpé en pages ou en blocs.
+ */
+#include <Arduino.h>
+
+// Types de TLV (NFC Forum Type 2, MIFARE Classic)
+#define NDEF_TLV_NULL        0x00
+#define NDEF_TLV_LOCK        0x01
+#define NDEF_TLV_MEMORY      0x02
+#define NDEF_TLV_MESSAGE     0x03
+#define NDEF_TLV_PROPRIETARY 0xFD
+#define NDEF_TLV_TERMINATOR  0xFE
+
+// En-tête d'enregistrement
+#define NDEF_MB  0x80
+#define NDEF_ME  0x40
+#define NDEF_CF  0x20
+#define NDEF_SR  0x10
+#define NDEF_IL  0x08
+#define NDEF_TNF_MASK 0x07
+
+#define NDEF_TNF_WELL_KNOWN 0x01
+#define NDEF_TNF_MIME       0x02
+#define NDEF_TNF_URI        0x03
+#define NDEF_TNF_EXTERNAL   0x04
+
+#define NDEF_MAD_AID       0xE103   // secteur NDEF dans le MAD
+#define NDEF_MAD_SECTORS   16       // MAD1 : secteurs 1 à 15
+#define NDEF_CC_MAGIC      0xE1
+
+enum NdefStatus : uint8_t {
+    NDEF_OK,
+    NDEF_END,          // plus d'enregistrement
+    NDEF_NO_MESSAGE,   // aucun TLV NDEF avant le terminateur
+    NDEF_TRUNCATED,    // zone lue trop courte : *needed octets nécessaires
+    NDEF_MALFORMED,
+};
+
+// Vue sur un enregistrement : pointeurs dans la zone analysée
+struct NdefRecord {
+    byte header;              // MB ME CF SR IL TNF
+    const byte *type;
+    byte typeLength;
+    const byte *id;
+    byte idLength;
+    const byte *payload;
+    uint32_t payloadLength;
+};
+
+struct NdefCursor {
+    const byte *data;
+    size_t length;
+    size_t offset;
+};
+
+enum NdefKind : uint8_t { NDEF_KIND_URI, NDEF_KIND_TEXT };
+
+// TLV NDEF dans une zone de données. NDEF_TRUNCATED : la zone doit contenir
+// au moins *needed octets pour que le message soit complet.
+NdefStatus ndefFindMessage(const byte *area, size_t length, const byte **message, size_t *messageLength,
+                           size_t *needed);
+void ndefBegin(NdefCursor &cursor, const byte *message, size_t length);
+NdefStatus ndefNextRecord(NdefCursor &cursor, NdefRecord &record);
+
+bool ndefIsUri(const NdefRecord &record);
+bool ndefIsText(const NdefRecord &record);
+// Préfixe abrégé d'un enregistrement URI ("" si code inconnu ou nul)
+const char *ndefUriPrefix(byte code);
+// Résumé lisible (URI complète, texte et langue, type MIME...), tronqué à size
+size_t ndefDescribe(const NdefRecord &record, char *out, size_t size);
+
+// TLV d'un message à un enregistrement URI ou texte ; 0 si le tampon est trop petit
+size_t ndefEncode(NdefKind kind, const char *value, const char *lang, byte *out, size_t size);
+
+// Capability Container Type 2 (page 3) : taille de la zone de données, 0 si absent
+uint16_t ndefType2Capacity(const byte *cc);
+// MAD1 (blocs 1 et 2 du secteur 0, 32 octets) : secteurs NDEF (bit s = secteur s),
+// 0 si le CRC est faux
+uint16_t ndefMadSectors(const byte *mad);
+void ndefMadBuild(uint16_t sectors, byte *mad);
+byte ndefMadCrc(const byte *mad);
@@ -0,0 +1,52 @@
+#pragma once
+/*
+ * Messages NDEF sur les cartes : lecture et écriture pour Ultralight/NTAG
+ * (NFC Forum Type 2) et MIFARE Classic (secteurs désignés par le MAD).
+ *
+ * Lecture : sur Ultralight/NTAG, les pages 0 à 15 déjà lues par le dump
+ * suffisent le plus souvent et le message y est analysé en place ; seuls
+ * les messages plus longs font lire les pages suivantes, jusqu'à la fin du
+ * TLV et pas au-delà. Sur Classic, le MAD (secteur 0, clé publique
+ * A0A1A2A3A4A5) désigne les secteurs NDEF (clé D3F7D3F7D3F7), lus un par un
+ * jusqu'à la fin du message. Les enregistrements décodés (URI, texte...)
+ * remplacent l'hexadécimal brut dans lastCardInfo.
+ *
+ * Écriture (/api/write?ndef=uri|text) : le TLV est encodé à la requête puis
+ * découpé en pages ou en blocs au passage de la carte, chaque bloc relu pour
+ * vérification. Une Ultralight vierge reçoit son Capability Container ; une
+ * Classic en configuration de transport est formatée selon NFC Forum (MAD
+ * et trailers aux clés publiques, clé B laissée à FF..FF) sur les seuls
+ * secteurs nécessaires.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <ndef.h>
+
+#define NDEF_AREA_MAX      888   // zone de données NTAG216 ; Classic 1K : 15 x 48 = 720
+#define NDEF_WRITE_MAX     256   // TLV écrit depuis /api/write
+#define NDEF_RECORDS_SHOWN 4     // enregistrements décrits dans lastCardInfo
+
+struct NdefStats {
+    uint32_t messages;       // messages NDEF trouvés à la lecture
+    uint32_t records;
+    uint32_t malformed;
+    uint32_t extraReads;     // lectures au-delà du dump (messages longs, secteurs Classic)
+    uint32_t writes;         // messages écrits et vérifiés
+    uint32_t writeFailures;
+    uint32_t formatted;      // cartes vierges formatées (CC ou MAD)
+};
+
+// Pages 0 à pageCount-1 d'une Ultralight/NTAG déjà lues
+void appendType2Ndef(const byte *pages, byte pageCount);
+// MAD puis secteurs NDEF de la Classic sélectionnée
+void appendClassicNdef();
+// Enregistrements d'un message (sans TLV) : série et lastCardInfo
+void appendNdefRecords(const byte *message, size_t length);
+
+// Message à écrire au prochain passage en mode écriture ; false s'il est trop long
+bool ndefPrepareWrite(NdefKind kind, const char *value, const char *lang);
+void ndefCancelWrite();
+bool ndefWritePending();
+bool ndefWriteCard(MFRC522::PICC_Type type);
+
+const NdefStats &ndefStats();
@@ -0,0 +1,72 @@
+#pragma once
+/*
+ * Encodage en série (mode PROVISION) : une file de contenus, une carte vierge
+ * après l'autre, sans requête par carte.
+ *
+ * La file est envoyée par POST /api/provision/queue, en CSV (une ligne par
+ * carte, « données[,format] » avec format raw, uri ou text, données entre
+ * guillemets si elles contiennent une virgule) ou en JSON (tableau de chaînes
+ * ou d'objets {"data":"...","ndef":"uri"}). Elle est validée puis normalisée
+ * dans /provision/queue.txt, une ligne « format<TAB>données » par entrée ; le
+ * rang et la position de la prochaine entrée sont gardés dans
+ * /provision/cursor, si bien qu'un redémarrage reprend là où l'encodage
+ * s'était arrêté.
+ *
+ * À chaque carte : UID déjà encodé (table de hachage en RAM, reconstruite au
+ * démarrage depuis le journal) -> refus sans écrire ; carte non vierge ->
+ * refus, l'entrée reste en tête de file ; sinon écriture de l'entrée, relue
+ * bloc par bloc, puis ligne « uid;rang;format;données » ajoutée à
+ * /provision/log.csv. Le bip final, non bloquant, distingue succès, doublon
+ * et échec.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+
+#define PROVISION_DIR          "/provision"
+#define PROVISION_QUEUE_PATH   PROVISION_DIR "/queue.txt"
+#define PROVISION_NEW_PATH     PROVISION_DIR "/queue.new"
+#define PROVISION_CURSOR_PATH  PROVISION_DIR "/cursor"
+#define PROVISION_LOG_PATH     PROVISION_DIR "/log.csv"
+#define PROVISION_UPLOAD_PATH  PROVISION_DIR "/upload.tmp"
+#define PROVISION_QUEUE_MAX    512     // entrées par file
+#define PROVISION_DATA_MAX     240     // octets de données par entrée
+#define PROVISION_SEEN_SLOTS   1024    // UID encodés suivis en RAM (4 Ko, puissance de 2)
+#define PROVISION_RATE_WINDOW  16      // dernières cartes prises pour le débit
+
+// Motifs du bip final (nombre, durée en ms)
+#define PROVISION_BEEP_OK        1, 300
+#define PROVISION_BEEP_DUPLICATE 2, 120
+#define PROVISION_BEEP_FAILED    4, 60
+#define PROVISION_BEEP_EMPTY     3, 250
+
+enum ProvisionResult : uint8_t {
+    PROVISION_WRITTEN,
+    PROVISION_DUPLICATE,    // UID déjà encodé
+    PROVISION_NOT_BLANK,    // carte déjà écrite ou illisible
+    PROVISION_FAILED,       // écriture ou vérification échouée
+    PROVISION_EMPTY,        // file épuisée
+};
+
+struct ProvisionStats {
+    uint32_t queued;        // entrées de la file
+    uint32_t next;          // rang de la prochaine entrée
+    uint32_t written;       // cartes écrites et vérifiées
+    uint32_t failures;
+    uint32_t duplicates;
+    uint32_t notBlank;
+    uint32_t lastUs;        // dernière carte : contrôle, écriture, vérification
+};
+
+void provisioningBegin();
+// Fichier envoyé (CSV ou JSON) -> nouvelle file ; nombre d'entrées, 0 et
+// error renseigné si le fichier est refusé (la file précédente est gardée)
+uint32_t provisionImport(const char *path, String &error);
+// Carte sélectionnée : contrôle, écriture de l'entrée suivante et journal
+ProvisionResult provisionCard(MFRC522::PICC_Type type, const char *uid);
+// Efface file, curseur, journal et UID connus
+void provisionReset();
+// Débit sur les PROVISION_RATE_WINDOW dernières cartes écrites
+uint32_t provisionCardsPerHour();
+const ProvisionStats &provisionStats();
+String provisionStatusJson();
+const char *provisionResultName(ProvisionResult result);
@@ -0,0 +1,49 @@
+#pragma once
+/*
+ * Surveillance du RC522 et reprise automatique.
+ *
+ * Après une micro-coupure ou une décharge électrostatique, le RC522 peut
+ * repartir avec ses registres au reset (antenne coupée, timer manuel) ou
+ * ne plus répondre sur le bus SPI : PICC_IsNewCardPresent() renvoie alors
+ * false indéfiniment. Toutes les RC522_HEALTH_INTERVAL_MS, rc522HealthLoop()
+ * relit VersionReg et les registres fixés par PCD_Init (quelques µs de SPI).
+ * À la moindre dérive : antenne seule coupée -> PCD_AntennaOn() ; registres
+ * perdus -> PCD_Init() (reset logiciel) ; puce muette -> reset matériel par
+ * RST_PIN puis PCD_Init(). Le gain et le timer enregistrés sont réappliqués
+ * et la puce revérifiée ; en cas d'échec la reprise est retentée toutes les
+ * RC522_HEALTH_RETRY_MS.
+ */
+#include <Arduino.h>
+
+#define RC522_HEALTH_INTERVAL_MS 1000
+#define RC522_HEALTH_RETRY_MS    250
+
+enum Rc522Fault : uint8_t {
+    RC522_FAULT_NONE,
+    RC522_FAULT_SPI,        // VersionReg à 0x00 ou 0xFF : puce muette
+    RC522_FAULT_VERSION,    // version différente de celle lue au démarrage
+    RC522_FAULT_REGISTERS,  // registres de PCD_Init revenus au reset
+    RC522_FAULT_ANTENNA,    // antenne seule coupée
+    RC522_FAULT_COUNT
+};
+
+struct Rc522HealthStats {
+    bool healthy;
+    byte version;               // lue au démarrage
+    uint32_t probes;
+    uint32_t faults;            // dérives détectées
+    uint32_t recoveries;        // reprises réussies
+    uint32_t failedRecoveries;  // tentatives restées sans effet
+    uint32_t hardResets;
+    Rc522Fault lastFault;
+    unsigned long lastFaultMs;  // 0 : aucun défaut
+    uint32_t lastRecoveryUs;    // détection -> puce revérifiée
+    uint32_t maxRecoveryUs;
+};
+
+void rc522HealthBegin();
+void rc522HealthLoop();
+// Sonde immédiate (et reprise si besoin) ; true si la puce est saine
+bool rc522HealthCheck();
+const Rc522HealthStats &rc522HealthStats();
+const char *rc522FaultName(Rc522Fault fault);
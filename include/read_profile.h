@@ -0,0 +1,72 @@
+#pragma once
+/*
+ * Profils de lecture : ne lire que les blocs ou pages utiles et en extraire
+ * des champs typés, envoyés à l'API à la place du vidage complet.
+ *
+ * /config/profiles.txt, une ligne par profil (# : commentaire) :
+ *   nom|zones|champs
+ *   badge|S2|employe=B8+0/8/ascii,site=B9+4/2/u16be
+ *   ntag|P4-P7|id=P4+0/16/hex
+ *
+ * Zones : B<n> bloc Classic, S<n> blocs de données du secteur n, P<n> ou
+ * P<a>-P<b> pages Ultralight/NTAG (lues par 4 avec une seule commande READ).
+ * Champ : nom=<zone de départ>+<décalage>/<longueur>/<encodage>, les octets
+ * des zones lues étant concaténés dans l'ordre de la liste.
+ * Encodages : hex, ascii, bcd, u16be, u16le, u32be, u32le.
+ *
+ * Le profil intégré « full » conserve l'ancien vidage complet (45 blocs ou
+ * 16 pages). Chaque profil mesure ses temps de lecture.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <config.h>
+#include <metrics.h>
+
+#define READ_PROFILES_PATH      "/config/profiles.txt"
+#define READ_PROFILE_MAX        6      // « full » compris
+#define READ_PROFILE_UNITS_MAX  16     // blocs ou pages lus
+#define READ_PROFILE_FIELDS_MAX 6
+#define READ_FIELD_NAME_MAXLEN  15
+#define READ_FIELD_VALUE_MAXLEN 32
+#define SCAN_FIELDS_MAXLEN      128    // "&nom=valeur..." encodé pour l'API
+
+enum ReadProfileMemory : uint8_t { PROFILE_FULL, PROFILE_CLASSIC, PROFILE_ULTRALIGHT };
+
+enum FieldEncoding : uint8_t { ENC_HEX, ENC_ASCII, ENC_BCD, ENC_U16BE, ENC_U16LE, ENC_U32BE, ENC_U32LE };
+
+struct ReadField {
+    char name[READ_FIELD_NAME_MAXLEN + 1];
+    uint8_t offset;     // dans la concaténation des zones lues
+    uint8_t length;
+    FieldEncoding encoding;
+};
+
+struct ReadProfile {
+    char name[READ_PROFILE_NAME_MAXLEN + 1];
+    ReadProfileMemory memory;
+    uint8_t unitCount;
+    uint8_t units[READ_PROFILE_UNITS_MAX];    // blocs ou pages, dans l'ordre
+    uint8_t fieldCount;
+    ReadField fields[READ_PROFILE_FIELDS_MAX];
+    // Temps de lecture
+    uint32_t reads;
+    uint32_t failures;
+    uint32_t lastUs;
+    uint32_t maxUs;
+    Histogram readTime;
+};
+
+bool readProfilesBegin();
+// Remplace les définitions (texte complet) ; error reçoit la ligne fautive
+bool readProfilesSave(const String &text, String &error);
+String readProfilesText();
+uint8_t readProfileCount();
+const ReadProfile *readProfileAt(uint8_t index);
+const ReadProfile *readProfileFind(const char *name);
+ReadProfile *readProfileActive();
+// Lit la carte sélectionnée selon un profil ciblé (pas « full ») : résumé dans
+// lastCardInfo, champs extraits dans fields ("&nom=valeur", encodé pour un formulaire)
+bool readProfileRun(ReadProfile *profile, MFRC522::PICC_Type piccType, char *fields, size_t fieldsSize);
+// Temps d'une lecture, ciblée ou complète
+void readProfileRecord(ReadProfile *profile, uint32_t us, bool ok);
+String readProfilesJson();
@@ -0,0 +1,63 @@
+#pragma once
+/*
+ * Réglage automatique du gain d'antenne et du timer du RC522.
+ *
+ * Chaque sélection, authentification attendue, lecture et écriture est
+ * comptée (réussite au premier essai, latence). Par fenêtre de
+ * RF_TUNE_WINDOW opérations, le taux d'échec du gain courant est lissé ;
+ * au-delà de RF_FAIL_HIGH_PERMILLE le gain passe au niveau voisin le plus
+ * prometteur (jamais essayé d'abord). Le timer, qui borne aussi l'attente de
+ * chaque REQA sans carte dans loop(), est raccourci tant que les fenêtres
+ * restent propres et rallongé dès que les timeouts augmentent. Les réglages
+ * restent dans [RF_GAIN_MIN, RF_GAIN_MAX] et [RF_TIMER_RELOAD_MIN, _MAX]
+ * (config.h) et sont enregistrés dans la configuration.
+ *
+ * Calibration : avec une carte de référence posée, chaque couple gain x timer
+ * est essayé RF_CALIBRATION_TRIALS fois (WUPA, SELECT, lecture, HLTA), un
+ * essai par appel de rfTuningLoop() ; le meilleur taux de réussite l'emporte,
+ * puis le cycle le plus court.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <config.h>
+#include <metrics.h>
+
+#define RF_TUNE_WINDOW          40
+#define RF_FAIL_HIGH_PERMILLE   30     // 3 % d'échecs au premier essai
+#define RF_TIMER_STEP           100    // 2,5 ms
+#define RF_CALIBRATION_TRIALS   20
+#define RF_CALIBRATION_TIMERS   4
+
+enum RfOp : uint8_t { RF_SELECT, RF_AUTH, RF_READ, RF_WRITE, RF_OP_COUNT };
+
+struct RfOpStats {
+    uint32_t attempts;
+    uint32_t failures;
+    Histogram latency;      // opérations réussies
+};
+
+struct RfTuningStats {
+    RfOpStats ops[RF_OP_COUNT];
+    uint32_t windows;
+    uint32_t adjustments;
+    uint16_t windowAttempts;        // fenêtre en cours
+    uint16_t windowFailures;
+    uint16_t lastFailPermille;      // dernière fenêtre close
+    uint16_t gainFailPermille[8];   // moyenne lissée par niveau (index RFCfgReg >> 4)
+    uint8_t gainWindows[8];
+};
+
+// Applique les réglages enregistrés au RC522 (après PCD_Init)
+void rfTuningBegin();
+void rfRecord(RfOp op, bool ok, uint32_t us);
+// Lecture et écriture MIFARE comptées
+MFRC522::StatusCode rfRead(MFRC522 &reader, byte block, byte *buffer, byte *size);
+MFRC522::StatusCode rfWrite(MFRC522 &reader, byte block, byte *buffer, byte size);
+// Fenêtre close : ajustements ; calibration en cours : un essai
+void rfTuningLoop();
+void rfApply(uint8_t gain, uint16_t timerReload);
+
+bool rfCalibrationStart();
+bool rfCalibrating();
+const RfTuningStats &rfTuningStats();
+String rfTuningJson();
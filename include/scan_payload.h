@@ -0,0 +1,57 @@
+#pragma once
+/*
+ * Corps des envois de scans : form-urlencoded (historique) ou CBOR (RFC 8949).
+ *
+ * Le même enregistrement est codé directement dans le tampon réseau du
+ * transport (corps HTTP, datagramme CoAP, publication MQTT), sans String
+ * intermédiaire. Encodage choisi par apiEncoding (settings.h).
+ *
+ * Schéma CBOR : une map à clés entières, les clés absentes sont omises.
+ *
+ *   0  UID            octets (bstr)
+ *   1  SAK            entier
+ *   2  type           entier (MFRC522::PICC_Type)
+ *   3  horodatage     entier, secondes depuis le démarrage à la capture
+ *   4  séquence       entier, persistante (upload_outbox.h)
+ *   5  champs         map texte -> texte du profil de lecture, décodés
+ *   6  blocs          octets, image mémoire optionnelle
+ *   7  taille de bloc entier (16 Classic, 4 Ultralight), avec 6
+ *   8  appareil       texte ; avec 4, clé d'idempotence (upload_outbox.h)
+ *
+ * Form : "uid=<hex>&device=&scan=&sak=&type=&ts=<champs>&data=<hex>", mêmes
+ * absences ; sans métadonnée de carte, le corps reste « uid=<hex><champs> ».
+ */
+#include <Arduino.h>
+#include <read_profile.h>
+#include <scanner.h>
+
+enum ApiEncoding : uint8_t {
+    API_ENCODING_FORM,
+    API_ENCODING_CBOR,
+    API_ENCODING_COUNT
+};
+
+// Plus grand corps sans blocs, dans les deux encodages
+#define SCAN_PAYLOAD_MAX (120 + SCAN_FIELDS_MAXLEN)
+
+struct ScanRecord {
+    const char *uid;            // hexadécimal, envoyé en octets en CBOR
+    bool hasCard;               // SAK, type et horodatage connus (absents via sendUidToApi)
+    uint8_t sak;
+    uint8_t piccType;
+    uint32_t timestamp;
+    uint32_t sequence;          // 0 : absent
+    const char *device;         // nullptr : absent (identifiant de l'appareil)
+    const char *fields;         // "&nom=valeur..." du profil de lecture
+    const uint8_t *blocks;      // nullptr : pas d'image mémoire
+    uint16_t blockCount;
+    uint8_t blockSize;
+};
+
+// Enregistrement minimal : UID et champs (appels existants)
+ScanRecord scanRecord(const char *uid, const char *fields = "");
+// Longueur du corps écrit dans buf, 0 si le tampon est trop petit
+size_t scanPayloadEncode(const ScanRecord &scan, ApiEncoding encoding, uint8_t *buf, size_t size);
+const char *apiEncodingName(ApiEncoding encoding);
+bool apiEncodingFromName(const char *name, ApiEncoding &out);
+const char *apiEncodingContentType(ApiEncoding encoding);
@@ -0,0 +1,70 @@
+#pragma once
+/*
+ * Pipeline de scan étagé (mode lecture).
+ *
+ * handleRFIDOperations() ne fait plus que la capture : UID, type, décision
+ * locale et lecture mémoire, puis HLTA immédiatement. L'événement capturé
+ * passe par deux files SPSC bornées vers des étapes appelées depuis loop() :
+ *
+ *   capture -> [captured] -> envoi API -> [decided] -> retour buzzer + journal
+ *
+ * Une API lente ne retient donc plus la carte ni le lecteur : les cartes
+ * suivantes sont capturées pendant que les envois se vident. Chaque
+ * événement est ajouté à la boîte d'envoi persistante (upload_outbox.h) dès
+ * la capture, avant la file : file pleine, il est compté et part plus tard
+ * par les renvois de la boîte, qui rejoue ce que le serveur n'a pas
+ * acquitté. Avec MQTT (mqtt_client.h), l'envoi se réduit à une publication
+ * QoS 1 sur la session déjà ouverte ; elle ne rapporte aucune décision (et
+ * hors connexion n'est qu'en file), le retour reste donc neutre : le bip de
+ * prise en compte de la capture, sans motif de succès ni de refus. Avec une URL coap:// (coap_uplink.h),
+ * l'étape reprend à chaque passage jusqu'à l'ACK qui porte la décision. Le
+ * POST HTTP reste bloquant, mais le buzzer joue ses motifs depuis un
+ * Ticker : le bip en cours n'est pas figé.
+ *
+ * Décision en cache (decision_cache.h) : l'événement passe dans [decided]
+ * dès son arrivée, le retour buzzer part, et l'envoi a lieu au passage
+ * suivant ; sa réponse rafraîchit le cache sans second retour.
+ */
+#include <Arduino.h>
+#include <scanner.h>
+#include <metrics.h>
+
+#define SCAN_QUEUE_CAPACITY 8  // puissance de 2
+
+struct ScanEvent {
+    uint32_t id;                // lastScan.id
+    char uid[UID_HEX_MAX];
+    AclDecision decision;       // ACL_UNKNOWN : décision demandée à l'API
+    AclDecision cached;         // décision de l'API en cache : retour avant l'envoi
+    char fields[SCAN_FIELDS_MAXLEN];  // champs du profil de lecture, envoyés avec l'UID
+    uint8_t sak;
+    uint8_t piccType;           // MFRC522::PICC_Type
+    uint32_t timestamp;         // secondes depuis le démarrage à la capture
+    uint32_t sequence;          // séquence persistante (upload_outbox.h), fixée à la capture
+    bool apiSuccess;
+    bool published;             // confié à MQTT : aucune décision, pas de bip de succès
+    unsigned long capturedUs;   // fin de capture (HLTA imminent)
+    unsigned long decidedUs;    // fin de l'envoi API (décision en cache : avant l'envoi)
+};
+
+struct PipelineStats {
+    uint8_t capturedDepth;
+    uint8_t decidedDepth;
+    uint8_t capturedHighWater;
+    uint8_t decidedHighWater;
+    uint32_t drops;             // file pleine : laissés aux renvois de la boîte d'envoi
+    uint32_t completed;
+    uint32_t cachedFeedback;    // retours donnés depuis le cache, avant l'envoi
+    uint32_t published;         // publiés par MQTT, sans décision : retour neutre
+    Histogram uploadWait;       // capture -> début de l'envoi
+    Histogram feedbackWait;     // fin de l'envoi -> début du retour buzzer
+    Histogram endToEnd;         // capture -> retour buzzer
+};
+
+// Producteur : appelé par l'étape de capture du mode lecture ; ajoute
+// l'événement à la boîte d'envoi (event.sequence), false si la file est pleine
+bool scanPipelinePush(ScanEvent &event);
+// Consommateurs : une étape de chaque par appel, depuis loop()
+void scanPipelineLoop();
+bool scanPipelineIdle();
+const PipelineStats &scanPipelineStats();
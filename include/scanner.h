@@ -0,0 +1,106 @@
+#pragma once
+/*
+ * Lecture / écriture RFID : boucle de scan et opérations par mode.
+ *
+ * Chaque mode est décrit par une entrée de table (nom, message d'activation,
+ * suite d'étapes). handleRFIDOperations() détecte et sélectionne la carte
+ * puis déroule les étapes du mode courant : ajouter un mode revient à
+ * ajouter une valeur d'enum et une ligne de table.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <acl.h>
+#include <metrics.h>
+#include <read_profile.h>
+
+extern MFRC522 mfrc522;
+extern MFRC522::MIFARE_Key key;
+
+enum ScanMode : uint8_t {
+    MODE_READ,
+    MODE_WRITE,
+    MODE_FORMAT,
+    MODE_BACKUP,
+    MODE_RESTORE,
+    MODE_PROVISION,
+    MODE_COUNT
+};
+
+#define UID_HEX_MAX 21            // 10 octets d'UID en hexadécimal + '\0'
+#define LAST_CARD_INFO_SIZE 1024  // résumé HTML de la dernière carte
+#define CARD_TYPE_MAX 40          // nom de type MFRC522 le plus long + '\0'
+#define WRITE_DATA_MAX 48         // données brutes : blocs 4 à 6 (Classic), pages 4 à 15 (Ultralight)
+
+// Dernier scan : identifiant croissant depuis le démarrage (0 = aucun scan) ;
+// version avance aussi à la fin du scan, quand le résumé est complet
+struct LastScan {
+    uint32_t id;
+    uint32_t version;
+    char uid[UID_HEX_MAX];
+    char type[CARD_TYPE_MAX];
+};
+
+extern ScanMode mode;
+extern String dataToWrite;
+extern String restoreUid;
+extern bool continuousMode;
+extern char lastCardInfo[LAST_CARD_INFO_SIZE];
+extern LastScan lastScan;
+extern unsigned long lastScanTime;
+
+// === Pipeline de scan ===
+// État partagé par les étapes d'un scan, sur la pile de handleRFIDOperations()
+struct ScanContext {
+    MFRC522::PICC_Type piccType;
+    const __FlashStringHelper *typeName;
+    char uid[UID_HEX_MAX];
+    AclDecision decision;
+    AclDecision cached;                // décision de l'API en cache (decision_cache.h)
+    char fields[SCAN_FIELDS_MAXLEN];   // champs extraits par le profil de lecture
+};
+
+// Une étape renvoie false pour interrompre la suite du pipeline ; sa durée
+// est cumulée dans l'histogramme de l'étape de métrique associée.
+struct ScanStep {
+    bool (*run)(ScanContext &ctx);
+    MetricStage stage;
+};
+
+struct ScanModeInfo {
+    const char *name;          // commande série / API
+    const char *activated;     // message affiché à l'activation
+    bool needsArgument;        // WRITE <données>, RESTORE <uid>
+    const ScanStep *steps;
+    uint8_t stepCount;
+};
+
+const ScanModeInfo &scanModeInfo(ScanMode m);
+const char *scanModeName(ScanMode m);
+bool scanModeFromName(const char *name, ScanMode &out);
+void scanModeActivate(ScanMode m);
+// Commande sans argument (/api/command, MQTT) : mode, STOP ou INFO ; false si inconnue
+bool scanCommand(const char *cmd);
+// Résumé de la dernière carte : tampon fixe, tronqué s'il déborde
+void cardInfoClear();
+void cardInfoAppend(const char *text);
+void cardInfoAppend(const __FlashStringHelper *text);
+void cardInfoPrintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+void scannerBegin();
+void handleRFIDOperations();
+void appendCardDump();
+void writeCard();
+// Données brutes complétées de zéros jusqu'au bloc (ou à la page) suivant,
+// chaque écriture relue ; false au premier échec
+bool writePayload(MFRC522::PICC_Type type, const byte *data, size_t length);
+void formatCard();
+void backupCard();
+void restoreCard();
+void showSystemInfo();
+void printHex(byte *buffer, byte bufferSize);
+void printText(byte *buffer, byte bufferSize);
+void testRFIDModule();
+void blinkBuzzer(int times = 2, unsigned long duration = 100);
+// Motif joué par un Ticker, sans bloquer ni dépendre de loop()
+void buzzerStart(uint8_t times, uint16_t duration);
+bool buzzerBusy();
@@ -0,0 +1,62 @@
+#pragma once
+/*
+ * Bits d'accès MIFARE Classic : décodage du trailer et plan des opérations.
+ *
+ * Une authentification refusée coûte un timeout puis une re-sélection, une
+ * lecture ou écriture interdite un NAK, une re-sélection et une nouvelle
+ * authentification. Le trailer de chaque secteur est donc lu une fois (la
+ * clé A peut toujours lire les bits d'accès) et les droits décodés sont
+ * gardés en cache par UID : les opérations vouées à l'échec sont évitées,
+ * dès le premier passage pour les blocs interdits, aux scans suivants pour
+ * les secteurs dont la clé A est refusée.
+ *
+ * Le cache suppose la clé A par défaut (FF..FF) utilisée partout ailleurs.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+
+#define ACCESS_CACHE_SIZE    4         // UID mémorisés (LRU)
+#define ACCESS_SECTORS_MAX   40        // MIFARE Classic 4K
+#define ACCESS_CACHE_TTL_MS  600000UL  // trailers relus au-delà (cartes réencodées)
+
+// Clés autorisées pour une opération
+#define ACCESS_KEY_A 0x01
+#define ACCESS_KEY_B 0x02
+
+struct AccessStats {
+    uint32_t cacheHits;       // secteurs servis par le cache
+    uint32_t trailersRead;    // trailers lus et décodés
+    uint32_t invalidTrailers; // bits d'accès incohérents (secteur traité sans plan)
+    uint32_t skippedAuths;    // authentifications évitées (clé A déjà refusée)
+    uint32_t skippedReads;
+    uint32_t skippedWrites;
+    uint32_t failedAuths;     // refus constatés (et mémorisés)
+    uint32_t reselects;
+};
+
+// Bits C1C2C3 des 4 groupes d'un trailer (octets 6 à 8) ; false si les
+// copies inversées ne correspondent pas
+bool accessDecode(const byte *trailer, uint8_t groups[4]);
+// Clés autorisées (ACCESS_KEY_*) pour un bloc de données selon ses bits C1C2C3
+uint8_t accessReadKeys(uint8_t bits);
+uint8_t accessWriteKeys(uint8_t bits);
+
+// Ouvre un secteur avec la clé A : authentification sur le trailer et droits
+// pris dans le cache ou lus dans le trailer. false si le secteur est
+// inaccessible ; la carte a alors déjà été re-sélectionnée si nécessaire.
+bool accessOpenSector(MFRC522 &reader, MFRC522::MIFARE_Key &key, uint8_t sector);
+// Opération permise sur un bloc du secteur ouvert ? Sinon comptée comme évitée.
+bool accessAllows(uint16_t block, bool write);
+// Après un échec imprévu (NAK) : re-sélection et nouvelle ouverture du secteur
+bool accessRecover(MFRC522 &reader, MFRC522::MIFARE_Key &key, uint8_t sector);
+// Carte re-sélectionnée après une perte de session Crypto1
+bool accessReselect(MFRC522 &reader);
+void accessForget();
+
+uint8_t accessSectorOf(uint16_t block);
+uint16_t accessFirstBlock(uint8_t sector);
+uint8_t accessBlocksInSector(uint8_t sector);
+
+// false : toutes les opérations sont tentées à l'aveugle (comparaison)
+extern bool accessPlanning;
+const AccessStats &accessStats();
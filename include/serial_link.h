@@ -0,0 +1,57 @@
+#pragma once
+/*
+ * Port série : commandes texte et liaison binaire vers un hôte.
+ *
+ * serialLinkPoll() lit ce qui est déjà arrivé (SERIAL_LINK_POLL_BUDGET octets
+ * au plus) et rend la main aussitôt : plus de readStringUntil() qui bloquait
+ * loop() jusqu'à une seconde sur une ligne incomplète. En mode texte les
+ * octets s'accumulent dans un tampon fixe et chaque ligne complète est passée
+ * au gestionnaire de commandes de main.cpp.
+ *
+ * « BINARY [baud] » bascule en trames COBS/CRC-16 (link_frame.h), jusqu'à
+ * 921600 bauds : chaque scan capturé part en LINK_MSG_SCAN dès la capture,
+ * sa décision en LINK_MSG_RESULT au retour buzzer, et l'hôte pilote modes,
+ * état et images de cartes par commandes typées, chacune acquittée. Tous
+ * les journaux émis après setup() (scan, écriture, liste d'accès, MQTT,
+ * boîte d'envoi, réglage RF, OTA...) passent par serialLog() et se taisent
+ * en mode binaire : aucun texte ne s'intercale entre les trames. Seuls
+ * setup() et les réponses aux commandes texte écrivent directement sur
+ * Serial, le mode binaire ne pouvant pas encore être actif.
+ * LINK_CMD_TEXT (ou un redémarrage) ramène au mode texte à 115200 bauds.
+ *
+ * Outil hôte Linux : tools/rfid_link.cpp.
+ */
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <link_frame.h>
+
+#define SERIAL_LINK_TEXT_BAUD    115200
+#define SERIAL_LINK_LINE_MAX     160     // ligne de commande texte
+#define SERIAL_LINK_POLL_BUDGET  256     // octets traités par appel
+
+struct ScanEvent;
+
+struct SerialLinkStats {
+    bool binary;
+    uint32_t baud;
+    uint32_t lines;             // commandes texte reçues
+    uint32_t linesTruncated;    // lignes plus longues que SERIAL_LINK_LINE_MAX
+    uint32_t framesIn;
+    uint32_t framesOut;
+    uint32_t crcErrors;
+    uint32_t framingErrors;
+    uint32_t bytesOut;          // octets de trames émis
+};
+
+// Gestionnaire d'une ligne de commande texte (sans le '\n')
+typedef void (*SerialLineHandler)(String &line);
+
+void serialLinkBegin(SerialLineHandler onLine);
+void serialLinkPoll();
+bool serialLinkBinary();
+// Événements du pipeline de scan ; sans effet en mode texte
+void serialLinkSendScan(const ScanEvent &event, MFRC522::PICC_Type type, const byte *uid, byte uidSize);
+void serialLinkSendResult(const ScanEvent &event, unsigned long feedbackUs);
+const SerialLinkStats &serialLinkStats();
+// Journal d'exécution : Serial en mode texte, sortie muette en mode binaire
+Stream &serialLog();
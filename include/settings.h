@@ -0,0 +1,55 @@
+#pragma once
+/*
+ * Paramètres persistants (journal LittleFS) et état réseau partagé entre modules.
+ *
+ * Les save*() mettent à jour la RAM et ajoutent un enregistrement au journal ;
+ * settingsLoop() compacte le journal en instantané quand il devient trop long.
+ */
+#include <Arduino.h>
+
+extern String apiUrl;
+extern uint8_t apiEncoding;      // corps des envois, ApiEncoding (scan_payload.h)
+extern String wifiSsid;
+extern String wifiPass;
+extern unsigned long scanDelayMs;
+extern String webAccessCode;
+extern bool readMemoryEnabled;
+extern String readProfileName;   // profil de lecture actif (read_profile.h)
+extern uint8_t rfGain;           // réglages RF du RC522 (rf_tuning.h)
+extern uint16_t rfTimerReload;
+extern bool rfAutoTune;
+extern bool mqttEnabled;         // scans publiés par MQTT (mqtt_client.h)
+extern String mqttHost;
+extern uint16_t mqttPort;
+extern String mqttUser;
+extern String mqttPass;
+extern String mqttTopic;         // préfixe des sujets, vide : rfid/<client>
+
+extern bool otaEnabled;
+extern bool wifiConnected;
+extern bool otaInProgress;
+
+struct ConfigStats {
+    uint32_t journalBytes;
+    uint32_t journalRecords;
+    uint32_t appends;
+    uint32_t compactions;
+    uint32_t lastCommitUs;      // dernier ajout au journal (ou compaction forcée)
+    uint32_t lastCompactionUs;
+    uint32_t loadUs;            // chargement au démarrage (instantané + rejeu)
+};
+
+void loadSettings();
+bool flushSettings();
+void settingsLoop();
+const ConfigStats &settingsStats();
+void saveApiUrl(const String& url);
+void saveApiEncoding(uint8_t encoding);
+void saveWifiConfig(const String& ssid, const String& pass);
+void saveScanDelay(unsigned long val);
+void saveWebAccessCode(const String& code);
+void saveReadMemoryEnabled(bool enabled);
+void saveReadProfile(const String& name);
+void saveRfTuning(uint8_t gain, uint16_t timerReload, bool autoTune);
+void saveMqttConfig(bool enabled, const String& host, uint16_t port, const String& user, const String& pass,
+                    const String& topic);
@@ -0,0 +1,47 @@
+#pragma once
+/*
+ * File bornée à un producteur et un consommateur (SPSC), sans allocation.
+ *
+ * Le producteur ne modifie que head, le consommateur que tail : aucune
+ * section critique n'est nécessaire tant que chaque côté reste unique.
+ * La capacité N est une puissance de 2, les index tournent librement sur
+ * 8 bits et size() = head - tail.
+ */
+#include <Arduino.h>
+
+template <typename T, uint8_t N>
+class SpscQueue {
+    static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "Capacité : puissance de 2, 128 au plus");
+
+public:
+    // Producteur : false (et une perte comptée) si la file est pleine
+    bool push(const T &item) {
+        if (full()) {
+            drops++;
+            return false;
+        }
+        items[head & (N - 1)] = item;
+        head = head + 1;
+        if (size() > highWater) highWater = size();
+        return true;
+    }
+
+    // Consommateur : élément le plus ancien, laissé en place jusqu'à pop()
+    T *front() { return empty() ? nullptr : &items[tail & (N - 1)]; }
+    void pop() {
+        if (!empty()) tail = tail + 1;
+    }
+
+    uint8_t size() const { return (uint8_t)(head - tail); }
+    bool empty() const { return head == tail; }
+    bool full() const { return size() == N; }
+    static constexpr uint8_t capacity() { return N; }
+
+    uint32_t drops = 0;
+    uint8_t highWater = 0;
+
+private:
+    T items[N];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+/*
+ * Boîte d'envoi persistante des scans : chaque événement est traité une seule
+ * fois par le serveur, même après une coupure réseau ou un redémarrage.
+ *
+ * Chaque événement reçoit un numéro de séquence croissant qui survit aux
+ * redémarrages ; avec l'identifiant de l'appareil (deviceId()), il forme la
+ * clé d'idempotence envoyée dans le corps (« device » et « scan », clés CBOR
+ * 8 et 4) et dans l'en-tête HTTP Idempotency-Key. Un renvoi réutilise la même
+ * clé : le serveur reconnaît le doublon et ne le traite pas une seconde fois.
+ *
+ * Avant son premier envoi, l'événement est ajouté à /outbox/events.bin
+ * (enregistrement fixe protégé par CRC, fichier gardé ouvert : un ajout coûte
+ * une page programmée et un commit, sans allocation). Un code 2xx à 4xx, une
+ * réponse CoAP ou un PUBACK l'acquitte ; un échec réseau, un 5xx, un 408 ou
+ * un 429 le laisse en attente. outboxLoop() rejoue alors le plus ancien non acquitté, avec un
+ * délai doublé à chaque échec, quand le pipeline est au repos. Les événements
+ * acquittés hors ordre ne sont pas renvoyés.
+ *
+ * /outbox/state.bin garde deux valeurs, réécrites rarement :
+ *   plafond   numéros réservés par blocs de OUTBOX_SEQ_BLOCK ; au démarrage,
+ *             la séquence reprend au plafond (jamais un numéro déjà utilisé)
+ *   filigrane plus grand numéro dont tous les précédents sont acquittés,
+ *             écrit au plus toutes les OUTBOX_STATE_FLUSH_MS, et seulement
+ *             si plusieurs acquittés restent dans le fichier ; un événement
+ *             acquitté mais pas encore couvert est renvoyé après un
+ *             redémarrage, et dédoublonné par le serveur
+ * Tout acquitté, le fichier d'événements est vidé au prochain ajout ; sinon
+ * outboxLoop() le compacte une fois OUTBOX_COMPACT_RECORDS enregistrements
+ * morts en tête. outboxLoop() tourne à chaque loop(), WiFi ou non : hors
+ * ligne il ne renvoie rien mais compacte toujours, et un ajout qui trouve le
+ * fichier plein compacte lui-même avant d'écrire.
+ *
+ * Les décisions de la liste d'accès locale passent par la même boîte : leur
+ * audit n'est plus une file en RAM perdue au redémarrage.
+ */
+#include <Arduino.h>
+#include <scan_payload.h>
+
+#define OUTBOX_DIR             "/outbox"
+#define OUTBOX_EVENTS_PATH     OUTBOX_DIR "/events.bin"
+#define OUTBOX_EVENTS_NEW      OUTBOX_DIR "/events.new"
+#define OUTBOX_STATE_PATH      OUTBOX_DIR "/state.bin"
+#define OUTBOX_CAPACITY        128     // événements non acquittés (au-delà, le plus ancien est abandonné)
+#define OUTBOX_FILE_MAX        (2 * OUTBOX_CAPACITY)  // enregistrements du fichier, morts compris
+#define OUTBOX_COMPACT_RECORDS 32      // enregistrements acquittés en tête avant compaction
+#define OUTBOX_SEQ_BLOCK       256     // numéros réservés par écriture de l'état
+#define OUTBOX_STATE_FLUSH_MS  5000
+#define OUTBOX_RETRY_MIN_MS    1000    // délai de renvoi, doublé jusqu'au maximum
+#define OUTBOX_RETRY_MAX_MS    60000
+#define DEVICE_ID_MAXLEN       32
+
+struct OutboxStats {
+    uint32_t nextSequence;
+    uint32_t watermark;         // tous les numéros <= filigrane sont acquittés
+    uint16_t pending;           // événements non acquittés
+    uint16_t fileRecords;       // enregistrements du fichier, acquittés compris
+    uint32_t appended;
+    uint32_t acked;
+    uint32_t replayed;          // renvois depuis la boîte (même clé d'idempotence)
+    uint32_t failures;          // envois sans acquittement (réseau, 5xx)
+    uint32_t dropped;           // boîte pleine : plus ancien abandonné
+    uint32_t notDurable;        // ajout impossible : envoyé sans copie en flash
+    uint32_t stateWrites;       // écritures de state.bin (plafond ou filigrane)
+    uint32_t compactions;
+    uint32_t recovered;         // en attente trouvés au démarrage
+};
+
+// Identifiant stable de l'appareil (HOSTNAME-<chipId>), aussi client MQTT
+const char *deviceId();
+void outboxBegin();
+// Ajout avant le premier envoi : numéro de séquence et identifiant placés dans
+// scan ; false si l'événement n'a pas pu être écrit (il reste envoyé)
+bool outboxAppend(ScanRecord &scan);
+// Résultat d'un envoi : code HTTP (ou équivalent CoAP), négatif si échec réseau
+void outboxResult(uint32_t sequence, int code);
+void outboxAck(uint32_t sequence);
+// Renvois, filigrane, réserve de séquence et compaction, hors du chemin de scan
+void outboxLoop();
+const OutboxStats &outboxStats();
+String outboxStatusJson();
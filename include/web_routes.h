@@ -0,0 +1,13 @@
+#pragma once
+/*
+ * Serveur web : interface, portail captif et routes /api.
+ */
+#include <ESP8266WebServer.h>
+
+extern ESP8266WebServer webServer;
+
+void setupWebServer();
+// handleClient() + mesure de la durée de la requête traitée
+void webServerLoop();
+// Route /update, fournie par chaque cible (Updater sur l'ESP8266)
+void setupUpdateRoute();
@@ -71,6 +71,8 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 <p><strong>Mémoire libre:</strong> <span id='memory'>Chargement...</span></p>
                 <p><strong>Uptime:</strong> <span id='uptime'>Chargement...</span></p>
                 <p><strong>Signal WiFi:</strong> <span id='rssi'>Chargement...</span></p>
+                <p><strong>File de scan:</strong> <span id='queue'>Chargement...</span></p>
+                <p><strong>Module RC522:</strong> <span id='rc522'>Chargement...</span></p>
             </div>
             <div id='cardInfo' class='status' style='display:none'>
                 <h3>💳 Dernière carte détectée</h3>
@@ -87,6 +89,11 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 </div>
                 <div class='form-row'>
                     <input type='text' id='writeData' placeholder='Données à écrire'>
+                    <select id='writeFormat'>
+                        <option value=''>Brut (bloc 4)</option>
+                        <option value='uri'>NDEF URI</option>
+                        <option value='text'>NDEF texte</option>
+                    </select>
                     <button class='button' onclick='writeData()'>✏️ Écrire</button>
                 </div>
             </div>
@@ -95,6 +102,15 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 <label for='readMemorySwitch'>Lecture mémoire activée :</label>
                 <input type='checkbox' id='readMemorySwitch' onchange='saveReadMemory()'>
                 <span id='readMemoryStatus'></span>
+                <div class='form-row'>
+                    <label for='readProfile'>Profil de lecture :</label>
+                    <select id='readProfile' onchange='saveReadProfile()'></select>
+                    <span id='readProfileStatus'></span>
+                </div>
+                <div id='readProfileTimes' style='font-size:12px;'></div>
+                <textarea id='readProfileText' rows='4' style='width:100%; font-family:monospace;'
+                    placeholder='badge|S2|employe=B8+0/8/ascii,site=B9+4/2/u16be'></textarea>
+                <button class='button' onclick='saveReadProfiles()'>💾 Enregistrer les profils</button>
             </div>
             <div class='info'>
                 <h3>⏱️ Délai entre scans RFID</h3>
@@ -105,6 +121,34 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 </div>
                 <span id='scanDelayStatus'></span>
             </div>
+            <div class='info'>
+                <h3>💾 Images de cartes</h3>
+                <div class='inline-group'>
+                    <button class='button' onclick='sendCommand("BACKUP")'>💾 Sauvegarder une carte</button>
+                    <button class='button' onclick='loadImages()'>🔄 Actualiser</button>
+                </div>
+                <div id='imageList'></div>
+                <div class='form-row'>
+                    <input type='file' id='imageFile' accept='.img,.mfd,.bin'>
+                    <button class='button' onclick='uploadImage()'>📤 Envoyer</button>
+                </div>
+                <span id='imageStatus'></span>
+            </div>
+            <div class='info'>
+                <h3>🏭 Encodage en série</h3>
+                <p><span id='provision'>Aucune file</span></p>
+                <div class='form-row'>
+                    <input type='file' id='provisionFile' accept='.csv,.txt,.json'>
+                    <button class='button' onclick='uploadProvisionQueue()'>📤 Charger la file</button>
+                </div>
+                <div class='inline-group'>
+                    <button class='button' onclick='sendCommand("PROVISION")'>▶️ Démarrer</button>
+                    <button class='button' onclick='sendCommand("READ")'>⏹️ Terminer</button>
+                    <a class='button' href='/api/provision/log'>📄 Journal</a>
+                    <button class='button danger' onclick='resetProvision()'>🗑️ Effacer</button>
+                </div>
+                <span id='provisionStatus'></span>
+            </div>
         </div>
         <div class='tab-content' id='tab-config'>
             <div class='info'>
@@ -115,6 +159,45 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 </div>
                 <button class='button' onclick='saveApiUrl()'>💾 Enregistrer URL</button>
                 <span id='apiUrlStatus'></span>
+                <div class='form-group'>
+                    <label for='apiEncoding'>Corps des envois :</label>
+                    <select id='apiEncoding' onchange='saveApiEncoding()'>
+                        <option value='form'>form-urlencoded</option>
+                        <option value='cbor'>CBOR (binaire compact)</option>
+                    </select>
+                    <span id='apiEncodingStatus'></span>
+                </div>
+            </div>
+            <div class='info'>
+                <h3>📨 Transport MQTT</h3>
+                <label for='mqttEnabled'>Scans publiés par MQTT :</label>
+                <input type='checkbox' id='mqttEnabled'>
+                <div class='form-group'>
+                    <label for='mqttHost'>Broker :</label>
+                    <input type='text' id='mqttHost' placeholder='broker.local'>
+                    <input type='number' id='mqttPort' min='1' max='65535' value='1883' style='width:90px;'>
+                </div>
+                <div class='form-group'>
+                    <label for='mqttUser'>Utilisateur / mot de passe :</label>
+                    <input type='text' id='mqttUser' placeholder='(aucun)'>
+                    <input type='password' id='mqttPass' placeholder='inchangé'>
+                </div>
+                <div class='form-group'>
+                    <label for='mqttTopic'>Préfixe des sujets :</label>
+                    <input type='text' id='mqttTopic' placeholder='rfid/<identifiant>'>
+                </div>
+                <button class='button' onclick='saveMqtt()'>💾 Enregistrer</button>
+                <div id='mqttStatus'></div>
+            </div>
+            <div class='info'>
+                <h3>🛂 Liste d'accès locale</h3>
+                <div class='form-group'>
+                    <label for='aclSource'>URL de synchronisation :</label>
+                    <input type='text' id='aclSource' placeholder='http://serveur/acl'>
+                </div>
+                <button class='button' onclick='saveAclSource()'>💾 Enregistrer</button>
+                <button class='button' onclick='syncAcl()'>🔄 Synchroniser</button>
+                <div id='aclStatus'></div>
             </div>
             <div class='info'>
                 <h3>🔑 Configuration WiFi</h3>
@@ -205,8 +288,9 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
         }
         function writeData() {
             const data = document.getElementById('writeData').value;
+            const format = document.getElementById('writeFormat').value;
             if (data) {
-                fetch('/api/write?data=' + encodeURIComponent(data))
+                fetch('/api/write?data=' + encodeURIComponent(data) + (format ? '&ndef=' + format : ''))
                     .then(response => response.text())
                     .then(data => {
                         alert('Mode écriture activé: ' + data);
@@ -229,36 +313,69 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
         function getCurrentWebCode() {
             return document.getElementById('webCode').textContent;
         }
-        function updateCardInfo() {
-            const code = getCurrentWebCode();
-            fetch('/api/lastcard?code=' + encodeURIComponent(code))
-                .then(response => response.text())
+        // Tableau de bord : une seule requête, seules les sections modifiées
+        // depuis les versions connues sont renvoyées (304 sinon). Le serveur
+        // garde la requête jusqu'au prochain changement.
+        const dash = {s: null, c: null, l: null, log: []};
+        function pollDashboard() {
+            let url = '/api/dashboard?code=' + encodeURIComponent(getCurrentWebCode());
+            if (dash.s !== null) url += '&s=' + dash.s + '&c=' + dash.c + '&l=' + dash.l + '&wait=25000';
+            fetch(url, {cache: 'no-store'})
+                .then(response => response.status === 304 ? null : response.json())
                 .then(data => {
-                    document.getElementById('cardDetails').innerHTML = data;
-                    document.getElementById('cardInfo').style.display = (data && data !== 'Aucune carte') ? '' : 'none';
-                });
+                    if (data) applyDashboard(data);
+                    pollDashboard();
+                })
+                .catch(() => setTimeout(pollDashboard, 2000));
+        }
+        function applyDashboard(data) {
+            if (data.s) {
+                dash.s = data.s.v;
+                showStatus(data.s);
+            }
+            if (data.c) {
+                dash.c = data.c.v;
+                if (data.c.id) {
+                    document.getElementById('cardDetails').innerHTML = data.c.details;
+                    document.getElementById('cardInfo').style.display = '';
+                }
+            }
+            if (data.l) {
+                dash.l = data.l.v;
+                dash.log = (data.l.full ? data.l.entries : dash.log.concat(data.l.entries)).slice(-32);
+                showApiLog(dash.log);
+            }
+        }
+        function showStatus(data) {
+            document.getElementById('mode').textContent = data.mode;
+            document.getElementById('memory').textContent = data.memory + ' bytes';
+            document.getElementById('uptime').textContent = formatUptime(data.uptime);
+            document.getElementById('rssi').textContent = data.rssi + ' dBm';
+            document.getElementById('queue').textContent = data.queue + ' en attente, ' + data.drops + ' perdus';
+            const rc = data.rc522;
+            let health = rc.ok ? '✅ OK' : '❌ Hors service';
+            health += ', ' + rc.recoveries + ' reprise(s)';
+            if (rc.lastFaultAt >= 0) {
+                health += ', dernier défaut: ' + rc.lastFault + ' à ' + formatUptime(rc.lastFaultAt);
+            }
+            document.getElementById('rc522').textContent = health;
+            const p = data.provision;
+            document.getElementById('provision').textContent = p.queued ?
+                p.next + '/' + p.queued + ' cartes, ' + p.perHour + ' cartes/h, ' + p.failures + ' échec(s), ' +
+                p.rejected + ' refusée(s)' : 'Aucune file';
+        }
+        function showApiLog(data) {
+            let html = '';
+            data.forEach(entry => {
+                html += '[' + entry.t + 's] UID=' + entry.uid + '  HTTP=' + entry.code + '<br>URL: ' + entry.url + '<br>';
+            });
+            document.getElementById('apiTerminal').innerHTML = html || '<i>Aucun envoi enregistré</i>';
         }
         function updateStatus() {
             const code = getCurrentWebCode();
             fetch('/api/status?code=' + encodeURIComponent(code))
                 .then(response => response.json())
-                .then(data => {
-                    document.getElementById('mode').textContent = data.mode;
-                    document.getElementById('memory').textContent = data.memory + ' bytes';
-                    document.getElementById('uptime').textContent = formatUptime(data.uptime);
-                    document.getElementById('rssi').textContent = data.rssi + ' dBm';
-                });
-        }
-        function updateApiTerminal() {
-            fetch('/api/apilog')
-                .then(response => response.json())
-                .then(data => {
-                    let html = '';
-                    data.forEach(entry => {
-                        html += '[' + entry.t + 's] UID=' + entry.uid + '  HTTP=' + entry.code + '<br>URL: ' + entry.url + '<br>';
-                    });
-                    document.getElementById('apiTerminal').innerHTML = html || '<i>Aucun envoi enregistré</i>';
-                });
+                .then(showStatus);
         }
         function buzzerTest() {
             const times = document.getElementById('buzzerTimes').value;
@@ -288,6 +405,77 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 setTimeout(()=>{document.getElementById('apiUrlStatus').textContent='';}, 2000);
             });
         }
+        function loadApiEncoding() {
+            fetch('/api/encoding')
+                .then(response => response.text())
+                .then(data => {
+                    document.getElementById('apiEncoding').value = data;
+                });
+        }
+        function saveApiEncoding() {
+            const encoding = document.getElementById('apiEncoding').value;
+            fetch('/api/encoding', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'encoding=' + encoding
+            })
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('apiEncodingStatus').textContent = 'Encodage enregistré!';
+                setTimeout(()=>{document.getElementById('apiEncodingStatus').textContent='';}, 2000);
+            });
+        }
+        function loadAcl() {
+            fetch('/api/acl')
+                .then(response => response.json())
+                .then(acl => {
+                    document.getElementById('aclSource').value = acl.source;
+                    document.getElementById('aclStatus').textContent = 'Version ' + acl.version + ' : ' + acl.count +
+                        ' UID, recherche ' + acl.lastLookupUs + ' µs (max ' + acl.maxLookupUs + ' µs), dernière synchro : ' + acl.lastSyncCode;
+                });
+        }
+        function saveAclSource() {
+            const url = document.getElementById('aclSource').value;
+            fetch('/api/acl/source', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'url=' + encodeURIComponent(url)
+            })
+            .then(() => setTimeout(loadAcl, 2000));
+        }
+        function syncAcl() {
+            fetch('/api/acl/sync', { method: 'POST' })
+                .then(() => setTimeout(loadAcl, 2000));
+        }
+        function loadMqtt() {
+            fetch('/api/mqtt')
+                .then(response => response.json())
+                .then(mqtt => {
+                    document.getElementById('mqttEnabled').checked = mqtt.enabled;
+                    document.getElementById('mqttHost').value = mqtt.host;
+                    document.getElementById('mqttPort').value = mqtt.port;
+                    document.getElementById('mqttUser').value = mqtt.user;
+                    document.getElementById('mqttTopic').value = mqtt.topic;
+                    document.getElementById('mqttStatus').textContent = (mqtt.connected ? 'Connecté' : 'Déconnecté') +
+                        ' (' + mqtt.prefix + ') : ' + mqtt.published + ' publiés, ' + mqtt.acked + ' acquittés, ' +
+                        mqtt.inflight + ' en attente, dernier PUBACK ' + (mqtt.lastAckUs / 1000).toFixed(1) + ' ms';
+                });
+        }
+        function saveMqtt() {
+            let body = 'enabled=' + (document.getElementById('mqttEnabled').checked ? '1' : '0');
+            ['host', 'port', 'user', 'topic'].forEach(name => {
+                const id = 'mqtt' + name.charAt(0).toUpperCase() + name.slice(1);
+                body += '&' + name + '=' + encodeURIComponent(document.getElementById(id).value);
+            });
+            const pass = document.getElementById('mqttPass').value;
+            if (pass) body += '&pass=' + encodeURIComponent(pass);
+            fetch('/api/mqtt', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: body
+            })
+            .then(() => setTimeout(loadMqtt, 2000));
+        }
         function loadWifiConfig() {
             fetch('/api/wificonfig')
                 .then(response => response.json())
@@ -382,6 +570,117 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 setTimeout(()=>{document.getElementById('readMemoryStatus').textContent='';}, 2000);
             });
         }
+        function loadReadProfiles() {
+            fetch('/api/profiles')
+                .then(response => response.json())
+                .then(data => {
+                    let options = '';
+                    let times = '';
+                    data.profiles.forEach(p => {
+                        options += '<option value="' + p.name + '"' + (p.name === data.active ? ' selected' : '') + '>' +
+                            p.name + (p.units ? ' (' + p.units + ' zones, ' + p.fields + ' champs)' : '') + '</option>';
+                        if (p.reads) {
+                            times += p.name + ' : ' + p.reads + ' lectures, moyenne ' + (p.meanUs / 1000).toFixed(1) +
+                                ' ms, max ' + (p.maxUs / 1000).toFixed(1) + ' ms' +
+                                (p.failures ? ', ' + p.failures + ' incomplètes' : '') + '<br/>';
+                        }
+                    });
+                    document.getElementById('readProfile').innerHTML = options;
+                    document.getElementById('readProfileTimes').innerHTML = times;
+                });
+            fetch('/api/profiles?text=1')
+                .then(response => response.text())
+                .then(text => { document.getElementById('readProfileText').value = text; });
+        }
+        function saveReadProfile() {
+            fetch('/api/profile', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'name=' + encodeURIComponent(document.getElementById('readProfile').value)
+            })
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('readProfileStatus').textContent = data === 'OK' ? 'Profil sélectionné!' : data;
+                setTimeout(()=>{document.getElementById('readProfileStatus').textContent='';}, 2000);
+            });
+        }
+        function saveReadProfiles() {
+            fetch('/api/profiles', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'text=' + encodeURIComponent(document.getElementById('readProfileText').value)
+            })
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('readProfileStatus').textContent = data === 'OK' ? 'Profils enregistrés!' : data;
+                loadReadProfiles();
+            });
+        }
+        function loadImages() {
+            fetch('/api/images')
+                .then(response => response.json())
+                .then(images => {
+                    let html = images.length ? '' : '<i>Aucune image enregistrée</i>';
+                    images.forEach(img => {
+                        html += '<div class="form-row"><b>' + img.uid + '</b> ' + img.type + ' (' + img.valid + '/' + img.blocks + ' blocs) ' +
+                            '<a href="/api/image?uid=' + img.uid + '">.img</a> ' +
+                            '<a href="/api/image?uid=' + img.uid + '&format=mfd">.mfd</a> ' +
+                            '<button class="button" onclick="restoreImage(\'' + img.uid + '\')">♻️ Restaurer</button>' +
+                            '<button class="button" onclick="deleteImage(\'' + img.uid + '\')">🗑️</button></div>';
+                    });
+                    document.getElementById('imageList').innerHTML = html;
+                });
+        }
+        function restoreImage(uid) {
+            fetch('/api/restore', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'uid=' + uid
+            })
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('imageStatus').textContent = data;
+                updateStatus();
+            });
+        }
+        function deleteImage(uid) {
+            if (!confirm('Supprimer l\'image ' + uid + ' ?')) return;
+            fetch('/api/image/delete', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'uid=' + uid
+            })
+            .then(() => loadImages());
+        }
+        function uploadImage() {
+            const file = document.getElementById('imageFile').files[0];
+            if (!file) return;
+            const form = new FormData();
+            form.append('image', file);
+            fetch('/api/image', { method: 'POST', body: form })
+                .then(response => response.text())
+                .then(data => {
+                    document.getElementById('imageStatus').textContent = 'Image importée: ' + data;
+                    loadImages();
+                });
+        }
+        function uploadProvisionQueue() {
+            const file = document.getElementById('provisionFile').files[0];
+            if (!file) return;
+            const form = new FormData();
+            form.append('queue', file);
+            fetch('/api/provision/queue', { method: 'POST', body: form })
+                .then(response => response.text())
+                .then(data => {
+                    document.getElementById('provisionStatus').textContent = data;
+                    updateStatus();
+                });
+        }
+        function resetProvision() {
+            if (!confirm('Effacer la file, le journal et les cartes déjà encodées ?')) return;
+            fetch('/api/provision/reset', { method: 'POST' })
+                .then(() => updateStatus());
+        }
         function loadWebCode() {
             fetch('/api/webcode')
                 .then(response => response.text())
@@ -410,16 +709,16 @@ const char WEB_PAGE[] PROGMEM = R"rawliteral(
                 .then(() => { /* la page va se recharger automatiquement */ });
         }
         loadApiUrl();
+        loadApiEncoding();
+        loadAcl();
+        loadMqtt();
         loadWifiConfig();
         loadScanDelay();
         loadWebCode();
         loadReadMemory();
-        setInterval(updateStatus, 5000);
-        setInterval(updateCardInfo, 2000);
-        setInterval(updateApiTerminal, 2000);
-        updateStatus();
-        updateCardInfo();
-        updateApiTerminal();
+        loadReadProfiles();
+        loadImages();
+        pollDashboard();
     </script>
 </body>
 </html>
@@ -0,0 +1,527 @@
+/*
+ * Liste d'accès locale : recherche Bloom + index creux, synchronisation delta
+ */
+#include <acl.h>
+#include <LittleFS.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <serial_link.h>
+
+struct AclFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+static uint8_t *aclBloom = nullptr;         // dimensionné au chargement
+static uint32_t aclBloomBits = 0;
+static uint8_t aclBloomHashes = 0;
+static uint8_t *aclFences = nullptr;        // première clé de chaque bloc
+static uint32_t aclFenceCount = 0;
+static AclEntry aclChunk[ACL_FENCE_STRIDE];
+static File aclFile;                        // gardé ouvert entre deux scans
+static AclStats stats;
+static String sourceUrl;
+static bool forceFull = false;              // base du delta inconnue du serveur
+
+// === Clés et filtre de Bloom ===
+static void makeKey(const byte *uid, byte uidSize, uint8_t *key) {
+    memset(key, 0, ACL_KEY_SIZE);
+    memcpy(key, uid, min(uidSize, (byte)10));
+    key[10] = uidSize;
+}
+
+static int compareKey(const uint8_t *a, const uint8_t *b) {
+    return memcmp(a, b, ACL_KEY_SIZE);
+}
+
+static uint32_t fnv1a(const uint8_t *data, size_t len, uint32_t hash) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// Double hachage : h1 + i*h2 pour les aclBloomHashes positions
+static bool bloomAccess(const uint8_t *key, bool add) {
+    uint32_t h1 = fnv1a(key, ACL_KEY_SIZE, 2166136261UL);
+    uint32_t h2 = fnv1a(key, ACL_KEY_SIZE, 0x9747B28CUL) | 1;
+    for (uint8_t i = 0; i < aclBloomHashes; i++) {
+        uint32_t bit = (h1 + i * h2) % aclBloomBits;
+        if (add) {
+            aclBloom[bit >> 3] |= (1 << (bit & 7));
+        } else if (!(aclBloom[bit >> 3] & (1 << (bit & 7)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Taux de faux positifs attendu : (1 - e^(-k n / m))^k
+static float bloomFpp() {
+    if (!stats.count || !aclBloomBits) return 0;
+    return powf(1 - expf(-(float)aclBloomHashes * stats.count / aclBloomBits), aclBloomHashes);
+}
+
+// ACL_BLOOM_BITS_PER_UID bits par UID, borné par le tas ; k optimal pour la taille obtenue
+static bool bloomAllocate(uint32_t count) {
+    uint32_t bytes = (count * ACL_BLOOM_BITS_PER_UID + 7) / 8;
+    uint32_t heap = ESP.getMaxFreeBlockSize();
+    uint32_t room = heap > ACL_HEAP_RESERVE ? heap - ACL_HEAP_RESERVE : 0;
+    bytes = min(bytes, min((uint32_t)ACL_BLOOM_MAX_BYTES, room));
+    bytes = max(bytes, (uint32_t)ACL_BLOOM_MIN_BYTES);
+    aclBloom = (uint8_t *)calloc(bytes, 1);
+    if (!aclBloom) return false;
+    aclBloomBits = bytes * 8;
+    float bitsPerUid = count ? (float)aclBloomBits / count : ACL_BLOOM_BITS_PER_UID;
+    aclBloomHashes = constrain((int)(bitsPerUid * 0.693f + 0.5f), 1, ACL_BLOOM_HASHES_MAX);
+    stats.bloomBytes = bytes;
+    stats.bloomHashes = aclBloomHashes;
+    return true;
+}
+
+// === Chargement de la liste ===
+static bool loadIndex() {
+    if (aclFile) aclFile.close();
+    free(aclFences);
+    aclFences = nullptr;
+    aclFenceCount = 0;
+    free(aclBloom);
+    aclBloom = nullptr;
+    aclBloomBits = 0;
+    stats.version = 0;
+    stats.count = 0;
+    stats.bloomBytes = 0;
+    stats.bloomHashes = 0;
+
+    File f = LittleFS.open(ACL_LIST_PATH, "r");
+    if (!f) return false;
+    AclFileHeader header;
+    if (f.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != ACL_MAGIC ||
+        f.size() != sizeof(header) + header.count * sizeof(AclEntry)) {
+        serialLog().println("[ACL] Liste locale invalide, ignorée");
+        f.close();
+        return false;
+    }
+    uint32_t fenceCount = (header.count + ACL_FENCE_STRIDE - 1) / ACL_FENCE_STRIDE;
+    if (fenceCount > 0) {
+        aclFences = (uint8_t *)malloc(fenceCount * ACL_KEY_SIZE);
+        if (!aclFences) {
+            serialLog().println("[ACL] Mémoire insuffisante pour l'index");
+            f.close();
+            return false;
+        }
+    }
+    // Après l'index creux : le filtre prend ce qui reste du tas, réserve déduite
+    if (!bloomAllocate(header.count)) {
+        serialLog().println("[ACL] Mémoire insuffisante pour le filtre de Bloom");
+        free(aclFences);
+        aclFences = nullptr;
+        f.close();
+        return false;
+    }
+    for (uint32_t block = 0; block < fenceCount; block++) {
+        uint32_t n = min((uint32_t)ACL_FENCE_STRIDE, header.count - block * ACL_FENCE_STRIDE);
+        f.read((uint8_t *)aclChunk, n * sizeof(AclEntry));
+        memcpy(aclFences + block * ACL_KEY_SIZE, aclChunk[0].uid, ACL_KEY_SIZE);
+        for (uint32_t i = 0; i < n; i++) bloomAccess(aclChunk[i].uid, true);
+        yield();
+    }
+    aclFenceCount = fenceCount;
+    aclFile = f;
+    stats.version = header.version;
+    stats.count = header.count;
+    serialLog().printf("[ACL] Liste v%u chargée: %u UID, filtre %u octets, k=%u (%.1f %% de faux positifs)\n",
+                       stats.version, stats.count, stats.bloomBytes, aclBloomHashes, bloomFpp() * 100);
+    return true;
+}
+
+bool aclBegin() {
+    File src = LittleFS.open(ACL_SOURCE_PATH, "r");
+    if (src) {
+        sourceUrl = src.readStringUntil('\n');
+        sourceUrl.trim();
+        src.close();
+    }
+    return loadIndex();
+}
+
+AclDecision aclLookup(const byte *uid, byte uidSize) {
+    if (!aclFile || stats.count == 0) return ACL_UNKNOWN;
+    unsigned long start = micros();
+    stats.lookups++;
+    uint8_t key[ACL_KEY_SIZE];
+    makeKey(uid, uidSize, key);
+    AclDecision result = ACL_UNKNOWN;
+    if (!bloomAccess(key, false)) {
+        stats.bloomRejects++;
+    } else {
+        // Dernier bloc dont la première clé est <= key
+        uint32_t lo = 0, hi = aclFenceCount;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (compareKey(aclFences + mid * ACL_KEY_SIZE, key) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo > 0) {
+            uint32_t block = lo - 1;
+            uint32_t n = min((uint32_t)ACL_FENCE_STRIDE, stats.count - block * ACL_FENCE_STRIDE);
+            aclFile.seek(sizeof(AclFileHeader) + block * ACL_FENCE_STRIDE * sizeof(AclEntry), SeekSet);
+            if (aclFile.read((uint8_t *)aclChunk, n * sizeof(AclEntry)) == n * sizeof(AclEntry)) {
+                int a = 0, b = (int)n - 1;
+                while (a <= b) {
+                    int mid = (a + b) / 2;
+                    int c = compareKey(aclChunk[mid].uid, key);
+                    if (c == 0) {
+                        result = (AclDecision)aclChunk[mid].flags;
+                        break;
+                    }
+                    if (c < 0) a = mid + 1;
+                    else b = mid - 1;
+                }
+            }
+        }
+        if (result == ACL_UNKNOWN) stats.misses++;
+        else stats.hits++;
+    }
+    stats.lastLookupUs = micros() - start;
+    if (stats.lastLookupUs > stats.maxLookupUs) stats.maxLookupUs = stats.lastLookupUs;
+    return result;
+}
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseUidHex(const char *hex, size_t len, AclEntry &entry) {
+    if (len < 2 || len > 20 || (len & 1)) return false;
+    memset(&entry, 0, sizeof(entry));
+    for (size_t i = 0; i < len; i += 2) {
+        int hi = hexNibble(hex[i]);
+        int lo = hexNibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        entry.uid[i / 2] = (hi << 4) | lo;
+    }
+    entry.uidSize = len / 2;
+    return true;
+}
+
+bool aclParseUidHex(const String &hex, AclEntry &entry) {
+    return parseUidHex(hex.c_str(), hex.length(), entry);
+}
+
+// === Synchronisation ===
+// Reçoit le corps HTTP au fil de l'eau (writeToStream) : la liste complète
+// n'est jamais chargée en RAM, seul le delta (borné) l'est.
+class AclSyncWriter : public Stream {
+public:
+    ~AclSyncWriter() {
+        free(delta);
+        if (out) out.close();
+    }
+    size_t write(uint8_t c) override {
+        if (state == FAILED) return 1;
+        if (c == '\n') {
+            line[lineLen] = '\0';
+            processLine();
+            lineLen = 0;
+        } else if (lineLen < sizeof(line) - 1) {
+            line[lineLen++] = c;
+        } else {
+            fail(-4);
+        }
+        return 1;
+    }
+    size_t write(const uint8_t *buf, size_t size) override {
+        for (size_t i = 0; i < size; i++) write(buf[i]);
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+
+    int finish();
+    uint16_t changes() const { return isFull ? count : deltaCount; }
+
+private:
+    enum { WAIT_HEADER, RECEIVING, FAILED } state = WAIT_HEADER;
+    char line[48];
+    uint8_t lineLen = 0;
+    bool isFull = false;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    int error = 0;
+    File out;
+    AclEntry last;
+    AclEntry *delta = nullptr;
+    uint16_t deltaCount = 0;
+
+    void fail(int code) {
+        state = FAILED;
+        error = code;
+    }
+    bool openOutput() {
+        out = LittleFS.open(ACL_NEW_PATH, "w");
+        if (!out) return false;
+        AclFileHeader header = {ACL_MAGIC, version, 0, 0};
+        out.write((const uint8_t *)&header, sizeof(header));
+        return true;
+    }
+    void emit(const AclEntry &entry) {
+        if (entry.flags == ACL_UNKNOWN) return;
+        out.write((const uint8_t *)&entry, sizeof(entry));
+        count++;
+    }
+    void processLine();
+    void insertDelta(const AclEntry &entry);
+    bool mergeDelta();
+};
+
+void AclSyncWriter::processLine() {
+    while (lineLen > 0 && (line[lineLen - 1] == '\r' || line[lineLen - 1] == ' ')) line[--lineLen] = '\0';
+    if (lineLen == 0 || line[0] == '#') return;
+    if (state == WAIT_HEADER) {
+        char *end;
+        if (strncmp(line, "ACL FULL ", 9) == 0) {
+            isFull = true;
+            version = strtoul(line + 9, &end, 10);
+            memset(&last, 0, sizeof(last));
+            if (!openOutput()) return fail(-2);
+        } else if (strncmp(line, "ACL DELTA ", 10) == 0) {
+            uint32_t base = strtoul(line + 10, &end, 10);
+            version = strtoul(end, &end, 10);
+            if (base != stats.version) {
+                forceFull = true;
+                return fail(-3);
+            }
+            delta = (AclEntry *)malloc(ACL_DELTA_MAX * sizeof(AclEntry));
+            if (!delta) return fail(-2);
+        } else {
+            return fail(-4);
+        }
+        state = RECEIVING;
+        return;
+    }
+    AclEntry entry;
+    if (!parseUidHex(line + 1, lineLen - 1, entry)) return fail(-4);
+    switch (line[0]) {
+        case '+': entry.flags = ACL_ALLOW; break;
+        case '-': entry.flags = ACL_DENY; break;
+        case '~': entry.flags = ACL_UNKNOWN; break;
+        default: return fail(-4);
+    }
+    if (!isFull) {
+        insertDelta(entry);
+        return;
+    }
+    // Liste complète : doit arriver triée, sans doublon
+    if (count > 0 && compareKey(entry.uid, last.uid) <= 0) return fail(-5);
+    emit(entry);
+    last = entry;
+    if ((count & 63) == 0) yield();
+}
+
+// Delta gardé trié ; une ligne répétée remplace la précédente
+void AclSyncWriter::insertDelta(const AclEntry &entry) {
+    int lo = 0, hi = deltaCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compareKey(delta[mid].uid, entry.uid) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < deltaCount && compareKey(delta[lo].uid, entry.uid) == 0) {
+        delta[lo] = entry;
+        return;
+    }
+    if (deltaCount >= ACL_DELTA_MAX) {
+        forceFull = true;
+        return fail(-6);
+    }
+    memmove(&delta[lo + 1], &delta[lo], (deltaCount - lo) * sizeof(AclEntry));
+    delta[lo] = entry;
+    deltaCount++;
+}
+
+// Fusion de la liste courante et du delta dans /acl/list.new
+bool AclSyncWriter::mergeDelta() {
+    if (!openOutput()) return false;
+    uint32_t oldCount = aclFile ? stats.count : 0;
+    uint32_t i = 0, chunkPos = 0, chunkLen = 0;
+    uint16_t j = 0;
+    if (oldCount > 0) aclFile.seek(sizeof(AclFileHeader), SeekSet);
+    while (i < oldCount || j < deltaCount) {
+        if (i < oldCount && chunkPos == chunkLen) {
+            chunkLen = min((uint32_t)ACL_FENCE_STRIDE, oldCount - i);
+            if (aclFile.read((uint8_t *)aclChunk, chunkLen * sizeof(AclEntry)) != chunkLen * sizeof(AclEntry)) {
+                return false;
+            }
+            chunkPos = 0;
+            yield();
+        }
+        int c = i >= oldCount ? 1 : (j >= deltaCount ? -1 : compareKey(aclChunk[chunkPos].uid, delta[j].uid));
+        if (c < 0) {
+            emit(aclChunk[chunkPos++]);
+            i++;
+        } else {
+            if (c == 0) {
+                chunkPos++;
+                i++;
+            }
+            emit(delta[j++]);
+        }
+    }
+    return true;
+}
+
+int AclSyncWriter::finish() {
+    if (state == WAIT_HEADER) fail(-4);
+    if (state == RECEIVING && lineLen > 0) {
+        line[lineLen] = '\0';
+        processLine();
+        lineLen = 0;
+    }
+    if (state == RECEIVING && !isFull && !mergeDelta()) fail(-2);
+    if (state == FAILED) {
+        if (out) out.close();
+        LittleFS.remove(ACL_NEW_PATH);
+        return error;
+    }
+    AclFileHeader header = {ACL_MAGIC, version, count, 0};
+    out.seek(0, SeekSet);
+    out.write((const uint8_t *)&header, sizeof(header));
+    out.close();
+    // Bascule atomique : la liste courante n'est remplacée qu'une fois la nouvelle complète
+    if (aclFile) aclFile.close();
+    if (!LittleFS.rename(ACL_NEW_PATH, ACL_LIST_PATH)) {
+        LittleFS.remove(ACL_NEW_PATH);
+        loadIndex();
+        return -2;
+    }
+    forceFull = false;
+    loadIndex();
+    return 0;
+}
+
+bool aclSync() {
+    String url = sourceUrl;
+    if (!url.startsWith("http")) return false;
+    if (WiFi.status() != WL_CONNECTED) {
+        stats.lastSyncCode = -1;
+        return false;
+    }
+    url += url.indexOf('?') >= 0 ? "&since=" : "?since=";
+    url += forceFull ? 0 : stats.version;
+    serialLog().println("[ACL] Synchronisation: " + url);
+    HTTPClient http;
+    WiFiClient client;
+    WiFiClientSecure secureClient;
+    bool beginOk;
+    if (url.startsWith("https://")) {
+        secureClient.setInsecure();
+        beginOk = http.begin(secureClient, url);
+    } else {
+        beginOk = http.begin(client, url);
+    }
+    stats.lastSyncMs = millis();
+    if (!beginOk) {
+        stats.lastSyncCode = -2;
+        return false;
+    }
+    int httpCode = http.GET();
+    stats.lastSyncCode = httpCode;
+    stats.lastSyncChanges = 0;
+    if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+        http.end();
+        return true;
+    }
+    if (httpCode != HTTP_CODE_OK) {
+        serialLog().printf("[ACL] Échec synchronisation: %d\n", httpCode);
+        http.end();
+        return false;
+    }
+    AclSyncWriter writer;
+    int received = http.writeToStream(&writer);
+    http.end();
+    int result = received < 0 ? received : writer.finish();
+    if (result != 0) {
+        stats.lastSyncCode = result;
+        serialLog().printf("[ACL] Synchronisation rejetée: %d\n", result);
+        return false;
+    }
+    stats.lastSyncChanges = writer.changes();
+    serialLog().printf("[ACL] Liste v%u active (%u modifications)\n", stats.version, stats.lastSyncChanges);
+    return true;
+}
+
+String aclSourceUrl() {
+    return sourceUrl;
+}
+
+void aclSetSourceUrl(const String &url) {
+    sourceUrl = url;
+    sourceUrl.trim();
+    File f = LittleFS.open(ACL_SOURCE_PATH, "w");
+    if (f) {
+        f.print(sourceUrl);
+        f.close();
+    }
+    forceFull = true;
+}
+
+const AclStats &aclStats() {
+    return stats;
+}
+
+const char *aclDecisionName(AclDecision decision) {
+    switch (decision) {
+        case ACL_ALLOW: return "allow";
+        case ACL_DENY: return "deny";
+        default: return "unknown";
+    }
+}
+
+String aclStatusJson() {
+    String json;
+    json.reserve(320);
+    json = "{\"version\":";
+    json += stats.version;
+    json += ",\"count\":";
+    json += stats.count;
+    json += ",\"ramBytes\":";
+    json += (unsigned long)(stats.bloomBytes + aclFenceCount * ACL_KEY_SIZE);
+    json += ",\"bloomBytes\":";
+    json += stats.bloomBytes;
+    json += ",\"bloomHashes\":";
+    json += stats.bloomHashes;
+    json += ",\"bloomFpp\":";
+    json += String(bloomFpp(), 4);
+    json += ",\"lookups\":";
+    json += stats.lookups;
+    json += ",\"bloomRejects\":";
+    json += stats.bloomRejects;
+    json += ",\"hits\":";
+    json += stats.hits;
+    json += ",\"misses\":";
+    json += stats.misses;
+    json += ",\"lastLookupUs\":";
+    json += stats.lastLookupUs;
+    json += ",\"maxLookupUs\":";
+    json += stats.maxLookupUs;
+    json += ",\"lastSyncAge\":";
+    json += stats.lastSyncMs ? (long)((millis() - stats.lastSyncMs) / 1000) : -1L;
+    json += ",\"lastSyncCode\":";
+    json += stats.lastSyncCode;
+    json += ",\"lastSyncChanges\":";
+    json += stats.lastSyncChanges;
+    json += ",\"source\":\"";
+    json += sourceUrl;
+    json += "\"}";
+    return json;
+}
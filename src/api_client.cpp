@@ -0,0 +1,151 @@
+/*
+ * Envoi des UID à l'API distante et historique des envois
+ */
+#include <ESP8266WiFi.h>
+#include <ESP8266HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <api_client.h>
+#include <settings.h>
+#include <acl.h>
+#include <metrics.h>
+#include <read_profile.h>
+#include <serial_link.h>
+#include <coap_uplink.h>
+#include <upload_outbox.h>
+#include <decision_cache.h>
+
+ApiLogEntry apiLog[API_LOG_SIZE];
+int apiLogIndex = 0;
+uint32_t apiLogTotal = 0;
+
+bool aclSyncDue = true;
+static unsigned long lastAclSync = 0;
+
+// Réponse recopiée sur le port série au fil de l'eau ; son début est gardé
+// pour y lire la décision et son ttl (decision_cache.h)
+class ResponseTap : public Stream {
+public:
+    char head[DECISION_BODY_MAX];
+    size_t length = 0;
+
+    size_t write(uint8_t c) override {
+        if (length < sizeof(head)) head[length++] = c;
+        return serialLog().write(c);
+    }
+    size_t write(const uint8_t *buf, size_t size) override {
+        size_t n = min(size, sizeof(head) - length);
+        memcpy(head + length, buf, n);
+        length += n;
+        return serialLog().write(buf, size);
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+};
+
+// Fonction pour envoyer un scan à l'API et retourner le code HTTP
+// Aucune String construite ici : corps codé en place dans un tampon fixe,
+// les seules allocations restantes sont celles de la pile HTTP/TLS.
+// Un corps « decision=deny » sous un code 2xx rend 403, comme coapSend().
+int sendScanToApi(const ScanRecord &scan) {
+    static const String contentTypeName = "Content-Type";
+    static const String contentTypeValues[API_ENCODING_COUNT] = {apiEncodingContentType(API_ENCODING_FORM),
+                                                                 apiEncodingContentType(API_ENCODING_CBOR)};
+    static const String idempotencyName = "Idempotency-Key";
+    static String idempotencyValue;
+    // URL coap:// : un datagramme confirmable, réponse attendue ici (audit, repli)
+    if (coapUplinkActive()) return coapSend(scan);
+    const char *uid = scan.uid;
+    ApiEncoding encoding = (ApiEncoding)apiEncoding;
+    const String &url = apiUrl;
+    serialLog().print("[API] Préparation envoi UID: ");
+    serialLog().print(uid);
+    serialLog().print(" vers ");
+    serialLog().println(url);
+    int httpCode = -1;
+    AclDecision answer = ACL_UNKNOWN;
+    if (WiFi.status() == WL_CONNECTED && strncmp(url.c_str(), "http", 4) == 0) {
+        HTTPClient http;
+        // Les clients doivent survivre jusqu'à http.end() : HTTPClient ne garde qu'un pointeur
+        WiFiClient client;
+        WiFiClientSecure secureClient;
+        bool beginOk = false;
+        if (strncmp(url.c_str(), "https://", 8) == 0) {
+            secureClient.setInsecure();
+            beginOk = http.begin(secureClient, url);
+        } else {
+            beginOk = http.begin(client, url);
+        }
+        if (!beginOk) {
+            serialLog().println("[API] Erreur http.begin()");
+            logApiSend(uid, -2, url);
+            metricsUpload(false);
+            return -2;
+        }
+        http.addHeader(contentTypeName, contentTypeValues[encoding]);
+        if (scan.device && scan.sequence) {
+            // « <appareil>-<séquence> », identique à chaque renvoi ; tampon réservé une fois
+            char key[DEVICE_ID_MAXLEN + 12];
+            snprintf(key, sizeof(key), "%s-%lu", scan.device, (unsigned long)scan.sequence);
+            idempotencyValue.reserve(sizeof(key));
+            idempotencyValue = key;
+            http.addHeader(idempotencyName, idempotencyValue);
+        }
+        serialLog().println("[API] Envoi POST...");
+        uint8_t body[SCAN_PAYLOAD_MAX];
+        size_t bodyLen = scanPayloadEncode(scan, encoding, body, sizeof(body));
+        httpCode = http.POST(body, bodyLen);
+        serialLog().print("[API] Code HTTP: ");
+        serialLog().println(httpCode);
+        if (httpCode > 0) {
+            // Réponse recopiée directement sur le port série, sans String intermédiaire
+            serialLog().print("[API] Réponse: ");
+            ResponseTap response;
+            http.writeToStream(&response);
+            serialLog().println();
+            logApiSend(uid, httpCode, url);
+            answer = decisionCacheLearn(uid, httpCode, response.head, response.length);
+        } else {
+            serialLog().print("[API] Erreur POST: ");
+            serialLog().println(http.errorToString(httpCode));
+            logApiSend(uid, httpCode, url);
+        }
+        http.end();
+    } else {
+        serialLog().println("[API] WiFi non connecté ou URL invalide");
+        logApiSend(uid, -1, url);
+        httpCode = -1;
+    }
+    // Envoi réussi pour tout 2xx ; un refus dans le corps (decision_cache.h)
+    // est rendu comme un 403 à l'appelant
+    metricsUpload(httpCode / 100 == 2);
+    return answer == ACL_DENY ? 403 : httpCode;
+}
+
+// fields : champs du profil de lecture, déjà encodés ("&nom=valeur...")
+int sendUidToApi(const char *uid, const char *fields) {
+    return sendScanToApi(scanRecord(uid, fields));
+}
+
+void logApiSend(const char *uid, int httpCode, const String& url) {
+    ApiLogEntry &entry = apiLog[apiLogIndex];
+    entry.timestamp = millis() / 1000;
+    strncpy(entry.uid, uid, API_LOG_UID_MAXLEN - 1);
+    entry.uid[API_LOG_UID_MAXLEN - 1] = '\0';
+    entry.httpCode = httpCode;
+    strncpy(entry.url, url.c_str(), API_LOG_URL_MAXLEN - 1);
+    entry.url[API_LOG_URL_MAXLEN - 1] = '\0';
+    apiLogIndex = (apiLogIndex + 1) % API_LOG_SIZE;
+    apiLogTotal++;
+}
+
+// Tâche réseau de fond : synchronisation de la liste d'accès (les renvois
+// de la boîte d'envoi passent par outboxLoop(), appelé à chaque loop())
+void apiClientLoop() {
+    if (aclSyncDue || millis() - lastAclSync > ACL_SYNC_INTERVAL_MS) {
+        aclSyncDue = false;
+        lastAclSync = millis();
+        aclSync();
+    }
+}
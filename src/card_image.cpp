@@ -0,0 +1,410 @@
+/*
+ * Sauvegarde / restauration d'images de cartes sur LittleFS
+ */
+#include <card_image.h>
+#include <hex_util.h>
+#include <LittleFS.h>
+#include <sector_access.h>
+#include <rf_tuning.h>
+#include <serial_link.h>
+
+static uint8_t sectorCountFor(uint16_t blockCount) {
+    return blockCount > 128 ? 32 + (blockCount - 128) / 16 : blockCount / 4;
+}
+
+static uint16_t firstBlockOfSector(uint8_t sector) {
+    return sector < 32 ? sector * 4 : 128 + (sector - 32) * 16;
+}
+
+static uint8_t blocksInSector(uint8_t sector) {
+    return sector < 32 ? 4 : 16;
+}
+
+static bool isClassicType(MFRC522::PICC_Type type) {
+    return type == MFRC522::PICC_TYPE_MIFARE_MINI ||
+           type == MFRC522::PICC_TYPE_MIFARE_1K ||
+           type == MFRC522::PICC_TYPE_MIFARE_4K;
+}
+
+static void setValid(CardImageHeader &header, uint16_t block) {
+    header.validMap[block >> 3] |= (1 << (block & 7));
+}
+
+static bool isValid(const CardImageHeader &header, uint16_t block) {
+    return header.validMap[block >> 3] & (1 << (block & 7));
+}
+
+static bool isUidHex(const String &uidHex) {
+    if (uidHex.length() < 8 || uidHex.length() > 20 || (uidHex.length() & 1)) return false;
+    for (unsigned int i = 0; i < uidHex.length(); i++) {
+        if (!isxdigit((unsigned char)uidHex[i])) return false;
+    }
+    return true;
+}
+
+bool cardImageBegin() {
+    if (!LittleFS.begin()) {
+        serialLog().println("[IMG] Échec du montage LittleFS");
+        return false;
+    }
+    if (!LittleFS.exists(CARD_IMAGE_DIR)) LittleFS.mkdir(CARD_IMAGE_DIR);
+    return true;
+}
+
+bool cardImageLayout(MFRC522::PICC_Type type, uint16_t &blockCount, uint8_t &blockSize) {
+    switch (type) {
+        case MFRC522::PICC_TYPE_MIFARE_MINI: blockCount = 20;  blockSize = 16; return true;
+        case MFRC522::PICC_TYPE_MIFARE_1K:   blockCount = 64;  blockSize = 16; return true;
+        case MFRC522::PICC_TYPE_MIFARE_4K:   blockCount = 256; blockSize = 16; return true;
+        case MFRC522::PICC_TYPE_MIFARE_UL:   blockCount = 16;  blockSize = 4;  return true;
+        default: return false;
+    }
+}
+
+void cardImageUidHex(const byte *uid, byte uidSize, char *out) {
+    hexEncode(uid, uidSize < 10 ? uidSize : 10, out);
+}
+
+String cardImagePath(const String &uidHex) {
+    if (!isUidHex(uidHex)) return "";
+    String lower = uidHex;
+    lower.toLowerCase();
+    return String(CARD_IMAGE_DIR) + "/" + lower + CARD_IMAGE_EXT;
+}
+
+size_t cardImageBodySize(const CardImageHeader &header) {
+    return (size_t)header.blockCount * header.blockSize;
+}
+
+// En-tête d'un fichier de size octets : géométrie bornée par validMap avant
+// toute lecture de la carte des blocs ou du contenu
+static bool headerValid(const CardImageHeader &header, size_t size) {
+    return header.magic == CARD_IMAGE_MAGIC && header.version == CARD_IMAGE_VERSION &&
+           header.blockCount <= CARD_IMAGE_MAX_BLOCKS && (header.blockSize == 4 || header.blockSize == 16) &&
+           header.uidSize <= sizeof(header.uid) && size == sizeof(header) + cardImageBodySize(header);
+}
+
+uint16_t cardImageValidCount(const CardImageHeader &header) {
+    uint16_t count = 0;
+    for (uint16_t b = 0; b < header.blockCount; b++) {
+        if (isValid(header, b)) count++;
+    }
+    return count;
+}
+
+bool cardImageCapture(MFRC522 &reader, MFRC522::MIFARE_Key &key, CardImageHeader &header) {
+    MFRC522::PICC_Type type = MFRC522::PICC_GetType(reader.uid.sak);
+    memset(&header, 0, sizeof(header));
+    if (!cardImageLayout(type, header.blockCount, header.blockSize)) {
+        serialLog().println("[IMG] Type de carte non supporté pour la sauvegarde");
+        return false;
+    }
+    header.magic = CARD_IMAGE_MAGIC;
+    header.version = CARD_IMAGE_VERSION;
+    header.piccType = type;
+    header.sak = reader.uid.sak;
+    header.uidSize = reader.uid.size;
+    memcpy(header.uid, reader.uid.uidByte, reader.uid.size);
+    header.timestamp = millis() / 1000;
+
+    char uidHex[CARD_IMAGE_UID_HEX_MAX];
+    cardImageUidHex(reader.uid.uidByte, reader.uid.size, uidHex);
+    String finalPath = cardImagePath(uidHex);
+    String tmpPath = String(CARD_IMAGE_DIR) + "/" + uidHex + ".tmp";
+    File f = LittleFS.open(tmpPath, "w");
+    if (!f) {
+        serialLog().println("[IMG] Impossible de créer " + tmpPath);
+        return false;
+    }
+    // En-tête provisoire, réécrit une fois validMap connu
+    f.write((const uint8_t *)&header, sizeof(header));
+
+    byte buffer[18];
+    if (isClassicType(type)) {
+        // Une authentification par secteur (sur le trailer) au lieu d'une par bloc
+        uint8_t sectors = sectorCountFor(header.blockCount);
+        for (uint8_t sector = 0; sector < sectors; sector++) {
+            uint16_t first = firstBlockOfSector(sector);
+            uint8_t count = blocksInSector(sector);
+            bool authOk = accessOpenSector(reader, key, sector);
+            uint8_t readOk = 0;
+            for (uint8_t i = 0; i < count; i++) {
+                uint16_t blockAddr = first + i;
+                memset(buffer, 0, sizeof(buffer));
+                // Blocs interdits en lecture : absents de l'image, sans NAK
+                if (authOk && accessAllows(blockAddr, false)) {
+                    byte size = sizeof(buffer);
+                    if (rfRead(reader, blockAddr, buffer, &size) == MFRC522::STATUS_OK) {
+                        setValid(header, blockAddr);
+                        readOk++;
+                    } else {
+                        // NAK : la session Crypto1 est perdue, on réauthentifie pour la suite du secteur
+                        memset(buffer, 0, sizeof(buffer));
+                        authOk = accessRecover(reader, key, sector);
+                    }
+                }
+                f.write(buffer, 16);
+            }
+            serialLog().printf("[IMG] Secteur %u: %u/%u blocs\n", sector, readOk, count);
+            yield();
+        }
+    } else {
+        // Ultralight : chaque READ renvoie 4 pages
+        for (uint16_t page = 0; page < header.blockCount; page += 4) {
+            byte size = sizeof(buffer);
+            memset(buffer, 0, sizeof(buffer));
+            uint8_t pages = min((uint16_t)4, (uint16_t)(header.blockCount - page));
+            if (rfRead(reader, page, buffer, &size) == MFRC522::STATUS_OK) {
+                for (uint8_t i = 0; i < pages; i++) setValid(header, page + i);
+            } else {
+                memset(buffer, 0, sizeof(buffer));
+            }
+            f.write(buffer, pages * 4);
+        }
+    }
+
+    f.seek(0, SeekSet);
+    f.write((const uint8_t *)&header, sizeof(header));
+    f.close();
+    if (!LittleFS.rename(tmpPath, finalPath)) {
+        LittleFS.remove(tmpPath);
+        serialLog().println("[IMG] Échec de l'enregistrement de " + finalPath);
+        return false;
+    }
+    serialLog().printf("[IMG] Image enregistrée: %s (%u/%u blocs lus)\n",
+                       finalPath.c_str(), cardImageValidCount(header), header.blockCount);
+    return true;
+}
+
+bool cardImageReadHeader(const String &uidHex, CardImageHeader &header) {
+    String path = cardImagePath(uidHex);
+    if (path.length() == 0) return false;
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+    bool ok = f.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && headerValid(header, f.size());
+    f.close();
+    return ok;
+}
+
+static bool restoreClassic(MFRC522 &reader, MFRC522::MIFARE_Key &key, File &f,
+                           const CardImageHeader &header, CardRestoreStats &stats) {
+    byte wanted[16];
+    byte current[18];
+    uint8_t sectors = sectorCountFor(header.blockCount);
+    for (uint8_t sector = 0; sector < sectors; sector++) {
+        uint16_t first = firstBlockOfSector(sector);
+        uint8_t count = blocksInSector(sector);
+        uint16_t trailer = first + count - 1;
+        // Le bloc 0 (constructeur) et les trailers (clés/bits d'accès) ne sont jamais réécrits
+        uint8_t candidates = 0;
+        for (uint16_t b = first; b < trailer; b++) {
+            if (b != 0 && isValid(header, b)) candidates++;
+        }
+        stats.skipped += count - candidates;
+        if (candidates == 0) continue;
+        if (!accessOpenSector(reader, key, sector)) {
+            serialLog().printf("[IMG] Secteur %u: authentification refusée\n", sector);
+            stats.failed += candidates;
+            continue;
+        }
+        for (uint16_t b = first; b < trailer; b++) {
+            if (b == 0 || !isValid(header, b)) continue;
+            f.seek(sizeof(CardImageHeader) + b * 16, SeekSet);
+            if (f.read(wanted, 16) != 16) {
+                stats.failed++;
+                continue;
+            }
+            byte size = sizeof(current);
+            if (accessAllows(b, false) && rfRead(reader, b, current, &size) == MFRC522::STATUS_OK &&
+                memcmp(current, wanted, 16) == 0) {
+                stats.unchanged++;
+                continue;
+            }
+            if (!accessAllows(b, true)) {
+                // Bloc en lecture seule pour la clé A : l'écriture échouerait
+                stats.failed++;
+            } else if (rfWrite(reader, b, wanted, 16) == MFRC522::STATUS_OK) {
+                stats.written++;
+            } else {
+                stats.failed++;
+                if (!accessRecover(reader, key, sector)) break;
+            }
+        }
+        yield();
+    }
+    return stats.failed == 0;
+}
+
+static bool restoreUltralight(MFRC522 &reader, File &f, const CardImageHeader &header,
+                              CardRestoreStats &stats) {
+    byte wanted[4];
+    byte current[18];
+    // Pages 0-3 : UID, verrous et OTP (irréversible) ; jamais réécrites
+    stats.skipped += min((uint16_t)4, header.blockCount);
+    for (uint16_t page = 4; page < header.blockCount; page += 4) {
+        byte size = sizeof(current);
+        bool haveCurrent = rfRead(reader, page, current, &size) == MFRC522::STATUS_OK;
+        for (uint8_t i = 0; i < 4 && page + i < header.blockCount; i++) {
+            uint16_t p = page + i;
+            if (!isValid(header, p)) {
+                stats.skipped++;
+                continue;
+            }
+            f.seek(sizeof(CardImageHeader) + p * 4, SeekSet);
+            if (f.read(wanted, 4) != 4) {
+                stats.failed++;
+                continue;
+            }
+            if (haveCurrent && memcmp(&current[i * 4], wanted, 4) == 0) {
+                stats.unchanged++;
+            } else if (reader.MIFARE_Ultralight_Write(p, wanted, 4) == MFRC522::STATUS_OK) {
+                stats.written++;
+            } else {
+                stats.failed++;
+                haveCurrent = false;
+                accessReselect(reader);
+            }
+        }
+    }
+    return stats.failed == 0;
+}
+
+bool cardImageRestore(MFRC522 &reader, MFRC522::MIFARE_Key &key, const String &uidHex, CardRestoreStats &stats) {
+    memset(&stats, 0, sizeof(stats));
+    CardImageHeader header;
+    if (!cardImageReadHeader(uidHex, header)) {
+        serialLog().println("[IMG] Image introuvable ou invalide: " + uidHex);
+        return false;
+    }
+    uint16_t targetBlocks;
+    uint8_t targetBlockSize;
+    MFRC522::PICC_Type targetType = MFRC522::PICC_GetType(reader.uid.sak);
+    if (!cardImageLayout(targetType, targetBlocks, targetBlockSize) ||
+        targetBlockSize != header.blockSize || targetBlocks < header.blockCount) {
+        serialLog().println("[IMG] Carte cible incompatible avec l'image");
+        return false;
+    }
+    File f = LittleFS.open(cardImagePath(uidHex), "r");
+    if (!f) return false;
+    bool ok = header.blockSize == 16
+        ? restoreClassic(reader, key, f, header, stats)
+        : restoreUltralight(reader, f, header, stats);
+    f.close();
+    serialLog().printf("[IMG] Restauration %s: %u écrits, %u identiques, %u ignorés, %u échecs\n",
+                       uidHex.c_str(), stats.written, stats.unchanged, stats.skipped, stats.failed);
+    return ok;
+}
+
+// Reconstruit un en-tête pour un dump .mfd brut (UID déduit du bloc 0)
+static bool headerFromRawDump(File &f, size_t size, CardImageHeader &header) {
+    memset(&header, 0, sizeof(header));
+    MFRC522::PICC_Type type;
+    if (size == 320) type = MFRC522::PICC_TYPE_MIFARE_MINI;
+    else if (size == 1024) type = MFRC522::PICC_TYPE_MIFARE_1K;
+    else if (size == 4096) type = MFRC522::PICC_TYPE_MIFARE_4K;
+    else if (size == 64) type = MFRC522::PICC_TYPE_MIFARE_UL;
+    else return false;
+    cardImageLayout(type, header.blockCount, header.blockSize);
+    byte b0[16];
+    f.seek(0, SeekSet);
+    if (f.read(b0, 16) != 16) return false;
+    if (type == MFRC522::PICC_TYPE_MIFARE_UL) {
+        // Pages 0-1 : UID0..2, BCC0, UID3..6
+        header.uidSize = 7;
+        memcpy(header.uid, b0, 3);
+        memcpy(header.uid + 3, b0 + 4, 4);
+    } else if ((b0[0] ^ b0[1] ^ b0[2] ^ b0[3]) == b0[4]) {
+        header.uidSize = 4;
+        memcpy(header.uid, b0, 4);
+        header.sak = b0[5];
+    } else {
+        header.uidSize = 7;
+        memcpy(header.uid, b0, 7);
+        header.sak = b0[7];
+    }
+    header.magic = CARD_IMAGE_MAGIC;
+    header.version = CARD_IMAGE_VERSION;
+    header.piccType = type;
+    header.timestamp = millis() / 1000;
+    memset(header.validMap, 0xFF, (header.blockCount + 7) / 8);
+    return true;
+}
+
+bool cardImageImport(const char *tmpPath, String &uidHex) {
+    File in = LittleFS.open(tmpPath, "r");
+    if (!in) return false;
+    size_t size = in.size();
+    CardImageHeader header;
+    bool isImage = size >= sizeof(header) &&
+                   in.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && headerValid(header, size);
+    if (!isImage && !headerFromRawDump(in, size, header)) {
+        in.close();
+        LittleFS.remove(tmpPath);
+        serialLog().println("[IMG] Fichier importé non reconnu");
+        return false;
+    }
+    char hex[CARD_IMAGE_UID_HEX_MAX];
+    cardImageUidHex(header.uid, header.uidSize, hex);
+    uidHex = hex;
+    String finalPath = cardImagePath(uidHex);
+    if (isImage) {
+        in.close();
+        return LittleFS.rename(tmpPath, finalPath);
+    }
+    // Dump brut : on préfixe l'en-tête puis on recopie le contenu
+    String outPath = finalPath + ".new";
+    File out = LittleFS.open(outPath, "w");
+    if (!out) {
+        in.close();
+        return false;
+    }
+    out.write((const uint8_t *)&header, sizeof(header));
+    uint8_t chunk[128];
+    in.seek(0, SeekSet);
+    size_t n;
+    while ((n = in.read(chunk, sizeof(chunk))) > 0) {
+        out.write(chunk, n);
+    }
+    out.close();
+    in.close();
+    LittleFS.remove(tmpPath);
+    return LittleFS.rename(outPath, finalPath);
+}
+
+bool cardImageRemove(const String &uidHex) {
+    String path = cardImagePath(uidHex);
+    return path.length() > 0 && LittleFS.remove(path);
+}
+
+String cardImageListJson() {
+    String json;
+    json.reserve(256);
+    json = "[";
+    Dir dir = LittleFS.openDir(CARD_IMAGE_DIR);
+    int count = 0;
+    while (dir.next()) {
+        String name = dir.fileName();
+        if (!name.endsWith(CARD_IMAGE_EXT)) continue;
+        String uidHex = name.substring(0, name.length() - strlen(CARD_IMAGE_EXT));
+        CardImageHeader header;
+        if (!cardImageReadHeader(uidHex, header)) continue;
+        if (count > 0) json += ",";
+        json += "{\"uid\":\"";
+        json += uidHex;
+        json += "\",\"type\":\"";
+        json += MFRC522::PICC_GetTypeName((MFRC522::PICC_Type)header.piccType);
+        json += "\",\"blocks\":";
+        json += header.blockCount;
+        json += ",\"valid\":";
+        json += cardImageValidCount(header);
+        json += ",\"size\":";
+        json += (unsigned long)dir.fileSize();
+        json += ",\"t\":";
+        json += header.timestamp;
+        json += "}";
+        count++;
+        yield();
+    }
+    json += "]";
+    return json;
+}
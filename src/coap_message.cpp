@@ -0,0 +1,165 @@
+/*
+ * Messages CoAP : codage en place et analyse d'un datagramme
+ */
+#include <coap_message.h>
+#include <string.h>
+
+// === Analyse ===
+// Valeur étendue d'un delta ou d'une longueur d'option (13 : +1 octet, 14 : +2)
+static bool optionNibble(uint8_t nibble, const uint8_t *&p, const uint8_t *end, uint32_t &out) {
+    if (nibble < 13) {
+        out = nibble;
+    } else if (nibble == 13) {
+        if (p + 1 > end) return false;
+        out = 13 + p[0];
+        p += 1;
+    } else if (nibble == 14) {
+        if (p + 2 > end) return false;
+        out = 269 + ((p[0] << 8) | p[1]);
+        p += 2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool coapParse(const uint8_t *data, size_t length, CoapMessage &out) {
+    if (length < COAP_HEADER_SIZE || (data[0] >> 6) != 1) return false;
+    out.type = (data[0] >> 4) & 0x03;
+    out.tokenLength = data[0] & 0x0F;
+    out.code = data[1];
+    out.messageId = (data[2] << 8) | data[3];
+    out.contentFormat = COAP_FORMAT_NONE;
+    out.path[0] = '\0';
+    out.payload = nullptr;
+    out.payloadLength = 0;
+    if (out.tokenLength > COAP_TOKEN_MAX || (size_t)(COAP_HEADER_SIZE + out.tokenLength) > length) return false;
+    memcpy(out.token, data + COAP_HEADER_SIZE, out.tokenLength);
+    // Message vide : ni jeton ni octet après l'en-tête
+    if (out.code == COAP_CODE_EMPTY) return out.tokenLength == 0 && length == COAP_HEADER_SIZE;
+
+    const uint8_t *p = data + COAP_HEADER_SIZE + out.tokenLength;
+    const uint8_t *end = data + length;
+    uint32_t number = 0;
+    size_t pathLength = 0;
+    while (p < end) {
+        if (*p == 0xFF) {
+            // Marqueur suivi d'une charge vide : message mal formé
+            if (p + 1 == end) return false;
+            out.payload = p + 1;
+            out.payloadLength = end - p - 1;
+            return true;
+        }
+        uint8_t head = *p++;
+        uint32_t delta, optionLength;
+        if (!optionNibble(head >> 4, p, end, delta) || !optionNibble(head & 0x0F, p, end, optionLength)) return false;
+        if (p + optionLength > end) return false;
+        number += delta;
+        if (number == COAP_OPTION_URI_PATH) {
+            if (pathLength && pathLength < COAP_PATH_MAX - 1) out.path[pathLength++] = '/';
+            size_t copy = optionLength;
+            if (pathLength + copy > COAP_PATH_MAX - 1) copy = COAP_PATH_MAX - 1 - pathLength;
+            memcpy(out.path + pathLength, p, copy);
+            pathLength += copy;
+            out.path[pathLength] = '\0';
+        } else if (number == COAP_OPTION_CONTENT_FORMAT && optionLength <= 2) {
+            out.contentFormat = 0;
+            for (uint32_t i = 0; i < optionLength; i++) out.contentFormat = (out.contentFormat << 8) | p[i];
+        }
+        p += optionLength;
+    }
+    return true;
+}
+
+// === Codage ===
+static void put(CoapWriter &w, uint8_t c) {
+    if (w.length < w.size) w.buf[w.length++] = c;
+    else w.overflow = true;
+}
+
+static uint8_t nibbleFor(uint32_t value) {
+    return value < 13 ? value : value < 269 ? 13 : 14;
+}
+
+static void putExtended(CoapWriter &w, uint32_t value) {
+    if (value >= 269) {
+        put(w, (value - 269) >> 8);
+        put(w, value - 269);
+    } else if (value >= 13) {
+        put(w, value - 13);
+    }
+}
+
+void coapBegin(CoapWriter &w, uint8_t *buf, size_t size, uint8_t type, uint8_t code, uint16_t messageId,
+               const uint8_t *token, uint8_t tokenLength) {
+    w.buf = buf;
+    w.size = size;
+    w.length = 0;
+    w.lastOption = 0;
+    w.overflow = tokenLength > COAP_TOKEN_MAX;
+    if (w.overflow) tokenLength = 0;
+    put(w, 0x40 | (type << 4) | tokenLength);
+    put(w, code);
+    put(w, messageId >> 8);
+    put(w, messageId);
+    for (uint8_t i = 0; i < tokenLength; i++) put(w, token[i]);
+}
+
+void coapOption(CoapWriter &w, uint16_t number, const uint8_t *value, size_t length) {
+    if (number < w.lastOption) {
+        w.overflow = true;
+        return;
+    }
+    uint32_t delta = number - w.lastOption;
+    w.lastOption = number;
+    put(w, (nibbleFor(delta) << 4) | nibbleFor(length));
+    putExtended(w, delta);
+    putExtended(w, length);
+    for (size_t i = 0; i < length; i++) put(w, value[i]);
+}
+
+void coapOptionUint(CoapWriter &w, uint16_t number, uint32_t value) {
+    // Entier sur le nombre minimal d'octets (0 : option vide)
+    uint8_t bytes[4];
+    size_t length = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (length || (value >> shift) & 0xFF) bytes[length++] = value >> shift;
+    }
+    coapOption(w, number, bytes, length);
+}
+
+void coapOptionPath(CoapWriter &w, const char *path) {
+    while (*path == '/') path++;
+    while (*path) {
+        const char *slash = strchr(path, '/');
+        size_t length = slash ? (size_t)(slash - path) : strlen(path);
+        if (length) coapOption(w, COAP_OPTION_URI_PATH, (const uint8_t *)path, length);
+        path += length;
+        while (*path == '/') path++;
+    }
+}
+
+void coapPayload(CoapWriter &w, const uint8_t *data, size_t length) {
+    if (!length) return;
+    put(w, 0xFF);
+    for (size_t i = 0; i < length; i++) put(w, data[i]);
+}
+
+uint8_t *coapPayloadSpace(CoapWriter &w, size_t &room) {
+    room = w.length + 1 < w.size ? w.size - w.length - 1 : 0;
+    return w.buf + w.length + 1;
+}
+
+void coapPayloadCommit(CoapWriter &w, size_t length) {
+    if (!length) return;
+    if (w.length + 1 + length > w.size) {
+        w.overflow = true;
+        return;
+    }
+    w.buf[w.length] = 0xFF;
+    w.length += 1 + length;
+}
+
+size_t coapEnd(CoapWriter &w) {
+    return w.overflow ? 0 : w.length;
+}
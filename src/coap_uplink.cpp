@@ -0,0 +1,241 @@
+/*
+ * Remontée des scans en CoAP confirmable sur UDP
+ */
+#include <coap_uplink.h>
+#include <coap_message.h>
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include <config.h>
+#include <settings.h>
+#include <api_client.h>
+#include <metrics.h>
+#include <scanner.h>
+#include <serial_link.h>
+#include <decision_cache.h>
+
+#define COAP_TOKEN_SIZE 4
+
+static WiFiUDP udp;
+static bool udpOpen = false;
+static CoapStats stats;
+
+// Serveur tiré de l'URL d'API, résolu une fois par URL
+static char serverUrl[API_URL_MAXLEN + 1];
+static IPAddress serverIp;
+static uint16_t serverPort = COAP_DEFAULT_PORT;
+static char serverPath[COAP_PATH_MAX];
+
+// Échange en cours : le datagramme est gardé tel quel pour les renvois
+static struct {
+    bool active;
+    bool acked;                 // ACK vide reçu : réponse séparée attendue
+    uint16_t messageId;
+    uint8_t token[COAP_TOKEN_SIZE];
+    uint8_t retransmits;
+    unsigned long sentMs;
+    unsigned long timeoutMs;
+    unsigned long startUs;
+    size_t length;
+    uint8_t datagram[COAP_DATAGRAM_MAX];
+    char uid[UID_HEX_MAX];
+} exchange;
+
+static uint16_t nextMessageId = 0;
+static uint32_t tokenCounter = 0;
+// Dernière réponse séparée reçue : ses répétitions sont acquittées à nouveau
+static uint16_t lastSeparateId = 0;
+static bool lastSeparateValid = false;
+static uint8_t rx[COAP_DATAGRAM_MAX];
+
+// === Serveur ===
+static bool resolveServer() {
+    if (strcmp(serverUrl, apiUrl.c_str()) == 0) return true;
+    // coap://hôte[:port][/chemin]
+    const char *p = apiUrl.c_str() + 7;
+    const char *hostEnd = p;
+    while (*hostEnd && *hostEnd != ':' && *hostEnd != '/') hostEnd++;
+    char host[64];
+    size_t hostLength = min((size_t)(hostEnd - p), sizeof(host) - 1);
+    memcpy(host, p, hostLength);
+    host[hostLength] = '\0';
+    serverPort = *hostEnd == ':' ? atoi(hostEnd + 1) : COAP_DEFAULT_PORT;
+    const char *path = strchr(hostEnd, '/');
+    snprintf(serverPath, sizeof(serverPath), "%s", path ? path : "");
+    if (!hostLength || !serverPort || !WiFi.hostByName(host, serverIp)) {
+        // URL gardée inconnue : nouvel essai au prochain scan
+        serverUrl[0] = '\0';
+        serialLog().printf("[CoAP] Serveur introuvable: %s\n", apiUrl.c_str());
+        return false;
+    }
+    snprintf(serverUrl, sizeof(serverUrl), "%s", apiUrl.c_str());
+    if (nextMessageId == 0) nextMessageId = micros();
+    return true;
+}
+
+static void sendDatagram(const uint8_t *data, size_t length, IPAddress ip, uint16_t port) {
+    udp.beginPacket(ip, port);
+    udp.write(data, length);
+    udp.endPacket();
+}
+
+static void sendExchange() {
+    sendDatagram(exchange.datagram, exchange.length, serverIp, serverPort);
+    exchange.sentMs = millis();
+}
+
+// ACK vide ou RST en réponse à un message du serveur
+static void sendEmpty(uint8_t type, uint16_t messageId) {
+    uint8_t empty[COAP_HEADER_SIZE];
+    CoapWriter w;
+    coapBegin(w, empty, sizeof(empty), type, COAP_CODE_EMPTY, messageId, nullptr, 0);
+    sendDatagram(empty, coapEnd(w), udp.remoteIP(), udp.remotePort());
+}
+
+// === Échange ===
+static CoapResult finish(CoapResult result, int code) {
+    exchange.active = false;
+    stats.lastRttUs = micros() - exchange.startUs;
+    if (stats.lastRttUs > stats.maxRttUs) stats.maxRttUs = stats.lastRttUs;
+    stats.lastCode = code;
+    if (result == COAP_ALLOW) stats.allowed++;
+    else if (result == COAP_DENY) stats.denied++;
+    logApiSend(exchange.uid, code, apiUrl);
+    metricsUpload(result != COAP_FAILED);
+    serialLog().printf("[CoAP] %s : %d %s en %lu µs, %u renvoi(s)\n", exchange.uid, code,
+                       result == COAP_ALLOW ? "autorisé" : result == COAP_DENY ? "refusé" : "échec",
+                       (unsigned long)stats.lastRttUs, exchange.retransmits);
+    return result;
+}
+
+// Charge lue comme un corps HTTP : décision, et ttl pour le cache (decision_cache.h)
+static CoapResult decision(const CoapMessage &msg) {
+    int code = coapCodeNumber(msg.code);
+    AclDecision answer = decisionCacheLearn(exchange.uid, code, (const char *)msg.payload,
+                                            msg.payload ? msg.payloadLength : 0);
+    if (answer == ACL_UNKNOWN) return finish(COAP_FAILED, code);
+    return finish(answer == ACL_DENY ? COAP_DENY : COAP_ALLOW, code);
+}
+
+static CoapResult handleMessage(const CoapMessage &msg) {
+    bool tokenMatches = msg.tokenLength == COAP_TOKEN_SIZE && memcmp(msg.token, exchange.token, COAP_TOKEN_SIZE) == 0;
+    switch (msg.type) {
+    case COAP_TYPE_ACK:
+        // ACK d'un renvoi déjà traité, ou d'un échange précédent
+        if (msg.messageId != exchange.messageId || exchange.acked) {
+            stats.duplicates++;
+            return COAP_PENDING;
+        }
+        if (msg.code == COAP_CODE_EMPTY) {
+            exchange.acked = true;
+            exchange.sentMs = millis();
+            stats.separate++;
+            return COAP_PENDING;
+        }
+        if (!tokenMatches) return COAP_PENDING;
+        return decision(msg);
+    case COAP_TYPE_RST:
+        if (msg.messageId != exchange.messageId) return COAP_PENDING;
+        return finish(COAP_FAILED, -2);
+    default:
+        // Réponse séparée, ou répétition d'une réponse déjà reçue
+        if (tokenMatches && msg.code >= COAP_CODE(2, 0)) {
+            if (msg.type == COAP_TYPE_CON) sendEmpty(COAP_TYPE_ACK, msg.messageId);
+            lastSeparateId = msg.messageId;
+            lastSeparateValid = true;
+            return decision(msg);
+        }
+        if (msg.type == COAP_TYPE_CON) {
+            bool repeat = lastSeparateValid && msg.messageId == lastSeparateId;
+            if (repeat) stats.duplicates++;
+            sendEmpty(repeat ? COAP_TYPE_ACK : COAP_TYPE_RST, msg.messageId);
+        }
+        return COAP_PENDING;
+    }
+}
+
+// === API ===
+bool coapUplinkActive() {
+    return strncmp(apiUrl.c_str(), "coap://", 7) == 0;
+}
+
+bool coapExchangeActive() {
+    return exchange.active;
+}
+
+bool coapStart(const ScanRecord &scan) {
+    if (exchange.active || !coapUplinkActive() || WiFi.status() != WL_CONNECTED || !resolveServer()) return false;
+    if (!udpOpen) udpOpen = udp.begin(COAP_LOCAL_PORT);
+    // Jeton distinct à chaque échange : une réponse tardive ne peut pas être prise pour la suivante
+    uint32_t token = (++tokenCounter * 2654435761UL) ^ micros();
+    memcpy(exchange.token, &token, COAP_TOKEN_SIZE);
+    exchange.messageId = nextMessageId++;
+    ApiEncoding encoding = (ApiEncoding)apiEncoding;
+    CoapWriter w;
+    coapBegin(w, exchange.datagram, sizeof(exchange.datagram), COAP_TYPE_CON, COAP_CODE_POST, exchange.messageId,
+              exchange.token, COAP_TOKEN_SIZE);
+    coapOptionPath(w, serverPath);
+    coapOptionUint(w, COAP_OPTION_CONTENT_FORMAT, encoding == API_ENCODING_CBOR ? COAP_FORMAT_CBOR : COAP_FORMAT_TEXT);
+    // Corps codé directement dans le datagramme, comme le POST HTTP
+    size_t room;
+    uint8_t *payload = coapPayloadSpace(w, room);
+    size_t payloadLength = scanPayloadEncode(scan, encoding, payload, room);
+    if (!payloadLength) return false;
+    coapPayloadCommit(w, payloadLength);
+    exchange.length = coapEnd(w);
+    if (!exchange.length) return false;
+    snprintf(exchange.uid, sizeof(exchange.uid), "%s", scan.uid);
+    exchange.acked = false;
+    exchange.retransmits = 0;
+    exchange.timeoutMs = COAP_ACK_TIMEOUT_MS;
+    exchange.startUs = micros();
+    exchange.active = true;
+    stats.requests++;
+    sendExchange();
+    return true;
+}
+
+CoapResult coapPoll() {
+    if (!exchange.active) return COAP_FAILED;
+    while (udp.parsePacket() > 0) {
+        int n = udp.read(rx, sizeof(rx));
+        CoapMessage msg;
+        if (n <= 0 || !coapParse(rx, n, msg)) continue;
+        CoapResult result = handleMessage(msg);
+        if (result != COAP_PENDING) return result;
+    }
+    unsigned long now = millis();
+    if (exchange.acked) {
+        if (now - exchange.sentMs >= COAP_SEPARATE_TIMEOUT_MS) {
+            stats.timeouts++;
+            return finish(COAP_FAILED, -1);
+        }
+    } else if (now - exchange.sentMs >= exchange.timeoutMs) {
+        if (exchange.retransmits == COAP_MAX_RETRANSMIT) {
+            stats.timeouts++;
+            return finish(COAP_FAILED, -1);
+        }
+        // Même identifiant de message : le serveur reconnaît le renvoi
+        exchange.retransmits++;
+        stats.retransmits++;
+        exchange.timeoutMs *= 2;
+        sendExchange();
+    }
+    return COAP_PENDING;
+}
+
+int coapSend(const ScanRecord &scan) {
+    if (!coapStart(scan)) {
+        logApiSend(scan.uid, -1, apiUrl);
+        metricsUpload(false);
+        return -1;
+    }
+    CoapResult result;
+    while ((result = coapPoll()) == COAP_PENDING) yield();
+    if (result == COAP_ALLOW) return 200;
+    if (result == COAP_DENY) return 403;
+    return stats.lastCode;
+}
+
+const CoapStats &coapStats() {
+    return stats;
+}
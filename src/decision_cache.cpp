@@ -0,0 +1,235 @@
+/*
+ * Cache des décisions de l'API (ttl fourni par le serveur)
+ */
+#include <decision_cache.h>
+#include <serial_link.h>
+
+#define CACHE_MASK (DECISION_CACHE_SLOTS - 1)
+#define CACHE_UID_MAX 10
+
+static_assert((DECISION_CACHE_SLOTS & CACHE_MASK) == 0, "DECISION_CACHE_SLOTS doit être une puissance de 2");
+
+struct CacheEntry {
+    uint8_t uid[CACHE_UID_MAX];
+    uint8_t uidSize;            // 0 : case libre
+    AclDecision decision;
+    uint64_t expiresMs;         // horloge de nowMs(), sans retour à zéro
+};
+
+static CacheEntry table[DECISION_CACHE_SLOTS];
+static DecisionCacheStats stats;
+
+// === Table ===
+static uint32_t keyHash(const byte *uid, byte uidSize) {
+    uint32_t hash = 2166136261UL;
+    for (byte i = 0; i < uidSize; i++) {
+        hash ^= uid[i];
+        hash *= 16777619UL;
+    }
+    return hash ^ uidSize;
+}
+
+// millis() repasse par zéro tous les 49,7 jours : une comparaison signée sur
+// 32 bits rendrait vie à une entrée périmée depuis 24,8 jours
+static uint64_t nowMs() {
+    return micros64() / 1000;
+}
+
+static bool alive(const CacheEntry &entry, uint64_t now) {
+    return entry.uidSize && entry.expiresMs > now;
+}
+
+// Entrée trouvée périmée : case libérée, la décision ne peut plus resservir
+static void expire(CacheEntry &entry) {
+    entry.uidSize = 0;
+    stats.entries--;
+    stats.expired++;
+}
+
+static CacheEntry *find(const byte *uid, byte uidSize) {
+    uint32_t hash = keyHash(uid, uidSize);
+    for (uint32_t i = 0; i < DECISION_CACHE_PROBE; i++) {
+        CacheEntry &entry = table[(hash + i) & CACHE_MASK];
+        if (entry.uidSize == uidSize && memcmp(entry.uid, uid, uidSize) == 0) return &entry;
+    }
+    return nullptr;
+}
+
+// Case pour un nouvel UID : libre ou périmée, sinon la plus proche de l'expiration
+static CacheEntry &slotFor(const byte *uid, byte uidSize, uint64_t now) {
+    uint32_t hash = keyHash(uid, uidSize);
+    CacheEntry *oldest = nullptr;
+    for (uint32_t i = 0; i < DECISION_CACHE_PROBE; i++) {
+        CacheEntry &entry = table[(hash + i) & CACHE_MASK];
+        if (entry.uidSize && !alive(entry, now)) expire(entry);
+        if (!entry.uidSize) {
+            stats.entries++;
+            return entry;
+        }
+        if (!oldest || entry.expiresMs < oldest->expiresMs) oldest = &entry;
+    }
+    stats.evictions++;
+    return *oldest;
+}
+
+static void removeEntry(CacheEntry &entry) {
+    entry.uidSize = 0;
+    stats.entries--;
+    stats.invalidations++;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static byte parseUid(const char *hex, byte *uid) {
+    size_t length = strlen(hex);
+    if (!length || length % 2 || length > 2 * CACHE_UID_MAX) return 0;
+    for (size_t i = 0; i < length; i += 2) {
+        int high = hexDigit(hex[i]);
+        int low = hexDigit(hex[i + 1]);
+        if (high < 0 || low < 0) return 0;
+        uid[i / 2] = (high << 4) | low;
+    }
+    return length / 2;
+}
+
+// === Réponse de l'API ===
+// Mots séparés par '&', ';', ',' ou des blancs : decision=<d>, <d> seul, ttl=<s>
+static bool wordIs(const char *word, size_t length, const char *expected) {
+    return strlen(expected) == length && strncasecmp(word, expected, length) == 0;
+}
+
+static void parseBody(const char *body, size_t length, AclDecision &decision, uint32_t &ttlS) {
+    size_t i = 0;
+    while (i < length) {
+        while (i < length && strchr("&;, \t\r\n", body[i])) i++;
+        size_t start = i;
+        while (i < length && !strchr("&;, \t\r\n", body[i])) i++;
+        const char *word = body + start;
+        size_t wordLength = i - start;
+        if (wordLength > 9 && strncasecmp(word, "decision=", 9) == 0) {
+            word += 9;
+            wordLength -= 9;
+        } else if (wordLength > 4 && strncasecmp(word, "ttl=", 4) == 0) {
+            uint32_t value = 0;
+            for (size_t k = 4; k < wordLength && isdigit((unsigned char)word[k]); k++) {
+                value = min(value * 10 + (word[k] - '0'), (uint32_t)DECISION_TTL_MAX_S);
+            }
+            ttlS = value;
+            continue;
+        }
+        if (wordIs(word, wordLength, "allow")) decision = ACL_ALLOW;
+        else if (wordIs(word, wordLength, "deny")) decision = ACL_DENY;
+    }
+}
+
+// === API ===
+AclDecision decisionCacheLookup(const byte *uid, byte uidSize) {
+    unsigned long start = micros();
+    stats.lookups++;
+    AclDecision decision = ACL_UNKNOWN;
+    CacheEntry *entry = uidSize <= CACHE_UID_MAX ? find(uid, uidSize) : nullptr;
+    if (!entry) {
+        stats.misses++;
+    } else if (!alive(*entry, nowMs())) {
+        expire(*entry);
+    } else {
+        stats.hits++;
+        decision = entry->decision;
+    }
+    stats.lastLookupUs = micros() - start;
+    return decision;
+}
+
+AclDecision decisionCacheLearn(const char *uidHex, int code, const char *body, size_t length) {
+    AclDecision decision = ACL_UNKNOWN;
+    uint32_t ttlS = 0;
+    if (code == 403 || code / 100 == 2) {
+        decision = code == 403 ? ACL_DENY : ACL_ALLOW;
+        parseBody(body, length, decision, ttlS);
+        if (code == 403) decision = ACL_DENY;
+    }
+    byte uid[CACHE_UID_MAX];
+    byte uidSize = parseUid(uidHex, uid);
+    if (decision == ACL_UNKNOWN || !uidSize) return decision;
+
+    uint64_t now = nowMs();
+    CacheEntry *entry = find(uid, uidSize);
+    if (entry && !alive(*entry, now)) {
+        expire(*entry);
+        entry = nullptr;
+    }
+    if (entry && entry->decision != decision) {
+        stats.stale++;
+        serialLog().printf("[Cache] %s : %s en cache, l'API répond %s\n", uidHex, aclDecisionName(entry->decision),
+                           aclDecisionName(decision));
+    }
+    if (!ttlS) {
+        // Décision non réutilisable : l'entrée éventuelle ne doit plus servir
+        if (entry) removeEntry(*entry);
+        return decision;
+    }
+    if (!entry) {
+        entry = &slotFor(uid, uidSize, now);
+        memcpy(entry->uid, uid, uidSize);
+        entry->uidSize = uidSize;
+    }
+    entry->decision = decision;
+    entry->expiresMs = now + ttlS * 1000ULL;
+    stats.stores++;
+    return decision;
+}
+
+bool decisionCacheInvalidate(const char *uidHex) {
+    byte uid[CACHE_UID_MAX];
+    byte uidSize = parseUid(uidHex, uid);
+    CacheEntry *entry = uidSize ? find(uid, uidSize) : nullptr;
+    if (!entry) return false;
+    removeEntry(*entry);
+    return true;
+}
+
+void decisionCacheClear() {
+    for (CacheEntry &entry : table) {
+        if (entry.uidSize) removeEntry(entry);
+    }
+}
+
+const DecisionCacheStats &decisionCacheStats() {
+    return stats;
+}
+
+String decisionCacheStatusJson() {
+    String json;
+    json.reserve(256);
+    json = "{\"slots\":";
+    json += DECISION_CACHE_SLOTS;
+    json += ",\"entries\":";
+    json += stats.entries;
+    json += ",\"lookups\":";
+    json += stats.lookups;
+    json += ",\"hits\":";
+    json += stats.hits;
+    json += ",\"misses\":";
+    json += stats.misses;
+    json += ",\"expired\":";
+    json += stats.expired;
+    json += ",\"hitRatio\":";
+    json += String(stats.lookups ? (float)stats.hits / stats.lookups : 0.0f, 3);
+    json += ",\"stores\":";
+    json += stats.stores;
+    json += ",\"evictions\":";
+    json += stats.evictions;
+    json += ",\"invalidations\":";
+    json += stats.invalidations;
+    json += ",\"stale\":";
+    json += stats.stale;
+    json += ",\"lastLookupUs\":";
+    json += stats.lastLookupUs;
+    json += "}";
+    return json;
+}
@@ -0,0 +1,187 @@
+/*
+ * Cartes ISO 14443-4 : DESFire et NDEF Type 4 sur la couche ISO-DEP
+ */
+#include <iso_card.h>
+#include <iso_dep.h>
+#include <scanner.h>
+#include <hex_util.h>
+#include <ndef_tag.h>
+#include <serial_link.h>
+
+#define SW_OK           0x9000
+#define SW_DESFIRE_OK   0x9100
+#define SW_DESFIRE_MORE 0x91AF
+
+#define DESFIRE_GET_VERSION    0x60
+#define DESFIRE_GET_AIDS       0x6A
+#define DESFIRE_ADDITIONAL     0xAF
+#define DESFIRE_AIDS_SHOWN     8
+
+bool isoDepEnabled = true;
+
+// Réponses APDU (mots d'état compris) et message NDEF : hors de la pile
+static byte response[ISO_DEP_APDU_MAX + 2];
+static uint16_t responseLength = 0;
+static byte ndefMessage[ISO_NDEF_MAX];
+
+bool isoCardHandles(MFRC522::PICC_Type type) {
+    if (!isoDepEnabled) return false;
+    return type == MFRC522::PICC_TYPE_ISO_14443_4 || type == MFRC522::PICC_TYPE_MIFARE_DESFIRE ||
+           type == MFRC522::PICC_TYPE_MIFARE_PLUS || type == MFRC522::PICC_TYPE_ISO_18092 ||
+           type == MFRC522::PICC_TYPE_TNP3XXX;
+}
+
+// APDU complète ; renvoie SW1 SW2 (0 si l'échange a échoué)
+static uint16_t transmit(const byte *apdu, uint16_t length) {
+    responseLength = sizeof(response);
+    if (isoDepTransceive(apdu, length, response, &responseLength) != MFRC522::STATUS_OK || responseLength < 2) {
+        responseLength = 0;
+        return 0;
+    }
+    responseLength -= 2;
+    return (response[responseLength] << 8) | response[responseLength + 1];
+}
+
+// Commande DESFire native encapsulée ISO 7816 (CLA 0x90), sans données
+static uint16_t desfireCommand(byte command) {
+    byte apdu[5] = {0x90, command, 0x00, 0x00, 0x00};
+    return transmit(apdu, sizeof(apdu));
+}
+
+static void appendHex(const char *label, const byte *data, uint16_t length) {
+    char hexStr[3 * 16 + 1];
+    hexEncodeSpaced(data, min(length, (uint16_t)16), hexStr);
+    serialLog().print(label);
+    serialLog().println(hexStr);
+    cardInfoPrintf("%s%s%s<br/>", label, hexStr, length > 16 ? " ..." : "");
+}
+
+// === DESFire ===
+static const char *desfireGeneration(byte major) {
+    switch (major) {
+    case 0x00: return "EV0";
+    case 0x01: return "EV1";
+    case 0x12: return "EV2";
+    case 0x33: return "EV3";
+    default: return "?";
+    }
+}
+
+// GetVersion : trois trames (matériel, logiciel, UID/lot) ; false si la
+// carte n'est pas une DESFire
+static bool readDesfireVersion() {
+    byte hardware[7];
+    if (desfireCommand(DESFIRE_GET_VERSION) != SW_DESFIRE_MORE || responseLength < 7) return false;
+    memcpy(hardware, response, sizeof(hardware));
+    // Vendeur NXP (0x04), type DESFire (0x01) ou DESFire Light (0x08)
+    if (hardware[0] != 0x04 || (hardware[1] != 0x01 && hardware[1] != 0x08)) return false;
+    if (desfireCommand(DESFIRE_ADDITIONAL) != SW_DESFIRE_MORE) return false;
+    byte software[2] = {response[3], response[4]};
+    if (desfireCommand(DESFIRE_ADDITIONAL) != SW_DESFIRE_OK || responseLength < 14) return false;
+    // Taille : 2^(n/2) octets, n impair = entre deux puissances
+    uint32_t storage = 1UL << (hardware[5] >> 1);
+    serialLog().printf("DESFire %s, %lu octets\n", desfireGeneration(hardware[3]), (unsigned long)storage);
+    cardInfoPrintf("<b>MIFARE DESFire %s</b> (%lu octets, logiciel %u.%u)<br/>", desfireGeneration(hardware[3]),
+                   (unsigned long)storage, software[0], software[1]);
+    appendHex("Lot:", response + 7, 5);
+    return true;
+}
+
+static void readDesfireApplications() {
+    uint16_t sw = desfireCommand(DESFIRE_GET_AIDS);
+    uint16_t count = 0;
+    cardInfoAppend("Applications:");
+    serialLog().print("Applications:");
+    while (sw == SW_DESFIRE_OK || sw == SW_DESFIRE_MORE) {
+        for (uint16_t i = 0; i + 3 <= responseLength; i += 3, count++) {
+            if (count >= DESFIRE_AIDS_SHOWN) continue;
+            // AID sur 3 octets, poids faible en premier
+            uint32_t aid = response[i] | (response[i + 1] << 8) | ((uint32_t)response[i + 2] << 16);
+            char aidStr[8];
+            snprintf(aidStr, sizeof(aidStr), " %06lX", (unsigned long)aid);
+            serialLog().print(aidStr);
+            cardInfoAppend(aidStr);
+        }
+        if (sw == SW_DESFIRE_OK) break;
+        sw = desfireCommand(DESFIRE_ADDITIONAL);
+    }
+    if (sw == 0) {
+        cardInfoAppend(" (lecture échouée)");
+    } else if (count == 0) {
+        cardInfoAppend(" aucune");
+    } else if (count > DESFIRE_AIDS_SHOWN) {
+        cardInfoPrintf(" ... (%u)", count);
+    }
+    cardInfoAppend("<br/>");
+    serialLog().printf(" (%u)\n", count);
+}
+
+// === NDEF Type 4 ===
+static bool selectFile(uint16_t fileId) {
+    byte apdu[7] = {0x00, 0xA4, 0x00, 0x0C, 0x02, (byte)(fileId >> 8), (byte)fileId};
+    return transmit(apdu, sizeof(apdu)) == SW_OK;
+}
+
+static bool readBinary(uint16_t offset, byte length) {
+    byte apdu[5] = {0x00, 0xB0, (byte)(offset >> 8), (byte)offset, length};
+    return transmit(apdu, sizeof(apdu)) == SW_OK && responseLength == length;
+}
+
+// Application NDEF, fichier CC, puis fichier NDEF lu par morceaux de MLe
+static void readType4Ndef() {
+    static const byte selectApp[13] = {0x00, 0xA4, 0x04, 0x00, 0x07, 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01, 0x00};
+    if (transmit(selectApp, sizeof(selectApp)) != SW_OK) {
+        cardInfoAppend("Pas d'application NDEF<br/>");
+        serialLog().println("Pas d'application NDEF");
+        return;
+    }
+    if (!selectFile(0xE103) || !readBinary(0, 15) || response[7] != 0x04) {
+        cardInfoAppend("NDEF : fichier CC illisible<br/>");
+        return;
+    }
+    uint16_t maxRead = (response[3] << 8) | response[4];
+    uint16_t fileId = (response[9] << 8) | response[10];
+    // Trame de réponse bornée par notre tampon et par le champ Le (un octet)
+    maxRead = min(maxRead, (uint16_t)min(ISO_DEP_APDU_MAX, 255));
+    if (!selectFile(fileId) || !readBinary(0, 2)) {
+        cardInfoAppend("NDEF : fichier illisible<br/>");
+        return;
+    }
+    uint16_t messageLength = (response[0] << 8) | response[1];
+    uint16_t wanted = min(messageLength, (uint16_t)ISO_NDEF_MAX);
+    uint16_t done = 0;
+    while (done < wanted) {
+        byte chunk = min((uint16_t)(wanted - done), maxRead);
+        if (!readBinary(2 + done, chunk)) break;
+        memcpy(ndefMessage + done, response, chunk);
+        done += chunk;
+    }
+    serialLog().printf("NDEF Type 4: %u octets\n", messageLength);
+    cardInfoPrintf("<b>NDEF Type 4</b> : %u octets%s<br/>", messageLength, done < messageLength ? " (tronqué)" : "");
+    appendNdefRecords(ndefMessage, done);
+}
+
+void appendIsoCardDump(MFRC522::PICC_Type type) {
+    if (type != MFRC522::PICC_TYPE_ISO_14443_4 && type != MFRC522::PICC_TYPE_MIFARE_DESFIRE) {
+        // Ni ISO-DEP ni secteurs Classic : aucun échange tenté
+        isoDepSkipped();
+        serialLog().println("Carte non supportée (SAK), lecture ignorée");
+        cardInfoAppend("<b>Carte non supportée pour la lecture mémoire (SAK)</b><br/>");
+        return;
+    }
+    serialLog().println("--- Lecture ISO 14443-4 ---");
+    IsoDepAts ats;
+    if (!isoDepActivate(mfrc522, ats)) {
+        isoDepSkipped();
+        serialLog().println("RATS sans réponse");
+        cardInfoAppend("<b>ISO 14443-4 : RATS sans réponse</b><br/>");
+        return;
+    }
+    cardInfoPrintf("ISO-DEP %u kbit/s, trame %u octets<br/>", isoDepBitrate(), ats.fsc);
+    appendHex("ATS:", ats.raw, ats.length);
+    if (readDesfireVersion()) {
+        readDesfireApplications();
+    }
+    readType4Ndef();
+    isoDepDeselect();
+}
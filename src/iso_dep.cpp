@@ -0,0 +1,263 @@
+/*
+ * Couche ISO-DEP (ISO/IEC 14443-4) : RATS, PPS, blocs I/R/S chaînés
+ */
+#include <iso_dep.h>
+#include <rf_tuning.h>
+#include <settings.h>
+
+// Octets de contrôle (PCB), sans CID ni NAD
+#define PCB_I_BLOCK   0x02
+#define PCB_CHAINING  0x10
+#define PCB_R_ACK     0xA2
+#define PCB_R_NAK     0xB2
+#define PCB_S_DESELECT 0xC2
+#define PCB_S_WTX     0xF2
+
+#define RATS_FSDI     5      // FSD = 64 octets
+#define FWT_UNIT_US   302    // 256 x 16 / fc
+
+static const uint16_t fscTable[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+// Largeur de modulation du lecteur par débit (ModWidthReg, note NXP AN10834)
+static const byte modWidth[4] = {0x26, 0x15, 0x0A, 0x05};
+
+static MFRC522 *pcd = nullptr;
+static IsoDepStats stats;
+static byte blockNumber = 0;
+static uint16_t frameInf = 0;        // octets utiles par bloc I
+static uint16_t sessionReload = 0;   // timer réglé sur FWT
+static byte dsi = 0;                 // débit carte -> lecteur : 106 x 2^dsi
+static byte dri = 0;
+
+static bool isIBlock(byte pcb) {
+    return (pcb & 0xE2) == 0x02;
+}
+
+static bool isRAck(byte pcb) {
+    return (pcb & 0xF6) == 0xA2;
+}
+
+static void setTimer(uint16_t reload) {
+    pcd->PCD_WriteRegister(MFRC522::TReloadRegH, reload >> 8);
+    pcd->PCD_WriteRegister(MFRC522::TReloadRegL, reload & 0xFF);
+}
+
+// Débit et CRC matériel : TxCRCEn/RxCRCEn (bit 7) et vitesse (bits 6..4)
+static void setLink(byte sendIndex, byte receiveIndex, bool hardwareCrc) {
+    byte crc = hardwareCrc ? 0x80 : 0x00;
+    pcd->PCD_WriteRegister(MFRC522::TxModeReg, crc | (sendIndex << 4));
+    pcd->PCD_WriteRegister(MFRC522::RxModeReg, crc | (receiveIndex << 4));
+    pcd->PCD_WriteRegister(MFRC522::ModWidthReg, modWidth[sendIndex]);
+}
+
+static MFRC522::StatusCode frame(const byte *tx, byte txLength, byte *rx, byte *rxLength) {
+    stats.frames++;
+    return pcd->PCD_TransceiveData(const_cast<byte *>(tx), txLength, rx, rxLength);
+}
+
+// Un bloc émis, une réponse exploitable : S(WTX) acquittés, R(NAK) après un
+// timeout, bloc I renvoyé si la carte signale par R(ACK) ne pas l'avoir reçu
+static MFRC522::StatusCode exchangeBlock(const byte *tx, byte txLength, byte *rx, byte *rxLength) {
+    const byte *current = tx;
+    byte currentLength = txLength;
+    byte control[2];
+    byte retries = ISO_DEP_RETRIES;       // trames perdues
+    byte resent = 0;                      // blocs renvoyés sur R(ACK)
+    bool extended = false;
+    byte capacity = *rxLength;
+    while (true) {
+        byte length = capacity;
+        MFRC522::StatusCode status = frame(current, currentLength, rx, &length);
+        if (extended) {
+            setTimer(sessionReload);
+            extended = false;
+        }
+        if (status == MFRC522::STATUS_OK && length >= 1) {
+            if ((rx[0] & 0xF7) == PCB_S_WTX && length >= 2) {
+                // Carte occupée : FWT multiplié par WTXM pour la réponse suivante
+                byte wtxm = rx[1] & 0x3F;
+                stats.waitExtensions++;
+                setTimer(min((uint32_t)sessionReload * (wtxm ? wtxm : 1), (uint32_t)0xFFFF));
+                extended = true;
+                control[0] = PCB_S_WTX;
+                control[1] = wtxm;
+                current = control;
+                currentLength = 2;
+                continue;
+            }
+            if (isRAck(rx[0]) && (rx[0] & 0x01) != blockNumber) {
+                // Réponse à notre R(NAK) : le dernier bloc n'a pas été reçu
+                if (++resent > ISO_DEP_RETRIES) return MFRC522::STATUS_ERROR;
+                stats.retransmissions++;
+                current = tx;
+                currentLength = txLength;
+                continue;
+            }
+            *rxLength = length;
+            return MFRC522::STATUS_OK;
+        }
+        if (retries-- == 0) return status == MFRC522::STATUS_OK ? MFRC522::STATUS_ERROR : status;
+        stats.retransmissions++;
+        control[0] = PCB_R_NAK | blockNumber;
+        current = control;
+        currentLength = 1;
+    }
+}
+
+static void parseAts(IsoDepAts &ats) {
+    byte *raw = ats.raw;
+    byte t0 = ats.length > 1 ? raw[1] : 0x02;
+    byte index = 2;
+    byte fsci = min((byte)(t0 & 0x0F), (byte)8);
+    ats.fsc = fscTable[fsci];
+    ats.fwi = 4;
+    ats.dsMask = ats.drMask = 0;
+    ats.sameDivisor = false;
+    if ((t0 & 0x10) && index < ats.length) {
+        byte ta = raw[index++];
+        ats.sameDivisor = ta & 0x80;
+        ats.dsMask = (ta >> 4) & 0x07;
+        ats.drMask = ta & 0x07;
+    }
+    if ((t0 & 0x20) && index < ats.length) {
+        byte tb = raw[index++];
+        if ((tb >> 4) != 15) ats.fwi = tb >> 4;
+        // SFGT : délai imposé avant la trame suivante
+        if (tb & 0x0F) delayMicroseconds((uint32_t)FWT_UNIT_US << (tb & 0x0F));
+    }
+    if ((t0 & 0x40) && index < ats.length) index++;
+    ats.historical = raw + index;
+    ats.historicalLength = ats.length > index ? ats.length - index : 0;
+}
+
+// Indice du plus haut débit proposé (0 : 106 kbit/s) dans la limite fixée
+static byte bestIndex(byte mask) {
+    byte limit = ISO_DEP_MAX_DIVISOR >= 8 ? 3 : (ISO_DEP_MAX_DIVISOR >= 4 ? 2 : (ISO_DEP_MAX_DIVISOR >= 2 ? 1 : 0));
+    for (byte index = limit; index > 0; index--) {
+        if (mask & (1 << (index - 1))) return index;
+    }
+    return 0;
+}
+
+bool isoDepActivate(MFRC522 &reader, IsoDepAts &ats) {
+    pcd = &reader;
+    blockNumber = 0;
+    dsi = dri = 0;
+    sessionReload = rfTimerReload;
+    setLink(0, 0, true);
+    byte rats[2] = {0xE0, RATS_FSDI << 4};
+    byte length = 0;
+    bool answered = false;
+    for (byte attempt = 0; attempt <= ISO_DEP_RETRIES && !answered; attempt++) {
+        length = sizeof(ats.raw);
+        answered = frame(rats, sizeof(rats), ats.raw, &length) == MFRC522::STATUS_OK && length >= 1 &&
+                   ats.raw[0] <= length;
+    }
+    if (!answered) {
+        setLink(0, 0, false);
+        return false;
+    }
+    ats.length = ats.raw[0];
+    parseAts(ats);
+    stats.activations++;
+    frameInf = min(ats.fsc, (uint16_t)ISO_DEP_FSD) - 3;   // PCB + CRC
+    // FWT avec marge ; la bibliothèque abandonne de toute façon après 36 ms,
+    // les commandes plus longues passent par S(WTX)
+    uint32_t fwtUs = (uint32_t)FWT_UNIT_US << ats.fwi;
+    sessionReload = min((fwtUs + fwtUs / 4) / 25 + 40, (uint32_t)0xFFFF);
+    setTimer(sessionReload);
+
+    byte ds = ats.sameDivisor ? bestIndex(ats.dsMask & ats.drMask) : bestIndex(ats.dsMask);
+    byte dr = ats.sameDivisor ? ds : bestIndex(ats.drMask);
+    if (ds || dr) {
+        byte pps[3] = {0xD0, 0x11, (byte)((ds << 2) | dr)};
+        byte response[3];
+        byte responseLength = sizeof(response);
+        if (frame(pps, sizeof(pps), response, &responseLength) == MFRC522::STATUS_OK && responseLength >= 1 &&
+            response[0] == 0xD0) {
+            dsi = ds;
+            dri = dr;
+            setLink(dri, dsi, true);
+            stats.ppsOk++;
+        }
+    }
+    return true;
+}
+
+uint16_t isoDepBitrate() {
+    return 106 << dsi;
+}
+
+MFRC522::StatusCode isoDepTransceive(const byte *apdu, uint16_t apduLength, byte *response,
+                                     uint16_t *responseLength) {
+    byte tx[ISO_DEP_FSD];
+    byte rx[ISO_DEP_FSD];
+    byte rxLength;
+    uint16_t capacity = *responseLength;
+    uint16_t sent = 0;
+    *responseLength = 0;
+    stats.apdus++;
+    // Commande : blocs I chaînés, chacun acquitté par R(ACK)
+    while (true) {
+        uint16_t chunk = min((uint16_t)(apduLength - sent), frameInf);
+        bool more = sent + chunk < apduLength;
+        tx[0] = PCB_I_BLOCK | blockNumber | (more ? PCB_CHAINING : 0);
+        memcpy(tx + 1, apdu + sent, chunk);
+        rxLength = sizeof(rx);
+        MFRC522::StatusCode status = exchangeBlock(tx, chunk + 1, rx, &rxLength);
+        if (status != MFRC522::STATUS_OK) {
+            stats.errors++;
+            return status;
+        }
+        sent += chunk;
+        if (!more) break;
+        if (!isRAck(rx[0])) {
+            stats.errors++;
+            return MFRC522::STATUS_ERROR;
+        }
+        blockNumber ^= 1;
+    }
+    // Réponse : blocs I chaînés, chacun réclamé par R(ACK)
+    while (true) {
+        if (!isIBlock(rx[0]) || (rx[0] & 0x01) != blockNumber) {
+            stats.errors++;
+            return MFRC522::STATUS_ERROR;
+        }
+        blockNumber ^= 1;
+        uint16_t inf = rxLength - 1;
+        if (*responseLength + inf > capacity) {
+            stats.errors++;
+            return MFRC522::STATUS_NO_ROOM;
+        }
+        memcpy(response + *responseLength, rx + 1, inf);
+        *responseLength += inf;
+        if (!(rx[0] & PCB_CHAINING)) return MFRC522::STATUS_OK;
+        tx[0] = PCB_R_ACK | blockNumber;
+        rxLength = sizeof(rx);
+        MFRC522::StatusCode status = exchangeBlock(tx, 1, rx, &rxLength);
+        if (status != MFRC522::STATUS_OK) {
+            stats.errors++;
+            return status;
+        }
+    }
+}
+
+void isoDepDeselect() {
+    if (!pcd) return;
+    byte deselect = PCB_S_DESELECT;
+    byte response[2];
+    byte length = sizeof(response);
+    frame(&deselect, 1, response, &length);
+    // Retour aux réglages de la bibliothèque pour les commandes MIFARE
+    setLink(0, 0, false);
+    rfApply(rfGain, rfTimerReload);
+    dsi = dri = 0;
+    pcd = nullptr;
+}
+
+const IsoDepStats &isoDepStats() {
+    return stats;
+}
+
+void isoDepSkipped() {
+    stats.skipped++;
+}
@@ -0,0 +1,97 @@
+/*
+ * Trames de la liaison série binaire : COBS, CRC-16, décodage incrémental
+ */
+#include <link_frame.h>
+#include <string.h>
+
+uint16_t linkCrc16(const uint8_t *data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// === Codage ===
+size_t linkEncode(const uint8_t *payload, size_t length, uint8_t *out, size_t size) {
+    if (length < LINK_HEADER_SIZE || length > LINK_PAYLOAD_MAX || size < LINK_FRAME_MAX) return 0;
+    uint16_t crc = linkCrc16(payload, length);
+    uint8_t crcBytes[LINK_CRC_SIZE];
+    linkPut16(crcBytes, crc);
+    size_t n = 0;
+    out[n++] = 0x00;
+    // Code du bloc courant écrit après coup, à la position réservée
+    size_t codeAt = n++;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length + LINK_CRC_SIZE; i++) {
+        uint8_t c = i < length ? payload[i] : crcBytes[i - length];
+        if (c == 0) {
+            out[codeAt] = code;
+            codeAt = n++;
+            code = 1;
+            continue;
+        }
+        out[n++] = c;
+        if (++code == 0xFF) {
+            out[codeAt] = code;
+            codeAt = n++;
+            code = 1;
+        }
+    }
+    out[codeAt] = code;
+    out[n++] = 0x00;
+    return n;
+}
+
+// === Décodage ===
+void linkDecoderReset(LinkDecoder &decoder) {
+    decoder.length = 0;
+    decoder.remaining = 0;
+    decoder.block = 0;
+    decoder.overflow = false;
+}
+
+static void append(LinkDecoder &decoder, uint8_t c) {
+    if (decoder.length < sizeof(decoder.buf)) {
+        decoder.buf[decoder.length++] = c;
+    } else {
+        decoder.overflow = true;
+    }
+}
+
+LinkFeed linkDecoderFeed(LinkDecoder &decoder, uint8_t byte) {
+    if (byte == 0x00) {
+        // Délimiteur : fin de trame, ou simple séparateur si rien n'a été reçu
+        if (decoder.block == 0) return LINK_NONE;
+        LinkFeed result = LINK_ERROR;
+        if (decoder.remaining || decoder.overflow || decoder.length < LINK_HEADER_SIZE + LINK_CRC_SIZE) {
+            decoder.framingErrors++;
+        } else if (linkCrc16(decoder.buf, decoder.length - LINK_CRC_SIZE) !=
+                   linkGet16(decoder.buf + decoder.length - LINK_CRC_SIZE)) {
+            decoder.crcErrors++;
+        } else {
+            decoder.frames++;
+            result = LINK_FRAME;
+        }
+        size_t length = decoder.length - LINK_CRC_SIZE;
+        linkDecoderReset(decoder);
+        // La trame reste lisible dans buf jusqu'au prochain octet
+        if (result == LINK_FRAME) decoder.length = length;
+        return result;
+    }
+    if (decoder.remaining) {
+        append(decoder, byte);
+        decoder.remaining--;
+        return LINK_NONE;
+    }
+    // Nouveau code COBS : le bloc précédent se terminait par un zéro implicite
+    // (sauf bloc plein de 254 octets) ; premier code : la trame précédente,
+    // encore lisible dans buf, est abandonnée
+    if (decoder.block == 0) decoder.length = 0;
+    else if (decoder.block != 0xFF) append(decoder, 0x00);
+    decoder.block = byte;
+    decoder.remaining = byte - 1;
+    return LINK_NONE;
+}
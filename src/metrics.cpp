@@ -0,0 +1,303 @@
+/*
+ * Histogrammes de latence et compteurs, rendu Prometheus
+ */
+#include <ESP8266WiFi.h>
+#include <metrics.h>
+#include <scan_pipeline.h>
+#include <sector_access.h>
+#include <rc522_health.h>
+#include <iso_dep.h>
+#include <ndef_tag.h>
+#include <provisioning.h>
+#include <serial_link.h>
+#include <mqtt_client.h>
+#include <coap_uplink.h>
+#include <upload_outbox.h>
+#include <decision_cache.h>
+
+static Histogram stageHistograms[STAGE_COUNT];
+static Histogram loopInterval;
+static Histogram loopJitter;
+static Histogram webHandler;
+static uint32_t uploadsSuccess = 0;
+static uint32_t uploadsFailure = 0;
+static unsigned long lastLoopUs = 0;
+static uint32_t lastIntervalUs = 0;
+static unsigned long webRequestStartUs = 0;
+static bool webRequestPending = false;
+
+static const char *const stageNames[STAGE_COUNT] = {
+    "detect", "select", "type", "memory", "upload", "feedback", "log"
+};
+
+void histogramRecord(Histogram &h, uint32_t us) {
+    uint8_t index = 0;
+    if (us > (1UL << METRICS_FIRST_BUCKET_LOG2)) {
+        // ceil(log2(us)) - 6, le dernier seau absorbe tout le reste
+        index = 32 - __builtin_clz(us - 1) - METRICS_FIRST_BUCKET_LOG2;
+        if (index >= METRICS_BUCKETS) index = METRICS_BUCKETS - 1;
+    }
+    h.buckets[index]++;
+    h.count++;
+    h.sumUs += us;
+}
+
+void metricsStage(MetricStage stage, uint32_t us) {
+    histogramRecord(stageHistograms[stage], us);
+}
+
+// Appelé en tête de loop() : période d'itération et écart avec la précédente
+void metricsLoopTick() {
+    unsigned long now = micros();
+    if (lastLoopUs != 0) {
+        uint32_t interval = now - lastLoopUs;
+        histogramRecord(loopInterval, interval);
+        if (lastIntervalUs != 0) {
+            histogramRecord(loopJitter, interval > lastIntervalUs ? interval - lastIntervalUs : lastIntervalUs - interval);
+        }
+        lastIntervalUs = interval;
+    }
+    lastLoopUs = now;
+}
+
+void metricsWebRequestStart() {
+    webRequestStartUs = micros();
+    webRequestPending = true;
+}
+
+void metricsWebRequestEnd() {
+    if (!webRequestPending) return;
+    webRequestPending = false;
+    histogramRecord(webHandler, micros() - webRequestStartUs);
+}
+
+void metricsUpload(bool success) {
+    if (success) uploadsSuccess++;
+    else uploadsFailure++;
+}
+
+// === Rendu ===
+static void appendSeconds(String &out, uint64_t us) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%lu.%06lu", (unsigned long)(us / 1000000), (unsigned long)(us % 1000000));
+    out += buf;
+}
+
+static void appendFamily(String &out, const char *name, const char *type, const char *help) {
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+}
+
+static void sendHistogram(ESP8266WebServer &server, const char *name, const char *label, const Histogram &h) {
+    String out;
+    out.reserve(1024);
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < METRICS_BUCKETS; i++) {
+        cumulative += h.buckets[i];
+        out += name;
+        out += "_bucket{";
+        if (label) {
+            out += label;
+            out += ",";
+        }
+        out += "le=\"";
+        if (i == METRICS_BUCKETS - 1) out += "+Inf";
+        else appendSeconds(out, 1ULL << (i + METRICS_FIRST_BUCKET_LOG2));
+        out += "\"} ";
+        out += cumulative;
+        out += "\n";
+    }
+    const char *suffixes[] = {"_sum", "_count"};
+    for (uint8_t s = 0; s < 2; s++) {
+        out += name;
+        out += suffixes[s];
+        if (label) {
+            out += "{";
+            out += label;
+            out += "}";
+        }
+        out += " ";
+        if (s == 0) appendSeconds(out, h.sumUs);
+        else out += h.count;
+        out += "\n";
+    }
+    server.sendContent(out);
+}
+
+static void appendGauge(String &out, const char *name, const char *type, const char *help, long value) {
+    appendFamily(out, name, type, help);
+    out += name;
+    out += " ";
+    out += value;
+    out += "\n";
+}
+
+// Envoi en plusieurs morceaux pour ne jamais construire toute la page en RAM
+void metricsSend(ESP8266WebServer &server) {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+
+    String head;
+    head.reserve(160);
+    appendFamily(head, "rfid_stage_duration_seconds", "histogram", "Durée de chaque étape d'un scan");
+    server.sendContent(head);
+    for (uint8_t s = 0; s < STAGE_COUNT; s++) {
+        String label = String("stage=\"") + stageNames[s] + "\"";
+        sendHistogram(server, "rfid_stage_duration_seconds", label.c_str(), stageHistograms[s]);
+        yield();
+    }
+
+    head = "";
+    appendFamily(head, "rfid_loop_interval_seconds", "histogram", "Période des itérations de loop()");
+    server.sendContent(head);
+    sendHistogram(server, "rfid_loop_interval_seconds", nullptr, loopInterval);
+    head = "";
+    appendFamily(head, "rfid_loop_jitter_seconds", "histogram", "Écart entre deux périodes successives de loop()");
+    server.sendContent(head);
+    sendHistogram(server, "rfid_loop_jitter_seconds", nullptr, loopJitter);
+    head = "";
+    appendFamily(head, "rfid_web_handler_duration_seconds", "histogram", "Durée de traitement des requêtes web");
+    server.sendContent(head);
+    sendHistogram(server, "rfid_web_handler_duration_seconds", nullptr, webHandler);
+
+    const PipelineStats &pipeline = scanPipelineStats();
+    head = "";
+    appendFamily(head, "rfid_pipeline_wait_seconds", "histogram", "Attente dans les files du pipeline de scan");
+    server.sendContent(head);
+    sendHistogram(server, "rfid_pipeline_wait_seconds", "queue=\"captured\"", pipeline.uploadWait);
+    sendHistogram(server, "rfid_pipeline_wait_seconds", "queue=\"decided\"", pipeline.feedbackWait);
+    head = "";
+    appendFamily(head, "rfid_pipeline_end_to_end_seconds", "histogram", "Capture de la carte -> retour buzzer");
+    server.sendContent(head);
+    sendHistogram(server, "rfid_pipeline_end_to_end_seconds", nullptr, pipeline.endToEnd);
+
+    String out;
+    out.reserve(1024);
+    appendFamily(out, "rfid_api_uploads_total", "counter", "Envois d'UID à l'API par résultat");
+    out += "rfid_api_uploads_total{result=\"success\"} ";
+    out += uploadsSuccess;
+    out += "\nrfid_api_uploads_total{result=\"failure\"} ";
+    out += uploadsFailure;
+    out += "\n";
+    appendGauge(out, "rfid_scans_total", "counter", "Cartes sélectionnées", stageHistograms[STAGE_SELECT].count);
+    appendFamily(out, "rfid_pipeline_queue_depth", "gauge", "Événements en attente par file");
+    out += "rfid_pipeline_queue_depth{queue=\"captured\"} ";
+    out += pipeline.capturedDepth;
+    out += "\nrfid_pipeline_queue_depth{queue=\"decided\"} ";
+    out += pipeline.decidedDepth;
+    out += "\n";
+    appendFamily(out, "rfid_pipeline_queue_high_water", "gauge", "Profondeur maximale atteinte par file");
+    out += "rfid_pipeline_queue_high_water{queue=\"captured\"} ";
+    out += pipeline.capturedHighWater;
+    out += "\nrfid_pipeline_queue_high_water{queue=\"decided\"} ";
+    out += pipeline.decidedHighWater;
+    out += "\n";
+    appendGauge(out, "rfid_pipeline_drops_total", "counter", "Scans hors file (capture pleine), renvoyés par la boîte d'envoi", pipeline.drops);
+    appendGauge(out, "rfid_pipeline_completed_total", "counter", "Scans arrivés au retour buzzer", pipeline.completed);
+    appendGauge(out, "rfid_pipeline_cached_feedback_total", "counter", "Retours donnés depuis le cache, avant l'envoi",
+                pipeline.cachedFeedback);
+    appendGauge(out, "rfid_pipeline_published_total", "counter", "Scans publiés par MQTT, retour neutre sans décision",
+                pipeline.published);
+    const AccessStats &access = accessStats();
+    appendFamily(out, "rfid_access_skipped_total", "counter", "Opérations interdites par les bits d'accès, évitées");
+    out += "rfid_access_skipped_total{op=\"auth\"} ";
+    out += access.skippedAuths;
+    out += "\nrfid_access_skipped_total{op=\"read\"} ";
+    out += access.skippedReads;
+    out += "\nrfid_access_skipped_total{op=\"write\"} ";
+    out += access.skippedWrites;
+    out += "\n";
+    appendGauge(out, "rfid_access_trailers_read_total", "counter", "Trailers lus et décodés", access.trailersRead);
+    appendGauge(out, "rfid_access_cache_hits_total", "counter", "Secteurs planifiés depuis le cache", access.cacheHits);
+    appendGauge(out, "rfid_access_auth_failures_total", "counter", "Authentifications clé A refusées",
+                access.failedAuths);
+    const Rc522HealthStats &rc522 = rc522HealthStats();
+    appendGauge(out, "rfid_rc522_healthy", "gauge", "RC522 sain à la dernière sonde", rc522.healthy ? 1 : 0);
+    appendGauge(out, "rfid_rc522_faults_total", "counter", "Dérives du RC522 détectées", rc522.faults);
+    appendGauge(out, "rfid_rc522_recoveries_total", "counter", "Reprises du RC522 réussies", rc522.recoveries);
+    appendGauge(out, "rfid_rc522_failed_recoveries_total", "counter", "Tentatives de reprise sans effet",
+                rc522.failedRecoveries);
+    appendGauge(out, "rfid_rc522_hard_resets_total", "counter", "Resets matériels par RST", rc522.hardResets);
+    appendFamily(out, "rfid_rc522_last_recovery_seconds", "gauge", "Durée de la dernière reprise");
+    out += "rfid_rc522_last_recovery_seconds ";
+    appendSeconds(out, rc522.lastRecoveryUs);
+    out += "\n";
+    const IsoDepStats &iso = isoDepStats();
+    appendGauge(out, "rfid_isodep_activations_total", "counter", "Cartes activées par RATS", iso.activations);
+    appendGauge(out, "rfid_isodep_pps_total", "counter", "Débits relevés par PPS", iso.ppsOk);
+    appendGauge(out, "rfid_isodep_apdus_total", "counter", "APDU échangées", iso.apdus);
+    appendGauge(out, "rfid_isodep_retransmissions_total", "counter", "Blocs repris (R(NAK), renvoi)",
+                iso.retransmissions);
+    appendGauge(out, "rfid_isodep_errors_total", "counter", "APDU abandonnées", iso.errors);
+    appendGauge(out, "rfid_isodep_skipped_total", "counter", "Cartes non supportées écartées", iso.skipped);
+    const NdefStats &ndef = ndefStats();
+    appendGauge(out, "rfid_ndef_messages_total", "counter", "Messages NDEF lus", ndef.messages);
+    appendGauge(out, "rfid_ndef_records_total", "counter", "Enregistrements NDEF décodés", ndef.records);
+    appendGauge(out, "rfid_ndef_malformed_total", "counter", "Messages NDEF malformés ou incomplets", ndef.malformed);
+    appendGauge(out, "rfid_ndef_writes_total", "counter", "Messages NDEF écrits et vérifiés", ndef.writes);
+    appendGauge(out, "rfid_ndef_write_failures_total", "counter", "Écritures NDEF échouées", ndef.writeFailures);
+    const ProvisionStats &provision = provisionStats();
+    appendGauge(out, "rfid_provision_written_total", "counter", "Cartes encodées et vérifiées", provision.written);
+    appendGauge(out, "rfid_provision_failures_total", "counter", "Encodages échoués", provision.failures);
+    appendGauge(out, "rfid_provision_rejected_total", "counter", "Cartes refusées (déjà encodées ou non vierges)",
+                provision.duplicates + provision.notBlank);
+    appendGauge(out, "rfid_provision_remaining", "gauge", "Entrées restant dans la file", provision.queued - provision.next);
+    appendGauge(out, "rfid_provision_cards_per_hour", "gauge", "Débit d'encodage", provisionCardsPerHour());
+    const SerialLinkStats &link = serialLinkStats();
+    appendGauge(out, "rfid_serial_binary", "gauge", "Liaison série en trames binaires", link.binary ? 1 : 0);
+    appendGauge(out, "rfid_serial_baud", "gauge", "Débit du port série", link.baud);
+    appendGauge(out, "rfid_serial_frames_in_total", "counter", "Trames reçues de l'hôte", link.framesIn);
+    appendGauge(out, "rfid_serial_frames_out_total", "counter", "Trames émises vers l'hôte", link.framesOut);
+    appendGauge(out, "rfid_serial_frame_errors_total", "counter", "Trames reçues rejetées (CRC, COBS)",
+                link.crcErrors + link.framingErrors);
+    appendGauge(out, "rfid_serial_lines_total", "counter", "Commandes texte reçues", link.lines);
+    const MqttStats &mqtt = mqttStats();
+    appendGauge(out, "rfid_mqtt_connected", "gauge", "Session MQTT ouverte", mqtt.connected ? 1 : 0);
+    appendGauge(out, "rfid_mqtt_published_total", "counter", "Scans publiés par MQTT", mqtt.published);
+    appendGauge(out, "rfid_mqtt_acked_total", "counter", "PUBACK reçus", mqtt.acked);
+    appendGauge(out, "rfid_mqtt_resent_total", "counter", "Publications renvoyées après reconnexion", mqtt.resent);
+    appendGauge(out, "rfid_mqtt_overflows_total", "counter", "File MQTT pleine, scan envoyé en HTTP", mqtt.overflows);
+    appendGauge(out, "rfid_mqtt_inflight", "gauge", "Publications en attente de PUBACK", mqtt.inflight);
+    appendGauge(out, "rfid_mqtt_ack_microseconds", "gauge", "Dernier délai publication -> PUBACK", mqtt.lastAckUs);
+    appendGauge(out, "rfid_mqtt_commands_total", "counter", "Commandes reçues par MQTT", mqtt.commands);
+    const CoapStats &coap = coapStats();
+    appendGauge(out, "rfid_coap_requests_total", "counter", "Scans envoyés en CoAP confirmable", coap.requests);
+    appendGauge(out, "rfid_coap_retransmits_total", "counter", "Datagrammes CoAP renvoyés faute d'ACK",
+                coap.retransmits);
+    appendGauge(out, "rfid_coap_timeouts_total", "counter", "Échanges CoAP sans réponse", coap.timeouts);
+    appendGauge(out, "rfid_coap_duplicates_total", "counter", "ACK et réponses CoAP en double ignorés",
+                coap.duplicates);
+    appendGauge(out, "rfid_coap_rtt_microseconds", "gauge", "Dernier délai envoi -> décision CoAP", coap.lastRttUs);
+    const OutboxStats &outbox = outboxStats();
+    appendGauge(out, "rfid_outbox_pending", "gauge", "Scans non acquittés gardés en flash", outbox.pending);
+    appendGauge(out, "rfid_outbox_watermark", "gauge", "Séquence jusqu'à laquelle tout est acquitté", outbox.watermark);
+    appendGauge(out, "rfid_outbox_replayed_total", "counter", "Scans renvoyés avec la même clé d'idempotence",
+                outbox.replayed);
+    appendGauge(out, "rfid_outbox_failures_total", "counter", "Envois sans acquittement (réseau, 5xx)",
+                outbox.failures);
+    appendGauge(out, "rfid_outbox_dropped_total", "counter", "Boîte d'envoi pleine, scan abandonné", outbox.dropped);
+    appendGauge(out, "rfid_outbox_state_writes_total", "counter", "Écritures de la séquence et du filigrane",
+                outbox.stateWrites);
+    const DecisionCacheStats &cache = decisionCacheStats();
+    appendGauge(out, "rfid_decision_cache_entries", "gauge", "Décisions de l'API en cache", cache.entries);
+    appendGauge(out, "rfid_decision_cache_hits_total", "counter", "Badges servis depuis le cache", cache.hits);
+    appendGauge(out, "rfid_decision_cache_misses_total", "counter", "Badges absents du cache ou expirés",
+                cache.misses + cache.expired);
+    appendGauge(out, "rfid_decision_cache_stale_total", "counter", "Réponses contraires à la décision en cache",
+                cache.stale);
+    appendGauge(out, "rfid_heap_free_bytes", "gauge", "Tas libre", ESP.getFreeHeap());
+    appendGauge(out, "rfid_heap_max_free_block_bytes", "gauge", "Plus grand bloc libre (fragmentation)",
+                ESP.getMaxFreeBlockSize());
+    appendGauge(out, "rfid_heap_fragmentation_percent", "gauge", "Fragmentation du tas", ESP.getHeapFragmentation());
+    appendGauge(out, "rfid_uptime_seconds", "gauge", "Temps depuis le démarrage", millis() / 1000);
+    appendGauge(out, "rfid_wifi_rssi_dbm", "gauge", "Puissance du signal WiFi", WiFi.RSSI());
+    server.sendContent(out);
+    server.sendContent("");
+}
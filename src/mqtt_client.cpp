@@ -0,0 +1,538 @@
+/*
+ * Client MQTT 3.1.1 : session persistante, publications QoS 1, commandes
+ */
+#include <mqtt_client.h>
+#include <ESP8266WiFi.h>
+#include <config.h>
+#include <settings.h>
+#include <upload_outbox.h>
+#include <serial_link.h>
+
+// Types de paquets (4 bits de poids fort de l'en-tête fixe)
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_SUBSCRIBE   0x82   // bits réservés 0010 imposés
+#define MQTT_SUBACK      0x90
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+#define MQTT_PUBLISH_DUP    0x08
+#define MQTT_PUBLISH_QOS1   0x02
+#define MQTT_PUBLISH_RETAIN 0x01
+
+// Préfixe des sujets : mqttTopic, ou « rfid/ » suivi de l'identifiant client
+#define MQTT_PREFIX_MAX (5 + DEVICE_ID_MAXLEN)
+static_assert(MQTT_PREFIX_MAX >= MQTT_TOPIC_MAXLEN, "Le préfixe doit contenir mqttTopic");
+
+// Plus grand paquet émis : en-tête fixe (3 octets), sujet, identifiant, corps
+#define MQTT_TX_HEADROOM 3
+#define MQTT_TX_MAX (MQTT_TX_HEADROOM + 2 + MQTT_PREFIX_MAX + 16 + 2 + MQTT_PAYLOAD_MAX)
+
+enum MqttState : uint8_t {
+    MQTT_IDLE,          // pas de connexion, reprise après retryDelayMs
+    MQTT_CONNECTING,    // CONNECT envoyé, CONNACK attendu
+    MQTT_READY,
+};
+
+struct InFlight {
+    uint16_t packetId;
+    uint16_t length;
+    uint32_t sequence;  // boîte d'envoi : acquittée au PUBACK
+    bool sent;          // déjà écrite une fois : renvoi avec DUP
+    bool acked;
+    unsigned long queuedUs;
+    uint8_t payload[MQTT_PAYLOAD_MAX];
+};
+
+static WiFiClient client;
+static MqttState state = MQTT_IDLE;
+static MqttStats stats;
+
+// File circulaire des publications QoS 1 : head est la plus ancienne non acquittée
+static InFlight inflight[MQTT_INFLIGHT_MAX];
+static uint8_t head = 0;
+static uint8_t count = 0;
+static uint16_t nextPacketId = 1;
+
+static char clientId[DEVICE_ID_MAXLEN];
+static char prefix[MQTT_PREFIX_MAX + 1];
+static size_t prefixLength = 0;
+static bool topicsValid = false;
+
+static unsigned long lastAttemptMs = 0;
+static unsigned long retryDelayMs = 0;
+static unsigned long lastSentMs = 0;
+static unsigned long pingSentMs = 0;
+static bool pingPending = false;
+
+// Paquet en cours de réception ; au-delà de MQTT_RX_MAX, la fin est ignorée
+enum RxPhase : uint8_t { RX_HEADER, RX_LENGTH, RX_BODY };
+static struct {
+    RxPhase phase;
+    uint8_t header;
+    uint8_t shift;
+    uint32_t length;
+    uint32_t received;
+    uint8_t buf[MQTT_RX_MAX];
+} rx;
+
+static uint8_t tx[MQTT_TX_MAX];
+#define TX_BODY (tx + MQTT_TX_HEADROOM)
+
+// === Sujets ===
+// Identifiant ou préfixe tronqué : sujets faux, la session n'est pas ouverte
+static bool configureTopics() {
+    size_t idLength = snprintf(clientId, sizeof(clientId), "%s", deviceId());
+    if (mqttTopic.length()) {
+        prefixLength = snprintf(prefix, sizeof(prefix), "%s", mqttTopic.c_str());
+    } else {
+        prefixLength = snprintf(prefix, sizeof(prefix), "rfid/%s", clientId);
+    }
+    if (idLength >= sizeof(clientId) || prefixLength >= sizeof(prefix)) {
+        prefix[0] = '\0';
+        prefixLength = 0;
+        return false;
+    }
+    // Séparateur final toléré dans la configuration
+    if (prefixLength && prefix[prefixLength - 1] == '/') prefix[--prefixLength] = '\0';
+    return true;
+}
+
+static size_t putTopic(uint8_t *p, const char *suffix) {
+    size_t suffixLength = strlen(suffix);
+    p[0] = (prefixLength + suffixLength) >> 8;
+    p[1] = prefixLength + suffixLength;
+    memcpy(p + 2, prefix, prefixLength);
+    memcpy(p + 2 + prefixLength, suffix, suffixLength);
+    return 2 + prefixLength + suffixLength;
+}
+
+static size_t putString(uint8_t *p, const char *s) {
+    size_t length = strlen(s);
+    p[0] = length >> 8;
+    p[1] = length;
+    memcpy(p + 2, s, length);
+    return 2 + length;
+}
+
+static bool topicIs(const uint8_t *topic, size_t length, const char *suffix) {
+    size_t suffixLength = strlen(suffix);
+    return length == prefixLength + suffixLength && memcmp(topic, prefix, prefixLength) == 0 &&
+           memcmp(topic + prefixLength, suffix, suffixLength) == 0;
+}
+
+// === Émission ===
+static void dropConnection();
+
+// En-tête fixe placé juste avant le corps déjà construit dans TX_BODY
+static bool sendPacket(uint8_t header, size_t length) {
+    uint8_t *p = TX_BODY;
+    if (length >= 128) {
+        *--p = length >> 7;
+        *--p = (length & 0x7F) | 0x80;
+    } else {
+        *--p = length;
+    }
+    *--p = header;
+    size_t total = TX_BODY + length - p;
+    if (client.write(p, total) != total) {
+        serialLog().println("[MQTT] Écriture impossible, connexion fermée");
+        dropConnection();
+        return false;
+    }
+    lastSentMs = millis();
+    return true;
+}
+
+static uint16_t takePacketId() {
+    uint16_t id = nextPacketId++;
+    if (nextPacketId == 0) nextPacketId = 1;
+    return id;
+}
+
+static bool sendPublish(InFlight &entry) {
+    size_t n = putTopic(TX_BODY, "/scan");
+    TX_BODY[n++] = entry.packetId >> 8;
+    TX_BODY[n++] = entry.packetId;
+    memcpy(TX_BODY + n, entry.payload, entry.length);
+    uint8_t header = MQTT_PUBLISH | MQTT_PUBLISH_QOS1 | (entry.sent ? MQTT_PUBLISH_DUP : 0);
+    if (entry.sent) stats.resent++;
+    entry.sent = true;
+    return sendPacket(header, n + entry.length);
+}
+
+static void sendStatus(const char *status) {
+    size_t n = putTopic(TX_BODY, "/status");
+    size_t length = strlen(status);
+    memcpy(TX_BODY + n, status, length);
+    sendPacket(MQTT_PUBLISH | MQTT_PUBLISH_RETAIN, n + length);
+}
+
+static void sendConnect() {
+    uint8_t *p = TX_BODY;
+    size_t n = putString(p, "MQTT");
+    p[n++] = 4;   // niveau de protocole 3.1.1
+    // Session persistante (clean session à 0), testament retenu en QoS 1
+    uint8_t flags = 0x04 | 0x08 | 0x20;
+    // MQTT 3.1.1 : pas de mot de passe sans nom d'utilisateur
+    bool withUser = mqttUser.length() > 0;
+    bool withPass = withUser && mqttPass.length() > 0;
+    if (withUser) flags |= 0x80;
+    if (withPass) flags |= 0x40;
+    p[n++] = flags;
+    p[n++] = MQTT_KEEPALIVE_S >> 8;
+    p[n++] = MQTT_KEEPALIVE_S & 0xFF;
+    n += putString(p + n, clientId);
+    n += putTopic(p + n, "/status");
+    n += putString(p + n, "offline");
+    if (withUser) n += putString(p + n, mqttUser.c_str());
+    if (withPass) n += putString(p + n, mqttPass.c_str());
+    sendPacket(MQTT_CONNECT, n);
+}
+
+static void sendSubscribe() {
+    uint16_t id = takePacketId();
+    TX_BODY[0] = id >> 8;
+    TX_BODY[1] = id;
+    size_t n = 2 + putTopic(TX_BODY + 2, "/cmd/#");
+    TX_BODY[n++] = 1;   // QoS 1 : les commandes manquées pendant une coupure sont gardées
+    sendPacket(MQTT_SUBSCRIBE, n);
+}
+
+static void sendPuback(uint16_t packetId) {
+    TX_BODY[0] = packetId >> 8;
+    TX_BODY[1] = packetId;
+    sendPacket(MQTT_PUBACK, 2);
+}
+
+// === Session ===
+static void dropConnection() {
+    client.stop();
+    state = MQTT_IDLE;
+    stats.connected = false;
+    rx.phase = RX_HEADER;
+    pingPending = false;
+    lastAttemptMs = millis();
+    retryDelayMs = MQTT_RETRY_MIN_MS;
+}
+
+static void connectFailed(const char *reason) {
+    client.stop();
+    state = MQTT_IDLE;
+    stats.connectFailures++;
+    lastAttemptMs = millis();
+    retryDelayMs = retryDelayMs ? min(retryDelayMs * 2, (unsigned long)MQTT_RETRY_MAX_MS) : MQTT_RETRY_MIN_MS;
+    serialLog().printf("[MQTT] Échec de connexion (%s), nouvel essai dans %lu ms\n", reason, retryDelayMs);
+}
+
+static void connect() {
+    serialLog().printf("[MQTT] Connexion à %s:%u (%s)\n", mqttHost.c_str(), mqttPort, clientId);
+    client.setTimeout(MQTT_CONNECT_TIMEOUT_MS);
+    if (!client.connect(mqttHost.c_str(), mqttPort)) {
+        connectFailed("TCP");
+        return;
+    }
+    client.setNoDelay(true);
+    rx.phase = RX_HEADER;
+    state = MQTT_CONNECTING;
+    lastAttemptMs = millis();
+    sendConnect();
+}
+
+// CONNACK accepté : statut, abonnement si le broker a perdu la session, puis
+// renvoi de tout ce qui attend encore son PUBACK
+static void sessionReady(bool sessionPresent) {
+    state = MQTT_READY;
+    stats.connected = true;
+    stats.sessionPresent = sessionPresent;
+    stats.connects++;
+    retryDelayMs = 0;
+    serialLog().printf("[MQTT] Connecté (session %s, %u en attente)\n", sessionPresent ? "retrouvée" : "nouvelle",
+                       count);
+    sendStatus("online");
+    if (!sessionPresent) sendSubscribe();
+    for (uint8_t i = 0; i < count && state == MQTT_READY; i++) {
+        InFlight &entry = inflight[(head + i) % MQTT_INFLIGHT_MAX];
+        if (!entry.acked) sendPublish(entry);
+    }
+}
+
+static void acknowledge(uint16_t packetId) {
+    for (uint8_t i = 0; i < count; i++) {
+        InFlight &entry = inflight[(head + i) % MQTT_INFLIGHT_MAX];
+        if (entry.acked || entry.packetId != packetId) continue;
+        entry.acked = true;
+        stats.acked++;
+        outboxAck(entry.sequence);
+        stats.lastAckUs = micros() - entry.queuedUs;
+        if (stats.lastAckUs > stats.maxAckUs) stats.maxAckUs = stats.lastAckUs;
+        break;
+    }
+    // PUBACK hors ordre : la tête n'avance que sur une suite acquittée
+    while (count && inflight[head].acked) {
+        head = (head + 1) % MQTT_INFLIGHT_MAX;
+        count--;
+    }
+}
+
+// === Commandes reçues ===
+// Valeur d'un champ "nom=valeur" d'un corps de formulaire
+static long formValue(const char *text, const char *name, long fallback) {
+    size_t nameLength = strlen(name);
+    for (const char *p = text; *p; p++) {
+        if ((p == text || p[-1] == '&') && strncmp(p, name, nameLength) == 0 && p[nameLength] == '=') {
+            return atol(p + nameLength + 1);
+        }
+    }
+    return fallback;
+}
+
+static void handleCommand(const uint8_t *topic, size_t topicLength, const char *text) {
+    if (topicIs(topic, topicLength, "/cmd/command")) {
+        char cmd[16];
+        size_t n = 0;
+        for (const char *p = text; *p && n < sizeof(cmd) - 1; p++) {
+            if (*p != ' ' && *p != '\r' && *p != '\n') cmd[n++] = toupper(*p);
+        }
+        cmd[n] = '\0';
+        stats.commands++;
+        if (!scanCommand(cmd)) serialLog().printf("[MQTT] Commande inconnue: %s\n", cmd);
+    } else if (topicIs(topic, topicLength, "/cmd/buzzer")) {
+        // Mêmes bornes que /api/buzzer ; motif non bloquant, comme le retour de scan
+        long times = constrain(formValue(text, "times", 1), 1L, 100L);
+        long duration = constrain(formValue(text, "duration", 100), 10L, 5000L);
+        stats.commands++;
+        buzzerStart(times, duration);
+    }
+}
+
+static void handlePublish(size_t length) {
+    uint8_t qos = (rx.header >> 1) & 0x03;
+    if (length < 2) return;
+    size_t topicLength = (rx.buf[0] << 8) | rx.buf[1];
+    size_t pos = 2 + topicLength;
+    if (pos + (qos ? 2 : 0) > length) return;
+    const uint8_t *topic = rx.buf + 2;
+    if (qos) {
+        uint16_t packetId = (rx.buf[pos] << 8) | rx.buf[pos + 1];
+        pos += 2;
+        // Acquittée avant exécution : la commande n'est pas rejouée si elle échoue
+        if (qos == 1) sendPuback(packetId);
+    }
+    char text[48];
+    size_t textLength = min(length - pos, sizeof(text) - 1);
+    memcpy(text, rx.buf + pos, textLength);
+    text[textLength] = '\0';
+    handleCommand(topic, topicLength, text);
+}
+
+static void handlePacket() {
+    size_t length = min(rx.length, (uint32_t)MQTT_RX_MAX);
+    pingPending = false;
+    switch (rx.header & 0xF0) {
+    case MQTT_CONNACK:
+        if (state != MQTT_CONNECTING || length < 2) break;
+        if (rx.buf[1] != 0) {
+            char reason[16];
+            snprintf(reason, sizeof(reason), "refus %u", rx.buf[1]);
+            connectFailed(reason);
+            break;
+        }
+        sessionReady(rx.buf[0] & 0x01);
+        break;
+    case MQTT_PUBLISH:
+        handlePublish(length);
+        break;
+    case MQTT_PUBACK:
+        if (length >= 2) acknowledge((rx.buf[0] << 8) | rx.buf[1]);
+        break;
+    case MQTT_SUBACK:
+        if (length >= 3 && rx.buf[2] == 0x80) serialLog().println("[MQTT] Abonnement aux commandes refusé");
+        break;
+    default:
+        break;
+    }
+}
+
+// Un octet du flux reçu ; false si le paquet est mal formé
+static bool feed(uint8_t c) {
+    switch (rx.phase) {
+    case RX_HEADER:
+        rx.header = c;
+        rx.length = 0;
+        rx.shift = 0;
+        rx.phase = RX_LENGTH;
+        return true;
+    case RX_LENGTH:
+        rx.length |= (uint32_t)(c & 0x7F) << rx.shift;
+        rx.shift += 7;
+        if (c & 0x80) return rx.shift < 28;
+        rx.received = 0;
+        rx.phase = RX_BODY;
+        break;
+    case RX_BODY:
+        if (rx.received < MQTT_RX_MAX) rx.buf[rx.received] = c;
+        rx.received++;
+        break;
+    }
+    if (rx.received == rx.length) {
+        rx.phase = RX_HEADER;
+        handlePacket();
+    }
+    return true;
+}
+
+// === API ===
+void mqttBegin() {
+    topicsValid = configureTopics();
+    retryDelayMs = 0;
+    if (mqttEnabled && !topicsValid) serialLog().println("[MQTT] Identifiant ou préfixe trop long, MQTT inactif");
+    if (mqttActive()) serialLog().printf("[MQTT] Scans publiés sur %s/scan\n", prefix);
+}
+
+void mqttRestart() {
+    if (state == MQTT_READY) {
+        // Fin propre : le broker ne publie pas le testament
+        sendStatus("offline");
+        sendPacket(MQTT_DISCONNECT, 0);
+    }
+    client.stop();
+    state = MQTT_IDLE;
+    stats.connected = false;
+    topicsValid = configureTopics();
+    retryDelayMs = 0;
+    if (mqttEnabled && !topicsValid) serialLog().println("[MQTT] Identifiant ou préfixe trop long, MQTT inactif");
+}
+
+bool mqttActive() {
+    return mqttEnabled && mqttHost.length() > 0 && topicsValid;
+}
+
+bool mqttConnected() {
+    return state == MQTT_READY;
+}
+
+void mqttLoop() {
+    if (!mqttActive()) {
+        if (state != MQTT_IDLE) mqttRestart();
+        return;
+    }
+    if (state == MQTT_IDLE) {
+        if (millis() - lastAttemptMs >= retryDelayMs) connect();
+        return;
+    }
+    uint8_t chunk[64];
+    int available;
+    while (state != MQTT_IDLE && (available = client.available()) > 0) {
+        int n = client.read(chunk, min((size_t)available, sizeof(chunk)));
+        if (n <= 0) break;
+        for (int i = 0; i < n && state != MQTT_IDLE; i++) {
+            if (!feed(chunk[i])) {
+                serialLog().println("[MQTT] Paquet mal formé, connexion fermée");
+                dropConnection();
+            }
+        }
+    }
+    if (state == MQTT_IDLE) return;
+    if (!client.connected()) {
+        serialLog().println("[MQTT] Connexion perdue");
+        dropConnection();
+        return;
+    }
+    unsigned long now = millis();
+    if (state == MQTT_CONNECTING) {
+        if (now - lastAttemptMs >= MQTT_CONNECT_TIMEOUT_MS) connectFailed("CONNACK");
+        return;
+    }
+    // Keepalive : PINGREQ après une demi-période sans émission, broker muet au-delà d'une période
+    if (pingPending && now - pingSentMs >= MQTT_KEEPALIVE_S * 1000UL) {
+        serialLog().println("[MQTT] Broker muet, connexion fermée");
+        dropConnection();
+    } else if (!pingPending && now - lastSentMs >= MQTT_KEEPALIVE_S * 500UL) {
+        if (sendPacket(MQTT_PINGREQ, 0)) {
+            pingPending = true;
+            pingSentMs = now;
+        }
+    }
+}
+
+bool mqttPublishScan(const ScanRecord &scan) {
+    if (!mqttActive()) return false;
+    if (count == MQTT_INFLIGHT_MAX) {
+        stats.overflows++;
+        return false;
+    }
+    InFlight &entry = inflight[(head + count) % MQTT_INFLIGHT_MAX];
+    // Corps codé directement dans l'entrée de la file, gardée pour un renvoi
+    entry.length = scanPayloadEncode(scan, (ApiEncoding)apiEncoding, entry.payload, sizeof(entry.payload));
+    if (!entry.length) return false;
+    entry.packetId = takePacketId();
+    entry.sequence = scan.sequence;
+    entry.sent = false;
+    entry.acked = false;
+    entry.queuedUs = micros();
+    count++;
+    if (count > stats.inflightHighWater) stats.inflightHighWater = count;
+    stats.published++;
+    // Hors connexion, la publication part à la reconnexion
+    if (state == MQTT_READY) sendPublish(entry);
+    return true;
+}
+
+const MqttStats &mqttStats() {
+    stats.inflight = count;
+    return stats;
+}
+
+const char *mqttTopicPrefix() {
+    return prefix;
+}
+
+String mqttStatusJson() {
+    const MqttStats &s = mqttStats();
+    String json;
+    json.reserve(384);
+    json = "{\"enabled\":";
+    json += mqttEnabled ? "true" : "false";
+    json += ",\"host\":\"";
+    json += mqttHost;
+    json += "\",\"port\":";
+    json += mqttPort;
+    json += ",\"user\":\"";
+    json += mqttUser;
+    json += "\",\"topic\":\"";
+    json += mqttTopic;
+    json += "\",\"prefix\":\"";
+    json += prefix;
+    json += "\",\"connected\":";
+    json += s.connected ? "true" : "false";
+    json += ",\"sessionPresent\":";
+    json += s.sessionPresent ? "true" : "false";
+    json += ",\"inflight\":";
+    json += s.inflight;
+    json += ",\"inflightHighWater\":";
+    json += s.inflightHighWater;
+    json += ",\"connects\":";
+    json += s.connects;
+    json += ",\"connectFailures\":";
+    json += s.connectFailures;
+    json += ",\"published\":";
+    json += s.published;
+    json += ",\"acked\":";
+    json += s.acked;
+    json += ",\"resent\":";
+    json += s.resent;
+    json += ",\"overflows\":";
+    json += s.overflows;
+    json += ",\"commands\":";
+    json += s.commands;
+    json += ",\"lastAckUs\":";
+    json += s.lastAckUs;
+    json += ",\"maxAckUs\":";
+    json += s.maxAckUs;
+    json += "}";
+    return json;
+}
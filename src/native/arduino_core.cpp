@@ -0,0 +1,479 @@
+/*
+ * Cœur Arduino hôte : temps, Ticker, broches, Print/Stream, Serial, ESP et suivi du tas.
+ */
+#include <Arduino.h>
+#include <SPI.h>
+#include <Ticker.h>
+#include "native_sim.h"
+#include <chrono>
+#include <map>
+#include <new>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <termios.h>
+
+// === Temps ===
+static const auto bootTime = std::chrono::steady_clock::now();
+
+// Temps virtuel : delay() et les attentes simulées avancent une horloge
+// au lieu de dormir ; le temps CPU réel de l'hôte reste compté.
+static bool virtualTime = false;
+static uint64_t virtualOffsetUs = 0;
+
+static uint64_t nowUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - bootTime)
+               .count() +
+           virtualOffsetUs;
+}
+
+void nativeSetVirtualTime(bool enabled) {
+    virtualTime = enabled;
+}
+
+static void advanceTo(uint64_t targetUs) {
+    uint64_t now = nowUs();
+    if (targetUs <= now) return;
+    if (virtualTime) virtualOffsetUs += targetUs - now;
+    else std::this_thread::sleep_for(std::chrono::microseconds(targetUs - now));
+}
+
+// === Ticker ===
+// Tickers armés, liste chaînée intrusive (aucune allocation)
+static Ticker *tickers = nullptr;
+
+void Ticker::arm(uint32_t milliseconds, callback_function_t callback, bool repeat) {
+    detach();
+    _periodUs = milliseconds ? (uint64_t)milliseconds * 1000 : 1;
+    _dueUs = nowUs() + _periodUs;
+    _repeat = repeat;
+    _callback = callback;
+    _armed = true;
+    _next = tickers;
+    tickers = this;
+}
+
+void Ticker::detach() {
+    if (!_armed) return;
+    for (Ticker **p = &tickers; *p; p = &(*p)->_next) {
+        if (*p == this) {
+            *p = _next;
+            break;
+        }
+    }
+    _armed = false;
+    _next = nullptr;
+}
+
+// Échéances jusqu'à untilUs servies dans l'ordre, l'horloge avancée à chacune
+static void runTickers(uint64_t untilUs) {
+    static bool running = false;
+    if (running) return;
+    running = true;
+    for (;;) {
+        Ticker *next = nullptr;
+        for (Ticker *t = tickers; t; t = t->_next) {
+            if (!next || t->_dueUs < next->_dueUs) next = t;
+        }
+        if (!next || next->_dueUs > untilUs) break;
+        advanceTo(next->_dueUs);
+        Ticker::callback_function_t callback = next->_callback;
+        if (next->_repeat) next->_dueUs += next->_periodUs;
+        else next->detach();
+        callback();
+    }
+    running = false;
+}
+
+void nativeWait(uint64_t us) {
+    if (us == 0) return;
+    uint64_t until = nowUs() + us;
+    runTickers(until);
+    advanceTo(until);
+}
+
+unsigned long millis() {
+    return (unsigned long)(nowUs() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)nowUs();
+}
+
+uint64_t micros64() {
+    return nowUs();
+}
+
+void delay(unsigned long ms) {
+    nativeWait((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    nativeWait(us);
+}
+
+void yield() {
+    runTickers(nowUs());
+}
+
+long random(long howbig) {
+    return howbig > 0 ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig) {
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    srandom(seed);
+}
+
+// === Broches ===
+static PinTrace pinTraces[17];
+
+PinTrace &nativePinTrace(uint8_t pin) {
+    return pinTraces[pin < 17 ? pin : 16];
+}
+
+void nativePinTraceReset() {
+    for (auto &t : pinTraces) t = PinTrace();
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    PinTrace &t = nativePinTrace(pin);
+    t.writes++;
+    if (value && !t.level) {
+        t.risingEdges++;
+        if (!t.firstRiseUs) t.firstRiseUs = micros();
+    }
+    if (t.level != value) t.lastChangeUs = micros();
+    t.level = value;
+}
+
+int digitalRead(uint8_t pin) {
+    return nativePinTrace(pin).level;
+}
+
+SPIClass SPI;
+
+// === Suivi du tas ===
+// Chaque bloc est préfixé de sa taille pour comptabiliser les libérations.
+static NativeHeapStats heapStats = {0, 0, 0, 0, NATIVE_HEAP_SIZE, 0};
+static int networkDepth = 0;
+
+static void *trackedAlloc(size_t size) {
+    size_t *p = (size_t *)malloc(size + sizeof(size_t) * 2);
+    if (!p) throw std::bad_alloc();
+    p[0] = size;
+    heapStats.allocations++;
+    if (networkDepth > 0) heapStats.networkAllocations++;
+    heapStats.liveBytes += size;
+    if (heapStats.liveBytes > heapStats.peakBytes) heapStats.peakBytes = heapStats.liveBytes;
+    uint32_t freeBytes = heapStats.liveBytes < NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE - heapStats.liveBytes : 0;
+    if (freeBytes < heapStats.minFree) heapStats.minFree = freeBytes;
+    return p + 2;
+}
+
+static void trackedFree(void *ptr) {
+    if (!ptr) return;
+    size_t *p = (size_t *)ptr - 2;
+    heapStats.frees++;
+    heapStats.liveBytes -= p[0];
+    free(p);
+}
+
+void *operator new(size_t size) { return trackedAlloc(size); }
+void *operator new[](size_t size) { return trackedAlloc(size); }
+void operator delete(void *ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { trackedFree(ptr); }
+
+NativeHeapStats nativeHeapStats() {
+    return heapStats;
+}
+
+NativeNetworkHeapScope::NativeNetworkHeapScope() {
+    networkDepth++;
+}
+
+NativeNetworkHeapScope::~NativeNetworkHeapScope() {
+    networkDepth--;
+}
+
+void nativeHeapResetPeak() {
+    heapStats.peakBytes = heapStats.liveBytes;
+    heapStats.minFree = heapStats.liveBytes < NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE - heapStats.liveBytes : 0;
+}
+
+// === ESP ===
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return heapStats.liveBytes < NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE - heapStats.liveBytes : 0;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+    // Pas de modèle de fragmentation : le plus grand bloc est le tas libre
+    return getFreeHeap();
+}
+
+uint8_t EspClass::getHeapFragmentation() {
+    return 0;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(micros() * 80);
+}
+
+void EspClass::restart() {
+    Serial.println("[NATIVE] ESP.restart()");
+    exit(0);
+}
+
+// === Print ===
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+}
+
+size_t Print::print(const __FlashStringHelper *s) {
+    return write(reinterpret_cast<const char *>(s));
+}
+
+size_t Print::print(const String &s) {
+    return write((const uint8_t *)s.c_str(), s.length());
+}
+
+size_t Print::print(const char *s) {
+    return write(s);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(int n, int base) {
+    return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+    if (base == 10 && n < 0) {
+        size_t t = print('-');
+        return t + print((unsigned long)(-n), base);
+    }
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+    return print((unsigned long long)n, base);
+}
+
+size_t Print::print(long long n, int base) {
+    if (base == 10 && n < 0) {
+        size_t t = print('-');
+        return t + print((unsigned long long)(-n), base);
+    }
+    return print((unsigned long long)n, base);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+    char buf[72];
+    char *p = buf + sizeof(buf) - 1;
+    *p = 0;
+    if (base < 2) base = 10;
+    do {
+        unsigned d = n % base;
+        *--p = d < 10 ? '0' + d : 'A' + d - 10;
+        n /= base;
+    } while (n);
+    return write(p);
+}
+
+size_t Print::print(double n, int digits) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+size_t Print::print(const Printable &p) {
+    return p.printTo(*this);
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+size_t Print::vprintf(const char *format, va_list args) {
+    // Comme le cœur ESP8266 : 64 octets sur la pile, tas au-delà
+    char buf[64];
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(buf, sizeof(buf), format, copy);
+    va_end(copy);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(buf)) return write((const uint8_t *)buf, len);
+    char *big = new char[len + 1];
+    vsnprintf(big, len + 1, format, args);
+    size_t n = write((const uint8_t *)big, len);
+    delete[] big;
+    return n;
+}
+
+// === Stream ===
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String ret;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+String Stream::readString() {
+    String ret;
+    int c = timedRead();
+    while (c >= 0) {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+// === Serial ===
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    _written += size;
+    if (_fd >= 0) {
+        size_t off = 0;
+        while (off < size) {
+            ssize_t n = ::write(_fd, buffer + off, size - off);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EINTR) continue;
+                break;
+            }
+            off += n;
+        }
+    } else if (_echo) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    if (_fd < 0 && _echo) fflush(stdout);
+}
+
+void HardwareSerial::inject(const char *data, size_t len) {
+    _rx.concat(data, len);
+}
+
+void HardwareSerial::inject(const char *data) {
+    inject(data, strlen(data));
+}
+
+void HardwareSerial::pollFd() {
+    if (_fd < 0) return;
+    uint8_t buf[256];
+    ssize_t n = ::read(_fd, buf, sizeof(buf));
+    if (n > 0) inject((const char *)buf, n);
+}
+
+int HardwareSerial::available() {
+    if (_rxPos >= _rx.length()) {
+        _rx = String();
+        _rxPos = 0;
+        pollFd();
+    }
+    return _rx.length() - _rxPos;
+}
+
+int HardwareSerial::read() {
+    if (!available()) return -1;
+    return (uint8_t)_rx[_rxPos++];
+}
+
+int HardwareSerial::peek() {
+    if (!available()) return -1;
+    return (uint8_t)_rx[_rxPos];
+}
+
+int nativeOpenPty(char *slavePath, size_t size) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+    const char *name = ptsname(master);
+    if (!name) return -1;
+    snprintf(slavePath, size, "%s", name);
+    // Sans mode brut, l'écho du terminal renverrait la sortie comme commandes
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0) return -1;
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    return master;
+}
+
+// === IPAddress ===
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+    return p.print(toString());
+}
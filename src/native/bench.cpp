@@ -0,0 +1,2960 @@
+/*
+ * Banc d'essai scan -> API (program bench).
+ *
+ * Passe par le vrai chemin handleRFIDOperations() -> sendUidToApi() avec des
+ * cartes simulées et le serveur HTTP en boucle locale. Pour chaque type de
+ * carte x lecture mémoire on/off x http/https, une ligne JSON sur stdout :
+ * latence carte posée -> requête reçue par le serveur (p50/p95/p99), scans
+ * par minute soutenus (retour buzzer compris) et point bas du tas.
+ *
+ * Options : --scans N, --latency-us N, --failure-rate F, --cards a,b,
+ *           --label nom, --real-time (sinon temps virtuel)
+ *
+ * program allocs [n] : allocations sur le tas par scan, hors pile HTTP
+ * simulée, pour chaque carte x lecture mémoire x décision (API / liste
+ * locale), outboxLoop() tournant hors mesure entre deux scans comme dans
+ * loop(). Code de sortie 1 si le chemin de scan alloue encore.
+ *
+ * program configbench [n] : coût d'un changement de réglage (EEPROM, un
+ * secteur réécrit par commit, contre ajout au journal LittleFS) et temps de
+ * chargement au démarrage selon la longueur du journal, avec le modèle
+ * temporel de la flash (SimFlash).
+ *
+ * program pipeline [n] [latence-us] : rafale de n cartes avec une API lente.
+ * Intervalle entre deux captures (disponibilité du lecteur), durée de
+ * maintien de la carte avant HLTA, profondeur des files et scans refusés
+ * par la file pleine, puis rejoués depuis la boîte d'envoi. Puis bip de
+ * prise en compte joué jusqu'au bout pendant un POST bloquant, et retour
+ * buzzer selon le code : tout 2xx autorise, sauf refus dans le corps.
+ *
+ * program access [n] : lecture complète et formatage d'une 1K aux droits
+ * mélangés, opérations tentées à l'aveugle, puis planifiées d'après les bits
+ * d'accès (premier passage, puis cache par UID). Temps par scan,
+ * authentifications refusées, re-sélections et opérations évitées.
+ *
+ * program rftune [n] [couplage] : carte mal couplée (boîtier, distance),
+ * réglage automatique depuis le gain par défaut, puis calibration sur la
+ * carte de référence. Réussite au premier essai par tranche de scans,
+ * réglages retenus et attente d'un REQA sans carte (timer).
+ *
+ * program rc522 [n] : défauts injectés pendant un scan continu (coupure :
+ * puce muette, esd : registres au reset, antenne coupée), avec et sans
+ * surveillance. Cartes manquées après le défaut, délai injection -> reprise
+ * et durée de la reprise elle-même.
+ *
+ * program iso [n] : cartes ISO 14443-4 (DESFire, carte à puce, MIFARE Plus
+ * SL2) lues par l'ancien repli Classic puis par la couche ISO-DEP ; DESFire
+ * aussi limitée à 106 kbit/s, avec S(WTX) et sur une liaison dégradée.
+ * Durée de capture, trames et retransmissions par scan.
+ *
+ * program ndef [n] : temps d'analyse NDEF en place contre copie dans des
+ * String sur les images de référence (vérifiées par test/test_ndef), puis
+ * écriture par /api/write et relecture sur cartes simulées.
+ *
+ * program provision [n] : import de files CSV/JSON (refus compris), puis n
+ * cartes vierges encodées en mode PROVISION avec doublons et cartes déjà
+ * écrites intercalés ; contenu relu dans la mémoire simulée, journal, reprise
+ * après redémarrage. Comparé à une requête /api/write par carte : durée par
+ * carte (hors manipulation), cartes par heure et requêtes HTTP.
+ *
+ * program serial [n] : liaison série vers un hôte à travers un pseudo-
+ * terminal (processus hôte séparé). n scans lus en texte (lignes « UID: »)
+ * puis en trames binaires : octets par événement, événements par seconde et
+ * latence capture -> événement décodé côté hôte, débit plafonné par le fil à
+ * 115200 et 921600 bauds ; aller-retour d'une commande, reprise après une
+ * trame corrompue, et attente de loop() sur une ligne incomplète
+ * (readStringUntil contre serialLinkPoll).
+ *
+ * program mqtt [n] [rtt-us] : transport MQTT contre un broker de substitution
+ * (processus séparé sur 127.0.0.1, aller-retour simulé avant chaque PUBACK).
+ * n envois HTTP (connexion + requête par scan) puis n publications QoS 1 sur
+ * la session ouverte : scans par seconde, temps bloquant par scan, délai
+ * publication -> broker et publication -> PUBACK. Puis file bornée (PUBACK
+ * retenus), coupure avec publications non acquittées (renvoi DUP, session
+ * retrouvée sans nouvel abonnement, commande gardée pendant la coupure),
+ * latence des commandes, scan complet du pipeline publié sans HTTP (retour
+ * neutre : bip de capture seul, pas de motif de succès), et mot
+ * de passe sans nom d'utilisateur refusé par /api/mqtt, jamais envoyé.
+ *
+ * program coap [n] [rtt-us] : remontée CoAP contre un serveur UDP de
+ * substitution (processus séparé, aller-retour simulé avant la réponse).
+ * n envois HTTP puis n échanges confirmables : latence scan -> décision et
+ * échanges par seconde. Puis 20 % de pertes dans chaque sens (renvois, aucun
+ * double traitement côté serveur), ACK en double ignorés, réponse séparée
+ * acquittée, et scan complet du pipeline : retour buzzer choisi par l'ACK
+ * (autorisé, refusé) sans bloquer loop() pendant l'attente.
+ *
+ * program cbor [n] : corps des envois en CBOR contre form et JSON (écrits
+ * en place tous les trois), pour un scan courant et pour l'image complète
+ * d'une 1K : octets et temps d'encodage. Le schéma lui-même est vérifié par
+ * test/test_cbor.
+ *
+ * program outbox [n] : boîte d'envoi persistante derrière le pipeline, contre
+ * un serveur de bouclage qui dédoublonne sur Idempotency-Key. n scans en
+ * ligne (pages programmées et écritures de l'état par scan), puis coupure
+ * et 503 sur un scan sur deux : seuls les non acquittés sont renvoyés, sans
+ * doublon. Enfin redémarrage simulé avec un ajout interrompu : événements
+ * retrouvés, séquence toujours croissante, aucun scan perdu ni traité deux
+ * fois par le serveur.
+ *
+ * program cache [n] [latence-us] : cache des décisions de l'API (ttl dans la
+ * réponse) derrière une API lente. Huit badges une première fois, puis n
+ * présentations : délai capture -> retour buzzer avec et sans le cache,
+ * taux de réussite, envoi toujours fait, aucune allocation. Puis badge
+ * révoqué côté serveur (un seul retour périmé), invalidation par
+ * POST /api/cache/invalidate, ttl écoulé et réponse sans ttl.
+ *
+ * program longpoll [n] : attente longue sur /api/lastcard. Vérifie l'échéance,
+ * la réponse pendant le scan suivant (au bip de prise en compte) et le nombre
+ * d'itérations de la boucle RFID pendant qu'une requête est en attente, puis
+ * les réponses différentielles de /api/dashboard (304, sections modifiées).
+ */
+#include <Arduino.h>
+#include <native_sim.h>
+#include <scanner.h>
+#include <settings.h>
+#include <config.h>
+#include <EEPROM.h>
+#include <acl.h>
+#include <hex_util.h>
+#include <web_routes.h>
+#include <scan_pipeline.h>
+#include <sector_access.h>
+#include <rf_tuning.h>
+#include <rc522_health.h>
+#include <iso_card.h>
+#include <iso_dep.h>
+#include <ndef.h>
+#include <ndef_tag.h>
+#include <ndef_samples.h>
+#include <provisioning.h>
+#include <serial_link.h>
+#include <link_frame.h>
+#include <mqtt_client.h>
+#include <coap_uplink.h>
+#include <coap_message.h>
+#include <scan_payload.h>
+#include <api_client.h>
+#include <upload_outbox.h>
+#include <decision_cache.h>
+#include <LittleFS.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <set>
+#include <string>
+#include <algorithm>
+#include <vector>
+
+std::shared_ptr<SimCard> nativeMakeCard(const String &name);
+void nativeDrainPipeline();
+
+static uint32_t percentile(std::vector<uint32_t> &sorted, int p) {
+    if (sorted.empty()) return 0;
+    size_t rank = (sorted.size() * p + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+struct BenchResult {
+    uint32_t ok = 0;
+    uint32_t failed = 0;
+    std::vector<uint32_t> latencies;
+    double scansPerMin = 0;
+    uint32_t heapMinFree = 0;
+};
+
+static BenchResult benchConfig(std::shared_ptr<SimCard> card, int scans) {
+    BenchResult r;
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    SimField &field = SimField::instance();
+    server.clear();
+    nativeHeapResetPeak();
+    unsigned long start = micros();
+    for (int i = 0; i < scans; i++) {
+        size_t before = server.received.size();
+        field.place(card);
+        unsigned long placedAt = field.placedAtUs();
+        handleRFIDOperations();
+        field.remove();
+        nativeDrainPipeline();
+        if (server.received.size() > before) {
+            r.latencies.push_back(server.received.back().receivedAtUs - placedAt);
+            r.ok++;
+        } else {
+            r.failed++;
+        }
+        server.received.clear();
+    }
+    unsigned long elapsed = micros() - start;
+    r.scansPerMin = elapsed ? scans * 60e6 / elapsed : 0;
+    r.heapMinFree = nativeHeapStats().minFree;
+    std::sort(r.latencies.begin(), r.latencies.end());
+    return r;
+}
+
+int runBench(int argc, char **argv) {
+    int scans = 50;
+    String cards = "classic1k,classic4k,ultralight,ntag215";
+    String label = "local";
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    bool realTime = false;
+    for (int i = 2; i < argc; i++) {
+        String opt(argv[i]);
+        const char *val = i + 1 < argc ? argv[i + 1] : "";
+        if (opt == "--scans") scans = atoi(val), i++;
+        else if (opt == "--latency-us") server.latencyUs = atol(val), i++;
+        else if (opt == "--failure-rate") server.failureRate = atof(val), i++;
+        else if (opt == "--cards") cards = val, i++;
+        else if (opt == "--label") label = val, i++;
+        else if (opt == "--real-time") realTime = true;
+        else {
+            fprintf(stderr, "Option inconnue: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    nativeSetVirtualTime(!realTime);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+
+    cards += ",";
+    int from = 0;
+    int sep;
+    while ((sep = cards.indexOf(',', from)) >= 0) {
+        String name = cards.substring(from, sep);
+        from = sep + 1;
+        if (name.length() == 0) continue;
+        std::shared_ptr<SimCard> card = nativeMakeCard(name);
+        if (!card) {
+            fprintf(stderr, "Carte inconnue: %s\n", name.c_str());
+            return 2;
+        }
+        for (int memory = 0; memory < 2; memory++) {
+            for (int https = 0; https < 2; https++) {
+                readMemoryEnabled = memory;
+                apiUrl = https ? "https://127.0.0.1/api/scan" : "http://127.0.0.1/api/scan";
+                BenchResult r = benchConfig(card, scans);
+                printf("{\"label\":\"%s\",\"card\":\"%s\",\"readMemory\":%s,\"scheme\":\"%s\","
+                       "\"scans\":%d,\"ok\":%u,\"failed\":%u,\"p50Us\":%u,\"p95Us\":%u,\"p99Us\":%u,"
+                       "\"scansPerMin\":%.1f,\"heapMinFree\":%u,\"serverLatencyUs\":%u,\"failureRate\":%.3f}\n",
+                       label.c_str(), name.c_str(), memory ? "true" : "false", https ? "https" : "http",
+                       scans, r.ok, r.failed, percentile(r.latencies, 50), percentile(r.latencies, 95),
+                       percentile(r.latencies, 99), r.scansPerMin, r.heapMinFree, server.latencyUs,
+                       server.failureRate);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
+
+// === Allocations par scan ===
+// Liste d'accès réduite à une seule carte (ou vide) via le serveur simulé
+static void allocsSetAcl(const SimCard *card, uint32_t version) {
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    String list = "ACL FULL " + String(version) + "\n";
+    if (card) {
+        char uid[UID_HEX_MAX];
+        hexEncode(card->uid, card->uidSize, uid);
+        list += "+" + String(uid) + "\n";
+    }
+    server.handler = [list](const LoopbackRequest &) {
+        LoopbackResponse r;
+        r.body = list;
+        return r;
+    };
+    aclSetSourceUrl("http://127.0.0.1/acl");
+    aclSync();
+    server.handler = nullptr;
+}
+
+int runAllocs(int argc, char **argv) {
+    int scans = argc > 2 ? atoi(argv[2]) : 20;
+    const char *cards[] = {"classic1k", "classic4k", "ultralight", "ntag215"};
+    SimField &field = SimField::instance();
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    apiUrl = "http://127.0.0.1/api/scan";
+    // Réglage RF figé : un ajustement enregistre la configuration (journal
+    // LittleFS), ce qui n'est pas le chemin de scan mesuré ici
+    bool autoTune = rfAutoTune;
+    rfAutoTune = false;
+    uint32_t version = aclStats().version;
+    bool clean = true;
+    for (const char *name : cards) {
+        std::shared_ptr<SimCard> card = nativeMakeCard(name);
+        for (int local = 0; local < 2; local++) {
+            allocsSetAcl(local ? card.get() : nullptr, ++version);
+            for (int memory = 0; memory < 2; memory++) {
+                readMemoryEnabled = memory;
+                // Un premier scan initialise les objets statiques (en-têtes HTTP...)
+                field.place(card);
+                handleRFIDOperations();
+                field.remove();
+                nativeDrainPipeline();
+                uint32_t network = 0;
+                uint32_t own = 0;
+                for (int i = 0; i < scans; i++) {
+                    NativeHeapStats before = nativeHeapStats();
+                    field.place(card);
+                    handleRFIDOperations();
+                    field.remove();
+                    nativeDrainPipeline();
+                    NativeHeapStats after = nativeHeapStats();
+                    network += after.networkAllocations - before.networkAllocations;
+                    own += after.allocations - before.allocations -
+                           (after.networkAllocations - before.networkAllocations);
+                    // Reste de loop(), hors mesure : la boîte d'envoi compacte les
+                    // audits des décisions locales comme sur le lecteur
+                    outboxLoop();
+                }
+                if (own) clean = false;
+                printf("{\"card\":\"%s\",\"decision\":\"%s\",\"readMemory\":%s,\"scans\":%d,"
+                       "\"allocsPerScan\":%.2f,\"networkAllocsPerScan\":%.2f}\n",
+                       name, local ? "local" : "api", memory ? "true" : "false", scans,
+                       (double)own / scans, (double)network / scans);
+                fflush(stdout);
+            }
+        }
+    }
+    allocsSetAcl(nullptr, ++version);
+    rfAutoTune = autoTune;
+    return clean ? 0 : 1;
+}
+
+// === Journal de configuration ===
+static void printLatencies(const char *store, std::vector<uint32_t> &lat, uint32_t erases, uint32_t pages,
+                           uint32_t bootUs, const char *extra) {
+    std::sort(lat.begin(), lat.end());
+    printf("{\"store\":\"%s\",\"changes\":%u,\"p50Us\":%u,\"p99Us\":%u,\"maxUs\":%u,"
+           "\"erasesPerChange\":%.3f,\"pagesPerChange\":%.2f,\"bootUs\":%u%s}\n",
+           store, (unsigned)lat.size(), percentile(lat, 50), percentile(lat, 99), lat.empty() ? 0 : lat.back(),
+           lat.empty() ? 0.0 : (double)erases / lat.size(), lat.empty() ? 0.0 : (double)pages / lat.size(), bootUs,
+           extra);
+    fflush(stdout);
+}
+
+int runConfigBench(int argc, char **argv) {
+    int changes = argc > 2 ? atoi(argv[2]) : 300;
+    SimFlash &flash = SimFlash::instance();
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    // L'EEPROM du banc reste en mémoire : la configuration réelle n'est pas touchée
+    EEPROM.persist = false;
+    std::vector<uint32_t> lat;
+
+    // Ancien stockage : bloc EEPROM, chaque commit efface et réécrit le secteur
+    uint8_t blob[333];
+    memset(blob, 0, sizeof(blob));
+    unsigned long t = micros();
+    EEPROM.begin(EEPROM_SIZE);
+    EEPROM.get(0, blob);
+    uint32_t eepromBootUs = micros() - t;
+    uint32_t erases = flash.erases, pages = flash.pagePrograms;
+    for (int i = 0; i < changes; i++) {
+        blob[8] = i;
+        EEPROM.put(0, blob);
+        t = micros();
+        EEPROM.commit();
+        lat.push_back(micros() - t);
+    }
+    EEPROM.end();
+    printLatencies("eeprom", lat, flash.erases - erases, flash.pagePrograms - pages, eepromBootUs, "");
+
+    // Journal LittleFS : ajout d'un enregistrement, compaction différée
+    unsigned long originalDelay = scanDelayMs;
+    lat.clear();
+    std::vector<uint32_t> compaction;
+    erases = flash.erases, pages = flash.pagePrograms;
+    for (int i = 0; i < changes; i++) {
+        t = micros();
+        saveScanDelay(1000 + (i % 2) * 500);
+        lat.push_back(micros() - t);
+        uint32_t before = settingsStats().compactions;
+        t = micros();
+        settingsLoop();
+        if (settingsStats().compactions != before) compaction.push_back(micros() - t);
+    }
+    std::sort(compaction.begin(), compaction.end());
+    char extra[96];
+    snprintf(extra, sizeof(extra), ",\"compactions\":%u,\"compactionP50Us\":%u", (unsigned)compaction.size(),
+             percentile(compaction, 50));
+    uint32_t journalErases = flash.erases - erases, journalPages = flash.pagePrograms - pages;
+
+    // Démarrage selon la longueur du journal : vide, moitié, juste avant compaction
+    while (settingsStats().journalRecords > 0) {
+        saveScanDelay(1000);
+        settingsLoop();
+    }
+    t = micros();
+    loadSettings();
+    uint32_t bootEmptyUs = micros() - t;
+    printLatencies("journal", lat, journalErases, journalPages, bootEmptyUs, extra);
+    for (int fill = 0; fill < 2; fill++) {
+        while (settingsStats().journalRecords > 0) {
+            saveScanDelay(1000);
+            settingsLoop();
+        }
+        uint32_t recordBytes = 0;
+        saveScanDelay(1500);
+        recordBytes = settingsStats().journalBytes;
+        uint32_t target = (fill == 0 ? 2048 : 4096) / recordBytes;
+        while (settingsStats().journalRecords < target) saveScanDelay(1000 + settingsStats().journalRecords % 2);
+        t = micros();
+        loadSettings();
+        printf("{\"store\":\"journal\",\"bootRecords\":%u,\"bootJournalBytes\":%u,\"bootUs\":%u}\n",
+               (unsigned)settingsStats().journalRecords, (unsigned)settingsStats().journalBytes,
+               (unsigned)(micros() - t));
+    }
+    saveScanDelay(originalDelay);
+    flushSettings();
+    return 0;
+}
+
+// === Attente longue /api/lastcard ===
+// Une itération de loop() réduite à la boucle RFID et au serveur web
+static void longPollLoopOnce() {
+    handleRFIDOperations();
+    scanPipelineLoop();
+    webServerLoop();
+    delay(1);
+}
+
+static NativeHttpResponse longPollPark(uint32_t after, unsigned long waitMs) {
+    char uri[64];
+    snprintf(uri, sizeof(uri), "/api/lastcard?after=%lu&wait=%lu", (unsigned long)after, waitMs);
+    return webServer.request(HTTP_GET, uri);
+}
+
+int runLongPoll(int argc, char **argv) {
+    int scans = argc > 2 ? atoi(argv[2]) : 10;
+    SimField &field = SimField::instance();
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    apiUrl = "http://127.0.0.1/api/scan";
+    bool ok = true;
+
+    // Sans scan : réponse à l'échéance avec le même identifiant, boucle RFID active
+    NativeHttpResponse r = longPollPark(lastScan.id, 500);
+    if (!r.deferred()) ok = false;
+    unsigned long t = millis();
+    uint32_t iterations = 0;
+    while (!r.poll() && millis() - t < 2000) {
+        longPollLoopOnce();
+        iterations++;
+    }
+    char expected[32];
+    snprintf(expected, sizeof(expected), "\"id\":%lu,", (unsigned long)lastScan.id);
+    if (r.code != 200 || r.body.indexOf(expected) < 0) ok = false;
+    printf("{\"case\":\"timeout\",\"waitMs\":500,\"answeredMs\":%lu,\"rfidIterations\":%u,\"code\":%d}\n",
+           millis() - t, iterations, r.code);
+
+    // Scan pendant l'attente : réponse au premier passage de la boucle après la capture
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k");
+    std::vector<uint32_t> notify, total;
+    uint32_t duringScan = 0;
+    for (int memory = 0; memory < 2; memory++) {
+        readMemoryEnabled = memory;
+        notify.clear();
+        total.clear();
+        duringScan = 0;
+        for (int i = 0; i < scans; i++) {
+            uint32_t before = lastScan.id;
+            r = longPollPark(before, 30000);
+            if (!r.deferred()) ok = false;
+            for (int idle = 0; idle < 20; idle++) longPollLoopOnce();
+            field.place(card);
+            t = micros();
+            handleRFIDOperations();
+            uint32_t scanUs = micros() - t;
+            field.remove();
+            bool answered = r.poll();
+            if (answered) duringScan++;
+            while (!answered && micros() - t < 5000000) {
+                longPollLoopOnce();
+                answered = r.poll();
+            }
+            notify.push_back(micros() - t);
+            nativeDrainPipeline();
+            snprintf(expected, sizeof(expected), "\"id\":%lu,", (unsigned long)before + 1);
+            if (!answered || r.code != 200 || r.body.indexOf(expected) < 0) ok = false;
+            total.push_back(scanUs);
+        }
+        std::sort(notify.begin(), notify.end());
+        std::sort(total.begin(), total.end());
+        printf("{\"case\":\"scan\",\"readMemory\":%s,\"scans\":%d,\"answeredDuringCapture\":%u,"
+               "\"notifyP50Us\":%u,\"captureP50Us\":%u,\"polling2sMeanLatencyUs\":%u}\n",
+               memory ? "true" : "false", scans, duringScan, percentile(notify, 50), percentile(total, 50),
+               1000000 + percentile(notify, 50));
+        fflush(stdout);
+    }
+
+    // Tableau de bord : tout au premier appel, 304 ensuite, seules carte et
+    // historique après un scan
+    r = webServer.request(HTTP_GET, "/api/dashboard");
+    size_t fullBytes = r.body.length();
+    int s = r.body.indexOf("\"s\":{\"v\":"), c = r.body.indexOf("\"c\":{\"v\":"), l = r.body.indexOf("\"l\":{\"v\":");
+    if (r.code != 200 || s < 0 || c < 0 || l < 0) ok = false;
+    char uri[96];
+    snprintf(uri, sizeof(uri), "/api/dashboard?s=%ld&c=%ld&l=%ld", atol(r.body.c_str() + s + 9),
+             atol(r.body.c_str() + c + 9), atol(r.body.c_str() + l + 9));
+    NativeHttpResponse same = webServer.request(HTTP_GET, uri);
+    if (same.code != 304 || same.body.length()) ok = false;
+    strcat(uri, "&wait=30000");
+    r = webServer.request(HTTP_GET, uri);
+    if (!r.deferred()) ok = false;
+    field.place(card);
+    handleRFIDOperations();
+    field.remove();
+    webServerLoop();
+    nativeDrainPipeline();
+    if (!r.poll() || r.code != 200 || r.body.indexOf("\"s\":") >= 0 || r.body.indexOf("\"c\":") < 0) ok = false;
+    printf("{\"case\":\"dashboard\",\"fullBytes\":%u,\"unchangedCode\":%d,\"afterScanCode\":%d,"
+           "\"afterScanBytes\":%u,\"requestsPerRefresh\":1}\n",
+           (unsigned)fullBytes, same.code, r.code, (unsigned)r.body.length());
+    return ok ? 0 : 1;
+}
+
+// === Pipeline étagé ===
+int runPipelineBench(int argc, char **argv) {
+    int cards = argc > 2 ? atoi(argv[2]) : 20;
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    server.latencyUs = argc > 3 ? atol(argv[3]) : 300000;
+    SimField &field = SimField::instance();
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    readMemoryEnabled = true;
+    apiUrl = "http://127.0.0.1/api/scan";
+    server.clear();
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k");
+    std::vector<uint32_t> hold, interval;
+    PipelineStats before = scanPipelineStats();
+    unsigned long previous = 0;
+    for (int i = 0; i < cards; i++) {
+        // La carte suivante est présentée dès que la précédente est relâchée
+        uint32_t id = lastScan.id;
+        field.place(card);
+        unsigned long deadline = micros() + 10000000;
+        while (lastScan.id == id && (long)(micros() - deadline) < 0) {
+            unsigned long t = micros();
+            handleRFIDOperations();
+            if (lastScan.id != id) {
+                hold.push_back(micros() - t);
+                if (previous) interval.push_back(t - previous);
+                previous = t;
+            }
+            scanPipelineLoop();
+            webServerLoop();
+            delay(1);
+        }
+        field.remove();
+    }
+    nativeDrainPipeline();
+    const PipelineStats &after = scanPipelineStats();
+    std::sort(hold.begin(), hold.end());
+    std::sort(interval.begin(), interval.end());
+    uint32_t completed = after.completed - before.completed;
+    uint32_t endToEnd = after.endToEnd.count ? after.endToEnd.sumUs / after.endToEnd.count : 0;
+    printf("{\"cards\":%d,\"apiLatencyUs\":%u,\"captured\":%u,\"uploaded\":%u,\"completed\":%u,"
+           "\"drops\":%u,\"capturedHighWater\":%u,\"decidedHighWater\":%u,\"holdP50Us\":%u,"
+           "\"captureIntervalP50Us\":%u,\"endToEndMeanUs\":%u}\n",
+           cards, server.latencyUs, (unsigned)hold.size(), (unsigned)server.received.size(), completed,
+           after.drops - before.drops, after.capturedHighWater, after.decidedHighWater, percentile(hold, 50),
+           percentile(interval, 50), endToEnd);
+
+    // Scans refusés par la file pleine : déjà dans la boîte d'envoi, rejoués ensuite
+    uint32_t replayed = outboxStats().replayed;
+    unsigned long replayStart = millis();
+    while (outboxStats().pending && millis() - replayStart < 60000) {
+        outboxLoop();
+        delay(10);
+    }
+    bool queueFullOk = server.received.size() == (size_t)hold.size() && outboxStats().pending == 0;
+    printf("{\"check\":\"file-pleine\",\"drops\":%u,\"replayed\":%lu,\"uploadedTotal\":%u,\"ok\":%s}\n",
+           after.drops - before.drops, (unsigned long)(outboxStats().replayed - replayed),
+           (unsigned)server.received.size(), queueFullOk ? "true" : "false");
+
+    // Bip de prise en compte (2 x 100 ms) pendant un POST bloquant plus long :
+    // le Ticker termine le motif à l'heure, buzzer éteint au retour
+    uint32_t savedLatency = server.latencyUs;
+    server.latencyUs = 500000;
+    PinTrace &buzzer = nativePinTrace(BUZZER_PIN);
+    buzzerStart(2, 100);
+    uint32_t rises = buzzer.risingEdges;
+    unsigned long postStart = micros();
+    sendUidToApi("04a1b2c3");
+    unsigned long postUs = micros() - postStart;
+    server.latencyUs = savedLatency;
+    bool beepOk = !buzzerBusy() && buzzer.level == LOW && buzzer.risingEdges == rises + 1 &&
+                  buzzer.lastChangeUs - postStart < 400000;
+    printf("{\"check\":\"bip-pendant-post\",\"postUs\":%lu,\"beepEndUs\":%lu,\"level\":%u,\"ok\":%s}\n",
+           postUs, buzzer.lastChangeUs - postStart, buzzer.level, beepOk ? "true" : "false");
+
+    // Tout 2xx autorise (bip de capture + 1 long), un refus dans le corps
+    // d'un 200 reste un refus (bip de capture + 5 courts)
+    struct { int code; const char *body; uint32_t beeps; } answers[] = {
+        {200, "OK", 3}, {201, "Created", 3}, {204, "", 3}, {200, "decision=deny", 7}, {500, "", 7},
+    };
+    bool codesOk = true;
+    for (const auto &answer : answers) {
+        server.handler = [&](const LoopbackRequest &) {
+            LoopbackResponse response;
+            response.code = answer.code;
+            response.body = answer.body;
+            return response;
+        };
+        uint32_t id = lastScan.id;
+        rises = buzzer.risingEdges;
+        field.place(card);
+        while (lastScan.id == id) {
+            handleRFIDOperations();
+            delay(1);
+        }
+        field.remove();
+        nativeDrainPipeline();
+        uint32_t beeps = buzzer.risingEdges - rises;
+        codesOk &= beeps == answer.beeps;
+        printf("{\"check\":\"codes-2xx\",\"code\":%d,\"body\":\"%s\",\"beeps\":%lu,\"ok\":%s}\n", answer.code,
+               answer.body, (unsigned long)beeps, beeps == answer.beeps ? "true" : "false");
+    }
+    server.handler = nullptr;
+    while (outboxStats().pending) {
+        outboxLoop();
+        delay(10);
+    }
+    return queueFullOk && beepOk && codesOk ? 0 : 1;
+}
+
+// === Bits d'accès : opérations évitées ===
+static void accessBenchRun(const char *op, const char *plan, int scans, bool cold) {
+    SimField &field = SimField::instance();
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k-mixed");
+    AccessStats before = accessStats();
+    uint64_t totalUs = 0;
+    for (int i = 0; i < scans; i++) {
+        // Premier passage : chaque scan repart d'un cache vide
+        if (cold) accessForget();
+        field.place(card);
+        unsigned long t = micros();
+        handleRFIDOperations();
+        totalUs += micros() - t;
+        field.remove();
+        nativeDrainPipeline();
+    }
+    const AccessStats &after = accessStats();
+    printf("{\"op\":\"%s\",\"plan\":\"%s\",\"scans\":%d,\"meanUs\":%lu,\"authFailures\":%u,"
+           "\"reselects\":%u,\"trailersRead\":%u,\"skippedAuths\":%u,\"skippedReads\":%u,"
+           "\"skippedWrites\":%u}\n",
+           op, plan, scans, (unsigned long)(totalUs / scans), (unsigned)card->authFailures / scans,
+           (after.reselects - before.reselects) / scans, (after.trailersRead - before.trailersRead) / scans,
+           (after.skippedAuths - before.skippedAuths) / scans, (after.skippedReads - before.skippedReads) / scans,
+           (after.skippedWrites - before.skippedWrites) / scans);
+}
+
+int runAccessBench(int argc, char **argv) {
+    int scans = argc > 2 ? atoi(argv[2]) : 10;
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    readMemoryEnabled = true;
+    saveReadProfile("full");
+    // Liste locale vide : décision API, hors du temps mesuré (pipeline)
+    apiUrl = "http://127.0.0.1/api/scan";
+    const ScanMode modes[] = {MODE_READ, MODE_FORMAT};
+    const char *ops[] = {"dump", "format"};
+    for (uint8_t m = 0; m < 2; m++) {
+        mode = modes[m];
+        accessPlanning = false;
+        accessBenchRun(ops[m], "blind", scans, false);
+        accessPlanning = true;
+        accessBenchRun(ops[m], "cold", scans, true);
+        accessBenchRun(ops[m], "cached", scans, false);
+    }
+    mode = MODE_READ;
+    return 0;
+}
+
+// === Réglage RF ===
+static uint32_t rfFailures() {
+    const RfTuningStats &rf = rfTuningStats();
+    uint32_t failures = 0;
+    for (uint8_t i = 0; i < RF_OP_COUNT; i++) failures += rf.ops[i].failures;
+    return failures;
+}
+
+// Scans successifs ; un scan réussi au premier essai n'a connu aucun échec RF
+static void rfTuneScans(const char *phase, int scans, std::shared_ptr<SimCard> card) {
+    SimField &field = SimField::instance();
+    int firstTry = 0, attempts = 0;
+    for (int i = 0; i < scans; i++) {
+        uint32_t failures = rfFailures();
+        uint32_t id = lastScan.id;
+        field.place(card);
+        for (int a = 0; a < 20 && lastScan.id == id; a++) {
+            handleRFIDOperations();
+            attempts++;
+        }
+        field.remove();
+        nativeDrainPipeline();
+        rfTuningLoop();
+        if (lastScan.id != id && rfFailures() == failures) firstTry++;
+    }
+    // Attente d'un REQA sans carte : coût de chaque tour de loop() à vide
+    unsigned long t = micros();
+    mfrc522.PICC_IsNewCardPresent();
+    unsigned long idleUs = micros() - t;
+    const RfTuningStats &rf = rfTuningStats();
+    printf("{\"phase\":\"%s\",\"scans\":%d,\"firstTryPct\":%.1f,\"attemptsPerScan\":%.2f,"
+           "\"gainDb\":%u,\"timerUs\":%lu,\"idlePollUs\":%lu,\"adjustments\":%u}\n",
+           phase, scans, 100.0 * firstTry / scans, (double)attempts / scans,
+           (unsigned)(mfrc522.PCD_GetAntennaGain() >> 4) * 5 + 13, (unsigned long)(rfTimerReload + 1) * 25,
+           idleUs, (unsigned)rf.adjustments);
+}
+
+int runRfTuneBench(int argc, char **argv) {
+    int scans = argc > 2 ? atoi(argv[2]) : 200;
+    SimField &field = SimField::instance();
+    field.coupling = argc > 3 ? atof(argv[3]) : 0.6f;
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    readMemoryEnabled = true;
+    saveReadProfile("full");
+    apiUrl = "http://127.0.0.1/api/scan";
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k");
+
+    // Gain et timer de la bibliothèque, sans réglage automatique
+    saveRfTuning(RF_GAIN_DEFAULT, RF_TIMER_RELOAD_DEFAULT, false);
+    rfApply(rfGain, rfTimerReload);
+    rfTuneScans("default", scans / 4, card);
+
+    saveRfTuning(RF_GAIN_DEFAULT, RF_TIMER_RELOAD_DEFAULT, true);
+    rfApply(rfGain, rfTimerReload);
+    char phase[16];
+    for (int part = 1; part <= 4; part++) {
+        snprintf(phase, sizeof(phase), "auto-%d", part);
+        rfTuneScans(phase, scans / 4, card);
+    }
+
+    // Calibration depuis le réglage par défaut, carte de référence posée
+    saveRfTuning(RF_GAIN_DEFAULT, RF_TIMER_RELOAD_DEFAULT, false);
+    rfApply(rfGain, rfTimerReload);
+    field.place(card);
+    unsigned long start = micros();
+    if (!rfCalibrationStart()) {
+        fprintf(stderr, "Calibration impossible\n");
+        return 1;
+    }
+    while (rfCalibrating()) rfTuningLoop();
+    unsigned long calibrationUs = micros() - start;
+    field.remove();
+    printf("{\"phase\":\"calibration\",\"durationMs\":%lu}\n", calibrationUs / 1000);
+    rfTuneScans("calibrated", scans / 4, card);
+    field.coupling = 0.0f;
+    return 0;
+}
+
+// === Surveillance du RC522 ===
+enum BenchFault { FAULT_BROWNOUT, FAULT_GLITCH, FAULT_ANTENNA, BENCH_FAULT_COUNT };
+static const char *const benchFaultNames[BENCH_FAULT_COUNT] = {"coupure", "esd", "antenne"};
+
+static void injectFault(BenchFault fault) {
+    SimField &field = SimField::instance();
+    if (fault == FAULT_BROWNOUT) field.injectBrownout();
+    else if (fault == FAULT_GLITCH) field.injectGlitch();
+    else mfrc522.PCD_AntennaOff();
+}
+
+// Une carte présentée toutes les 500 ms (300 ms dans le champ) pendant 10 s,
+// défaut injecté entre 1 et 2 s ; boucle principale de 10 ms
+static void rc522Trial(BenchFault fault, bool watchdog, std::shared_ptr<SimCard> card, int &presented,
+                       int &missed, uint64_t &recoveredUs, int &recovered) {
+    SimField &field = SimField::instance();
+    mfrc522.PCD_Init();
+    rfTuningBegin();
+    rc522HealthCheck();
+    uint32_t recoveries = rc522HealthStats().recoveries;
+    unsigned long start = millis();
+    unsigned long faultAt = 1000 + random(1000);
+    unsigned long injectedUs = 0;
+    bool injected = false;
+    int presentation = -1;
+    uint32_t idAtPlacement = 0;
+    while (millis() - start < 10000) {
+        unsigned long t = millis() - start;
+        if (!injected && t >= faultAt) {
+            injectFault(fault);
+            injectedUs = micros();
+            injected = true;
+        }
+        int slot = t / 500;
+        bool inField = t % 500 < 300;
+        if (inField && slot != presentation) {
+            presentation = slot;
+            idAtPlacement = lastScan.id;
+            field.place(card);
+        } else if (!inField && field.present()) {
+            field.remove();
+            // Présentations entièrement postérieures au défaut
+            if (injected && presentation * 500UL >= faultAt) {
+                presented++;
+                if (lastScan.id == idAtPlacement) missed++;
+            }
+        }
+        // Même enchaînement que loop() : le retour buzzer ne bloque pas la boucle
+        handleRFIDOperations();
+        scanPipelineLoop();
+        if (watchdog) rc522HealthLoop();
+        if (injected && injectedUs && rc522HealthStats().recoveries != recoveries) {
+            recoveredUs += micros() - injectedUs;
+            recovered++;
+            injectedUs = 0;
+        }
+        delay(10);
+    }
+    if (field.present()) field.remove();
+}
+
+int runRc522Bench(int argc, char **argv) {
+    int trials = argc > 2 ? atoi(argv[2]) : 20;
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    randomSeed(41);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    readMemoryEnabled = false;
+    apiUrl = "http://127.0.0.1/api/scan";
+    std::shared_ptr<SimCard> card = nativeMakeCard("ntag215");
+    for (int f = 0; f < BENCH_FAULT_COUNT; f++) {
+        for (int w = 0; w < 2; w++) {
+            bool watchdog = w == 1;
+            const Rc522HealthStats before = rc522HealthStats();
+            int presented = 0, missed = 0, recovered = 0;
+            uint64_t recoveredUs = 0;
+            for (int i = 0; i < trials; i++) {
+                rc522Trial((BenchFault)f, watchdog, card, presented, missed, recoveredUs, recovered);
+            }
+            const Rc522HealthStats &after = rc522HealthStats();
+            uint32_t recoveries = after.recoveries - before.recoveries;
+            printf("{\"fault\":\"%s\",\"watchdog\":%s,\"trials\":%d,\"presented\":%d,\"missed\":%d,"
+                   "\"recovered\":%d,\"injectToRecoveredMs\":%.1f,\"recoveryUs\":%lu,\"hardResets\":%lu}\n",
+                   benchFaultNames[f], watchdog ? "true" : "false", trials, presented, missed, recovered,
+                   recovered ? recoveredUs / 1000.0 / recovered : 0.0,
+                   recoveries ? (unsigned long)after.lastRecoveryUs : 0UL,
+                   (unsigned long)(after.hardResets - before.hardResets));
+        }
+    }
+    return 0;
+}
+
+// === ISO 14443-4 ===
+static void isoScans(const char *name, std::shared_ptr<SimCard> card, bool iso, int scans) {
+    SimField &field = SimField::instance();
+    isoDepEnabled = iso;
+    IsoDepStats before = isoDepStats();
+    uint64_t captureUs = 0;
+    int completed = 0;
+    for (int i = 0; i < scans; i++) {
+        // Cartes différentes à chaque passage : aucun cache de bits d'accès
+        accessForget();
+        uint32_t id = lastScan.id;
+        field.place(card);
+        unsigned long start = micros();
+        handleRFIDOperations();
+        captureUs += micros() - start;
+        field.remove();
+        nativeDrainPipeline();
+        if (lastScan.id != id) completed++;
+    }
+    const IsoDepStats &after = isoDepStats();
+    printf("{\"card\":\"%s\",\"isoDep\":%s,\"scans\":%d,\"completed\":%d,\"captureMs\":%.2f,"
+           "\"framesPerScan\":%.1f,\"apdusPerScan\":%.1f,\"retransmissions\":%lu,\"wtx\":%lu,\"errors\":%lu,"
+           "\"skipped\":%lu}\n",
+           name, iso ? "true" : "false", scans, completed, captureUs / 1000.0 / scans,
+           (double)(after.frames - before.frames) / scans, (double)(after.apdus - before.apdus) / scans,
+           (unsigned long)(after.retransmissions - before.retransmissions),
+           (unsigned long)(after.waitExtensions - before.waitExtensions), (unsigned long)(after.errors - before.errors),
+           (unsigned long)(after.skipped - before.skipped));
+}
+
+int runIsoBench(int argc, char **argv) {
+    int scans = argc > 2 ? atoi(argv[2]) : 20;
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    readMemoryEnabled = true;
+    saveReadProfile("full");
+    apiUrl = "http://127.0.0.1/api/scan";
+    const char *names[] = {"desfire", "iso14443-4", "mifareplus"};
+    for (const char *name : names) {
+        std::shared_ptr<SimCard> card = nativeMakeCard(name);
+        isoScans(name, card, false, scans);
+        isoScans(name, card, true, scans);
+    }
+    // Message NDEF de 240 octets, à 424 kbit/s puis sans TA(1) (pas de PPS, 106 kbit/s)
+    std::vector<byte> message = {0xD1, 0x01, 237, 'T', 0x02, 'f', 'r'};
+    message.resize(240, 'x');
+    std::shared_ptr<SimIsoDepCard> large = simDesfire();
+    large->setNdef(message);
+    isoScans("desfire-ndef240", large, true, scans);
+    large->ats = {0x05, 0x55, 0x81, 0x02, 0x80};
+    isoScans("desfire-ndef240-106", large, true, scans);
+    std::shared_ptr<SimIsoDepCard> busy = simDesfire();
+    busy->waitExtension = true;
+    isoScans("desfire-wtx", busy, true, scans);
+    // Liaison dégradée : trames perdues, reprises par R(NAK)
+    SimField::instance().coupling = 0.9f;
+    isoScans("desfire-lossy", simDesfire(), true, scans);
+    SimField::instance().coupling = 0.0f;
+    isoDepEnabled = true;
+    return 0;
+}
+
+// === NDEF ===
+// Recherche du message puis parcours des enregistrements ; copie : message et
+// charges utiles recopiés dans des String, comme le font les bibliothèques courantes
+static uint32_t ndefParse(const byte *area, size_t length, bool copy) {
+    const byte *message;
+    size_t messageLength;
+    size_t needed;
+    uint32_t sum = 0;
+    if (ndefFindMessage(area, length, &message, &messageLength, &needed) != NDEF_OK) return 0;
+    String messageCopy;
+    if (copy) {
+        messageCopy.reserve(messageLength);
+        for (size_t i = 0; i < messageLength; i++) messageCopy += (char)message[i];
+        message = reinterpret_cast<const byte *>(messageCopy.c_str());
+    }
+    NdefCursor cursor;
+    NdefRecord record;
+    ndefBegin(cursor, message, messageLength);
+    while (ndefNextRecord(cursor, record) == NDEF_OK) {
+        if (copy) {
+            String payload;
+            payload.reserve(record.payloadLength);
+            for (uint32_t i = 0; i < record.payloadLength; i++) payload += (char)record.payload[i];
+            sum += payload.length();
+        } else {
+            sum += record.payloadLength;
+        }
+    }
+    return sum;
+}
+
+static void ndefParseBench(const char *name, const byte *area, size_t length, int iterations) {
+    for (int copy = 0; copy < 2; copy++) {
+        NativeHeapStats before = nativeHeapStats();
+        volatile uint32_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) sink = sink + ndefParse(area, length, copy);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        NativeHeapStats after = nativeHeapStats();
+        printf("{\"parse\":\"%s\",\"mode\":\"%s\",\"bytes\":%u,\"iterations\":%d,\"nsPerParse\":%.1f,"
+               "\"allocsPerParse\":%.1f}\n",
+               name, copy ? "copie" : "en place", (unsigned)length, iterations, ns / iterations,
+               (double)(after.allocations - before.allocations) / iterations);
+    }
+}
+
+static String ndefUrlEncode(const String &value) {
+    String out;
+    char hex[4];
+    for (unsigned int i = 0; i < value.length(); i++) {
+        char c = value[i];
+        if (isalnum((unsigned char)c) || c == '.' || c == '-' || c == '_') {
+            out += c;
+        } else {
+            snprintf(hex, sizeof(hex), "%%%02X", (unsigned char)c);
+            out += hex;
+        }
+    }
+    return out;
+}
+
+// /api/write, carte posée en mode écriture, puis relue en mode lecture
+static bool ndefRoundTrip(const char *name, std::shared_ptr<SimCard> card, const char *format, const String &value,
+                          const char *expected) {
+    SimField &field = SimField::instance();
+    NdefStats before = ndefStats();
+    String uri = String("/api/write?ndef=") + format + "&data=" + ndefUrlEncode(value);
+    int code = webServer.request(HTTP_GET, uri, String(), "application/x-www-form-urlencoded").code;
+    uint32_t writesBefore = card->writes;
+    field.place(card);
+    handleRFIDOperations();
+    field.remove();
+    nativeDrainPipeline();
+    uint32_t blockWrites = card->writes - writesBefore;
+    bool written = code == 200 && ndefStats().writes == before.writes + 1;
+    scanModeActivate(MODE_READ);
+    // Relecture : un premier passage, puis un passage mesuré (droits en cache)
+    uint32_t readMs = 0;
+    uint32_t extraReads = 0;
+    double allocs = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t extraBefore = ndefStats().extraReads;
+        NativeHeapStats heapBefore = nativeHeapStats();
+        field.place(card);
+        unsigned long start = micros();
+        handleRFIDOperations();
+        readMs = (micros() - start) / 1000;
+        field.remove();
+        nativeDrainPipeline();
+        NativeHeapStats heapAfter = nativeHeapStats();
+        extraReads = ndefStats().extraReads - extraBefore;
+        allocs = (double)(heapAfter.allocations - heapBefore.allocations) -
+                 (heapAfter.networkAllocations - heapBefore.networkAllocations);
+    }
+    bool found = strstr(lastCardInfo, expected) != nullptr;
+    printf("{\"card\":\"%s\",\"ndef\":\"%s\",\"bytes\":%u,\"written\":%s,\"blockWrites\":%lu,\"formatted\":%lu,"
+           "\"readMs\":%lu,\"extraReads\":%lu,\"allocs\":%.0f,\"found\":%s}\n",
+           name, format, value.length(), written ? "true" : "false", (unsigned long)blockWrites,
+           (unsigned long)(ndefStats().formatted - before.formatted), (unsigned long)readMs,
+           (unsigned long)extraReads, allocs, found ? "true" : "false");
+    if (!found) fprintf(stderr, "%s\n", lastCardInfo);
+    return written && found;
+}
+
+int runNdefBench(int argc, char **argv) {
+    int iterations = argc > 2 ? atoi(argv[2]) : 100000;
+    bool ok = true;
+    // Images de référence (vérifiées par test/test_ndef)
+    byte classicArea[96];
+    size_t classicLength = classicNdefArea(classic1kImage, 16, classicArea, sizeof(classicArea));
+    std::vector<byte> vcard = ndefVcardArea();
+
+    // Temps d'analyse (horloge réelle)
+    ndefParseBench("ntag213", ntag213Image + 16, 48, iterations);
+    ndefParseBench("classic1k-mad", classicArea, classicLength, iterations);
+    ndefParseBench("mime-300", vcard.data(), vcard.size(), iterations);
+
+    // Écriture puis lecture sur cartes simulées
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    readMemoryEnabled = true;
+    saveReadProfile("full");
+    apiUrl = "http://127.0.0.1/api/scan";
+    // Pas d'enregistrement de réglage RF pendant les relectures (allocations)
+    bool autoTune = rfAutoTune;
+    rfAutoTune = false;
+    std::shared_ptr<SimCard> classic = nativeMakeCard("classic1k");
+    std::shared_ptr<SimCard> ntag = nativeMakeCard("ntag215");
+    String longMessage = "Consignes : ";
+    while (longMessage.length() < 200) longMessage += "badge visible, ";
+    ok &= ndefRoundTrip("ultralight", nativeMakeCard("ultralight"), "uri", "https://example.com/a",
+                        "URI https://example.com/a");
+    ok &= ndefRoundTrip("ntag215", ntag, "uri", "https://www.example.org/badge?id=1234",
+                        "URI https://www.example.org/badge?id=1234");
+    ok &= ndefRoundTrip("ntag215", ntag, "text", "Bonjour", "Texte [fr] Bonjour");
+    ok &= ndefRoundTrip("ntag216", nativeMakeCard("ntag216"), "text", longMessage, "Texte [fr] Consignes : badge");
+    ok &= ndefRoundTrip("classic1k", classic, "uri", "https://intranet.example.com/agents/fiche?matricule=000123",
+                        "URI https://intranet.example.com/agents/fiche?matricule=000123");
+    ok &= ndefRoundTrip("classic1k", classic, "text", "Accès visiteur", "Texte [fr] Accès visiteur");
+    ndefCancelWrite();
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
+
+// === Encodage en série ===
+static bool provisionImportCheck(const char *name, const String &file, uint32_t expected) {
+    NativeHttpResponse response =
+        webServer.requestUpload("/api/provision/queue", "file", (const uint8_t *)file.c_str(), file.length());
+    bool ok = expected ? response.code == 200 && provisionStats().queued == expected : response.code == 400;
+    printf("{\"check\":\"%s\",\"code\":%d,\"queued\":%lu,\"ok\":%s}\n", name, response.code,
+           (unsigned long)provisionStats().queued, ok ? "true" : "false");
+    if (!ok) fprintf(stderr, "%s\n", response.body.c_str());
+    return ok;
+}
+
+static void provisionPayload(int index, char *format, char *data, size_t size) {
+    static const char *const formats[] = {"raw", "uri", "text"};
+    strcpy(format, formats[index % 3]);
+    if (index % 3 == 0) {
+        snprintf(data, size, "BADGE-%05d", index);
+    } else if (index % 3 == 1) {
+        snprintf(data, size, "https://badges.example.com/p/%05d", index);
+    } else {
+        snprintf(data, size, "Agent %05d, accès niveau %d", index, index % 4);
+    }
+}
+
+// Cartes vierges d'UID distincts, Classic 1K et NTAG215 en alternance
+static std::shared_ptr<SimCard> provisionBlankCard(int index) {
+    if (index % 2 == 0) return simClassic1K(0x50000000UL + index);
+    const byte uid[7] = {0x04, 0x50, (byte)(index >> 16), (byte)(index >> 8), (byte)index, 0x2A, 0x80};
+    return std::make_shared<SimUltralightCard>(SimUltralightCard::NTAG215, uid);
+}
+
+// Zone de données de la carte simulée : blocs 4 à 6 puis secteurs suivants
+// (Classic), pages 4 et suivantes (NTAG)
+static size_t provisionArea(SimCard &card, byte *out, size_t size) {
+    size_t n = 0;
+    if (SimClassicCard *classic = dynamic_cast<SimClassicCard *>(&card)) {
+        for (byte sector = 1; sector < 16 && n + 48 <= size; sector++) {
+            for (byte block = 0; block < 3; block++, n += 16) memcpy(out + n, classic->block(sector * 4 + block), 16);
+        }
+    } else if (SimUltralightCard *ntag = dynamic_cast<SimUltralightCard *>(&card)) {
+        for (uint16_t page = 4; page < ntag->pageCount() && n + 4 <= size; page++, n += 4) {
+            memcpy(out + n, ntag->page(page), 4);
+        }
+    }
+    return n;
+}
+
+// Contenu relu directement dans la mémoire simulée, sans passer par le lecteur
+static bool provisionVerify(SimCard &card, const char *format, const char *data) {
+    byte area[NDEF_AREA_MAX];
+    size_t length = provisionArea(card, area, sizeof(area));
+    if (strcmp(format, "raw") == 0) {
+        size_t dataLength = strlen(data);
+        if (memcmp(area, data, dataLength) != 0) return false;
+        for (size_t i = dataLength; i < ((dataLength + 15) & ~(size_t)15); i++) {
+            if (area[i]) return false;
+        }
+        return true;
+    }
+    const byte *message = nullptr;
+    size_t messageLength = 0;
+    size_t needed;
+    NdefCursor cursor;
+    NdefRecord record;
+    char text[NDEF_WRITE_MAX];
+    char expected[NDEF_WRITE_MAX];
+    // Classic : MAD et secteurs NDEF ; la zone commence au secteur 1
+    if (ndefFindMessage(area, length, &message, &messageLength, &needed) != NDEF_OK) return false;
+    ndefBegin(cursor, message, messageLength);
+    if (ndefNextRecord(cursor, record) != NDEF_OK) return false;
+    ndefDescribe(record, text, sizeof(text));
+    snprintf(expected, sizeof(expected), strcmp(format, "uri") == 0 ? "URI %s" : "Texte [fr] %s", data);
+    return strcmp(text, expected) == 0;
+}
+
+// Durée d'occupation du lecteur ; le bip final (non bloquant en mode
+// PROVISION) se termine ensuite, avant la carte suivante
+static uint32_t provisionPresent(std::shared_ptr<SimCard> card) {
+    SimField &field = SimField::instance();
+    field.place(card);
+    unsigned long start = micros();
+    handleRFIDOperations();
+    uint32_t us = micros() - start;
+    field.remove();
+    nativeDrainPipeline();
+    return us;
+}
+
+int runProvisionBench(int argc, char **argv) {
+    int cards = argc > 2 ? atoi(argv[2]) : 120;
+    if (cards < 10) cards = 10;
+    bool ok = true;
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    bool autoTune = rfAutoTune;
+    rfAutoTune = false;
+    provisionReset();
+
+    // Import : CSV (en-tête, guillemets, formats), JSON (chaînes, objets, \u), refus
+    ok &= provisionImportCheck("csv", "data,format\n\"Dupont, Marie\",text\nhttps://example.com/a,uri\nBADGE-1\n\n# fin\n", 3);
+    ok &= provisionImportCheck("json", "[\"BADGE-2\", {\"data\":\"https://example.com/b\",\"ndef\":\"uri\"},"
+                                       " {\"format\":\"text\",\"data\":\"Acc\\u00e8s\"}]", 3);
+    ok &= provisionImportCheck("format-inconnu", "BADGE-3,raw\n\"BADGE-4\",mifare\n", 0) &&
+          provisionStats().queued == 3;
+    String tooLong;
+    while (tooLong.length() <= WRITE_DATA_MAX) tooLong += 'x';
+    ok &= provisionImportCheck("brut-trop-long", tooLong + "\n", 0);
+    ok &= provisionImportCheck("json-invalide", "[\"BADGE-5\", 12]", 0);
+
+    // File de n contenus, un seul envoi
+    String csv = "data,format\n";
+    char format[8];
+    char data[64];
+    for (int i = 0; i < cards; i++) {
+        provisionPayload(i, format, data, sizeof(data));
+        csv += String("\"") + data + "\"," + format + "\n";
+    }
+    ok &= provisionImportCheck("file", csv, cards);
+    LoopbackHttpServer::instance().clear();
+    uint32_t requestsBefore = webServer.requestsServed;
+    webServer.request(HTTP_GET, "/api/command?cmd=PROVISION", String(), "application/x-www-form-urlencoded");
+
+    // Cartes vierges ; toutes les 10 cartes, la dernière est représentée
+    // (doublon) puis une carte déjà écrite est posée (non vierge)
+    std::vector<std::shared_ptr<SimCard>> encoded;
+    std::shared_ptr<SimClassicCard> used = simClassic1K(0x0BADCAFE);
+    const byte usedBlock[16] = {'D', 'E', 'J', 'A'};
+    used->setBlock(4, usedBlock);
+    unsigned long start = micros();
+    uint32_t cardUs = 0;
+    for (int i = 0; i < cards; i++) {
+        std::shared_ptr<SimCard> card = provisionBlankCard(i);
+        cardUs += provisionPresent(card);
+        encoded.push_back(card);
+        if (i % 10 == 4) {
+            provisionPresent(card);
+            provisionPresent(used);
+        }
+    }
+    unsigned long elapsedUs = micros() - start;
+    // File épuisée : la carte suivante est refusée sans écriture
+    std::shared_ptr<SimCard> extra = provisionBlankCard(cards);
+    provisionPresent(extra);
+    bool emptyOk = extra->writes == 0 && used->writes == 0;
+
+    uint32_t verified = 0;
+    for (int i = 0; i < cards; i++) {
+        provisionPayload(i, format, data, sizeof(data));
+        if (provisionVerify(*encoded[i], format, data)) verified++;
+    }
+    // Journal : une ligne par carte encodée, dans l'ordre de la file
+    uint32_t logLines = 0;
+    bool logOk = true;
+    File log = LittleFS.open(PROVISION_LOG_PATH, "r");
+    while (log && log.available()) {
+        String line = log.readStringUntil('\n');
+        provisionPayload(logLines, format, data, sizeof(data));
+        char uid[UID_HEX_MAX];
+        SimCard &card = *encoded[min((int)logLines, cards - 1)];
+        hexEncode(card.uid, card.uidSize, uid);
+        logOk &= line == String(uid) + ";" + (logLines + 1) + ";" + format + ";" + data;
+        logLines++;
+    }
+    log.close();
+    const ProvisionStats &stats = provisionStats();
+    int rounds = (cards + 5) / 10;
+    bool runOk = stats.written == (uint32_t)cards && stats.failures == 0 && stats.duplicates == (uint32_t)rounds &&
+                 stats.notBlank == (uint32_t)rounds && verified == (uint32_t)cards && logOk &&
+                 logLines == (uint32_t)cards && emptyOk;
+    ok &= runOk;
+    double perCardMs = cardUs / 1000.0 / cards;
+    printf("{\"flow\":\"provision\",\"cards\":%d,\"written\":%lu,\"verified\":%lu,\"failures\":%lu,"
+           "\"duplicates\":%lu,\"notBlank\":%lu,\"logLines\":%lu,\"msPerCard\":%.1f,\"cardsPerHour\":%.0f,"
+           "\"sessionMs\":%lu,\"httpRequests\":%lu,\"ok\":%s}\n",
+           cards, (unsigned long)stats.written, (unsigned long)verified, (unsigned long)stats.failures,
+           (unsigned long)stats.duplicates, (unsigned long)stats.notBlank, (unsigned long)logLines, perCardMs,
+           3600000.0 / perCardMs, elapsedUs / 1000, (unsigned long)(webServer.requestsServed - requestsBefore),
+           runOk ? "true" : "false");
+
+    // Redémarrage : curseur et UID connus relus depuis LittleFS
+    provisioningBegin();
+    provisionPresent(encoded[0]);
+    bool resumeOk = provisionStats().next == (uint32_t)cards && provisionStats().duplicates == 1;
+    ok &= resumeOk;
+    printf("{\"check\":\"reprise\",\"next\":%lu,\"duplicates\":%lu,\"ok\":%s}\n",
+           (unsigned long)provisionStats().next, (unsigned long)provisionStats().duplicates,
+           resumeOk ? "true" : "false");
+
+    // Référence : une requête /api/write par carte, mode écriture (bip bloquant)
+    int manual = min(cards, 30);
+    requestsBefore = webServer.requestsServed;
+    cardUs = 0;
+    uint32_t manualVerified = 0;
+    for (int i = 0; i < manual; i++) {
+        std::shared_ptr<SimCard> card = provisionBlankCard(100000 + 2 * i);
+        snprintf(data, sizeof(data), "BADGE-%05d", i);
+        webServer.request(HTTP_GET, String("/api/write?data=") + data, String(), "application/x-www-form-urlencoded");
+        cardUs += provisionPresent(card);
+        if (provisionVerify(*card, "raw", data)) manualVerified++;
+    }
+    perCardMs = cardUs / 1000.0 / manual;
+    printf("{\"flow\":\"api-write\",\"cards\":%d,\"verified\":%lu,\"msPerCard\":%.1f,\"cardsPerHour\":%lu,"
+           "\"httpRequests\":%lu}\n",
+           manual, (unsigned long)manualVerified, perCardMs, (unsigned long)(3600000.0 / perCardMs),
+           (unsigned long)(webServer.requestsServed - requestsBefore));
+
+    scanModeActivate(MODE_READ);
+    provisionReset();
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
+
+// === Liaison série vers un hôte (program serial) ===
+#define SERIAL_BENCH_MAX_EVENTS 2000
+#define SERIAL_BENCH_PINGS      200
+
+// Partagé entre le lecteur simulé et le processus hôte (MAP_SHARED)
+struct SerialBenchShared {
+    volatile uint32_t received;
+    volatile bool ready;          // hôte en attente (binaire : bascule confirmée)
+    volatile bool scansDone;      // plus de scans à venir côté lecteur
+    volatile bool hostDone;
+    uint32_t idGaps;              // identifiants de scan non consécutifs
+    uint32_t textSegments;        // segments non-trames reçus en binaire
+    uint32_t crcErrors;
+    uint32_t framingErrors;
+    uint32_t pingRtt[SERIAL_BENCH_PINGS];
+    uint32_t pings;
+    bool resyncOk;                // ping acquitté après une trame corrompue
+    bool statusOk;
+    uint64_t sentUs[SERIAL_BENCH_MAX_EVENTS];
+    uint64_t receivedUs[SERIAL_BENCH_MAX_EVENTS];
+};
+
+// Horloge réelle commune aux deux processus, indépendante du temps virtuel
+static uint64_t monotonicUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct SerialBenchHost {
+    int fd;
+    SerialBenchShared *shared;
+    LinkDecoder decoder;
+    uint8_t seq;
+};
+
+static int hostRead(SerialBenchHost &host, uint8_t *buf, size_t size, int timeoutMs) {
+    struct pollfd pfd = {host.fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeoutMs) <= 0) return 0;
+    ssize_t n = read(host.fd, buf, size);
+    return n > 0 ? (int)n : 0;
+}
+
+static void hostSend(SerialBenchHost &host, uint8_t type, const uint8_t *body, size_t length) {
+    uint8_t payload[LINK_PAYLOAD_MAX];
+    uint8_t frame[LINK_FRAME_MAX];
+    payload[0] = type;
+    payload[1] = host.seq++;
+    if (length) memcpy(payload + LINK_HEADER_SIZE, body, length);
+    size_t n = linkEncode(payload, LINK_HEADER_SIZE + length, frame, sizeof(frame));
+    if (write(host.fd, frame, n) != (ssize_t)n) return;
+}
+
+// Trame suivante du type demandé ; les autres sont traitées comme des scans
+static bool hostExpect(SerialBenchHost &host, uint8_t type, int timeoutMs) {
+    uint64_t deadline = monotonicUs() + timeoutMs * 1000ULL;
+    uint8_t c;
+    while (monotonicUs() < deadline) {
+        if (!hostRead(host, &c, 1, 10)) continue;
+        LinkFeed feed = linkDecoderFeed(host.decoder, c);
+        if (feed == LINK_ERROR) host.shared->textSegments++;
+        if (feed == LINK_FRAME && host.decoder.buf[0] == type) return true;
+    }
+    return false;
+}
+
+// Processus hôte, mode texte : chaque ligne « UID: » est un événement
+static void hostText(SerialBenchHost &host) {
+    SerialBenchShared &shared = *host.shared;
+    char line[256];
+    size_t length = 0;
+    uint8_t buf[512];
+    shared.ready = true;
+    while (true) {
+        int n = hostRead(host, buf, sizeof(buf), 10);
+        if (n == 0 && shared.scansDone) break;
+        for (int i = 0; i < n; i++) {
+            if (buf[i] != '\n') {
+                if (length < sizeof(line) - 1) line[length++] = buf[i];
+                continue;
+            }
+            line[length] = '\0';
+            length = 0;
+            if (strncmp(line, "UID: ", 5) == 0 && shared.received < SERIAL_BENCH_MAX_EVENTS) {
+                shared.receivedUs[shared.received++] = monotonicUs();
+            }
+        }
+    }
+}
+
+// Processus hôte, mode binaire : bascule, scans, état, pings, trame corrompue
+static void hostBinary(SerialBenchHost &host) {
+    SerialBenchShared &shared = *host.shared;
+    const char *command = "BINARY 921600\n";
+    if (write(host.fd, command, strlen(command)) < 0) return;
+    // Le texte de confirmation précède la première trame (état)
+    if (!hostExpect(host, LINK_MSG_STATUS, 2000)) return;
+    shared.textSegments = 0;
+    host.decoder.crcErrors = 0;
+    host.decoder.framingErrors = 0;
+    shared.ready = true;
+    uint8_t buf[512];
+    uint32_t lastId = 0;
+    while (true) {
+        int n = hostRead(host, buf, sizeof(buf), 10);
+        if (n == 0 && shared.scansDone) break;
+        for (int i = 0; i < n; i++) {
+            LinkFeed feed = linkDecoderFeed(host.decoder, buf[i]);
+            if (feed == LINK_ERROR) shared.textSegments++;
+            if (feed != LINK_FRAME || host.decoder.buf[0] != LINK_MSG_SCAN) continue;
+            uint32_t id = linkGet32(host.decoder.buf + LINK_HEADER_SIZE);
+            if (lastId && id != lastId + 1) shared.idGaps++;
+            lastId = id;
+            if (shared.received < SERIAL_BENCH_MAX_EVENTS) shared.receivedUs[shared.received++] = monotonicUs();
+        }
+    }
+    // Commandes : état, puis aller-retour d'un ping de 16 octets
+    hostSend(host, LINK_CMD_STATUS, nullptr, 0);
+    shared.statusOk = hostExpect(host, LINK_MSG_STATUS, 1000) && hostExpect(host, LINK_MSG_ACK, 1000);
+    uint8_t body[16] = {};
+    for (uint32_t i = 0; i < SERIAL_BENCH_PINGS; i++) {
+        linkPut32(body, i);
+        uint64_t start = monotonicUs();
+        hostSend(host, LINK_CMD_PING, body, sizeof(body));
+        if (!hostExpect(host, LINK_MSG_ACK, 1000)) break;
+        shared.pingRtt[shared.pings++] = monotonicUs() - start;
+    }
+    // Trame corrompue (un octet inversé) : rejetée au CRC, la suivante passe
+    uint8_t payload[LINK_HEADER_SIZE + 4] = {LINK_CMD_PING, host.seq++, 1, 2, 3, 4};
+    uint8_t frame[LINK_FRAME_MAX];
+    size_t n = linkEncode(payload, sizeof(payload), frame, sizeof(frame));
+    frame[3] ^= 0x40;
+    if (write(host.fd, frame, n) < 0) return;
+    hostSend(host, LINK_CMD_PING, body, 4);
+    shared.resyncOk = hostExpect(host, LINK_MSG_ACK, 1000);
+    uint8_t baud[4];
+    linkPut32(baud, SERIAL_LINK_TEXT_BAUD);
+    hostSend(host, LINK_CMD_TEXT, baud, sizeof(baud));
+    hostExpect(host, LINK_MSG_ACK, 1000);
+    shared.crcErrors = host.decoder.crcErrors;
+    shared.framingErrors = host.decoder.framingErrors;
+}
+
+struct SerialBenchRow {
+    uint32_t events;
+    double bytesPerEvent;
+    double eventsPerSec;
+    uint32_t latencyP50;
+    uint32_t latencyP99;
+};
+
+// Un passage : lecteur simulé dans ce processus, hôte dans un processus fils
+static bool serialBenchRun(bool binary, int events, SerialBenchShared &shared, SerialBenchRow &row) {
+    char path[64];
+    int master = nativeOpenPty(path, sizeof(path));
+    if (master < 0) return false;
+    memset(&shared, 0, sizeof(shared));
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        SerialBenchHost host = {open(path, O_RDWR | O_NOCTTY), &shared, {}, 0};
+        linkDecoderReset(host.decoder);
+        if (host.fd >= 0) {
+            if (binary) hostBinary(host);
+            else hostText(host);
+        }
+        shared.hostDone = true;
+        _exit(0);
+    }
+    Serial.attachFd(master);
+    // Le lecteur traite les commandes de l'hôte jusqu'à ce qu'il soit prêt
+    uint64_t deadline = monotonicUs() + 3000000;
+    while (!shared.ready && !shared.hostDone && monotonicUs() < deadline) serialLinkPoll();
+    SimField &field = SimField::instance();
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k");
+    size_t bytesBefore = Serial.bytesWritten();
+    uint64_t start = monotonicUs();
+    for (int i = 0; i < events && shared.ready; i++) {
+        field.place(card);
+        shared.sentUs[i] = monotonicUs();
+        handleRFIDOperations();
+        field.remove();
+        nativeDrainPipeline();
+        serialLinkPoll();
+    }
+    size_t bytes = Serial.bytesWritten() - bytesBefore;
+    // Attente des derniers événements, puis commandes de l'hôte
+    deadline = monotonicUs() + 2000000;
+    while (shared.received < (uint32_t)events && monotonicUs() < deadline) serialLinkPoll();
+    uint64_t end = shared.received ? shared.receivedUs[shared.received - 1] : monotonicUs();
+    shared.scansDone = true;
+    deadline = monotonicUs() + 10000000;
+    while (!shared.hostDone && monotonicUs() < deadline) serialLinkPoll();
+    if (!shared.hostDone) kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    Serial.attachFd(-1);
+    close(master);
+
+    std::vector<uint32_t> latencies;
+    for (uint32_t i = 0; i < shared.received; i++) latencies.push_back(shared.receivedUs[i] - shared.sentUs[i]);
+    std::sort(latencies.begin(), latencies.end());
+    row.events = shared.received;
+    row.bytesPerEvent = (double)bytes / events;
+    row.eventsPerSec = end > start ? shared.received * 1e6 / (end - start) : 0;
+    row.latencyP50 = percentile(latencies, 50);
+    row.latencyP99 = percentile(latencies, 99);
+    return shared.received == (uint32_t)events && !serialLinkBinary();
+}
+
+static String benchLine;
+static void benchLineHandler(String &line) {
+    benchLine = line;
+}
+
+int runSerialBench(int argc, char **argv) {
+    int events = argc > 2 ? atoi(argv[2]) : 200;
+    if (events < 1) events = 1;
+    if (events > SERIAL_BENCH_MAX_EVENTS) events = SERIAL_BENCH_MAX_EVENTS;
+    SerialBenchShared *shared = (SerialBenchShared *)mmap(nullptr, sizeof(SerialBenchShared), PROT_READ | PROT_WRITE,
+                                                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) return 1;
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    scanDelayMs = 0;
+    mode = MODE_READ;
+    bool autoTune = rfAutoTune;
+    rfAutoTune = false;
+    bool readMemory = readMemoryEnabled;
+    bool ok = true;
+
+    // Débit du fil : 10 bits par octet (8N1)
+    for (int memory = 0; memory < 2; memory++) {
+        readMemoryEnabled = memory;
+        for (int binary = 0; binary < 2; binary++) {
+            SerialBenchRow row = {};
+            bool runOk = serialBenchRun(binary, events, *shared, row);
+            uint32_t baud = binary ? 921600 : SERIAL_LINK_TEXT_BAUD;
+            if (binary) {
+                runOk &= shared->idGaps == 0 && shared->textSegments == 0 && shared->crcErrors == 0 &&
+                         shared->framingErrors == 0;
+            }
+            ok &= runOk;
+            printf("{\"link\":\"%s\",\"readMemory\":%s,\"events\":%lu,\"bytesPerEvent\":%.1f,"
+                   "\"eventsPerSecPty\":%.0f,\"latencyP50Us\":%lu,\"latencyP99Us\":%lu,\"wireBaud\":%lu,"
+                   "\"wireEventsPerSec\":%.0f,\"textSegments\":%lu,\"ok\":%s}\n",
+                   binary ? "binary" : "text", memory ? "true" : "false", (unsigned long)row.events,
+                   row.bytesPerEvent, row.eventsPerSec, (unsigned long)row.latencyP50,
+                   (unsigned long)row.latencyP99, (unsigned long)baud, baud / 10.0 / row.bytesPerEvent,
+                   (unsigned long)shared->textSegments, runOk ? "true" : "false");
+        }
+    }
+    // Commandes du dernier passage binaire
+    std::vector<uint32_t> rtts(shared->pingRtt, shared->pingRtt + shared->pings);
+    std::sort(rtts.begin(), rtts.end());
+    const SerialLinkStats &link = serialLinkStats();
+    bool commandsOk = shared->pings == SERIAL_BENCH_PINGS && shared->statusOk && shared->resyncOk &&
+                      link.crcErrors + link.framingErrors >= 1;
+    ok &= commandsOk;
+    printf("{\"check\":\"commandes\",\"pings\":%lu,\"rttP50Us\":%lu,\"rttP99Us\":%lu,\"status\":%s,"
+           "\"resync\":%s,\"deviceFrameErrors\":%lu,\"ok\":%s}\n",
+           (unsigned long)shared->pings, (unsigned long)percentile(rtts, 50), (unsigned long)percentile(rtts, 99),
+           shared->statusOk ? "true" : "false", shared->resyncOk ? "true" : "false",
+           (unsigned long)(link.crcErrors + link.framingErrors), commandsOk ? "true" : "false");
+
+    // Ligne incomplète (« REA » sans fin de ligne) : attente de loop(), temps réel
+    nativeSetVirtualTime(false);
+    Serial.inject("REA");
+    uint64_t t = monotonicUs();
+    String legacy = Serial.readStringUntil('\n');
+    uint32_t legacyUs = monotonicUs() - t;
+    serialLinkBegin(benchLineHandler);
+    benchLine = "";
+    Serial.inject("REA");
+    t = monotonicUs();
+    serialLinkPoll();
+    uint32_t pollUs = monotonicUs() - t;
+    Serial.inject("D\n");
+    serialLinkPoll();
+    bool lineOk = legacy == "REA" && benchLine == "READ";
+    serialLinkBegin(nullptr);
+    nativeSetVirtualTime(true);
+    ok &= lineOk;
+    printf("{\"check\":\"ligne-incomplete\",\"readStringUntilUs\":%lu,\"serialLinkPollUs\":%lu,"
+           "\"lineCompleted\":%s,\"ok\":%s}\n",
+           (unsigned long)legacyUs, (unsigned long)pollUs, benchLine == "READ" ? "true" : "false",
+           lineOk ? "true" : "false");
+
+    munmap(shared, sizeof(SerialBenchShared));
+    readMemoryEnabled = readMemory;
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
+
+// === Transport MQTT (program mqtt) ===
+#define MQTT_BENCH_MAX_EVENTS 2000
+#define MQTT_BENCH_MAX_IDS    (MQTT_BENCH_MAX_EVENTS + 256)
+#define MQTT_BENCH_COMMANDS   8
+
+// Partagé entre le lecteur et le broker de substitution (MAP_SHARED)
+struct MqttBenchShared {
+    volatile bool stop;
+    volatile bool holdAcks;           // PUBACK retenus jusqu'à nouvel ordre
+    volatile uint32_t ackDelayUs;     // aller-retour réseau simulé avant chaque PUBACK
+    volatile uint32_t dropRequests;   // coupure demandée par le lecteur
+    volatile uint32_t commandRequests;
+    volatile uint32_t connects;
+    volatile uint32_t sessionPresentConnects;
+    volatile uint32_t subscribes;
+    volatile uint32_t received;       // scans distincts
+    volatile uint32_t duplicates;     // scans déjà reçus (renvois)
+    volatile uint32_t dupFlags;       // PUBLISH marqués DUP
+    volatile uint32_t commandsSent;
+    volatile uint32_t commandsAcked;
+    volatile bool willSet;
+    volatile bool online;
+    volatile bool offlineGraceful;    // "offline" publié avant DISCONNECT
+    volatile uint32_t passWithoutUser; // CONNECT interdit par MQTT 3.1.1
+    char commandTopic[MQTT_BENCH_COMMANDS][48];
+    char commandPayload[MQTT_BENCH_COMMANDS][48];
+    uint64_t commandSentUs[MQTT_BENCH_COMMANDS];
+    char lastScan[MQTT_PAYLOAD_MAX + 1];
+    bool seen[MQTT_BENCH_MAX_IDS];
+    uint64_t receivedUs[MQTT_BENCH_MAX_IDS];
+};
+
+struct MqttBroker {
+    int listenFd;
+    int fd;
+    MqttBenchShared *shared;
+    bool sessionExists;
+    bool subscribed;
+    uint16_t packetId;
+    std::vector<uint8_t> in;
+    std::deque<std::pair<uint64_t, uint16_t>> pendingAcks;   // échéance, identifiant
+    std::vector<uint16_t> heldAcks;
+};
+
+static void brokerSend(MqttBroker &b, const uint8_t *packet, size_t length) {
+    if (b.fd >= 0 && ::send(b.fd, packet, length, MSG_NOSIGNAL) != (ssize_t)length) {
+        close(b.fd);
+        b.fd = -1;
+    }
+}
+
+static void brokerPuback(MqttBroker &b, uint16_t id) {
+    uint8_t packet[4] = {0x40, 2, (uint8_t)(id >> 8), (uint8_t)id};
+    brokerSend(b, packet, sizeof(packet));
+}
+
+static void brokerPublishCommand(MqttBroker &b, uint32_t index) {
+    MqttBenchShared &s = *b.shared;
+    const char *topic = s.commandTopic[index];
+    const char *payload = s.commandPayload[index];
+    size_t topicLength = strlen(topic);
+    size_t payloadLength = strlen(payload);
+    uint8_t packet[128];
+    size_t n = 0;
+    packet[n++] = 0x32;
+    packet[n++] = 2 + topicLength + 2 + payloadLength;
+    packet[n++] = topicLength >> 8;
+    packet[n++] = topicLength;
+    memcpy(packet + n, topic, topicLength);
+    n += topicLength;
+    b.packetId++;
+    packet[n++] = b.packetId >> 8;
+    packet[n++] = b.packetId;
+    memcpy(packet + n, payload, payloadLength);
+    n += payloadLength;
+    s.commandSentUs[index] = monotonicUs();
+    brokerSend(b, packet, n);
+    s.commandsSent++;
+}
+
+static bool endsWith(const char *text, size_t length, const char *suffix) {
+    size_t suffixLength = strlen(suffix);
+    return length >= suffixLength && memcmp(text + length - suffixLength, suffix, suffixLength) == 0;
+}
+
+static void brokerPacket(MqttBroker &b, uint8_t header, const uint8_t *body, size_t length) {
+    MqttBenchShared &s = *b.shared;
+    switch (header & 0xF0) {
+    case 0x10: {   // CONNECT
+        uint8_t flags = body[7];
+        // Mot de passe sans nom d'utilisateur : le broker ferme la connexion
+        if ((flags & 0x40) && !(flags & 0x80)) {
+            s.passWithoutUser++;
+            close(b.fd);
+            b.fd = -1;
+            break;
+        }
+        bool clean = flags & 0x02;
+        bool sessionPresent = b.sessionExists && !clean;
+        if (clean) b.subscribed = false;
+        b.sessionExists = true;
+        s.willSet = flags & 0x04;
+        uint8_t connack[4] = {0x20, 2, (uint8_t)sessionPresent, 0};
+        brokerSend(b, connack, sizeof(connack));
+        s.connects++;
+        if (sessionPresent) s.sessionPresentConnects++;
+        break;
+    }
+    case 0x30: {   // PUBLISH
+        uint8_t qos = (header >> 1) & 0x03;
+        size_t topicLength = (body[0] << 8) | body[1];
+        const char *topic = (const char *)body + 2;
+        size_t pos = 2 + topicLength;
+        uint16_t id = 0;
+        if (qos) {
+            id = (body[pos] << 8) | body[pos + 1];
+            pos += 2;
+        }
+        const char *payload = (const char *)body + pos;
+        size_t payloadLength = length - pos;
+        if (endsWith(topic, topicLength, "/status")) {
+            bool online = payloadLength == 6 && memcmp(payload, "online", 6) == 0;
+            s.online = online;
+            if (!online) s.offlineGraceful = true;
+        } else if (endsWith(topic, topicLength, "/scan")) {
+            if (header & 0x08) s.dupFlags++;
+            const char *scan = (const char *)memmem(payload, payloadLength, "&scan=", 6);
+            uint32_t scanId = scan ? strtoul(scan + 6, nullptr, 10) : 0;
+            if (scanId < MQTT_BENCH_MAX_IDS) {
+                if (s.seen[scanId]) {
+                    s.duplicates++;
+                } else {
+                    s.seen[scanId] = true;
+                    s.receivedUs[scanId] = monotonicUs();
+                    s.received++;
+                }
+            }
+            size_t copy = std::min(payloadLength, sizeof(s.lastScan) - 1);
+            memcpy(s.lastScan, payload, copy);
+            s.lastScan[copy] = '\0';
+        }
+        if (qos == 1) {
+            if (s.holdAcks) b.heldAcks.push_back(id);
+            else b.pendingAcks.push_back({monotonicUs() + s.ackDelayUs, id});
+        }
+        break;
+    }
+    case 0x40:     // PUBACK d'une commande
+        s.commandsAcked++;
+        break;
+    case 0x80: {   // SUBSCRIBE
+        b.subscribed = true;
+        s.subscribes++;
+        uint8_t suback[5] = {0x90, 3, body[0], body[1], 1};
+        brokerSend(b, suback, sizeof(suback));
+        break;
+    }
+    case 0xC0: {   // PINGREQ
+        uint8_t pingresp[2] = {0xD0, 0};
+        brokerSend(b, pingresp, sizeof(pingresp));
+        break;
+    }
+    case 0xE0:     // DISCONNECT
+        close(b.fd);
+        b.fd = -1;
+        break;
+    }
+}
+
+// Paquets complets en tête du tampon de réception
+static void brokerParse(MqttBroker &b) {
+    while (b.fd >= 0 && b.in.size() >= 2) {
+        size_t length = 0, pos = 1;
+        int shift = 0;
+        while (pos < b.in.size() && (b.in[pos] & 0x80)) {
+            length |= (size_t)(b.in[pos++] & 0x7F) << shift;
+            shift += 7;
+        }
+        if (pos >= b.in.size()) return;
+        length |= (size_t)(b.in[pos++] & 0x7F) << shift;
+        if (b.in.size() < pos + length) return;
+        brokerPacket(b, b.in[0], b.in.data() + pos, length);
+        b.in.erase(b.in.begin(), b.in.begin() + pos + length);
+    }
+}
+
+// Broker de substitution : une connexion à la fois, session persistante en mémoire,
+// commandes QoS 1 gardées tant que l'abonné est absent
+static void brokerRun(MqttBroker &b) {
+    MqttBenchShared &s = *b.shared;
+    uint32_t drops = 0;
+    uint32_t commandsQueued = 0;
+    std::vector<uint32_t> pendingCommands;
+    while (!s.stop) {
+        while (commandsQueued < s.commandRequests) pendingCommands.push_back(commandsQueued++);
+        if (drops != s.dropRequests) {
+            // Coupure : les PUBACK non envoyés sont perdus, le lecteur renverra
+            drops = s.dropRequests;
+            if (b.fd >= 0) close(b.fd);
+            b.fd = -1;
+            b.in.clear();
+            b.pendingAcks.clear();
+            b.heldAcks.clear();
+        }
+        if (b.fd >= 0 && b.subscribed && !pendingCommands.empty()) {
+            for (uint32_t index : pendingCommands) brokerPublishCommand(b, index);
+            pendingCommands.clear();
+        }
+        if (!s.holdAcks && !b.heldAcks.empty()) {
+            for (uint16_t id : b.heldAcks) brokerPuback(b, id);
+            b.heldAcks.clear();
+        }
+        uint64_t now = monotonicUs();
+        while (!b.pendingAcks.empty() && b.pendingAcks.front().first <= now) {
+            brokerPuback(b, b.pendingAcks.front().second);
+            b.pendingAcks.pop_front();
+        }
+        struct pollfd pfd = {b.fd >= 0 ? b.fd : b.listenFd, POLLIN, 0};
+        // Attente bornée : échéance du prochain PUBACK ou nouvel ordre du lecteur
+        int timeoutMs = b.pendingAcks.empty() ? 1 : (int)std::min<uint64_t>(1, (b.pendingAcks.front().first - now) / 1000);
+        if (poll(&pfd, 1, timeoutMs) <= 0) continue;
+        if (b.fd < 0) {
+            b.fd = accept(b.listenFd, nullptr, nullptr);
+            int noDelay = 1;
+            if (b.fd >= 0) setsockopt(b.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            b.in.clear();
+            continue;
+        }
+        uint8_t buf[1024];
+        ssize_t n = recv(b.fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            close(b.fd);
+            b.fd = -1;
+            b.pendingAcks.clear();
+            b.heldAcks.clear();
+            continue;
+        }
+        b.in.insert(b.in.end(), buf, buf + n);
+        brokerParse(b);
+    }
+    if (b.fd >= 0) close(b.fd);
+}
+
+// Le lecteur tourne (mqttLoop) jusqu'à la condition ou l'échéance
+template <typename Condition>
+static bool mqttSpin(Condition condition, uint32_t timeoutMs) {
+    uint64_t deadline = monotonicUs() + timeoutMs * 1000ULL;
+    while (!condition()) {
+        if (monotonicUs() > deadline) return false;
+        mqttLoop();
+        // Fin de loop() : le SDK sert les Ticker (buzzer)
+        yield();
+    }
+    return true;
+}
+
+static void mqttBenchCommand(MqttBenchShared &s, const char *suffix, const char *payload) {
+    uint32_t index = s.commandRequests % MQTT_BENCH_COMMANDS;
+    snprintf(s.commandTopic[index], sizeof(s.commandTopic[index]), "%s%s", mqttTopicPrefix(), suffix);
+    snprintf(s.commandPayload[index], sizeof(s.commandPayload[index]), "%s", payload);
+    s.commandSentUs[index] = 0;
+    s.commandRequests++;
+}
+
+// Scan du banc : l'identifiant part dans le champ de séquence (&scan=)
+static bool mqttBenchPublish(uint32_t id, const char *uid, const char *fields) {
+    ScanRecord scan = scanRecord(uid, fields);
+    scan.sequence = id;
+    return mqttPublishScan(scan);
+}
+
+// Commande publiée par le broker -> effet observé par le lecteur
+template <typename Effect>
+static uint32_t mqttCommandLatency(MqttBenchShared &s, const char *suffix, const char *payload, Effect effect) {
+    uint32_t index = s.commandRequests % MQTT_BENCH_COMMANDS;
+    mqttBenchCommand(s, suffix, payload);
+    if (!mqttSpin(effect, 3000)) return UINT32_MAX;
+    uint64_t seen = monotonicUs();
+    return s.commandSentUs[index] ? (uint32_t)(seen - s.commandSentUs[index]) : UINT32_MAX;
+}
+
+int runMqttBench(int argc, char **argv) {
+    int events = argc > 2 ? atoi(argv[2]) : 200;
+    uint32_t rttUs = argc > 3 ? strtoul(argv[3], nullptr, 10) : 20000;
+    if (events < 1) events = 1;
+    if (events > MQTT_BENCH_MAX_EVENTS) events = MQTT_BENCH_MAX_EVENTS;
+    MqttBenchShared *shared = (MqttBenchShared *)mmap(nullptr, sizeof(MqttBenchShared), PROT_READ | PROT_WRITE,
+                                                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) return 1;
+    memset(shared, 0, sizeof(MqttBenchShared));
+    shared->ackDelayUs = rttUs;
+
+    // Port éphémère réservé avant le fork : le lecteur connaît l'adresse d'emblée
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLength = sizeof(addr);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, 4) != 0 ||
+        getsockname(listenFd, (struct sockaddr *)&addr, &addrLength) != 0) {
+        munmap(shared, sizeof(MqttBenchShared));
+        return 1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        MqttBroker broker = {listenFd, -1, shared, false, false, 0, {}, {}, {}};
+        brokerRun(broker);
+        _exit(0);
+    }
+    close(listenFd);
+
+    // Sockets réelles : temps réel de bout en bout
+    nativeSetVirtualTime(false);
+    Serial.setEcho(false);
+    bool autoTune = rfAutoTune;
+    rfAutoTune = false;
+    bool readMemory = readMemoryEnabled;
+    ScanMode savedMode = mode;
+    bool savedContinuous = continuousMode;
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    uint32_t savedLatency = server.latencyUs;
+    uint32_t savedConnect = server.connectUs;
+    bool ok = true;
+    const char *uid = "04a1b2c3d4e5f6";
+    const char *fields = "&employe=B8421&site=12";
+
+    // HTTP : une connexion (1 aller-retour) et une requête (1 aller-retour) par scan
+    server.latencyUs = rttUs;
+    server.connectUs = rttUs;
+    server.clear();
+    std::vector<uint32_t> httpBlocking;
+    uint64_t start = monotonicUs();
+    uint32_t httpOk = 0;
+    for (int i = 0; i < events; i++) {
+        uint64_t t = monotonicUs();
+        httpOk += sendUidToApi(uid, fields) == 200;
+        httpBlocking.push_back(monotonicUs() - t);
+    }
+    uint64_t httpUs = monotonicUs() - start;
+    std::sort(httpBlocking.begin(), httpBlocking.end());
+    printf("{\"transport\":\"http\",\"events\":%d,\"rttUs\":%lu,\"eventsPerSec\":%.0f,\"blockingP50Us\":%lu,"
+           "\"blockingP99Us\":%lu,\"ok\":%s}\n",
+           events, (unsigned long)rttUs, events * 1e6 / httpUs, (unsigned long)percentile(httpBlocking, 50),
+           (unsigned long)percentile(httpBlocking, 99), httpOk == (uint32_t)events ? "true" : "false");
+    ok &= httpOk == (uint32_t)events;
+
+    // MQTT : session ouverte une fois, publications QoS 1 sans attendre le PUBACK
+    mqttEnabled = true;
+    mqttHost = "127.0.0.1";
+    mqttPort = ntohs(addr.sin_port);
+    mqttUser = "lecteur";
+    mqttPass = "secret";
+    mqttTopic = "";
+    mqttRestart();
+    uint64_t connectStart = monotonicUs();
+    bool connected = mqttSpin([] { return mqttConnected(); }, 3000) &&
+                     mqttSpin([&] { return shared->subscribes == 1 && shared->online; }, 1000);
+    uint32_t connectUs = monotonicUs() - connectStart;
+    const MqttStats &stats = mqttStats();
+    std::vector<uint32_t> mqttBlocking, acks, deliveries;
+    std::vector<uint64_t> publishedUs(events);
+    uint32_t fullWaits = 0;
+    // PUBACK reçus dans l'ordre des publications : le k-ième acquitte le scan k
+    uint32_t ackBase = stats.acked;
+    uint32_t ackedSeen = ackBase;
+    auto collectAcks = [&] {
+        uint64_t now = monotonicUs();
+        for (; ackedSeen < stats.acked; ackedSeen++) acks.push_back(now - publishedUs[ackedSeen - ackBase]);
+    };
+    start = monotonicUs();
+    for (int i = 0; i < events && connected; i++) {
+        // File pleine : le pipeline passerait en HTTP ; ici le banc attend une place
+        if (mqttStats().inflight == MQTT_INFLIGHT_MAX) {
+            fullWaits++;
+            mqttSpin([&] {
+                collectAcks();
+                return mqttStats().inflight < MQTT_INFLIGHT_MAX;
+            }, 3000);
+        }
+        uint64_t t = monotonicUs();
+        publishedUs[i] = t;
+        mqttBenchPublish(i, uid, fields);
+        mqttBlocking.push_back(monotonicUs() - t);
+        mqttLoop();
+        collectAcks();
+    }
+    uint32_t expected = connected ? ackBase + events : 0;
+    mqttSpin([&] {
+        collectAcks();
+        return mqttStats().acked == expected;
+    }, 5000);
+    uint64_t mqttUs = monotonicUs() - start;
+    for (int i = 0; i < events; i++) {
+        if (shared->seen[i]) deliveries.push_back(shared->receivedUs[i] - publishedUs[i]);
+    }
+    std::sort(mqttBlocking.begin(), mqttBlocking.end());
+    std::sort(acks.begin(), acks.end());
+    std::sort(deliveries.begin(), deliveries.end());
+    bool mqttOk = connected && shared->received == (uint32_t)events && stats.acked == (uint32_t)events &&
+                  shared->duplicates == 0 && stats.overflows == 0 && shared->willSet;
+    ok &= mqttOk;
+    printf("{\"transport\":\"mqtt\",\"events\":%d,\"rttUs\":%lu,\"connectUs\":%lu,\"eventsPerSec\":%.0f,"
+           "\"blockingP50Us\":%lu,\"blockingP99Us\":%lu,\"deliveryP50Us\":%lu,\"deliveryP99Us\":%lu,"
+           "\"ackP50Us\":%lu,\"ackP99Us\":%lu,\"inflightMax\":%d,\"inflightHighWater\":%u,\"queueFullWaits\":%lu,"
+           "\"received\":%lu,\"duplicates\":%lu,\"ok\":%s}\n",
+           events, (unsigned long)rttUs, (unsigned long)connectUs, events * 1e6 / mqttUs,
+           (unsigned long)percentile(mqttBlocking, 50), (unsigned long)percentile(mqttBlocking, 99),
+           (unsigned long)percentile(deliveries, 50), (unsigned long)percentile(deliveries, 99),
+           (unsigned long)percentile(acks, 50), (unsigned long)percentile(acks, 99), MQTT_INFLIGHT_MAX,
+           stats.inflightHighWater, (unsigned long)fullWaits, (unsigned long)shared->received,
+           (unsigned long)shared->duplicates, mqttOk ? "true" : "false");
+
+    // File bornée : PUBACK retenus, les publications au-delà de la borne sont refusées
+    uint32_t id = events;
+    shared->holdAcks = true;
+    uint32_t accepted = 0, refused = 0;
+    for (int i = 0; i < MQTT_INFLIGHT_MAX + 4; i++) {
+        if (mqttBenchPublish(id++, uid, fields)) accepted++;
+        else refused++;
+        mqttLoop();
+    }
+    uint8_t heldInflight = mqttStats().inflight;
+    shared->holdAcks = false;
+    bool drained = mqttSpin([] { return mqttStats().inflight == 0; }, 3000);
+    bool boundOk = accepted == MQTT_INFLIGHT_MAX && refused == 4 && stats.overflows == 4 &&
+                   heldInflight == MQTT_INFLIGHT_MAX && drained;
+    ok &= boundOk;
+    printf("{\"check\":\"file-bornee\",\"accepted\":%lu,\"refused\":%lu,\"inflightHeld\":%u,\"drained\":%s,"
+           "\"ok\":%s}\n",
+           (unsigned long)accepted, (unsigned long)refused, heldInflight, drained ? "true" : "false",
+           boundOk ? "true" : "false");
+
+    // Coupure avec des publications non acquittées, scans et commande pendant la coupure
+    shared->holdAcks = true;
+    uint32_t receivedBefore = shared->received;
+    uint32_t resentBefore = stats.resent;
+    uint32_t connectsBefore = shared->connects;
+    for (int i = 0; i < 5; i++) mqttBenchPublish(id++, uid, fields);
+    mqttSpin([&] { return shared->received == receivedBefore + 5; }, 2000);
+    uint64_t dropUs = monotonicUs();
+    shared->dropRequests++;
+    shared->holdAcks = false;
+    bool lost = mqttSpin([] { return !mqttConnected(); }, 3000);
+    for (int i = 0; i < 3; i++) mqttBenchPublish(id++, uid, fields);
+    mode = MODE_READ;
+    mqttBenchCommand(*shared, "/cmd/command", "format");
+    bool recovered = mqttSpin([&] { return mqttConnected() && mqttStats().inflight == 0 && mode == MODE_FORMAT; },
+                              5000);
+    uint32_t recoveryUs = monotonicUs() - dropUs;
+    bool reconnectOk = lost && recovered && shared->received == receivedBefore + 8 && shared->duplicates == 5 &&
+                       shared->dupFlags == 5 && stats.resent - resentBefore == 5 &&
+                       shared->connects == connectsBefore + 1 && shared->sessionPresentConnects == 1 &&
+                       shared->subscribes == 1 && stats.sessionPresent;
+    ok &= reconnectOk;
+    printf("{\"check\":\"reconnexion\",\"recoveryUs\":%lu,\"resent\":%lu,\"dupReceived\":%lu,"
+           "\"delivered\":%lu,\"sessionPresent\":%s,\"subscribes\":%lu,\"offlineCommand\":%s,\"ok\":%s}\n",
+           (unsigned long)recoveryUs, (unsigned long)(stats.resent - resentBefore),
+           (unsigned long)shared->duplicates, (unsigned long)(shared->received - receivedBefore),
+           stats.sessionPresent ? "true" : "false", (unsigned long)shared->subscribes,
+           mode == MODE_FORMAT ? "true" : "false", reconnectOk ? "true" : "false");
+
+    // Commandes : broker -> effet sur le lecteur
+    continuousMode = true;
+    uint32_t stopUs = mqttCommandLatency(*shared, "/cmd/command", "stop", [] { return !continuousMode; });
+    uint32_t readUs = mqttCommandLatency(*shared, "/cmd/command", "read", [] { return mode == MODE_READ; });
+    uint32_t buzzerUs = mqttCommandLatency(*shared, "/cmd/buzzer", "times=2&duration=30", [] { return buzzerBusy(); });
+    mqttSpin([&] { return shared->commandsAcked == shared->commandsSent; }, 2000);
+    uint32_t commandsAcked = shared->commandsAcked;
+    bool commandsOk = stopUs != UINT32_MAX && readUs != UINT32_MAX && buzzerUs != UINT32_MAX &&
+                      commandsAcked == 4 && stats.commands == 4;
+    ok &= commandsOk;
+    printf("{\"check\":\"commandes\",\"stopUs\":%lu,\"readUs\":%lu,\"buzzerUs\":%lu,\"acked\":%lu,\"ok\":%s}\n",
+           (unsigned long)stopUs, (unsigned long)readUs, (unsigned long)buzzerUs, (unsigned long)commandsAcked,
+           commandsOk ? "true" : "false");
+    mqttSpin([] { return !buzzerBusy(); }, 1000);
+
+    // Pipeline : un scan capturé part par MQTT, sans requête HTTP ; la
+    // publication ne porte pas de décision, seul le bip de capture retentit
+    server.clear();
+    uint32_t publishedBefore = stats.published;
+    uint32_t ackedBefore = stats.acked;
+    uint32_t neutralBefore = scanPipelineStats().published;
+    uint32_t completedBefore = scanPipelineStats().completed;
+    continuousMode = true;
+    scanDelayMs = 0;
+    PinTrace &buzzer = nativePinTrace(BUZZER_PIN);
+    uint32_t rises = buzzer.risingEdges;
+    SimField &field = SimField::instance();
+    field.place(nativeMakeCard("classic1k"));
+    handleRFIDOperations();
+    field.remove();
+    mqttSpin([&] {
+        scanPipelineLoop();
+        return mqttStats().acked == ackedBefore + 1 && scanPipelineStats().completed == completedBefore + 1 &&
+               !buzzerBusy();
+    }, 3000);
+    char lastScan[sizeof(shared->lastScan)];
+    memcpy(lastScan, shared->lastScan, sizeof(lastScan));
+    uint32_t beeps = buzzer.risingEdges - rises;
+    bool pipelineOk = stats.published == publishedBefore + 1 && stats.acked == ackedBefore + 1 &&
+                      server.received.empty() && scanPipelineStats().published == neutralBefore + 1 &&
+                      beeps == 2 && strncmp(lastScan, "uid=", 4) == 0 && strstr(lastScan, "&scan=") != nullptr;
+    ok &= pipelineOk;
+    printf("{\"check\":\"pipeline\",\"payload\":\"%s\",\"httpRequests\":%lu,\"beeps\":%lu,\"ok\":%s}\n",
+           lastScan, (unsigned long)server.received.size(), (unsigned long)beeps, pipelineOk ? "true" : "false");
+
+    // Fin propre : "offline" publié avant DISCONNECT, sans testament
+    mqttEnabled = false;
+    mqttLoop();
+    bool offline = mqttSpin([&] { return shared->offlineGraceful; }, 1000);
+    ok &= offline;
+    printf("{\"check\":\"deconnexion\",\"offlineGraceful\":%s,\"ok\":%s}\n", offline ? "true" : "false",
+           offline ? "true" : "false");
+
+    // Mot de passe sans utilisateur : refusé par /api/mqtt, jamais envoyé au broker
+    int rejected = webServer.request(HTTP_POST, "/api/mqtt?user=&pass=secret").code;
+    mqttEnabled = true;
+    mqttUser = "";
+    mqttRestart();
+    bool anonymous = mqttSpin([] { return mqttConnected(); }, 3000);
+    mqttEnabled = false;
+    mqttLoop();
+    mqttSpin([] { return !mqttConnected(); }, 1000);
+    bool credentialsOk = rejected == 400 && anonymous && shared->passWithoutUser == 0;
+    ok &= credentialsOk;
+    printf("{\"check\":\"identifiants\",\"apiCode\":%d,\"anonymousConnected\":%s,\"passWithoutUser\":%lu,"
+           "\"ok\":%s}\n",
+           rejected, anonymous ? "true" : "false", (unsigned long)shared->passWithoutUser,
+           credentialsOk ? "true" : "false");
+
+    shared->stop = true;
+    waitpid(pid, nullptr, 0);
+    munmap(shared, sizeof(MqttBenchShared));
+    nativeSetVirtualTime(true);
+    nativeDrainPipeline();
+    mqttHost = "";
+    mqttRestart();
+    server.latencyUs = savedLatency;
+    server.connectUs = savedConnect;
+    mode = savedMode;
+    continuousMode = savedContinuous;
+    readMemoryEnabled = readMemory;
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
+
+// === Remontée CoAP (program coap) ===
+#define COAP_BENCH_MAX_EVENTS 2000
+#define COAP_BENCH_DEDUPE     256
+#define COAP_BENCH_RESEND_US  20000   // renvoi d'une réponse séparée non acquittée
+
+// Partagé entre le lecteur et le serveur de substitution (MAP_SHARED)
+struct CoapBenchShared {
+    volatile bool stop;
+    volatile uint32_t delayUs;        // aller-retour réseau simulé avant la réponse
+    volatile uint32_t lossPercent;    // datagrammes perdus, à l'aller comme au retour
+    volatile bool separate;           // ACK vide tout de suite, décision dans un CON séparé
+    volatile bool doubleAck;          // chaque ACK envoyé deux fois
+    volatile bool deny;               // décision "deny" pour tous les scans
+    volatile uint32_t processed;      // requêtes traitées (identifiants de message distincts)
+    volatile uint32_t duplicates;     // renvois reconnus : réponse rejouée sans traitement
+    volatile uint32_t separateAcked;  // réponses séparées acquittées par le lecteur
+    char lastBody[128];
+};
+
+struct CoapBenchReply {
+    uint64_t dueUs;
+    struct sockaddr_in peer;
+    std::vector<uint8_t> datagram;
+    uint16_t messageId;
+    bool confirmable;                 // réponse séparée : renvoyée jusqu'à son ACK
+    int attempts;
+};
+
+struct CoapBenchSent {
+    struct sockaddr_in peer;
+    uint16_t messageId;
+    uint64_t readyUs;                 // réponse rejouée au plus tôt à cette date
+    std::vector<uint8_t> response;
+};
+
+static bool coapBenchSamePeer(const struct sockaddr_in &a, const struct sockaddr_in &b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+static void coapBenchServer(int fd, CoapBenchShared &s) {
+    std::deque<CoapBenchSent> sent;
+    std::vector<CoapBenchReply> replies;
+    uint32_t seed = 12345;
+    // Pertes reproductibles d'un lancement à l'autre
+    auto lost = [&] {
+        seed = seed * 1103515245 + 12345;
+        return s.lossPercent && (seed >> 16) % 100 < s.lossPercent;
+    };
+    auto schedule = [&](const struct sockaddr_in &peer, const std::vector<uint8_t> &datagram, uint64_t dueUs,
+                        uint16_t messageId, bool confirmable) {
+        replies.push_back({dueUs, peer, datagram, messageId, confirmable, 0});
+    };
+    uint16_t nextMessageId = 0x4000;
+    while (!s.stop) {
+        uint64_t now = monotonicUs();
+        for (size_t i = 0; i < replies.size();) {
+            CoapBenchReply &r = replies[i];
+            if (r.dueUs > now) {
+                i++;
+                continue;
+            }
+            int copies = s.doubleAck && !r.confirmable ? 2 : 1;
+            for (int c = 0; c < copies; c++) {
+                if (!lost()) sendto(fd, r.datagram.data(), r.datagram.size(), 0, (struct sockaddr *)&r.peer, sizeof(r.peer));
+            }
+            if (r.confirmable && ++r.attempts <= COAP_MAX_RETRANSMIT) {
+                r.dueUs = now + COAP_BENCH_RESEND_US;
+                i++;
+                continue;
+            }
+            replies.erase(replies.begin() + i);
+        }
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 1) <= 0) continue;
+        uint8_t buf[COAP_DATAGRAM_MAX];
+        struct sockaddr_in peer = {};
+        socklen_t peerLength = sizeof(peer);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&peer, &peerLength);
+        CoapMessage msg;
+        if (n <= 0 || lost() || !coapParse(buf, n, msg)) continue;
+        now = monotonicUs();
+        if (msg.type == COAP_TYPE_ACK || msg.type == COAP_TYPE_RST) {
+            for (size_t i = 0; i < replies.size(); i++) {
+                if (replies[i].confirmable && replies[i].messageId == msg.messageId &&
+                    coapBenchSamePeer(replies[i].peer, peer)) {
+                    if (msg.type == COAP_TYPE_ACK) s.separateAcked++;
+                    replies.erase(replies.begin() + i);
+                    break;
+                }
+            }
+            continue;
+        }
+        // Renvoi du lecteur : même réponse, une fois le traitement terminé
+        bool duplicate = false;
+        for (const CoapBenchSent &e : sent) {
+            if (e.messageId == msg.messageId && coapBenchSamePeer(e.peer, peer)) {
+                schedule(peer, e.response, std::max(now, e.readyUs), 0, false);
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            s.duplicates++;
+            continue;
+        }
+        s.processed++;
+        size_t bodyLength = std::min(msg.payloadLength, sizeof(s.lastBody) - 1);
+        memcpy(s.lastBody, msg.payload, bodyLength);
+        s.lastBody[bodyLength] = '\0';
+        const char *decision = s.deny ? "deny" : "allow";
+        uint8_t out[COAP_DATAGRAM_MAX];
+        CoapWriter w;
+        uint64_t readyUs = now + s.delayUs;
+        std::vector<uint8_t> response;
+        if (s.separate) {
+            coapBegin(w, out, sizeof(out), COAP_TYPE_ACK, COAP_CODE_EMPTY, msg.messageId, nullptr, 0);
+            response.assign(out, out + coapEnd(w));
+            readyUs = now;
+            coapBegin(w, out, sizeof(out), COAP_TYPE_CON, COAP_CODE_CHANGED, nextMessageId, msg.token,
+                      msg.tokenLength);
+            coapPayload(w, (const uint8_t *)decision, strlen(decision));
+            schedule(peer, std::vector<uint8_t>(out, out + coapEnd(w)), now + s.delayUs, nextMessageId++, true);
+        } else {
+            coapBegin(w, out, sizeof(out), COAP_TYPE_ACK, COAP_CODE_CHANGED, msg.messageId, msg.token,
+                      msg.tokenLength);
+            coapPayload(w, (const uint8_t *)decision, strlen(decision));
+            response.assign(out, out + coapEnd(w));
+        }
+        schedule(peer, response, readyUs, 0, false);
+        sent.push_back({peer, msg.messageId, readyUs, response});
+        if (sent.size() > COAP_BENCH_DEDUPE) sent.pop_front();
+    }
+}
+
+// n échanges bloquants (coapSend) : latence, échanges par seconde, réussites
+struct CoapBenchRun {
+    uint32_t allowed = 0;
+    uint32_t denied = 0;
+    uint32_t failed = 0;
+    double eventsPerSec = 0;
+    std::vector<uint32_t> latencies;
+};
+
+static CoapBenchRun coapBenchExchanges(int events, const char *uid, const char *fields) {
+    CoapBenchRun run;
+    uint64_t start = monotonicUs();
+    for (int i = 0; i < events; i++) {
+        uint64_t t = monotonicUs();
+        int code = sendUidToApi(uid, fields);
+        run.latencies.push_back(monotonicUs() - t);
+        if (code == 200) run.allowed++;
+        else if (code == 403) run.denied++;
+        else run.failed++;
+    }
+    run.eventsPerSec = events * 1e6 / (monotonicUs() - start);
+    std::sort(run.latencies.begin(), run.latencies.end());
+    return run;
+}
+
+// Scan complet du pipeline : capture -> décision de l'ACK -> retour buzzer
+struct CoapPipelineScan {
+    uint32_t decisionUs;
+    uint32_t feedbackUs;
+    uint32_t loops;        // passages de loop() pendant l'attente de l'ACK
+};
+
+static bool coapPipelineScan(bool deny, CoapBenchShared &s, CoapPipelineScan &scan) {
+    const CoapStats &stats = coapStats();
+    uint32_t decidedBefore = stats.allowed + stats.denied;
+    uint32_t allowedBefore = stats.allowed;
+    uint32_t completedBefore = scanPipelineStats().completed;
+    s.deny = deny;
+    SimField &field = SimField::instance();
+    field.place(nativeMakeCard("classic1k"));
+    uint64_t start = monotonicUs();
+    handleRFIDOperations();
+    field.remove();
+    uint64_t deadline = start + 3000000ULL;
+    scan = {};
+    // yield() : fin de loop(), le SDK sert les Ticker (buzzer)
+    while (stats.allowed + stats.denied == decidedBefore && monotonicUs() < deadline) {
+        scanPipelineLoop();
+        yield();
+        scan.loops++;
+    }
+    scan.decisionUs = monotonicUs() - start;
+    // Le bip de prise en compte se termine avant le motif de la décision
+    while (scanPipelineStats().completed == completedBefore && monotonicUs() < deadline) {
+        scanPipelineLoop();
+        yield();
+    }
+    scan.feedbackUs = monotonicUs() - start;
+    bool done = scanPipelineStats().completed == completedBefore + 1 && buzzerBusy();
+    while (!scanPipelineIdle() && monotonicUs() < deadline + 2000000ULL) {
+        scanPipelineLoop();
+        yield();
+    }
+    return done && stats.allowed == allowedBefore + (deny ? 0 : 1) && stats.denied + stats.allowed == decidedBefore + 1;
+}
+
+int runCoapBench(int argc, char **argv) {
+    int events = argc > 2 ? atoi(argv[2]) : 200;
+    uint32_t rttUs = argc > 3 ? strtoul(argv[3], nullptr, 10) : 20000;
+    if (events < 1) events = 1;
+    if (events > COAP_BENCH_MAX_EVENTS) events = COAP_BENCH_MAX_EVENTS;
+    CoapBenchShared *shared = (CoapBenchShared *)mmap(nullptr, sizeof(CoapBenchShared), PROT_READ | PROT_WRITE,
+                                                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) return 1;
+    memset(shared, 0, sizeof(CoapBenchShared));
+    shared->delayUs = rttUs;
+
+    // Port éphémère réservé avant le fork : le lecteur connaît l'adresse d'emblée
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLength = sizeof(addr);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addrLength) != 0) {
+        munmap(shared, sizeof(CoapBenchShared));
+        return 1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        coapBenchServer(fd, *shared);
+        _exit(0);
+    }
+    close(fd);
+
+    // Sockets réelles : temps réel de bout en bout
+    nativeSetVirtualTime(false);
+    Serial.setEcho(false);
+    bool autoTune = rfAutoTune;
+    rfAutoTune = false;
+    bool readMemory = readMemoryEnabled;
+    ScanMode savedMode = mode;
+    bool savedContinuous = continuousMode;
+    String savedUrl = apiUrl;
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    uint32_t savedLatency = server.latencyUs;
+    uint32_t savedConnect = server.connectUs;
+    bool ok = true;
+    const char *uid = "04a1b2c3d4e5f6";
+    const char *fields = "&employe=B8421&site=12";
+
+    // HTTP : une connexion (1 aller-retour) et une requête (1 aller-retour) par scan
+    server.latencyUs = rttUs;
+    server.connectUs = rttUs;
+    server.clear();
+    if (coapUplinkActive()) apiUrl = "http://127.0.0.1/api/scan";
+    CoapBenchRun http = coapBenchExchanges(events, uid, fields);
+    ok &= http.allowed == (uint32_t)events;
+    printf("{\"transport\":\"http\",\"events\":%d,\"rttUs\":%lu,\"eventsPerSec\":%.0f,\"latencyP50Us\":%lu,"
+           "\"latencyP99Us\":%lu,\"ok\":%s}\n",
+           events, (unsigned long)rttUs, http.eventsPerSec, (unsigned long)percentile(http.latencies, 50),
+           (unsigned long)percentile(http.latencies, 99), http.allowed == (uint32_t)events ? "true" : "false");
+
+    // CoAP : un datagramme CON par scan, décision dans l'ACK
+    char url[64];
+    snprintf(url, sizeof(url), "coap://127.0.0.1:%u/api/scan", ntohs(addr.sin_port));
+    apiUrl = url;
+    const CoapStats &stats = coapStats();
+    uint32_t retransmitsBefore = stats.retransmits;
+    CoapBenchRun coap = coapBenchExchanges(events, uid, fields);
+    bool coapOk = coap.allowed == (uint32_t)events && shared->processed == (uint32_t)events &&
+                  stats.retransmits == retransmitsBefore && strcmp(shared->lastBody, "uid=04a1b2c3d4e5f6&employe=B8421&site=12") == 0;
+    ok &= coapOk;
+    printf("{\"transport\":\"coap\",\"events\":%d,\"rttUs\":%lu,\"eventsPerSec\":%.0f,\"latencyP50Us\":%lu,"
+           "\"latencyP99Us\":%lu,\"speedup\":%.1f,\"processed\":%lu,\"body\":\"%s\",\"ok\":%s}\n",
+           events, (unsigned long)rttUs, coap.eventsPerSec, (unsigned long)percentile(coap.latencies, 50),
+           (unsigned long)percentile(coap.latencies, 99), coap.eventsPerSec / http.eventsPerSec,
+           (unsigned long)shared->processed, shared->lastBody, coapOk ? "true" : "false");
+
+    // Pertes : 20 % des datagrammes dans chaque sens, renvois avec le même identifiant
+    int lossEvents = std::min(events, 200);
+    shared->lossPercent = 20;
+    uint32_t processedBefore = shared->processed;
+    uint32_t duplicatesBefore = shared->duplicates;
+    retransmitsBefore = stats.retransmits;
+    uint32_t timeoutsBefore = stats.timeouts;
+    CoapBenchRun lossy = coapBenchExchanges(lossEvents, uid, fields);
+    shared->lossPercent = 0;
+    uint32_t processed = shared->processed - processedBefore;
+    uint32_t retransmits = stats.retransmits - retransmitsBefore;
+    // Chaque requête arrivée au serveur n'est traitée qu'une fois : les renvois sont rejoués
+    bool lossOk = lossy.allowed + lossy.failed == (uint32_t)lossEvents && lossy.allowed * 100 >= lossEvents * 95u &&
+                  processed <= (uint32_t)lossEvents && processed >= lossy.allowed && retransmits > 0 &&
+                  shared->duplicates > duplicatesBefore && stats.timeouts - timeoutsBefore == lossy.failed;
+    ok &= lossOk;
+    printf("{\"check\":\"pertes\",\"lossPercent\":20,\"events\":%d,\"allowed\":%lu,\"failed\":%lu,\"retransmits\":%lu,"
+           "\"processed\":%lu,\"serverDuplicates\":%lu,\"latencyP50Us\":%lu,\"latencyP99Us\":%lu,\"ok\":%s}\n",
+           lossEvents, (unsigned long)lossy.allowed, (unsigned long)lossy.failed, (unsigned long)retransmits,
+           (unsigned long)processed, (unsigned long)(shared->duplicates - duplicatesBefore),
+           (unsigned long)percentile(lossy.latencies, 50), (unsigned long)percentile(lossy.latencies, 99),
+           lossOk ? "true" : "false");
+
+    // ACK en double : ignorés, sans confondre l'échange suivant
+    int dupEvents = 20;
+    shared->doubleAck = true;
+    uint32_t duplicateAcksBefore = stats.duplicates;
+    CoapBenchRun doubled = coapBenchExchanges(dupEvents, uid, fields);
+    shared->doubleAck = false;
+    uint32_t duplicateAcks = stats.duplicates - duplicateAcksBefore;
+    bool dupOk = doubled.allowed == (uint32_t)dupEvents && duplicateAcks >= (uint32_t)dupEvents - 1;
+    ok &= dupOk;
+    printf("{\"check\":\"ack-doubles\",\"events\":%d,\"allowed\":%lu,\"ignored\":%lu,\"ok\":%s}\n", dupEvents,
+           (unsigned long)doubled.allowed, (unsigned long)duplicateAcks, dupOk ? "true" : "false");
+
+    // Réponse séparée : ACK vide, puis décision dans un CON acquitté par le lecteur
+    shared->separate = true;
+    shared->deny = true;
+    uint32_t separateBefore = stats.separate;
+    uint32_t ackedBefore = shared->separateAcked;
+    CoapBenchRun separate = coapBenchExchanges(dupEvents, uid, fields);
+    shared->separate = false;
+    shared->deny = false;
+    bool separateOk = separate.denied == (uint32_t)dupEvents && stats.separate - separateBefore == (uint32_t)dupEvents &&
+                      shared->separateAcked - ackedBefore == (uint32_t)dupEvents;
+    ok &= separateOk;
+    printf("{\"check\":\"reponse-separee\",\"events\":%d,\"denied\":%lu,\"acked\":%lu,\"latencyP50Us\":%lu,\"ok\":%s}\n",
+           dupEvents, (unsigned long)separate.denied, (unsigned long)(shared->separateAcked - ackedBefore),
+           (unsigned long)percentile(separate.latencies, 50), separateOk ? "true" : "false");
+
+    // Pipeline : la décision de l'ACK choisit le retour buzzer, loop() tourne pendant l'attente
+    continuousMode = true;
+    scanDelayMs = 0;
+    server.clear();
+    CoapPipelineScan allow, refused;
+    bool allowOk = coapPipelineScan(false, *shared, allow);
+    bool denyOk = coapPipelineScan(true, *shared, refused);
+    shared->deny = false;
+    bool pipelineOk = allowOk && denyOk && server.received.empty() && allow.loops > 1 && refused.loops > 1;
+    ok &= pipelineOk;
+    printf("{\"check\":\"pipeline\",\"allowDecisionUs\":%lu,\"denyDecisionUs\":%lu,\"loopsWhileWaiting\":%lu,"
+           "\"allowFeedbackUs\":%lu,\"denyFeedbackUs\":%lu,\"httpRequests\":%lu,\"ok\":%s}\n",
+           (unsigned long)allow.decisionUs, (unsigned long)refused.decisionUs, (unsigned long)allow.loops,
+           (unsigned long)allow.feedbackUs, (unsigned long)refused.feedbackUs, (unsigned long)server.received.size(),
+           pipelineOk ? "true" : "false");
+
+    shared->stop = true;
+    waitpid(pid, nullptr, 0);
+    munmap(shared, sizeof(CoapBenchShared));
+    nativeSetVirtualTime(true);
+    apiUrl = savedUrl;
+    nativeDrainPipeline();
+    server.latencyUs = savedLatency;
+    server.connectUs = savedConnect;
+    mode = savedMode;
+    continuousMode = savedContinuous;
+    readMemoryEnabled = readMemory;
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
+
+// === Encodage CBOR des envois (program cbor) ===
+#define CBOR_BENCH_BUF 4096
+
+// Corps JSON équivalent, écrit en place lui aussi (référence de taille et de temps)
+struct JsonBenchWriter {
+    char *buf;
+    size_t size;
+    size_t length;
+    void put(char c) {
+        if (length < size) buf[length++] = c;
+    }
+    void text(const char *s, size_t n) {
+        for (size_t i = 0; i < n; i++) put(s[i]);
+    }
+    void text(const char *s) { text(s, strlen(s)); }
+    void uint(uint32_t v) {
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        while (n) put(digits[--n]);
+    }
+};
+
+static uint8_t benchHexValue(char c) {
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+static size_t jsonBenchEncode(const ScanRecord &scan, char *buf, size_t size) {
+    JsonBenchWriter w = {buf, size, 0};
+    w.text("{\"uid\":\"");
+    w.text(scan.uid);
+    w.put('"');
+    if (scan.sequence) {
+        w.text(",\"scan\":");
+        w.uint(scan.sequence);
+    }
+    if (scan.hasCard) {
+        w.text(",\"sak\":");
+        w.uint(scan.sak);
+        w.text(",\"type\":");
+        w.uint(scan.piccType);
+        w.text(",\"ts\":");
+        w.uint(scan.timestamp);
+    }
+    if (scan.fields && scan.fields[0] == '&') {
+        w.text(",\"fields\":{");
+        for (const char *p = scan.fields; *p == '&';) {
+            const char *name = p + 1;
+            const char *eq = strchr(name, '=');
+            const char *end = strchr(name, '&');
+            if (!end) end = name + strlen(name);
+            if (p != scan.fields) w.put(',');
+            w.put('"');
+            w.text(name, eq - name);
+            w.text("\":\"");
+            for (const char *v = eq + 1; v < end; v++) {
+                char c = *v;
+                if (c == '%' && v + 2 < end) {
+                    c = (benchHexValue(v[1]) << 4) | benchHexValue(v[2]);
+                    v += 2;
+                }
+                if (c == '"' || c == '\\') w.put('\\');
+                w.put(c);
+            }
+            w.put('"');
+            p = end;
+        }
+        w.put('}');
+    }
+    if (scan.blocks) {
+        w.text(",\"data\":\"");
+        size_t length = (size_t)scan.blockCount * scan.blockSize;
+        for (size_t i = 0; i < length; i++) {
+            w.put(HEX_LOWER[scan.blocks[i] >> 4]);
+            w.put(HEX_LOWER[scan.blocks[i] & 0x0F]);
+        }
+        w.text("\",\"blockSize\":");
+        w.uint(scan.blockSize);
+    }
+    w.put('}');
+    return w.length < size ? w.length : 0;
+}
+
+static void cborBenchRow(const char *record, const char *encoding, const ScanRecord &scan, int iterations,
+                         size_t formBytes, size_t &bytes) {
+    static uint8_t buf[CBOR_BENCH_BUF];
+    bool json = strcmp(encoding, "json") == 0;
+    ApiEncoding apiEnc = strcmp(encoding, "cbor") == 0 ? API_ENCODING_CBOR : API_ENCODING_FORM;
+    NativeHeapStats before = nativeHeapStats();
+    volatile size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink = json ? jsonBenchEncode(scan, (char *)buf, sizeof(buf)) : scanPayloadEncode(scan, apiEnc, buf, sizeof(buf));
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    NativeHeapStats after = nativeHeapStats();
+    bytes = sink;
+    printf("{\"record\":\"%s\",\"encoding\":\"%s\",\"bytes\":%u,\"vsForm\":%.2f,\"iterations\":%d,"
+           "\"nsPerEncode\":%.1f,\"allocsPerEncode\":%.1f}\n",
+           record, encoding, (unsigned)bytes, formBytes ? (double)bytes / formBytes : 1.0, iterations,
+           ns / iterations, (double)(after.allocations - before.allocations) / iterations);
+}
+
+int runCborBench(int argc, char **argv) {
+    int iterations = argc > 2 ? atoi(argv[2]) : 20000;
+    if (iterations < 10) iterations = 10;
+    bool ok = true;
+
+    // Scan courant (UID 7 octets, champs du profil) puis image complète d'une 1K
+    ScanRecord scan = scanRecord("04a1b2c3d4e5f6", "&employe=B8421&site=12&nom=Jean%20Dupont");
+    scan.hasCard = true;
+    scan.sak = 0x08;
+    scan.piccType = MFRC522::PICC_TYPE_MIFARE_1K;
+    scan.timestamp = 86400;
+    scan.sequence = 1234;
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k");
+    SimClassicCard *classic = static_cast<SimClassicCard *>(card.get());
+    std::vector<uint8_t> image(classic->blockCount() * 16);
+    for (uint16_t b = 0; b < classic->blockCount(); b++) memcpy(&image[b * 16], classic->block(b), 16);
+    // Blocs de données remplis : l'image n'est pas faite que de zéros
+    for (uint16_t b = 1; b < classic->blockCount(); b++) {
+        if ((b + 1) % 4 == 0) continue;
+        for (int i = 0; i < 16; i++) image[b * 16 + i] = (uint8_t)(b * 31 + i * 7);
+    }
+    ScanRecord full = scan;
+    full.blocks = image.data();
+    full.blockCount = classic->blockCount();
+    full.blockSize = 16;
+
+    struct {
+        const char *name;
+        const ScanRecord *record;
+        int iterations;
+    } records[] = {{"scan", &scan, iterations}, {"image1k", &full, std::max(iterations / 10, 10)}};
+    for (auto &r : records) {
+        size_t formBytes = 0, jsonBytes = 0, cborBytes = 0;
+        cborBenchRow(r.name, "form", *r.record, r.iterations, 0, formBytes);
+        cborBenchRow(r.name, "json", *r.record, r.iterations, formBytes, jsonBytes);
+        cborBenchRow(r.name, "cbor", *r.record, r.iterations, formBytes, cborBytes);
+        ok &= cborBytes && cborBytes < formBytes && cborBytes < jsonBytes;
+    }
+    return ok ? 0 : 1;
+}
+
+// === Boîte d'envoi persistante ===
+// Serveur de bouclage qui dédoublonne sur Idempotency-Key, comme l'API
+struct OutboxBenchServer {
+    std::set<std::string> keys;
+    uint32_t requests = 0;
+    uint32_t duplicates = 0;        // clés déjà traitées (renvois après redémarrage)
+    uint32_t maxSequence = 0;
+    bool failOdd = false;           // 503 pour les séquences impaires
+    bool keysMatchBody = true;      // en-tête identique aux champs device et scan du corps
+};
+
+static void outboxBenchScans(int count, bool loop) {
+    SimField &field = SimField::instance();
+    std::shared_ptr<SimCard> card = nativeMakeCard("classic1k");
+    for (int i = 0; i < count; i++) {
+        field.place(card);
+        handleRFIDOperations();
+        field.remove();
+        nativeDrainPipeline();
+        if (loop) outboxLoop();
+    }
+}
+
+// Passages dans outboxLoop() jusqu'à la condition ou l'échéance (temps virtuel)
+template <typename Done> static bool outboxBenchSpin(Done done, uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (!done() && millis() - start < timeoutMs) {
+        outboxLoop();
+        delay(50);
+    }
+    return done();
+}
+
+int runOutboxBench(int argc, char **argv) {
+    int events = argc > 2 ? atoi(argv[2]) : 200;
+    if (events < 8) events = 8;
+    events &= ~3;
+    bool ok = true;
+    SimFlash &flash = SimFlash::instance();
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    bool autoTune = rfAutoTune;
+    bool readMemory = readMemoryEnabled;
+    ScanMode savedMode = mode;
+    unsigned long savedDelay = scanDelayMs;
+    String savedUrl = apiUrl;
+    uint8_t savedEncoding = apiEncoding;
+    uint32_t savedLatency = server.latencyUs;
+    rfAutoTune = false;
+    readMemoryEnabled = false;
+    mode = MODE_READ;
+    scanDelayMs = 0;
+    apiUrl = "http://127.0.0.1/api/scan";
+    apiEncoding = API_ENCODING_FORM;
+    server.latencyUs = 20000;
+    server.clear();
+    OutboxBenchServer bench;
+    server.handler = [&bench](const LoopbackRequest &req) {
+        LoopbackResponse r;
+        bench.requests++;
+        const char *key = req.idempotencyKey.c_str();
+        const char *dash = strrchr(key, '-');
+        uint32_t sequence = dash ? strtoul(dash + 1, nullptr, 10) : 0;
+        char expected[64];
+        snprintf(expected, sizeof(expected), "&device=%s&scan=%lu", deviceId(), (unsigned long)sequence);
+        std::string body(req.body.begin(), req.body.end());
+        if (!sequence || (size_t)(dash - key) != strlen(deviceId()) || strncmp(key, deviceId(), dash - key) != 0 ||
+            body.find(expected) == std::string::npos) {
+            bench.keysMatchBody = false;
+        }
+        if (bench.failOdd && sequence % 2) {
+            r.code = 503;
+            r.body = "busy";
+            return r;
+        }
+        if (!bench.keys.insert(key).second) bench.duplicates++;
+        if (sequence > bench.maxSequence) bench.maxSequence = sequence;
+        return r;
+    };
+
+    // En ligne : un ajout par scan, acquitté aussitôt ; état réécrit rarement
+    uint32_t firstSequence = outboxStats().nextSequence;
+    uint32_t pages = flash.pagePrograms, erases = flash.erases;
+    uint32_t stateWrites = outboxStats().stateWrites;
+    outboxBenchScans(events, true);
+    const OutboxStats &stats = outboxStats();
+    bool onlineOk = stats.pending == 0 && bench.keys.size() == (size_t)events && bench.duplicates == 0 &&
+                    bench.keysMatchBody && stats.nextSequence == firstSequence + events &&
+                    stats.watermark == firstSequence + events - 1;
+    ok &= onlineOk;
+    printf("{\"phase\":\"en-ligne\",\"events\":%d,\"pagesPerEvent\":%.2f,\"erasesPerEvent\":%.3f,"
+           "\"stateWritesPerEvent\":%.3f,\"fileRecords\":%u,\"keysMatchBody\":%s,\"ok\":%s}\n",
+           events, (double)(flash.pagePrograms - pages) / events, (double)(flash.erases - erases) / events,
+           (double)(stats.stateWrites - stateWrites) / events, stats.fileRecords, bench.keysMatchBody ? "true" : "false",
+           onlineOk ? "true" : "false");
+    fflush(stdout);
+
+    // Coupure (tout échoue) puis 503 un scan sur deux : seuls les non acquittés
+    // repartent. Les deux rafales tiennent dans la boîte (acquittés hors ordre compris)
+    int burst = std::min(events / 2, OUTBOX_CAPACITY / 2);
+    server.reachable = false;
+    outboxBenchScans(burst, false);
+    server.reachable = true;
+    bench.failOdd = true;
+    outboxBenchScans(burst, false);
+    bench.failOdd = false;
+    uint32_t pending = stats.pending;
+    uint32_t requests = bench.requests;
+    uint32_t replayed = stats.replayed;
+    unsigned long start = millis();
+    bool drained = outboxBenchSpin([&] { return stats.pending == 0; }, 600000);
+    uint32_t replayMs = millis() - start;
+    uint32_t replayRequests = bench.requests - requests;
+    bool outageOk = drained && pending == (uint32_t)(burst + burst / 2) && replayRequests == pending &&
+                    stats.replayed - replayed == pending && bench.keys.size() == (size_t)(events + 2 * burst) &&
+                    bench.duplicates == 0 && stats.dropped == 0 && stats.watermark == stats.nextSequence - 1;
+    ok &= outageOk;
+    printf("{\"phase\":\"coupure\",\"events\":%d,\"pending\":%lu,\"replayRequests\":%lu,\"replayMs\":%lu,"
+           "\"serverDuplicates\":%lu,\"compactions\":%lu,\"ok\":%s}\n",
+           2 * burst, (unsigned long)pending, (unsigned long)replayRequests, (unsigned long)replayMs,
+           (unsigned long)bench.duplicates, (unsigned long)stats.compactions, outageOk ? "true" : "false");
+    fflush(stdout);
+
+    // Redémarrage : une partie renvoyée (filigrane pas encore écrit), un ajout
+    // interrompu en fin de fichier, puis tout est rejoué
+    int outage = events / 4;
+    server.reachable = false;
+    outboxBenchScans(outage, false);
+    server.reachable = true;
+    uint32_t lastSequence = stats.nextSequence - 1;
+    outboxBenchSpin([&] { return stats.pending <= (uint32_t)outage / 2; }, 600000);
+    uint32_t pendingBeforeReboot = stats.pending;
+    File torn = LittleFS.open(OUTBOX_EVENTS_PATH, "a");
+    static const uint8_t partial[10] = {0x42, 0x4F, 0x01};
+    torn.write(partial, sizeof(partial));
+    torn.close();
+    outboxBegin();
+    uint32_t recovered = stats.recovered;
+    uint32_t duplicates = bench.duplicates;
+    bool rebootDrained = outboxBenchSpin([&] { return stats.pending == 0; }, 600000);
+    uint32_t resent = bench.duplicates - duplicates;
+    outboxBenchScans(1, true);
+    uint32_t expected = events + 2 * burst + outage + 1;
+    bool rebootOk = rebootDrained && recovered >= pendingBeforeReboot && stats.nextSequence > lastSequence + 1 &&
+                    bench.maxSequence > lastSequence && bench.keys.size() == expected && stats.pending == 0 &&
+                    resent == recovered - pendingBeforeReboot;
+    ok &= rebootOk;
+    printf("{\"phase\":\"redemarrage\",\"pendingBefore\":%lu,\"recovered\":%lu,\"resentAcked\":%lu,"
+           "\"sequenceBefore\":%lu,\"sequenceAfter\":%lu,\"processed\":%u,\"expected\":%lu,\"ok\":%s}\n",
+           (unsigned long)pendingBeforeReboot, (unsigned long)recovered, (unsigned long)resent,
+           (unsigned long)lastSequence, (unsigned long)bench.maxSequence, (unsigned)bench.keys.size(),
+           (unsigned long)expected, rebootOk ? "true" : "false");
+    fflush(stdout);
+
+    // Boîte pleine : les plus anciens sont abandonnés et comptés, le reste part
+    uint32_t dropped = stats.dropped;
+    server.reachable = false;
+    outboxBenchScans(OUTBOX_CAPACITY + 8, false);
+    server.reachable = true;
+    uint32_t full = stats.pending;
+    size_t keys = bench.keys.size();
+    bool fullDrained = outboxBenchSpin([&] { return stats.pending == 0; }, 600000);
+    bool fullOk = fullDrained && full == OUTBOX_CAPACITY && stats.dropped - dropped == 8 &&
+                  bench.keys.size() - keys == OUTBOX_CAPACITY && stats.notDurable == 0;
+    ok &= fullOk;
+    printf("{\"phase\":\"saturation\",\"events\":%d,\"pending\":%lu,\"dropped\":%lu,\"ok\":%s}\n",
+           OUTBOX_CAPACITY + 8, (unsigned long)full, (unsigned long)(stats.dropped - dropped), fullOk ? "true" : "false");
+    fflush(stdout);
+
+    server.handler = nullptr;
+    server.latencyUs = savedLatency;
+    apiEncoding = savedEncoding;
+    apiUrl = savedUrl;
+    scanDelayMs = savedDelay;
+    mode = savedMode;
+    readMemoryEnabled = readMemory;
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
+
+// === Cache des décisions de l'API ===
+#define CACHE_BENCH_CARDS 8
+
+struct CacheBenchServer {
+    std::set<std::string> deny;
+    uint32_t ttlS = 60;             // 0 : réponse sans ttl
+    uint32_t requests = 0;
+};
+
+static std::shared_ptr<SimCard> cacheBenchCard(int index, char *uidHex) {
+    const byte uid[4] = {0xCA, 0xC4, 0x00, (byte)index};
+    hexEncode(uid, sizeof(uid), uidHex);
+    return std::make_shared<SimClassicCard>(SimClassicCard::CLASSIC_1K, uid, 4);
+}
+
+// Capture -> début du retour buzzer, puis envoi mené à terme
+static uint32_t cacheBenchScan(std::shared_ptr<SimCard> card) {
+    uint32_t completedBefore = scanPipelineStats().completed;
+    SimField &field = SimField::instance();
+    field.place(card);
+    unsigned long start = micros();
+    handleRFIDOperations();
+    field.remove();
+    while (scanPipelineStats().completed == completedBefore && micros() - start < 5000000) {
+        scanPipelineLoop();
+        delay(1);
+    }
+    uint32_t feedbackUs = micros() - start;
+    nativeDrainPipeline();
+    return feedbackUs;
+}
+
+int runCacheBench(int argc, char **argv) {
+    int scans = argc > 2 ? atoi(argv[2]) : 40;
+    if (scans < CACHE_BENCH_CARDS) scans = CACHE_BENCH_CARDS;
+    bool ok = true;
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    nativeSetVirtualTime(true);
+    Serial.setEcho(false);
+    bool autoTune = rfAutoTune;
+    bool readMemory = readMemoryEnabled;
+    ScanMode savedMode = mode;
+    unsigned long savedDelay = scanDelayMs;
+    String savedUrl = apiUrl;
+    uint8_t savedEncoding = apiEncoding;
+    uint32_t savedLatency = server.latencyUs;
+    rfAutoTune = false;
+    readMemoryEnabled = false;
+    mode = MODE_READ;
+    scanDelayMs = 0;
+    apiUrl = "http://127.0.0.1/api/scan";
+    apiEncoding = API_ENCODING_FORM;
+    server.latencyUs = argc > 3 ? atol(argv[3]) : 500000;
+    server.clear();
+    CacheBenchServer bench;
+    server.handler = [&bench](const LoopbackRequest &req) {
+        LoopbackResponse r;
+        bench.requests++;
+        std::string body(req.body.begin(), req.body.end());
+        std::string uid = body.compare(0, 4, "uid=") == 0 ? body.substr(4, body.find('&', 4) - 4) : "";
+        r.body = bench.deny.count(uid) ? "decision=deny" : "decision=allow";
+        if (bench.ttlS) r.body += "&ttl=" + String(bench.ttlS);
+        return r;
+    };
+
+    std::vector<std::shared_ptr<SimCard>> cards;
+    char uids[CACHE_BENCH_CARDS][UID_HEX_MAX];
+    for (int i = 0; i < CACHE_BENCH_CARDS; i++) cards.push_back(cacheBenchCard(i, uids[i]));
+    bench.deny.insert(uids[1]);
+    decisionCacheClear();
+    const DecisionCacheStats &cache = decisionCacheStats();
+
+    // Premier passage : décision attendue de l'API, puis mise en cache
+    std::vector<uint32_t> cold, warm;
+    for (int i = 0; i < CACHE_BENCH_CARDS; i++) cold.push_back(cacheBenchScan(cards[i]));
+    bool coldOk = cache.entries == CACHE_BENCH_CARDS && cache.hits == 0 && bench.requests == CACHE_BENCH_CARDS;
+    ok &= coldOk;
+
+    // Badges présentés à nouveau : retour depuis le cache, envoi toujours fait
+    uint32_t hits = cache.hits, requests = bench.requests;
+    uint32_t cachedFeedback = scanPipelineStats().cachedFeedback;
+    warm.reserve(scans);
+    NativeHeapStats heapBefore = nativeHeapStats();
+    for (int i = 0; i < scans; i++) warm.push_back(cacheBenchScan(cards[i % CACHE_BENCH_CARDS]));
+    NativeHeapStats heapAfter = nativeHeapStats();
+    uint32_t network = heapAfter.networkAllocations - heapBefore.networkAllocations;
+    uint32_t own = heapAfter.allocations - heapBefore.allocations - network;
+    bool warmOk = cache.hits - hits == (uint32_t)scans && bench.requests - requests == (uint32_t)scans &&
+                  scanPipelineStats().cachedFeedback - cachedFeedback == (uint32_t)scans && own == 0 &&
+                  cache.stale == 0;
+    ok &= warmOk;
+    std::sort(cold.begin(), cold.end());
+    std::sort(warm.begin(), warm.end());
+    printf("{\"phase\":\"retour\",\"apiLatencyUs\":%u,\"coldP50Us\":%u,\"cachedP50Us\":%u,\"cachedP99Us\":%u,"
+           "\"hitRatio\":%.2f,\"uploads\":%lu,\"allocsPerScan\":%.2f,\"lookupUs\":%lu,\"ok\":%s}\n",
+           server.latencyUs, percentile(cold, 50), percentile(warm, 50), percentile(warm, 99),
+           (double)cache.hits / cache.lookups, (unsigned long)(bench.requests - requests), (double)own / scans,
+           (unsigned long)cache.lastLookupUs, coldOk && warmOk ? "true" : "false");
+    fflush(stdout);
+
+    // Révocation côté serveur : un retour périmé au plus, corrigé par la réponse
+    byte uid0[4] = {0xCA, 0xC4, 0x00, 0x00};
+    uint32_t stale = cache.stale;
+    bench.deny.insert(uids[0]);
+    cacheBenchScan(cards[0]);
+    bool revokedOk = cache.stale == stale + 1 && decisionCacheLookup(uid0, 4) == ACL_DENY;
+    // Invalidation explicite par l'API web, d'un UID puis de tout le cache
+    char uri[64];
+    snprintf(uri, sizeof(uri), "/api/cache/invalidate?uid=%s", uids[0]);
+    NativeHttpResponse one = webServer.request(HTTP_POST, uri);
+    NativeHttpResponse again = webServer.request(HTTP_POST, uri);
+    bool invalidatedOk = one.code == 200 && again.code == 404 && decisionCacheLookup(uid0, 4) == ACL_UNKNOWN &&
+                         cache.entries == CACHE_BENCH_CARDS - 1;
+    NativeHttpResponse all = webServer.request(HTTP_POST, "/api/cache/invalidate");
+    invalidatedOk &= all.code == 200 && cache.entries == 0;
+    ok &= revokedOk && invalidatedOk;
+    printf("{\"phase\":\"invalidation\",\"stale\":%lu,\"revoked\":%s,\"uidCode\":%d,\"missingCode\":%d,"
+           "\"allCode\":%d,\"entries\":%u,\"ok\":%s}\n",
+           (unsigned long)(cache.stale - stale), revokedOk ? "true" : "false", one.code, again.code, all.code,
+           cache.entries, revokedOk && invalidatedOk ? "true" : "false");
+    fflush(stdout);
+
+    // ttl écoulé, puis réponse sans ttl : la décision n'est plus réutilisée
+    bench.ttlS = 2;
+    cacheBenchScan(cards[2]);
+    uint32_t expired = cache.expired;
+    delay(2500);
+    bool expiredOk = decisionCacheLookup(cards[2]->uid, 4) == ACL_UNKNOWN && cache.expired == expired + 1;
+    bench.ttlS = 60;
+    cacheBenchScan(cards[3]);
+    bench.ttlS = 0;
+    uint32_t invalidations = cache.invalidations;
+    cacheBenchScan(cards[3]);
+    bool noTtlOk = cache.invalidations == invalidations + 1 && decisionCacheLookup(cards[3]->uid, 4) == ACL_UNKNOWN;
+    // Retours depuis le cache : passage chaud, badge révoqué, dernier scan avec ttl
+    noTtlOk &= scanPipelineStats().cachedFeedback == cachedFeedback + scans + 2;
+    ok &= expiredOk && noTtlOk;
+    printf("{\"phase\":\"expiration\",\"expired\":%s,\"noTtlRemoved\":%s,\"ok\":%s}\n", expiredOk ? "true" : "false",
+           noTtlOk ? "true" : "false", expiredOk && noTtlOk ? "true" : "false");
+    fflush(stdout);
+
+    decisionCacheClear();
+    server.handler = nullptr;
+    server.latencyUs = savedLatency;
+    apiEncoding = savedEncoding;
+    apiUrl = savedUrl;
+    scanDelayMs = savedDelay;
+    mode = savedMode;
+    readMemoryEnabled = readMemory;
+    rfAutoTune = autoTune;
+    return ok ? 0 : 1;
+}
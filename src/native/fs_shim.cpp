@@ -0,0 +1,356 @@
+/*
+ * LittleFS et EEPROM hôtes.
+ */
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <LittleFS.h>
+#include "native_sim.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+// === Modèle temporel de la flash ===
+SimFlash &SimFlash::instance() {
+    static SimFlash flash;
+    return flash;
+}
+
+void SimFlash::read(size_t bytes) {
+    static uint64_t pendingNs = 0;
+    bytesRead += bytes;
+    if (!enabled) return;
+    pendingNs += (uint64_t)bytes * readUsPerKB * 1000 / 1024;
+    if (pendingNs >= 1000) {
+        nativeWait(pendingNs / 1000);
+        pendingNs %= 1000;
+    }
+}
+
+void SimFlash::program(size_t bytes, bool allocates) {
+    static size_t sinceErase = 0;
+    if (!bytes) return;
+    uint32_t pages = (bytes + 255) / 256;
+    pagePrograms += pages;
+    if (enabled) nativeWait((uint64_t)pages * pageProgramUs);
+    // LittleFS : un bloc neuf est effacé chaque fois que 4 Ko ont été consommés
+    if (!allocates) return;
+    sinceErase += pages * 256;
+    while (sinceErase >= 4096) {
+        sinceErase -= 4096;
+        erase();
+    }
+}
+
+void SimFlash::erase() {
+    erases++;
+    if (enabled) nativeWait(sectorEraseUs);
+}
+
+void SimFlash::metadataCommit() {
+    if (enabled) nativeWait(fsMetadataCommitUs);
+}
+
+void SimFlash::open() {
+    if (enabled) nativeWait(fsOpenUs);
+}
+
+// === LittleFS ===
+fs::FS LittleFS;
+
+namespace fs {
+
+String FS::hostPath(const char *path) {
+    const char *root = getenv("NATIVE_FS_ROOT");
+    String p(root ? root : "./.native_fs");
+    if (!path || path[0] != '/') p += "/";
+    p += path ? path : "";
+    return p;
+}
+
+static void mkdirs(const String &hostDir) {
+    String partial;
+    for (unsigned int i = 0; i < hostDir.length(); i++) {
+        char c = hostDir[i];
+        if (c == '/' && partial.length()) ::mkdir(partial.c_str(), 0755);
+        partial += c;
+    }
+    if (partial.length()) ::mkdir(partial.c_str(), 0755);
+}
+
+bool FS::begin() {
+    mkdirs(hostPath("/"));
+    return true;
+}
+
+bool FS::format() {
+    String cmd = "rm -rf '" + hostPath("/") + "'";
+    if (system(cmd.c_str()) != 0) return false;
+    return begin();
+}
+
+bool FS::info(FSInfo &info) {
+    info.totalBytes = 2 * 1024 * 1024;
+    info.usedBytes = 0;
+    info.blockSize = 8192;
+    info.pageSize = 256;
+    info.maxOpenFiles = 5;
+    info.maxPathLength = 32;
+    return true;
+}
+
+File FS::open(const char *path, const char *mode) {
+    String host = hostPath(path);
+    // Comme LittleFS sur ESP8266 : les répertoires parents sont créés à l'écriture
+    if (mode[0] == 'w' || mode[0] == 'a') {
+        int slash = host.lastIndexOf('/');
+        if (slash > 0) mkdirs(host.substring(0, slash));
+    }
+    struct stat st;
+    if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) return File(nullptr, String(path), true);
+    String m(mode);
+    if (m.indexOf('b') < 0) m += "b";
+    FILE *fp = fopen(host.c_str(), m.c_str());
+    SimFlash::instance().open();
+    if (!fp) return File();
+    return File(fp, String(path));
+}
+
+bool FS::exists(const char *path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+Dir FS::openDir(const char *path) {
+    return Dir(String(path));
+}
+
+bool FS::rename(const char *from, const char *to) {
+    SimFlash::instance().metadataCommit();
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::remove(const char *path) {
+    SimFlash::instance().metadataCommit();
+    return ::unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+    mkdirs(hostPath(path));
+    return true;
+}
+
+bool FS::rmdir(const char *path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+// === File ===
+// Programmation des pages en attente + commit de métadonnées
+static void commitPending(size_t &pending) {
+    if (!pending) return;
+    SimFlash::instance().program(pending);
+    SimFlash::instance().metadataCommit();
+    pending = 0;
+}
+
+File::File(FILE *fp, const String &path, bool isDir) : _path(path), _isDir(isDir) {
+    if (!fp) return;
+    _pending = std::make_shared<size_t>(0);
+    std::shared_ptr<size_t> pending = _pending;
+    _fp = std::shared_ptr<FILE>(fp, [pending](FILE *f) {
+        commitPending(*pending);
+        fclose(f);
+    });
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size) {
+    if (!_fp) return 0;
+    size_t n = fwrite(buf, 1, size, _fp.get());
+    LittleFS.bytesWritten += n;
+    *_pending += n;
+    return n;
+}
+
+int File::available() {
+    if (!_fp) return 0;
+    long pos = ftell(_fp.get());
+    long sz = (long)size();
+    return pos < sz ? (int)(sz - pos) : 0;
+}
+
+int File::read() {
+    if (!_fp) return -1;
+    SimFlash::instance().read(1);
+    return fgetc(_fp.get());
+}
+
+int File::peek() {
+    if (!_fp) return -1;
+    int c = fgetc(_fp.get());
+    if (c != EOF) ungetc(c, _fp.get());
+    return c;
+}
+
+void File::flush() {
+    if (!_fp) return;
+    fflush(_fp.get());
+    commitPending(*_pending);
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+    if (!_fp) return 0;
+    size_t n = fread(buf, 1, size, _fp.get());
+    SimFlash::instance().read(n);
+    return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_fp) return false;
+    int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+    return fseek(_fp.get(), pos, whence) == 0;
+}
+
+size_t File::position() const {
+    return _fp ? (size_t)ftell(_fp.get()) : 0;
+}
+
+size_t File::size() const {
+    if (!_fp) return 0;
+    fflush(_fp.get());
+    struct stat st;
+    if (fstat(fileno(_fp.get()), &st) != 0) return 0;
+    return st.st_size;
+}
+
+void File::close() {
+    _fp.reset();
+}
+
+bool File::truncate(uint32_t size) {
+    if (!_fp) return false;
+    fflush(_fp.get());
+    return ftruncate(fileno(_fp.get()), size) == 0;
+}
+
+const char *File::name() const {
+    int slash = _path.lastIndexOf('/');
+    return slash >= 0 ? _path.c_str() + slash + 1 : _path.c_str();
+}
+
+// === Dir ===
+bool Dir::next() {
+    DIR *d = opendir(FS::hostPath(_path.c_str()).c_str());
+    if (!d) return false;
+    std::vector<String> names;
+    while (struct dirent *e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        names.push_back(String(e->d_name));
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    if (_index >= names.size()) return false;
+    _name = names[_index++];
+    String full = _path;
+    if (!full.endsWith("/")) full += "/";
+    full += _name;
+    struct stat st;
+    if (stat(FS::hostPath(full.c_str()).c_str(), &st) == 0) {
+        _size = st.st_size;
+        _isDir = S_ISDIR(st.st_mode);
+    }
+    return true;
+}
+
+File Dir::openFile(const char *mode) {
+    String full = _path;
+    if (!full.endsWith("/")) full += "/";
+    full += _name;
+    return LittleFS.open(full.c_str(), mode);
+}
+
+} // namespace fs
+
+// === EEPROM ===
+EEPROMClass EEPROM;
+
+static struct EepromFlashInit {
+    EepromFlashInit() { memset(EEPROM.flash, 0xFF, sizeof(EEPROM.flash)); }
+} eepromFlashInit;
+
+static String eepromHostPath() {
+    return fs::FS::hostPath("/eeprom.bin");
+}
+
+void EEPROMClass::begin(size_t size) {
+    if (size == 0 || size > sizeof(flash)) return;
+    if (persist && !_loaded) {
+        FILE *fp = fopen(eepromHostPath().c_str(), "rb");
+        if (fp) {
+            if (fread(flash, 1, sizeof(flash), fp) != sizeof(flash)) eraseFlash();
+            fclose(fp);
+        }
+    }
+    _loaded = true;
+    size = (size + 3) & ~3;
+    if (_data && size != _size) {
+        delete[] _data;
+        _data = nullptr;
+    }
+    if (!_data) _data = new uint8_t[size];
+    _size = size;
+    memcpy(_data, flash, _size);
+    sectorReads++;
+    SimFlash::instance().read(sizeof(flash));
+    _dirty = false;
+}
+
+uint8_t EEPROMClass::read(int address) {
+    if (address < 0 || (size_t)address >= _size || !_data) return 0;
+    return _data[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    if (address < 0 || (size_t)address >= _size || !_data) return;
+    if (_data[address] != value) {
+        _data[address] = value;
+        _dirty = true;
+    }
+}
+
+bool EEPROMClass::commit() {
+    if (!_size || !_data) return false;
+    if (!_dirty) return true;
+    memcpy(flash, _data, _size);
+    sectorErases++;
+    // Effacement du secteur entier puis reprogrammation de ses 16 pages
+    SimFlash::instance().erase();
+    SimFlash::instance().program(sizeof(flash), false);
+    if (persist) {
+        LittleFS.begin();
+        FILE *fp = fopen(eepromHostPath().c_str(), "wb");
+        if (fp) {
+            fwrite(flash, 1, sizeof(flash), fp);
+            fclose(fp);
+        }
+    }
+    _dirty = false;
+    return true;
+}
+
+bool EEPROMClass::end() {
+    bool ok = commit();
+    delete[] _data;
+    _data = nullptr;
+    _size = 0;
+    return ok;
+}
+
+uint8_t *EEPROMClass::getDataPtr() {
+    _dirty = true;
+    return _data;
+}
@@ -0,0 +1,1006 @@
+/*
+ * RC522 et cartes simulés pour la cible hôte.
+ * Les codes de retour et transitions d'état suivent la bibliothèque MFRC522
+ * et les fiches techniques MIFARE (ISO 14443-3) ; les durées suivent SimTiming.
+ */
+#include <MFRC522.h>
+#include "native_sim.h"
+
+typedef MFRC522::StatusCode StatusCode;
+
+// === SimField ===
+SimField &SimField::instance() {
+    static SimField field;
+    return field;
+}
+
+SimField::SimField() {
+    resetRegisters();
+}
+
+void SimField::resetRegisters() {
+    memset(regs, 0, sizeof(regs));
+    regs[MFRC522::CommandReg >> 1] = 0x20;
+    regs[MFRC522::ModeReg >> 1] = 0x3F;
+    regs[MFRC522::TxControlReg >> 1] = 0x80; // antenne coupée après reset
+    regs[MFRC522::TxASKReg >> 1] = 0x00;
+    regs[MFRC522::RFCfgReg >> 1] = 0x48;     // gain 33 dB
+    regs[MFRC522::GsNReg >> 1] = 0x88;
+    regs[MFRC522::CWGsPReg >> 1] = 0x20;
+    regs[MFRC522::ModGsPReg >> 1] = 0x20;
+    regs[MFRC522::VersionReg >> 1] = 0x92;
+}
+
+void SimField::place(std::shared_ptr<SimCard> card) {
+    _card = card;
+    if (_card) _card->reset();
+    _placedAtUs = micros();
+}
+
+void SimField::remove() {
+    _card.reset();
+    _placedAtUs = 0;
+}
+
+void SimField::spend(uint32_t us) {
+    if (timing.scale <= 0.0f || us == 0) return;
+    nativeWait((uint64_t)(us * timing.scale));
+}
+
+uint32_t SimField::timerTimeoutUs() const {
+    // f_timer = 13,56 MHz / (2 * TPrescaler + 1), TPrescaler sur 12 bits
+    uint32_t prescaler = ((regs[MFRC522::TModeReg >> 1] & 0x0F) << 8) | regs[MFRC522::TPrescalerReg >> 1];
+    uint32_t reload = (regs[MFRC522::TReloadRegH >> 1] << 8) | regs[MFRC522::TReloadRegL >> 1];
+    return (uint32_t)((uint64_t)(reload + 1) * (2 * prescaler + 1) / 13.56);
+}
+
+bool SimField::responseLost(uint32_t responseUs) {
+    if (timerTimeoutUs() < responseUs) return true;
+    if (coupling <= 0.0f) return false;
+    static const uint8_t gainDb[8] = {18, 23, 18, 23, 33, 38, 43, 48};
+    float q = coupling * powf(10.0f, (gainDb[(regs[MFRC522::RFCfgReg >> 1] >> 4) & 0x07] - 33) / 20.0f);
+    float p = q >= 1.0f ? (q > 4.0f ? 0.08f : 0.005f) : fminf(1.0f, 0.005f + (1.0f - q) / 0.6f);
+    // xorshift32 : reproductible d'une exécution à l'autre
+    rfSeed ^= rfSeed << 13;
+    rfSeed ^= rfSeed >> 17;
+    rfSeed ^= rfSeed << 5;
+    if ((rfSeed & 0xFFFFFF) >= p * 0x1000000) return false;
+    rfErrors++;
+    return true;
+}
+
+// Échange perdu : timeout côté lecteur, la carte sélectionnée retombe en IDLE
+static bool exchangeLost(SimField &f, SimCard *card, uint32_t responseUs) {
+    if (!f.responseLost(responseUs)) return false;
+    f.timeouts++;
+    if (card->state == SimCard::STATE_ACTIVE || card->state == SimCard::STATE_READY) {
+        card->state = SimCard::STATE_IDLE;
+        card->crypto = false;
+    }
+    f.spend(f.timerTimeoutUs());
+    return true;
+}
+
+void SimField::injectBrownout() {
+    brownout = true;
+    memset(regs, 0, sizeof(regs));
+}
+
+void SimField::injectGlitch() {
+    resetRegisters();
+}
+
+// === SimCard ===
+SimCard::SimCard(const byte *uidBytes, byte uidLen, byte sakValue, uint16_t atqaValue)
+    : uidSize(uidLen), sak(sakValue), atqa(atqaValue) {
+    memset(uid, 0, sizeof(uid));
+    memcpy(uid, uidBytes, uidLen);
+}
+
+StatusCode SimCard::authenticate(byte, byte, const byte *) {
+    return MFRC522::STATUS_TIMEOUT;
+}
+
+StatusCode SimCard::transceive(const byte *, byte, byte *, byte *) {
+    return MFRC522::STATUS_TIMEOUT;
+}
+
+void SimCard::reset() {
+    state = STATE_IDLE;
+    crypto = false;
+}
+
+// === SimClassicCard ===
+static const byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+SimClassicCard::SimClassicCard(Size size, const byte *uidBytes, byte uidLen)
+    : SimCard(uidBytes, uidLen, size == MINI ? 0x09 : (size == CLASSIC_4K ? 0x18 : 0x08),
+              size == CLASSIC_4K ? 0x0002 : 0x0004),
+      _size(size) {
+    _blocks = size == MINI ? 20 : (size == CLASSIC_4K ? 256 : 64);
+    _memory.assign(_blocks * 16, 0x00);
+    // Bloc constructeur
+    byte *b0 = &_memory[0];
+    memcpy(b0, uidBytes, uidLen);
+    if (uidLen == 4) {
+        b0[4] = uidBytes[0] ^ uidBytes[1] ^ uidBytes[2] ^ uidBytes[3];
+        b0[5] = sak;
+        b0[6] = atqa & 0xFF;
+        b0[7] = atqa >> 8;
+    }
+    for (byte i = 8; i < 16; i++) b0[i] = 0x60 + i;
+    // Secteurs en configuration de transport
+    for (byte s = 0; s < sectorCount(); s++) {
+        setSectorKeys(s, defaultKey, defaultKey, 0, 0, 0, 1);
+    }
+}
+
+const char *SimClassicCard::kindName() const {
+    return _size == MINI ? "classic-mini" : (_size == CLASSIC_4K ? "classic-4k" : "classic-1k");
+}
+
+byte SimClassicCard::sectorCount() const {
+    return _size == MINI ? 5 : (_size == CLASSIC_4K ? 40 : 16);
+}
+
+byte SimClassicCard::sectorOf(byte blockAddr) {
+    return blockAddr < 128 ? blockAddr / 4 : 32 + (blockAddr - 128) / 16;
+}
+
+byte SimClassicCard::firstBlockOf(byte sector) {
+    return sector < 32 ? sector * 4 : 128 + (sector - 32) * 16;
+}
+
+byte SimClassicCard::blocksInSector(byte sector) {
+    return sector < 32 ? 4 : 16;
+}
+
+byte SimClassicCard::trailerOf(byte sector) {
+    return firstBlockOf(sector) + blocksInSector(sector) - 1;
+}
+
+void SimClassicCard::setBlock(byte blockAddr, const byte *data16) {
+    if (blockAddr < _blocks) memcpy(&_memory[blockAddr * 16], data16, 16);
+}
+
+void SimClassicCard::setSectorKeys(byte sector, const byte *keyA, const byte *keyB, byte g0, byte g1, byte g2,
+                                   byte g3) {
+    byte trailer[16];
+    memcpy(trailer, keyA, 6);
+    MFRC522 helper;
+    helper.MIFARE_SetAccessBits(&trailer[6], g0, g1, g2, g3);
+    trailer[9] = 0x69;
+    memcpy(&trailer[10], keyB, 6);
+    setBlock(trailerOf(sector), trailer);
+}
+
+void SimClassicCard::reset() {
+    SimCard::reset();
+    _authSector = -1;
+}
+
+byte SimClassicCard::accessBits(byte blockAddr) const {
+    // Renvoie C1C2C3 (3 bits) du groupe auquel appartient le bloc
+    byte sector = sectorOf(blockAddr);
+    const byte *t = block(trailerOf(sector));
+    byte offset = blockAddr - firstBlockOf(sector);
+    byte group = blocksInSector(sector) == 4 ? offset : (offset == 15 ? 3 : offset / 5);
+    byte c1 = (t[7] >> (4 + group)) & 1;
+    byte c2 = (t[8] >> group) & 1;
+    byte c3 = (t[8] >> (4 + group)) & 1;
+    return (c1 << 2) | (c2 << 1) | c3;
+}
+
+bool SimClassicCard::dataAllowed(byte blockAddr, bool writeOp) const {
+    byte ac = accessBits(blockAddr);
+    bool isTrailer = blockAddr == trailerOf(sectorOf(blockAddr));
+    if (isTrailer) {
+        // Simplification : écriture du trailer autorisée selon la clé d'écriture de la clé A
+        if (!writeOp) return true;
+        switch (ac) {
+        case 0b000: case 0b001: return !_authKeyB;
+        case 0b100: case 0b011: return _authKeyB;
+        default: return false;
+        }
+    }
+    if (!writeOp) {
+        switch (ac) {
+        case 0b000: case 0b010: case 0b100: case 0b110: case 0b001: return true;
+        case 0b011: case 0b101: return _authKeyB;
+        default: return false;
+        }
+    }
+    switch (ac) {
+    case 0b000: return true;
+    case 0b100: case 0b110: case 0b011: return _authKeyB;
+    default: return false;
+    }
+}
+
+StatusCode SimClassicCard::authenticate(byte command, byte blockAddr, const byte *key) {
+    if (state != STATE_ACTIVE || blockAddr >= _blocks) return MFRC522::STATUS_TIMEOUT;
+    bool keyB = command == MFRC522::PICC_CMD_MF_AUTH_KEY_B;
+    byte sector = sectorOf(blockAddr);
+    const byte *t = block(trailerOf(sector));
+    if (memcmp(keyB ? &t[10] : &t[0], key, 6) != 0) {
+        // Échec Crypto1 : la carte retourne à l'état IDLE
+        authFailures++;
+        state = STATE_IDLE;
+        crypto = false;
+        _authSector = -1;
+        return MFRC522::STATUS_TIMEOUT;
+    }
+    crypto = true;
+    _authSector = sector;
+    _authKeyB = keyB;
+    return MFRC522::STATUS_OK;
+}
+
+StatusCode SimClassicCard::read(byte blockAddr, byte *out16) {
+    if (state != STATE_ACTIVE) return MFRC522::STATUS_TIMEOUT;
+    if (!crypto || blockAddr >= _blocks || sectorOf(blockAddr) != _authSector || !dataAllowed(blockAddr, false)) {
+        state = STATE_IDLE;
+        crypto = false;
+        return MFRC522::STATUS_MIFARE_NACK;
+    }
+    reads++;
+    memcpy(out16, block(blockAddr), 16);
+    if (blockAddr == trailerOf(_authSector)) {
+        // La clé A n'est jamais lisible ; la clé B seulement si les bits d'accès le permettent
+        memset(out16, 0, 6);
+        byte ac = accessBits(blockAddr);
+        bool keyBReadable = !_authKeyB && (ac == 0b000 || ac == 0b010 || ac == 0b001);
+        if (!keyBReadable) memset(out16 + 10, 0, 6);
+    }
+    return MFRC522::STATUS_OK;
+}
+
+StatusCode SimClassicCard::write(byte blockAddr, const byte *data, byte len) {
+    if (state != STATE_ACTIVE) return MFRC522::STATUS_TIMEOUT;
+    bool denied = !crypto || blockAddr >= _blocks || sectorOf(blockAddr) != _authSector ||
+                  (blockAddr == 0 && !magic) || !dataAllowed(blockAddr, true);
+    if (denied) {
+        state = STATE_IDLE;
+        crypto = false;
+        return MFRC522::STATUS_MIFARE_NACK;
+    }
+    writes++;
+    memcpy(&_memory[blockAddr * 16], data, len < 16 ? len : 16);
+    return MFRC522::STATUS_OK;
+}
+
+// === SimUltralightCard ===
+SimUltralightCard::SimUltralightCard(Model model, const byte *uid7)
+    : SimCard(uid7, 7, 0x00, 0x0044), _model(model) {
+    _pages = model == ULTRALIGHT ? 16 : (model == NTAG213 ? 45 : (model == NTAG215 ? 135 : 231));
+    _memory.assign(_pages * 4, 0x00);
+    // Pages 0-2 : UID et octets de contrôle (BCC0 = CT ^ uid0..2, BCC1 = uid3..6)
+    _memory[0] = uid7[0];
+    _memory[1] = uid7[1];
+    _memory[2] = uid7[2];
+    _memory[3] = 0x88 ^ uid7[0] ^ uid7[1] ^ uid7[2];
+    memcpy(&_memory[4], &uid7[3], 4);
+    _memory[8] = uid7[3] ^ uid7[4] ^ uid7[5] ^ uid7[6];
+    _memory[9] = 0x48;
+    // Page 3 : Capability Container NDEF
+    if (model != ULTRALIGHT) {
+        byte size = model == NTAG213 ? 0x12 : (model == NTAG215 ? 0x3E : 0x6D);
+        byte cc[4] = {0xE1, 0x10, size, 0x00};
+        memcpy(&_memory[12], cc, 4);
+    }
+}
+
+const char *SimUltralightCard::kindName() const {
+    switch (_model) {
+    case NTAG213: return "ntag213";
+    case NTAG215: return "ntag215";
+    case NTAG216: return "ntag216";
+    default: return "ultralight";
+    }
+}
+
+void SimUltralightCard::setPage(byte p, const byte *data4) {
+    if (p < _pages) memcpy(&_memory[p * 4], data4, 4);
+}
+
+StatusCode SimUltralightCard::read(byte p, byte *out16) {
+    if (state != STATE_ACTIVE) return MFRC522::STATUS_TIMEOUT;
+    if (p >= _pages) {
+        state = STATE_IDLE;
+        return MFRC522::STATUS_MIFARE_NACK;
+    }
+    reads++;
+    // READ renvoie 4 pages ; sur Ultralight l'adresse reboucle au début
+    for (byte i = 0; i < 4; i++) {
+        uint16_t src = (p + i) % _pages;
+        memcpy(out16 + i * 4, &_memory[src * 4], 4);
+    }
+    return MFRC522::STATUS_OK;
+}
+
+StatusCode SimUltralightCard::write(byte p, const byte *data, byte len) {
+    if (state != STATE_ACTIVE) return MFRC522::STATUS_TIMEOUT;
+    if (p < 3 || p >= _pages || len < 4) {
+        state = STATE_IDLE;
+        return MFRC522::STATUS_MIFARE_NACK;
+    }
+    writes++;
+    memcpy(&_memory[p * 4], data, 4);
+    return MFRC522::STATUS_OK;
+}
+
+// === SimIsoDepCard ===
+static const uint16_t fsdTable[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+static const byte ndefAid[7] = {0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01};
+
+SimIsoDepCard::SimIsoDepCard(Kind kind, const byte *uid7)
+    : SimCard(uid7, 7, kind == MIFARE_PLUS_SL2 ? 0x11 : 0x20, kind == DESFIRE_EV1 ? 0x0344 : 0x0004),
+      _kind(kind) {
+    if (kind == DESFIRE_EV1) {
+        // FSCI 5 (64 octets), 212/424/848 kbit/s, FWI 8, SFGI 1, historique 0x80
+        ats = {0x06, 0x75, 0x77, 0x81, 0x02, 0x80};
+    } else {
+        // FSCI 8 (256 octets), 212/424 kbit/s, FWI 7, historique "JCOP31"
+        ats = {0x0B, 0x78, 0x33, 0x70, 0x02, 'J', 'C', 'O', 'P', '3', '1'};
+    }
+}
+
+const char *SimIsoDepCard::kindName() const {
+    switch (_kind) {
+    case DESFIRE_EV1: return "DESFire EV1";
+    case SMARTCARD: return "ISO 14443-4";
+    default: return "MIFARE Plus SL2";
+    }
+}
+
+StatusCode SimIsoDepCard::read(byte, byte *) {
+    return MFRC522::STATUS_TIMEOUT;
+}
+
+StatusCode SimIsoDepCard::write(byte, const byte *, byte) {
+    return MFRC522::STATUS_TIMEOUT;
+}
+
+void SimIsoDepCard::reset() {
+    SimCard::reset();
+    _layer4 = false;
+    _blockNumber = 1;
+    dsi = dri = 0;
+    _command.clear();
+    _pending.clear();
+    _wtxPending = false;
+    _versionFrame = 0;
+    _ndefSelected = false;
+    _file = 0;
+}
+
+void SimIsoDepCard::setNdef(const std::vector<byte> &message) {
+    _ndefFile.clear();
+    if (message.empty()) return;
+    _ndefFile.push_back(message.size() >> 8);
+    _ndefFile.push_back(message.size() & 0xFF);
+    _ndefFile.insert(_ndefFile.end(), message.begin(), message.end());
+}
+
+void SimIsoDepCard::sendBlock(const std::vector<byte> &block, byte *rx, byte *rxLen) {
+    _lastBlock = block;
+    byte n = min((size_t)*rxLen, block.size());
+    memcpy(rx, block.data(), n);
+    *rxLen = n;
+}
+
+// Bloc suivant de la réponse en cours, chaîné au-delà de FSD
+void SimIsoDepCard::nextBlock(byte *rx, byte *rxLen) {
+    size_t chunk = min(_pending.size() - _pendingOffset, (size_t)_fsd - 3);
+    bool more = _pendingOffset + chunk < _pending.size();
+    std::vector<byte> block;
+    block.push_back(0x02 | _blockNumber | (more ? 0x10 : 0x00));
+    block.insert(block.end(), _pending.begin() + _pendingOffset, _pending.begin() + _pendingOffset + chunk);
+    _pendingOffset += chunk;
+    sendBlock(block, rx, rxLen);
+}
+
+StatusCode SimIsoDepCard::transceive(const byte *tx, byte txLen, byte *rx, byte *rxLen) {
+    if (txLen == 0 || _kind == MIFARE_PLUS_SL2) return MFRC522::STATUS_TIMEOUT;
+    if (!_layer4) {
+        // RATS : FSDI dans le quartet de poids fort du paramètre
+        if (tx[0] != 0xE0 || txLen < 2) return MFRC522::STATUS_TIMEOUT;
+        _layer4 = true;
+        _blockNumber = 1;
+        _fsd = fsdTable[min(tx[1] >> 4, 8)];
+        sendBlock(ats, rx, rxLen);
+        return MFRC522::STATUS_OK;
+    }
+    byte pcb = tx[0];
+    if ((pcb & 0xF0) == 0xD0) {
+        // PPS : réponse au débit courant, nouveau débit ensuite
+        if (txLen >= 3 && (tx[1] & 0x10)) {
+            byte requestedDs = (tx[2] >> 2) & 0x03;
+            byte requestedDr = tx[2] & 0x03;
+            byte ta = ats.size() > 2 && (ats[1] & 0x10) ? ats[2] : 0;
+            if ((requestedDs && !(ta & (0x10 << (requestedDs - 1)))) ||
+                (requestedDr && !(ta & (0x01 << (requestedDr - 1))))) {
+                return MFRC522::STATUS_TIMEOUT;
+            }
+            dsi = requestedDs;
+            dri = requestedDr;
+        }
+        sendBlock({pcb}, rx, rxLen);
+        return MFRC522::STATUS_OK;
+    }
+    if (pcb == 0xC2) {
+        sendBlock({0xC2}, rx, rxLen);
+        state = STATE_HALT;
+        _layer4 = false;
+        dsi = dri = 0;
+        return MFRC522::STATUS_OK;
+    }
+    if ((pcb & 0xF7) == 0xF2) {
+        // Réponse du lecteur à notre S(WTX) : la réponse APDU suit
+        if (!_wtxPending) return MFRC522::STATUS_TIMEOUT;
+        _wtxPending = false;
+        nextBlock(rx, rxLen);
+        return MFRC522::STATUS_OK;
+    }
+    if ((pcb & 0xE2) == 0x02) {
+        _blockNumber = pcb & 0x01;
+        _command.insert(_command.end(), tx + 1, tx + txLen);
+        if (pcb & 0x10) {
+            sendBlock({(byte)(0xA2 | _blockNumber)}, rx, rxLen);
+            return MFRC522::STATUS_OK;
+        }
+        _pending = apdu(_command);
+        _pendingOffset = 0;
+        _command.clear();
+        apdus++;
+        if (waitExtension) {
+            _wtxPending = true;
+            sendBlock({0xF2, 0x01}, rx, rxLen);
+            return MFRC522::STATUS_OK;
+        }
+        nextBlock(rx, rxLen);
+        return MFRC522::STATUS_OK;
+    }
+    if ((pcb & 0xE6) == 0xA2) {
+        byte bn = pcb & 0x01;
+        if (!(pcb & 0x10)) {
+            // R(ACK) : bloc suivant de la réponse chaînée, ou dernier bloc perdu
+            if (bn != _blockNumber) {
+                _blockNumber ^= 1;
+                nextBlock(rx, rxLen);
+            } else {
+                sendBlock(_lastBlock, rx, rxLen);
+            }
+        } else if (bn == _blockNumber) {
+            sendBlock(_lastBlock, rx, rxLen);
+        } else {
+            sendBlock({(byte)(0xA2 | _blockNumber)}, rx, rxLen);
+        }
+        return MFRC522::STATUS_OK;
+    }
+    return MFRC522::STATUS_TIMEOUT;
+}
+
+std::vector<byte> SimIsoDepCard::apdu(const std::vector<byte> &c) {
+    if (c.size() < 4) return {0x67, 0x00};
+    byte version = _versionFrame;
+    _versionFrame = 0;
+    if (c[0] == 0x90) {
+        if (_kind != DESFIRE_EV1) return {0x6E, 0x00};
+        switch (c[1]) {
+        case 0x60:
+            _versionFrame = 1;
+            return {0x04, 0x01, 0x01, 0x01, 0x00, 0x18, 0x05, 0x91, 0xAF};
+        case 0xAF:
+            if (version == 1) {
+                _versionFrame = 2;
+                return {0x04, 0x01, 0x01, 0x01, 0x04, 0x18, 0x05, 0x91, 0xAF};
+            }
+            if (version == 2) {
+                std::vector<byte> out(uid, uid + 7);
+                const byte batch[7] = {0xBA, 0x5C, 0x01, 0x23, 0x45, 0x10, 0x21};
+                out.insert(out.end(), batch, batch + 7);
+                out.push_back(0x91);
+                out.push_back(0x00);
+                return out;
+            }
+            return {0x91, 0xCA};
+        case 0x6A: {
+            std::vector<byte> out;
+            for (uint32_t aid : applications) {
+                out.push_back(aid & 0xFF);
+                out.push_back((aid >> 8) & 0xFF);
+                out.push_back(aid >> 16);
+            }
+            out.push_back(0x91);
+            out.push_back(0x00);
+            return out;
+        }
+        default:
+            return {0x91, 0x1C};
+        }
+    }
+    if (c[0] != 0x00) return {0x6E, 0x00};
+    if (c[1] == 0xA4 && c[2] == 0x04) {
+        bool match = c.size() >= 12 && c[4] == 7 && memcmp(&c[5], ndefAid, 7) == 0;
+        _ndefSelected = match && !_ndefFile.empty();
+        _file = 0;
+        return _ndefSelected ? std::vector<byte>{0x90, 0x00} : std::vector<byte>{0x6A, 0x82};
+    }
+    if (c[1] == 0xA4 && c[2] == 0x00) {
+        uint16_t fid = c.size() >= 7 ? (c[5] << 8) | c[6] : 0;
+        if (!_ndefSelected || (fid != 0xE103 && fid != 0xE104)) return {0x6A, 0x82};
+        _file = fid;
+        return {0x90, 0x00};
+    }
+    if (c[1] == 0xB0) {
+        if (_file == 0) return {0x69, 0x86};
+        // CC : MLe 0x3B, MLc 0x34, fichier E104 de 2 Ko en lecture/écriture libres
+        const std::vector<byte> cc = {0x00, 0x0F, 0x20, 0x00, 0x3B, 0x00, 0x34, 0x04,
+                                      0x06, 0xE1, 0x04, 0x08, 0x00, 0x00, 0x00};
+        const std::vector<byte> &file = _file == 0xE103 ? cc : _ndefFile;
+        size_t offset = (c[2] << 8) | c[3];
+        size_t le = c.size() > 4 ? (c[4] ? c[4] : 256) : 256;
+        if (offset > file.size()) return {0x6B, 0x00};
+        size_t n = min(le, file.size() - offset);
+        std::vector<byte> out(file.begin() + offset, file.begin() + offset + n);
+        out.push_back(0x90);
+        out.push_back(0x00);
+        return out;
+    }
+    return {0x6D, 0x00};
+}
+
+// === Fabriques ===
+std::shared_ptr<SimClassicCard> simClassic1K(uint32_t uid4) {
+    byte uid[4] = {(byte)(uid4 >> 24), (byte)(uid4 >> 16), (byte)(uid4 >> 8), (byte)uid4};
+    return std::make_shared<SimClassicCard>(SimClassicCard::CLASSIC_1K, uid, 4);
+}
+
+std::shared_ptr<SimClassicCard> simClassic4K(uint32_t uid4) {
+    byte uid[4] = {(byte)(uid4 >> 24), (byte)(uid4 >> 16), (byte)(uid4 >> 8), (byte)uid4};
+    return std::make_shared<SimClassicCard>(SimClassicCard::CLASSIC_4K, uid, 4);
+}
+
+std::shared_ptr<SimClassicCard> simClassicMixed(uint32_t uid4) {
+    std::shared_ptr<SimClassicCard> card = simClassic1K(uid4);
+    const byte defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    const byte otherKey[6] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+    const byte keyB[6] = {0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5};
+    // Secteurs 3-5 : clé A inconnue ; 6-8 : données lisibles avec la clé B seulement
+    for (byte s = 3; s <= 5; s++) card->setSectorKeys(s, otherKey, keyB, 0, 0, 0, 1);
+    for (byte s = 6; s <= 8; s++) card->setSectorKeys(s, defaultKey, keyB, 3, 3, 3, 3);
+    // Secteurs 9-10 : lecture seule ; 11 : blocs 0-1 bloqués, bloc 2 libre
+    for (byte s = 9; s <= 10; s++) card->setSectorKeys(s, defaultKey, keyB, 2, 2, 2, 1);
+    card->setSectorKeys(11, defaultKey, keyB, 7, 7, 0, 1);
+    return card;
+}
+
+std::shared_ptr<SimUltralightCard> simUltralight() {
+    const byte uid[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    return std::make_shared<SimUltralightCard>(SimUltralightCard::ULTRALIGHT, uid);
+}
+
+std::shared_ptr<SimUltralightCard> simNtag(SimUltralightCard::Model model) {
+    const byte uid[7] = {0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x80};
+    return std::make_shared<SimUltralightCard>(model, uid);
+}
+
+std::shared_ptr<SimIsoDepCard> simDesfire() {
+    const byte uid[7] = {0x04, 0x5D, 0xE5, 0xF1, 0x2A, 0x64, 0x80};
+    auto card = std::make_shared<SimIsoDepCard>(SimIsoDepCard::DESFIRE_EV1, uid);
+    card->applications = {0x000001, 0xF51230, 0xA1B2C3};
+    // Enregistrement URI court : préfixe 0x04 = "https://"
+    const char *host = "example.com";
+    std::vector<byte> message = {0xD1, 0x01, (byte)(1 + strlen(host)), 'U', 0x04};
+    message.insert(message.end(), host, host + strlen(host));
+    card->setNdef(message);
+    return card;
+}
+
+std::shared_ptr<SimIsoDepCard> simSmartCard() {
+    const byte uid[7] = {0x08, 0x3C, 0x91, 0x5E, 0x21, 0x07, 0x44};
+    return std::make_shared<SimIsoDepCard>(SimIsoDepCard::SMARTCARD, uid);
+}
+
+std::shared_ptr<SimIsoDepCard> simMifarePlus() {
+    const byte uid[7] = {0x04, 0x7F, 0x10, 0x2B, 0x33, 0x5A, 0x81};
+    return std::make_shared<SimIsoDepCard>(SimIsoDepCard::MIFARE_PLUS_SL2, uid);
+}
+
+// === MFRC522 (double) ===
+static SimField &field() {
+    return SimField::instance();
+}
+
+static SimCard *activeCard() {
+    SimField &f = field();
+    if (f.brownout || !f.antennaOn()) return nullptr;
+    return f.card();
+}
+
+MFRC522::MFRC522() : MFRC522(UNUSED_PIN, UNUSED_PIN) {}
+
+MFRC522::MFRC522(byte resetPowerDownPin) : MFRC522(UNUSED_PIN, resetPowerDownPin) {}
+
+MFRC522::MFRC522(byte chipSelectPin, byte resetPowerDownPin)
+    : _chipSelectPin(chipSelectPin), _resetPowerDownPin(resetPowerDownPin) {
+    memset(&uid, 0, sizeof(uid));
+}
+
+void MFRC522::PCD_WriteRegister(PCD_Register reg, byte value) {
+    field().spend(field().timing.registerUs);
+    if (field().brownout) return;
+    field().regs[(reg >> 1) & 0x3F] = value;
+}
+
+void MFRC522::PCD_WriteRegister(PCD_Register reg, byte count, byte *values) {
+    for (byte i = 0; i < count; i++) PCD_WriteRegister(reg, values[i]);
+}
+
+byte MFRC522::PCD_ReadRegister(PCD_Register reg) {
+    field().spend(field().timing.registerUs);
+    return field().regs[(reg >> 1) & 0x3F];
+}
+
+void MFRC522::PCD_ReadRegister(PCD_Register reg, byte count, byte *values, byte) {
+    for (byte i = 0; i < count; i++) values[i] = PCD_ReadRegister(reg);
+}
+
+void MFRC522::PCD_SetRegisterBitMask(PCD_Register reg, byte mask) {
+    PCD_WriteRegister(reg, PCD_ReadRegister(reg) | mask);
+}
+
+void MFRC522::PCD_ClearRegisterBitMask(PCD_Register reg, byte mask) {
+    PCD_WriteRegister(reg, PCD_ReadRegister(reg) & (~mask));
+}
+
+StatusCode MFRC522::PCD_CalculateCRC(byte *data, byte length, byte *result) {
+    // CRC_A (ISO 14443-3) : init 0x6363, polynôme réfléchi 0x8408
+    uint16_t crc = 0x6363;
+    for (byte i = 0; i < length; i++) {
+        byte b = data[i] ^ (byte)(crc & 0xFF);
+        b ^= b << 4;
+        crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+    }
+    result[0] = crc & 0xFF;
+    result[1] = crc >> 8;
+    return STATUS_OK;
+}
+
+void MFRC522::PCD_Init() {
+    SimField &f = field();
+    f.brownout = false;
+    f.resetRegisters();
+    f.spend(50000); // reset logiciel (ou mise sous tension par RST) de la bibliothèque
+    // Mêmes valeurs que la bibliothèque : timer 25 ms, modulation 100 % ASK, CRC 0x6363
+    f.regs[TxModeReg >> 1] = 0x00;
+    f.regs[RxModeReg >> 1] = 0x00;
+    f.regs[ModWidthReg >> 1] = 0x26;
+    f.regs[TModeReg >> 1] = 0x80;
+    f.regs[TPrescalerReg >> 1] = 0xA9;
+    f.regs[TReloadRegH >> 1] = 0x03;
+    f.regs[TReloadRegL >> 1] = 0xE8;
+    f.regs[TxASKReg >> 1] = 0x40;
+    f.regs[ModeReg >> 1] = 0x3D;
+    PCD_AntennaOn();
+}
+
+void MFRC522::PCD_Init(byte resetPowerDownPin) {
+    _resetPowerDownPin = resetPowerDownPin;
+    PCD_Init();
+}
+
+void MFRC522::PCD_Init(byte chipSelectPin, byte resetPowerDownPin) {
+    _chipSelectPin = chipSelectPin;
+    _resetPowerDownPin = resetPowerDownPin;
+    PCD_Init();
+}
+
+void MFRC522::PCD_Reset() {
+    field().resetRegisters();
+    field().brownout = false;
+    field().spend(50000); // oscillateur : ~37,74 µs * 1024 + marge
+}
+
+void MFRC522::PCD_AntennaOn() {
+    byte value = PCD_ReadRegister(TxControlReg);
+    if ((value & 0x03) != 0x03) PCD_WriteRegister(TxControlReg, value | 0x03);
+}
+
+void MFRC522::PCD_AntennaOff() {
+    PCD_ClearRegisterBitMask(TxControlReg, 0x03);
+}
+
+byte MFRC522::PCD_GetAntennaGain() {
+    return PCD_ReadRegister(RFCfgReg) & (0x07 << 4);
+}
+
+void MFRC522::PCD_SetAntennaGain(byte mask) {
+    if (PCD_GetAntennaGain() != mask) {
+        PCD_ClearRegisterBitMask(RFCfgReg, (0x07 << 4));
+        PCD_SetRegisterBitMask(RFCfgReg, mask & (0x07 << 4));
+    }
+}
+
+bool MFRC522::PCD_PerformSelfTest() {
+    return !field().brownout;
+}
+
+void MFRC522::PCD_SoftPowerDown() {
+    PCD_SetRegisterBitMask(CommandReg, 1 << 4);
+}
+
+void MFRC522::PCD_SoftPowerUp() {
+    PCD_ClearRegisterBitMask(CommandReg, 1 << 4);
+}
+
+// Trame brute : CRC ajouté/vérifié par le RC522 si TxCRCEn/RxCRCEn (bit 7 de
+// TxModeReg/RxModeReg), sinon présent dans les données ; au-delà de 106 kbit/s
+// le CRC matériel est obligatoire et la carte doit avoir négocié le même débit
+StatusCode MFRC522::PCD_TransceiveData(byte *sendData, byte sendLen, byte *backData, byte *backLen,
+                                       byte *validBits, byte, bool) {
+    SimField &f = field();
+    SimCard *card = activeCard();
+    byte txMode = f.regs[TxModeReg >> 1];
+    byte rxMode = f.regs[RxModeReg >> 1];
+    byte txSpeed = (txMode >> 4) & 0x07;
+    byte rxSpeed = (rxMode >> 4) & 0x07;
+    bool txCrc = txMode & 0x80;
+    bool rxCrc = rxMode & 0x80;
+    byte payloadLen = sendLen;
+    bool understood = card && card->state == SimCard::STATE_ACTIVE && card->acceptsLink(txSpeed, rxSpeed) &&
+                      ((txCrc && rxCrc) || (txSpeed == 0 && rxSpeed == 0));
+    if (understood && !txCrc) {
+        byte crc[2];
+        understood = sendLen >= 3 && PCD_CalculateCRC(sendData, sendLen - 2, crc) == STATUS_OK &&
+                     crc[0] == sendData[sendLen - 2] && crc[1] == sendData[sendLen - 1];
+        payloadLen = sendLen - 2;
+    }
+    if (!understood) {
+        f.timeouts++;
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    // Trame perdue : une carte ISO-DEP l'ignore simplement et reste active
+    if (f.responseLost(f.timing.frameUs)) {
+        f.timeouts++;
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    byte dummy = 0;
+    byte *length = backLen ? backLen : &dummy;
+    if (!rxCrc && *length >= 2) *length -= 2;
+    StatusCode status = card->transceive(sendData, payloadLen, backData, length);
+    if (validBits) *validBits = 0;
+    if (status != STATUS_OK) {
+        f.spend(f.timerTimeoutUs());
+        return status;
+    }
+    if (!rxCrc) {
+        PCD_CalculateCRC(backData, *length, backData + *length);
+        *length += 2;
+    }
+    f.spend(f.timing.frameUs + (sendLen + 2) * f.timing.byteUs / (1 << txSpeed) +
+            (*length + 2) * f.timing.byteUs / (1 << rxSpeed));
+    return status;
+}
+
+StatusCode MFRC522::PCD_CommunicateWithPICC(byte command, byte, byte *sendData, byte sendLen, byte *backData,
+                                            byte *backLen, byte *validBits, byte rxAlign, bool checkCRC) {
+    if (command != PCD_Transceive) return STATUS_ERROR;
+    return PCD_TransceiveData(sendData, sendLen, backData, backLen, validBits, rxAlign, checkCRC);
+}
+
+StatusCode MFRC522::PICC_RequestA(byte *bufferATQA, byte *bufferSize) {
+    return PICC_REQA_or_WUPA(PICC_CMD_REQA, bufferATQA, bufferSize);
+}
+
+StatusCode MFRC522::PICC_WakeupA(byte *bufferATQA, byte *bufferSize) {
+    return PICC_REQA_or_WUPA(PICC_CMD_WUPA, bufferATQA, bufferSize);
+}
+
+StatusCode MFRC522::PICC_REQA_or_WUPA(byte command, byte *bufferATQA, byte *bufferSize) {
+    if (bufferATQA == nullptr || *bufferSize < 2) return STATUS_NO_ROOM;
+    SimField &f = field();
+    f.requests++;
+    SimCard *card = activeCard();
+    bool wakes = card && (card->state == SimCard::STATE_IDLE ||
+                          (command == PICC_CMD_WUPA && card->state == SimCard::STATE_HALT));
+    if (!wakes) {
+        f.timeouts++;
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    if (exchangeLost(f, card, f.timing.requestUs)) return STATUS_TIMEOUT;
+    f.spend(f.timing.requestUs);
+    card->state = SimCard::STATE_READY;
+    card->crypto = false;
+    bufferATQA[0] = card->atqa & 0xFF;
+    bufferATQA[1] = card->atqa >> 8;
+    *bufferSize = 2;
+    return STATUS_OK;
+}
+
+StatusCode MFRC522::PICC_Select(Uid *target, byte validBits) {
+    if (validBits > 80) return STATUS_INVALID;
+    SimField &f = field();
+    SimCard *card = activeCard();
+    if (!card || card->state != SimCard::STATE_READY) {
+        f.timeouts++;
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    if (exchangeLost(f, card, f.timing.selectUs)) return STATUS_TIMEOUT;
+    f.selects++;
+    byte cascades = card->uidSize == 4 ? 1 : (card->uidSize == 7 ? 2 : 3);
+    f.spend(f.timing.selectUs + (cascades - 1) * f.timing.cascadeUs);
+    card->state = SimCard::STATE_ACTIVE;
+    target->size = card->uidSize;
+    memcpy(target->uidByte, card->uid, card->uidSize);
+    target->sak = card->sak;
+    return STATUS_OK;
+}
+
+StatusCode MFRC522::PICC_HaltA() {
+    // Comme la bibliothèque : le succès est signalé par l'absence de réponse (timeout)
+    SimField &f = field();
+    SimCard *card = activeCard();
+    if (card && card->state == SimCard::STATE_ACTIVE) card->state = SimCard::STATE_HALT;
+    f.spend(f.timerTimeoutUs());
+    return STATUS_OK;
+}
+
+StatusCode MFRC522::PCD_Authenticate(byte command, byte blockAddr, MIFARE_Key *key, Uid *) {
+    SimField &f = field();
+    SimCard *card = activeCard();
+    if (!card) {
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    if (exchangeLost(f, card, f.timing.authUs)) return STATUS_TIMEOUT;
+    StatusCode status = card->authenticate(command, blockAddr, key->keyByte);
+    f.spend(status == STATUS_OK ? f.timing.authUs : f.timerTimeoutUs());
+    return status;
+}
+
+void MFRC522::PCD_StopCrypto1() {
+    PCD_ClearRegisterBitMask(Status2Reg, 0x08);
+    SimCard *card = field().card();
+    if (card) card->crypto = false;
+}
+
+StatusCode MFRC522::MIFARE_Read(byte blockAddr, byte *buffer, byte *bufferSize) {
+    if (buffer == nullptr || *bufferSize < 18) return STATUS_NO_ROOM;
+    SimField &f = field();
+    SimCard *card = activeCard();
+    if (!card) {
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    if (exchangeLost(f, card, f.timing.readUs)) return STATUS_TIMEOUT;
+    StatusCode status = card->read(blockAddr, buffer);
+    f.spend(status == STATUS_TIMEOUT ? f.timerTimeoutUs() : f.timing.readUs);
+    if (status == STATUS_OK) {
+        PCD_CalculateCRC(buffer, 16, &buffer[16]);
+        *bufferSize = 18;
+    }
+    return status;
+}
+
+StatusCode MFRC522::MIFARE_Write(byte blockAddr, byte *buffer, byte bufferSize) {
+    if (buffer == nullptr || bufferSize < 16) return STATUS_INVALID;
+    SimField &f = field();
+    SimCard *card = activeCard();
+    if (!card) {
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    if (exchangeLost(f, card, f.timing.writeUs / 2)) return STATUS_TIMEOUT;
+    StatusCode status = card->write(blockAddr, buffer, 16);
+    f.spend(status == STATUS_TIMEOUT ? f.timerTimeoutUs() : f.timing.writeUs);
+    return status;
+}
+
+StatusCode MFRC522::MIFARE_Ultralight_Write(byte page, byte *buffer, byte bufferSize) {
+    if (buffer == nullptr || bufferSize < 4) return STATUS_INVALID;
+    SimField &f = field();
+    SimCard *card = activeCard();
+    if (!card) {
+        f.spend(f.timerTimeoutUs());
+        return STATUS_TIMEOUT;
+    }
+    if (exchangeLost(f, card, f.timing.writeUs / 2)) return STATUS_TIMEOUT;
+    StatusCode status = card->write(page, buffer, 4);
+    f.spend(status == STATUS_TIMEOUT ? f.timerTimeoutUs() : f.timing.writeUs / 2);
+    return status;
+}
+
+StatusCode MFRC522::PCD_MIFARE_Transceive(byte *sendData, byte sendLen, bool acceptTimeout) {
+    byte back[18];
+    byte backLen = sizeof(back);
+    StatusCode status = PCD_TransceiveData(sendData, sendLen, back, &backLen);
+    if (acceptTimeout && status == STATUS_TIMEOUT) return STATUS_OK;
+    return status;
+}
+
+const __FlashStringHelper *MFRC522::GetStatusCodeName(StatusCode code) {
+    switch (code) {
+    case STATUS_OK: return F("Success.");
+    case STATUS_ERROR: return F("Error in communication.");
+    case STATUS_COLLISION: return F("Collision detected.");
+    case STATUS_TIMEOUT: return F("Timeout in communication.");
+    case STATUS_NO_ROOM: return F("A buffer is not big enough.");
+    case STATUS_INTERNAL_ERROR: return F("Internal error in the code. Should not happen.");
+    case STATUS_INVALID: return F("Invalid argument.");
+    case STATUS_CRC_WRONG: return F("The CRC_A does not match.");
+    case STATUS_MIFARE_NACK: return F("A MIFARE PICC responded with NAK.");
+    default: return F("Unknown error");
+    }
+}
+
+MFRC522::PICC_Type MFRC522::PICC_GetType(byte sak) {
+    sak &= 0x7F;
+    switch (sak) {
+    case 0x04: return PICC_TYPE_NOT_COMPLETE;
+    case 0x09: return PICC_TYPE_MIFARE_MINI;
+    case 0x08: return PICC_TYPE_MIFARE_1K;
+    case 0x18: return PICC_TYPE_MIFARE_4K;
+    case 0x00: return PICC_TYPE_MIFARE_UL;
+    case 0x10:
+    case 0x11: return PICC_TYPE_MIFARE_PLUS;
+    case 0x01: return PICC_TYPE_TNP3XXX;
+    case 0x20: return PICC_TYPE_ISO_14443_4;
+    case 0x40: return PICC_TYPE_ISO_18092;
+    default: return PICC_TYPE_UNKNOWN;
+    }
+}
+
+const __FlashStringHelper *MFRC522::PICC_GetTypeName(PICC_Type piccType) {
+    switch (piccType) {
+    case PICC_TYPE_ISO_14443_4: return F("PICC compliant with ISO/IEC 14443-4");
+    case PICC_TYPE_ISO_18092: return F("PICC compliant with ISO/IEC 18092 (NFC)");
+    case PICC_TYPE_MIFARE_MINI: return F("MIFARE Mini, 320 bytes");
+    case PICC_TYPE_MIFARE_1K: return F("MIFARE 1KB");
+    case PICC_TYPE_MIFARE_4K: return F("MIFARE 4KB");
+    case PICC_TYPE_MIFARE_UL: return F("MIFARE Ultralight or Ultralight C");
+    case PICC_TYPE_MIFARE_PLUS: return F("MIFARE Plus");
+    case PICC_TYPE_MIFARE_DESFIRE: return F("MIFARE DESFire");
+    case PICC_TYPE_TNP3XXX: return F("MIFARE TNP3XXX");
+    case PICC_TYPE_NOT_COMPLETE: return F("SAK indicates UID is not complete.");
+    case PICC_TYPE_UNKNOWN:
+    default: return F("Unknown type");
+    }
+}
+
+void MFRC522::PCD_DumpVersionToSerial() {
+    byte v = PCD_ReadRegister(VersionReg);
+    Serial.print(F("Firmware Version: 0x"));
+    Serial.print(v, HEX);
+    if (v == 0x92) Serial.println(F(" = v2.0"));
+    else if (v == 0x00 || v == 0xFF) Serial.println(F(" (communication failure?)"));
+    else Serial.println(F(" = (unknown)"));
+}
+
+void MFRC522::MIFARE_SetAccessBits(byte *accessBitBuffer, byte g0, byte g1, byte g2, byte g3) {
+    byte c1 = ((g3 & 4) << 1) | ((g2 & 4) << 0) | ((g1 & 4) >> 1) | ((g0 & 4) >> 2);
+    byte c2 = ((g3 & 2) << 2) | ((g2 & 2) << 1) | ((g1 & 2) << 0) | ((g0 & 2) >> 1);
+    byte c3 = ((g3 & 1) << 3) | ((g2 & 1) << 2) | ((g1 & 1) << 1) | ((g0 & 1) << 0);
+    accessBitBuffer[0] = (~c2 & 0xF) << 4 | (~c1 & 0xF);
+    accessBitBuffer[1] = c1 << 4 | (~c3 & 0xF);
+    accessBitBuffer[2] = c3 << 4 | c2;
+}
+
+bool MFRC522::PICC_IsNewCardPresent() {
+    byte bufferATQA[2];
+    byte bufferSize = sizeof(bufferATQA);
+    PCD_WriteRegister(TxModeReg, 0x00);
+    PCD_WriteRegister(RxModeReg, 0x00);
+    PCD_WriteRegister(ModWidthReg, 0x26);
+    StatusCode result = PICC_RequestA(bufferATQA, &bufferSize);
+    return (result == STATUS_OK || result == STATUS_COLLISION);
+}
+
+bool MFRC522::PICC_ReadCardSerial() {
+    return PICC_Select(&uid) == STATUS_OK;
+}
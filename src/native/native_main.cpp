@@ -0,0 +1,249 @@
+/*
+ * Point d'entrée de l'environnement native (pio run -e native).
+ *
+ * Fait tourner la logique applicative (scanner, paramètres, API, routes web)
+ * sur Linux avec un RC522, des cartes, un WiFi et un serveur HTTP simulés.
+ *
+ *   program scan <carte> [n]          n scans complets (lecture + envoi API)
+ *   program http <méthode> <uri> [corps]
+ *   program bench [options]           banc d'essai scan -> API (voir bench.cpp)
+ *   program allocs [n]                allocations sur le tas par scan (voir bench.cpp)
+ *   program configbench [n]           coût des réglages EEPROM / journal (voir bench.cpp)
+ *   program longpoll [n]              attente longue sur /api/lastcard (voir bench.cpp)
+ *   program pipeline [n] [latence-us] rafale de cartes, API lente (voir bench.cpp)
+ *   program mqtt [n] [rtt-us]         transport MQTT, broker de substitution (voir bench.cpp)
+ *   program coap [n] [rtt-us]         remontée CoAP, serveur UDP de substitution (voir bench.cpp)
+ *   program cbor [n]                  corps CBOR contre form et JSON, image 1K complète
+ *   program outbox [n]                boîte d'envoi : coupure, renvois idempotents, redémarrage
+ *   program cache [n] [latence-us]    cache des décisions de l'API : retour immédiat, invalidation
+ *   program link [intervalle-ms] [carte]  lecteur sur un pseudo-terminal (tools/rfid_link)
+ *   program scan classic1k 5 + http GET /api/metrics   (commandes enchaînées)
+ *
+ * Cartes : classic1k, classic4k, ultralight, ntag213, ntag215, ntag216
+ * Variables d'environnement :
+ *   NATIVE_FS_ROOT       racine LittleFS/EEPROM (défaut ./.native_fs)
+ *   NATIVE_TIMING_SCALE  facteur appliqué au modèle temporel du RC522 (0 = instantané)
+ *   NATIVE_QUIET=1       coupe la recopie de Serial sur stdout
+ */
+#include <Arduino.h>
+#include <native_sim.h>
+#include <scanner.h>
+#include <scan_pipeline.h>
+#include <settings.h>
+#include <api_client.h>
+#include <web_routes.h>
+#include <card_image.h>
+#include <mqtt_client.h>
+#include <acl.h>
+#include <rf_tuning.h>
+#include <rc522_health.h>
+#include <provisioning.h>
+#include <serial_link.h>
+#include <upload_outbox.h>
+
+int runBench(int argc, char **argv);
+int runAllocs(int argc, char **argv);
+int runConfigBench(int argc, char **argv);
+int runLongPoll(int argc, char **argv);
+int runPipelineBench(int argc, char **argv);
+int runAccessBench(int argc, char **argv);
+int runRfTuneBench(int argc, char **argv);
+int runRc522Bench(int argc, char **argv);
+int runIsoBench(int argc, char **argv);
+int runNdefBench(int argc, char **argv);
+int runProvisionBench(int argc, char **argv);
+int runSerialBench(int argc, char **argv);
+int runMqttBench(int argc, char **argv);
+int runCoapBench(int argc, char **argv);
+int runCborBench(int argc, char **argv);
+int runOutboxBench(int argc, char **argv);
+int runCacheBench(int argc, char **argv);
+
+// Pas d'Updater sur l'hôte : /update répond simplement 501
+void setupUpdateRoute() {
+    webServer.on("/update", HTTP_POST, []() {
+        webServer.send(501, "text/plain", "Mise à jour indisponible (native)");
+    });
+}
+
+std::shared_ptr<SimCard> nativeMakeCard(const String &name) {
+    if (name == "classic1k") return simClassic1K();
+    if (name == "classic4k") return simClassic4K();
+    if (name == "classic1k-mixed") return simClassicMixed();
+    if (name == "ultralight") return simUltralight();
+    if (name == "ntag213") return simNtag(SimUltralightCard::NTAG213);
+    if (name == "ntag215") return simNtag(SimUltralightCard::NTAG215);
+    if (name == "ntag216") return simNtag(SimUltralightCard::NTAG216);
+    if (name == "desfire") return simDesfire();
+    if (name == "iso14443-4") return simSmartCard();
+    if (name == "mifareplus") return simMifarePlus();
+    return nullptr;
+}
+
+// Équivalent de setup() sans WiFi/OTA : le réseau simulé est toujours connecté
+void nativeSetup() {
+    const char *scale = getenv("NATIVE_TIMING_SCALE");
+    if (scale) SimField::instance().timing.scale = atof(scale);
+    const char *quiet = getenv("NATIVE_QUIET");
+    if (quiet && quiet[0] == '1') Serial.setEcho(false);
+    Serial.begin(115200);
+    // Pas de commandes texte sur l'hôte : BINARY et les trames restent actives
+    serialLinkBegin(nullptr);
+    scannerBegin();
+    loadSettings();
+    rfTuningBegin();
+    rc522HealthBegin();
+    readProfilesBegin();
+    cardImageBegin();
+    aclBegin();
+    provisioningBegin();
+    outboxBegin();
+    mqttBegin();
+    wifiConnected = true;
+    // Configuration vierge (« http:// ») : URL de l'API en boucle locale
+    if (apiUrl.length() <= 7) apiUrl = "http://127.0.0.1/api/scan";
+    setupWebServer();
+}
+
+// Itérations de loop() jusqu'à ce que le pipeline de scan soit vide
+void nativeDrainPipeline() {
+    while (!scanPipelineIdle()) {
+        scanPipelineLoop();
+        rfTuningLoop();
+        mqttLoop();
+        webServerLoop();
+        delay(1);
+    }
+}
+
+// pio test -e native : chaque suite de test/ fournit son propre main()
+#ifndef PIO_UNIT_TESTING
+
+static int runScan(int argc, char **argv) {
+    if (argc < 3) return 2;
+    std::shared_ptr<SimCard> card = nativeMakeCard(argv[2]);
+    if (!card) {
+        fprintf(stderr, "Carte inconnue: %s\n", argv[2]);
+        return 2;
+    }
+    int count = argc > 3 ? atoi(argv[3]) : 1;
+    scanDelayMs = 0;
+    for (int i = 0; i < count; i++) {
+        // Carte retirée puis représentée : elle repart de l'état IDLE
+        SimField::instance().place(card);
+        unsigned long start = micros();
+        handleRFIDOperations();
+        unsigned long captureUs = micros() - start;
+        SimField::instance().remove();
+        nativeDrainPipeline();
+        const std::vector<LoopbackRequest> &received = LoopbackHttpServer::instance().received;
+        fprintf(stderr, "scan %d: capture %lu us, total %lu us, requêtes API %u\n", i + 1, captureUs,
+                micros() - start, (unsigned)received.size());
+        if (!received.empty()) {
+            const std::vector<uint8_t> &body = received.back().body;
+            fprintf(stderr, "  corps: %.*s\n", (int)body.size(), (const char *)body.data());
+        }
+    }
+    return 0;
+}
+
+static int runHttp(int argc, char **argv) {
+    if (argc < 4) return 2;
+    String m(argv[2]);
+    m.toUpperCase();
+    HTTPMethod method = m == "POST" ? HTTP_POST : (m == "DELETE" ? HTTP_DELETE : HTTP_GET);
+    String body = argc > 4 ? String(argv[4]) : String();
+    NativeHttpResponse response = webServer.request(method, argv[3], body, "application/x-www-form-urlencoded");
+    // Réponse différée (attente longue) : la boucle tourne jusqu'à la réponse
+    while (!response.poll()) {
+        webServerLoop();
+        delay(1);
+    }
+    printf("%d %s\n%s\n", response.code, response.contentType.c_str(), response.body.c_str());
+    return response.code >= 200 && response.code < 400 ? 0 : 1;
+}
+
+// Lecteur exposé sur un pseudo-terminal pour tools/rfid_link.cpp : la carte
+// est présentée toutes les intervalle-ms tant que le scan continu est actif
+static int runLink(int argc, char **argv) {
+    int intervalMs = argc > 2 ? atoi(argv[2]) : 1000;
+    std::shared_ptr<SimCard> card = nativeMakeCard(argc > 3 ? argv[3] : "classic1k");
+    if (!card) {
+        fprintf(stderr, "Carte inconnue: %s\n", argv[3]);
+        return 2;
+    }
+    char path[64];
+    int fd = nativeOpenPty(path, sizeof(path));
+    if (fd < 0) {
+        perror("pseudo-terminal");
+        return 1;
+    }
+    fprintf(stderr, "Port série: %s (Ctrl-C pour arrêter)\n", path);
+    Serial.attachFd(fd);
+    scanDelayMs = 0;
+    continuousMode = true;
+    unsigned long lastCard = 0;
+    for (;;) {
+        serialLinkPoll();
+        if (continuousMode && millis() - lastCard >= (unsigned long)intervalMs) {
+            lastCard = millis();
+            SimField::instance().place(card);
+            handleRFIDOperations();
+            SimField::instance().remove();
+        }
+        scanPipelineLoop();
+        rfTuningLoop();
+        webServerLoop();
+        delay(1);
+    }
+}
+
+static int runCommand(int argc, char **argv) {
+    String command(argv[1]);
+    if (command == "scan") return runScan(argc, argv);
+    if (command == "http") return runHttp(argc, argv);
+    if (command == "bench") return runBench(argc, argv);
+    if (command == "allocs") return runAllocs(argc, argv);
+    if (command == "configbench") return runConfigBench(argc, argv);
+    if (command == "longpoll") return runLongPoll(argc, argv);
+    if (command == "pipeline") return runPipelineBench(argc, argv);
+    if (command == "access") return runAccessBench(argc, argv);
+    if (command == "rftune") return runRfTuneBench(argc, argv);
+    if (command == "rc522") return runRc522Bench(argc, argv);
+    if (command == "iso") return runIsoBench(argc, argv);
+    if (command == "ndef") return runNdefBench(argc, argv);
+    if (command == "provision") return runProvisionBench(argc, argv);
+    if (command == "serial") return runSerialBench(argc, argv);
+    if (command == "mqtt") return runMqttBench(argc, argv);
+    if (command == "coap") return runCoapBench(argc, argv);
+    if (command == "cbor") return runCborBench(argc, argv);
+    if (command == "outbox") return runOutboxBench(argc, argv);
+    if (command == "cache") return runCacheBench(argc, argv);
+    if (command == "link") return runLink(argc, argv);
+    fprintf(stderr, "Commande inconnue: %s\n", argv[1]);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s scan <carte> [n] | http <méthode> <uri> [corps] | bench [options] | allocs [n] | configbench [n] | longpoll [n] | pipeline [n] [latence-us] | access [n] | rftune [n] [couplage] | rc522 [n] | iso [n] | ndef [n] | provision [n] | serial [n] | mqtt [n] [rtt-us] | coap [n] [rtt-us] | cbor [n] | outbox [n] | cache [n] [latence-us] | link [intervalle-ms] [carte]\n", argv[0]);
+        return 2;
+    }
+    // La sortie du banc d'essai doit rester lisible par machine
+    String first(argv[1]);
+    if (first == "bench" || first == "allocs" || first == "configbench" || first == "longpoll" || first == "pipeline" || first == "access" || first == "rftune" || first == "rc522" || first == "iso" || first == "ndef" || first == "provision" || first == "serial" || first == "mqtt" || first == "coap" || first == "cbor" || first == "outbox" || first == "cache") Serial.setEcho(false);
+    nativeSetup();
+    // Plusieurs commandes dans le même processus, séparées par « + »
+    int start = 1;
+    int result = 0;
+    for (int i = 1; i <= argc && result == 0; i++) {
+        if (i < argc && strcmp(argv[i], "+") != 0) continue;
+        if (i > start) result = runCommand(i - start + 1, argv + start - 1);
+        start = i + 1;
+    }
+    // Équivalent d'un arrêt propre : les réglages modifiés sont écrits
+    flushSettings();
+    return result;
+}
+
+#endif // PIO_UNIT_TESTING
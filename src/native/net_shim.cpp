@@ -0,0 +1,619 @@
+/*
+ * Réseau hôte : WiFi simulé, WiFiClient (sockets POSIX), HTTPClient servi par
+ * LoopbackHttpServer et ESP8266WebServer à requêtes injectées.
+ */
+#include <Arduino.h>
+#include <ESP8266HTTPClient.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266WiFi.h>
+#include "native_sim.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// === WiFi ===
+ESP8266WiFiClass WiFi;
+
+SimNetwork &SimNetwork::instance() {
+    static SimNetwork net;
+    return net;
+}
+
+wl_status_t ESP8266WiFiClass::status() {
+    return SimNetwork::instance().connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+int ESP8266WiFiClass::hostByName(const char *host, IPAddress &result) {
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res) return 0;
+    const uint8_t *a = (const uint8_t *)&((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    result = IPAddress(a[0], a[1], a[2], a[3]);
+    freeaddrinfo(res);
+    return 1;
+}
+
+// === WiFiClient (TCP POSIX) ===
+WiFiClient::~WiFiClient() {}
+
+WiFiClient::WiFiClient(const WiFiClient &other) : Stream(), _fd(other._fd), _peeked(other._peeked) {}
+
+WiFiClient &WiFiClient::operator=(const WiFiClient &other) {
+    _fd = other._fd;
+    _peeked = other._peeked;
+    return *this;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    stop();
+    struct addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%u", port);
+    if (getaddrinfo(host, portStr, &hints, &res) != 0 || !res) return 0;
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0 || ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        if (fd >= 0) ::close(fd);
+        freeaddrinfo(res);
+        return 0;
+    }
+    freeaddrinfo(res);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _fd = std::shared_ptr<int>(new int(fd), [](int *p) {
+        if (*p >= 0) ::close(*p);
+        delete p;
+    });
+    _peeked = -1;
+    return 1;
+}
+
+void WiFiClient::attach(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _fd = std::shared_ptr<int>(new int(fd), [](int *p) {
+        if (*p >= 0) ::close(*p);
+        delete p;
+    });
+    _peeked = -1;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+    if (fd() < 0) return 0;
+    size_t off = 0;
+    while (off < size) {
+        ssize_t n = ::send(fd(), buf + off, size - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                struct pollfd p = {fd(), POLLOUT, 0};
+                poll(&p, 1, 100);
+                continue;
+            }
+            stop();
+            break;
+        }
+        off += n;
+    }
+    return off;
+}
+
+int WiFiClient::available() {
+    if (fd() < 0) return 0;
+    if (_peeked >= 0) return 1;
+    uint8_t c;
+    ssize_t n = ::recv(fd(), &c, 1, MSG_PEEK);
+    if (n == 0) return 0;
+    if (n < 0) return 0;
+    int pending = 0;
+    ::ioctl(fd(), FIONREAD, &pending);
+    return pending > 0 ? pending : 1;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+    if (fd() < 0 || size == 0) return -1;
+    size_t off = 0;
+    if (_peeked >= 0) {
+        buf[off++] = (uint8_t)_peeked;
+        _peeked = -1;
+    }
+    if (off < size) {
+        ssize_t n = ::recv(fd(), buf + off, size - off, 0);
+        if (n > 0) off += n;
+        else if (n == 0) stop();
+    }
+    return off ? (int)off : -1;
+}
+
+int WiFiClient::peek() {
+    if (_peeked < 0) {
+        uint8_t c;
+        if (fd() >= 0 && ::recv(fd(), &c, 1, 0) == 1) _peeked = c;
+    }
+    return _peeked;
+}
+
+void WiFiClient::stop() {
+    _fd.reset();
+    _peeked = -1;
+}
+
+uint8_t WiFiClient::connected() {
+    if (fd() < 0) return 0;
+    uint8_t c;
+    ssize_t n = ::recv(fd(), &c, 1, MSG_PEEK);
+    if (n == 0) return 0;
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+    return 1;
+}
+
+void WiFiClient::setNoDelay(bool nodelay) {
+    int flag = nodelay ? 1 : 0;
+    if (fd() >= 0) setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+// === WiFiUDP (UDP POSIX) ===
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) return 0;
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        // Port déjà pris sur l'hôte (plusieurs instances) : port éphémère
+        addr.sin_port = 0;
+        if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            stop();
+            return 0;
+        }
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _rxLength = _rxPos = 0;
+}
+
+uint16_t WiFiUDP::localPort() const {
+    struct sockaddr_in addr = {};
+    socklen_t length = sizeof(addr);
+    if (_fd < 0 || getsockname(_fd, (struct sockaddr *)&addr, &length) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    _txIp = ip;
+    _txPort = port;
+    _tx.clear();
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return beginPacket(ip, port);
+}
+
+size_t WiFiUDP::write(uint8_t c) {
+    _tx.push_back(c);
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t size) {
+    _tx.insert(_tx.end(), buf, buf + size);
+    return size;
+}
+
+int WiFiUDP::endPacket() {
+    if (_fd < 0 && !begin(0)) return 0;
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    uint8_t *a = (uint8_t *)&addr.sin_addr.s_addr;
+    for (int i = 0; i < 4; i++) a[i] = _txIp[i];
+    addr.sin_port = htons(_txPort);
+    ssize_t n = ::sendto(_fd, _tx.data(), _tx.size(), 0, (struct sockaddr *)&addr, sizeof(addr));
+    _tx.clear();
+    return n >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+    if (_fd < 0) return 0;
+    struct sockaddr_in from = {};
+    socklen_t length = sizeof(from);
+    ssize_t n = ::recvfrom(_fd, _rx, sizeof(_rx), 0, (struct sockaddr *)&from, &length);
+    if (n <= 0) {
+        _rxLength = _rxPos = 0;
+        return 0;
+    }
+    const uint8_t *a = (const uint8_t *)&from.sin_addr.s_addr;
+    _remoteIp = IPAddress(a[0], a[1], a[2], a[3]);
+    _remotePort = ntohs(from.sin_port);
+    _rxLength = n;
+    _rxPos = 0;
+    return n;
+}
+
+int WiFiUDP::available() {
+    return _rxLength - _rxPos;
+}
+
+int WiFiUDP::read() {
+    return _rxPos < _rxLength ? _rx[_rxPos++] : -1;
+}
+
+int WiFiUDP::read(uint8_t *buf, size_t size) {
+    size_t n = std::min(size, _rxLength - _rxPos);
+    memcpy(buf, _rx + _rxPos, n);
+    _rxPos += n;
+    return n;
+}
+
+int WiFiUDP::peek() {
+    return _rxPos < _rxLength ? _rx[_rxPos] : -1;
+}
+
+// === LoopbackHttpServer ===
+LoopbackHttpServer &LoopbackHttpServer::instance() {
+    static LoopbackHttpServer server;
+    return server;
+}
+
+int LoopbackHttpServer::serve(const LoopbackRequest &req, String &responseBody, bool secure) {
+    // Coûts réseau indépendants de l'échelle du modèle RC522
+    nativeWait(connectUs + (secure ? tlsHandshakeUs : 0));
+    if (!reachable) return HTTPC_ERROR_CONNECTION_FAILED;
+    nativeWait(latencyUs);
+    if (failureRate > 0.0f && (float)::random() / (float)RAND_MAX < failureRate) {
+        return failureCode;
+    }
+    received.push_back(req);
+    received.back().receivedAtUs = micros();
+    if (handler) {
+        LoopbackResponse r = handler(req);
+        responseBody = r.body;
+        return r.code;
+    }
+    responseBody = "OK";
+    return 200;
+}
+
+// === HTTPClient ===
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+    NativeNetworkHeapScope scope;
+    if (!url.startsWith("http://") && !url.startsWith("https://")) return false;
+    _client = &client;
+    _url = url;
+    _contentType = String();
+    _idempotencyKey = String();
+    _response = String();
+    return true;
+}
+
+void HTTPClient::end() {
+    NativeNetworkHeapScope scope;
+    _client = nullptr;
+}
+
+void HTTPClient::addHeader(const String &name, const String &value, bool, bool) {
+    NativeNetworkHeapScope scope;
+    if (name.equalsIgnoreCase("Content-Type")) _contentType = value;
+    else if (name.equalsIgnoreCase("Idempotency-Key")) _idempotencyKey = value;
+}
+
+void HTTPClient::collectHeaders(const char *[], const size_t) {}
+
+String HTTPClient::header(const char *) {
+    return String();
+}
+
+int HTTPClient::GET() {
+    return sendRequest("GET");
+}
+
+int HTTPClient::POST(const uint8_t *payload, size_t size) {
+    return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::POST(const String &payload) {
+    return sendRequest("POST", (const uint8_t *)payload.c_str(), payload.length());
+}
+
+int HTTPClient::sendRequest(const char *type, const uint8_t *payload, size_t size) {
+    NativeNetworkHeapScope scope;
+    if (!_client) return HTTPC_ERROR_NOT_CONNECTED;
+    if (!SimNetwork::instance().connected) return HTTPC_ERROR_CONNECTION_FAILED;
+    LoopbackRequest req;
+    req.method = type;
+    req.url = _url;
+    req.contentType = _contentType;
+    req.idempotencyKey = _idempotencyKey;
+    if (payload && size) req.body.assign(payload, payload + size);
+    req.receivedAtUs = 0;
+    return LoopbackHttpServer::instance().serve(req, _response, _client->isSecure());
+}
+
+int HTTPClient::writeToStream(Stream *stream) {
+    NativeNetworkHeapScope scope;
+    if (!stream) return HTTPC_ERROR_NO_STREAM;
+    // Remis par morceaux comme le ferait la pile TCP
+    size_t done = 0;
+    while (done < _response.length()) {
+        size_t n = std::min((size_t)1460, _response.length() - done);
+        stream->write((const uint8_t *)_response.c_str() + done, n);
+        done += n;
+    }
+    return done;
+}
+
+String HTTPClient::errorToString(int error) {
+    NativeNetworkHeapScope scope;
+    switch (error) {
+    case HTTPC_ERROR_CONNECTION_FAILED: return F("connection failed");
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return F("send header failed");
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return F("send payload failed");
+    case HTTPC_ERROR_NOT_CONNECTED: return F("not connected");
+    case HTTPC_ERROR_CONNECTION_LOST: return F("connection lost");
+    case HTTPC_ERROR_NO_STREAM: return F("no stream");
+    case HTTPC_ERROR_NO_HTTP_SERVER: return F("no HTTP server");
+    case HTTPC_ERROR_TOO_LESS_RAM: return F("too less ram");
+    case HTTPC_ERROR_ENCODING: return F("Transfer-Encoding not supported");
+    case HTTPC_ERROR_STREAM_WRITE: return F("Stream write error");
+    case HTTPC_ERROR_READ_TIMEOUT: return F("read Timeout");
+    default: return String();
+    }
+}
+
+// === ESP8266WebServer ===
+String NativeHttpResponse::header(const char *name) const {
+    for (const auto &h : headers) {
+        if (h.first.equalsIgnoreCase(name)) return h.second;
+    }
+    return String();
+}
+
+bool NativeHttpResponse::poll() {
+    if (!deferred()) return true;
+    char buf[512];
+    ssize_t n;
+    while ((n = ::recv(*peer, buf, sizeof(buf), MSG_DONTWAIT)) > 0) raw.concat(buf, n);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+    // Fin de flux : l'application a fermé le client, la réponse est complète
+    peer.reset();
+    int headerEnd = raw.indexOf("\r\n\r\n");
+    if (!raw.startsWith("HTTP/1.") || headerEnd < 0) {
+        code = -1;
+        return true;
+    }
+    code = atoi(raw.c_str() + raw.indexOf(' ') + 1);
+    int line = raw.indexOf("\r\n") + 2;
+    while (line < headerEnd) {
+        int next = raw.indexOf("\r\n", line);
+        int colon = raw.indexOf(':', line);
+        if (colon > 0 && colon < next) {
+            String name = raw.substring(line, colon);
+            String value = raw.substring(colon + 1, next);
+            value.trim();
+            if (name.equalsIgnoreCase("Content-Type")) contentType = value;
+            else headers.push_back({name, value});
+        }
+        line = next + 2;
+    }
+    body = raw.substring(headerEnd + 4);
+    return true;
+}
+
+static const String emptyArg;
+
+static String urlDecode(const String &in) {
+    String out;
+    out.reserve(in.length());
+    for (unsigned int i = 0; i < in.length(); i++) {
+        char c = in[i];
+        if (c == '+') {
+            out += ' ';
+        } else if (c == '%' && i + 2 < in.length()) {
+            char hex[3] = {in[i + 1], in[i + 2], 0};
+            out += (char)strtol(hex, nullptr, 16);
+            i += 2;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction fn) {
+    _routes.push_back({uri, method, fn, nullptr});
+}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+    _routes.push_back({uri, method, fn, ufn});
+}
+
+void ESP8266WebServer::handleClient() {}
+
+const String &ESP8266WebServer::arg(const String &name) const {
+    for (const auto &a : _args) {
+        if (a.first == name) return a.second;
+    }
+    return emptyArg;
+}
+
+const String &ESP8266WebServer::arg(int i) const {
+    return i >= 0 && i < (int)_args.size() ? _args[i].second : emptyArg;
+}
+
+const String &ESP8266WebServer::argName(int i) const {
+    return i >= 0 && i < (int)_args.size() ? _args[i].first : emptyArg;
+}
+
+bool ESP8266WebServer::hasArg(const String &name) const {
+    for (const auto &a : _args) {
+        if (a.first == name) return true;
+    }
+    return false;
+}
+
+const String &ESP8266WebServer::header(const String &name) const {
+    for (const auto &h : _headers) {
+        if (h.first.equalsIgnoreCase(name)) return h.second;
+    }
+    return emptyArg;
+}
+
+bool ESP8266WebServer::hasHeader(const String &name) const {
+    for (const auto &h : _headers) {
+        if (h.first.equalsIgnoreCase(name)) return true;
+    }
+    return false;
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first) {
+    if (first) _pendingHeaders.insert(_pendingHeaders.begin(), {name, value});
+    else _pendingHeaders.push_back({name, value});
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const String &content) {
+    if (!_response) return;
+    _response->code = code;
+    _response->contentType = contentType ? contentType : "text/html";
+    _response->headers = _pendingHeaders;
+    _pendingHeaders.clear();
+    _response->body = content;
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const char *content, size_t contentLength) {
+    send(code, contentType, String(content, contentLength));
+}
+
+void ESP8266WebServer::sendContent(const char *content, size_t size) {
+    if (_response) _response->body.concat(content, size);
+}
+
+ESP8266WebServer::Route *ESP8266WebServer::findRoute(const String &path, HTTPMethod method) {
+    for (auto &r : _routes) {
+        if (r.uri == path && (r.method == HTTP_ANY || r.method == method)) return &r;
+    }
+    return nullptr;
+}
+
+void ESP8266WebServer::parseArgs(const String &query) {
+    unsigned int pos = 0;
+    while (pos < query.length()) {
+        int amp = query.indexOf('&', pos);
+        String pair = query.substring(pos, amp < 0 ? query.length() : amp);
+        int eq = pair.indexOf('=');
+        if (pair.length()) {
+            if (eq < 0) _args.push_back({urlDecode(pair), String()});
+            else _args.push_back({urlDecode(pair.substring(0, eq)), urlDecode(pair.substring(eq + 1))});
+        }
+        if (amp < 0) break;
+        pos = amp + 1;
+    }
+}
+
+NativeHttpResponse ESP8266WebServer::dispatch(HTTPMethod method, const String &uriWithQuery, const String &body,
+                                              const String &contentType, const uint8_t *upload,
+                                              size_t uploadLen, const String &filename) {
+    NativeHttpResponse response;
+    _response = &response;
+    // Socket réelle derrière client() : un gestionnaire peut la garder et répondre plus tard
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0) {
+        _client.attach(pair[0]);
+        response.peer = std::shared_ptr<int>(new int(pair[1]), [](int *p) {
+            ::close(*p);
+            delete p;
+        });
+    }
+    _args.clear();
+    _headers.clear();
+    _pendingHeaders.clear();
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _method = method;
+    int q = uriWithQuery.indexOf('?');
+    _uri = q < 0 ? uriWithQuery : uriWithQuery.substring(0, q);
+    if (q >= 0) parseArgs(uriWithQuery.substring(q + 1));
+    if (body.length()) {
+        if (contentType.startsWith("application/x-www-form-urlencoded")) parseArgs(body);
+        else _args.push_back({String("plain"), body});
+    }
+    static const char *const methodNames[] = {"ANY", "GET", "HEAD", "POST", "PUT", "PATCH", "DELETE", "OPTIONS"};
+    for (auto &hook : _hooks) {
+        ClientFuture future = hook(methodNames[method], _uri, &_client, [](const String &) { return String(); });
+        if (future != CLIENT_REQUEST_CAN_CONTINUE) {
+            _response = nullptr;
+            _client = WiFiClient();
+            if (response.code) response.peer.reset();
+            return response;
+        }
+    }
+    Route *route = findRoute(_uri, method);
+    if (route && route->ufn && upload) {
+        _upload.filename = filename;
+        _upload.name = "file";
+        _upload.type = "application/octet-stream";
+        _upload.totalSize = 0;
+        _upload.contentLength = uploadLen;
+        _upload.status = UPLOAD_FILE_START;
+        _upload.currentSize = 0;
+        route->ufn();
+        size_t off = 0;
+        while (off < uploadLen) {
+            size_t n = std::min((size_t)HTTP_UPLOAD_BUFLEN, uploadLen - off);
+            memcpy(_upload.buf, upload + off, n);
+            _upload.currentSize = n;
+            _upload.totalSize += n;
+            _upload.status = UPLOAD_FILE_WRITE;
+            route->ufn();
+            off += n;
+        }
+        _upload.status = UPLOAD_FILE_END;
+        _upload.currentSize = 0;
+        route->ufn();
+    }
+    if (route) route->fn();
+    else if (_notFound) _notFound();
+    else send(404, "text/plain", String("Not found: ") + _uri);
+    requestsServed++;
+    _response = nullptr;
+    // Comme le vrai serveur : sa référence au client est abandonnée sans stop()
+    _client = WiFiClient();
+    if (response.code) response.peer.reset();
+    return response;
+}
+
+NativeHttpResponse ESP8266WebServer::request(HTTPMethod method, const String &uriWithQuery, const String &body,
+                                             const String &contentType) {
+    return dispatch(method, uriWithQuery, body, contentType, nullptr, 0, String());
+}
+
+NativeHttpResponse ESP8266WebServer::requestUpload(const String &uri, const String &filename, const uint8_t *data,
+                                                   size_t len) {
+    return dispatch(HTTP_POST, uri, String(), String("multipart/form-data"), data, len, filename);
+}
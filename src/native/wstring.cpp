@@ -0,0 +1,443 @@
+/*
+ * Implémentation hôte de String (sémantique Arduino, sans SSO afin que
+ * chaque allocation soit visible par le suivi de tas).
+ */
+#include <Arduino.h>
+#include <ctype.h>
+
+String::String(const char *cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const char *cstr, size_t len) {
+    if (cstr) copy(cstr, len);
+}
+
+String::String(const String &str) {
+    copy(str.c_str(), str._len);
+}
+
+String::String(String &&str) {
+    move(str);
+}
+
+String::String(const __FlashStringHelper *str) {
+    const char *p = reinterpret_cast<const char *>(str);
+    if (p) copy(p, strlen(p));
+}
+
+String::String(char c) {
+    char buf[2] = {c, 0};
+    copy(buf, 1);
+}
+
+String::String(unsigned char value, unsigned char base) {
+    concatNumber(value, false, base);
+}
+
+String::String(int value, unsigned char base) {
+    if (value < 0 && base == 10) concatNumber((unsigned long long)(-(long long)value), true, base);
+    else concatNumber((unsigned int)value, false, base);
+}
+
+String::String(unsigned int value, unsigned char base) {
+    concatNumber(value, false, base);
+}
+
+String::String(long value, unsigned char base) {
+    if (value < 0 && base == 10) concatNumber((unsigned long long)(-(long long)value), true, base);
+    else concatNumber((unsigned long)value, false, base);
+}
+
+String::String(unsigned long value, unsigned char base) {
+    concatNumber(value, false, base);
+}
+
+String::String(long long value, unsigned char base) {
+    if (value < 0 && base == 10) concatNumber((unsigned long long)(-value), true, base);
+    else concatNumber((unsigned long long)value, false, base);
+}
+
+String::String(unsigned long long value, unsigned char base) {
+    concatNumber(value, false, base);
+}
+
+String::String(float value, unsigned char decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned char decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    copy(buf, strlen(buf));
+}
+
+String::~String() {
+    delete[] _buf;
+}
+
+String &String::operator=(const String &rhs) {
+    if (this != &rhs) copy(rhs.c_str(), rhs._len);
+    return *this;
+}
+
+String &String::operator=(String &&rhs) {
+    if (this != &rhs) {
+        delete[] _buf;
+        _buf = nullptr;
+        _len = _cap = 0;
+        move(rhs);
+    }
+    return *this;
+}
+
+String &String::operator=(const char *cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+    else copy("", 0);
+    return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *str) {
+    return *this = reinterpret_cast<const char *>(str);
+}
+
+String &String::operator=(char c) {
+    char buf[2] = {c, 0};
+    copy(buf, 1);
+    return *this;
+}
+
+bool String::grow(unsigned int size) {
+    if (_buf && _cap >= size) return true;
+    char *nb = new char[size + 1];
+    if (_buf) {
+        memcpy(nb, _buf, _len + 1);
+        delete[] _buf;
+    } else {
+        nb[0] = 0;
+    }
+    _buf = nb;
+    _cap = size;
+    return true;
+}
+
+bool String::reserve(unsigned int size) {
+    return grow(size);
+}
+
+void String::copy(const char *cstr, unsigned int len) {
+    if (len == 0 && !_buf) {
+        _len = 0;
+        return;
+    }
+    // La source peut appartenir à ce tampon (ex: s = s.c_str() + 1)
+    if (_buf && cstr >= _buf && cstr <= _buf + _cap) {
+        memmove(_buf, cstr, len);
+    } else {
+        grow(len);
+        memcpy(_buf, cstr, len);
+    }
+    _buf[len] = 0;
+    _len = len;
+}
+
+void String::move(String &rhs) {
+    _buf = rhs._buf;
+    _len = rhs._len;
+    _cap = rhs._cap;
+    rhs._buf = nullptr;
+    rhs._len = rhs._cap = 0;
+}
+
+bool String::concat(const char *cstr, unsigned int len) {
+    if (!cstr || len == 0) return true;
+    unsigned int newLen = _len + len;
+    if (!_buf || newLen > _cap) {
+        // Croissance similaire à WString : pas de réserve anticipée
+        char *nb = new char[newLen + 1];
+        if (_buf) memcpy(nb, _buf, _len);
+        memcpy(nb + _len, cstr, len);
+        delete[] _buf;
+        _buf = nb;
+        _cap = newLen;
+    } else {
+        memmove(_buf + _len, cstr, len);
+    }
+    _len = newLen;
+    _buf[_len] = 0;
+    return true;
+}
+
+bool String::concat(const String &str) {
+    if (&str == this) {
+        String tmp(str);
+        return concat(tmp.c_str(), tmp._len);
+    }
+    return concat(str.c_str(), str._len);
+}
+
+bool String::concat(const char *cstr) {
+    return cstr ? concat(cstr, strlen(cstr)) : true;
+}
+
+bool String::concat(const __FlashStringHelper *str) {
+    return concat(reinterpret_cast<const char *>(str));
+}
+
+bool String::concat(char c) {
+    return concat(&c, 1);
+}
+
+bool String::concatNumber(unsigned long long value, bool negative, unsigned char base) {
+    char buf[72];
+    char *p = buf + sizeof(buf) - 1;
+    *p = 0;
+    if (base < 2) base = 10;
+    do {
+        unsigned d = value % base;
+        *--p = d < 10 ? '0' + d : 'a' + d - 10;
+        value /= base;
+    } while (value);
+    if (negative) *--p = '-';
+    return concat(p, (unsigned int)(buf + sizeof(buf) - 1 - p));
+}
+
+bool String::concat(unsigned char num) {
+    return concatNumber(num, false, 10);
+}
+
+bool String::concat(int num) {
+    return num < 0 ? concatNumber((unsigned long long)(-(long long)num), true, 10) : concatNumber(num, false, 10);
+}
+
+bool String::concat(unsigned int num) {
+    return concatNumber(num, false, 10);
+}
+
+bool String::concat(long num) {
+    return num < 0 ? concatNumber((unsigned long long)(-(long long)num), true, 10) : concatNumber(num, false, 10);
+}
+
+bool String::concat(unsigned long num) {
+    return concatNumber(num, false, 10);
+}
+
+bool String::concat(long long num) {
+    return num < 0 ? concatNumber((unsigned long long)(-num), true, 10) : concatNumber(num, false, 10);
+}
+
+bool String::concat(unsigned long long num) {
+    return concatNumber(num, false, 10);
+}
+
+bool String::concat(float num) {
+    return concat((double)num);
+}
+
+bool String::concat(double num) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.2f", num);
+    return concat(buf);
+}
+
+int String::compareTo(const String &s) const {
+    return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const {
+    return _len == s._len && compareTo(s) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+    if (!cstr) return _len == 0;
+    return strcmp(c_str(), cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+    if (_len != s._len) return false;
+    return strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+    if (offset + prefix._len > _len) return false;
+    return strncmp(c_str() + offset, prefix.c_str(), prefix._len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    if (suffix._len > _len) return false;
+    return strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+    return index < _len ? _buf[index] : 0;
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < _len) _buf[index] = c;
+}
+
+char &String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _len) {
+        dummy = 0;
+        return dummy;
+    }
+    return _buf[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+    if (!bufsize || !buf) return;
+    if (index >= _len) {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > _len - index) n = _len - index;
+    memcpy(buf, _buf + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char *p = strchr(_buf + fromIndex, ch);
+    return p ? (int)(p - _buf) : -1;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char *p = strstr(_buf + fromIndex, str.c_str());
+    return p ? (int)(p - _buf) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+    if (!_len) return -1;
+    const char *p = strrchr(_buf, ch);
+    return p ? (int)(p - _buf) : -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+    if (beginIndex >= _len) return String();
+    if (endIndex > _len) endIndex = _len;
+    return String(_buf + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+    for (unsigned int i = 0; i < _len; i++) {
+        if (_buf[i] == find) _buf[i] = replace;
+    }
+}
+
+void String::replace(const String &find, const String &replace) {
+    if (!_len || !find._len) return;
+    String out;
+    unsigned int pos = 0;
+    while (true) {
+        int idx = indexOf(find, pos);
+        if (idx < 0) break;
+        out.concat(_buf + pos, idx - pos);
+        out.concat(replace);
+        pos = idx + find._len;
+    }
+    if (pos == 0) return;
+    out.concat(_buf + pos, _len - pos);
+    *this = std::move(out);
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len) return;
+    if (count > _len - index) count = _len - index;
+    memmove(_buf + index, _buf + index + count, _len - index - count + 1);
+    _len -= count;
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < _len; i++) _buf[i] = tolower((unsigned char)_buf[i]);
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < _len; i++) _buf[i] = toupper((unsigned char)_buf[i]);
+}
+
+void String::trim() {
+    if (!_len) return;
+    unsigned int begin = 0;
+    while (begin < _len && isspace((unsigned char)_buf[begin])) begin++;
+    unsigned int end = _len;
+    while (end > begin && isspace((unsigned char)_buf[end - 1])) end--;
+    _len = end - begin;
+    if (begin) memmove(_buf, _buf + begin, _len);
+    _buf[_len] = 0;
+}
+
+long String::toInt() const {
+    return _len ? atol(_buf) : 0;
+}
+
+float String::toFloat() const {
+    return (float)toDouble();
+}
+
+double String::toDouble() const {
+    return _len ? atof(_buf) : 0.0;
+}
+
+String operator+(const String &lhs, const String &rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, char rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, int rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, unsigned int rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, long rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, unsigned long rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator+(const String &lhs, const __FlashStringHelper *rhs) {
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
@@ -0,0 +1,281 @@
+/*
+ * Codage NDEF : analyse en place (TLV, enregistrements) et encodage URI/texte
+ */
+#include <ndef.h>
+
+#define MAD_CRC_PRESET 0xC7
+#define MAD_CRC_POLY   0x1D
+#define MAD_INFO       0x01
+
+// Préfixes abrégés des enregistrements URI (NFC Forum RTD URI), indexés par code
+static const char *const uriPrefixes[] = {
+    "", "http://www.", "https://www.", "http://", "https://", "tel:", "mailto:", "ftp://anonymous:anonymous@",
+    "ftp://ftp.", "ftps://", "sftp://", "smb://", "nfs://", "ftp://", "dav://", "news:", "telnet://", "imap:",
+    "rtsp://", "urn:", "pop:", "sip:", "sips:", "tftp:", "btspp://", "btl2cap://", "btgoep://", "tcpobex://",
+    "irdaobex://", "file://", "urn:epc:id:", "urn:epc:tag:", "urn:epc:pat:", "urn:epc:raw:", "urn:epc:", "urn:nfc:",
+};
+#define URI_PREFIX_COUNT (sizeof(uriPrefixes) / sizeof(uriPrefixes[0]))
+
+// === Analyse ===
+NdefStatus ndefFindMessage(const byte *area, size_t length, const byte **message, size_t *messageLength,
+                           size_t *needed) {
+    size_t pos = 0;
+    bool padding = false;
+    while (pos < length) {
+        byte type = area[pos];
+        padding = type == NDEF_TLV_NULL;
+        if (padding) {
+            pos++;
+            continue;
+        }
+        if (type == NDEF_TLV_TERMINATOR) return NDEF_NO_MESSAGE;
+        // Longueur sur un octet, ou 0xFF suivi de deux octets
+        if (pos + 2 > length) {
+            *needed = pos + 2;
+            return NDEF_TRUNCATED;
+        }
+        size_t valueLength = area[pos + 1];
+        size_t value = pos + 2;
+        if (valueLength == 0xFF) {
+            if (pos + 4 > length) {
+                *needed = pos + 4;
+                return NDEF_TRUNCATED;
+            }
+            valueLength = (area[pos + 2] << 8) | area[pos + 3];
+            value = pos + 4;
+        }
+        if (type == NDEF_TLV_MESSAGE) {
+            if (value + valueLength > length) {
+                *needed = value + valueLength;
+                return NDEF_TRUNCATED;
+            }
+            *message = area + value;
+            *messageLength = valueLength;
+            return NDEF_OK;
+        }
+        // Lock Control, Memory Control, propriétaire : ignorés
+        pos = value + valueLength;
+    }
+    // Zone épuisée dans le remplissage (TLV nuls) : carte vierge ou non formatée
+    if (padding) return NDEF_NO_MESSAGE;
+    *needed = pos + 2;
+    return NDEF_TRUNCATED;
+}
+
+void ndefBegin(NdefCursor &cursor, const byte *message, size_t length) {
+    cursor.data = message;
+    cursor.length = length;
+    cursor.offset = 0;
+}
+
+NdefStatus ndefNextRecord(NdefCursor &cursor, NdefRecord &record) {
+    if (cursor.offset >= cursor.length) return NDEF_END;
+    const byte *p = cursor.data + cursor.offset;
+    size_t left = cursor.length - cursor.offset;
+    if (left < 3) return NDEF_MALFORMED;
+    record.header = p[0];
+    record.typeLength = p[1];
+    size_t i = 2;
+    if (record.header & NDEF_SR) {
+        record.payloadLength = p[i++];
+    } else {
+        if (left < 6) return NDEF_MALFORMED;
+        record.payloadLength = ((uint32_t)p[2] << 24) | ((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 8) | p[5];
+        i = 6;
+    }
+    record.idLength = 0;
+    if (record.header & NDEF_IL) {
+        if (i >= left) return NDEF_MALFORMED;
+        record.idLength = p[i++];
+    }
+    if ((uint64_t)i + record.typeLength + record.idLength + record.payloadLength > left) return NDEF_MALFORMED;
+    record.type = p + i;
+    i += record.typeLength;
+    record.id = p + i;
+    i += record.idLength;
+    record.payload = p + i;
+    i += record.payloadLength;
+    // ME : les octets suivants n'appartiennent plus au message
+    cursor.offset = (record.header & NDEF_ME) ? cursor.length : cursor.offset + i;
+    return NDEF_OK;
+}
+
+static bool isWellKnown(const NdefRecord &record, char type) {
+    return (record.header & NDEF_TNF_MASK) == NDEF_TNF_WELL_KNOWN && record.typeLength == 1 &&
+           record.type[0] == (byte)type;
+}
+
+bool ndefIsUri(const NdefRecord &record) {
+    return isWellKnown(record, 'U') && record.payloadLength >= 1;
+}
+
+bool ndefIsText(const NdefRecord &record) {
+    return isWellKnown(record, 'T') && record.payloadLength >= 1 &&
+           1 + (uint32_t)(record.payload[0] & 0x3F) <= record.payloadLength;
+}
+
+const char *ndefUriPrefix(byte code) {
+    return code < URI_PREFIX_COUNT ? uriPrefixes[code] : "";
+}
+
+// === Résumé ===
+// Ajout borné ; caractères de contrôle remplacés par '.', UTF-8 conservé
+static size_t put(char *out, size_t size, size_t n, const char *text, size_t length) {
+    for (size_t i = 0; i < length && n + 1 < size; i++) {
+        byte c = text[i];
+        out[n++] = c < 0x20 || c == 0x7F ? '.' : (char)c;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+static size_t putText(char *out, size_t size, size_t n, const char *text) {
+    return put(out, size, n, text, strlen(text));
+}
+
+size_t ndefDescribe(const NdefRecord &record, char *out, size_t size) {
+    if (size == 0) return 0;
+    out[0] = '\0';
+    // « (UTF-16, <unsigned long> octets) » : 20 chiffres au plus sur l'hôte 64 bits
+    char count[40];
+    size_t n = 0;
+    const char *payload = reinterpret_cast<const char *>(record.payload);
+    const char *type = reinterpret_cast<const char *>(record.type);
+    if (ndefIsUri(record)) {
+        n = putText(out, size, n, "URI ");
+        n = putText(out, size, n, ndefUriPrefix(record.payload[0]));
+        return put(out, size, n, payload + 1, record.payloadLength - 1);
+    }
+    if (ndefIsText(record)) {
+        byte status = record.payload[0];
+        byte langLength = status & 0x3F;
+        n = putText(out, size, n, "Texte [");
+        n = put(out, size, n, payload + 1, langLength);
+        n = putText(out, size, n, "] ");
+        if (status & 0x80) {
+            snprintf(count, sizeof(count), "(UTF-16, %lu octets)",
+                     (unsigned long)(record.payloadLength - 1 - langLength));
+            return putText(out, size, n, count);
+        }
+        return put(out, size, n, payload + 1 + langLength, record.payloadLength - 1 - langLength);
+    }
+    switch (record.header & NDEF_TNF_MASK) {
+    case 0x00: return putText(out, size, n, "Vide");
+    case NDEF_TNF_URI:
+        n = putText(out, size, n, "URI ");
+        return put(out, size, n, payload, record.payloadLength);
+    case NDEF_TNF_WELL_KNOWN: n = putText(out, size, n, "Type NFC "); break;
+    case NDEF_TNF_MIME: n = putText(out, size, n, "MIME "); break;
+    case NDEF_TNF_EXTERNAL: n = putText(out, size, n, "Externe "); break;
+    default: n = putText(out, size, n, "TNF inconnu "); break;
+    }
+    n = put(out, size, n, type, record.typeLength);
+    snprintf(count, sizeof(count), " (%lu octets)", (unsigned long)record.payloadLength);
+    return putText(out, size, n, count);
+}
+
+// === Encodage ===
+// Code du plus long préfixe abrégé présent au début de l'URI
+static byte uriCode(const char *uri) {
+    byte best = 0;
+    size_t bestLength = 0;
+    for (byte code = 1; code < URI_PREFIX_COUNT; code++) {
+        size_t length = strlen(uriPrefixes[code]);
+        if (length > bestLength && strncmp(uri, uriPrefixes[code], length) == 0) {
+            best = code;
+            bestLength = length;
+        }
+    }
+    return best;
+}
+
+size_t ndefEncode(NdefKind kind, const char *value, const char *lang, byte *out, size_t size) {
+    byte code = 0;
+    size_t valueLength = strlen(value);
+    size_t langLength = 0;
+    size_t payloadLength;
+    if (kind == NDEF_KIND_URI) {
+        code = uriCode(value);
+        valueLength -= strlen(uriPrefixes[code]);
+        value += strlen(uriPrefixes[code]);
+        payloadLength = 1 + valueLength;
+    } else {
+        if (!lang || !*lang) lang = "fr";
+        langLength = min(strlen(lang), (size_t)0x3F);
+        payloadLength = 1 + langLength + valueLength;
+    }
+    bool shortRecord = payloadLength <= 0xFF;
+    size_t recordLength = 3 + (shortRecord ? 1 : 4) + payloadLength;
+    size_t tlvHeader = recordLength < 0xFF ? 2 : 4;
+    if (recordLength > 0xFFFE || tlvHeader + recordLength + 1 > size) return 0;
+    // TLV NDEF
+    size_t n = 0;
+    out[n++] = NDEF_TLV_MESSAGE;
+    if (tlvHeader == 2) {
+        out[n++] = recordLength;
+    } else {
+        out[n++] = 0xFF;
+        out[n++] = recordLength >> 8;
+        out[n++] = recordLength & 0xFF;
+    }
+    // Enregistrement unique : MB, ME, type NFC « U » ou « T »
+    out[n++] = NDEF_MB | NDEF_ME | (shortRecord ? NDEF_SR : 0) | NDEF_TNF_WELL_KNOWN;
+    out[n++] = 1;
+    if (shortRecord) {
+        out[n++] = payloadLength;
+    } else {
+        for (int shift = 24; shift >= 0; shift -= 8) out[n++] = (payloadLength >> shift) & 0xFF;
+    }
+    if (kind == NDEF_KIND_URI) {
+        out[n++] = 'U';
+        out[n++] = code;
+    } else {
+        out[n++] = 'T';
+        out[n++] = langLength;   // UTF-8
+        memcpy(out + n, lang, langLength);
+        n += langLength;
+    }
+    memcpy(out + n, value, valueLength);
+    n += valueLength;
+    out[n++] = NDEF_TLV_TERMINATOR;
+    return n;
+}
+
+// === Cartes ===
+uint16_t ndefType2Capacity(const byte *cc) {
+    // Version majeure 1 ; taille en unités de 8 octets
+    if (cc[0] != NDEF_CC_MAGIC || (cc[1] >> 4) != 1) return 0;
+    return cc[2] * 8;
+}
+
+byte ndefMadCrc(const byte *mad) {
+    // CRC-8 (x^8 + x^4 + x^3 + x^2 + 1) sur l'octet d'information et les AID
+    byte crc = MAD_CRC_PRESET;
+    for (byte i = 1; i < 32; i++) {
+        crc ^= mad[i];
+        for (byte bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? (crc << 1) ^ MAD_CRC_POLY : crc << 1;
+    }
+    return crc;
+}
+
+uint16_t ndefMadSectors(const byte *mad) {
+    if (ndefMadCrc(mad) != mad[0]) return 0;
+    uint16_t sectors = 0;
+    for (byte sector = 1; sector < NDEF_MAD_SECTORS; sector++) {
+        // AID sur deux octets, code d'application puis code de cluster
+        uint16_t aid = mad[2 * sector] | (mad[2 * sector + 1] << 8);
+        if (aid == NDEF_MAD_AID) sectors |= 1 << sector;
+    }
+    return sectors;
+}
+
+void ndefMadBuild(uint16_t sectors, byte *mad) {
+    memset(mad, 0, 32);
+    mad[1] = MAD_INFO;
+    for (byte sector = 1; sector < NDEF_MAD_SECTORS; sector++) {
+        if (!(sectors & (1 << sector))) continue;
+        mad[2 * sector] = NDEF_MAD_AID & 0xFF;
+        mad[2 * sector + 1] = NDEF_MAD_AID >> 8;
+    }
+    mad[0] = ndefMadCrc(mad);
+}
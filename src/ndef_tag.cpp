@@ -0,0 +1,358 @@
+/*
+ * Messages NDEF sur Ultralight/NTAG (Type 2) et MIFARE Classic (MAD)
+ */
+#include <ndef_tag.h>
+#include <scanner.h>
+#include <sector_access.h>
+#include <rf_tuning.h>
+#include <serial_link.h>
+
+#define TYPE2_CC_PAGE      3
+#define TYPE2_FIRST_PAGE   4
+#define TYPE2_BLANK_SIZE   0x06     // Ultralight : 48 octets (pages 4 à 15)
+#define SECTOR_DATA_SIZE   48       // trois blocs de données par secteur NDEF
+#define DESCRIBE_MAX       96
+
+static const byte transportKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const byte madKey[6] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+static const byte ndefKey[6] = {0xD3, 0xF7, 0xD3, 0xF7, 0xD3, 0xF7};
+// Bits d'accès et GPB (NFC Forum) : MAD modifiable avec la clé B seulement,
+// MAD v1 ; secteurs NDEF libres avec la clé A, version 1.0 en lecture/écriture
+static const byte madAccess[4] = {0x78, 0x77, 0x88, 0xC1};
+static const byte ndefAccess[4] = {0x7F, 0x07, 0x88, 0x40};
+
+static NdefStats stats;
+// Zone de données reconstituée quand le dump ne suffit pas (hors de la pile)
+static byte area[NDEF_AREA_MAX];
+static byte pending[NDEF_WRITE_MAX];
+static size_t pendingLength = 0;
+
+// === Affichage ===
+// Texte de la carte échappé avant d'entrer dans le résumé HTML
+static void appendEscaped(const char *text) {
+    char chunk[32];
+    size_t n = 0;
+    for (; *text; text++) {
+        const char *entity = *text == '<' ? "&lt;" : (*text == '>' ? "&gt;" : (*text == '&' ? "&amp;" : nullptr));
+        if (n + 6 > sizeof(chunk)) {
+            chunk[n] = '\0';
+            cardInfoAppend(chunk);
+            n = 0;
+        }
+        if (entity) {
+            while (*entity) chunk[n++] = *entity++;
+        } else {
+            chunk[n++] = *text;
+        }
+    }
+    chunk[n] = '\0';
+    cardInfoAppend(chunk);
+}
+
+void appendNdefRecords(const byte *message, size_t length) {
+    NdefCursor cursor;
+    NdefRecord record;
+    NdefStatus status;
+    uint16_t count = 0;
+    char line[DESCRIBE_MAX];
+    ndefBegin(cursor, message, length);
+    stats.messages++;
+    while ((status = ndefNextRecord(cursor, record)) == NDEF_OK) {
+        if (count++ >= NDEF_RECORDS_SHOWN) continue;
+        ndefDescribe(record, line, sizeof(line));
+        serialLog().print("  ");
+        serialLog().println(line);
+        cardInfoAppend("&nbsp;&nbsp;");
+        appendEscaped(line);
+        cardInfoAppend("<br/>");
+    }
+    stats.records += count;
+    if (status == NDEF_MALFORMED) {
+        stats.malformed++;
+        serialLog().println("  Enregistrement malformé");
+        cardInfoAppend("&nbsp;&nbsp;(enregistrement malformé)<br/>");
+    } else if (count == 0) {
+        cardInfoAppend("&nbsp;&nbsp;(message vide)<br/>");
+    } else if (count > NDEF_RECORDS_SHOWN) {
+        cardInfoPrintf("&nbsp;&nbsp;... (%u enregistrements)<br/>", count);
+    }
+}
+
+static void appendArea(NdefStatus status, const char *label, const byte *message, size_t length, size_t needed) {
+    switch (status) {
+    case NDEF_OK:
+        serialLog().printf("%s: %u octets\n", label, (unsigned)length);
+        cardInfoPrintf("<b>%s</b> : %u octets<br/>", label, (unsigned)length);
+        appendNdefRecords(message, length);
+        break;
+    case NDEF_TRUNCATED:
+        stats.malformed++;
+        serialLog().printf("%s: message incomplet\n", label);
+        cardInfoPrintf("<b>%s</b> : message incomplet (%u octets attendus)<br/>", label, (unsigned)needed);
+        break;
+    default:
+        cardInfoPrintf("<b>%s</b> : aucun message<br/>", label);
+        break;
+    }
+}
+
+// === Type 2 (Ultralight / NTAG) ===
+void appendType2Ndef(const byte *pages, byte pageCount) {
+    if (pageCount <= TYPE2_FIRST_PAGE) return;
+    uint16_t capacity = min(ndefType2Capacity(pages + TYPE2_CC_PAGE * 4), (uint16_t)NDEF_AREA_MAX);
+    if (!capacity) return;   // pas de Capability Container : carte non formatée NDEF
+    const byte *data = pages + TYPE2_FIRST_PAGE * 4;
+    size_t available = min((size_t)(pageCount - TYPE2_FIRST_PAGE) * 4, (size_t)capacity);
+    const byte *message = nullptr;
+    size_t messageLength = 0;
+    size_t needed = 0;
+    // Cas courant : message entier dans les pages du dump, analysé sur place
+    NdefStatus status = ndefFindMessage(data, available, &message, &messageLength, &needed);
+    if (status == NDEF_TRUNCATED && needed <= capacity) {
+        // Message long : zone recopiée puis complétée jusqu'à la fin du TLV
+        memcpy(area, data, available);
+        byte page = pageCount;
+        while (status == NDEF_TRUNCATED && needed <= capacity) {
+            while (available < needed) {
+                byte buffer[18];
+                byte size = sizeof(buffer);
+                if (rfRead(mfrc522, page, buffer, &size) != MFRC522::STATUS_OK) break;
+                stats.extraReads++;
+                size_t chunk = min((size_t)16, capacity - available);
+                memcpy(area + available, buffer, chunk);
+                available += chunk;
+                page += 4;
+            }
+            if (available < needed) break;
+            status = ndefFindMessage(area, available, &message, &messageLength, &needed);
+        }
+    }
+    appendArea(status, "NDEF Type 2", message, messageLength, needed);
+}
+
+// === MIFARE Classic ===
+static void setKey(MFRC522::MIFARE_Key &key, const byte *bytes) {
+    memcpy(key.keyByte, bytes, MFRC522::MF_KEY_SIZE);
+}
+
+// Clé publique : hors du cache de sector_access, qui suppose FF..FF
+static bool authenticate(uint8_t sector, const byte *keyBytes) {
+    MFRC522::MIFARE_Key key;
+    setKey(key, keyBytes);
+    byte trailer = accessFirstBlock(sector) + accessBlocksInSector(sector) - 1;
+    if (mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, trailer, &key, &(mfrc522.uid)) ==
+        MFRC522::STATUS_OK) {
+        return true;
+    }
+    accessReselect(mfrc522);
+    return false;
+}
+
+static bool openSector(uint8_t sector, bool publicKeys) {
+    if (publicKeys) return authenticate(sector, sector == 0 ? madKey : ndefKey);
+    MFRC522::MIFARE_Key key;
+    setKey(key, transportKey);
+    return accessOpenSector(mfrc522, key, sector);
+}
+
+static bool readBlock(byte blockAddr, byte *out16) {
+    byte buffer[18];
+    byte size = sizeof(buffer);
+    if (rfRead(mfrc522, blockAddr, buffer, &size) != MFRC522::STATUS_OK) return false;
+    memcpy(out16, buffer, 16);
+    return true;
+}
+
+// Blocs 1 et 2 du secteur 0 : clé de transport (refus gardé en cache), sinon
+// clé publique du MAD
+static bool loadMad(byte *mad, bool &publicKeys) {
+    publicKeys = false;
+    if (!openSector(0, false)) {
+        publicKeys = true;
+        if (!openSector(0, true)) return false;
+    }
+    stats.extraReads += 2;
+    return readBlock(1, mad) && readBlock(2, mad + 16);
+}
+
+void appendClassicNdef() {
+    byte mad[32];
+    bool publicKeys;
+    if (!loadMad(mad, publicKeys)) return;
+    uint16_t sectors = ndefMadSectors(mad);
+    if (!sectors) return;   // pas de MAD ou aucun secteur NDEF
+    size_t available = 0;
+    size_t needed = 1;
+    const byte *message = nullptr;
+    size_t messageLength = 0;
+    NdefStatus status = NDEF_TRUNCATED;
+    for (uint8_t sector = 1; sector < NDEF_MAD_SECTORS && status == NDEF_TRUNCATED; sector++) {
+        if (!(sectors & (1 << sector))) continue;
+        if (available + SECTOR_DATA_SIZE > sizeof(area) || !openSector(sector, publicKeys)) break;
+        // Blocs de données mis bout à bout, arrêt dès la fin du TLV
+        for (byte block = 0; block < 3 && status == NDEF_TRUNCATED; block++) {
+            if (!readBlock(accessFirstBlock(sector) + block, area + available)) break;
+            stats.extraReads++;
+            available += 16;
+            if (available >= needed) status = ndefFindMessage(area, available, &message, &messageLength, &needed);
+        }
+    }
+    appendArea(status, "NDEF (MAD)", message, messageLength, needed);
+}
+
+// === Écriture ===
+bool ndefPrepareWrite(NdefKind kind, const char *value, const char *lang) {
+    size_t length = ndefEncode(kind, value, lang, pending, sizeof(pending));
+    if (!length) return false;
+    pendingLength = length;
+    return true;
+}
+
+void ndefCancelWrite() {
+    pendingLength = 0;
+}
+
+bool ndefWritePending() {
+    return pendingLength > 0;
+}
+
+static bool writePage(byte page, byte *data4) {
+    unsigned long start = micros();
+    MFRC522::StatusCode status = mfrc522.MIFARE_Ultralight_Write(page, data4, 4);
+    rfRecord(RF_WRITE, status == MFRC522::STATUS_OK, micros() - start);
+    return status == MFRC522::STATUS_OK;
+}
+
+static bool writeType2() {
+    byte cc[18];
+    byte size = sizeof(cc);
+    if (rfRead(mfrc522, TYPE2_CC_PAGE, cc, &size) != MFRC522::STATUS_OK) return false;
+    uint16_t capacity = ndefType2Capacity(cc);
+    if (!capacity) {
+        if (cc[0] || cc[1] || cc[2] || cc[3]) {
+            serialLog().println("NDEF : Capability Container inconnu");
+            return false;
+        }
+        // Ultralight vierge : CC en OTP, écrit une fois pour toutes
+        byte blank[4] = {NDEF_CC_MAGIC, 0x10, TYPE2_BLANK_SIZE, 0x00};
+        if (!writePage(TYPE2_CC_PAGE, blank)) return false;
+        stats.formatted++;
+        capacity = TYPE2_BLANK_SIZE * 8;
+    } else if (cc[3] & 0x0F) {
+        serialLog().println("NDEF : carte en lecture seule");
+        return false;
+    }
+    if (pendingLength > capacity) {
+        serialLog().printf("NDEF : %u octets pour %u disponibles\n", (unsigned)pendingLength, capacity);
+        return false;
+    }
+    for (size_t offset = 0; offset < pendingLength; offset += 4) {
+        byte page[4] = {0};
+        memcpy(page, pending + offset, min((size_t)4, pendingLength - offset));
+        if (!writePage(TYPE2_FIRST_PAGE + offset / 4, page)) return false;
+    }
+    // Vérification : une lecture relit quatre pages
+    for (size_t offset = 0; offset < pendingLength; offset += 16) {
+        byte buffer[18];
+        size = sizeof(buffer);
+        if (rfRead(mfrc522, TYPE2_FIRST_PAGE + offset / 4, buffer, &size) != MFRC522::STATUS_OK ||
+            memcmp(buffer, pending + offset, min((size_t)16, pendingLength - offset)) != 0) {
+            serialLog().println("NDEF : vérification échouée");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeVerified(byte blockAddr, byte *data16) {
+    byte check[16];
+    return rfWrite(mfrc522, blockAddr, data16, 16) == MFRC522::STATUS_OK && readBlock(blockAddr, check) &&
+           memcmp(check, data16, 16) == 0;
+}
+
+static bool writeTrailer(uint8_t sector, const byte *keyA, const byte *access) {
+    byte trailer[16];
+    memcpy(trailer, keyA, 6);
+    memcpy(trailer + 6, access, 4);
+    memcpy(trailer + 10, transportKey, 6);
+    byte blockAddr = accessFirstBlock(sector) + 3;
+    return accessAllows(blockAddr, true) && rfWrite(mfrc522, blockAddr, trailer, 16) == MFRC522::STATUS_OK;
+}
+
+static bool writeClassic() {
+    byte mad[32];
+    bool publicKeys;
+    if (!loadMad(mad, publicKeys)) {
+        serialLog().println("NDEF : secteur 0 inaccessible");
+        return false;
+    }
+    uint16_t sectors = ndefMadSectors(mad);
+    bool format = false;
+    if (!sectors) {
+        if (publicKeys) {
+            serialLog().println("NDEF : MAD sans secteur NDEF");
+            return false;
+        }
+        // Carte de transport : secteurs 1 à n réservés au message
+        uint8_t count = (pendingLength + SECTOR_DATA_SIZE - 1) / SECTOR_DATA_SIZE;
+        if (count >= NDEF_MAD_SECTORS) return false;
+        for (uint8_t sector = 1; sector <= count; sector++) sectors |= 1 << sector;
+        format = true;
+    }
+    size_t capacity = 0;
+    for (uint8_t sector = 1; sector < NDEF_MAD_SECTORS; sector++) {
+        if (sectors & (1 << sector)) capacity += SECTOR_DATA_SIZE;
+    }
+    if (pendingLength > capacity) {
+        serialLog().printf("NDEF : %u octets pour %u disponibles\n", (unsigned)pendingLength, (unsigned)capacity);
+        return false;
+    }
+    size_t offset = 0;
+    for (uint8_t sector = 1; sector < NDEF_MAD_SECTORS && offset < pendingLength; sector++) {
+        if (!(sectors & (1 << sector))) continue;
+        if (!openSector(sector, publicKeys)) return false;
+        for (byte block = 0; block < 3 && offset < pendingLength; block++, offset += 16) {
+            byte data[16] = {0};
+            memcpy(data, pending + offset, min((size_t)16, pendingLength - offset));
+            if (!writeVerified(accessFirstBlock(sector) + block, data)) return false;
+        }
+        if (format && !writeTrailer(sector, ndefKey, ndefAccess)) return false;
+    }
+    if (format) {
+        // MAD en dernier : la carte n'est annoncée NDEF qu'une fois le message en place
+        ndefMadBuild(sectors, mad);
+        bool ok = openSector(0, false) && writeVerified(1, mad) && writeVerified(2, mad + 16) &&
+                  writeTrailer(0, madKey, madAccess);
+        // Clés changées : droits appris pour cet UID périmés
+        accessForget();
+        if (!ok) return false;
+        stats.formatted++;
+    }
+    return true;
+}
+
+bool ndefWriteCard(MFRC522::PICC_Type type) {
+    bool ok;
+    if (type == MFRC522::PICC_TYPE_MIFARE_UL) {
+        ok = writeType2();
+    } else if (type == MFRC522::PICC_TYPE_MIFARE_MINI || type == MFRC522::PICC_TYPE_MIFARE_1K ||
+               type == MFRC522::PICC_TYPE_MIFARE_4K) {
+        ok = writeClassic();
+    } else {
+        serialLog().println("NDEF : type de carte non supporté");
+        ok = false;
+    }
+    if (ok) {
+        stats.writes++;
+        serialLog().printf("Message NDEF écrit (%u octets)\n", (unsigned)pendingLength);
+        cardInfoPrintf("<br/>Message NDEF écrit : %u octets", (unsigned)pendingLength);
+    } else {
+        stats.writeFailures++;
+        cardInfoAppend("<br/>Écriture NDEF échouée");
+    }
+    return ok;
+}
+
+const NdefStats &ndefStats() {
+    return stats;
+}
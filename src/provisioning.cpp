@@ -0,0 +1,622 @@
+/*
+ * Encodage en série : file de contenus, contrôle de carte vierge, journal
+ */
+#include <provisioning.h>
+#include <LittleFS.h>
+#include <scanner.h>
+#include <sector_access.h>
+#include <rf_tuning.h>
+#include <ndef_tag.h>
+#include <serial_link.h>
+
+#define SEEN_MASK     (PROVISION_SEEN_SLOTS - 1)
+#define SEEN_LIMIT    (PROVISION_SEEN_SLOTS * 3 / 4)   // au-delà, sondage linéaire trop long
+#define LINE_MAX      (PROVISION_DATA_MAX + 32)        // ligne CSV : données, guillemets, format
+#define TEXT_(x)      #x
+#define TEXT(x)       TEXT_(x)
+
+static_assert((PROVISION_SEEN_SLOTS & SEEN_MASK) == 0, "PROVISION_SEEN_SLOTS doit être une puissance de 2");
+
+// Entrée de la file : format 'r' (brut), 'u' (NDEF URI) ou 't' (NDEF texte)
+struct Entry {
+    char format;
+    char data[PROVISION_DATA_MAX + 1];
+    size_t length;
+    size_t lineLength;   // octets occupés dans queue.txt, '\n' compris
+};
+
+static ProvisionStats stats;
+static uint32_t queueOffset = 0;      // position de l'entrée stats.next dans queue.txt
+static Entry current;                 // entrée stats.next, lue une fois
+static bool currentLoaded = false;
+static uint32_t seen[PROVISION_SEEN_SLOTS];
+static uint32_t seenCount = 0;
+static unsigned long rateMs[PROVISION_RATE_WINDOW];
+static uint32_t rateCount = 0;
+
+// Lecture tamponnée : LittleFS est lent octet par octet
+struct FileReader {
+    File &file;
+    uint8_t buf[128];
+    size_t length = 0;
+    size_t pos = 0;
+
+    explicit FileReader(File &f) : file(f) {}
+    int next() {
+        if (pos == length) {
+            length = file.read(buf, sizeof(buf));
+            pos = 0;
+            if (!length) return -1;
+        }
+        return buf[pos++];
+    }
+    int peek() {
+        int c = next();
+        if (c >= 0) pos--;
+        return c;
+    }
+};
+
+static void skipSpaces(FileReader &in) {
+    int c;
+    while ((c = in.peek()) == ' ' || c == '\t' || c == '\r' || c == '\n') in.next();
+}
+
+// Ligne terminée par '\n' (ou la fin du fichier), '\r' final retiré ; -1 en
+// fin de fichier, -2 si elle dépasse size - 1 octets
+static int readLine(FileReader &in, char *out, size_t size, size_t *consumed = nullptr) {
+    size_t length = 0;
+    size_t used = 0;
+    int c = in.next();
+    if (c < 0) return -1;
+    bool overflow = false;
+    for (; c >= 0; c = in.next()) {
+        used++;
+        if (c == '\n') break;
+        if (length < size - 1) {
+            out[length++] = c;
+        } else {
+            overflow = true;
+        }
+    }
+    if (length && out[length - 1] == '\r') length--;
+    out[length] = '\0';
+    if (consumed) *consumed = used;
+    return overflow ? -2 : (int)length;
+}
+
+// === UID déjà encodés ===
+// Empreinte FNV-1a de l'UID hexadécimal ; 0 marque une case libre
+static uint32_t uidHash(const char *uid) {
+    uint32_t hash = 2166136261UL;
+    for (; *uid; uid++) {
+        hash ^= (uint8_t)tolower(*uid);
+        hash *= 16777619UL;
+    }
+    return hash ? hash : 1;
+}
+
+static bool seenFind(uint32_t hash, bool insert) {
+    for (uint32_t i = 0; i < PROVISION_SEEN_SLOTS; i++) {
+        uint32_t &slot = seen[(hash + i) & SEEN_MASK];
+        if (slot == hash) return true;
+        if (slot == 0) {
+            if (insert) {
+                if (seenCount >= SEEN_LIMIT) {
+                    serialLog().println("[Provision] Table des UID pleine : doublons non détectés au-delà");
+                } else {
+                    slot = hash;
+                    seenCount++;
+                }
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+// === File et curseur ===
+static char formatCode(const char *name) {
+    while (*name == ' ') name++;
+    size_t length = strlen(name);
+    while (length && name[length - 1] == ' ') length--;
+    if (length == 3 && strncasecmp(name, "raw", 3) == 0) return 'r';
+    if (length == 3 && strncasecmp(name, "uri", 3) == 0) return 'u';
+    if (length == 4 && strncasecmp(name, "text", 4) == 0) return 't';
+    return 0;
+}
+
+static const char *formatName(char code) {
+    return code == 'u' ? "uri" : (code == 't' ? "text" : "raw");
+}
+
+static void saveCursor() {
+    File f = LittleFS.open(PROVISION_CURSOR_PATH, "w");
+    if (!f) return;
+    char line[24];
+    int n = snprintf(line, sizeof(line), "%lu %lu\n", (unsigned long)stats.next, (unsigned long)queueOffset);
+    f.write((const uint8_t *)line, n);
+    f.close();
+}
+
+static bool loadCurrent() {
+    if (currentLoaded) return true;
+    if (stats.next >= stats.queued) return false;
+    File f = LittleFS.open(PROVISION_QUEUE_PATH, "r");
+    if (!f || !f.seek(queueOffset, SeekSet)) return false;
+    FileReader in(f);
+    char line[PROVISION_DATA_MAX + 4];
+    int length = readLine(in, line, sizeof(line), &current.lineLength);
+    f.close();
+    if (length < 3 || line[1] != '\t') {
+        serialLog().println("[Provision] File corrompue");
+        return false;
+    }
+    current.format = line[0];
+    current.length = length - 2;
+    memcpy(current.data, line + 2, current.length + 1);
+    currentLoaded = true;
+    return true;
+}
+
+static void advance() {
+    queueOffset += current.lineLength;
+    stats.next++;
+    currentLoaded = false;
+    saveCursor();
+}
+
+// === Import ===
+// Entrée validée puis ajoutée à la nouvelle file ; message d'erreur sinon
+static const char *addEntry(File &out, const Entry &entry, uint32_t &count) {
+    if (!entry.length) return "données vides";
+    if (count >= PROVISION_QUEUE_MAX) return "file limitée à " TEXT(PROVISION_QUEUE_MAX) " entrées";
+    if (entry.format == 'r') {
+        if (entry.length > WRITE_DATA_MAX) return "plus de " TEXT(WRITE_DATA_MAX) " octets en brut";
+    } else {
+        byte tlv[NDEF_WRITE_MAX];
+        if (!ndefEncode(entry.format == 'u' ? NDEF_KIND_URI : NDEF_KIND_TEXT, entry.data, nullptr, tlv,
+                        sizeof(tlv))) {
+            return "message NDEF trop long";
+        }
+    }
+    out.write((uint8_t)entry.format);
+    out.write((uint8_t)'\t');
+    out.write((const uint8_t *)entry.data, entry.length);
+    out.write((uint8_t)'\n');
+    count++;
+    return nullptr;
+}
+
+// « données[,format] », données entre guillemets ("" pour un guillemet) si
+// elles contiennent une virgule
+static const char *parseCsvLine(const char *line, Entry &entry) {
+    entry.format = 'r';
+    entry.length = 0;
+    const char *formatField = nullptr;
+    const char *p = line;
+    if (*p == '"') {
+        for (p++;; p++) {
+            if (!*p) return "guillemet non fermé";
+            if (*p == '"' && *++p != '"') break;
+            if (entry.length >= PROVISION_DATA_MAX) return "données trop longues";
+            entry.data[entry.length++] = *p;
+        }
+        while (*p == ' ') p++;
+        if (*p == ',') {
+            formatField = p + 1;
+        } else if (*p) {
+            return "texte après les guillemets";
+        }
+    } else {
+        // Dernière virgule suivie d'un format connu : sinon elle fait partie des données
+        const char *comma = strrchr(line, ',');
+        size_t end = strlen(line);
+        if (comma && formatCode(comma + 1)) {
+            formatField = comma + 1;
+            end = comma - line;
+        }
+        if (end > PROVISION_DATA_MAX) return "données trop longues";
+        memcpy(entry.data, line, end);
+        entry.length = end;
+    }
+    entry.data[entry.length] = '\0';
+    for (size_t i = 0; i < entry.length; i++) {
+        if ((uint8_t)entry.data[i] < 0x20) return "caractère de contrôle";
+    }
+    if (formatField && !(entry.format = formatCode(formatField))) return "format inconnu (raw, uri ou text)";
+    return nullptr;
+}
+
+static const char *importCsv(FileReader &in, File &out, uint32_t &count, uint32_t &lineNumber) {
+    char line[LINE_MAX];
+    Entry entry;
+    int length;
+    while ((length = readLine(in, line, sizeof(line))) != -1) {
+        lineNumber++;
+        if (length == -2) return "ligne trop longue";
+        char *start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        char *end = start + strlen(start);
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+        // Lignes vides, commentaires et en-tête « data[,format] » ignorés
+        if (!*start || *start == '#') continue;
+        if (lineNumber == 1 && strncasecmp(start, "data", 4) == 0 && (!start[4] || start[4] == ',')) continue;
+        const char *error = parseCsvLine(start, entry);
+        if (!error) error = addEntry(out, entry, count);
+        if (error) return error;
+    }
+    return nullptr;
+}
+
+static bool appendUtf8(char *out, size_t size, size_t &length, uint32_t cp) {
+    byte bytes = cp < 0x80 ? 1 : (cp < 0x800 ? 2 : 3);
+    if (length + bytes > size - 1) return false;
+    if (bytes == 1) {
+        out[length++] = cp;
+    } else if (bytes == 2) {
+        out[length++] = 0xC0 | (cp >> 6);
+        out[length++] = 0x80 | (cp & 0x3F);
+    } else {
+        out[length++] = 0xE0 | (cp >> 12);
+        out[length++] = 0x80 | ((cp >> 6) & 0x3F);
+        out[length++] = 0x80 | (cp & 0x3F);
+    }
+    return true;
+}
+
+// Chaîne JSON, guillemet ouvrant déjà lu ; les caractères de contrôle
+// (\n, \t...) sont refusés, ils ne tiennent pas sur une ligne de la file
+static const char *jsonString(FileReader &in, char *out, size_t size, size_t &length) {
+    length = 0;
+    for (;;) {
+        int c = in.next();
+        if (c < 0) return "chaîne non terminée";
+        if (c == '"') break;
+        if (c < 0x20) return "caractère de contrôle";
+        if (c == '\\') {
+            c = in.next();
+            if (c == 'u') {
+                uint32_t cp = 0;
+                for (byte i = 0; i < 4; i++) {
+                    int h = in.next();
+                    if (!isxdigit(h)) return "échappement \\u invalide";
+                    cp = (cp << 4) | (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+                }
+                if (cp < 0x20 || (cp >= 0xD800 && cp <= 0xDFFF)) return "caractère non pris en charge";
+                if (!appendUtf8(out, size, length, cp)) return "données trop longues";
+                continue;
+            }
+            if (c != '"' && c != '\\' && c != '/') return "caractère de contrôle";
+        }
+        if (length >= size - 1) return "données trop longues";
+        out[length++] = c;
+    }
+    out[length] = '\0';
+    return nullptr;
+}
+
+// {"data":"...","ndef":"uri"} ; « format » accepté comme synonyme de « ndef »
+static const char *jsonObject(FileReader &in, Entry &entry) {
+    bool hasData = false;
+    char key[8];
+    char value[8];
+    size_t length;
+    skipSpaces(in);
+    if (in.peek() == '}') {
+        in.next();
+        return "objet sans 'data'";
+    }
+    for (;;) {
+        skipSpaces(in);
+        if (in.next() != '"') return "clé attendue";
+        if (jsonString(in, key, sizeof(key), length)) return "clé inconnue";
+        skipSpaces(in);
+        if (in.next() != ':') return "':' attendu";
+        skipSpaces(in);
+        if (in.next() != '"') return "valeur texte attendue";
+        const char *error;
+        if (strcmp(key, "data") == 0) {
+            error = jsonString(in, entry.data, sizeof(entry.data), entry.length);
+            hasData = true;
+        } else if (strcmp(key, "ndef") == 0 || strcmp(key, "format") == 0) {
+            error = jsonString(in, value, sizeof(value), length);
+            if (!error && !(entry.format = formatCode(value))) error = "format inconnu (raw, uri ou text)";
+        } else {
+            error = "clé inconnue";
+        }
+        if (error) return error;
+        skipSpaces(in);
+        int c = in.next();
+        if (c == '}') break;
+        if (c != ',') return "',' ou '}' attendu";
+    }
+    return hasData ? nullptr : "objet sans 'data'";
+}
+
+static const char *importJson(FileReader &in, File &out, uint32_t &count) {
+    Entry entry;
+    in.next();   // '['
+    skipSpaces(in);
+    if (in.peek() == ']') return nullptr;
+    for (;;) {
+        skipSpaces(in);
+        int c = in.next();
+        entry.format = 'r';
+        const char *error;
+        if (c == '"') {
+            error = jsonString(in, entry.data, sizeof(entry.data), entry.length);
+        } else if (c == '{') {
+            error = jsonObject(in, entry);
+        } else {
+            error = "chaîne ou objet attendu";
+        }
+        if (!error) error = addEntry(out, entry, count);
+        if (error) return error;
+        skipSpaces(in);
+        c = in.next();
+        if (c == ']') return nullptr;
+        if (c != ',') return "',' ou ']' attendu";
+    }
+}
+
+uint32_t provisionImport(const char *path, String &error) {
+    File in = LittleFS.open(path, "r");
+    if (!in) {
+        error = "Fichier absent";
+        return 0;
+    }
+    File out = LittleFS.open(PROVISION_NEW_PATH, "w");
+    if (!out) {
+        in.close();
+        error = "Écriture impossible";
+        return 0;
+    }
+    FileReader reader(in);
+    // BOM UTF-8 éventuel (tableurs), puis JSON si le fichier commence par '['
+    if (reader.peek() == 0xEF) {
+        for (byte i = 0; i < 3; i++) reader.next();
+    }
+    skipSpaces(reader);
+    uint32_t count = 0;
+    uint32_t lineNumber = 0;
+    bool json = reader.peek() == '[';
+    const char *message = json ? importJson(reader, out, count) : importCsv(reader, out, count, lineNumber);
+    out.close();
+    in.close();
+    LittleFS.remove(path);
+    if (!message && count == 0) message = "aucune entrée";
+    if (message) {
+        LittleFS.remove(PROVISION_NEW_PATH);
+        error = json ? "Entrée " + String(count + 1) : "Ligne " + String(lineNumber);
+        error += " : ";
+        error += message;
+        return 0;
+    }
+    // Nouvelle file : le journal et les UID déjà encodés sont conservés
+    LittleFS.remove(PROVISION_QUEUE_PATH);
+    LittleFS.rename(PROVISION_NEW_PATH, PROVISION_QUEUE_PATH);
+    stats.queued = count;
+    stats.next = 0;
+    queueOffset = 0;
+    currentLoaded = false;
+    saveCursor();
+    serialLog().printf("[Provision] File chargée : %lu entrées\n", (unsigned long)count);
+    return count;
+}
+
+// === Démarrage ===
+void provisioningBegin() {
+    LittleFS.mkdir(PROVISION_DIR);
+    memset(&stats, 0, sizeof(stats));
+    queueOffset = 0;
+    currentLoaded = false;
+    char line[LINE_MAX];
+    File f = LittleFS.open(PROVISION_QUEUE_PATH, "r");
+    if (f) {
+        FileReader in(f);
+        while (readLine(in, line, sizeof(line)) != -1) stats.queued++;
+        f.close();
+    }
+    f = LittleFS.open(PROVISION_CURSOR_PATH, "r");
+    if (f) {
+        FileReader in(f);
+        unsigned long next = 0;
+        unsigned long offset = 0;
+        if (readLine(in, line, sizeof(line)) > 0 && sscanf(line, "%lu %lu", &next, &offset) == 2 &&
+            next <= stats.queued) {
+            stats.next = next;
+            queueOffset = offset;
+        }
+        f.close();
+    }
+    // UID du journal (premier champ) : la protection contre les doublons survit au redémarrage
+    memset(seen, 0, sizeof(seen));
+    seenCount = 0;
+    f = LittleFS.open(PROVISION_LOG_PATH, "r");
+    if (f) {
+        FileReader in(f);
+        while (readLine(in, line, sizeof(line)) != -1) {
+            char *separator = strchr(line, ';');
+            if (!separator) continue;
+            *separator = '\0';
+            seenFind(uidHash(line), true);
+        }
+        f.close();
+    }
+    if (stats.queued) {
+        serialLog().printf("[Provision] File : %lu/%lu entrées écrites, %lu UID connus\n", (unsigned long)stats.next,
+                           (unsigned long)stats.queued, (unsigned long)seenCount);
+    }
+}
+
+// === Encodage d'une carte ===
+static bool allZero(const byte *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i]) return false;
+    }
+    return true;
+}
+
+// Vierge : pages 4 à 15 nulles ou simple TLV NDEF vide (NTAG neuve) ; Classic
+// en configuration de transport, sans secteur NDEF au MAD et secteur 1 nul
+static bool cardBlank(MFRC522::PICC_Type type) {
+    byte buffer[18];
+    byte size;
+    if (type == MFRC522::PICC_TYPE_MIFARE_UL) {
+        byte area[48];
+        for (byte i = 0; i < 3; i++) {
+            size = sizeof(buffer);
+            if (rfRead(mfrc522, 4 + i * 4, buffer, &size) != MFRC522::STATUS_OK) return false;
+            memcpy(area + i * 16, buffer, 16);
+        }
+        if (allZero(area, sizeof(area))) return true;
+        const byte *message = nullptr;
+        size_t messageLength = 1;
+        size_t needed;
+        return ndefFindMessage(area, sizeof(area), &message, &messageLength, &needed) == NDEF_OK &&
+               messageLength == 0;
+    }
+    if (type != MFRC522::PICC_TYPE_MIFARE_MINI && type != MFRC522::PICC_TYPE_MIFARE_1K &&
+        type != MFRC522::PICC_TYPE_MIFARE_4K) {
+        return false;
+    }
+    for (byte k = 0; k < 6; k++) key.keyByte[k] = 0xFF;
+    // Clé de transport refusée au secteur 0 : carte déjà formatée
+    byte mad[32];
+    if (!accessOpenSector(mfrc522, key, 0)) return false;
+    for (byte block = 1; block <= 2; block++) {
+        size = sizeof(buffer);
+        if (rfRead(mfrc522, block, buffer, &size) != MFRC522::STATUS_OK) return false;
+        memcpy(mad + (block - 1) * 16, buffer, 16);
+    }
+    if (ndefMadSectors(mad)) return false;
+    if (!accessOpenSector(mfrc522, key, 1)) return false;
+    for (byte block = 4; block < 7; block++) {
+        size = sizeof(buffer);
+        if (rfRead(mfrc522, block, buffer, &size) != MFRC522::STATUS_OK || !allZero(buffer, 16)) return false;
+    }
+    return true;
+}
+
+static void appendLog(const char *uid) {
+    File log = LittleFS.open(PROVISION_LOG_PATH, "a");
+    if (!log) return;
+    char prefix[UID_HEX_MAX + 24];
+    int n = snprintf(prefix, sizeof(prefix), "%s;%lu;%s;", uid, (unsigned long)stats.next + 1,
+                     formatName(current.format));
+    log.write((const uint8_t *)prefix, n);
+    log.write((const uint8_t *)current.data, current.length);
+    log.write((uint8_t)'\n');
+    log.close();
+}
+
+static ProvisionResult encode(MFRC522::PICC_Type type, const char *uid) {
+    uint32_t hash = uidHash(uid);
+    if (seenFind(hash, false)) {
+        cardInfoAppend("<b>Encodage :</b> carte déjà encodée, ignorée<br/>");
+        return PROVISION_DUPLICATE;
+    }
+    if (!loadCurrent()) {
+        cardInfoAppend("<b>Encodage :</b> file épuisée<br/>");
+        return PROVISION_EMPTY;
+    }
+    if (!cardBlank(type)) {
+        // L'entrée reste en tête de file pour la carte suivante
+        cardInfoAppend("<b>Encodage :</b> carte non vierge, ignorée<br/>");
+        return PROVISION_NOT_BLANK;
+    }
+    bool ok;
+    if (current.format == 'r') {
+        ok = writePayload(type, (const byte *)current.data, current.length);
+    } else {
+        ok = ndefPrepareWrite(current.format == 'u' ? NDEF_KIND_URI : NDEF_KIND_TEXT, current.data, nullptr) &&
+             ndefWriteCard(type);
+        ndefCancelWrite();
+    }
+    if (!ok) {
+        cardInfoPrintf("<b>Encodage :</b> entrée %lu échouée<br/>", (unsigned long)stats.next + 1);
+        return PROVISION_FAILED;
+    }
+    appendLog(uid);
+    seenFind(hash, true);
+    cardInfoPrintf("<b>Encodage :</b> entrée %lu/%lu écrite et vérifiée<br/>", (unsigned long)stats.next + 1,
+                   (unsigned long)stats.queued);
+    advance();
+    rateMs[rateCount++ % PROVISION_RATE_WINDOW] = millis();
+    return PROVISION_WRITTEN;
+}
+
+ProvisionResult provisionCard(MFRC522::PICC_Type type, const char *uid) {
+    unsigned long start = micros();
+    ProvisionResult result = encode(type, uid);
+    stats.lastUs = micros() - start;
+    switch (result) {
+    case PROVISION_WRITTEN: stats.written++; break;
+    case PROVISION_DUPLICATE: stats.duplicates++; break;
+    case PROVISION_NOT_BLANK: stats.notBlank++; break;
+    case PROVISION_FAILED: stats.failures++; break;
+    default: break;
+    }
+    serialLog().printf("[Provision] %s : %s (%lu us)\n", uid, provisionResultName(result), (unsigned long)stats.lastUs);
+    return result;
+}
+
+void provisionReset() {
+    LittleFS.remove(PROVISION_QUEUE_PATH);
+    LittleFS.remove(PROVISION_CURSOR_PATH);
+    LittleFS.remove(PROVISION_LOG_PATH);
+    memset(&stats, 0, sizeof(stats));
+    memset(seen, 0, sizeof(seen));
+    seenCount = 0;
+    queueOffset = 0;
+    currentLoaded = false;
+    rateCount = 0;
+}
+
+uint32_t provisionCardsPerHour() {
+    uint32_t n = min(rateCount, (uint32_t)PROVISION_RATE_WINDOW);
+    if (n < 2) return 0;
+    unsigned long span = rateMs[(rateCount - 1) % PROVISION_RATE_WINDOW] -
+                         rateMs[(rateCount - n) % PROVISION_RATE_WINDOW];
+    return span ? (uint32_t)((n - 1) * 3600000ULL / span) : 0;
+}
+
+const ProvisionStats &provisionStats() {
+    return stats;
+}
+
+String provisionStatusJson() {
+    String json;
+    json.reserve(192);
+    json = "{\"queued\":";
+    json += stats.queued;
+    json += ",\"next\":";
+    json += stats.next;
+    json += ",\"written\":";
+    json += stats.written;
+    json += ",\"failures\":";
+    json += stats.failures;
+    json += ",\"duplicates\":";
+    json += stats.duplicates;
+    json += ",\"notBlank\":";
+    json += stats.notBlank;
+    json += ",\"perHour\":";
+    json += provisionCardsPerHour();
+    json += ",\"known\":";
+    json += seenCount;
+    json += ",\"lastUs\":";
+    json += stats.lastUs;
+    json += "}";
+    return json;
+}
+
+const char *provisionResultName(ProvisionResult result) {
+    switch (result) {
+    case PROVISION_WRITTEN: return "written";
+    case PROVISION_DUPLICATE: return "duplicate";
+    case PROVISION_NOT_BLANK: return "not-blank";
+    case PROVISION_FAILED: return "failed";
+    default: return "empty";
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * Surveillance du RC522 : sonde périodique des registres et reprise
+ */
+#include <rc522_health.h>
+#include <config.h>
+#include <scanner.h>
+#include <rf_tuning.h>
+#include <serial_link.h>
+
+// Valeurs écrites par PCD_Init() (MFRC522 1.4.x) ; le gain et le timer
+// appartiennent à rf_tuning.cpp et ne sont pas comparés
+struct ExpectedRegister {
+    MFRC522::PCD_Register reg;
+    byte value;
+};
+
+static const ExpectedRegister expectedRegisters[] = {
+    {MFRC522::TModeReg, 0x80},
+    {MFRC522::TPrescalerReg, 0xA9},
+    {MFRC522::TxASKReg, 0x40},
+    {MFRC522::ModeReg, 0x3D},
+};
+
+static const char *const faultNames[RC522_FAULT_COUNT] = {"aucun", "spi", "version", "registres", "antenne"};
+
+static Rc522HealthStats stats;
+static unsigned long lastProbeMs = 0;
+static unsigned long faultStartUs = 0;   // détection du défaut en cours
+static bool recovering = false;
+static uint8_t attempts = 0;             // tentatives de reprise du défaut en cours
+
+static Rc522Fault probe() {
+    byte version = mfrc522.PCD_ReadRegister(MFRC522::VersionReg);
+    if (version == 0x00 || version == 0xFF) return RC522_FAULT_SPI;
+    // Module absent au démarrage : la première version lue fait référence
+    if (stats.version == 0) stats.version = version;
+    if (version != stats.version) return RC522_FAULT_VERSION;
+    for (const ExpectedRegister &expected : expectedRegisters) {
+        if (mfrc522.PCD_ReadRegister(expected.reg) != expected.value) return RC522_FAULT_REGISTERS;
+    }
+    if ((mfrc522.PCD_ReadRegister(MFRC522::TxControlReg) & 0x03) != 0x03) return RC522_FAULT_ANTENNA;
+    return RC522_FAULT_NONE;
+}
+
+// Reprise graduée selon le défaut ; une puce muette passe par RST_PIN
+// (PCD_Init() fait alors une mise sous tension complète)
+static void recover(Rc522Fault fault) {
+    if (fault == RC522_FAULT_ANTENNA) {
+        mfrc522.PCD_AntennaOn();
+        return;
+    }
+    if (fault == RC522_FAULT_SPI || fault == RC522_FAULT_VERSION || attempts > 0) {
+        stats.hardResets++;
+        pinMode(RST_PIN, OUTPUT);
+        digitalWrite(RST_PIN, LOW);
+        delayMicroseconds(2);
+    }
+    mfrc522.PCD_Init();
+    mfrc522.PCD_AntennaOn();
+    rfTuningBegin();
+}
+
+static void recordFault(Rc522Fault fault) {
+    stats.healthy = false;
+    stats.faults++;
+    stats.lastFault = fault;
+    stats.lastFaultMs = millis();
+    if (stats.lastFaultMs == 0) stats.lastFaultMs = 1;
+    faultStartUs = micros();
+    recovering = true;
+    attempts = 0;
+    serialLog().printf("[RC522] Défaut %s, reprise\n", faultNames[fault]);
+}
+
+bool rc522HealthCheck() {
+    lastProbeMs = millis();
+    stats.probes++;
+    Rc522Fault fault = probe();
+    if (fault == RC522_FAULT_NONE) {
+        stats.healthy = true;
+        return true;
+    }
+    if (!recovering) recordFault(fault);
+    recover(fault);
+    attempts++;
+    if (probe() != RC522_FAULT_NONE) {
+        stats.failedRecoveries++;
+        return false;
+    }
+    uint32_t us = micros() - faultStartUs;
+    recovering = false;
+    stats.healthy = true;
+    stats.recoveries++;
+    stats.lastRecoveryUs = us;
+    if (us > stats.maxRecoveryUs) stats.maxRecoveryUs = us;
+    serialLog().printf("[RC522] Repris en %lu us\n", (unsigned long)us);
+    return true;
+}
+
+void rc522HealthBegin() {
+    stats.healthy = probe() == RC522_FAULT_NONE;
+    lastProbeMs = millis();
+    if (!stats.healthy) serialLog().println("[RC522] Module absent ou mal initialisé, reprise périodique");
+}
+
+void rc522HealthLoop() {
+    unsigned long interval = stats.healthy ? RC522_HEALTH_INTERVAL_MS : RC522_HEALTH_RETRY_MS;
+    if (millis() - lastProbeMs < interval) return;
+    rc522HealthCheck();
+}
+
+const Rc522HealthStats &rc522HealthStats() {
+    return stats;
+}
+
+const char *rc522FaultName(Rc522Fault fault) {
+    return fault < RC522_FAULT_COUNT ? faultNames[fault] : "?";
+}
@@ -0,0 +1,458 @@
+/*
+ * Profils de lecture : définitions sur LittleFS, lecture ciblée et extraction
+ */
+#include <LittleFS.h>
+#include <read_profile.h>
+#include <scanner.h>
+#include <settings.h>
+#include <hex_util.h>
+#include <sector_access.h>
+#include <rf_tuning.h>
+#include <serial_link.h>
+
+#define READ_PROFILES_TMP "/config/profiles.tmp"
+
+static ReadProfile profiles[READ_PROFILE_MAX];
+static uint8_t profileCount = 0;
+// Analyse dans un tableau séparé : une définition invalide ne remplace rien
+static ReadProfile parsed[READ_PROFILE_MAX];
+
+static const char *const encodingNames[] = {"hex", "ascii", "bcd", "u16be", "u16le", "u32be", "u32le"};
+static const char *const memoryNames[] = {"full", "classic", "ultralight"};
+
+static void fullProfile(ReadProfile &p) {
+    memset(&p, 0, sizeof(p));
+    strcpy(p.name, "full");
+    p.memory = PROFILE_FULL;
+}
+
+// === Analyse des définitions ===
+static bool parseNumber(const char *&p, uint16_t max, uint16_t &out) {
+    if (*p < '0' || *p > '9') return false;
+    uint32_t n = 0;
+    while (*p >= '0' && *p <= '9') {
+        n = n * 10 + (*p++ - '0');
+        if (n > max) return false;
+    }
+    out = n;
+    return true;
+}
+
+// Premier bloc de données et nombre de blocs de données d'un secteur Classic
+static void sectorBlocks(uint16_t sector, uint8_t &first, uint8_t &count) {
+    if (sector < 32) {
+        first = sector * 4;
+        count = 3;
+    } else {
+        first = 128 + (sector - 32) * 16;
+        count = 15;
+    }
+}
+
+static bool isTrailer(uint16_t block) {
+    return block < 128 ? (block % 4) == 3 : ((block - 128) % 16) == 15;
+}
+
+static bool addUnit(ReadProfile &p, uint16_t unit) {
+    if (p.unitCount >= READ_PROFILE_UNITS_MAX) return false;
+    p.units[p.unitCount++] = unit;
+    return true;
+}
+
+static bool parseZones(const char *p, ReadProfile &profile) {
+    while (*p) {
+        char kind = *p++;
+        uint16_t n, last;
+        if (!parseNumber(p, 255, n)) return false;
+        ReadProfileMemory memory = kind == 'P' ? PROFILE_ULTRALIGHT : PROFILE_CLASSIC;
+        if (kind != 'B' && kind != 'S' && kind != 'P') return false;
+        if (profile.unitCount && profile.memory != memory) return false;
+        profile.memory = memory;
+        if (kind == 'B') {
+            // Les blocs de secteur (clés, bits d'accès) ne sont jamais lus
+            if (isTrailer(n) || !addUnit(profile, n)) return false;
+        } else if (kind == 'S') {
+            uint8_t first, count;
+            if (n >= 40) return false;
+            sectorBlocks(n, first, count);
+            for (uint8_t i = 0; i < count; i++) {
+                if (!addUnit(profile, first + i)) return false;
+            }
+        } else {
+            last = n;
+            if (p[0] == '-' && p[1] == 'P') {
+                p += 2;
+                if (!parseNumber(p, 255, last) || last < n) return false;
+            }
+            for (uint16_t page = n; page <= last; page++) {
+                if (!addUnit(profile, page)) return false;
+            }
+        }
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return profile.unitCount > 0;
+}
+
+static bool parseField(const char *p, ReadProfile &profile) {
+    if (profile.fieldCount >= READ_PROFILE_FIELDS_MAX) return false;
+    ReadField &field = profile.fields[profile.fieldCount];
+    memset(&field, 0, sizeof(field));
+    size_t len = 0;
+    while (*p && *p != '=') {
+        if (len >= READ_FIELD_NAME_MAXLEN || !(isalnum((unsigned char)*p) || *p == '_' || *p == '-')) return false;
+        field.name[len++] = *p++;
+    }
+    if (len == 0 || *p++ != '=') return false;
+    char kind = *p++;
+    if (kind != (profile.memory == PROFILE_ULTRALIGHT ? 'P' : 'B')) return false;
+    uint16_t unit, offset, length;
+    if (!parseNumber(p, 255, unit) || *p++ != '+' || !parseNumber(p, 255, offset) || *p++ != '/' ||
+        !parseNumber(p, 255, length) || *p++ != '/' || length == 0) {
+        return false;
+    }
+    uint8_t unitSize = profile.memory == PROFILE_ULTRALIGHT ? 4 : 16;
+    int index = -1;
+    for (uint8_t i = 0; i < profile.unitCount && index < 0; i++) {
+        if (profile.units[i] == unit) index = i;
+    }
+    if (index < 0) return false;
+    uint16_t start = index * unitSize + offset;
+    if (start + length > profile.unitCount * unitSize) return false;
+    int encoding = -1;
+    for (uint8_t e = 0; e < sizeof(encodingNames) / sizeof(encodingNames[0]); e++) {
+        if (strcmp(p, encodingNames[e]) == 0) encoding = e;
+    }
+    if (encoding < 0) return false;
+    // La valeur affichée doit tenir dans READ_FIELD_VALUE_MAXLEN caractères
+    uint16_t maxLength = encoding == ENC_ASCII ? READ_FIELD_VALUE_MAXLEN : READ_FIELD_VALUE_MAXLEN / 2;
+    if (encoding == ENC_U16BE || encoding == ENC_U16LE) maxLength = 2;
+    if (encoding == ENC_U32BE || encoding == ENC_U32LE) maxLength = 4;
+    if (length > maxLength || ((encoding >= ENC_U16BE) && length != maxLength)) return false;
+    field.offset = start;
+    field.length = length;
+    field.encoding = (FieldEncoding)encoding;
+    profile.fieldCount++;
+    return true;
+}
+
+static bool parseLine(String line, ReadProfile &profile) {
+    memset(&profile, 0, sizeof(profile));
+    int bar1 = line.indexOf('|');
+    int bar2 = bar1 < 0 ? -1 : line.indexOf('|', bar1 + 1);
+    if (bar2 < 0) return false;
+    String name = line.substring(0, bar1);
+    String zones = line.substring(bar1 + 1, bar2);
+    String fields = line.substring(bar2 + 1);
+    name.trim();
+    zones.trim();
+    zones.toUpperCase();
+    if (name.length() == 0 || name.length() > READ_PROFILE_NAME_MAXLEN || name == "full") return false;
+    strcpy(profile.name, name.c_str());
+    if (!parseZones(zones.c_str(), profile)) return false;
+    int from = 0;
+    while (from < (int)fields.length()) {
+        int comma = fields.indexOf(',', from);
+        String field = fields.substring(from, comma < 0 ? fields.length() : comma);
+        field.trim();
+        if (field.length() && !parseField(field.c_str(), profile)) return false;
+        if (comma < 0) break;
+        from = comma + 1;
+    }
+    return true;
+}
+
+// Analyse le texte complet dans parsed[] ; renvoie le nombre de profils, ou -1
+static int parseText(const String &text, String &error) {
+    fullProfile(parsed[0]);
+    uint8_t count = 1;
+    int from = 0;
+    int lineNumber = 0;
+    while (from < (int)text.length()) {
+        int eol = text.indexOf('\n', from);
+        String line = text.substring(from, eol < 0 ? text.length() : eol);
+        from = eol < 0 ? text.length() : eol + 1;
+        lineNumber++;
+        line.trim();
+        if (line.length() == 0 || line[0] == '#') continue;
+        bool duplicate = false;
+        if (count < READ_PROFILE_MAX && parseLine(line, parsed[count])) {
+            for (uint8_t i = 0; i < count; i++) {
+                if (strcmp(parsed[i].name, parsed[count].name) == 0) duplicate = true;
+            }
+            if (!duplicate) {
+                count++;
+                continue;
+            }
+        }
+        error = String("Ligne ") + lineNumber + " : " + line;
+        return -1;
+    }
+    return count;
+}
+
+// Les compteurs d'un profil conservé sous le même nom sont repris
+static void adoptParsed(uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        const ReadProfile *previous = readProfileFind(parsed[i].name);
+        if (!previous) continue;
+        parsed[i].reads = previous->reads;
+        parsed[i].failures = previous->failures;
+        parsed[i].lastUs = previous->lastUs;
+        parsed[i].maxUs = previous->maxUs;
+        parsed[i].readTime = previous->readTime;
+    }
+    memcpy(profiles, parsed, sizeof(ReadProfile) * count);
+    profileCount = count;
+}
+
+bool readProfilesBegin() {
+    fullProfile(profiles[0]);
+    profileCount = 1;
+    String text = readProfilesText();
+    String error;
+    int count = parseText(text, error);
+    if (count < 0) {
+        serialLog().printf("[PROFIL] Définitions ignorées : %s\n", error.c_str());
+        return false;
+    }
+    adoptParsed(count);
+    serialLog().printf("[PROFIL] %u profils, actif : %s\n", (unsigned)profileCount, readProfileActive()->name);
+    return true;
+}
+
+bool readProfilesSave(const String &text, String &error) {
+    int count = parseText(text, error);
+    if (count < 0) return false;
+    File f = LittleFS.open(READ_PROFILES_TMP, "w");
+    if (!f) {
+        error = "Écriture impossible";
+        return false;
+    }
+    bool ok = f.print(text) == text.length();
+    f.close();
+    if (!ok || !LittleFS.rename(READ_PROFILES_TMP, READ_PROFILES_PATH)) {
+        LittleFS.remove(READ_PROFILES_TMP);
+        error = "Écriture impossible";
+        return false;
+    }
+    adoptParsed(count);
+    return true;
+}
+
+String readProfilesText() {
+    File f = LittleFS.open(READ_PROFILES_PATH, "r");
+    if (!f) return String();
+    String text = f.readString();
+    f.close();
+    return text;
+}
+
+uint8_t readProfileCount() {
+    return profileCount;
+}
+
+const ReadProfile *readProfileAt(uint8_t index) {
+    return index < profileCount ? &profiles[index] : nullptr;
+}
+
+const ReadProfile *readProfileFind(const char *name) {
+    for (uint8_t i = 0; i < profileCount; i++) {
+        if (strcmp(profiles[i].name, name) == 0) return &profiles[i];
+    }
+    return nullptr;
+}
+
+// Profil inconnu (définitions modifiées depuis) : vidage complet
+ReadProfile *readProfileActive() {
+    for (uint8_t i = 1; i < profileCount; i++) {
+        if (readProfileName == profiles[i].name) return &profiles[i];
+    }
+    return &profiles[0];
+}
+
+// === Lecture ciblée ===
+static bool readClassicUnits(const ReadProfile &p, byte *data) {
+    bool ok = true;
+    int openSector = -1;
+    bool sectorOk = false;
+    for (uint8_t i = 0; i < p.unitCount; i++) {
+        byte block = p.units[i];
+        uint8_t sector = accessSectorOf(block);
+        if (sector != openSector) {
+            // Une authentification par secteur, pas par bloc
+            for (byte k = 0; k < 6; k++) key.keyByte[k] = 0xFF;
+            openSector = sector;
+            sectorOk = accessOpenSector(mfrc522, key, sector);
+        }
+        byte buffer[18];
+        byte size = sizeof(buffer);
+        if (sectorOk && accessAllows(block, false) &&
+            rfRead(mfrc522, block, buffer, &size) == MFRC522::STATUS_OK) {
+            memcpy(data + i * 16, buffer, 16);
+        } else {
+            memset(data + i * 16, 0, 16);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool readUltralightUnits(const ReadProfile &p, byte *data) {
+    bool ok = true;
+    int cachedFirst = -1;
+    byte cache[18];
+    for (uint8_t i = 0; i < p.unitCount; i++) {
+        byte page = p.units[i];
+        // READ renvoie 4 pages : les pages voisines ne coûtent pas de commande
+        if (cachedFirst < 0 || page < cachedFirst || page >= cachedFirst + 4) {
+            byte size = sizeof(cache);
+            if (rfRead(mfrc522, page, cache, &size) == MFRC522::STATUS_OK) {
+                cachedFirst = page;
+            } else {
+                cachedFirst = -1;
+                memset(data + i * 4, 0, 4);
+                ok = false;
+                continue;
+            }
+        }
+        memcpy(data + i * 4, cache + (page - cachedFirst) * 4, 4);
+    }
+    return ok;
+}
+
+static void encodeField(const ReadField &field, const byte *data, char *out) {
+    const byte *b = data + field.offset;
+    switch (field.encoding) {
+    case ENC_HEX:
+        hexEncode(b, field.length, out);
+        break;
+    case ENC_BCD: {
+        // Chiffres décimaux codés par quartet ; un quartet > 9 termine la valeur
+        char *o = out;
+        for (uint8_t i = 0; i < field.length; i++) {
+            byte hi = b[i] >> 4, lo = b[i] & 0x0F;
+            if (hi > 9) break;
+            *o++ = '0' + hi;
+            if (lo > 9) break;
+            *o++ = '0' + lo;
+        }
+        *o = '\0';
+        break;
+    }
+    case ENC_ASCII: {
+        // Arrêt au premier octet nul (bourrage), caractères HTML neutralisés
+        uint8_t i = 0;
+        for (; i < field.length && b[i]; i++) {
+            char c = b[i];
+            out[i] = (c >= 32 && c <= 126 && c != '<' && c != '>' && c != '&' && c != '"') ? c : '.';
+        }
+        out[i] = '\0';
+        break;
+    }
+    case ENC_U16BE:
+        snprintf(out, READ_FIELD_VALUE_MAXLEN + 1, "%u", (unsigned)((b[0] << 8) | b[1]));
+        break;
+    case ENC_U16LE:
+        snprintf(out, READ_FIELD_VALUE_MAXLEN + 1, "%u", (unsigned)((b[1] << 8) | b[0]));
+        break;
+    case ENC_U32BE:
+        snprintf(out, READ_FIELD_VALUE_MAXLEN + 1, "%lu",
+                 (unsigned long)(((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | (b[2] << 8) | b[3]));
+        break;
+    case ENC_U32LE:
+        snprintf(out, READ_FIELD_VALUE_MAXLEN + 1, "%lu",
+                 (unsigned long)(((uint32_t)b[3] << 24) | ((uint32_t)b[2] << 16) | (b[1] << 8) | b[0]));
+        break;
+    }
+}
+
+// "&nom=valeur" encodé pour application/x-www-form-urlencoded ; rien si trop long
+static void appendFormField(char *fields, size_t size, const char *name, const char *value) {
+    size_t len = strlen(fields);
+    size_t needed = 2 + strlen(name);
+    for (const char *v = value; *v; v++) needed += isalnum((unsigned char)*v) ? 1 : 3;
+    if (len + needed >= size) return;
+    char *o = fields + len;
+    *o++ = '&';
+    o = stpcpy(o, name);
+    *o++ = '=';
+    for (const char *v = value; *v; v++) {
+        if (isalnum((unsigned char)*v)) {
+            *o++ = *v;
+        } else {
+            *o++ = '%';
+            *o++ = HEX_UPPER[(uint8_t)*v >> 4];
+            *o++ = HEX_UPPER[*v & 0x0F];
+        }
+    }
+    *o = '\0';
+}
+
+bool readProfileRun(ReadProfile *profile, MFRC522::PICC_Type piccType, char *fields, size_t fieldsSize) {
+    fields[0] = '\0';
+    bool ultralight = piccType == MFRC522::PICC_TYPE_MIFARE_UL;
+    if ((profile->memory == PROFILE_ULTRALIGHT) != ultralight) {
+        cardInfoPrintf("<i>Profil %s non applicable à ce type de carte</i><br/>", profile->name);
+        return false;
+    }
+    unsigned long start = micros();
+    byte data[READ_PROFILE_UNITS_MAX * 16];
+    bool ok = ultralight ? readUltralightUnits(*profile, data) : readClassicUnits(*profile, data);
+    uint32_t elapsed = micros() - start;
+    readProfileRecord(profile, elapsed, ok);
+    serialLog().printf("[PROFIL] %s : %u zones en %lu us%s\n", profile->name, (unsigned)profile->unitCount,
+                       (unsigned long)elapsed, ok ? "" : " (lecture incomplète)");
+    cardInfoPrintf("<b>Profil %s</b> : %u zones, %lu us<br/>", profile->name, (unsigned)profile->unitCount,
+                   (unsigned long)elapsed);
+    for (uint8_t i = 0; i < profile->fieldCount; i++) {
+        const ReadField &field = profile->fields[i];
+        char value[READ_FIELD_VALUE_MAXLEN + 1];
+        encodeField(field, data, value);
+        serialLog().printf("  %s = %s\n", field.name, value);
+        cardInfoPrintf("%s : %s<br/>", field.name, value);
+        appendFormField(fields, fieldsSize, field.name, value);
+    }
+    return ok;
+}
+
+void readProfileRecord(ReadProfile *profile, uint32_t us, bool ok) {
+    profile->reads++;
+    if (!ok) profile->failures++;
+    profile->lastUs = us;
+    if (us > profile->maxUs) profile->maxUs = us;
+    histogramRecord(profile->readTime, us);
+}
+
+String readProfilesJson() {
+    String json;
+    json.reserve(128 + profileCount * 160);
+    json = "{\"active\":\"";
+    json += readProfileActive()->name;
+    json += "\",\"profiles\":[";
+    for (uint8_t i = 0; i < profileCount; i++) {
+        const ReadProfile &p = profiles[i];
+        if (i) json += ",";
+        json += "{\"name\":\"";
+        json += p.name;
+        json += "\",\"memory\":\"";
+        json += memoryNames[p.memory];
+        json += "\",\"units\":";
+        json += p.unitCount;
+        json += ",\"fields\":";
+        json += p.fieldCount;
+        json += ",\"reads\":";
+        json += p.reads;
+        json += ",\"failures\":";
+        json += p.failures;
+        json += ",\"lastUs\":";
+        json += p.lastUs;
+        json += ",\"meanUs\":";
+        json += p.readTime.count ? (uint32_t)(p.readTime.sumUs / p.readTime.count) : 0;
+        json += ",\"maxUs\":";
+        json += p.maxUs;
+        json += "}";
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,319 @@
+/*
+ * Réglage automatique du gain d'antenne et du timer du RC522, calibration
+ */
+#include <rf_tuning.h>
+#include <scanner.h>
+#include <settings.h>
+#include <serial_link.h>
+
+#define RF_GAIN_LEVELS ((RF_GAIN_MAX - RF_GAIN_MIN) / 0x10 + 1)
+
+static const uint8_t gainDb[8] = {18, 23, 18, 23, 33, 38, 43, 48};
+static const char *const opNames[RF_OP_COUNT] = {"select", "auth", "read", "write"};
+
+static RfTuningStats stats;
+// Plus court timer sans hausse des échecs ; relevé à chaque rechute
+static uint16_t timerFloor = RF_TIMER_RELOAD_MIN;
+static bool timerShortened = false;
+
+// === Calibration ===
+struct CalibrationResult {
+    uint8_t successes;
+    uint32_t totalUs;
+};
+
+static bool calibrating = false;
+static bool calibrationClassic = false;
+static uint8_t calGain = 0;     // index dans les niveaux bornés
+static uint8_t calTimer = 0;
+static uint8_t calTrial = 0;
+static CalibrationResult calibration[RF_GAIN_LEVELS][RF_CALIBRATION_TIMERS];
+static bool calibrationDone = false;
+
+static uint16_t calibrationReload(uint8_t index) {
+    return RF_TIMER_RELOAD_MIN + (uint32_t)(RF_TIMER_RELOAD_MAX - RF_TIMER_RELOAD_MIN) * index /
+                                     (RF_CALIBRATION_TIMERS - 1);
+}
+
+static uint8_t levelGain(uint8_t index) {
+    return RF_GAIN_MIN + index * 0x10;
+}
+
+// Prescaler de la bibliothèque (0xA9) : un pas de reload vaut 25 µs
+static uint32_t reloadUs(uint16_t reload) {
+    return (uint32_t)(reload + 1) * 25;
+}
+
+void rfApply(uint8_t gain, uint16_t timerReload) {
+    mfrc522.PCD_SetAntennaGain(gain);
+    mfrc522.PCD_WriteRegister(MFRC522::TReloadRegH, timerReload >> 8);
+    mfrc522.PCD_WriteRegister(MFRC522::TReloadRegL, timerReload & 0xFF);
+}
+
+void rfTuningBegin() {
+    uint8_t gain = constrain(rfGain, RF_GAIN_MIN, RF_GAIN_MAX);
+    uint16_t reload = constrain(rfTimerReload, RF_TIMER_RELOAD_MIN, RF_TIMER_RELOAD_MAX);
+    rfApply(gain, reload);
+    rfGain = gain;
+    rfTimerReload = reload;
+    serialLog().printf("[RF] Gain %u dB, timer %lu us%s\n", gainDb[gain >> 4], (unsigned long)reloadUs(reload),
+                       rfAutoTune ? " (auto)" : "");
+}
+
+void rfRecord(RfOp op, bool ok, uint32_t us) {
+    if (calibrating) return;
+    RfOpStats &s = stats.ops[op];
+    s.attempts++;
+    stats.windowAttempts++;
+    if (ok) {
+        histogramRecord(s.latency, us);
+    } else {
+        s.failures++;
+        stats.windowFailures++;
+    }
+}
+
+MFRC522::StatusCode rfRead(MFRC522 &reader, byte block, byte *buffer, byte *size) {
+    unsigned long start = micros();
+    MFRC522::StatusCode status = reader.MIFARE_Read(block, buffer, size);
+    rfRecord(RF_READ, status == MFRC522::STATUS_OK, micros() - start);
+    return status;
+}
+
+MFRC522::StatusCode rfWrite(MFRC522 &reader, byte block, byte *buffer, byte size) {
+    unsigned long start = micros();
+    MFRC522::StatusCode status = reader.MIFARE_Write(block, buffer, size);
+    rfRecord(RF_WRITE, status == MFRC522::STATUS_OK, micros() - start);
+    return status;
+}
+
+// === Réglage automatique ===
+// Niveau voisin à essayer : jamais essayé d'abord (vers le haut en priorité),
+// sinon celui dont le taux d'échec lissé est le plus bas s'il bat le courant
+static uint8_t nextGain(uint8_t gain) {
+    uint8_t level = gain >> 4;
+    int8_t candidates[2] = {(int8_t)(level + 1), (int8_t)(level - 1)};
+    int8_t best = -1;
+    for (uint8_t i = 0; i < 2; i++) {
+        int8_t c = candidates[i];
+        if (c < (RF_GAIN_MIN >> 4) || c > (RF_GAIN_MAX >> 4)) continue;
+        if (stats.gainWindows[c] == 0) return c << 4;
+        if (best < 0 || stats.gainFailPermille[c] < stats.gainFailPermille[best]) best = c;
+    }
+    if (best >= 0 && stats.gainFailPermille[best] < stats.gainFailPermille[level]) return best << 4;
+    return gain;
+}
+
+static void closeWindow() {
+    uint16_t permille = (uint32_t)stats.windowFailures * 1000 / stats.windowAttempts;
+    stats.windowAttempts = 0;
+    stats.windowFailures = 0;
+    stats.windows++;
+    stats.lastFailPermille = permille;
+    uint8_t level = rfGain >> 4;
+    // Moyenne lissée (1/4) du taux d'échec de ce niveau de gain
+    if (stats.gainWindows[level] == 0) stats.gainFailPermille[level] = permille;
+    else stats.gainFailPermille[level] = (stats.gainFailPermille[level] * 3 + permille) / 4;
+    if (stats.gainWindows[level] < 255) stats.gainWindows[level]++;
+    if (!rfAutoTune) return;
+
+    uint8_t gain = rfGain;
+    uint16_t reload = rfTimerReload;
+    if (permille > RF_FAIL_HIGH_PERMILLE) {
+        if (timerShortened) {
+            // Rechute après un raccourcissement : le timer revient en arrière d'abord
+            reload = min((uint16_t)RF_TIMER_RELOAD_MAX, (uint16_t)(reload + RF_TIMER_STEP * 2));
+            timerFloor = reload;
+        } else {
+            gain = nextGain(gain);
+        }
+        timerShortened = false;
+    } else if (permille == 0 && reload > timerFloor) {
+        // Fenêtre propre : chaque REQA sans carte attendra moins longtemps
+        reload = max(timerFloor, (uint16_t)(reload - RF_TIMER_STEP));
+        timerShortened = true;
+    }
+    if (gain == rfGain && reload == rfTimerReload) return;
+    stats.adjustments++;
+    rfApply(gain, reload);
+    saveRfTuning(gain, reload, rfAutoTune);
+    serialLog().printf("[RF] %u ‰ d'échecs : gain %u dB, timer %lu us\n", permille, gainDb[gain >> 4],
+                       (unsigned long)reloadUs(reload));
+}
+
+// === Calibration ===
+bool rfCalibrating() {
+    return calibrating;
+}
+
+bool rfCalibrationStart() {
+    byte atqa[2];
+    byte atqaSize = sizeof(atqa);
+    rfApply(RF_GAIN_MAX, RF_TIMER_RELOAD_MAX);
+    MFRC522::StatusCode status = mfrc522.PICC_WakeupA(atqa, &atqaSize);
+    bool found = (status == MFRC522::STATUS_OK || status == MFRC522::STATUS_COLLISION) &&
+                 mfrc522.PICC_Select(&mfrc522.uid) == MFRC522::STATUS_OK;
+    if (!found) {
+        rfApply(rfGain, rfTimerReload);
+        serialLog().println("[RF] Calibration : aucune carte de référence");
+        return false;
+    }
+    MFRC522::PICC_Type type = MFRC522::PICC_GetType(mfrc522.uid.sak);
+    calibrationClassic = type == MFRC522::PICC_TYPE_MIFARE_MINI || type == MFRC522::PICC_TYPE_MIFARE_1K ||
+                         type == MFRC522::PICC_TYPE_MIFARE_4K;
+    mfrc522.PICC_HaltA();
+    memset(calibration, 0, sizeof(calibration));
+    calGain = calTimer = calTrial = 0;
+    calibrating = true;
+    calibrationDone = false;
+    serialLog().printf("[RF] Calibration : %u réglages x %u essais\n", RF_GAIN_LEVELS * RF_CALIBRATION_TIMERS,
+                       RF_CALIBRATION_TRIALS);
+    return true;
+}
+
+// Un cycle complet sur la carte de référence : réveil, sélection, lecture, HLTA
+static bool calibrationTrial() {
+    byte atqa[2];
+    byte atqaSize = sizeof(atqa);
+    MFRC522::StatusCode status = mfrc522.PICC_WakeupA(atqa, &atqaSize);
+    bool ok = (status == MFRC522::STATUS_OK || status == MFRC522::STATUS_COLLISION) &&
+              mfrc522.PICC_Select(&mfrc522.uid) == MFRC522::STATUS_OK;
+    if (ok && calibrationClassic) {
+        for (byte k = 0; k < 6; k++) key.keyByte[k] = 0xFF;
+        ok = mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, 7, &key, &(mfrc522.uid)) ==
+             MFRC522::STATUS_OK;
+    }
+    if (ok) {
+        byte buffer[18];
+        byte size = sizeof(buffer);
+        ok = mfrc522.MIFARE_Read(4, buffer, &size) == MFRC522::STATUS_OK;
+    }
+    mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1();
+    return ok;
+}
+
+static void finishCalibration() {
+    uint8_t bestGain = 0, bestTimer = 0;
+    for (uint8_t g = 0; g < RF_GAIN_LEVELS; g++) {
+        for (uint8_t t = 0; t < RF_CALIBRATION_TIMERS; t++) {
+            const CalibrationResult &r = calibration[g][t];
+            const CalibrationResult &best = calibration[bestGain][bestTimer];
+            // Taux de réussite d'abord, puis cycle moyen le plus court
+            if (r.successes > best.successes ||
+                (r.successes == best.successes && r.successes &&
+                 (uint64_t)r.totalUs * best.successes < (uint64_t)best.totalUs * r.successes)) {
+                bestGain = g;
+                bestTimer = t;
+            }
+        }
+    }
+    calibrating = false;
+    calibrationDone = true;
+    uint8_t gain = levelGain(bestGain);
+    uint16_t reload = calibrationReload(bestTimer);
+    // Nouveau point de départ : le réglage automatique repart de zéro
+    memset(stats.gainWindows, 0, sizeof(stats.gainWindows));
+    stats.windowAttempts = stats.windowFailures = 0;
+    timerFloor = RF_TIMER_RELOAD_MIN;
+    timerShortened = false;
+    rfApply(gain, reload);
+    saveRfTuning(gain, reload, rfAutoTune);
+    serialLog().printf("[RF] Calibration terminée : gain %u dB, timer %lu us (%u/%u)\n", gainDb[gain >> 4],
+                       (unsigned long)reloadUs(reload), calibration[bestGain][bestTimer].successes,
+                       RF_CALIBRATION_TRIALS);
+}
+
+void rfTuningLoop() {
+    if (!calibrating) {
+        if (stats.windowAttempts >= RF_TUNE_WINDOW) closeWindow();
+        return;
+    }
+    if (calTrial == 0) rfApply(levelGain(calGain), calibrationReload(calTimer));
+    unsigned long start = micros();
+    bool ok = calibrationTrial();
+    CalibrationResult &r = calibration[calGain][calTimer];
+    if (ok) {
+        r.successes++;
+        r.totalUs += micros() - start;
+    }
+    if (++calTrial < RF_CALIBRATION_TRIALS) return;
+    calTrial = 0;
+    if (++calTimer < RF_CALIBRATION_TIMERS) return;
+    calTimer = 0;
+    if (++calGain < RF_GAIN_LEVELS) return;
+    finishCalibration();
+}
+
+const RfTuningStats &rfTuningStats() {
+    return stats;
+}
+
+String rfTuningJson() {
+    String json;
+    json.reserve(768);
+    json = "{\"gainDb\":";
+    json += gainDb[rfGain >> 4];
+    json += ",\"timerReload\":";
+    json += rfTimerReload;
+    json += ",\"timerUs\":";
+    json += reloadUs(rfTimerReload);
+    json += ",\"autoTune\":";
+    json += rfAutoTune ? "true" : "false";
+    json += ",\"calibrating\":";
+    json += calibrating ? "true" : "false";
+    json += ",\"windows\":";
+    json += stats.windows;
+    json += ",\"adjustments\":";
+    json += stats.adjustments;
+    json += ",\"lastFailPermille\":";
+    json += stats.lastFailPermille;
+    json += ",\"ops\":{";
+    for (uint8_t i = 0; i < RF_OP_COUNT; i++) {
+        const RfOpStats &s = stats.ops[i];
+        if (i) json += ",";
+        json += "\"";
+        json += opNames[i];
+        json += "\":{\"attempts\":";
+        json += s.attempts;
+        json += ",\"failures\":";
+        json += s.failures;
+        json += ",\"meanUs\":";
+        json += s.latency.count ? (uint32_t)(s.latency.sumUs / s.latency.count) : 0;
+        json += "}";
+    }
+    json += "},\"gains\":[";
+    for (uint8_t g = 0; g < RF_GAIN_LEVELS; g++) {
+        uint8_t level = levelGain(g) >> 4;
+        if (g) json += ",";
+        json += "{\"db\":";
+        json += gainDb[level];
+        json += ",\"windows\":";
+        json += stats.gainWindows[level];
+        json += ",\"failPermille\":";
+        json += stats.gainFailPermille[level];
+        json += "}";
+    }
+    json += "]";
+    if (calibrationDone) {
+        json += ",\"calibration\":[";
+        for (uint8_t g = 0; g < RF_GAIN_LEVELS; g++) {
+            for (uint8_t t = 0; t < RF_CALIBRATION_TIMERS; t++) {
+                const CalibrationResult &r = calibration[g][t];
+                if (g || t) json += ",";
+                json += "{\"db\":";
+                json += gainDb[levelGain(g) >> 4];
+                json += ",\"timerUs\":";
+                json += reloadUs(calibrationReload(t));
+                json += ",\"successes\":";
+                json += r.successes;
+                json += ",\"meanUs\":";
+                json += r.successes ? r.totalUs / r.successes : 0;
+                json += "}";
+            }
+        }
+        json += "]";
+    }
+    json += "}";
+    return json;
+}
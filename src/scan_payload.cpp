@@ -0,0 +1,236 @@
+/*
+ * Corps des envois de scans : form-urlencoded ou CBOR, écrits en place
+ */
+#include <scan_payload.h>
+#include <hex_util.h>
+
+static const char *const encodingNames[API_ENCODING_COUNT] = {"form", "cbor"};
+static const char *const contentTypes[API_ENCODING_COUNT] = {"application/x-www-form-urlencoded",
+                                                             "application/cbor"};
+
+// Écriture bornée dans le tampon réseau : tout dépassement invalide le corps
+struct PayloadWriter {
+    uint8_t *buf;
+    size_t size;
+    size_t length;
+    bool overflow;
+};
+
+static inline void put(PayloadWriter &w, uint8_t c) {
+    if (w.length < w.size) w.buf[w.length++] = c;
+    else w.overflow = true;
+}
+
+static void putBytes(PayloadWriter &w, const void *data, size_t length) {
+    if (w.length + length > w.size) {
+        w.overflow = true;
+        return;
+    }
+    memcpy(w.buf + w.length, data, length);
+    w.length += length;
+}
+
+static void putText(PayloadWriter &w, const char *text) {
+    putBytes(w, text, strlen(text));
+}
+
+static uint8_t hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+// === CBOR ===
+#define CBOR_UINT  0
+#define CBOR_BYTES 2
+#define CBOR_TEXT  3
+#define CBOR_MAP   5
+
+// Tête d'un élément : type majeur sur 3 bits, argument sur 0, 1, 2 ou 4 octets
+static void cborHead(PayloadWriter &w, uint8_t major, uint32_t value) {
+    major <<= 5;
+    if (value < 24) {
+        put(w, major | value);
+    } else if (value <= 0xFF) {
+        put(w, major | 24);
+        put(w, value);
+    } else if (value <= 0xFFFF) {
+        put(w, major | 25);
+        put(w, value >> 8);
+        put(w, value);
+    } else {
+        put(w, major | 26);
+        put(w, value >> 24);
+        put(w, value >> 16);
+        put(w, value >> 8);
+        put(w, value);
+    }
+}
+
+static void cborUint(PayloadWriter &w, uint8_t key, uint32_t value) {
+    cborHead(w, CBOR_UINT, key);
+    cborHead(w, CBOR_UINT, value);
+}
+
+// Valeur encodée "%41" décodée directement dans le texte CBOR
+static void cborFormText(PayloadWriter &w, const char *text, size_t length, size_t escapes) {
+    size_t decoded = length - 2 * escapes;
+    cborHead(w, CBOR_TEXT, decoded);
+    if (!escapes) {
+        putBytes(w, text, length);
+        return;
+    }
+    if (w.length + decoded > w.size) {
+        w.overflow = true;
+        return;
+    }
+    uint8_t *o = w.buf + w.length;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '%' && i + 2 < length) {
+            *o++ = (hexValue(text[i + 1]) << 4) | hexValue(text[i + 2]);
+            i += 2;
+        } else {
+            *o++ = text[i];
+        }
+    }
+    w.length += decoded;
+}
+
+// "&nom=valeur&..." -> map texte -> texte, en un passage par champ
+static void cborFields(PayloadWriter &w, const char *fields) {
+    uint32_t pairs = 0;
+    for (const char *p = fields; *p; p++) pairs += *p == '&';
+    cborHead(w, CBOR_MAP, pairs);
+    const char *p = fields;
+    while (*p == '&') {
+        const char *name = ++p;
+        while (*p && *p != '=' && *p != '&') p++;
+        cborHead(w, CBOR_TEXT, p - name);
+        putBytes(w, name, p - name);
+        if (*p == '=') p++;
+        const char *value = p;
+        size_t escapes = 0;
+        for (; *p && *p != '&'; p++) {
+            // "%XX" complet seulement : un '%' tronqué reste tel quel
+            if (*p == '%' && p[1] && p[1] != '&' && p[2] && p[2] != '&') {
+                escapes++;
+                p += 2;
+            }
+        }
+        cborFormText(w, value, p - value, escapes);
+    }
+}
+
+static void encodeCbor(PayloadWriter &w, const ScanRecord &scan) {
+    bool hasFields = scan.fields && scan.fields[0] == '&';
+    bool hasBlocks = scan.blocks && scan.blockCount;
+    uint8_t entries = 1 + (scan.hasCard ? 3 : 0) + (scan.sequence ? 1 : 0) + (hasFields ? 1 : 0) + (hasBlocks ? 2 : 0) +
+                      (scan.device ? 1 : 0);
+    cborHead(w, CBOR_MAP, entries);
+    // UID hexadécimal -> octets (10 au plus, sur la pile)
+    uint8_t uid[UID_HEX_MAX / 2];
+    size_t uidLength = 0;
+    for (const char *p = scan.uid; p[0] && p[1] && uidLength < sizeof(uid); p += 2) {
+        uid[uidLength++] = (hexValue(p[0]) << 4) | hexValue(p[1]);
+    }
+    cborHead(w, CBOR_UINT, 0);
+    cborHead(w, CBOR_BYTES, uidLength);
+    putBytes(w, uid, uidLength);
+    if (scan.hasCard) {
+        cborUint(w, 1, scan.sak);
+        cborUint(w, 2, scan.piccType);
+        cborUint(w, 3, scan.timestamp);
+    }
+    if (scan.sequence) cborUint(w, 4, scan.sequence);
+    if (hasFields) {
+        cborHead(w, CBOR_UINT, 5);
+        cborFields(w, scan.fields);
+    }
+    if (hasBlocks) {
+        size_t length = (size_t)scan.blockCount * scan.blockSize;
+        cborHead(w, CBOR_UINT, 6);
+        cborHead(w, CBOR_BYTES, length);
+        putBytes(w, scan.blocks, length);
+        cborUint(w, 7, scan.blockSize);
+    }
+    if (scan.device) {
+        size_t length = strlen(scan.device);
+        cborHead(w, CBOR_UINT, 8);
+        cborHead(w, CBOR_TEXT, length);
+        putBytes(w, scan.device, length);
+    }
+}
+
+// === Form ===
+static void formUint(PayloadWriter &w, const char *name, uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    putText(w, name);
+    while (n) put(w, digits[--n]);
+}
+
+static void encodeForm(PayloadWriter &w, const ScanRecord &scan) {
+    putText(w, "uid=");
+    putText(w, scan.uid);
+    if (scan.device) {
+        putText(w, "&device=");
+        putText(w, scan.device);
+    }
+    if (scan.sequence) formUint(w, "&scan=", scan.sequence);
+    if (scan.hasCard) {
+        formUint(w, "&sak=", scan.sak);
+        formUint(w, "&type=", scan.piccType);
+        formUint(w, "&ts=", scan.timestamp);
+    }
+    if (scan.fields) putText(w, scan.fields);
+    if (scan.blocks && scan.blockCount) {
+        size_t length = (size_t)scan.blockCount * scan.blockSize;
+        putText(w, "&data=");
+        if (w.length + 2 * length > w.size) {
+            w.overflow = true;
+            return;
+        }
+        for (size_t i = 0; i < length; i++) {
+            w.buf[w.length++] = HEX_LOWER[scan.blocks[i] >> 4];
+            w.buf[w.length++] = HEX_LOWER[scan.blocks[i] & 0x0F];
+        }
+    }
+}
+
+// === API ===
+ScanRecord scanRecord(const char *uid, const char *fields) {
+    ScanRecord scan = {};
+    scan.uid = uid;
+    scan.fields = fields;
+    return scan;
+}
+
+size_t scanPayloadEncode(const ScanRecord &scan, ApiEncoding encoding, uint8_t *buf, size_t size) {
+    PayloadWriter w = {buf, size, 0, false};
+    if (encoding == API_ENCODING_CBOR) encodeCbor(w, scan);
+    else encodeForm(w, scan);
+    return w.overflow ? 0 : w.length;
+}
+
+const char *apiEncodingName(ApiEncoding encoding) {
+    return encodingNames[encoding < API_ENCODING_COUNT ? encoding : API_ENCODING_FORM];
+}
+
+bool apiEncodingFromName(const char *name, ApiEncoding &out) {
+    for (uint8_t i = 0; i < API_ENCODING_COUNT; i++) {
+        if (strcasecmp(name, encodingNames[i]) == 0) {
+            out = (ApiEncoding)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *apiEncodingContentType(ApiEncoding encoding) {
+    return contentTypes[encoding < API_ENCODING_COUNT ? encoding : API_ENCODING_FORM];
+}
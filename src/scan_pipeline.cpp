@@ -0,0 +1,161 @@
+/*
+ * Pipeline de scan étagé : files SPSC entre capture, envoi API et retour
+ */
+#include <scan_pipeline.h>
+#include <spsc_queue.h>
+#include <api_client.h>
+#include <serial_link.h>
+#include <mqtt_client.h>
+#include <coap_uplink.h>
+#include <upload_outbox.h>
+
+static SpscQueue<ScanEvent, SCAN_QUEUE_CAPACITY> captured;
+static SpscQueue<ScanEvent, SCAN_QUEUE_CAPACITY> decided;
+static PipelineStats stats;
+
+// === Étape envoi : décision API ou publication MQTT (audit différé pour la liste locale) ===
+// Chaque événement est copié dans la boîte d'envoi (upload_outbox.h) dès la
+// capture : sa séquence persistante sert de clé d'idempotence, et un envoi qui
+// échoue est rejoué plus tard depuis la flash.
+
+// Enregistrement envoyé pour un événement (form ou CBOR selon apiEncoding)
+static ScanRecord eventRecord(const ScanEvent &event) {
+    ScanRecord scan = scanRecord(event.uid, event.fields);
+    scan.hasCard = true;
+    scan.sak = event.sak;
+    scan.piccType = event.piccType;
+    scan.timestamp = event.timestamp;
+    scan.sequence = event.sequence;
+    scan.device = deviceId();
+    return scan;
+}
+
+bool scanPipelinePush(ScanEvent &event) {
+    // Copie durable avant la file : un scan qu'elle ne peut pas prendre garde
+    // sa séquence et part plus tard par les renvois de la boîte d'envoi
+    ScanRecord scan = eventRecord(event);
+    outboxAppend(scan);
+    event.sequence = scan.sequence;
+    if (captured.push(event)) return true;
+    serialLog().printf("[PIPELINE] File pleine, scan #%lu laissé à la boîte d'envoi\n", (unsigned long)event.id);
+    return false;
+}
+
+// Décision de l'API pour le scan en tête ; false tant que l'échange CoAP attend
+// sa réponse
+static bool uploadDecision(ScanEvent *event) {
+    if (!coapExchangeActive()) {
+        ScanRecord scan = eventRecord(*event);
+        // Publication MQTT confiée à la session (PUBACK attendu hors du chemin de
+        // scan) ; MQTT inactif ou file pleine : CoAP ou POST HTTP selon l'URL.
+        // La publication ne porte aucune décision, et hors connexion elle n'est
+        // qu'en file : pas de bip de succès
+        if (mqttPublishScan(scan)) {
+            event->apiSuccess = false;
+            event->published = true;
+            stats.published++;
+            return true;
+        }
+        if (!coapUplinkActive()) {
+            int httpCode = sendScanToApi(scan);
+            event->apiSuccess = httpCode / 100 == 2;
+            outboxResult(event->sequence, httpCode);
+            return true;
+        }
+        if (!coapStart(scan)) {
+            event->apiSuccess = false;
+            outboxResult(event->sequence, -1);
+            return true;
+        }
+    }
+    CoapResult result = coapPoll();
+    if (result == COAP_PENDING) return false;
+    event->apiSuccess = result == COAP_ALLOW;
+    outboxResult(event->sequence, coapStats().lastCode);
+    return true;
+}
+
+static void stageUpload() {
+    static bool pending = false;
+    static unsigned long start;
+    ScanEvent *event = captured.front();
+    // La file aval pleine bloque l'étape : aucune perte après la capture
+    if (!event || decided.full()) return;
+    if (!pending) {
+        start = micros();
+        histogramRecord(stats.uploadWait, start - event->capturedUs);
+        if (event->decision == ACL_UNKNOWN && event->cached != ACL_UNKNOWN) {
+            // Retour tout de suite depuis le cache ; l'envoi suit au passage
+            // suivant, après le départ du buzzer
+            event->apiSuccess = event->cached == ACL_ALLOW;
+            event->decidedUs = micros();
+            decided.push(*event);
+            stats.cachedFeedback++;
+            pending = true;
+            return;
+        }
+    }
+    // Décision en cache : l'envoi attend que le retour soit parti ; le motif
+    // continue pendant un POST bloquant (Ticker)
+    if (event->cached != ACL_UNKNOWN && !decided.empty()) return;
+    if (event->decision == ACL_UNKNOWN) {
+        // Échange CoAP en cours : l'étape reprend au passage suivant, sans bloquer loop()
+        pending = !uploadDecision(event);
+        if (pending) return;
+    } else {
+        // Retour immédiat depuis la liste locale, la boîte d'envoi informe l'API plus tard
+        event->apiSuccess = event->decision == ACL_ALLOW;
+    }
+    metricsStage(STAGE_UPLOAD, micros() - start);
+    // Décision en cache : retour déjà donné, la réponse n'a servi qu'au cache
+    if (event->cached == ACL_UNKNOWN) {
+        event->decidedUs = micros();
+        decided.push(*event);
+    }
+    captured.pop();
+}
+
+// === Étapes retour buzzer et journal ===
+static void stageFeedback() {
+    ScanEvent *event = decided.front();
+    // Un motif à la fois : le suivant attend la fin du précédent
+    if (!event || buzzerBusy()) return;
+    unsigned long start = micros();
+    histogramRecord(stats.feedbackWait, start - event->decidedUs);
+    if (event->published) {
+        // Publié sans décision : le bip de prise en compte de la capture suffit
+    } else if (event->apiSuccess) {
+        buzzerStart(1, 800); // Clignote seulement si API OK
+    } else {
+        buzzerStart(5, 50); // Clignote 5 fois à 50ms si API != OK
+    }
+    unsigned long logStart = micros();
+    metricsStage(STAGE_FEEDBACK, logStart - start);
+    histogramRecord(stats.endToEnd, start - event->capturedUs);
+    serialLinkSendResult(*event, start);
+    // Deux printf courts : le tampon de pile de Print::printf suffit, pas d'allocation
+    serialLog().printf("[PIPELINE] #%lu %s %s", (unsigned long)event->id, event->uid,
+                       event->published ? "publié" : event->apiSuccess ? "OK" : "refusé");
+    serialLog().printf(" : capture -> retour %lu us (file %u)\n", start - event->capturedUs, (unsigned)captured.size());
+    stats.completed++;
+    decided.pop();
+    metricsStage(STAGE_LOG, micros() - logStart);
+}
+
+void scanPipelineLoop() {
+    stageUpload();
+    stageFeedback();
+}
+
+bool scanPipelineIdle() {
+    return captured.empty() && decided.empty() && !buzzerBusy();
+}
+
+const PipelineStats &scanPipelineStats() {
+    stats.capturedDepth = captured.size();
+    stats.decidedDepth = decided.size();
+    stats.capturedHighWater = captured.highWater;
+    stats.decidedHighWater = decided.highWater;
+    stats.drops = captured.drops;
+    return stats;
+}
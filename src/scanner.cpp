@@ -0,0 +1,784 @@
+/*
+ * Boucle de scan RFID et opérations par mode (lecture, écriture, formatage,
+ * sauvegarde, restauration, encodage en série)
+ */
+#include <config.h>
+#include <SPI.h>
+#include <Ticker.h>
+#include <scanner.h>
+#include <settings.h>
+#include <api_client.h>
+#include <web_routes.h>
+#include <card_image.h>
+#include <acl.h>
+#include <decision_cache.h>
+#include <metrics.h>
+#include <hex_util.h>
+#include <rc522_health.h>
+#include <iso_card.h>
+#include <ndef_tag.h>
+#include <provisioning.h>
+#include <scan_pipeline.h>
+#include <sector_access.h>
+#include <rf_tuning.h>
+#include <serial_link.h>
+
+// Création des instances
+MFRC522 mfrc522(SS_PIN, RST_PIN);
+MFRC522::MIFARE_Key key;
+
+// Variables globales
+ScanMode mode = MODE_READ;
+String dataToWrite = "";
+String restoreUid = "";      // Image source du mode RESTORE
+bool continuousMode = true;
+char lastCardInfo[LAST_CARD_INFO_SIZE] = "Aucune carte";
+static size_t lastCardInfoLen = sizeof("Aucune carte") - 1;
+LastScan lastScan = {0, 0, "", ""};
+unsigned long lastScanTime = 0;
+
+// === Résumé de la dernière carte ===
+// Tampon statique plutôt qu'une String : aucun tas consommé par scan
+void cardInfoClear() {
+    lastCardInfoLen = 0;
+    lastCardInfo[0] = '\0';
+}
+
+void cardInfoAppend(const char *text) {
+    while (*text && lastCardInfoLen < LAST_CARD_INFO_SIZE - 1) {
+        lastCardInfo[lastCardInfoLen++] = *text++;
+    }
+    lastCardInfo[lastCardInfoLen] = '\0';
+}
+
+void cardInfoAppend(const __FlashStringHelper *text) {
+    PGM_P p = reinterpret_cast<PGM_P>(text);
+    char c;
+    while ((c = pgm_read_byte(p++)) && lastCardInfoLen < LAST_CARD_INFO_SIZE - 1) {
+        lastCardInfo[lastCardInfoLen++] = c;
+    }
+    lastCardInfo[lastCardInfoLen] = '\0';
+}
+
+void cardInfoPrintf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(lastCardInfo + lastCardInfoLen, LAST_CARD_INFO_SIZE - lastCardInfoLen, format, args);
+    va_end(args);
+    if (n > 0) lastCardInfoLen = min(lastCardInfoLen + n, (size_t)LAST_CARD_INFO_SIZE - 1);
+}
+
+void scannerBegin() {
+    // Initialisation SPI
+    SPI.begin();
+    // Initialisation du module RFID
+    mfrc522.PCD_Init();
+    // Préparation de la clé par défaut
+    for (byte i = 0; i < 6; i++) {
+        key.keyByte[i] = 0xFF;
+    }
+    pinMode(BUZZER_PIN, OUTPUT);
+    digitalWrite(BUZZER_PIN, LOW);
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, HIGH); // Éteint la LED (inversée sur ESP8266)
+}
+
+static void appendUltralightDump();
+
+// === Étapes du pipeline ===
+// Formatage de l'UID et du type, début du résumé de la carte
+static bool stepIdentify(ScanContext &ctx) {
+    serialLog().println("\n=== Carte détectée ===");
+    // Affichage de l'UID (aucune allocation : tampons sur la pile)
+    char uidLine[3 * 10 + 1];
+    hexEncode(mfrc522.uid.uidByte, mfrc522.uid.size, ctx.uid);
+    hexEncodeSpaced(mfrc522.uid.uidByte, mfrc522.uid.size, uidLine);
+    serialLog().print("UID: ");
+    serialLog().println(uidLine);
+    // Affichage du type de carte
+    ctx.piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
+    ctx.typeName = mfrc522.PICC_GetTypeName(ctx.piccType);
+    serialLog().print("Type: ");
+    serialLog().println(ctx.typeName);
+    cardInfoClear();
+    cardInfoAppend("UID: ");
+    cardInfoAppend(ctx.uid);
+    cardInfoAppend("\nType: ");
+    cardInfoAppend(ctx.typeName);
+    cardInfoAppend("<br/>\n");
+    // Nouvel identifiant : débloque les attentes longues sur /api/lastcard
+    memcpy(lastScan.uid, ctx.uid, sizeof(lastScan.uid));
+    strncpy_P(lastScan.type, reinterpret_cast<PGM_P>(ctx.typeName), sizeof(lastScan.type) - 1);
+    lastScan.type[sizeof(lastScan.type) - 1] = '\0';
+    lastScan.id++;
+    lastScan.version++;
+    return true;
+}
+
+// Bip de prise en compte de la carte
+static bool stepAnnounce(ScanContext &) {
+    blinkBuzzer();
+    return true;
+}
+
+static bool stepAclLookup(ScanContext &ctx) {
+    ctx.decision = aclLookup(mfrc522.uid.uidByte, mfrc522.uid.size);
+    if (ctx.decision != ACL_UNKNOWN) {
+        serialLog().printf("[ACL] Décision locale: %s (%lu us)\n", aclDecisionName(ctx.decision),
+                           (unsigned long)aclStats().lastLookupUs);
+        cardInfoAppend(ctx.decision == ACL_ALLOW ? "Accès local : autorisé<br/>\n" : "Accès local : refusé<br/>\n");
+        return true;
+    }
+    // Hors de la liste locale : dernière réponse de l'API si son ttl court encore
+    ctx.cached = decisionCacheLookup(mfrc522.uid.uidByte, mfrc522.uid.size);
+    if (ctx.cached != ACL_UNKNOWN) {
+        serialLog().printf("[Cache] Décision en cache: %s (%lu us)\n", aclDecisionName(ctx.cached),
+                           (unsigned long)decisionCacheStats().lastLookupUs);
+    }
+    return true;
+}
+
+static bool stepReadMemory(ScanContext &ctx) {
+    ReadProfile *profile = readProfileActive();
+    unsigned long start = micros();
+    if (!readMemoryEnabled) {
+        cardInfoAppend("<i>Lecture mémoire désactivée</i><br/>");
+        return true;
+    } else if (profile->memory != PROFILE_FULL) {
+        // Profil ciblé : seuls les blocs ou pages listés sont lus
+        readProfileRun(profile, ctx.piccType, ctx.fields, sizeof(ctx.fields));
+        return true;
+    } else if (ctx.piccType == MFRC522::PICC_TYPE_MIFARE_UL) {
+        appendUltralightDump();
+    } else if (isoCardHandles(ctx.piccType)) {
+        // ISO-DEP (DESFire, NDEF Type 4) ou carte écartée d'après son SAK
+        appendIsoCardDump(ctx.piccType);
+    } else if (
+        ctx.piccType == MFRC522::PICC_TYPE_ISO_14443_4 ||
+        ctx.piccType == MFRC522::PICC_TYPE_ISO_18092 ||
+        ctx.piccType == MFRC522::PICC_TYPE_MIFARE_MINI ||
+        ctx.piccType == MFRC522::PICC_TYPE_MIFARE_1K ||
+        ctx.piccType == MFRC522::PICC_TYPE_MIFARE_4K ||
+        ctx.piccType == MFRC522::PICC_TYPE_MIFARE_PLUS ||
+        ctx.piccType == MFRC522::PICC_TYPE_MIFARE_DESFIRE) {
+        // Lecture classique
+        appendCardDump();
+        if (ctx.piccType == MFRC522::PICC_TYPE_MIFARE_MINI || ctx.piccType == MFRC522::PICC_TYPE_MIFARE_1K ||
+            ctx.piccType == MFRC522::PICC_TYPE_MIFARE_4K) {
+            appendClassicNdef();
+        }
+    } else {
+        cardInfoAppend("<b>Type de carte non supporté pour la lecture mémoire (");
+        cardInfoAppend(ctx.typeName);
+        cardInfoAppend(")</b>");
+        return true;
+    }
+    readProfileRecord(profile, micros() - start, true);
+    return true;
+}
+
+// Fin de capture (mode lecture) : l'événement part dans le pipeline et la
+// carte est relâchée par HLTA dès le retour de handleRFIDOperations()
+static bool stepCapture(ScanContext &ctx) {
+    ScanEvent event = {};
+    event.id = lastScan.id;
+    memcpy(event.uid, ctx.uid, sizeof(event.uid));
+    event.decision = ctx.decision;
+    event.cached = ctx.cached;
+    memcpy(event.fields, ctx.fields, sizeof(event.fields));
+    event.sak = mfrc522.uid.sak;
+    event.piccType = ctx.piccType;
+    event.timestamp = millis() / 1000;
+    event.capturedUs = micros();
+    // Hôte en liaison binaire : l'événement part avant l'envoi API
+    serialLinkSendScan(event, ctx.piccType, mfrc522.uid.uidByte, mfrc522.uid.size);
+    if (scanPipelinePush(event)) {
+        buzzerStart(2, 100); // Bip de prise en compte, sans bloquer
+    } else {
+        buzzerStart(5, 50);
+    }
+    return true;
+}
+
+static bool stepWrite(ScanContext &) {
+    cardInfoAppend("(Mode écriture)");
+    writeCard();
+    return true;
+}
+
+static bool stepFormat(ScanContext &) {
+    cardInfoAppend("(Mode formatage)");
+    formatCard();
+    return true;
+}
+
+static bool stepBackup(ScanContext &) {
+    cardInfoAppend("(Mode sauvegarde)");
+    backupCard();
+    return true;
+}
+
+// Entrée suivante de la file ; bip final sans bloquer, la carte suivante
+// peut être présentée aussitôt
+static bool stepProvision(ScanContext &ctx) {
+    switch (provisionCard(ctx.piccType, ctx.uid)) {
+    case PROVISION_WRITTEN: buzzerStart(PROVISION_BEEP_OK); break;
+    case PROVISION_DUPLICATE: buzzerStart(PROVISION_BEEP_DUPLICATE); break;
+    case PROVISION_EMPTY: buzzerStart(PROVISION_BEEP_EMPTY); break;
+    default: buzzerStart(PROVISION_BEEP_FAILED); break;
+    }
+    return true;
+}
+
+static bool stepRestore(ScanContext &) {
+    cardInfoPrintf("(Mode restauration %s)", restoreUid.c_str());
+    restoreCard();
+    return true;
+}
+
+// === Table des modes ===
+// Capture seule : envoi et retour sont des étapes du pipeline (scan_pipeline.h)
+static const ScanStep readSteps[] = {
+    {stepIdentify, STAGE_TYPE},
+    {stepAclLookup, STAGE_MEMORY},
+    {stepReadMemory, STAGE_MEMORY},
+    {stepCapture, STAGE_FEEDBACK},
+};
+static const ScanStep writeSteps[] = {
+    {stepIdentify, STAGE_TYPE},
+    {stepAnnounce, STAGE_FEEDBACK},
+    {stepWrite, STAGE_MEMORY},
+};
+static const ScanStep formatSteps[] = {
+    {stepIdentify, STAGE_TYPE},
+    {stepAnnounce, STAGE_FEEDBACK},
+    {stepFormat, STAGE_MEMORY},
+};
+static const ScanStep backupSteps[] = {
+    {stepIdentify, STAGE_TYPE},
+    {stepAnnounce, STAGE_FEEDBACK},
+    {stepBackup, STAGE_MEMORY},
+};
+static const ScanStep restoreSteps[] = {
+    {stepIdentify, STAGE_TYPE},
+    {stepAnnounce, STAGE_FEEDBACK},
+    {stepRestore, STAGE_MEMORY},
+};
+// Pas de bip initial : seul le bip final compte, il indique le résultat
+static const ScanStep provisionSteps[] = {
+    {stepIdentify, STAGE_TYPE},
+    {stepProvision, STAGE_MEMORY},
+};
+
+#define MODE_STEPS(steps) steps, sizeof(steps) / sizeof(steps[0])
+
+// Indexée par ScanMode
+static const ScanModeInfo modeTable[] = {
+    {"READ", "Mode lecture activé", false, MODE_STEPS(readSteps)},
+    {"WRITE", "Mode écriture activé", true, MODE_STEPS(writeSteps)},
+    {"FORMAT", "Mode formatage activé - Approchez une carte", false, MODE_STEPS(formatSteps)},
+    {"BACKUP", "Mode sauvegarde activé - Approchez une carte", false, MODE_STEPS(backupSteps)},
+    {"RESTORE", "Mode restauration activé - Approchez une carte", true, MODE_STEPS(restoreSteps)},
+    {"PROVISION", "Mode encodage en série activé - Approchez les cartes vierges", false, MODE_STEPS(provisionSteps)},
+};
+static_assert(sizeof(modeTable) / sizeof(modeTable[0]) == MODE_COUNT, "Une entrée de table par ScanMode");
+
+const ScanModeInfo &scanModeInfo(ScanMode m) {
+    return modeTable[m < MODE_COUNT ? m : MODE_READ];
+}
+
+const char *scanModeName(ScanMode m) {
+    return m < MODE_COUNT ? modeTable[m].name : "?";
+}
+
+bool scanModeFromName(const char *name, ScanMode &out) {
+    for (uint8_t m = 0; m < MODE_COUNT; m++) {
+        if (strcasecmp(name, modeTable[m].name) == 0) {
+            out = (ScanMode)m;
+            return true;
+        }
+    }
+    return false;
+}
+
+void scanModeActivate(ScanMode m) {
+    mode = m;
+    continuousMode = true;
+}
+
+bool scanCommand(const char *cmd) {
+    ScanMode requested;
+    if (scanModeFromName(cmd, requested) && !scanModeInfo(requested).needsArgument) {
+        scanModeActivate(requested);
+    } else if (strcmp(cmd, "STOP") == 0) {
+        continuousMode = false;
+    } else if (strcmp(cmd, "INFO") == 0) {
+        showSystemInfo();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void handleRFIDOperations() {
+    // Délai entre scans ; la calibration RF dispose seule du lecteur
+    if (millis() - lastScanTime < scanDelayMs || rfCalibrating()) {
+        return;
+    }
+    // Recherche de nouvelles cartes
+    unsigned long stageStart = micros();
+    if (!mfrc522.PICC_IsNewCardPresent()) {
+        return;
+    }
+    metricsStage(STAGE_DETECT, micros() - stageStart);
+    // Sélection de la carte
+    stageStart = micros();
+    bool selected = mfrc522.PICC_ReadCardSerial();
+    rfRecord(RF_SELECT, selected, micros() - stageStart);
+    if (!selected) {
+        return;
+    }
+    metricsStage(STAGE_SELECT, micros() - stageStart);
+    lastScanTime = millis();
+    // Étapes du mode courant ; les durées sont cumulées par étape de métrique
+    // (le bip initial et le bip final comptent tous deux pour « feedback »)
+    ScanContext ctx = {};
+    ctx.decision = ACL_UNKNOWN;
+    const ScanModeInfo &info = scanModeInfo(mode);
+    uint32_t stageUs[STAGE_COUNT] = {0};
+    uint8_t stagesRun = 0;
+    for (uint8_t i = 0; i < info.stepCount; i++) {
+        const ScanStep &step = info.steps[i];
+        stageStart = micros();
+        bool more = step.run(ctx);
+        stageUs[step.stage] += micros() - stageStart;
+        stagesRun |= 1 << step.stage;
+        if (!more) break;
+    }
+    for (uint8_t s = 0; s < STAGE_COUNT; s++) {
+        if (stagesRun & (1 << s)) metricsStage((MetricStage)s, stageUs[s]);
+    }
+    lastScan.version++;
+    // Arrêt de la communication avec la carte
+    mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1();
+    serialLog().println("===================\n");
+}
+
+static void appendUltralightDump() {
+    serialLog().println("--- Lecture MIFARE Ultralight ---");
+    cardInfoAppend("<b>Lecture MIFARE Ultralight :</b><br/>");
+    // Pages lues sans interruption depuis la page 0, reprises pour le NDEF
+    byte pages[16 * 4];
+    byte pagesRead = 0;
+    for (byte page = 0; page < 16; page++) {
+        byte buffer[18] = {0};
+        byte size = 18;
+        MFRC522::StatusCode status = rfRead(mfrc522, page, buffer, &size);
+        char hexStr[3 * 4 + 1];
+        char txtStr[4 + 1];
+        const char *hexOut = hexStr;
+        const char *txtOut = txtStr;
+        if (status == MFRC522::STATUS_OK) {
+            if (pagesRead == page) memcpy(pages + 4 * pagesRead++, buffer, 4);
+            hexEncodeSpaced(buffer, 4, hexStr);
+            asciiEncode(buffer, 4, txtStr);
+            serialLog().print(hexStr);
+            serialLog().print(" | ");
+            serialLog().println(txtStr);
+            hexEncodeSpaced(buffer, 4, hexStr, false);
+        } else {
+            serialLog().print("Page ");
+            serialLog().print(page);
+            serialLog().print(": Lecture échouée: ");
+            serialLog().println(mfrc522.GetStatusCodeName(status));
+            hexOut = "(Lecture échouée)";
+            txtOut = "(Lecture échouée)";
+        }
+        // Limite l'affichage HTML aux 4 premières pages
+        if (page < 4) {
+            cardInfoPrintf("Page %u: %s | %s<br/>", page, hexOut, txtOut);
+        }
+
+        // Permettre au serveur web de répondre pendant la lecture RFID
+        if (page % 4 == 0) {
+            webServerLoop();
+            yield();
+        }
+    }
+    cardInfoAppend("<i>Pages suivantes affichées uniquement sur le port série.</i><br/>");
+    appendType2Ndef(pages, pagesRead);
+}
+
+void appendCardDump() {
+    serialLog().println("--- Lecture complète de la carte ---");
+    cardInfoAppend("<b>Lecture des secteurs RFID :</b><br/>");
+    const AccessStats &access = accessStats();
+    uint32_t skippedBefore = access.skippedAuths + access.skippedReads;
+    for (byte sector = 1; sector < 16; sector++) {
+        serialLog().print("Secteur ");
+        serialLog().print(sector);
+        serialLog().println(":");
+        // Limite l'affichage HTML aux 2 premiers secteurs
+        if (sector < 3) {
+            cardInfoPrintf("Secteur %u:<br/>", sector);
+        }
+        // Une authentification par secteur ; droits lus dans le trailer (ou le cache)
+        for (byte k = 0; k < 6; k++) key.keyByte[k] = 0xFF;
+        bool authOk = accessOpenSector(mfrc522, key, sector);
+        if (!authOk) {
+            serialLog().println("  Auth échouée (clé A refusée)");
+        }
+        for (byte block = 0; block < 3; block++) {
+            byte blockAddr = sector * 4 + block;
+            byte buffer[18] = {0};
+            byte size = sizeof(buffer);
+            char hexStr[3 * 16 + 1];
+            char txtStr[16 + 1];
+            const char *hexOut = hexStr;
+            const char *txtOut = txtStr;
+            if (!authOk) {
+                hexOut = "(Auth échouée)";
+                txtOut = "(Auth échouée)";
+            } else if (!accessAllows(blockAddr, false)) {
+                // Lecture interdite par les bits d'accès : ni NAK ni re-sélection
+                serialLog().print("  Bloc ");
+                serialLog().print(blockAddr);
+                serialLog().println(": lecture interdite avec la clé A");
+                hexOut = "(Lecture interdite)";
+                txtOut = "(Lecture interdite)";
+            } else {
+                MFRC522::StatusCode status = rfRead(mfrc522, blockAddr, buffer, &size);
+                if (status == MFRC522::STATUS_OK) {
+                    hexEncodeSpaced(buffer, 16, hexStr);
+                    asciiEncode(buffer, 16, txtStr);
+                    serialLog().print("  Bloc ");
+                    serialLog().print(blockAddr);
+                    serialLog().print(" | ");
+                    serialLog().print(hexStr);
+                    serialLog().print(" | ");
+                    serialLog().println(txtStr);
+                    hexEncodeSpaced(buffer, 16, hexStr, false);
+                } else {
+                    serialLog().print("  Bloc ");
+                    serialLog().print(blockAddr);
+                    serialLog().print(": Lecture échouée: ");
+                    serialLog().println(mfrc522.GetStatusCodeName(status));
+                    if (status == MFRC522::STATUS_TIMEOUT) {
+                        serialLog().println("[AIDE] Vérifiez le câblage SPI, l'alimentation du module RC522, et la position de la carte.");
+                    }
+                    hexOut = "(Lecture échouée)";
+                    txtOut = "(Lecture échouée)";
+                    // Session Crypto1 perdue : re-sélection pour la suite du secteur
+                    authOk = accessRecover(mfrc522, key, sector);
+                }
+            }
+            if (sector < 3) {
+                cardInfoPrintf("&nbsp;&nbsp;Bloc %u: %s | %s<br/>", blockAddr, hexOut, txtOut);
+            }
+            
+            // Permettre au serveur web de répondre pendant la lecture des secteurs
+            webServerLoop();
+            yield();
+        }
+    }
+    cardInfoAppend("<i>Secteurs suivants affichés uniquement sur le port série.</i><br/>");
+    uint32_t skipped = access.skippedAuths + access.skippedReads - skippedBefore;
+    if (skipped) {
+        cardInfoPrintf("<i>%lu opérations vouées à l'échec évitées (bits d'accès)</i><br/>", (unsigned long)skipped);
+    }
+}
+
+void writeCard() {
+    serialLog().println("--- Écriture des données ---");
+    if (ndefWritePending()) {
+        // Message NDEF encodé par /api/write, réparti sur pages ou blocs
+        ndefWriteCard(mfrc522.PICC_GetType(mfrc522.uid.sak));
+        return;
+    }
+    
+    // Données tronquées à WRITE_DATA_MAX octets (trois blocs ou douze pages)
+    byte buffer[WRITE_DATA_MAX];
+    size_t length = min((size_t)dataToWrite.length(), sizeof(buffer));
+    memcpy(buffer, dataToWrite.c_str(), length);
+    if (!writePayload(mfrc522.PICC_GetType(mfrc522.uid.sak), buffer, length)) {
+        return;
+    }
+
+    serialLog().println("Données écrites et vérifiées!");
+    serialLog().print("Contenu écrit:");
+    char hexStr[3 * 16 + 1];
+    char txtStr[16 + 1];
+    for (size_t offset = 0; offset < length; offset += 16) {
+        size_t chunk = min((size_t)16, length - offset);
+        hexEncodeSpaced(buffer + offset, chunk, hexStr);
+        asciiEncode(buffer + offset, chunk, txtStr);
+        serialLog().print(hexStr);
+        serialLog().print(" | ");
+        serialLog().println(txtStr);
+    }
+    if (!length) serialLog().println();
+}
+
+static bool writeFailed(const char *what, MFRC522::StatusCode status) {
+    serialLog().print(what);
+    serialLog().println(mfrc522.GetStatusCodeName(status));
+    return false;
+}
+
+bool writePayload(MFRC522::PICC_Type type, const byte *data, size_t length) {
+    if (length > WRITE_DATA_MAX) return false;
+    byte padded[WRITE_DATA_MAX] = {0};
+    memcpy(padded, data, length);
+    byte buffer[18];
+    byte size;
+    MFRC522::StatusCode status;
+    if (type == MFRC522::PICC_TYPE_MIFARE_UL) {
+        // Pages de 4 octets à partir de la page 4 ; une lecture relit quatre pages
+        size_t total = length ? (length + 3) & ~(size_t)3 : 4;
+        for (size_t offset = 0; offset < total; offset += 4) {
+            unsigned long start = micros();
+            status = mfrc522.MIFARE_Ultralight_Write(4 + offset / 4, padded + offset, 4);
+            rfRecord(RF_WRITE, status == MFRC522::STATUS_OK, micros() - start);
+            if (status != MFRC522::STATUS_OK) return writeFailed("Écriture échouée: ", status);
+        }
+        for (size_t offset = 0; offset < total; offset += 16) {
+            size = sizeof(buffer);
+            status = rfRead(mfrc522, 4 + offset / 4, buffer, &size);
+            if (status != MFRC522::STATUS_OK) return writeFailed("Vérification échouée: ", status);
+            if (memcmp(buffer, padded + offset, min((size_t)16, total - offset)) != 0) {
+                serialLog().println("Vérification échouée: contenu relu différent");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // MIFARE Classic : blocs 4 à 6 du secteur 1, même session d'authentification
+    if (!accessOpenSector(mfrc522, key, 1)) {
+        serialLog().println("Authentification échouée: clé A refusée");
+        return false;
+    }
+    size_t total = length ? (length + 15) & ~(size_t)15 : 16;
+    for (size_t offset = 0; offset < total; offset += 16) {
+        byte blockAddr = 4 + offset / 16;
+        if (!accessAllows(blockAddr, true)) {
+            serialLog().println("Écriture interdite par les bits d'accès");
+            return false;
+        }
+        status = rfWrite(mfrc522, blockAddr, padded + offset, 16);
+        if (status != MFRC522::STATUS_OK) return writeFailed("Écriture échouée: ", status);
+        size = sizeof(buffer);
+        status = rfRead(mfrc522, blockAddr, buffer, &size);
+        if (status != MFRC522::STATUS_OK) return writeFailed("Vérification échouée: ", status);
+        if (memcmp(buffer, padded + offset, 16) != 0) {
+            serialLog().println("Vérification échouée: contenu relu différent");
+            return false;
+        }
+    }
+    return true;
+}
+
+void formatCard() {
+    serialLog().println("--- Formatage de la carte ---");
+    serialLog().println("ATTENTION: Cette opération effacera toutes les données!");
+    
+    byte emptyBlock[16] = {0};
+    int blocksFormatted = 0;
+    
+    // Formatage des secteurs 1 à 15 (éviter le secteur 0)
+    for (byte sector = 1; sector < 16; sector++) {
+        // Une authentification par secteur ; blocs non inscriptibles avec la clé A ignorés
+        if (!accessOpenSector(mfrc522, key, sector)) continue;
+        for (byte block = 0; block < 3; block++) { // Éviter le bloc trailer
+            byte blockAddr = sector * 4 + block;
+            if (!accessAllows(blockAddr, true)) continue;
+            
+            // Écriture du bloc vide
+            MFRC522::StatusCode status = rfWrite(mfrc522, blockAddr, emptyBlock, 16);
+            if (status == MFRC522::STATUS_OK) {
+                blocksFormatted++;
+                if (blocksFormatted % 10 == 0) {
+                    serialLog().print(".");
+                }
+            } else if (!accessRecover(mfrc522, key, sector)) {
+                break;
+            }
+        }
+    }
+    
+    serialLog().println();
+    serialLog().print("Formatage terminé! ");
+    serialLog().print(blocksFormatted);
+    serialLog().println(" blocs formatés.");
+}
+
+void backupCard() {
+    serialLog().println("--- Sauvegarde de la carte ---");
+    // Image binaire sur LittleFS, téléchargeable depuis l'interface web
+    CardImageHeader header;
+    if (!cardImageCapture(mfrc522, key, header)) {
+        serialLog().println("Sauvegarde échouée!");
+        blinkBuzzer(5, 50);
+        return;
+    }
+    char uidHex[CARD_IMAGE_UID_HEX_MAX];
+    cardImageUidHex(header.uid, header.uidSize, uidHex);
+    cardInfoPrintf("<br/>Image %s : %u/%u blocs", uidHex, (unsigned)cardImageValidCount(header),
+                   (unsigned)header.blockCount);
+    serialLog().println("Sauvegarde terminée!");
+}
+
+void restoreCard() {
+    serialLog().println("--- Restauration de la carte ---");
+    CardRestoreStats stats;
+    bool ok = cardImageRestore(mfrc522, key, restoreUid, stats);
+    cardInfoPrintf("<br/>%u écrits, %u identiques, %u ignorés, %u échecs", (unsigned)stats.written,
+                   (unsigned)stats.unchanged, (unsigned)stats.skipped, (unsigned)stats.failed);
+    if (ok) {
+        serialLog().println("Restauration terminée!");
+        blinkBuzzer(1, 800);
+    } else {
+        serialLog().println("Restauration incomplète!");
+        blinkBuzzer(5, 50);
+    }
+}
+
+void showSystemInfo() {
+    serialLog().println("\n=== Informations système ===");
+    serialLog().println("Modèle: ESP8266 D1 Mini");
+    serialLog().println("Module RFID: RC522");
+    serialLog().println("Fréquence: 13.56 MHz");
+    serialLog().println("Connexions SPI:");
+    serialLog().println("  RST: D3 (GPIO 0)");
+    serialLog().println("  SS:  D8 (GPIO 15)");
+    serialLog().println("  SCK: D5 (GPIO 14)");
+    serialLog().println("  MOSI:D7 (GPIO 13)");
+    serialLog().println("  MISO:D6 (GPIO 12)");
+    serialLog().print("Mode actuel: ");
+    serialLog().println(scanModeName(mode));
+    serialLog().print("Scan continu: ");
+    serialLog().println(continuousMode ? "Activé" : "Désactivé");
+    serialLog().print("Mémoire libre: ");
+    serialLog().print(ESP.getFreeHeap());
+    serialLog().println(" bytes");
+    serialLog().print("Fréquence CPU: ");
+    serialLog().print(ESP.getCpuFreqMHz());
+    serialLog().println(" MHz");
+    serialLog().print("WiFi: ");
+    serialLog().println(wifiConnected ? "Connecté" : "Déconnecté");
+    if (wifiConnected) {
+        serialLog().print("IP: ");
+        serialLog().println(WiFi.localIP());
+    }
+    serialLog().print("OTA: ");
+    serialLog().println(otaEnabled ? "Activé" : "Désactivé");
+    serialLog().println("============================\n");
+}
+
+// Fonction utilitaire pour afficher les données en hexadécimal
+void printHex(byte *buffer, byte bufferSize) {
+    for (byte i = 0; i < bufferSize; i++) {
+        serialLog().print(buffer[i] < 0x10 ? " 0" : " ");
+        serialLog().print(buffer[i], HEX);
+    }
+}
+
+// Fonction utilitaire pour afficher les données en texte
+void printText(byte *buffer, byte bufferSize) {
+    for (byte i = 0; i < bufferSize; i++) {
+        if (buffer[i] >= 32 && buffer[i] <= 126) {
+            serialLog().print((char)buffer[i]);
+        } else {
+            serialLog().print(".");
+        }
+    }
+}
+
+// Fonction de test de connectivité
+void testRFIDModule() {
+    serialLog().println("=== Test du module RFID ===");
+    
+    // Test de communication SPI
+    byte version = mfrc522.PCD_ReadRegister(MFRC522::VersionReg);
+    serialLog().print("Version du firmware: 0x");
+    serialLog().println(version, HEX);
+    
+    if (version == 0x00 || version == 0xFF) {
+        serialLog().println("ERREUR: Aucune communication avec le module RC522!");
+        serialLog().println("Vérifiez les connexions SPI.");
+    } else {
+        serialLog().println("Module RC522 détecté et fonctionnel.");
+    }
+    const RfTuningStats &rf = rfTuningStats();
+    serialLog().printf("Gain antenne: 0x%02X, timer: %u (%s)\n", mfrc522.PCD_GetAntennaGain(), rfTimerReload,
+                       rfAutoTune ? "auto" : "fixe");
+    serialLog().printf("Échecs dernière fenêtre: %u pour mille, ajustements: %lu\n", rf.lastFailPermille,
+                       (unsigned long)rf.adjustments);
+    // Sonde immédiate : répare aussi un module resté muet depuis la dernière
+    rc522HealthCheck();
+    const Rc522HealthStats &health = rc522HealthStats();
+    serialLog().printf("Reprises: %lu (échecs %lu), dernier défaut: %s\n", (unsigned long)health.recoveries,
+                       (unsigned long)health.failedRecoveries, rc522FaultName(health.lastFault));
+    
+    serialLog().println("===========================\n");
+}
+
+// Fonction pour faire clignoter le buzzer (optimisée pour la réactivité web)
+void blinkBuzzer(int times, unsigned long duration) {
+    for (int i = 0; i < times; i++) {
+        digitalWrite(BUZZER_PIN, HIGH);
+        
+        // Délai fractionné pour permettre au serveur web de répondre
+        unsigned long start = millis();
+        while (millis() - start < duration) {
+            webServerLoop(); // Traiter les requêtes pendant le délai
+            yield(); // Permettre au système de respirer
+            delay(1);
+        }
+        
+        digitalWrite(BUZZER_PIN, LOW);
+        
+        // Même chose pour le délai d'arrêt
+        start = millis();
+        while (millis() - start < duration) {
+            webServerLoop();
+            yield();
+            delay(1);
+        }
+    }
+}
+
+// === Buzzer non bloquant ===
+// Motif joué par un Ticker (os_timer du SDK) : il continue pendant un POST
+// bloquant ou une écriture flash. Un nouveau motif remplace le précédent.
+static Ticker buzzerTicker;
+static volatile uint8_t buzzerSteps = 0;   // demi-périodes restantes, dernier silence compris
+static volatile bool buzzerOn = false;
+
+static void buzzerStep() {
+    if (--buzzerSteps == 0) {
+        buzzerTicker.detach();
+        return;
+    }
+    buzzerOn = !buzzerOn;
+    digitalWrite(BUZZER_PIN, buzzerOn ? HIGH : LOW);
+}
+
+void buzzerStart(uint8_t times, uint16_t duration) {
+    buzzerTicker.detach();
+    if (!times || !duration) {
+        buzzerSteps = 0;
+        buzzerOn = false;
+        digitalWrite(BUZZER_PIN, LOW);
+        return;
+    }
+    buzzerSteps = times * 2;
+    buzzerOn = true;
+    digitalWrite(BUZZER_PIN, HIGH);
+    buzzerTicker.attach_ms(duration, buzzerStep);
+}
+
+bool buzzerBusy() {
+    return buzzerSteps != 0;
+}
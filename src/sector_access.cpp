@@ -0,0 +1,194 @@
+/*
+ * Bits d'accès MIFARE Classic : décodage, cache par UID et plan des opérations
+ */
+#include <sector_access.h>
+#include <rf_tuning.h>
+
+// État d'un secteur dans le cache : bits C1C2C3 des 4 groupes (3 bits chacun)
+#define SECTOR_KNOWN         0x1000  // trailer lu (ou clé refusée)
+#define SECTOR_KEY_A_REFUSED 0x2000
+#define SECTOR_INVALID       0x4000  // bits d'accès incohérents : aucun plan
+
+struct AccessEntry {
+    byte uidSize;            // 0 : entrée libre
+    byte uid[10];
+    unsigned long learnedMs;
+    unsigned long lastUse;
+    uint16_t sectors[ACCESS_SECTORS_MAX];
+};
+
+bool accessPlanning = true;
+static AccessEntry cache[ACCESS_CACHE_SIZE];
+static AccessStats stats;
+// Secteur ouvert par le dernier accessOpenSector() réussi
+static int openSector = -1;
+static uint16_t openState = 0;
+
+uint8_t accessSectorOf(uint16_t block) {
+    return block < 128 ? block / 4 : 32 + (block - 128) / 16;
+}
+
+uint16_t accessFirstBlock(uint8_t sector) {
+    return sector < 32 ? sector * 4 : 128 + (sector - 32) * 16;
+}
+
+uint8_t accessBlocksInSector(uint8_t sector) {
+    return sector < 32 ? 4 : 16;
+}
+
+// Secteurs de 16 blocs (4K) : groupes de 5 blocs, le trailer forme le groupe 3
+static uint8_t groupOf(uint16_t block) {
+    uint8_t sector = accessSectorOf(block);
+    uint8_t offset = block - accessFirstBlock(sector);
+    if (accessBlocksInSector(sector) == 4) return offset;
+    return offset == 15 ? 3 : offset / 5;
+}
+
+static uint8_t groupBits(uint16_t state, uint8_t group) {
+    return (state >> (group * 3)) & 0x07;
+}
+
+bool accessDecode(const byte *trailer, uint8_t groups[4]) {
+    uint8_t c1 = trailer[7] >> 4;
+    uint8_t c2 = trailer[8] & 0x0F;
+    uint8_t c3 = trailer[8] >> 4;
+    if ((trailer[6] & 0x0F) != (~c1 & 0x0F) || (trailer[6] >> 4) != (~c2 & 0x0F) ||
+        (trailer[7] & 0x0F) != (~c3 & 0x0F)) {
+        return false;
+    }
+    for (uint8_t g = 0; g < 4; g++) {
+        groups[g] = (((c1 >> g) & 1) << 2) | (((c2 >> g) & 1) << 1) | ((c3 >> g) & 1);
+    }
+    return true;
+}
+
+// Table des droits des blocs de données (fiche technique MF1S50, §8.7.3)
+uint8_t accessReadKeys(uint8_t bits) {
+    switch (bits) {
+    case 0b000: case 0b010: case 0b100: case 0b110: case 0b001: return ACCESS_KEY_A | ACCESS_KEY_B;
+    case 0b011: case 0b101: return ACCESS_KEY_B;
+    default: return 0;
+    }
+}
+
+uint8_t accessWriteKeys(uint8_t bits) {
+    switch (bits) {
+    case 0b000: return ACCESS_KEY_A | ACCESS_KEY_B;
+    case 0b100: case 0b110: case 0b011: return ACCESS_KEY_B;
+    default: return 0;
+    }
+}
+
+// Entrée de l'UID sélectionné, créée (à la place de la plus ancienne) si besoin
+static AccessEntry &entryFor(const MFRC522::Uid &uid) {
+    AccessEntry *oldest = &cache[0];
+    for (uint8_t i = 0; i < ACCESS_CACHE_SIZE; i++) {
+        AccessEntry &e = cache[i];
+        if (e.uidSize == uid.size && memcmp(e.uid, uid.uidByte, uid.size) == 0) {
+            if (millis() - e.learnedMs > ACCESS_CACHE_TTL_MS) {
+                memset(e.sectors, 0, sizeof(e.sectors));
+                e.learnedMs = millis();
+            }
+            e.lastUse = millis();
+            return e;
+        }
+        if (e.uidSize == 0 || (oldest->uidSize != 0 && e.lastUse < oldest->lastUse)) oldest = &e;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->uidSize = uid.size < 10 ? uid.size : 10;
+    memcpy(oldest->uid, uid.uidByte, oldest->uidSize);
+    oldest->learnedMs = oldest->lastUse = millis();
+    return *oldest;
+}
+
+bool accessReselect(MFRC522 &reader) {
+    byte atqa[2];
+    byte atqaSize = sizeof(atqa);
+    stats.reselects++;
+    reader.PCD_StopCrypto1();
+    MFRC522::StatusCode status = reader.PICC_WakeupA(atqa, &atqaSize);
+    if (status != MFRC522::STATUS_OK && status != MFRC522::STATUS_COLLISION) return false;
+    return reader.PICC_Select(&reader.uid) == MFRC522::STATUS_OK;
+}
+
+bool accessOpenSector(MFRC522 &reader, MFRC522::MIFARE_Key &key, uint8_t sector) {
+    openSector = -1;
+    if (sector >= ACCESS_SECTORS_MAX) return false;
+    uint16_t &state = entryFor(reader.uid).sectors[sector];
+    if (accessPlanning && (state & SECTOR_KEY_A_REFUSED)) {
+        stats.skippedAuths++;
+        return false;
+    }
+    byte trailer = accessFirstBlock(sector) + accessBlocksInSector(sector) - 1;
+    unsigned long start = micros();
+    bool authOk = reader.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, trailer, &key, &(reader.uid)) ==
+                  MFRC522::STATUS_OK;
+    // Seul un secteur dont la clé A a déjà été acceptée mesure la liaison RF :
+    // ailleurs un refus peut venir d'une clé inconnue
+    if ((state & (SECTOR_KNOWN | SECTOR_KEY_A_REFUSED)) == SECTOR_KNOWN) rfRecord(RF_AUTH, authOk, micros() - start);
+    if (!authOk) {
+        stats.failedAuths++;
+        if (accessPlanning) state = SECTOR_KNOWN | SECTOR_KEY_A_REFUSED;
+        accessReselect(reader);
+        return false;
+    }
+    if (accessPlanning && !(state & SECTOR_KNOWN)) {
+        // La clé A peut toujours lire les bits d'accès, quel que soit le secteur
+        byte buffer[18];
+        byte size = sizeof(buffer);
+        uint8_t groups[4];
+        if (rfRead(reader, trailer, buffer, &size) != MFRC522::STATUS_OK) {
+            // Trailer illisible : secteur traité sans plan, session rétablie
+            accessReselect(reader);
+            if (reader.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, trailer, &key, &(reader.uid)) !=
+                MFRC522::STATUS_OK) {
+                return false;
+            }
+        } else if (accessDecode(buffer, groups)) {
+            stats.trailersRead++;
+            state = SECTOR_KNOWN | groups[0] | (groups[1] << 3) | (groups[2] << 6) | (groups[3] << 9);
+        } else {
+            stats.trailersRead++;
+            stats.invalidTrailers++;
+            state = SECTOR_KNOWN | SECTOR_INVALID;
+        }
+    } else if (accessPlanning) {
+        stats.cacheHits++;
+    }
+    openSector = sector;
+    openState = accessPlanning ? state : 0;
+    return true;
+}
+
+bool accessAllows(uint16_t block, bool write) {
+    if (!accessPlanning || openSector != accessSectorOf(block)) return true;
+    if (!(openState & SECTOR_KNOWN) || (openState & SECTOR_INVALID)) return true;
+    uint8_t group = groupOf(block);
+    uint8_t bits = groupBits(openState, group);
+    bool allowed;
+    if (group == 3) {
+        // Trailer : bits d'accès toujours lisibles avec la clé A, écriture selon C1C2C3
+        allowed = !write || bits == 0b000 || bits == 0b001;
+    } else {
+        allowed = (write ? accessWriteKeys(bits) : accessReadKeys(bits)) & ACCESS_KEY_A;
+    }
+    if (!allowed) {
+        if (write) stats.skippedWrites++;
+        else stats.skippedReads++;
+    }
+    return allowed;
+}
+
+bool accessRecover(MFRC522 &reader, MFRC522::MIFARE_Key &key, uint8_t sector) {
+    accessReselect(reader);
+    return accessOpenSector(reader, key, sector);
+}
+
+void accessForget() {
+    memset(cache, 0, sizeof(cache));
+    openSector = -1;
+}
+
+const AccessStats &accessStats() {
+    return stats;
+}
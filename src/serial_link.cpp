@@ -0,0 +1,291 @@
+/*
+ * Port série non bloquant : lignes de commande texte et trames binaires
+ */
+#include <serial_link.h>
+#include <LittleFS.h>
+#include <scanner.h>
+#include <scan_pipeline.h>
+#include <card_image.h>
+#include <ndef_tag.h>
+#include <rc522_health.h>
+
+// Sortie muette : les journaux du chemin de scan n'occupent pas la liaison binaire
+class NullStream : public Stream {
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+static NullStream nullStream;
+
+static SerialLineHandler lineHandler = nullptr;
+static SerialLinkStats stats;
+
+// Mode texte : ligne en cours ; au-delà de la taille maximale, le reste de la
+// ligne est ignoré jusqu'au '\n'
+static char line[SERIAL_LINK_LINE_MAX + 1];
+static size_t lineLength = 0;
+static bool lineOverflow = false;
+
+// Mode binaire : décodeur de réception, trame d'émission (type, séquence et
+// corps construits en place) et son codage
+static LinkDecoder decoder;
+static uint8_t tx[LINK_PAYLOAD_MAX];
+static uint8_t txFrame[LINK_FRAME_MAX];
+static uint8_t txSeq = 0;
+
+#define TX_BODY (tx + LINK_HEADER_SIZE)
+#define TX_BODY_MAX (LINK_PAYLOAD_MAX - LINK_HEADER_SIZE)
+
+static bool allowedBaud(uint32_t baud) {
+    return baud == 115200 || baud == 230400 || baud == 460800 || baud == 921600;
+}
+
+// Vide le tampon d'émission au débit courant avant d'en changer
+static void setBaud(uint32_t baud) {
+    Serial.flush();
+    Serial.begin(baud);
+    stats.baud = baud;
+}
+
+static void send(uint8_t type, size_t bodyLength) {
+    tx[0] = type;
+    tx[1] = txSeq++;
+    size_t n = linkEncode(tx, LINK_HEADER_SIZE + bodyLength, txFrame, sizeof(txFrame));
+    if (!n) return;
+    Serial.write(txFrame, n);
+    stats.framesOut++;
+    stats.bytesOut += n;
+}
+
+static void sendAck(uint8_t commandType, uint8_t commandSeq, uint8_t result, const uint8_t *data = nullptr,
+                    size_t length = 0) {
+    if (length > TX_BODY_MAX - 3) length = TX_BODY_MAX - 3;
+    TX_BODY[0] = commandType;
+    TX_BODY[1] = commandSeq;
+    TX_BODY[2] = result;
+    if (length) memcpy(TX_BODY + 3, data, length);
+    send(LINK_MSG_ACK, 3 + length);
+}
+
+// === Messages de l'appareil ===
+void serialLinkSendScan(const ScanEvent &event, MFRC522::PICC_Type type, const byte *uid, byte uidSize) {
+    if (!stats.binary) return;
+    uint8_t *p = TX_BODY;
+    linkPut32(p, event.id);
+    linkPut32(p + 4, event.capturedUs);
+    p[8] = type;
+    p[9] = event.decision;
+    p[10] = uidSize;
+    memcpy(p + 11, uid, uidSize);
+    size_t length = 11 + uidSize;
+    // Champs du profil de lecture, tronqués à la place restante
+    size_t fields = strnlen(event.fields, sizeof(event.fields));
+    if (fields > TX_BODY_MAX - length) fields = TX_BODY_MAX - length;
+    memcpy(p + length, event.fields, fields);
+    send(LINK_MSG_SCAN, length + fields);
+}
+
+void serialLinkSendResult(const ScanEvent &event, unsigned long feedbackUs) {
+    if (!stats.binary) return;
+    linkPut32(TX_BODY, event.id);
+    TX_BODY[4] = event.published ? 2 : event.apiSuccess;
+    linkPut32(TX_BODY + 5, feedbackUs - event.capturedUs);
+    send(LINK_MSG_RESULT, 9);
+}
+
+static void sendStatus() {
+    const PipelineStats &pipeline = scanPipelineStats();
+    uint8_t *p = TX_BODY;
+    p[0] = mode;
+    p[1] = continuousMode;
+    linkPut32(p + 2, millis() / 1000);
+    linkPut32(p + 6, ESP.getFreeHeap());
+    p[10] = pipeline.capturedDepth + pipeline.decidedDepth;
+    linkPut32(p + 11, pipeline.drops);
+    p[15] = rc522HealthStats().healthy;
+    linkPut32(p + 16, lastScan.id);
+    send(LINK_MSG_STATUS, 20);
+}
+
+// === Commandes de l'hôte ===
+// nom[\0argument] ; mêmes effets que les commandes texte
+static uint8_t commandMode(const uint8_t *body, size_t length) {
+    char name[16];
+    size_t nameLength = strnlen((const char *)body, length);
+    if (nameLength == 0 || nameLength >= sizeof(name)) return LINK_ACK_INVALID;
+    for (size_t i = 0; i < nameLength; i++) name[i] = toupper(body[i]);
+    name[nameLength] = '\0';
+    String argument;
+    if (nameLength + 1 < length) argument.concat((const char *)body + nameLength + 1, length - nameLength - 1);
+    if (strcmp(name, "SCAN") == 0 || strcmp(name, "STOP") == 0) {
+        continuousMode = name[1] == 'C';
+        return LINK_ACK_OK;
+    }
+    ScanMode requested;
+    if (!scanModeFromName(name, requested)) return LINK_ACK_UNKNOWN;
+    if (scanModeInfo(requested).needsArgument && argument.length() == 0) return LINK_ACK_INVALID;
+    if (requested == MODE_WRITE) {
+        dataToWrite = argument;
+        ndefCancelWrite();
+    } else if (requested == MODE_RESTORE) {
+        argument.toLowerCase();
+        CardImageHeader header;
+        if (!cardImageReadHeader(argument, header)) return LINK_ACK_NOT_FOUND;
+        restoreUid = argument;
+    }
+    scanModeActivate(requested);
+    return LINK_ACK_OK;
+}
+
+// Image complète (en-tête et contenu) en trames de LINK_IMAGE_CHUNK octets
+static uint8_t commandImage(const uint8_t *body, size_t length) {
+    if (length == 0 || length >= CARD_IMAGE_UID_HEX_MAX) return LINK_ACK_INVALID;
+    String uid;
+    uid.concat((const char *)body, length);
+    uid.toLowerCase();
+    String path = cardImagePath(uid);
+    if (path.length() == 0 || !LittleFS.exists(path)) return LINK_ACK_NOT_FOUND;
+    File f = LittleFS.open(path, "r");
+    if (!f) return LINK_ACK_NOT_FOUND;
+    size_t total = f.size();
+    size_t offset = 0;
+    while (offset < total) {
+        size_t n = f.read(TX_BODY + 4, LINK_IMAGE_CHUNK);
+        if (n == 0) break;
+        linkPut16(TX_BODY, offset);
+        linkPut16(TX_BODY + 2, total);
+        send(LINK_MSG_IMAGE, 4 + n);
+        offset += n;
+    }
+    f.close();
+    return offset == total ? LINK_ACK_OK : LINK_ACK_INVALID;
+}
+
+static void handleFrame(const uint8_t *payload, size_t length) {
+    stats.framesIn++;
+    uint8_t type = payload[0];
+    uint8_t seq = payload[1];
+    const uint8_t *body = payload + LINK_HEADER_SIZE;
+    length -= LINK_HEADER_SIZE;
+    switch (type) {
+    case LINK_CMD_MODE:
+        sendAck(type, seq, commandMode(body, length));
+        break;
+    case LINK_CMD_STATUS:
+        sendStatus();
+        sendAck(type, seq, LINK_ACK_OK);
+        break;
+    case LINK_CMD_IMAGE:
+        sendAck(type, seq, commandImage(body, length));
+        break;
+    case LINK_CMD_PING:
+        sendAck(type, seq, LINK_ACK_OK, body, length);
+        break;
+    case LINK_CMD_TEXT: {
+        uint32_t baud = length >= 4 ? linkGet32(body) : SERIAL_LINK_TEXT_BAUD;
+        if (!allowedBaud(baud)) {
+            sendAck(type, seq, LINK_ACK_INVALID);
+            break;
+        }
+        sendAck(type, seq, LINK_ACK_OK);
+        stats.binary = false;
+        setBaud(baud);
+        Serial.println("Mode texte");
+        break;
+    }
+    default:
+        sendAck(type, seq, LINK_ACK_UNKNOWN);
+        break;
+    }
+}
+
+// === Lignes de commande texte ===
+static void enterBinary(const char *argument) {
+    // Sans débit : on reste à 115200
+    uint32_t baud = strtoul(argument, nullptr, 10);
+    if (baud == 0) baud = SERIAL_LINK_TEXT_BAUD;
+    if (!allowedBaud(baud)) {
+        Serial.println("Débit refusé (115200, 230400, 460800 ou 921600)");
+        return;
+    }
+    Serial.printf("Mode binaire COBS/CRC-16 à %lu bauds\n", (unsigned long)baud);
+    setBaud(baud);
+    linkDecoderReset(decoder);
+    stats.binary = true;
+    // Première trame : l'hôte sait que la bascule a eu lieu
+    sendStatus();
+}
+
+static void handleLine() {
+    line[lineLength] = '\0';
+    stats.lines++;
+    // BINARY est traité ici : le débit change avant de relire le port
+    const char *p = line;
+    while (*p == ' ' || *p == '\r') p++;
+    if (strncasecmp(p, "BINARY", 6) == 0 && (p[6] == '\0' || p[6] == ' ' || p[6] == '\r')) {
+        p += 6;
+        while (*p == ' ') p++;
+        enterBinary(p);
+        return;
+    }
+    if (!lineHandler) return;
+    String command(line);
+    lineHandler(command);
+}
+
+static void feedText(uint8_t c) {
+    if (c == '\n') {
+        if (!lineOverflow) handleLine();
+        lineLength = 0;
+        lineOverflow = false;
+        return;
+    }
+    if (lineOverflow) return;
+    if (lineLength == SERIAL_LINK_LINE_MAX) {
+        lineOverflow = true;
+        stats.linesTruncated++;
+        Serial.println("Commande trop longue, ignorée");
+        return;
+    }
+    line[lineLength++] = c;
+}
+
+// === API ===
+void serialLinkBegin(SerialLineHandler onLine) {
+    lineHandler = onLine;
+    // Démarrage en mode texte, au débit ouvert par setup()
+    stats.binary = false;
+    stats.baud = SERIAL_LINK_TEXT_BAUD;
+    lineLength = 0;
+    lineOverflow = false;
+    linkDecoderReset(decoder);
+}
+
+void serialLinkPoll() {
+    for (int budget = SERIAL_LINK_POLL_BUDGET; budget > 0 && Serial.available(); budget--) {
+        uint8_t c = Serial.read();
+        if (!stats.binary) {
+            feedText(c);
+            continue;
+        }
+        if (linkDecoderFeed(decoder, c) == LINK_FRAME) handleFrame(decoder.buf, decoder.length);
+    }
+}
+
+bool serialLinkBinary() {
+    return stats.binary;
+}
+
+Stream &serialLog() {
+    if (stats.binary) return nullStream;
+    return Serial;
+}
+
+const SerialLinkStats &serialLinkStats() {
+    stats.crcErrors = decoder.crcErrors;
+    stats.framingErrors = decoder.framingErrors;
+    return stats;
+}
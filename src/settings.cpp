@@ -0,0 +1,443 @@
+/*
+ * Paramètres persistants (journal LittleFS) et état réseau partagé
+ */
+#include <config.h>
+#include <EEPROM.h>
+#include <LittleFS.h>
+#include <settings.h>
+#include <scan_payload.h>
+#include <serial_link.h>
+
+String apiUrl = "";
+uint8_t apiEncoding = 0;
+String wifiSsid = "";
+String wifiPass = "";
+unsigned long scanDelayMs = 3000; // 3 secondes par défaut
+String webAccessCode = "admin";
+bool readMemoryEnabled = true;
+String readProfileName = "full";
+uint8_t rfGain = RF_GAIN_DEFAULT;
+uint16_t rfTimerReload = RF_TIMER_RELOAD_DEFAULT;
+bool rfAutoTune = true;
+bool mqttEnabled = false;
+String mqttHost = "";
+uint16_t mqttPort = 1883;
+String mqttUser = "";
+String mqttPass = "";
+String mqttTopic = "";
+bool otaEnabled = true;
+bool wifiConnected = false;
+bool otaInProgress = false;
+
+// === Bloc de configuration ===
+// Une seule structure versionnée et protégée par CRC. Elle est conservée sur
+// LittleFS sous forme d'instantané + journal :
+//   /config/snapshot.bin  ConfigBlob complet, remplacé atomiquement (tmp + rename)
+//   /config/journal.bin   enregistrements ajoutés à chaque modification
+// Un réglage modifié coûte quelques dizaines d'octets ajoutés au journal au
+// lieu de l'effacement d'un secteur EEPROM de 4 Ko. Au démarrage, le journal
+// est rejoué sur l'instantané ; au-delà de CONFIG_JOURNAL_MAX_BYTES il est
+// compacté dans un nouvel instantané. L'EEPROM n'est plus lue qu'une fois,
+// pour migrer une configuration existante.
+//
+// Les champs ne sont ajoutés qu'en fin de bloc (avant le CRC) : un bloc ou un
+// enregistrement d'une version antérieure s'applique tel quel, les nouveaux
+// champs gardent leur valeur par défaut.
+#define CONFIG_MAGIC 0x31474643UL  // "CFG1" en little-endian
+#define CONFIG_VERSION 5
+#define CONFIG_DIR "/config"
+#define CONFIG_SNAPSHOT_PATH CONFIG_DIR "/snapshot.bin"
+#define CONFIG_SNAPSHOT_TMP  CONFIG_DIR "/snapshot.tmp"
+#define CONFIG_JOURNAL_PATH  CONFIG_DIR "/journal.bin"
+#define CONFIG_JOURNAL_MAX_BYTES 4096
+#define CONFIG_RECORD_MAGIC 0xC5
+
+struct __attribute__((packed)) ConfigBlob {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;                        // sizeof(ConfigBlob) à l'écriture
+    char apiUrl[API_URL_MAXLEN + 1];
+    char wifiSsid[WIFI_SSID_MAXLEN + 1];
+    char wifiPass[WIFI_PASS_MAXLEN + 1];    // doit suivre wifiSsid (écrits ensemble)
+    uint32_t scanDelayMs;
+    char webAccessCode[WEB_CODE_MAXLEN + 1];
+    uint8_t readMemoryEnabled;
+    char readProfile[READ_PROFILE_NAME_MAXLEN + 1];  // v2
+    uint8_t rfGain;                         // v3 : masque RFCfgReg (bits 4-6)
+    uint16_t rfTimerReload;                 // v3 : TReloadReg, pas de 25 µs
+    uint8_t rfAutoTune;                     // v3
+    uint8_t mqttEnabled;                    // v4 : transport des scans (mqtt_client.h)
+    uint16_t mqttPort;                      // v4
+    char mqttHost[MQTT_HOST_MAXLEN + 1];    // v4, champs MQTT contigus (écrits ensemble)
+    char mqttUser[MQTT_USER_MAXLEN + 1];    // v4
+    char mqttPass[MQTT_PASS_MAXLEN + 1];    // v4
+    char mqttTopic[MQTT_TOPIC_MAXLEN + 1];  // v4 : préfixe des sujets
+    uint8_t apiEncoding;                    // v5 : corps des envois (scan_payload.h)
+    uint32_t crc;                           // CRC-32 de tout ce qui précède
+};
+static_assert(sizeof(ConfigBlob) == 497, "Disposition du bloc de configuration modifiée : incrémenter CONFIG_VERSION");
+
+// Taille utile (avant le CRC) de chaque version du bloc
+static const uint16_t configPayloadSizes[CONFIG_VERSION + 1] = {0, 329, 345, 349, 492, offsetof(ConfigBlob, crc)};
+static_assert(sizeof(ConfigBlob) <= EEPROM_SIZE, "Le bloc de configuration dépasse EEPROM_SIZE");
+
+// Enregistrement du journal : en-tête, octets du champ, CRC-32 (en-tête + données)
+struct __attribute__((packed)) ConfigRecord {
+    uint8_t magic;
+    uint8_t version;    // CONFIG_VERSION du bloc visé
+    uint16_t offset;    // position du champ dans ConfigBlob
+    uint16_t length;
+};
+static_assert(sizeof(ConfigRecord) == 6, "En-tête d'enregistrement de 6 octets");
+
+// === Ancienne disposition (champs à adresses fixes, avant CONFIG_VERSION 1) ===
+// Avec EEPROM_SIZE à 256, tout ce qui suivait l'octet 255 (fin du mot de passe
+// WiFi, délai, code d'accès, lecture mémoire) n'était jamais enregistré.
+#define LEGACY_API_URL_ADDR     0
+#define LEGACY_WIFI_SSID_ADDR   200
+#define LEGACY_WIFI_PASS_ADDR   232
+#define LEGACY_SCAN_DELAY_ADDR  296
+#define LEGACY_WEB_CODE_ADDR    300
+#define LEGACY_READ_MEMORY_ADDR 316
+
+static ConfigBlob config;
+static ConfigStats stats;
+static bool compactionDue = false;
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *p, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void defaultConfig();
+
+static uint32_t configCrc(const ConfigBlob &c) {
+    return crc32Update(0, (const uint8_t *)&c, offsetof(ConfigBlob, crc));
+}
+
+// Accepte un bloc brut de n'importe quelle version connue et le charge dans
+// config (valeurs par défaut pour les champs plus récents)
+static bool configAccept(const uint8_t *raw) {
+    const ConfigBlob *c = (const ConfigBlob *)raw;
+    if (c->magic != CONFIG_MAGIC || c->version == 0 || c->version > CONFIG_VERSION) return false;
+    uint16_t payload = configPayloadSizes[c->version];
+    if (c->length != payload + sizeof(uint32_t)) return false;
+    uint32_t crc;
+    memcpy(&crc, raw + payload, sizeof(crc));
+    if (crc != crc32Update(0, raw, payload)) return false;
+    defaultConfig();
+    memcpy(&config, raw, payload);
+    return true;
+}
+
+static void copyField(char *dst, size_t size, const String &value) {
+    strncpy(dst, value.c_str(), size - 1);
+    dst[size - 1] = '\0';
+}
+
+// Chaîne de l'ancienne disposition : s'arrête sur 0 ou sur un octet effacé
+static void readLegacyString(int addr, size_t maxLen, char *dst) {
+    size_t i = 0;
+    for (; i < maxLen; i++) {
+        byte b = EEPROM.read(addr + i);
+        if (b == 0xFF || b == 0) break;
+        dst[i] = b;
+    }
+    dst[i] = '\0';
+}
+
+static void defaultConfig() {
+    memset(&config, 0, sizeof(config));
+    config.scanDelayMs = 3000;
+    strcpy(config.webAccessCode, "admin");
+    config.readMemoryEnabled = 1;
+    strcpy(config.readProfile, "full");
+    config.rfGain = RF_GAIN_DEFAULT;
+    config.rfTimerReload = RF_TIMER_RELOAD_DEFAULT;
+    config.rfAutoTune = 1;
+    config.mqttPort = 1883;
+}
+
+static void migrateLegacyLayout() {
+    defaultConfig();
+    readLegacyString(LEGACY_API_URL_ADDR, API_URL_MAXLEN, config.apiUrl);
+    readLegacyString(LEGACY_WIFI_SSID_ADDR, WIFI_SSID_MAXLEN, config.wifiSsid);
+    readLegacyString(LEGACY_WIFI_PASS_ADDR, WIFI_PASS_MAXLEN, config.wifiPass);
+    uint32_t delayMs = 0;
+    bool delayValid = true;
+    for (int i = 0; i < 4; i++) {
+        byte b = EEPROM.read(LEGACY_SCAN_DELAY_ADDR + i);
+        if (b == 0xFF) delayValid = false;
+        delayMs |= ((uint32_t)b) << (8 * i);
+    }
+    if (delayValid && delayMs >= 500) config.scanDelayMs = delayMs;
+    readLegacyString(LEGACY_WEB_CODE_ADDR, WEB_CODE_MAXLEN, config.webAccessCode);
+    if (config.webAccessCode[0] == '\0') strcpy(config.webAccessCode, "admin");
+    byte readMemory = EEPROM.read(LEGACY_READ_MEMORY_ADDR);
+    if (readMemory != 0xFF) config.readMemoryEnabled = readMemory != 0;
+}
+
+// Recopie le bloc dans les variables globales utilisées par les autres modules
+static void applyConfig() {
+    config.apiUrl[API_URL_MAXLEN] = '\0';
+    config.wifiSsid[WIFI_SSID_MAXLEN] = '\0';
+    config.wifiPass[WIFI_PASS_MAXLEN] = '\0';
+    config.webAccessCode[WEB_CODE_MAXLEN] = '\0';
+    apiUrl = config.apiUrl;
+    if (apiUrl.length() == 0) apiUrl = "http://";
+    wifiSsid = config.wifiSsid;
+    wifiPass = config.wifiPass;
+    wifiSsid.trim();
+    wifiPass.trim();
+    scanDelayMs = config.scanDelayMs < 500 ? 3000 : config.scanDelayMs;
+    webAccessCode = config.webAccessCode;
+    if (webAccessCode.length() == 0) webAccessCode = "admin";
+    readMemoryEnabled = config.readMemoryEnabled != 0;
+    config.readProfile[READ_PROFILE_NAME_MAXLEN] = '\0';
+    readProfileName = config.readProfile;
+    if (readProfileName.length() == 0) readProfileName = "full";
+    rfGain = config.rfGain & 0x70;
+    rfTimerReload = config.rfTimerReload;
+    rfAutoTune = config.rfAutoTune != 0;
+    config.mqttHost[MQTT_HOST_MAXLEN] = '\0';
+    config.mqttUser[MQTT_USER_MAXLEN] = '\0';
+    config.mqttPass[MQTT_PASS_MAXLEN] = '\0';
+    config.mqttTopic[MQTT_TOPIC_MAXLEN] = '\0';
+    mqttEnabled = config.mqttEnabled != 0;
+    mqttPort = config.mqttPort ? config.mqttPort : 1883;
+    mqttHost = config.mqttHost;
+    mqttUser = config.mqttUser;
+    mqttPass = config.mqttPass;
+    mqttTopic = config.mqttTopic;
+    apiEncoding = config.apiEncoding < API_ENCODING_COUNT ? (uint8_t)config.apiEncoding : (uint8_t)API_ENCODING_FORM;
+}
+
+// === Instantané et journal ===
+// Nouvel instantané écrit à côté puis renommé : une coupure laisse l'ancien intact.
+// Le journal n'est supprimé qu'ensuite ; le rejouer sur le nouvel instantané
+// redonne le même état.
+static bool writeSnapshot() {
+    unsigned long start = micros();
+    config.magic = CONFIG_MAGIC;
+    config.version = CONFIG_VERSION;
+    config.length = sizeof(ConfigBlob);
+    config.crc = configCrc(config);
+    File f = LittleFS.open(CONFIG_SNAPSHOT_TMP, "w");
+    if (!f) return false;
+    bool ok = f.write((const uint8_t *)&config, sizeof(config)) == sizeof(config);
+    f.close();
+    if (!ok || !LittleFS.rename(CONFIG_SNAPSHOT_TMP, CONFIG_SNAPSHOT_PATH)) {
+        LittleFS.remove(CONFIG_SNAPSHOT_TMP);
+        return false;
+    }
+    LittleFS.remove(CONFIG_JOURNAL_PATH);
+    stats.journalBytes = 0;
+    stats.journalRecords = 0;
+    stats.compactions++;
+    stats.lastCompactionUs = micros() - start;
+    compactionDue = false;
+    return true;
+}
+
+// Rejoue le journal sur config ; s'arrête au premier enregistrement incomplet
+// ou corrompu (écriture interrompue par une coupure)
+static void replayJournal() {
+    stats.journalBytes = 0;
+    stats.journalRecords = 0;
+    if (!LittleFS.exists(CONFIG_JOURNAL_PATH)) return;
+    File f = LittleFS.open(CONFIG_JOURNAL_PATH, "r");
+    if (!f) return;
+    size_t size = f.size();
+    size_t pos = 0;
+    static uint8_t data[offsetof(ConfigBlob, crc)];
+    while (pos + sizeof(ConfigRecord) + 4 <= size) {
+        ConfigRecord rec;
+        uint32_t crc;
+        if (f.read((uint8_t *)&rec, sizeof(rec)) != sizeof(rec)) break;
+        if (rec.magic != CONFIG_RECORD_MAGIC || rec.version == 0 || rec.version > CONFIG_VERSION ||
+            rec.length == 0 || rec.offset + rec.length > configPayloadSizes[rec.version]) break;
+        if (f.read(data, rec.length) != rec.length) break;
+        if (f.read((uint8_t *)&crc, sizeof(crc)) != sizeof(crc)) break;
+        uint32_t expected = crc32Update(crc32Update(0, (const uint8_t *)&rec, sizeof(rec)), data, rec.length);
+        if (crc != expected) break;
+        memcpy((uint8_t *)&config + rec.offset, data, rec.length);
+        pos += sizeof(rec) + rec.length + sizeof(crc);
+        stats.journalRecords++;
+    }
+    f.close();
+    stats.journalBytes = pos;
+    if (pos < size) {
+        // Fin de journal illisible : on repart d'un instantané propre
+        serialLog().printf("[CFG] Journal tronqué à %u/%u octets\n", (unsigned)pos, (unsigned)size);
+        compactionDue = true;
+    }
+}
+
+// Ajoute la nouvelle valeur d'un champ (ou de champs contigus) au journal
+static bool journalAppend(size_t offset, size_t length) {
+    unsigned long start = micros();
+    if (compactionDue && writeSnapshot()) {
+        // L'instantané contient déjà la valeur modifiée
+        stats.lastCommitUs = micros() - start;
+        return true;
+    }
+    ConfigRecord rec = {CONFIG_RECORD_MAGIC, CONFIG_VERSION, (uint16_t)offset, (uint16_t)length};
+    const uint8_t *data = (const uint8_t *)&config + offset;
+    uint32_t crc = crc32Update(crc32Update(0, (const uint8_t *)&rec, sizeof(rec)), data, length);
+    File f = LittleFS.open(CONFIG_JOURNAL_PATH, "a");
+    if (!f) return false;
+    bool ok = f.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec) &&
+              f.write(data, length) == length &&
+              f.write((const uint8_t *)&crc, sizeof(crc)) == sizeof(crc);
+    f.close();
+    if (!ok) {
+        compactionDue = true;
+        return false;
+    }
+    stats.journalBytes += sizeof(rec) + length + sizeof(crc);
+    stats.journalRecords++;
+    stats.appends++;
+    stats.lastCommitUs = micros() - start;
+    if (stats.journalBytes > CONFIG_JOURNAL_MAX_BYTES) compactionDue = true;
+    return true;
+}
+
+// Champ texte : seuls les octets utiles (jusqu'au '\0' inclus) sont journalisés
+#define JOURNAL_STRING(field) journalAppend(offsetof(ConfigBlob, field), strlen(config.field) + 1)
+#define JOURNAL_FIELD(field) journalAppend(offsetof(ConfigBlob, field), sizeof(config.field))
+
+// Charge la configuration : instantané + journal, ou migration depuis l'EEPROM
+void loadSettings() {
+    unsigned long start = micros();
+    LittleFS.begin();
+    bool loaded = false;
+    static uint8_t raw[sizeof(ConfigBlob)];
+    memset(raw, 0, sizeof(raw));
+    File f = LittleFS.open(CONFIG_SNAPSHOT_PATH, "r");
+    if (f) {
+        f.read(raw, sizeof(raw));
+        f.close();
+        loaded = configAccept(raw);
+    }
+    if (LittleFS.exists(CONFIG_SNAPSHOT_TMP)) LittleFS.remove(CONFIG_SNAPSHOT_TMP);
+    if (loaded) {
+        uint16_t version = config.version;
+        replayJournal();
+        serialLog().printf("[CFG] Configuration v%u chargée (%u enregistrements rejoués)\n", version,
+                           (unsigned)stats.journalRecords);
+        // Ancienne version : réécrite au format courant
+        if (compactionDue || version != CONFIG_VERSION) writeSnapshot();
+    } else {
+        // Première mise en route : reprise de l'EEPROM (bloc v1 ou ancienne disposition)
+        EEPROM.begin(EEPROM_SIZE);
+        EEPROM.get(0, raw);
+        if (configAccept(raw)) {
+            serialLog().println("[CFG] Migration du bloc EEPROM vers LittleFS");
+        } else {
+            serialLog().println("[CFG] Migration de l'ancienne disposition EEPROM");
+            migrateLegacyLayout();
+        }
+        EEPROM.end();
+        writeSnapshot();
+    }
+    applyConfig();
+    stats.loadUs = micros() - start;
+}
+
+// Tout est écrit au fil de l'eau ; compacte si nécessaire (avant un redémarrage)
+bool flushSettings() {
+    return !compactionDue || writeSnapshot();
+}
+
+// Compaction différée, hors des gestionnaires web
+void settingsLoop() {
+    if (compactionDue) writeSnapshot();
+}
+
+const ConfigStats &settingsStats() {
+    return stats;
+}
+
+// Fonction pour sauvegarder l'URL de l'API
+void saveApiUrl(const String& url) {
+    copyField(config.apiUrl, sizeof(config.apiUrl), url);
+    JOURNAL_STRING(apiUrl);
+    apiUrl = url;
+}
+
+void saveWifiConfig(const String& ssid, const String& pass) {
+    copyField(config.wifiSsid, sizeof(config.wifiSsid), ssid);
+    copyField(config.wifiPass, sizeof(config.wifiPass), pass);
+    // SSID et mot de passe dans le même enregistrement : jamais l'un sans l'autre
+    journalAppend(offsetof(ConfigBlob, wifiSsid), sizeof(config.wifiSsid) + sizeof(config.wifiPass));
+    wifiSsid = ssid;
+    wifiPass = pass;
+}
+
+void saveApiEncoding(uint8_t encoding) {
+    config.apiEncoding = encoding;
+    JOURNAL_FIELD(apiEncoding);
+    apiEncoding = encoding;
+}
+
+// Fonction pour sauvegarder le délai entre scans RFID
+void saveScanDelay(unsigned long val) {
+    config.scanDelayMs = val;
+    JOURNAL_FIELD(scanDelayMs);
+    scanDelayMs = val;
+}
+
+// Fonction pour sauvegarder le code d'accès à l'interface web
+void saveWebAccessCode(const String& code) {
+    copyField(config.webAccessCode, sizeof(config.webAccessCode), code);
+    JOURNAL_STRING(webAccessCode);
+    webAccessCode = code;
+}
+
+void saveReadMemoryEnabled(bool enabled) {
+    config.readMemoryEnabled = enabled ? 1 : 0;
+    JOURNAL_FIELD(readMemoryEnabled);
+    readMemoryEnabled = enabled;
+}
+
+void saveRfTuning(uint8_t gain, uint16_t timerReload, bool autoTune) {
+    config.rfGain = gain;
+    config.rfTimerReload = timerReload;
+    config.rfAutoTune = autoTune ? 1 : 0;
+    // Champs contigus : un seul enregistrement
+    journalAppend(offsetof(ConfigBlob, rfGain), sizeof(config.rfGain) + sizeof(config.rfTimerReload) +
+                  sizeof(config.rfAutoTune));
+    rfGain = gain;
+    rfTimerReload = timerReload;
+    rfAutoTune = autoTune;
+}
+
+void saveReadProfile(const String& name) {
+    copyField(config.readProfile, sizeof(config.readProfile), name);
+    JOURNAL_STRING(readProfile);
+    readProfileName = config.readProfile;
+}
+
+void saveMqttConfig(bool enabled, const String& host, uint16_t port, const String& user, const String& pass,
+                    const String& topic) {
+    config.mqttEnabled = enabled ? 1 : 0;
+    config.mqttPort = port;
+    copyField(config.mqttHost, sizeof(config.mqttHost), host);
+    copyField(config.mqttUser, sizeof(config.mqttUser), user);
+    copyField(config.mqttPass, sizeof(config.mqttPass), pass);
+    copyField(config.mqttTopic, sizeof(config.mqttTopic), topic);
+    // Champs contigus : un seul enregistrement, jamais un hôte sans son port
+    journalAppend(offsetof(ConfigBlob, mqttEnabled), offsetof(ConfigBlob, apiEncoding) - offsetof(ConfigBlob, mqttEnabled));
+    mqttEnabled = enabled;
+    mqttPort = port;
+    mqttHost = config.mqttHost;
+    mqttUser = config.mqttUser;
+    mqttPass = config.mqttPass;
+    mqttTopic = config.mqttTopic;
+}
@@ -0,0 +1,380 @@
+/*
+ * Boîte d'envoi persistante : séquence, copie en flash et renvois idempotents
+ */
+#include <upload_outbox.h>
+#include <LittleFS.h>
+#include <config.h>
+#include <settings.h>
+#include <link_frame.h>
+#include <api_client.h>
+#include <mqtt_client.h>
+#include <coap_uplink.h>
+#include <scan_pipeline.h>
+#include <serial_link.h>
+
+#define OUTBOX_RECORD_MAGIC 0x4F42      // "BO" en little-endian
+#define OUTBOX_STATE_MAGIC  0x3158424FUL  // "OBX1"
+#define OUTBOX_FLAG_CARD    0x01
+
+// Enregistrement de taille fixe : l'événement d'indice i est à i * sizeof
+struct __attribute__((packed)) OutboxRecord {
+    uint16_t magic;
+    uint8_t flags;
+    uint8_t sak;
+    uint32_t sequence;
+    uint32_t timestamp;
+    uint8_t piccType;
+    char uid[UID_HEX_MAX];
+    char fields[SCAN_FIELDS_MAXLEN];
+    uint16_t crc;               // CRC-16 de tout ce qui précède
+};
+
+struct __attribute__((packed)) OutboxState {
+    uint32_t magic;
+    uint32_t ceiling;           // premier numéro non réservé
+    uint32_t watermark;
+    uint16_t crc;
+};
+
+// Fichiers gardés ouverts : ni allocation ni recherche de métadonnées par scan
+static File eventsFile;
+static File stateFile;
+static OutboxStats stats;
+static uint32_t ceiling = 1;
+static uint32_t persistedWatermark = 0;
+// Acquittés encore dans le fichier depuis la dernière écriture de l'état :
+// ceux qu'un redémarrage renverrait
+static uint16_t unflushedAcks = 0;
+static unsigned long lastStateFlushMs = 0;
+static unsigned long lastAttemptMs = 0;
+static unsigned long retryDelayMs = 0;
+static char device[DEVICE_ID_MAXLEN];
+
+// Enregistrements [firstPending, fileRecords) : numéro et acquittement hors
+// ordre, dans un anneau décalé de slotBase (la compaction ne déplace rien)
+static uint16_t firstPending = 0;
+static uint16_t slotBase = 0;
+static uint32_t pendingSeq[OUTBOX_CAPACITY];
+static uint32_t ackedBits[OUTBOX_CAPACITY / 32];
+
+static inline uint16_t slot(uint16_t index) {
+    return (index + slotBase) % OUTBOX_CAPACITY;
+}
+
+static inline bool slotAcked(uint16_t index) {
+    uint16_t s = slot(index);
+    return (ackedBits[s / 32] >> (s % 32)) & 1;
+}
+
+static inline void setAcked(uint16_t index, bool acked) {
+    uint16_t s = slot(index);
+    if (acked) ackedBits[s / 32] |= 1UL << (s % 32);
+    else ackedBits[s / 32] &= ~(1UL << (s % 32));
+}
+
+// Le filigrane suit la suite acquittée en tête
+static void advance() {
+    while (firstPending < stats.fileRecords && slotAcked(firstPending)) {
+        stats.watermark = pendingSeq[slot(firstPending)];
+        setAcked(firstPending, false);
+        firstPending++;
+        unflushedAcks++;
+    }
+}
+
+// Plus ancien en attente abandonné : boîte pleine ou enregistrement illisible
+static void dropOldest() {
+    setAcked(firstPending, true);
+    stats.pending--;
+    stats.dropped++;
+    advance();
+}
+
+// === État : plafond de séquence et filigrane ===
+static bool writeState() {
+    if (!stateFile) return false;
+    OutboxState s = {OUTBOX_STATE_MAGIC, ceiling, stats.watermark, 0};
+    s.crc = linkCrc16((const uint8_t *)&s, offsetof(OutboxState, crc));
+    // Réécrit sur place, validé au flush
+    stateFile.seek(0, SeekSet);
+    bool ok = stateFile.write((const uint8_t *)&s, sizeof(s)) == sizeof(s);
+    stateFile.flush();
+    persistedWatermark = stats.watermark;
+    unflushedAcks = 0;
+    lastStateFlushMs = millis();
+    stats.stateWrites++;
+    return ok;
+}
+
+static void reserve() {
+    ceiling = stats.nextSequence + OUTBOX_SEQ_BLOCK;
+    writeState();
+}
+
+// === Enregistrements ===
+static bool recordValid(const OutboxRecord &rec) {
+    return rec.magic == OUTBOX_RECORD_MAGIC && rec.sequence &&
+           rec.crc == linkCrc16((const uint8_t *)&rec, offsetof(OutboxRecord, crc));
+}
+
+static bool readRecord(uint16_t index, OutboxRecord &rec) {
+    File f = LittleFS.open(OUTBOX_EVENTS_PATH, "r");
+    if (!f) return false;
+    bool ok = f.seek((uint32_t)index * sizeof(rec), SeekSet) && f.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    f.close();
+    return ok && recordValid(rec);
+}
+
+static ScanRecord recordScan(const OutboxRecord &rec) {
+    ScanRecord scan = scanRecord(rec.uid, rec.fields);
+    scan.hasCard = rec.flags & OUTBOX_FLAG_CARD;
+    scan.sak = rec.sak;
+    scan.piccType = rec.piccType;
+    scan.timestamp = rec.timestamp;
+    scan.sequence = rec.sequence;
+    scan.device = deviceId();
+    return scan;
+}
+
+// Les enregistrements en attente recopiés dans un nouveau fichier, renommé
+// ensuite : une coupure laisse l'ancien intact
+static void compact() {
+    File in = LittleFS.open(OUTBOX_EVENTS_PATH, "r");
+    File out = LittleFS.open(OUTBOX_EVENTS_NEW, "w");
+    bool ok = in && out && in.seek((uint32_t)firstPending * sizeof(OutboxRecord), SeekSet);
+    OutboxRecord rec;
+    for (uint16_t i = firstPending; ok && i < stats.fileRecords; i++) {
+        ok = in.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec) &&
+             out.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    }
+    in.close();
+    out.close();
+    if (!ok) {
+        LittleFS.remove(OUTBOX_EVENTS_NEW);
+        return;
+    }
+    eventsFile.close();
+    if (!LittleFS.rename(OUTBOX_EVENTS_NEW, OUTBOX_EVENTS_PATH)) {
+        LittleFS.remove(OUTBOX_EVENTS_NEW);
+    } else {
+        slotBase = slot(firstPending);
+        stats.fileRecords -= firstPending;
+        firstPending = 0;
+        unflushedAcks = 0;
+        stats.compactions++;
+    }
+    eventsFile = LittleFS.open(OUTBOX_EVENTS_PATH, "a");
+}
+
+// === API ===
+const char *deviceId() {
+    if (!device[0]) snprintf(device, sizeof(device), "%s-%08lx", HOSTNAME, (unsigned long)ESP.getChipId());
+    return device;
+}
+
+void outboxBegin() {
+    deviceId();
+    LittleFS.mkdir(OUTBOX_DIR);
+    eventsFile.close();
+    stateFile.close();
+    memset(&stats, 0, sizeof(stats));
+    memset(ackedBits, 0, sizeof(ackedBits));
+    firstPending = 0;
+    slotBase = 0;
+    unflushedAcks = 0;
+    lastAttemptMs = 0;
+    retryDelayMs = 0;
+    ceiling = 1;
+
+    stateFile = LittleFS.open(OUTBOX_STATE_PATH, LittleFS.exists(OUTBOX_STATE_PATH) ? "r+" : "w+");
+    OutboxState s;
+    if (stateFile && stateFile.read((uint8_t *)&s, sizeof(s)) == sizeof(s) && s.magic == OUTBOX_STATE_MAGIC &&
+        s.crc == linkCrc16((const uint8_t *)&s, offsetof(OutboxState, crc)) && s.ceiling) {
+        ceiling = s.ceiling;
+        stats.watermark = s.watermark;
+    }
+    // Les numéros réservés avant le redémarrage sont tous considérés utilisés
+    stats.nextSequence = ceiling;
+    persistedWatermark = stats.watermark;
+
+    // Relecture des événements ; une fin incomplète (coupure pendant un ajout) est coupée
+    size_t valid = 0;
+    File in = LittleFS.open(OUTBOX_EVENTS_PATH, "r");
+    if (in) {
+        OutboxRecord rec;
+        while (stats.fileRecords < OUTBOX_FILE_MAX && in.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec) &&
+               recordValid(rec)) {
+            uint16_t index = stats.fileRecords++;
+            valid += sizeof(rec);
+            if (rec.sequence >= stats.nextSequence) stats.nextSequence = rec.sequence + 1;
+            if (rec.sequence <= stats.watermark) {
+                firstPending = index + 1;
+                continue;
+            }
+            if (index - firstPending == OUTBOX_CAPACITY) dropOldest();
+            pendingSeq[slot(index)] = rec.sequence;
+            stats.pending++;
+        }
+        in.close();
+    }
+    eventsFile = LittleFS.open(OUTBOX_EVENTS_PATH, "a");
+    if (eventsFile && eventsFile.size() > valid) eventsFile.truncate(valid);
+    stats.recovered = stats.pending;
+    reserve();
+    if (stats.pending) {
+        serialLog().printf("[OUTBOX] %u événement(s) à renvoyer, séquence %lu\n", stats.pending,
+                           (unsigned long)stats.nextSequence);
+    }
+}
+
+bool outboxAppend(ScanRecord &scan) {
+    scan.device = deviceId();
+    scan.sequence = stats.nextSequence++;
+    // Réserve normalement renouvelée par outboxLoop()
+    if (stats.nextSequence >= ceiling) reserve();
+    if (!eventsFile) {
+        stats.notDurable++;
+        return false;
+    }
+    if (!stats.pending && stats.fileRecords) {
+        // Tout est acquitté : le fichier repart de zéro, sans suppression ni réouverture
+        eventsFile.truncate(0);
+        stats.fileRecords = 0;
+        firstPending = 0;
+        unflushedAcks = 0;
+    }
+    // Fichier plein de morts en tête (hors ligne, les abandonnés s'accumulent) :
+    // compacté ici plutôt que de perdre l'événement
+    if (stats.fileRecords == OUTBOX_FILE_MAX && firstPending > 0) compact();
+    if (stats.fileRecords == OUTBOX_FILE_MAX) {
+        stats.notDurable++;
+        return false;
+    }
+    if (stats.fileRecords - firstPending == OUTBOX_CAPACITY) dropOldest();
+
+    OutboxRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = OUTBOX_RECORD_MAGIC;
+    rec.flags = scan.hasCard ? OUTBOX_FLAG_CARD : 0;
+    rec.sak = scan.sak;
+    rec.sequence = scan.sequence;
+    rec.timestamp = scan.timestamp;
+    rec.piccType = scan.piccType;
+    snprintf(rec.uid, sizeof(rec.uid), "%s", scan.uid);
+    snprintf(rec.fields, sizeof(rec.fields), "%s", scan.fields ? scan.fields : "");
+    rec.crc = linkCrc16((const uint8_t *)&rec, offsetof(OutboxRecord, crc));
+    size_t written = eventsFile.write((const uint8_t *)&rec, sizeof(rec));
+    eventsFile.flush();
+    if (written != sizeof(rec)) {
+        // Enregistrement partiel retiré : les suivants restent alignés
+        eventsFile.truncate((uint32_t)stats.fileRecords * sizeof(rec));
+        stats.notDurable++;
+        return false;
+    }
+    uint16_t index = stats.fileRecords++;
+    pendingSeq[slot(index)] = scan.sequence;
+    setAcked(index, false);
+    stats.pending++;
+    stats.appended++;
+    return true;
+}
+
+void outboxAck(uint32_t sequence) {
+    if (!sequence || sequence <= stats.watermark) return;
+    for (uint16_t i = firstPending; i < stats.fileRecords; i++) {
+        if (pendingSeq[slot(i)] != sequence) continue;
+        if (slotAcked(i)) return;
+        setAcked(i, true);
+        stats.pending--;
+        stats.acked++;
+        advance();
+        // Serveur joignable : le reste de la boîte suit sans attendre
+        retryDelayMs = 0;
+        return;
+    }
+}
+
+void outboxResult(uint32_t sequence, int code) {
+    // 4xx : le serveur a traité la requête, un renvoi n'y changerait rien ;
+    // sauf 408 (délai dépassé) et 429 (trop de requêtes), à renvoyer plus tard
+    if (code >= 200 && code < 500 && code != 408 && code != 429) {
+        outboxAck(sequence);
+        return;
+    }
+    stats.failures++;
+    lastAttemptMs = millis();
+    retryDelayMs = retryDelayMs ? min(retryDelayMs * 2, (unsigned long)OUTBOX_RETRY_MAX_MS) : OUTBOX_RETRY_MIN_MS;
+}
+
+void outboxLoop() {
+    unsigned long now = millis();
+    // Réserve renouvelée avant d'être épuisée : pas d'écriture de l'état sur le chemin de scan
+    if (ceiling - stats.nextSequence < OUTBOX_SEQ_BLOCK / 2) {
+        reserve();
+    } else if (unflushedAcks > 1 && now - lastStateFlushMs >= OUTBOX_STATE_FLUSH_MS) {
+        // En ligne, un seul acquitté reste dans le fichier jusqu'au prochain
+        // ajout : un renvoi possible après redémarrage ne vaut pas une écriture
+        writeState();
+    }
+    if (firstPending >= OUTBOX_COMPACT_RECORDS && stats.pending) compact();
+
+    // Un renvoi par passage, le plus ancien d'abord, quand aucun scan n'est en
+    // cours ; hors ligne, seuls la réserve et la compaction ci-dessus tournent
+    if (!wifiConnected || !stats.pending || now - lastAttemptMs < retryDelayMs) return;
+    if (!scanPipelineIdle() || coapExchangeActive()) return;
+    // Publications MQTT en attente : la session les renvoie elle-même
+    if (mqttActive() && mqttStats().inflight) return;
+    OutboxRecord rec;
+    if (!readRecord(firstPending, rec) || rec.sequence != pendingSeq[slot(firstPending)]) {
+        serialLog().printf("[OUTBOX] Enregistrement %u illisible, abandonné\n", firstPending);
+        dropOldest();
+        return;
+    }
+    ScanRecord scan = recordScan(rec);
+    stats.replayed++;
+    lastAttemptMs = now;
+    // MQTT : acquitté au PUBACK ; sinon CoAP ou POST HTTP selon l'URL, même clé
+    if (mqttPublishScan(scan)) return;
+    outboxResult(rec.sequence, sendScanToApi(scan));
+}
+
+const OutboxStats &outboxStats() {
+    return stats;
+}
+
+String outboxStatusJson() {
+    String json;
+    json.reserve(320);
+    json = "{\"device\":\"";
+    json += deviceId();
+    json += "\",\"nextSequence\":";
+    json += stats.nextSequence;
+    json += ",\"watermark\":";
+    json += stats.watermark;
+    json += ",\"pending\":";
+    json += stats.pending;
+    json += ",\"fileRecords\":";
+    json += stats.fileRecords;
+    json += ",\"appended\":";
+    json += stats.appended;
+    json += ",\"acked\":";
+    json += stats.acked;
+    json += ",\"replayed\":";
+    json += stats.replayed;
+    json += ",\"failures\":";
+    json += stats.failures;
+    json += ",\"dropped\":";
+    json += stats.dropped;
+    json += ",\"notDurable\":";
+    json += stats.notDurable;
+    json += ",\"stateWrites\":";
+    json += stats.stateWrites;
+    json += ",\"compactions\":";
+    json += stats.compactions;
+    json += ",\"recovered\":";
+    json += stats.recovered;
+    json += ",\"retryDelayMs\":";
+    json += retryDelayMs;
+    json += "}";
+    return json;
+}
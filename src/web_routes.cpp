@@ -0,0 +1,901 @@
+/*
+ * Serveur web : interface, portail captif et routes /api
+ */
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <web_routes.h>
+#include <scanner.h>
+#include <settings.h>
+#include <api_client.h>
+#include <card_image.h>
+#include <acl.h>
+#include <metrics.h>
+#include <scan_pipeline.h>
+#include <rf_tuning.h>
+#include <rc522_health.h>
+#include <ndef_tag.h>
+#include <provisioning.h>
+#include <mqtt_client.h>
+#include <upload_outbox.h>
+#include <decision_cache.h>
+#include <serial_link.h>
+#include <webpage.h>
+#include <login_page.h>
+
+ESP8266WebServer webServer(80);
+
+// === Sections du tableau de bord ===
+// Chaque section porte une version ; /api/dashboard ne renvoie que celles
+// dont la version diffère de celle connue du client.
+#define DASHBOARD_STATUS_PERIOD_MS 5000
+
+enum DashboardSection : uint8_t {
+    SECTION_STATUS,  // mode, mémoire, uptime, RSSI, santé du RC522
+    SECTION_CARD,    // dernière carte et son résumé
+    SECTION_LOG,     // historique des envois à l'API
+    SECTION_COUNT
+};
+static const char *const sectionArgs[SECTION_COUNT] = {"s", "c", "l"};
+
+// L'état change en continu (mémoire, uptime) : nouvelle version à chaque
+// changement de mode, défaut du RC522 ou carte passée en encodage en série,
+// et au plus toutes les DASHBOARD_STATUS_PERIOD_MS
+static uint32_t statusVersion() {
+    static uint32_t version = 0;
+    static ScanMode versionMode = MODE_COUNT;
+    static uint32_t versionFaults = 0;
+    static unsigned long versionMs = 0;
+    const Rc522HealthStats &rc522 = rc522HealthStats();
+    const ProvisionStats &provision = provisionStats();
+    uint32_t faults = rc522.faults + rc522.recoveries + provision.written + provision.failures +
+                      provision.duplicates + provision.notBlank;
+    if (mode != versionMode || faults != versionFaults || millis() - versionMs >= DASHBOARD_STATUS_PERIOD_MS) {
+        version++;
+        versionMode = mode;
+        versionFaults = faults;
+        versionMs = millis();
+    }
+    return version;
+}
+
+static uint32_t sectionVersion(uint8_t section) {
+    switch (section) {
+    case SECTION_STATUS: return statusVersion();
+    case SECTION_CARD: return lastScan.version;
+    default: return apiLogTotal;
+    }
+}
+
+static void appendJsonString(String &json, const char *text) {
+    json += '"';
+    for (; *text; text++) {
+        char c = *text;
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if ((uint8_t)c < 0x20) {
+            json += c == '\n' ? "\\n" : " ";
+        } else {
+            json += c;
+        }
+    }
+    json += '"';
+}
+
+static void appendStatusFields(String &json) {
+    json += "\"mode\":\"";
+    json += scanModeName(mode);
+    json += "\",\"memory\":";
+    json += ESP.getFreeHeap();
+    json += ",\"uptime\":";
+    json += millis() / 1000;
+    json += ",\"rssi\":";
+    json += WiFi.RSSI();
+    const PipelineStats &pipeline = scanPipelineStats();
+    json += ",\"queue\":";
+    json += pipeline.capturedDepth + pipeline.decidedDepth;
+    json += ",\"drops\":";
+    json += pipeline.drops;
+    const Rc522HealthStats &rc522 = rc522HealthStats();
+    json += ",\"rc522\":{\"ok\":";
+    json += rc522.healthy ? "true" : "false";
+    json += ",\"version\":";
+    json += rc522.version;
+    json += ",\"faults\":";
+    json += rc522.faults;
+    json += ",\"recoveries\":";
+    json += rc522.recoveries;
+    json += ",\"failedRecoveries\":";
+    json += rc522.failedRecoveries;
+    json += ",\"lastFault\":\"";
+    json += rc522FaultName(rc522.lastFault);
+    // Secondes depuis le démarrage au moment du défaut, -1 si aucun
+    json += "\",\"lastFaultAt\":";
+    json += rc522.lastFaultMs ? (long)(rc522.lastFaultMs / 1000) : -1L;
+    json += ",\"lastRecoveryUs\":";
+    json += rc522.lastRecoveryUs;
+    const ProvisionStats &provision = provisionStats();
+    json += "},\"provision\":{\"queued\":";
+    json += provision.queued;
+    json += ",\"next\":";
+    json += provision.next;
+    json += ",\"failures\":";
+    json += provision.failures;
+    json += ",\"rejected\":";
+    json += provision.duplicates + provision.notBlank;
+    json += ",\"perHour\":";
+    json += provisionCardsPerHour();
+    json += "}";
+}
+
+// Entrées de l'historique postérieures à la version after (ordre chronologique)
+static void appendApiLogEntries(String &json, uint32_t after) {
+    uint32_t fresh = apiLogTotal - after;
+    if (after > apiLogTotal || fresh > API_LOG_SIZE) fresh = API_LOG_SIZE;
+    json += "[";
+    int count = 0;
+    for (int i = API_LOG_SIZE - fresh; i < API_LOG_SIZE; i++) {
+        int idx = (apiLogIndex + i) % API_LOG_SIZE;
+        if (apiLog[idx].uid[0] == '\0') continue;
+        if (count > 0) json += ",";
+        json += "{\"t\":";
+        json += apiLog[idx].timestamp;
+        json += ",\"uid\":\"";
+        json += apiLog[idx].uid;
+        json += "\",\"code\":";
+        json += apiLog[idx].httpCode;
+        json += ",\"url\":\"";
+        json += apiLog[idx].url;
+        json += "\"}";
+        count++;
+        // Permettre au système de respirer pendant la construction
+        if (count % 5 == 0) yield();
+    }
+    json += "]";
+}
+
+// Sections dont la version diffère de known[] (ou inconnue du client, bit
+// absent de knownMask) ; json reste vide si rien n'a changé
+static void dashboardJson(String &json, const uint32_t *known, uint8_t knownMask) {
+    uint32_t versions[SECTION_COUNT];
+    bool changed[SECTION_COUNT];
+    bool any = false;
+    for (uint8_t s = 0; s < SECTION_COUNT; s++) {
+        versions[s] = sectionVersion(s);
+        changed[s] = !(knownMask & (1 << s)) || known[s] != versions[s];
+        any |= changed[s];
+    }
+    if (!any) return;
+    json.reserve(320 + (changed[SECTION_CARD] ? LAST_CARD_INFO_SIZE : 0) + (changed[SECTION_LOG] ? 1024 : 0));
+    json = "{";
+    if (changed[SECTION_STATUS]) {
+        json += "\"s\":{\"v\":";
+        json += versions[SECTION_STATUS];
+        json += ",";
+        appendStatusFields(json);
+        json += "}";
+    }
+    if (changed[SECTION_CARD]) {
+        if (json.length() > 1) json += ",";
+        json += "\"c\":{\"v\":";
+        json += versions[SECTION_CARD];
+        json += ",\"id\":";
+        json += lastScan.id;
+        json += ",\"uid\":\"";
+        json += lastScan.uid;
+        json += "\",\"type\":\"";
+        json += lastScan.type;
+        json += "\",\"details\":";
+        appendJsonString(json, lastCardInfo);
+        json += "}";
+    }
+    if (changed[SECTION_LOG]) {
+        // full : le client doit remplacer son historique au lieu de le compléter
+        uint32_t after = known[SECTION_LOG];
+        bool full = !(knownMask & (1 << SECTION_LOG)) || after > apiLogTotal || apiLogTotal - after >= API_LOG_SIZE;
+        if (json.length() > 1) json += ",";
+        json += "\"l\":{\"v\":";
+        json += versions[SECTION_LOG];
+        json += ",\"full\":";
+        json += full ? "true" : "false";
+        json += ",\"entries\":";
+        appendApiLogEntries(json, full ? 0 : after);
+        json += "}";
+    }
+    json += "}";
+}
+
+// === Attente longue (/api/lastcard, /api/dashboard) ===
+// Le gestionnaire garde une copie du client (la connexion TCP reste ouverte
+// tant qu'une référence existe) et rend la main au serveur sans répondre ;
+// webServerLoop() répond dès que la donnée attendue change ou à l'échéance.
+// La boucle RFID n'est jamais bloquée par une requête en attente.
+#define LONGPOLL_MAX_CLIENTS 4
+#define LONGPOLL_MAX_WAIT_MS 30000
+
+enum LongPollKind : uint8_t { LONGPOLL_LASTCARD, LONGPOLL_DASHBOARD };
+
+struct LongPollClient {
+    WiFiClient client;
+    LongPollKind kind;
+    uint32_t after[SECTION_COUNT];  // lastcard : after[0] = identifiant de scan
+    unsigned long startMs;
+    unsigned long waitMs;
+};
+static LongPollClient longPolls[LONGPOLL_MAX_CLIENTS];
+static uint8_t longPollCount = 0;
+
+static size_t lastScanJson(char *out, size_t size) {
+    int len = snprintf(out, size, "{\"id\":%lu,\"uid\":\"%s\",\"type\":\"%s\"}",
+                       (unsigned long)lastScan.id, lastScan.uid, lastScan.type);
+    return len < (int)size ? len : size - 1;
+}
+
+static bool longPollPark(LongPollKind kind, const uint32_t *after) {
+    unsigned long wait = strtoul(webServer.arg("wait").c_str(), nullptr, 10);
+    if (wait == 0 || longPollCount >= LONGPOLL_MAX_CLIENTS) return false;
+    LongPollClient &lp = longPolls[longPollCount++];
+    lp.client = webServer.client();
+    lp.kind = kind;
+    memcpy(lp.after, after, sizeof(lp.after));
+    lp.startMs = millis();
+    lp.waitMs = wait > LONGPOLL_MAX_WAIT_MS ? LONGPOLL_MAX_WAIT_MS : wait;
+    return true;
+}
+
+static bool longPollReady(const LongPollClient &lp) {
+    if (lp.kind == LONGPOLL_LASTCARD) return lastScan.id != lp.after[0];
+    for (uint8_t s = 0; s < SECTION_COUNT; s++) {
+        if (sectionVersion(s) != lp.after[s]) return true;
+    }
+    return false;
+}
+
+// Réponse écrite directement sur la socket : le serveur a déjà oublié ce client
+static void rawReply(WiFiClient &client, int code, const char *body, size_t len) {
+    char head[160];
+    int headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+                           "Cache-Control: no-store\r\nConnection: close\r\n\r\n",
+                           code, code == 304 ? "Not Modified" : "OK", (unsigned)len);
+    client.write((const uint8_t *)head, headLen);
+    if (len) client.write((const uint8_t *)body, len);
+    client.stop();
+}
+
+static void longPollReply(LongPollClient &lp) {
+    if (lp.kind == LONGPOLL_LASTCARD) {
+        char body[128];
+        size_t len = lastScanJson(body, sizeof(body));
+        rawReply(lp.client, 200, body, len);
+        return;
+    }
+    String json;
+    dashboardJson(json, lp.after, (1 << SECTION_COUNT) - 1);
+    rawReply(lp.client, json.length() ? 200 : 304, json.c_str(), json.length());
+}
+
+static void longPollService() {
+    for (uint8_t i = 0; i < longPollCount;) {
+        LongPollClient &lp = longPolls[i];
+        if (lp.client.connected() && !longPollReady(lp) && millis() - lp.startMs < lp.waitMs) {
+            i++;
+            continue;
+        }
+        // Donnée plus récente ou échéance : réponse ; client parti : place libérée
+        if (lp.client.connected()) longPollReply(lp);
+        longPolls[i] = longPolls[--longPollCount];
+        longPolls[longPollCount].client = WiFiClient();
+    }
+}
+
+void webServerLoop() {
+    webServer.handleClient();
+    metricsWebRequestEnd();
+    if (longPollCount) longPollService();
+}
+
+// Configuration du serveur web pour interface OTA
+void setupWebServer() {
+    static bool started = false;
+    if (started) return;
+    
+    // Horodatage de chaque requête, clôturé par webServerLoop()
+    webServer.addHook([](const String&, const String&, WiFiClient*, ESP8266WebServer::ContentTypeFunction) {
+        metricsWebRequestStart();
+        return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+    });
+    
+    // Routes pour portail captif (compatibilité smartphone étendue)
+    webServer.on("/generate_204", []() {
+        webServer.sendHeader("Location", "http://192.168.4.1/", true);
+        webServer.send(302, "text/plain", "");
+    });
+    webServer.on("/fwlink", []() {
+        webServer.sendHeader("Location", "http://192.168.4.1/", true);
+        webServer.send(302, "text/plain", "");
+    });
+    webServer.on("/connecttest.txt", []() {
+        webServer.send(200, "text/plain", "Microsoft Connect Test");
+    });
+    webServer.on("/wpad.dat", []() {
+        webServer.send(404, "text/plain", "");
+    });
+    
+    // Routes supplémentaires pour différents types de smartphones
+    webServer.on("/hotspot-detect.html", []() {
+        webServer.sendHeader("Location", "http://192.168.4.1/", true);
+        webServer.send(302, "text/html", "");
+    });
+    webServer.on("/library/test/success.html", []() {
+        webServer.sendHeader("Location", "http://192.168.4.1/", true);
+        webServer.send(302, "text/html", "");
+    });
+    webServer.on("/kindle-wifi/redirect.html", []() {
+        webServer.sendHeader("Location", "http://192.168.4.1/", true);
+        webServer.send(302, "text/html", "");
+    });
+    webServer.on("/success.txt", []() {
+        webServer.send(200, "text/plain", "success");
+    });
+    
+    // Page principale protégée par code
+    webServer.on("/", HTTP_GET, []() {
+        if (!webServer.hasArg("code") || webServer.arg("code") != webAccessCode) {
+            webServer.send(401, "text/html", LOGIN_PAGE);
+            return;
+        }
+        String page = WEB_PAGE;
+        String msg = "";
+        if (webServer.hasArg("msg")) msg = webServer.arg("msg");
+        page.replace("%MSG%", msg);
+        webServer.send(200, "text/html", page);
+    });
+    // Modification du code d'accès via POST sur la page principale
+    webServer.on("/", HTTP_POST, []() {
+        if (!webServer.hasArg("code") || webServer.arg("code") != webAccessCode) {
+            webServer.send(401, "text/html", LOGIN_PAGE);
+            return;
+        }
+        if (webServer.hasArg("newcode")) {
+            saveWebAccessCode(webServer.arg("newcode"));
+            String page = WEB_PAGE;
+            page.replace("%MSG%", "Code modifié !");
+            webServer.send(200, "text/html", page);
+        } else {
+            String page = WEB_PAGE;
+            page.replace("%MSG%", "Erreur : paramètre manquant.");
+            webServer.send(400, "text/html", page);
+        }
+    });
+    // Toutes les routes API sont publiques
+    webServer.on("/api/command", []() {
+        if (webServer.hasArg("cmd")) {
+            String cmd = webServer.arg("cmd");
+            cmd.toUpperCase();
+            scanCommand(cmd.c_str());
+            webServer.send(200, "text/plain", "Commande exécutée: " + cmd);
+        } else {
+            webServer.send(400, "text/plain", "Paramètre 'cmd' manquant");
+        }
+    });
+    webServer.on("/api/write", []() {
+        if (webServer.hasArg("data")) {
+            // ndef=uri|text : message NDEF (lang pour le texte), sinon 48 octets bruts au plus dès le bloc 4
+            String format = webServer.arg("ndef");
+            if (format.length() && format != "uri" && format != "text") {
+                webServer.send(400, "text/plain", "Paramètre 'ndef' : uri ou text");
+                return;
+            }
+            if (format.length()) {
+                NdefKind kind = format == "uri" ? NDEF_KIND_URI : NDEF_KIND_TEXT;
+                if (!ndefPrepareWrite(kind, webServer.arg("data").c_str(), webServer.arg("lang").c_str())) {
+                    webServer.send(400, "text/plain", "Message NDEF trop long");
+                    return;
+                }
+            } else {
+                ndefCancelWrite();
+            }
+            dataToWrite = webServer.arg("data");
+            scanModeActivate(MODE_WRITE);
+            webServer.send(200, "text/plain", dataToWrite);
+        } else {
+            webServer.send(400, "text/plain", "Paramètre 'data' manquant");
+        }
+    });
+    webServer.on("/api/status", []() {
+        // Construction optimisée du JSON pour éviter la fragmentation mémoire
+        String json;
+        json.reserve(384); // Réserver la mémoire à l'avance
+        json = "{";
+        appendStatusFields(json);
+        json += "}";
+        webServer.send(200, "application/json", json);
+    });
+    // Dernier scan en JSON compact ; ?after=ID&wait=ms attend un scan plus
+    // récent que ID (réponse immédiate si ID est dépassé ou inconnu)
+    webServer.on("/api/lastcard", []() {
+        uint32_t after[SECTION_COUNT] = {(uint32_t)strtoul(webServer.arg("after").c_str(), nullptr, 10)};
+        if (webServer.hasArg("after") && after[0] == lastScan.id && longPollPark(LONGPOLL_LASTCARD, after)) return;
+        char body[128];
+        lastScanJson(body, sizeof(body));
+        webServer.sendHeader("Cache-Control", "no-store");
+        webServer.send(200, "application/json", body);
+    });
+    // Résumé HTML détaillé (lecture mémoire) de la dernière carte
+    webServer.on("/api/lastcard/details", []() {
+        webServer.send(200, "text/plain", lastCardInfo);
+    });
+    
+    // API pour l'URL de l'API
+    webServer.on("/api/apiurl", []() {
+        webServer.send(200, "text/plain", apiUrl);
+    });
+    webServer.on("/api/setapiurl", []() {
+        if (webServer.hasArg("url")) {
+            saveApiUrl(webServer.arg("url"));
+            webServer.send(200, "text/plain", "OK");
+        } else {
+            webServer.send(400, "text/plain", "Paramètre 'url' manquant");
+        }
+    });
+    
+    // Encodage du corps des envois : form (historique) ou cbor
+    webServer.on("/api/encoding", []() {
+        if (webServer.method() == HTTP_POST) {
+            ApiEncoding encoding;
+            if (!webServer.hasArg("encoding")) {
+                webServer.send(400, "text/plain", "Paramètre 'encoding' manquant");
+            } else if (!apiEncodingFromName(webServer.arg("encoding").c_str(), encoding)) {
+                webServer.send(400, "text/plain", "Encodage inconnu (form, cbor)");
+            } else {
+                saveApiEncoding(encoding);
+                webServer.send(200, "text/plain", "OK");
+            }
+        } else {
+            webServer.send(200, "text/plain", apiEncodingName((ApiEncoding)apiEncoding));
+        }
+    });
+
+    // API pour la config WiFi
+    webServer.on("/api/wificonfig", []() {
+        String json = "{";
+        json += "\"ssid\":\"" + wifiSsid + "\",";
+        json += "\"pass\":\"" + wifiPass + "\"}";
+        webServer.send(200, "application/json", json);
+    });
+    webServer.on("/api/setwificonfig", []() {
+        if (webServer.hasArg("ssid") && webServer.hasArg("pass")) {
+            saveWifiConfig(webServer.arg("ssid"), webServer.arg("pass"));
+            webServer.send(200, "text/plain", "OK");
+        } else {
+            webServer.send(400, "text/plain", "Paramètres 'ssid' ou 'pass' manquants");
+        }
+    });
+    
+    // API pour le délai entre scans RFID
+    webServer.on("/api/scandelay", []() {
+        if (webServer.method() == HTTP_GET) {
+            webServer.send(200, "text/plain", String(scanDelayMs));
+        } else if (webServer.method() == HTTP_POST) {
+            if (webServer.hasArg("delay")) {
+                unsigned long val = webServer.arg("delay").toInt();
+                if (val < 500) val = 500;
+                saveScanDelay(val);
+                webServer.send(200, "text/plain", "OK");
+            } else {
+                webServer.send(400, "text/plain", "Paramètre 'delay' manquant");
+            }
+        }
+    });
+    
+    // API pour l'historique des envois à l'API (optimisée)
+    webServer.on("/api/apilog", []() {
+        String json;
+        json.reserve(1024); // Réserver mémoire pour éviter la fragmentation
+        appendApiLogEntries(json, 0);
+        webServer.send(200, "application/json", json);
+    });
+    // Tableau de bord agrégé : ?s=&c=&l= versions connues du client, seules les
+    // sections modifiées sont renvoyées (304 si aucune) ; &wait=ms attend un changement
+    webServer.on("/api/dashboard", []() {
+        uint32_t known[SECTION_COUNT] = {0};
+        uint8_t knownMask = 0;
+        for (uint8_t s = 0; s < SECTION_COUNT; s++) {
+            if (!webServer.hasArg(sectionArgs[s])) continue;
+            known[s] = strtoul(webServer.arg(sectionArgs[s]).c_str(), nullptr, 10);
+            knownMask |= 1 << s;
+        }
+        String json;
+        dashboardJson(json, known, knownMask);
+        if (json.length() == 0 && longPollPark(LONGPOLL_DASHBOARD, known)) return;
+        webServer.sendHeader("Cache-Control", "no-store");
+        if (json.length()) webServer.send(200, "application/json", json);
+        else webServer.send(304, "application/json", "");
+    });
+    
+    // Redémarrage (optimisé pour éviter le délai bloquant)
+    webServer.on("/restart", []() {
+        webServer.send(200, "text/html", "<h1>Redémarrage en cours...</h1><script>setTimeout(function(){location.href='/';}, 10000);</script>");
+        webServer.handleClient(); // S'assurer que la réponse est envoyée
+        yield();
+        ESP.restart(); // Redémarrage immédiat sans délai
+    });
+    
+    // Mise à jour du firmware (propre à la cible)
+    setupUpdateRoute();
+    
+    // API pour faire clignoter le buzzer (version non-bloquante)
+    webServer.on("/api/buzzer", []() {
+        int times = 1;
+        int duration = 100;
+        if (webServer.hasArg("times")) times = webServer.arg("times").toInt();
+        if (webServer.hasArg("duration")) duration = webServer.arg("duration").toInt();
+        if (times < 1) times = 1;
+        if (duration < 10) duration = 10;
+        
+        // Version non-bloquante : utilise la fonction existante
+        blinkBuzzer(times, duration);
+        
+        webServer.send(200, "text/plain", "Buzzer OK");
+    });
+    
+    // API pour le code d'accès web
+    webServer.on("/api/webcode", []() {
+        if (webServer.method() == HTTP_GET) {
+            webServer.send(200, "text/plain", webAccessCode);
+        } else if (webServer.method() == HTTP_POST) {
+            if (webServer.hasArg("code")) {
+                saveWebAccessCode(webServer.arg("code"));
+                webServer.send(200, "text/plain", "OK");
+            } else {
+                webServer.send(400, "text/plain", "Paramètre 'code' manquant");
+            }
+        }
+    });
+    
+    // API pour activer/désactiver la lecture mémoire RFID
+    webServer.on("/api/readmemory", []() {
+        if (webServer.method() == HTTP_GET) {
+            webServer.send(200, "text/plain", readMemoryEnabled ? "1" : "0");
+        } else if (webServer.method() == HTTP_POST) {
+            if (webServer.hasArg("enabled")) {
+                bool enabled = (webServer.arg("enabled") == "1" || webServer.arg("enabled") == "true");
+                saveReadMemoryEnabled(enabled);
+                webServer.send(200, "text/plain", "OK");
+            } else {
+                webServer.send(400, "text/plain", "Paramètre 'enabled' manquant");
+            }
+        }
+    });
+    
+    // Profils de lecture : définitions, sélection et temps de lecture
+    webServer.on("/api/profiles", []() {
+        if (webServer.method() == HTTP_POST) {
+            String error;
+            if (!webServer.hasArg("text")) {
+                webServer.send(400, "text/plain", "Paramètre 'text' manquant");
+            } else if (readProfilesSave(webServer.arg("text"), error)) {
+                webServer.send(200, "text/plain", "OK");
+            } else {
+                webServer.send(400, "text/plain", error);
+            }
+        } else if (webServer.hasArg("text")) {
+            webServer.send(200, "text/plain", readProfilesText());
+        } else {
+            webServer.send(200, "application/json", readProfilesJson());
+        }
+    });
+    webServer.on("/api/profile", HTTP_POST, []() {
+        String name = webServer.arg("name");
+        if (!readProfileFind(name.c_str())) {
+            webServer.send(400, "text/plain", "Profil inconnu");
+            return;
+        }
+        saveReadProfile(name);
+        webServer.send(200, "text/plain", "OK");
+    });
+    
+    // Réglages RF du RC522 : état, réglage manuel, calibration
+    webServer.on("/api/rf", []() {
+        if (webServer.method() == HTTP_POST) {
+            uint8_t gain = rfGain;
+            uint16_t reload = rfTimerReload;
+            bool autoTune = rfAutoTune;
+            if (webServer.hasArg("gain")) {
+                // Gain en dB : 33, 38, 43 ou 48 dans les bornes de config.h
+                int db = webServer.arg("gain").toInt();
+                int mask = db == 48 ? 0x70 : db == 43 ? 0x60 : db == 38 ? 0x50 : db == 33 ? 0x40 : -1;
+                if (mask < RF_GAIN_MIN || mask > RF_GAIN_MAX) {
+                    webServer.send(400, "text/plain", "Gain hors bornes");
+                    return;
+                }
+                gain = mask;
+            }
+            if (webServer.hasArg("timer")) {
+                long value = webServer.arg("timer").toInt();
+                if (value < RF_TIMER_RELOAD_MIN || value > RF_TIMER_RELOAD_MAX) {
+                    webServer.send(400, "text/plain", "Timer hors bornes");
+                    return;
+                }
+                reload = value;
+            }
+            if (webServer.hasArg("auto")) autoTune = webServer.arg("auto") == "1" || webServer.arg("auto") == "true";
+            rfApply(gain, reload);
+            saveRfTuning(gain, reload, autoTune);
+        }
+        webServer.send(200, "application/json", rfTuningJson());
+    });
+    webServer.on("/api/rf/calibrate", HTTP_POST, []() {
+        if (rfCalibrating()) {
+            webServer.send(409, "text/plain", "Calibration déjà en cours");
+        } else if (rfCalibrationStart()) {
+            webServer.send(202, "text/plain", "Calibration démarrée, laissez la carte de référence en place");
+        } else {
+            webServer.send(400, "text/plain", "Aucune carte de référence détectée");
+        }
+    });
+    
+    // Métriques au format Prometheus
+    webServer.on("/api/metrics", HTTP_GET, []() {
+        metricsSend(webServer);
+    });
+    
+    // === Images de cartes (LittleFS) ===
+    webServer.on("/api/images", HTTP_GET, []() {
+        webServer.send(200, "application/json", cardImageListJson());
+    });
+    // Téléchargement : image complète, ou contenu brut .mfd avec format=mfd
+    webServer.on("/api/image", HTTP_GET, []() {
+        String uid = webServer.arg("uid");
+        CardImageHeader header;
+        if (!cardImageReadHeader(uid, header)) {
+            webServer.send(404, "text/plain", "Image introuvable");
+            return;
+        }
+        File f = LittleFS.open(cardImagePath(uid), "r");
+        bool raw = webServer.arg("format") == "mfd";
+        size_t skip = raw ? sizeof(CardImageHeader) : 0;
+        f.seek(skip, SeekSet);
+        webServer.sendHeader("Content-Disposition", "attachment; filename=" + uid + (raw ? ".mfd" : CARD_IMAGE_EXT));
+        webServer.setContentLength(f.size() - skip);
+        webServer.send(200, "application/octet-stream", "");
+        uint8_t buf[256];
+        size_t n;
+        while ((n = f.read(buf, sizeof(buf))) > 0) {
+            webServer.sendContent((const char *)buf, n);
+            yield();
+        }
+        f.close();
+    });
+    // Envoi d'une image (.img ou dump .mfd brut) : écrite dans un fichier temporaire puis validée
+    webServer.on("/api/image", HTTP_POST, []() {
+        String uid;
+        if (cardImageImport(CARD_IMAGE_DIR "/upload.tmp", uid)) {
+            webServer.send(200, "text/plain", uid);
+        } else {
+            webServer.send(400, "text/plain", "Image invalide");
+        }
+    }, []() {
+        static File uploadFile;
+        HTTPUpload& upload = webServer.upload();
+        if (upload.status == UPLOAD_FILE_START) {
+            uploadFile = LittleFS.open(CARD_IMAGE_DIR "/upload.tmp", "w");
+        } else if (upload.status == UPLOAD_FILE_WRITE) {
+            if (uploadFile) uploadFile.write(upload.buf, upload.currentSize);
+        } else if (upload.status == UPLOAD_FILE_END || upload.status == UPLOAD_FILE_ABORTED) {
+            if (uploadFile) uploadFile.close();
+        }
+    });
+    webServer.on("/api/image/delete", HTTP_POST, []() {
+        if (cardImageRemove(webServer.arg("uid"))) {
+            webServer.send(200, "text/plain", "OK");
+        } else {
+            webServer.send(404, "text/plain", "Image introuvable");
+        }
+    });
+    // Passe en mode restauration : la prochaine carte présentée reçoit l'image
+    webServer.on("/api/restore", HTTP_POST, []() {
+        String uid = webServer.arg("uid");
+        uid.toLowerCase();
+        CardImageHeader header;
+        if (!cardImageReadHeader(uid, header)) {
+            webServer.send(404, "text/plain", "Image introuvable");
+            return;
+        }
+        restoreUid = uid;
+        scanModeActivate(MODE_RESTORE);
+        webServer.send(200, "text/plain", "Mode restauration activé - Approchez une carte");
+    });
+
+    // === Encodage en série ===
+    webServer.on("/api/provision", HTTP_GET, []() {
+        webServer.send(200, "application/json", provisionStatusJson());
+    });
+    // File de contenus (CSV ou JSON) : remplace la file en cours si elle est valide
+    webServer.on("/api/provision/queue", HTTP_POST, []() {
+        String error;
+        uint32_t count = provisionImport(PROVISION_UPLOAD_PATH, error);
+        if (count) {
+            webServer.send(200, "text/plain", String(count) + " entrées");
+        } else {
+            webServer.send(400, "text/plain", error);
+        }
+    }, []() {
+        static File uploadFile;
+        HTTPUpload& upload = webServer.upload();
+        if (upload.status == UPLOAD_FILE_START) {
+            uploadFile = LittleFS.open(PROVISION_UPLOAD_PATH, "w");
+        } else if (upload.status == UPLOAD_FILE_WRITE) {
+            if (uploadFile) uploadFile.write(upload.buf, upload.currentSize);
+        } else if (upload.status == UPLOAD_FILE_END || upload.status == UPLOAD_FILE_ABORTED) {
+            if (uploadFile) uploadFile.close();
+        }
+    });
+    // Journal UID -> contenu : uid;rang;format;données
+    webServer.on("/api/provision/log", HTTP_GET, []() {
+        File f = LittleFS.open(PROVISION_LOG_PATH, "r");
+        if (!f) {
+            webServer.send(200, "text/csv", "");
+            return;
+        }
+        webServer.sendHeader("Content-Disposition", "attachment; filename=provision.csv");
+        webServer.setContentLength(f.size());
+        webServer.send(200, "text/csv", "");
+        uint8_t buf[256];
+        size_t n;
+        while ((n = f.read(buf, sizeof(buf))) > 0) {
+            webServer.sendContent((const char *)buf, n);
+            yield();
+        }
+        f.close();
+    });
+    webServer.on("/api/provision/reset", HTTP_POST, []() {
+        provisionReset();
+        webServer.send(200, "text/plain", "OK");
+    });
+
+    // === Transport MQTT ===
+    // Réglages et état de la session (mot de passe jamais renvoyé)
+    webServer.on("/api/mqtt", HTTP_GET, []() {
+        webServer.send(200, "application/json", mqttStatusJson());
+    });
+    webServer.on("/api/mqtt", HTTP_POST, []() {
+        long port = webServer.hasArg("port") ? webServer.arg("port").toInt() : mqttPort;
+        if (port < 1 || port > 65535) {
+            webServer.send(400, "text/plain", "Port invalide");
+            return;
+        }
+        String host = webServer.hasArg("host") ? webServer.arg("host") : mqttHost;
+        String topic = webServer.hasArg("topic") ? webServer.arg("topic") : mqttTopic;
+        if (host.length() > MQTT_HOST_MAXLEN || topic.length() > MQTT_TOPIC_MAXLEN) {
+            webServer.send(400, "text/plain", "Hôte ou préfixe trop long");
+            return;
+        }
+        // MQTT 3.1.1 : un mot de passe n'est envoyé qu'avec un nom d'utilisateur
+        String user = webServer.hasArg("user") ? webServer.arg("user") : mqttUser;
+        String pass = webServer.hasArg("pass") ? webServer.arg("pass") : mqttPass;
+        if (pass.length() && !user.length()) {
+            webServer.send(400, "text/plain", "Mot de passe sans nom d'utilisateur");
+            return;
+        }
+        bool enabled = webServer.hasArg("enabled") ? webServer.arg("enabled") == "1" : mqttEnabled;
+        saveMqttConfig(enabled, host, port, user, pass, topic);
+        mqttRestart();
+        webServer.send(200, "text/plain", "OK");
+    });
+
+    // === Boîte d'envoi ===
+    // Séquence, filigrane et événements en attente de renvoi
+    webServer.on("/api/outbox", HTTP_GET, []() {
+        webServer.send(200, "application/json", outboxStatusJson());
+    });
+
+    // === Cache des décisions de l'API ===
+    // Taux de réussite, invalidation (un UID, ou tout sans paramètre)
+    webServer.on("/api/cache", HTTP_GET, []() {
+        webServer.send(200, "application/json", decisionCacheStatusJson());
+    });
+    webServer.on("/api/cache/invalidate", HTTP_POST, []() {
+        if (!webServer.hasArg("uid")) {
+            decisionCacheClear();
+            webServer.send(200, "text/plain", "Cache vidé");
+            return;
+        }
+        if (!decisionCacheInvalidate(webServer.arg("uid").c_str())) {
+            webServer.send(404, "text/plain", "UID absent du cache");
+            return;
+        }
+        webServer.send(200, "text/plain", "OK");
+    });
+
+    // === Liste d'accès locale ===
+    webServer.on("/api/acl", HTTP_GET, []() {
+        webServer.send(200, "application/json", aclStatusJson());
+    });
+    webServer.on("/api/acl/source", []() {
+        if (webServer.method() == HTTP_POST) {
+            if (!webServer.hasArg("url")) {
+                webServer.send(400, "text/plain", "Paramètre 'url' manquant");
+                return;
+            }
+            aclSetSourceUrl(webServer.arg("url"));
+            aclSyncDue = true;
+            webServer.send(200, "text/plain", "OK");
+        } else {
+            webServer.send(200, "text/plain", aclSourceUrl());
+        }
+    });
+    webServer.on("/api/acl/sync", HTTP_POST, []() {
+        aclSyncDue = true;
+        webServer.send(200, "text/plain", "Synchronisation programmée");
+    });
+    webServer.on("/api/acl/check", HTTP_GET, []() {
+        AclEntry entry;
+        if (!aclParseUidHex(webServer.arg("uid"), entry)) {
+            webServer.send(400, "text/plain", "UID invalide");
+            return;
+        }
+        AclDecision decision = aclLookup(entry.uid, entry.uidSize);
+        webServer.send(200, "application/json", String("{\"decision\":\"") + aclDecisionName(decision) +
+                       "\",\"us\":" + String(aclStats().lastLookupUs) + "}");
+    });
+
+    // API pour scanner les réseaux WiFi disponibles
+    webServer.on("/api/wifiscan", []() {
+        serialLog().println("[WiFi] Début du scan des réseaux...");
+        int n = WiFi.scanNetworks();
+        String json;
+        json.reserve(512); // Réserver mémoire pour éviter la fragmentation
+        json = "[";
+        
+        if (n > 0) {
+            for (int i = 0; i < n; i++) {
+                if (i > 0) json += ",";
+                json += "{\"ssid\":\"";
+                json += WiFi.SSID(i);
+                json += "\",\"rssi\":";
+                json += WiFi.RSSI(i);
+                json += ",\"secure\":";
+                json += (WiFi.encryptionType(i) == ENC_TYPE_NONE) ? "false" : "true";
+                json += "}";
+                
+                // Permettre au système de respirer
+                if (i % 3 == 0) {
+                    webServer.handleClient();
+                    yield();
+                }
+            }
+        }
+        json += "]";
+        
+        serialLog().printf("[WiFi] Scan terminé : %d réseaux trouvés\n", n);
+        WiFi.scanDelete(); // Libérer la mémoire du scan
+        webServer.send(200, "application/json", json);
+    });
+    
+    // Gestionnaire catch-all amélioré pour portail captif
+    webServer.onNotFound([]() {
+        if (WiFi.getMode() == WIFI_AP) {
+            // En mode AP, rediriger vers la page de connexion
+            String message = "<!DOCTYPE html><html><head>";
+            message += "<meta charset='utf-8'>";
+            message += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
+            message += "<title>Configuration RFID Scanner</title>";
+            message += "<script>setTimeout(function(){window.location.href='http://192.168.4.1/';}, 1000);</script>";
+            message += "</head><body>";
+            message += "<h1>Configuration RFID Scanner</h1>";
+            message += "<p>Redirection automatique...</p>";
+            message += "<p><a href='http://192.168.4.1/'>Cliquez ici si la redirection ne fonctionne pas</a></p>";
+            message += "</body></html>";
+            webServer.send(200, "text/html", message);
+        } else {
+            webServer.send(404, "text/plain", "Page non trouvée");
+        }
+    });
+    
+    webServer.begin();
+    started = true;
+    serialLog().print("Serveur web démarré sur IP: ");
+    serialLog().println(WiFi.softAPIP());
+}
@@ -0,0 +1,189 @@
+/*
+ * Liste d'accès locale (acl.h) : recherche, filtre de Bloom dimensionné
+ * d'après la liste, synchronisation complète et delta
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <native_sim.h>
+#include <acl.h>
+#include <algorithm>
+#include <vector>
+
+void nativeSetup();
+
+void setUp() {
+    LoopbackHttpServer::instance().handler = nullptr;
+}
+void tearDown() {}
+
+static AclEntry entry(uint32_t value, uint8_t uidSize, AclDecision decision) {
+    AclEntry e;
+    memset(&e, 0, sizeof(e));
+    for (uint8_t i = 0; i < uidSize; i++) e.uid[i] = value >> (8 * (i % 4)) ^ (i * 0x3D);
+    e.uidSize = uidSize;
+    e.flags = decision;
+    return e;
+}
+
+// Liste écrite telle que la synchronisation la produit : triée par clé
+static void writeList(std::vector<AclEntry> &entries, uint32_t version) {
+    std::sort(entries.begin(), entries.end(),
+              [](const AclEntry &a, const AclEntry &b) { return memcmp(a.uid, b.uid, ACL_KEY_SIZE) < 0; });
+    LittleFS.mkdir(ACL_DIR);
+    File f = LittleFS.open(ACL_LIST_PATH, "w");
+    const uint32_t header[4] = {ACL_MAGIC, version, (uint32_t)entries.size(), 0};
+    f.write((const uint8_t *)header, sizeof(header));
+    f.write((const uint8_t *)entries.data(), entries.size() * sizeof(AclEntry));
+    f.close();
+}
+
+static AclDecision lookup(const AclEntry &e) {
+    return aclLookup(e.uid, e.uidSize);
+}
+
+static AclDecision lookupHex(const char *hex) {
+    AclEntry e;
+    TEST_ASSERT_TRUE(aclParseUidHex(hex, e));
+    return lookup(e);
+}
+
+// Réponse du serveur simulé à la synchronisation
+static bool sync(const char *body) {
+    String list(body);
+    LoopbackHttpServer::instance().handler = [list](const LoopbackRequest &) {
+        LoopbackResponse r;
+        r.body = list;
+        return r;
+    };
+    bool ok = aclSync();
+    LoopbackHttpServer::instance().handler = nullptr;
+    return ok;
+}
+
+void test_parse_uid_hex() {
+    AclEntry e;
+    TEST_ASSERT_TRUE(aclParseUidHex("04A1b2C3", e));
+    TEST_ASSERT_EQUAL(4, e.uidSize);
+    TEST_ASSERT_EQUAL_HEX8(0xA1, e.uid[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, e.uid[4]);
+    TEST_ASSERT_TRUE(aclParseUidHex("0102030405060708090a", e));
+    TEST_ASSERT_FALSE(aclParseUidHex("04a1b2c", e));
+    TEST_ASSERT_FALSE(aclParseUidHex("0102030405060708090a0b", e));
+    TEST_ASSERT_FALSE(aclParseUidHex("04g1", e));
+}
+
+// UID de 4, 7 et 10 octets ; même début mais autre taille : UID différent
+void test_lookup() {
+    std::vector<AclEntry> entries;
+    for (uint32_t i = 0; i < 1000; i++) {
+        entries.push_back(entry(i * 7919, i % 3 == 0 ? 4 : i % 3 == 1 ? 7 : 10, i % 5 ? ACL_ALLOW : ACL_DENY));
+    }
+    writeList(entries, 3);
+    TEST_ASSERT_TRUE(aclBegin());
+    TEST_ASSERT_EQUAL(1000, aclStats().count);
+    TEST_ASSERT_EQUAL(3, aclStats().version);
+    for (uint32_t i = 0; i < entries.size(); i++) TEST_ASSERT_EQUAL(entries[i].flags, lookup(entries[i]));
+    AclEntry longer = entries[0];
+    longer.uidSize = 5;
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, lookup(longer));
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, lookup(entry(0xDEADBEEF, 4, ACL_ALLOW)));
+}
+
+// Taille incohérente avec le nombre d'entrées : liste ignorée
+void test_invalid_list_ignored() {
+    std::vector<AclEntry> entries = {entry(1, 4, ACL_ALLOW)};
+    writeList(entries, 1);
+    File f = LittleFS.open(ACL_LIST_PATH, "a");
+    f.write((const uint8_t *)"x", 1);
+    f.close();
+    TEST_ASSERT_FALSE(aclBegin());
+    TEST_ASSERT_EQUAL(0, aclStats().count);
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, lookup(entry(1, 4, ACL_ALLOW)));
+}
+
+static AclEntry member(uint32_t i, AclDecision decision) {
+    return entry(0x04000000 + i * 2654435761UL, 7, decision);
+}
+
+// Liste de count UID de 7 octets ; le vecteur est libéré avant aclBegin(),
+// le tas simulé comptant chaque allocation
+static void writeMembers(uint32_t count, AclDecision decision, uint32_t version) {
+    std::vector<AclEntry> entries;
+    for (uint32_t i = 0; i < count; i++) entries.push_back(member(i, decision));
+    writeList(entries, version);
+}
+
+// Filtre dimensionné d'après la liste : ~1 % de faux positifs à 20 000 UID
+void test_bloom_sized_from_list() {
+    const uint32_t count = 20000;
+    writeMembers(count, ACL_ALLOW, 4);
+    TEST_ASSERT_TRUE(aclBegin());
+    TEST_ASSERT_EQUAL(count * ACL_BLOOM_BITS_PER_UID / 8, aclStats().bloomBytes);
+    TEST_ASSERT_EQUAL(7, aclStats().bloomHashes);
+    // UID absents : quasiment tous écartés par le filtre, sans lecture flash
+    uint32_t lookups = aclStats().lookups;
+    uint32_t misses = aclStats().misses;
+    for (uint32_t i = 0; i < count; i++) TEST_ASSERT_EQUAL(ACL_UNKNOWN, lookup(entry(0x80000000 + i * 40503, 4, ACL_ALLOW)));
+    float fpp = (float)(aclStats().misses - misses) / (aclStats().lookups - lookups);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.02f, fpp);
+    for (uint32_t i = 0; i < count; i += 97) TEST_ASSERT_EQUAL(ACL_ALLOW, lookup(member(i, ACL_ALLOW)));
+}
+
+// Liste plus grande que le tas ne le permet : filtre plafonné, k réduit, aucun UID perdu
+void test_bloom_capped() {
+    const uint32_t count = 50000;
+    writeMembers(count, ACL_DENY, 5);
+    TEST_ASSERT_TRUE(aclBegin());
+    TEST_ASSERT_LESS_THAN(count * ACL_BLOOM_BITS_PER_UID / 8, aclStats().bloomBytes);
+    TEST_ASSERT_LESS_OR_EQUAL(ACL_BLOOM_MAX_BYTES, aclStats().bloomBytes);
+    TEST_ASSERT_LESS_THAN(7, aclStats().bloomHashes);
+    for (uint32_t i = 0; i < count; i += 101) TEST_ASSERT_EQUAL(ACL_DENY, lookup(member(i, ACL_DENY)));
+}
+
+// Liste complète puis delta : ajout, retrait et changement de décision
+void test_sync_full_then_delta() {
+    aclSetSourceUrl("http://127.0.0.1/acl");
+    TEST_ASSERT_TRUE(sync("ACL FULL 10\n-0102030405060708\n+04a1b2c3\n+04a1b2c3d4e5f6\n"));
+    TEST_ASSERT_EQUAL(10, aclStats().version);
+    TEST_ASSERT_EQUAL(3, aclStats().count);
+    TEST_ASSERT_EQUAL(ACL_DENY, lookupHex("0102030405060708"));
+    TEST_ASSERT_EQUAL(ACL_ALLOW, lookupHex("04a1b2c3"));
+
+    TEST_ASSERT_TRUE(sync("ACL DELTA 10 11\n~0102030405060708\n-04a1b2c3\n+11223344\n"));
+    TEST_ASSERT_EQUAL(11, aclStats().version);
+    TEST_ASSERT_EQUAL(3, aclStats().count);
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, lookupHex("0102030405060708"));
+    TEST_ASSERT_EQUAL(ACL_DENY, lookupHex("04a1b2c3"));
+    TEST_ASSERT_EQUAL(ACL_ALLOW, lookupHex("04a1b2c3d4e5f6"));
+    TEST_ASSERT_EQUAL(ACL_ALLOW, lookupHex("11223344"));
+}
+
+// Synchronisation rejetée : la version précédente reste active
+void test_sync_rejected_keeps_list() {
+    aclSetSourceUrl("http://127.0.0.1/acl");
+    TEST_ASSERT_TRUE(sync("ACL FULL 20\n+04a1b2c3\n"));
+    TEST_ASSERT_FALSE(sync("ACL FULL 21\n+11223344\n+04a1b2c3\n"));
+    TEST_ASSERT_EQUAL(-5, aclStats().lastSyncCode);
+    TEST_ASSERT_FALSE(sync("ACL DELTA 7 22\n+11223344\n"));
+    TEST_ASSERT_EQUAL(-3, aclStats().lastSyncCode);
+    TEST_ASSERT_FALSE(sync("ACL FULL 23\n+zz\n"));
+    TEST_ASSERT_EQUAL(20, aclStats().version);
+    TEST_ASSERT_EQUAL(ACL_ALLOW, lookupHex("04a1b2c3"));
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, lookupHex("11223344"));
+}
+
+int main() {
+    Serial.setEcho(false);
+    nativeSetVirtualTime(true);
+    nativeSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_uid_hex);
+    RUN_TEST(test_lookup);
+    RUN_TEST(test_invalid_list_ignored);
+    RUN_TEST(test_bloom_sized_from_list);
+    RUN_TEST(test_bloom_capped);
+    RUN_TEST(test_sync_full_then_delta);
+    RUN_TEST(test_sync_rejected_keeps_list);
+    return UNITY_END();
+}
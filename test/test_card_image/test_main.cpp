@@ -0,0 +1,99 @@
+/*
+ * Images de cartes (card_image.h) : un en-tête dont la géométrie dépasse
+ * validMap est refusé à l'import comme à la lecture
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <native_sim.h>
+#include <card_image.h>
+
+void nativeSetup();
+
+#define TMP_PATH "/cards/upload.tmp"
+
+void setUp() {
+    LittleFS.remove(TMP_PATH);
+    LittleFS.remove(cardImagePath("04a1b2c3"));
+}
+void tearDown() {}
+
+// En-tête 1K cohérent, tous les blocs valides
+static CardImageHeader classicHeader() {
+    CardImageHeader header = {};
+    header.magic = CARD_IMAGE_MAGIC;
+    header.version = CARD_IMAGE_VERSION;
+    header.piccType = MFRC522::PICC_TYPE_MIFARE_1K;
+    header.uidSize = 4;
+    const uint8_t uid[] = {0x04, 0xA1, 0xB2, 0xC3};
+    memcpy(header.uid, uid, sizeof(uid));
+    header.blockCount = 64;
+    header.blockSize = 16;
+    memset(header.validMap, 0xFF, 64 / 8);
+    return header;
+}
+
+// En-tête suivi d'un corps de la taille qu'il annonce
+static void writeImage(const char *path, const CardImageHeader &header) {
+    File f = LittleFS.open(path, "w");
+    f.write((const uint8_t *)&header, sizeof(header));
+    uint8_t zeros[64] = {};
+    size_t body = (size_t)header.blockCount * header.blockSize;
+    while (body > 0) {
+        size_t n = body < sizeof(zeros) ? body : sizeof(zeros);
+        f.write(zeros, n);
+        body -= n;
+    }
+    f.close();
+}
+
+void test_import_valid_image() {
+    writeImage(TMP_PATH, classicHeader());
+    String uidHex;
+    TEST_ASSERT_TRUE(cardImageImport(TMP_PATH, uidHex));
+    TEST_ASSERT_EQUAL_STRING("04a1b2c3", uidHex.c_str());
+    CardImageHeader header;
+    TEST_ASSERT_TRUE(cardImageReadHeader(uidHex, header));
+    TEST_ASSERT_EQUAL(64, cardImageValidCount(header));
+}
+
+void test_import_rejects_block_count() {
+    CardImageHeader header = classicHeader();
+    header.blockCount = CARD_IMAGE_MAX_BLOCKS + 16;
+    writeImage(TMP_PATH, header);
+    String uidHex;
+    TEST_ASSERT_FALSE(cardImageImport(TMP_PATH, uidHex));
+    TEST_ASSERT_FALSE(LittleFS.exists(cardImagePath("04a1b2c3")));
+}
+
+void test_import_rejects_block_size() {
+    CardImageHeader header = classicHeader();
+    header.blockSize = 8;
+    writeImage(TMP_PATH, header);
+    String uidHex;
+    TEST_ASSERT_FALSE(cardImageImport(TMP_PATH, uidHex));
+    TEST_ASSERT_FALSE(LittleFS.exists(cardImagePath("04a1b2c3")));
+}
+
+// Fichier déjà en place (écrit hors import) : ni lu, ni listé
+void test_read_header_rejects_geometry() {
+    CardImageHeader header = classicHeader();
+    header.blockCount = 1024;
+    header.blockSize = 4;
+    writeImage(cardImagePath("04a1b2c3").c_str(), header);
+    CardImageHeader read;
+    TEST_ASSERT_FALSE(cardImageReadHeader("04a1b2c3", read));
+    TEST_ASSERT_NULL(strstr(cardImageListJson().c_str(), "04a1b2c3"));
+}
+
+int main() {
+    Serial.setEcho(false);
+    nativeSetVirtualTime(true);
+    nativeSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_import_valid_image);
+    RUN_TEST(test_import_rejects_block_count);
+    RUN_TEST(test_import_rejects_block_size);
+    RUN_TEST(test_read_header_rejects_geometry);
+    return UNITY_END();
+}
@@ -0,0 +1,223 @@
+/*
+ * Corps des envois (scan_payload.h) : schéma CBOR, corps form historique et
+ * POST application/cbor depuis le pipeline
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <native_sim.h>
+#include <scanner.h>
+#include <settings.h>
+#include <rf_tuning.h>
+#include <scan_payload.h>
+#include <upload_outbox.h>
+#include <string>
+#include <vector>
+
+void nativeSetup();
+std::shared_ptr<SimCard> nativeMakeCard(const String &name);
+void nativeDrainPipeline();
+
+void setUp() {}
+void tearDown() {}
+
+// Lecture CBOR minimale pour vérifier le schéma (entiers, octets, texte, map)
+struct CborReader {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok = true;
+    uint32_t head(uint8_t &major) {
+        major = 0xFF;
+        if (p >= end) return ok = false;
+        major = *p >> 5;
+        uint8_t info = *p++ & 0x1F;
+        if (info < 24) return info;
+        int bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : 0;
+        if (!bytes || p + bytes > end) return ok = false;
+        uint32_t value = 0;
+        while (bytes--) value = (value << 8) | *p++;
+        return value;
+    }
+    uint32_t expect(uint8_t major) {
+        uint8_t got = 0xFF;
+        uint32_t value = head(got);
+        if (!ok || got != major) {
+            ok = false;
+            return 0;
+        }
+        return value;
+    }
+    const uint8_t *take(uint32_t length) {
+        if (!ok || length > (size_t)(end - p)) {
+            ok = false;
+            return nullptr;
+        }
+        const uint8_t *start = p;
+        p += length;
+        return start;
+    }
+};
+
+struct CborScan {
+    uint8_t uid[10];
+    uint8_t uidSize = 0;
+    uint32_t values[9] = {};       // par clé entière
+    bool present[9] = {};
+    std::vector<std::pair<std::string, std::string>> fields;
+    std::string device;
+    std::vector<uint8_t> blocks;
+};
+
+static bool cborDecode(const uint8_t *data, size_t length, CborScan &out) {
+    CborReader r = {data, data + length};
+    uint32_t entries = r.expect(5);
+    for (uint32_t i = 0; i < entries && r.ok; i++) {
+        uint32_t key = r.expect(0);
+        if (!r.ok || key > 8 || out.present[key]) return false;
+        out.present[key] = true;
+        if (key == 0) {
+            uint32_t n = r.expect(2);
+            const uint8_t *uid = r.take(n);
+            if (!uid || n > sizeof(out.uid)) return false;
+            memcpy(out.uid, uid, n);
+            out.uidSize = n;
+        } else if (key == 5) {
+            uint32_t pairs = r.expect(5);
+            for (uint32_t k = 0; k < pairs && r.ok; k++) {
+                uint32_t n = r.expect(3);
+                const uint8_t *name = r.take(n);
+                uint32_t m = r.expect(3);
+                const uint8_t *value = r.take(m);
+                if (r.ok) out.fields.push_back({std::string((const char *)name, n), std::string((const char *)value, m)});
+            }
+        } else if (key == 6) {
+            uint32_t n = r.expect(2);
+            const uint8_t *blocks = r.take(n);
+            if (blocks) out.blocks.assign(blocks, blocks + n);
+        } else if (key == 8) {
+            uint32_t n = r.expect(3);
+            const uint8_t *device = r.take(n);
+            if (device) out.device.assign((const char *)device, n);
+        } else {
+            out.values[key] = r.expect(0);
+        }
+    }
+    return r.ok && r.p == r.end;
+}
+
+static ScanRecord goldenRecord() {
+    ScanRecord golden = scanRecord("04a1b2c3", "&nom=Jean%20Dupont");
+    golden.hasCard = true;
+    golden.sak = 0x08;
+    golden.piccType = MFRC522::PICC_TYPE_MIFARE_1K;
+    golden.timestamp = 1234;
+    golden.sequence = 42;
+    return golden;
+}
+
+// Octets attendus écrits à la main d'après le schéma
+static const uint8_t goldenBytes[] = {0xA6, 0x00, 0x44, 0x04, 0xA1, 0xB2, 0xC3, 0x01, 0x08, 0x02, 0x04,
+                                      0x03, 0x19, 0x04, 0xD2, 0x04, 0x18, 0x2A, 0x05, 0xA1, 0x63, 'n',
+                                      'o',  'm',  0x6B, 'J',  'e',  'a',  'n',  ' ',  'D',  'u',  'p',
+                                      'o',  'n',  't'};
+
+void test_golden_vector() {
+    uint8_t buf[256];
+    size_t n = scanPayloadEncode(goldenRecord(), API_ENCODING_CBOR, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(sizeof(goldenBytes), n);
+    TEST_ASSERT_EQUAL_MEMORY(goldenBytes, buf, n);
+}
+
+void test_form_body() {
+    static const char *expected = "uid=04a1b2c3&scan=42&sak=8&type=4&ts=1234&nom=Jean%20Dupont";
+    char buf[256];
+    size_t n = scanPayloadEncode(goldenRecord(), API_ENCODING_FORM, (uint8_t *)buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(strlen(expected), n);
+    buf[n] = 0;
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+// Corps historique inchangé sans métadonnée de carte
+void test_legacy_form_body() {
+    char buf[64];
+    size_t n = scanPayloadEncode(scanRecord("04a1b2c3", "&site=12"), API_ENCODING_FORM, (uint8_t *)buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(20, n);
+    buf[n] = 0;
+    TEST_ASSERT_EQUAL_STRING("uid=04a1b2c3&site=12", buf);
+}
+
+// Tampon trop petit d'un octet : rien d'écrit
+void test_buffer_too_small() {
+    uint8_t buf[256];
+    TEST_ASSERT_EQUAL(0, scanPayloadEncode(goldenRecord(), API_ENCODING_CBOR, buf, sizeof(goldenBytes) - 1));
+}
+
+// Image complète d'une 1K : mêmes octets, mêmes champs décodés
+void test_image_round_trip() {
+    ScanRecord scan = scanRecord("04a1b2c3d4e5f6", "&employe=B8421&site=12&nom=Jean%20Dupont");
+    scan.hasCard = true;
+    scan.sak = 0x08;
+    scan.piccType = MFRC522::PICC_TYPE_MIFARE_1K;
+    scan.timestamp = 86400;
+    scan.sequence = 1234;
+    std::vector<uint8_t> image(64 * 16);
+    for (size_t i = 0; i < image.size(); i++) image[i] = (uint8_t)(i * 31 + 7);
+    scan.blocks = image.data();
+    scan.blockCount = 64;
+    scan.blockSize = 16;
+
+    static uint8_t buf[4096];
+    size_t n = scanPayloadEncode(scan, API_ENCODING_CBOR, buf, sizeof(buf));
+    TEST_ASSERT_NOT_EQUAL(0, n);
+    CborScan decoded;
+    TEST_ASSERT_TRUE(cborDecode(buf, n, decoded));
+    TEST_ASSERT_EQUAL(7, decoded.uidSize);
+    TEST_ASSERT_EQUAL_HEX8(0x04, decoded.uid[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xf6, decoded.uid[6]);
+    TEST_ASSERT_EQUAL(0x08, decoded.values[1]);
+    TEST_ASSERT_EQUAL(86400, decoded.values[3]);
+    TEST_ASSERT_EQUAL(1234, decoded.values[4]);
+    TEST_ASSERT_EQUAL(16, decoded.values[7]);
+    TEST_ASSERT_TRUE(decoded.blocks == image);
+    TEST_ASSERT_EQUAL(3, decoded.fields.size());
+    TEST_ASSERT_EQUAL_STRING("nom", decoded.fields[2].first.c_str());
+    TEST_ASSERT_EQUAL_STRING("Jean Dupont", decoded.fields[2].second.c_str());
+}
+
+// De bout en bout : POST HTTP application/cbor depuis le pipeline
+void test_pipeline_post() {
+    rfAutoTune = false;
+    apiEncoding = API_ENCODING_CBOR;
+    mode = MODE_READ;
+    continuousMode = true;
+    scanDelayMs = 0;
+    LoopbackHttpServer &server = LoopbackHttpServer::instance();
+    server.clear();
+    SimField &field = SimField::instance();
+    field.place(nativeMakeCard("classic1k"));
+    handleRFIDOperations();
+    field.remove();
+    nativeDrainPipeline();
+    apiEncoding = API_ENCODING_FORM;
+
+    TEST_ASSERT_EQUAL(1, server.received.size());
+    TEST_ASSERT_EQUAL_STRING("application/cbor", server.received[0].contentType.c_str());
+    CborScan posted;
+    TEST_ASSERT_TRUE(cborDecode(server.received[0].body.data(), server.received[0].body.size(), posted));
+    TEST_ASSERT_TRUE(posted.present[0] && posted.present[1] && posted.present[2] && posted.present[3]);
+    TEST_ASSERT_EQUAL(outboxStats().nextSequence - 1, posted.values[4]);
+    TEST_ASSERT_EQUAL_STRING(deviceId(), posted.device.c_str());
+    TEST_ASSERT_EQUAL(MFRC522::PICC_TYPE_MIFARE_1K, posted.values[2]);
+}
+
+int main() {
+    Serial.setEcho(false);
+    nativeSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_vector);
+    RUN_TEST(test_form_body);
+    RUN_TEST(test_legacy_form_body);
+    RUN_TEST(test_buffer_too_small);
+    RUN_TEST(test_image_round_trip);
+    RUN_TEST(test_pipeline_post);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+/*
+ * Cache des décisions de l'API (decision_cache.h) : lecture de la réponse,
+ * ttl, invalidation et remplacement
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <native_sim.h>
+#include <decision_cache.h>
+
+static const byte uidA[] = {0x04, 0xA1, 0xB2, 0xC3};
+
+void setUp() {
+    decisionCacheClear();
+}
+void tearDown() {}
+
+static AclDecision learn(const char *uid, int code, const char *body) {
+    return decisionCacheLearn(uid, code, body, strlen(body));
+}
+
+void test_allow_with_ttl_is_cached() {
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+    TEST_ASSERT_EQUAL(ACL_ALLOW, learn("04a1b2c3", 200, "decision=allow&ttl=300"));
+    TEST_ASSERT_EQUAL(ACL_ALLOW, decisionCacheLookup(uidA, sizeof(uidA)));
+    TEST_ASSERT_EQUAL(1, decisionCacheStats().entries);
+}
+
+// Mot seul, autres séparateurs, UID en majuscules
+void test_body_variants() {
+    TEST_ASSERT_EQUAL(ACL_DENY, learn("04A1B2C3", 200, "deny; ttl=60"));
+    TEST_ASSERT_EQUAL(ACL_DENY, decisionCacheLookup(uidA, sizeof(uidA)));
+    // 403 refuse, quel que soit le corps
+    TEST_ASSERT_EQUAL(ACL_DENY, learn("0102030405060708090a", 403, "allow&ttl=60"));
+    const byte uid10[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    TEST_ASSERT_EQUAL(ACL_DENY, decisionCacheLookup(uid10, sizeof(uid10)));
+    // Sans mot « decision » : 2xx autorise
+    TEST_ASSERT_EQUAL(ACL_ALLOW, learn("11223344", 201, "OK ttl=5"));
+}
+
+// Autre code : pas de décision, cache inchangé
+void test_other_codes_ignored() {
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, learn("04a1b2c3", 500, "decision=allow&ttl=300"));
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, learn("04a1b2c3", 0, ""));
+    TEST_ASSERT_EQUAL(0, decisionCacheStats().entries);
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+}
+
+// Réponse sans ttl : l'entrée existante est retirée
+void test_response_without_ttl_removes_entry() {
+    learn("04a1b2c3", 200, "allow&ttl=300");
+    uint32_t invalidations = decisionCacheStats().invalidations;
+    TEST_ASSERT_EQUAL(ACL_ALLOW, learn("04a1b2c3", 200, "allow"));
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+    TEST_ASSERT_EQUAL(invalidations + 1, decisionCacheStats().invalidations);
+}
+
+void test_entry_expires() {
+    learn("04a1b2c3", 200, "allow&ttl=2");
+    delay(1900);
+    TEST_ASSERT_EQUAL(ACL_ALLOW, decisionCacheLookup(uidA, sizeof(uidA)));
+    uint32_t expired = decisionCacheStats().expired;
+    delay(200);
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+    TEST_ASSERT_EQUAL(expired + 1, decisionCacheStats().expired);
+}
+
+// Entrée périmée retirée dès la recherche ; toujours absente après le retour
+// à zéro de millis() (49,7 jours), un badge révoqué ne revient pas du cache
+void test_expired_entry_cleared() {
+    learn("04a1b2c3", 200, "allow&ttl=60");
+    delay(61000);
+    uint16_t entries = decisionCacheStats().entries;
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+    TEST_ASSERT_EQUAL(entries - 1, decisionCacheStats().entries);
+    learn("04a1b2c3", 200, "deny&ttl=60");
+    delay(61000);
+    for (int day = 0; day < 60; day++) {
+        delay(86400000UL);
+        TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+    }
+}
+
+// ttl plus long qu'un jour ramené à DECISION_TTL_MAX_S
+void test_ttl_capped() {
+    learn("04a1b2c3", 200, "allow&ttl=999999999");
+    delay(DECISION_TTL_MAX_S * 1000UL - 1000);
+    TEST_ASSERT_EQUAL(ACL_ALLOW, decisionCacheLookup(uidA, sizeof(uidA)));
+    delay(2000);
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+}
+
+// Réponse contraire à la décision en cache : comptée, la nouvelle l'emporte
+void test_stale_counted() {
+    learn("04a1b2c3", 200, "allow&ttl=300");
+    uint32_t stale = decisionCacheStats().stale;
+    TEST_ASSERT_EQUAL(ACL_DENY, learn("04a1b2c3", 200, "decision=deny&ttl=300"));
+    TEST_ASSERT_EQUAL(stale + 1, decisionCacheStats().stale);
+    TEST_ASSERT_EQUAL(ACL_DENY, decisionCacheLookup(uidA, sizeof(uidA)));
+}
+
+void test_invalidate() {
+    learn("04a1b2c3", 200, "allow&ttl=300");
+    TEST_ASSERT_TRUE(decisionCacheInvalidate("04a1b2c3"));
+    TEST_ASSERT_FALSE(decisionCacheInvalidate("04a1b2c3"));
+    TEST_ASSERT_FALSE(decisionCacheInvalidate("04a1b2c"));
+    TEST_ASSERT_FALSE(decisionCacheInvalidate("zz"));
+    TEST_ASSERT_EQUAL(ACL_UNKNOWN, decisionCacheLookup(uidA, sizeof(uidA)));
+}
+
+// Plus d'UID que de cases : remplacement, jamais plus de DECISION_CACHE_SLOTS
+// entrées, et le dernier UID appris est toujours trouvé
+void test_eviction_keeps_latest() {
+    for (uint32_t i = 0; i < DECISION_CACHE_SLOTS * 4; i++) {
+        const byte uid[] = {0x04, (byte)(i >> 8), (byte)i, 0x5A};
+        char hex[9];
+        snprintf(hex, sizeof(hex), "%02x%02x%02x%02x", uid[0], uid[1], uid[2], uid[3]);
+        learn(hex, 200, "allow&ttl=600");
+        TEST_ASSERT_EQUAL(ACL_ALLOW, decisionCacheLookup(uid, sizeof(uid)));
+        delay(1);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(DECISION_CACHE_SLOTS, decisionCacheStats().entries);
+    TEST_ASSERT_GREATER_THAN(0, decisionCacheStats().evictions);
+}
+
+int main() {
+    Serial.setEcho(false);
+    nativeSetVirtualTime(true);
+    UNITY_BEGIN();
+    RUN_TEST(test_allow_with_ttl_is_cached);
+    RUN_TEST(test_body_variants);
+    RUN_TEST(test_other_codes_ignored);
+    RUN_TEST(test_response_without_ttl_removes_entry);
+    RUN_TEST(test_entry_expires);
+    RUN_TEST(test_expired_entry_cleared);
+    RUN_TEST(test_ttl_capped);
+    RUN_TEST(test_stale_counted);
+    RUN_TEST(test_invalidate);
+    RUN_TEST(test_eviction_keeps_latest);
+    return UNITY_END();
+}
@@ -0,0 +1,134 @@
+/*
+ * Trames de la liaison série binaire (link_frame.h) : CRC, COBS, décodeur
+ */
+#include <unity.h>
+#include <link_frame.h>
+#include <string.h>
+
+static LinkDecoder decoder;
+
+void setUp() {
+    memset(&decoder, 0, sizeof(decoder));
+    linkDecoderReset(decoder);
+}
+void tearDown() {}
+
+// Octets passés un à un ; nombre de trames valides reçues
+static int feed(const uint8_t *data, size_t length) {
+    int frames = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (linkDecoderFeed(decoder, data[i]) == LINK_FRAME) frames++;
+    }
+    return frames;
+}
+
+// Valeur de contrôle du CRC-16/CCITT-FALSE
+void test_crc_check_value() {
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, linkCrc16((const uint8_t *)"123456789", 9));
+    // Calcul en deux fois : même résultat
+    uint16_t crc = linkCrc16((const uint8_t *)"1234", 4);
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, linkCrc16((const uint8_t *)"56789", 5, crc));
+}
+
+// Zéros du corps et du CRC : aucun octet nul entre les délimiteurs
+void test_round_trip_with_zeros() {
+    const uint8_t payload[] = {LINK_MSG_SCAN, 7, 0x00, 0x00, 0x12, 0x00, 0x34};
+    uint8_t frame[LINK_FRAME_MAX];
+    size_t n = linkEncode(payload, sizeof(payload), frame, sizeof(frame));
+    TEST_ASSERT_NOT_EQUAL(0, n);
+    TEST_ASSERT_EQUAL_HEX8(0x00, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, frame[n - 1]);
+    for (size_t i = 1; i < n - 1; i++) TEST_ASSERT_NOT_EQUAL(0, frame[i]);
+    TEST_ASSERT_EQUAL(1, feed(frame, n));
+    TEST_ASSERT_EQUAL(sizeof(payload), decoder.length);
+    TEST_ASSERT_EQUAL_MEMORY(payload, decoder.buf, sizeof(payload));
+}
+
+void test_round_trip_max_payload() {
+    uint8_t payload[LINK_PAYLOAD_MAX];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)(i * 7);
+    uint8_t frame[LINK_FRAME_MAX];
+    size_t n = linkEncode(payload, sizeof(payload), frame, sizeof(frame));
+    TEST_ASSERT_NOT_EQUAL(0, n);
+    TEST_ASSERT_LESS_OR_EQUAL(LINK_FRAME_MAX, n);
+    TEST_ASSERT_EQUAL(1, feed(frame, n));
+    TEST_ASSERT_EQUAL(sizeof(payload), decoder.length);
+    TEST_ASSERT_EQUAL_MEMORY(payload, decoder.buf, sizeof(payload));
+}
+
+void test_encode_rejects_bad_sizes() {
+    uint8_t payload[LINK_PAYLOAD_MAX + 1] = {LINK_MSG_ACK, 1};
+    uint8_t frame[LINK_FRAME_MAX + 8];
+    TEST_ASSERT_EQUAL(0, linkEncode(payload, 1, frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL(0, linkEncode(payload, sizeof(payload), frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL(0, linkEncode(payload, 2, frame, LINK_FRAME_MAX - 1));
+}
+
+// Octet altéré : CRC faux, trame écartée, la suivante passe
+void test_corrupted_frame_rejected() {
+    const uint8_t payload[] = {LINK_CMD_PING, 3, 'a', 'b', 'c'};
+    uint8_t frame[LINK_FRAME_MAX];
+    size_t n = linkEncode(payload, sizeof(payload), frame, sizeof(frame));
+    frame[3] ^= 0x01;
+    TEST_ASSERT_EQUAL(0, feed(frame, n));
+    TEST_ASSERT_EQUAL(1, decoder.crcErrors);
+    frame[3] ^= 0x01;
+    TEST_ASSERT_EQUAL(1, feed(frame, n));
+    TEST_ASSERT_EQUAL(1, decoder.frames);
+}
+
+// Texte du journal entre deux trames : écarté sans perdre la trame suivante
+void test_text_between_frames() {
+    const uint8_t payload[] = {LINK_MSG_STATUS, 9, 1};
+    uint8_t frame[LINK_FRAME_MAX];
+    size_t n = linkEncode(payload, sizeof(payload), frame, sizeof(frame));
+    const char *text = "Carte lue\r\n";
+    TEST_ASSERT_EQUAL(1, feed(frame, n));
+    feed((const uint8_t *)text, strlen(text));
+    TEST_ASSERT_EQUAL(1, feed(frame, n));
+    TEST_ASSERT_EQUAL(2, decoder.frames);
+    TEST_ASSERT_EQUAL(1, decoder.crcErrors + decoder.framingErrors);
+}
+
+// Délimiteurs consécutifs et trame trop courte
+void test_delimiters_and_short_frame() {
+    TEST_ASSERT_EQUAL(LINK_NONE, linkDecoderFeed(decoder, 0x00));
+    TEST_ASSERT_EQUAL(LINK_NONE, linkDecoderFeed(decoder, 0x00));
+    const uint8_t shortFrame[] = {0x00, 0x03, 0x41, 0x42, 0x00};
+    TEST_ASSERT_EQUAL(0, feed(shortFrame, sizeof(shortFrame)));
+    TEST_ASSERT_EQUAL(1, decoder.framingErrors);
+    TEST_ASSERT_EQUAL(0, decoder.crcErrors);
+}
+
+// Flux sans délimiteur plus long qu'une trame : rejeté au délimiteur suivant
+void test_overflow_rejected() {
+    uint8_t noise[LINK_FRAME_MAX * 2];
+    memset(noise, 0x41, sizeof(noise));
+    TEST_ASSERT_EQUAL(0, feed(noise, sizeof(noise)));
+    TEST_ASSERT_EQUAL(LINK_ERROR, linkDecoderFeed(decoder, 0x00));
+    TEST_ASSERT_EQUAL(1, decoder.framingErrors);
+}
+
+void test_little_endian_helpers() {
+    uint8_t buf[4];
+    linkPut16(buf, 0xBEEF);
+    TEST_ASSERT_EQUAL_HEX8(0xEF, buf[0]);
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, linkGet16(buf));
+    linkPut32(buf, 0xDEADBEEF);
+    TEST_ASSERT_EQUAL_HEX8(0xDE, buf[3]);
+    TEST_ASSERT_EQUAL_UINT32(0xDEADBEEF, linkGet32(buf));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_check_value);
+    RUN_TEST(test_round_trip_with_zeros);
+    RUN_TEST(test_round_trip_max_payload);
+    RUN_TEST(test_encode_rejects_bad_sizes);
+    RUN_TEST(test_corrupted_frame_rejected);
+    RUN_TEST(test_text_between_frames);
+    RUN_TEST(test_delimiters_and_short_frame);
+    RUN_TEST(test_overflow_rejected);
+    RUN_TEST(test_little_endian_helpers);
+    return UNITY_END();
+}
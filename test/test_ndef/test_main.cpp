@@ -0,0 +1,121 @@
+/*
+ * Analyse et encodage NDEF (ndef.h) sur les images de référence
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <ndef.h>
+#include <ndef_samples.h>
+
+void setUp() {}
+void tearDown() {}
+
+// Statut attendu, puis résumé de chaque enregistrement (« ! » : malformé en dernier)
+static void checkArea(const byte *area, size_t length, NdefStatus expected, std::vector<const char *> records,
+                      size_t expectedNeeded = 0) {
+    const byte *message = nullptr;
+    size_t messageLength = 0;
+    size_t needed = 0;
+    NdefStatus status = ndefFindMessage(area, length, &message, &messageLength, &needed);
+    TEST_ASSERT_EQUAL(expected, status);
+    if (status == NDEF_TRUNCATED) TEST_ASSERT_EQUAL(expectedNeeded, needed);
+    if (status != NDEF_OK) return;
+    NdefCursor cursor;
+    NdefRecord record;
+    char line[512];
+    size_t count = 0;
+    ndefBegin(cursor, message, messageLength);
+    while ((status = ndefNextRecord(cursor, record)) == NDEF_OK) {
+        TEST_ASSERT_LESS_THAN(records.size(), count);
+        ndefDescribe(record, line, sizeof(line));
+        TEST_ASSERT_EQUAL_STRING(records[count], line);
+        count++;
+    }
+    bool malformed = !records.empty() && strcmp(records.back(), "!") == 0;
+    TEST_ASSERT_EQUAL(malformed ? NDEF_MALFORMED : NDEF_END, status);
+    TEST_ASSERT_EQUAL(malformed ? records.size() - 1 : records.size(), count);
+}
+
+static void checkEncode(NdefKind kind, const char *value, const char *lang, const String &expected) {
+    byte tlv[512];
+    size_t length = ndefEncode(kind, value, lang, tlv, sizeof(tlv));
+    TEST_ASSERT_NOT_EQUAL(0, length);
+    checkArea(tlv, length, NDEF_OK, {expected.c_str()});
+}
+
+void test_ntag213_uri_and_text() {
+    checkArea(ntag213Image + 16, 48, NDEF_OK, {"URI https://www.example.org/badge?id=1234", "Texte [fr] Bonjour"});
+}
+
+void test_ultralight_lock_tlv_skipped() {
+    checkArea(ultralightImage + 16, 48, NDEF_OK, {"Texte [fr] Accès visiteur"});
+}
+
+void test_classic_mad_across_sectors() {
+    byte area[96];
+    size_t length = classicNdefArea(classic1kImage, 16, area, sizeof(area));
+    checkArea(area, length, NDEF_OK, {"URI https://intranet.example.com/agents/fiche?matricule=000123"});
+}
+
+void test_classic_without_mad() {
+    const byte blank[256] = {0};
+    byte area[96];
+    TEST_ASSERT_EQUAL(0, classicNdefArea(blank, 16, area, sizeof(area)));
+}
+
+void test_mime_long_record() {
+    std::vector<byte> vcard = ndefVcardArea();
+    checkArea(vcard.data(), vcard.size(), NDEF_OK, {"MIME text/vcard (300 octets)"});
+}
+
+void test_blank_and_empty() {
+    const byte blank[48] = {0};
+    const byte emptyMessage[3] = {NDEF_TLV_MESSAGE, 0x00, NDEF_TLV_TERMINATOR};
+    checkArea(blank, sizeof(blank), NDEF_NO_MESSAGE, {});
+    checkArea(emptyMessage, sizeof(emptyMessage), NDEF_OK, {});
+}
+
+void test_truncated_reports_needed() {
+    checkArea(ntag213Image + 16, 24, NDEF_TRUNCATED, {}, 46);
+}
+
+void test_invalid_length_is_malformed() {
+    const byte overflow[8] = {NDEF_TLV_MESSAGE, 0x05, 0xD1, 0x01, 0x09, 'U', 0x04, NDEF_TLV_TERMINATOR};
+    checkArea(overflow, sizeof(overflow), NDEF_OK, {"!"});
+}
+
+void test_encode_round_trip() {
+    checkEncode(NDEF_KIND_URI, "https://www.example.org/x", nullptr, "URI https://www.example.org/x");
+    checkEncode(NDEF_KIND_TEXT, "Hello", "en", "Texte [en] Hello");
+    String longText(300, 'a');
+    checkEncode(NDEF_KIND_TEXT, longText.c_str(), nullptr, "Texte [fr] " + longText);
+}
+
+void test_encode_buffer_too_small() {
+    byte tlv[8];
+    TEST_ASSERT_EQUAL(0, ndefEncode(NDEF_KIND_URI, "https://www.example.org/x", nullptr, tlv, sizeof(tlv)));
+}
+
+void test_mad_matches_nxp_tools() {
+    byte mad[32];
+    ndefMadBuild(0xFFFE, mad);
+    TEST_ASSERT_EQUAL_HEX8(0x14, mad[0]);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFE, ndefMadSectors(mad));
+    mad[5] ^= 1;
+    TEST_ASSERT_EQUAL_UINT16(0, ndefMadSectors(mad));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ntag213_uri_and_text);
+    RUN_TEST(test_ultralight_lock_tlv_skipped);
+    RUN_TEST(test_classic_mad_across_sectors);
+    RUN_TEST(test_classic_without_mad);
+    RUN_TEST(test_mime_long_record);
+    RUN_TEST(test_blank_and_empty);
+    RUN_TEST(test_truncated_reports_needed);
+    RUN_TEST(test_invalid_length_is_malformed);
+    RUN_TEST(test_encode_round_trip);
+    RUN_TEST(test_encode_buffer_too_small);
+    RUN_TEST(test_mad_matches_nxp_tools);
+    return UNITY_END();
+}
@@ -0,0 +1,195 @@
+/*
+ * Boîte d'envoi persistante (upload_outbox.h) : séquence, acquittements,
+ * reprise après redémarrage, saturation et compaction
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <native_sim.h>
+#include <settings.h>
+#include <upload_outbox.h>
+
+void nativeSetup();
+
+void setUp() {
+    LittleFS.remove(OUTBOX_EVENTS_PATH);
+    LittleFS.remove(OUTBOX_STATE_PATH);
+    outboxBegin();
+    LoopbackHttpServer::instance().clear();
+    LoopbackHttpServer::instance().reachable = true;
+}
+void tearDown() {}
+
+static uint32_t append() {
+    ScanRecord scan = scanRecord("04a1b2c3", "&site=12");
+    TEST_ASSERT_TRUE(outboxAppend(scan));
+    return scan.sequence;
+}
+
+void test_sequence_and_device() {
+    ScanRecord scan = scanRecord("04a1b2c3", "&site=12");
+    TEST_ASSERT_TRUE(outboxAppend(scan));
+    TEST_ASSERT_EQUAL_STRING(deviceId(), scan.device);
+    uint32_t first = scan.sequence;
+    TEST_ASSERT_NOT_EQUAL(0, first);
+    TEST_ASSERT_EQUAL(first + 1, append());
+    TEST_ASSERT_EQUAL(first + 2, append());
+    TEST_ASSERT_EQUAL(3, outboxStats().pending);
+    TEST_ASSERT_EQUAL(3, outboxStats().fileRecords);
+}
+
+// Le filigrane ne suit que la suite acquittée en tête
+void test_out_of_order_ack() {
+    uint32_t s1 = append();
+    uint32_t s2 = append();
+    uint32_t s3 = append();
+    uint32_t watermark = outboxStats().watermark;
+    outboxAck(s2);
+    TEST_ASSERT_EQUAL(watermark, outboxStats().watermark);
+    TEST_ASSERT_EQUAL(2, outboxStats().pending);
+    outboxAck(s2);
+    TEST_ASSERT_EQUAL(1, outboxStats().acked);
+    outboxAck(s1);
+    TEST_ASSERT_EQUAL(s2, outboxStats().watermark);
+    outboxAck(s3);
+    TEST_ASSERT_EQUAL(s3, outboxStats().watermark);
+    TEST_ASSERT_EQUAL(0, outboxStats().pending);
+}
+
+// 2xx à 4xx acquittent ; 5xx, 408, 429 et échec réseau laissent en attente
+void test_result_codes() {
+    uint32_t s1 = append();
+    uint32_t s2 = append();
+    outboxResult(s1, 503);
+    outboxResult(s2, -1);
+    outboxResult(s1, 408);
+    outboxResult(s2, 429);
+    TEST_ASSERT_EQUAL(2, outboxStats().pending);
+    TEST_ASSERT_EQUAL(4, outboxStats().failures);
+    outboxResult(s2, 404);
+    outboxResult(s1, 200);
+    TEST_ASSERT_EQUAL(0, outboxStats().pending);
+}
+
+// Redémarrage : les non acquittés sont relus, aucun numéro n'est réutilisé
+void test_restart_recovers_pending() {
+    uint32_t s1 = append();
+    append();
+    uint32_t s3 = append();
+    outboxAck(s1);
+    outboxBegin();
+    TEST_ASSERT_GREATER_OR_EQUAL(2, outboxStats().recovered);
+    TEST_ASSERT_LESS_OR_EQUAL(3, outboxStats().recovered);
+    TEST_ASSERT_GREATER_THAN(s3, outboxStats().nextSequence);
+    TEST_ASSERT_GREATER_THAN(s3, append());
+}
+
+// Ajout interrompu en fin de fichier : coupé au démarrage, les suivants restent alignés
+void test_torn_tail_truncated() {
+    append();
+    append();
+    File torn = LittleFS.open(OUTBOX_EVENTS_PATH, "a");
+    static const uint8_t partial[10] = {0x42, 0x4F, 0x01};
+    torn.write(partial, sizeof(partial));
+    torn.close();
+    outboxBegin();
+    TEST_ASSERT_EQUAL(2, outboxStats().pending);
+    TEST_ASSERT_EQUAL(2, outboxStats().fileRecords);
+    append();
+    outboxBegin();
+    TEST_ASSERT_EQUAL(3, outboxStats().recovered);
+}
+
+// Boîte pleine : les plus anciens sont abandonnés et comptés
+void test_full_drops_oldest() {
+    for (int i = 0; i < OUTBOX_CAPACITY + 8; i++) append();
+    TEST_ASSERT_EQUAL(OUTBOX_CAPACITY, outboxStats().pending);
+    TEST_ASSERT_EQUAL(8, outboxStats().dropped);
+    TEST_ASSERT_EQUAL(0, outboxStats().notDurable);
+}
+
+// Tout acquitté : le fichier repart de zéro au prochain ajout
+void test_file_restarts_when_all_acked() {
+    uint32_t s1 = append();
+    uint32_t s2 = append();
+    outboxAck(s1);
+    outboxAck(s2);
+    TEST_ASSERT_EQUAL(2, outboxStats().fileRecords);
+    append();
+    TEST_ASSERT_EQUAL(1, outboxStats().fileRecords);
+}
+
+// Enregistrements acquittés en tête : compactés par outboxLoop(), attente conservée
+void test_compaction() {
+    uint32_t sequences[OUTBOX_COMPACT_RECORDS + 8];
+    for (uint32_t &s : sequences) s = append();
+    for (int i = 0; i <= OUTBOX_COMPACT_RECORDS; i++) outboxAck(sequences[i]);
+    LoopbackHttpServer::instance().reachable = false;
+    outboxLoop();
+    TEST_ASSERT_EQUAL(1, outboxStats().compactions);
+    TEST_ASSERT_EQUAL(7, outboxStats().fileRecords);
+    TEST_ASSERT_EQUAL(7, outboxStats().pending);
+    outboxBegin();
+    TEST_ASSERT_EQUAL(7, outboxStats().recovered);
+}
+
+// Hors ligne : outboxLoop() compacte les abandonnés sans rien renvoyer
+void test_offline_loop_compacts() {
+    wifiConnected = false;
+    for (int i = 0; i < OUTBOX_CAPACITY + OUTBOX_COMPACT_RECORDS; i++) append();
+    delay(OUTBOX_RETRY_MAX_MS);
+    outboxLoop();
+    wifiConnected = true;
+    TEST_ASSERT_EQUAL(1, outboxStats().compactions);
+    TEST_ASSERT_EQUAL(OUTBOX_CAPACITY, outboxStats().fileRecords);
+    TEST_ASSERT_EQUAL(0, outboxStats().replayed);
+    TEST_ASSERT_EQUAL(0, LoopbackHttpServer::instance().received.size());
+}
+
+// Hors ligne sans passage dans outboxLoop() : l'ajout compacte le fichier plein
+void test_full_file_compacted_on_append() {
+    for (int i = 0; i < OUTBOX_FILE_MAX + 8; i++) append();
+    TEST_ASSERT_EQUAL(1, outboxStats().compactions);
+    TEST_ASSERT_EQUAL(0, outboxStats().notDurable);
+    TEST_ASSERT_EQUAL(OUTBOX_CAPACITY, outboxStats().pending);
+    TEST_ASSERT_EQUAL(OUTBOX_FILE_MAX + 8 - OUTBOX_CAPACITY, outboxStats().dropped);
+    outboxBegin();
+    TEST_ASSERT_EQUAL(OUTBOX_CAPACITY, outboxStats().recovered);
+}
+
+// Renvoi après échec : le plus ancien, avec la même clé d'idempotence
+void test_replay_same_key() {
+    uint32_t s1 = append();
+    append();
+    outboxResult(s1, 503);
+    outboxLoop();
+    TEST_ASSERT_EQUAL(0, LoopbackHttpServer::instance().received.size());
+    delay(OUTBOX_RETRY_MIN_MS);
+    outboxLoop();
+    const std::vector<LoopbackRequest> &received = LoopbackHttpServer::instance().received;
+    TEST_ASSERT_EQUAL(1, received.size());
+    char key[64];
+    snprintf(key, sizeof(key), "%s-%lu", deviceId(), (unsigned long)s1);
+    TEST_ASSERT_EQUAL_STRING(key, received[0].idempotencyKey.c_str());
+    TEST_ASSERT_EQUAL(1, outboxStats().replayed);
+    TEST_ASSERT_EQUAL(1, outboxStats().pending);
+}
+
+int main() {
+    Serial.setEcho(false);
+    nativeSetVirtualTime(true);
+    nativeSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_sequence_and_device);
+    RUN_TEST(test_out_of_order_ack);
+    RUN_TEST(test_result_codes);
+    RUN_TEST(test_restart_recovers_pending);
+    RUN_TEST(test_torn_tail_truncated);
+    RUN_TEST(test_full_drops_oldest);
+    RUN_TEST(test_file_restarts_when_all_acked);
+    RUN_TEST(test_compaction);
+    RUN_TEST(test_offline_loop_compacts);
+    RUN_TEST(test_full_file_compacted_on_append);
+    RUN_TEST(test_replay_same_key);
+    return UNITY_END();
+}
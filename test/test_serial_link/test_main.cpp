@@ -0,0 +1,85 @@
+/*
+ * Liaison série (serial_link.h) : en mode binaire, seuls des octets de trames
+ * sortent sur Serial, quel que soit le mode de scan
+ */
+#include <unity.h>
+#include <Arduino.h>
+#include <native_sim.h>
+#include <scanner.h>
+#include <settings.h>
+#include <serial_link.h>
+
+void nativeSetup();
+std::shared_ptr<SimCard> nativeMakeCard(const String &name);
+void nativeDrainPipeline();
+
+void setUp() {
+    serialLinkBegin(nullptr);
+    Serial.inject("BINARY\n");
+    serialLinkPoll();
+}
+void tearDown() {}
+
+// Présente une carte dans le mode donné ; octets écrits hors trames
+static size_t textBytes(ScanMode scanMode) {
+    size_t written = Serial.bytesWritten();
+    uint32_t frameBytes = serialLinkStats().bytesOut;
+    mode = scanMode;
+    SimField &field = SimField::instance();
+    field.place(nativeMakeCard("classic1k"));
+    handleRFIDOperations();
+    field.remove();
+    nativeDrainPipeline();
+    mode = MODE_READ;
+    return (Serial.bytesWritten() - written) - (serialLinkStats().bytesOut - frameBytes);
+}
+
+void test_enters_binary() {
+    TEST_ASSERT_TRUE(serialLinkBinary());
+    TEST_ASSERT_EQUAL(SERIAL_LINK_TEXT_BAUD, serialLinkStats().baud);
+    TEST_ASSERT_GREATER_THAN(0, serialLinkStats().framesOut);
+}
+
+void test_read_emits_frames_only() {
+    uint32_t frames = serialLinkStats().framesOut;
+    TEST_ASSERT_EQUAL(0, textBytes(MODE_READ));
+    // LINK_MSG_SCAN puis LINK_MSG_RESULT
+    TEST_ASSERT_GREATER_OR_EQUAL(frames + 2, serialLinkStats().framesOut);
+}
+
+void test_write_emits_frames_only() {
+    dataToWrite = "Jean Dupont";
+    TEST_ASSERT_EQUAL(0, textBytes(MODE_WRITE));
+}
+
+void test_format_emits_frames_only() {
+    TEST_ASSERT_EQUAL(0, textBytes(MODE_FORMAT));
+}
+
+void test_backup_emits_frames_only() {
+    TEST_ASSERT_EQUAL(0, textBytes(MODE_BACKUP));
+}
+
+// Retour au mode texte : le journal reprend sur Serial
+void test_text_mode_logs_again() {
+    serialLinkBegin(nullptr);
+    TEST_ASSERT_FALSE(serialLinkBinary());
+    TEST_ASSERT_GREATER_THAN(0, textBytes(MODE_READ));
+}
+
+int main() {
+    Serial.setEcho(false);
+    nativeSetVirtualTime(true);
+    nativeSetup();
+    rfAutoTune = false;
+    continuousMode = true;
+    scanDelayMs = 0;
+    UNITY_BEGIN();
+    RUN_TEST(test_enters_binary);
+    RUN_TEST(test_read_emits_frames_only);
+    RUN_TEST(test_write_emits_frames_only);
+    RUN_TEST(test_format_emits_frames_only);
+    RUN_TEST(test_backup_emits_frames_only);
+    RUN_TEST(test_text_mode_logs_again);
+    return UNITY_END();
+}
@@ -0,0 +1,239 @@
+/*
+ * Serveur CoAP de test pour la remontée des scans (coap_uplink.h).
+ *
+ * Compilation (depuis la racine du dépôt) :
+ *   g++ -std=c++17 -O2 -Iinclude tools/coap_server.cpp src/coap_message.cpp -o coap_server
+ *
+ * Usage :
+ *   coap_server [--port P] [--allow uid,uid...] [--deny uid,uid...]
+ *               [--loss F] [--delay-ms D] [--separate] [--ttl S]
+ *
+ *     --allow      seuls ces UID sont autorisés (sinon tous, sauf --deny)
+ *     --deny       UID refusés
+ *     --loss F     proportion de datagrammes perdus, à l'aller et au retour
+ *     --delay-ms D délai de traitement avant la réponse
+ *     --separate   ACK vide immédiat puis réponse séparée (CON) après le délai
+ *     --ttl S      décision réutilisable S secondes par le lecteur (« allow&ttl=S »)
+ *
+ * Lecteur : URL d'API « coap://<ip de l'hôte>:P/api/scan », corps form ou
+ * CBOR (Content-Format 60). Chaque POST reçu est affiché en ligne JSON sur
+ * stdout. Les renvois (même identifiant
+ * de message, même émetteur) reçoivent la réponse déjà envoyée, sans
+ * nouveau traitement, comme le demande la RFC 7252.
+ *
+ * Le banc program coap (env:native) mesure la latence de ce même échange
+ * contre le firmware, comparée au POST HTTP.
+ */
+#include <coap_message.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <deque>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#define DEDUPE_ENTRIES 256
+#define SEPARATE_RETRY_MS 500
+#define SEPARATE_MAX_RETRANSMIT 4
+
+struct Sent {
+    sockaddr_in peer;
+    uint16_t messageId;
+    std::vector<uint8_t> response;
+};
+
+// Réponse séparée en attente de son ACK
+struct Separate {
+    sockaddr_in peer;
+    uint16_t messageId;
+    std::vector<uint8_t> datagram;
+    uint64_t dueUs;
+    int attempts;
+};
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static std::set<std::string> splitList(const char *list) {
+    std::set<std::string> out;
+    std::string item;
+    for (const char *p = list;; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) out.insert(item);
+            item.clear();
+            if (!*p) break;
+        } else {
+            item += tolower(*p);
+        }
+    }
+    return out;
+}
+
+static bool samePeer(const sockaddr_in &a, const sockaddr_in &b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+static int usage() {
+    fprintf(stderr, "Usage: coap_server [--port P] [--allow uid,...] [--deny uid,...] [--loss F] [--delay-ms D] "
+                    "[--separate] [--ttl S]\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    int port = 5683;
+    std::set<std::string> allow, deny;
+    bool allowList = false;
+    double loss = 0;
+    int delayMs = 0;
+    bool separate = false;
+    int ttl = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--allow") == 0 && i + 1 < argc) allow = splitList(argv[++i]), allowList = true;
+        else if (strcmp(argv[i], "--deny") == 0 && i + 1 < argc) deny = splitList(argv[++i]);
+        else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) loss = atof(argv[++i]);
+        else if (strcmp(argv[i], "--delay-ms") == 0 && i + 1 < argc) delayMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--separate") == 0) separate = true;
+        else if (strcmp(argv[i], "--ttl") == 0 && i + 1 < argc) ttl = atoi(argv[++i]);
+        else return usage();
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("bind");
+        return 1;
+    }
+    fprintf(stderr, "Serveur CoAP sur le port %d\n", port);
+
+    std::mt19937 rng(nowUs());
+    std::uniform_real_distribution<double> draw(0, 1);
+    auto lost = [&] { return loss > 0 && draw(rng) < loss; };
+    auto sendTo = [&](const sockaddr_in &peer, const std::vector<uint8_t> &datagram) {
+        if (!lost()) sendto(fd, datagram.data(), datagram.size(), 0, (const sockaddr *)&peer, sizeof(peer));
+    };
+    std::deque<Sent> sent;
+    std::vector<Separate> pending;
+    uint16_t nextMessageId = nowUs();
+    uint32_t processed = 0, duplicates = 0;
+
+    while (true) {
+        // Renvoi des réponses séparées non acquittées
+        uint64_t now = nowUs();
+        for (size_t i = 0; i < pending.size();) {
+            Separate &s = pending[i];
+            if (s.dueUs > now) {
+                i++;
+                continue;
+            }
+            if (s.attempts++ > SEPARATE_MAX_RETRANSMIT) {
+                pending.erase(pending.begin() + i);
+                continue;
+            }
+            sendTo(s.peer, s.datagram);
+            s.dueUs = now + SEPARATE_RETRY_MS * 1000ULL;
+            i++;
+        }
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 10) <= 0) continue;
+        uint8_t buf[1500];
+        sockaddr_in peer = {};
+        socklen_t peerLength = sizeof(peer);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr *)&peer, &peerLength);
+        CoapMessage msg;
+        if (n <= 0 || lost() || !coapParse(buf, n, msg)) continue;
+        if (msg.type == COAP_TYPE_ACK || msg.type == COAP_TYPE_RST) {
+            for (size_t i = 0; i < pending.size(); i++) {
+                if (samePeer(pending[i].peer, peer) && pending[i].messageId == msg.messageId) {
+                    pending.erase(pending.begin() + i);
+                    break;
+                }
+            }
+            continue;
+        }
+        // Renvoi du lecteur : même réponse, sans nouveau traitement
+        bool duplicate = false;
+        for (const Sent &s : sent) {
+            if (samePeer(s.peer, peer) && s.messageId == msg.messageId) {
+                sendTo(peer, s.response);
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            duplicates++;
+            printf("{\"mid\":%u,\"duplicate\":true,\"duplicates\":%u}\n", msg.messageId, duplicates);
+            fflush(stdout);
+            continue;
+        }
+        std::string body((const char *)msg.payload, msg.payload ? msg.payloadLength : 0);
+        std::string uid;
+        if (msg.contentFormat == COAP_FORMAT_CBOR) {
+            // Corps CBOR (scan_payload.h) : map dont la première entrée est 0 -> UID en octets
+            const uint8_t *p = msg.payload;
+            size_t n = msg.payloadLength;
+            if (n >= 3 && (p[0] >> 5) == 5 && p[1] == 0x00 && (p[2] >> 5) == 2 && (p[2] & 0x1F) < 24 &&
+                3 + (size_t)(p[2] & 0x1F) <= n) {
+                static const char digits[] = "0123456789abcdef";
+                for (int i = 0; i < (p[2] & 0x1F); i++) {
+                    uid += digits[p[3 + i] >> 4];
+                    uid += digits[p[3 + i] & 0x0F];
+                }
+            }
+            body = "cbor:" + std::to_string(n) + " octets";
+        } else if (body.compare(0, 4, "uid=") == 0) {
+            uid = body.substr(4, body.find('&', 4) - 4);
+        }
+        for (char &c : uid) c = tolower(c);
+        uint8_t code = COAP_CODE_CHANGED;
+        const char *decision = "allow";
+        if (msg.code != COAP_CODE_POST || uid.empty()) {
+            code = COAP_CODE_BAD_REQUEST;
+            decision = "";
+        } else if (deny.count(uid) || (allowList && !allow.count(uid))) {
+            decision = "deny";
+        }
+        processed++;
+        std::string answer = decision;
+        if (ttl > 0 && *decision) answer += "&ttl=" + std::to_string(ttl);
+        if (delayMs && !separate) usleep(delayMs * 1000);
+
+        uint8_t out[256];
+        CoapWriter w;
+        std::vector<uint8_t> ack;
+        if (separate && msg.type == COAP_TYPE_CON) {
+            // ACK vide tout de suite, décision dans un CON séparé
+            coapBegin(w, out, sizeof(out), COAP_TYPE_ACK, COAP_CODE_EMPTY, msg.messageId, nullptr, 0);
+            ack.assign(out, out + coapEnd(w));
+            coapBegin(w, out, sizeof(out), COAP_TYPE_CON, code, nextMessageId, msg.token, msg.tokenLength);
+            coapPayload(w, (const uint8_t *)answer.data(), answer.size());
+            pending.push_back({peer, nextMessageId++, std::vector<uint8_t>(out, out + coapEnd(w)),
+                               nowUs() + delayMs * 1000ULL, 0});
+        } else {
+            uint8_t type = msg.type == COAP_TYPE_CON ? COAP_TYPE_ACK : COAP_TYPE_NON;
+            uint16_t messageId = msg.type == COAP_TYPE_CON ? msg.messageId : nextMessageId++;
+            coapBegin(w, out, sizeof(out), type, code, messageId, msg.token, msg.tokenLength);
+            coapPayload(w, (const uint8_t *)answer.data(), answer.size());
+            ack.assign(out, out + coapEnd(w));
+        }
+        sendTo(peer, ack);
+        sent.push_back({peer, msg.messageId, ack});
+        if (sent.size() > DEDUPE_ENTRIES) sent.pop_front();
+        printf("{\"mid\":%u,\"uid\":\"%s\",\"decision\":\"%s\",\"body\":\"%s\",\"processed\":%u}\n", msg.messageId,
+               uid.c_str(), decision, body.c_str(), processed);
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,309 @@
+/*
+ * Outil hôte Linux pour la liaison série binaire du lecteur (serial_link.h).
+ *
+ * Compilation (depuis la racine du dépôt) :
+ *   g++ -std=c++17 -O2 -Iinclude tools/rfid_link.cpp src/link_frame.cpp -o rfid_link
+ *
+ * Usage :
+ *   rfid_link <port> [--baud B] [--switch] <commande>
+ *     monitor              scans et décisions en lignes JSON sur stdout
+ *     status               état du lecteur
+ *     ping [n]             aller-retour d'une trame, p50/p99 en µs
+ *     mode <NOM> [arg]     READ, WRITE <données>, RESTORE <uid>, SCAN, STOP...
+ *     image <uid> [fichier] image de carte sauvegardée (BACKUP)
+ *     text                 retour du lecteur au mode texte
+ *
+ * --switch ouvre le port à 115200 bauds, envoie « BINARY B » puis passe à B
+ * (921600 par défaut). Sans --switch, le lecteur doit déjà être en binaire.
+ * Les segments qui ne sont pas des trames valides (journal texte du
+ * firmware) sont recopiés sur stderr.
+ *
+ * Le banc program serial (env:native) mesure débit et latence de ce même
+ * décodage contre le firmware, à travers un pseudo-terminal.
+ */
+#include <link_frame.h>
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#define ACK_TIMEOUT_MS 2000
+
+struct Link {
+    int fd = -1;
+    LinkDecoder decoder = {};
+    uint8_t seq = 0;
+    // Segment en cours, gardé pour afficher le texte rejeté par le décodeur
+    std::string segment;
+};
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static bool setBaud(int fd, unsigned long baud) {
+    speed_t speed;
+    switch (baud) {
+    case 115200: speed = B115200; break;
+    case 230400: speed = B230400; break;
+    case 460800: speed = B460800; break;
+    case 921600: speed = B921600; break;
+    default: return false;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cflag |= CLOCAL | CREAD;
+    // Pseudo-terminal (banc native) : la vitesse est sans effet, pas une erreur
+    tcsetattr(fd, TCSANOW, &tio);
+    return true;
+}
+
+static bool sendFrame(Link &link, uint8_t type, const uint8_t *body, size_t length, uint8_t &seq) {
+    uint8_t payload[LINK_PAYLOAD_MAX];
+    uint8_t frame[LINK_FRAME_MAX];
+    if (length > LINK_PAYLOAD_MAX - LINK_HEADER_SIZE) return false;
+    seq = link.seq++;
+    payload[0] = type;
+    payload[1] = seq;
+    if (length) memcpy(payload + LINK_HEADER_SIZE, body, length);
+    size_t n = linkEncode(payload, LINK_HEADER_SIZE + length, frame, sizeof(frame));
+    return n && write(link.fd, frame, n) == (ssize_t)n;
+}
+
+static void showSegment(const std::string &segment) {
+    size_t start = segment.find_first_not_of("\r\n");
+    if (start == std::string::npos) return;
+    fprintf(stderr, "%s", segment.c_str() + start);
+    if (segment.back() != '\n') fputc('\n', stderr);
+}
+
+// Trame suivante (payload dans link.decoder.buf) ; false à l'échéance
+static bool readFrame(Link &link, int timeoutMs) {
+    uint64_t deadline = nowUs() + (uint64_t)timeoutMs * 1000;
+    // Octets lus mais pas encore décodés : ils restent d'un appel à l'autre
+    static uint8_t rx[256];
+    static size_t pending = 0, pos = 0;
+    for (;;) {
+        while (pos < pending) {
+            uint8_t c = rx[pos++];
+            if (c && link.segment.size() < 1024) link.segment += (char)c;
+            LinkFeed feed = linkDecoderFeed(link.decoder, c);
+            if (c == 0) {
+                if (feed == LINK_ERROR) showSegment(link.segment);
+                link.segment.clear();
+            }
+            if (feed == LINK_FRAME) return true;
+        }
+        int64_t left = timeoutMs < 0 ? -1 : ((int64_t)deadline - (int64_t)nowUs()) / 1000;
+        if (timeoutMs >= 0 && left <= 0) return false;
+        struct pollfd pfd = {link.fd, POLLIN, 0};
+        if (poll(&pfd, 1, (int)left) <= 0) continue;
+        ssize_t n = read(link.fd, rx, sizeof(rx));
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            return false;
+        }
+        pending = n;
+        pos = 0;
+    }
+}
+
+static const char *ackName(uint8_t result) {
+    switch (result) {
+    case LINK_ACK_OK: return "ok";
+    case LINK_ACK_INVALID: return "invalide";
+    case LINK_ACK_UNKNOWN: return "inconnu";
+    case LINK_ACK_NOT_FOUND: return "introuvable";
+    default: return "?";
+    }
+}
+
+static void printScan(const uint8_t *body, size_t length) {
+    if (length < 11 || length < 11u + body[10]) return;
+    char uid[21] = "";
+    for (uint8_t i = 0; i < body[10] && i < 10; i++) snprintf(uid + 2 * i, 3, "%02x", body[11 + i]);
+    size_t fieldsAt = 11 + body[10];
+    printf("{\"type\":\"scan\",\"id\":%u,\"uid\":\"%s\",\"picc\":%u,\"decision\":%u,\"capturedUs\":%u,"
+           "\"fields\":\"%.*s\"}\n",
+           linkGet32(body), uid, body[8], body[9], linkGet32(body + 4), (int)(length - fieldsAt),
+           (const char *)body + fieldsAt);
+}
+
+static void printStatus(const uint8_t *body, size_t length) {
+    if (length < 20) return;
+    printf("{\"type\":\"status\",\"mode\":%u,\"continuous\":%s,\"uptimeS\":%u,\"heapFree\":%u,\"queued\":%u,"
+           "\"drops\":%u,\"rc522Healthy\":%s,\"lastScan\":%u}\n",
+           body[0], body[1] ? "true" : "false", linkGet32(body + 2), linkGet32(body + 6), body[10],
+           linkGet32(body + 11), body[15] ? "true" : "false", linkGet32(body + 16));
+}
+
+// Affiche les messages spontanés ; true si c'est l'ACK attendu (résultat dans result)
+static bool dispatch(Link &link, int ackType, int ackSeq, uint8_t &result, FILE *image) {
+    const uint8_t *payload = link.decoder.buf;
+    const uint8_t *body = payload + LINK_HEADER_SIZE;
+    size_t length = link.decoder.length - LINK_HEADER_SIZE;
+    switch (payload[0]) {
+    case LINK_MSG_SCAN:
+        printScan(body, length);
+        break;
+    case LINK_MSG_RESULT:
+        if (length >= 9) {
+            // 2 : publié par MQTT, aucune décision de l'API
+            printf("{\"type\":\"result\",\"id\":%u,\"apiOk\":%s,\"feedbackUs\":%u}\n", linkGet32(body),
+                   body[4] == 2 ? "null" : body[4] ? "true" : "false", linkGet32(body + 5));
+        }
+        break;
+    case LINK_MSG_STATUS:
+        printStatus(body, length);
+        break;
+    case LINK_MSG_IMAGE:
+        if (length >= 4 && image) {
+            fwrite(body + 4, 1, length - 4, image);
+            fprintf(stderr, "image: %u/%u octets\r", (unsigned)(linkGet16(body) + length - 4), linkGet16(body + 2));
+        }
+        break;
+    case LINK_MSG_ACK:
+        if (length >= 3 && body[0] == ackType && body[1] == ackSeq) {
+            result = body[2];
+            return true;
+        }
+        break;
+    }
+    fflush(stdout);
+    return false;
+}
+
+// Envoie une commande et attend son acquittement
+static int command(Link &link, uint8_t type, const uint8_t *body, size_t length, FILE *image = nullptr) {
+    uint8_t seq;
+    if (!sendFrame(link, type, body, length, seq)) {
+        fprintf(stderr, "Échec d'envoi\n");
+        return 1;
+    }
+    uint8_t result = 0;
+    while (readFrame(link, ACK_TIMEOUT_MS)) {
+        if (dispatch(link, type, seq, result, image)) {
+            if (image) fputc('\n', stderr);
+            fprintf(stderr, "ack: %s\n", ackName(result));
+            return result == LINK_ACK_OK ? 0 : 1;
+        }
+    }
+    fprintf(stderr, "Pas d'acquittement\n");
+    return 1;
+}
+
+static int runPing(Link &link, int count) {
+    std::vector<uint32_t> rtts;
+    uint8_t body[16];
+    for (int i = 0; i < count; i++) {
+        linkPut32(body, i);
+        uint8_t seq, result;
+        uint64_t start = nowUs();
+        if (!sendFrame(link, LINK_CMD_PING, body, sizeof(body), seq)) break;
+        while (readFrame(link, ACK_TIMEOUT_MS)) {
+            if (dispatch(link, LINK_CMD_PING, seq, result, nullptr)) {
+                rtts.push_back(nowUs() - start);
+                break;
+            }
+        }
+    }
+    if (rtts.empty()) return 1;
+    std::sort(rtts.begin(), rtts.end());
+    printf("{\"pings\":%u,\"lost\":%u,\"rttP50Us\":%u,\"rttP99Us\":%u,\"crcErrors\":%u,\"framingErrors\":%u}\n",
+           (unsigned)rtts.size(), (unsigned)(count - rtts.size()), rtts[rtts.size() / 2],
+           rtts[std::min(rtts.size() - 1, rtts.size() * 99 / 100)], link.decoder.crcErrors,
+           link.decoder.framingErrors);
+    return 0;
+}
+
+static int usage() {
+    fprintf(stderr, "Usage: rfid_link <port> [--baud B] [--switch] monitor | status | ping [n] | "
+                    "mode <NOM> [arg] | image <uid> [fichier] | text\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) return usage();
+    unsigned long baud = 921600;
+    bool switchMode = false;
+    int arg = 2;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (strcmp(argv[arg], "--switch") == 0) {
+            switchMode = true;
+        } else if (strcmp(argv[arg], "--baud") == 0 && arg + 1 < argc) {
+            baud = strtoul(argv[++arg], nullptr, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (arg >= argc) return usage();
+    Link link;
+    linkDecoderReset(link.decoder);
+    link.fd = open(argv[1], O_RDWR | O_NOCTTY);
+    if (link.fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (switchMode) {
+        setBaud(link.fd, 115200);
+        char line[32];
+        int n = snprintf(line, sizeof(line), "BINARY %lu\n", baud);
+        if (write(link.fd, line, n) != n) return 1;
+        tcdrain(link.fd);
+        // Le lecteur confirme en texte, change de débit puis envoie un état
+        usleep(50000);
+    }
+    if (!setBaud(link.fd, baud)) {
+        fprintf(stderr, "Débit non supporté: %lu\n", baud);
+        return 2;
+    }
+    if (switchMode) tcflush(link.fd, TCIFLUSH);
+
+    std::string cmd = argv[arg++];
+    if (cmd == "monitor") {
+        uint8_t result;
+        while (readFrame(link, -1)) dispatch(link, -1, -1, result, nullptr);
+        return 0;
+    }
+    if (cmd == "status") return command(link, LINK_CMD_STATUS, nullptr, 0);
+    if (cmd == "ping") return runPing(link, arg < argc ? atoi(argv[arg]) : 100);
+    if (cmd == "mode" && arg < argc) {
+        std::string body = argv[arg];
+        if (arg + 1 < argc) {
+            body += '\0';
+            body += argv[arg + 1];
+        }
+        return command(link, LINK_CMD_MODE, (const uint8_t *)body.data(), body.size());
+    }
+    if (cmd == "image" && arg < argc) {
+        std::string path = arg + 1 < argc ? argv[arg + 1] : std::string(argv[arg]) + ".img";
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f) {
+            perror(path.c_str());
+            return 1;
+        }
+        int rc = command(link, LINK_CMD_IMAGE, (const uint8_t *)argv[arg], strlen(argv[arg]), f);
+        fclose(f);
+        if (rc == 0) fprintf(stderr, "%s\n", path.c_str());
+        return rc;
+    }
+    if (cmd == "text") {
+        uint8_t body[4];
+        linkPut32(body, 115200);
+        return command(link, LINK_CMD_TEXT, body, sizeof(body));
+    }
+    return usage();
+}